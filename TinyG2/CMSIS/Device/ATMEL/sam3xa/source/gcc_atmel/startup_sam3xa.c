@@ -37,6 +37,8 @@ extern uint32_t _srelocate;
 extern uint32_t _erelocate;
 extern uint32_t _szero;
 extern uint32_t _ezero;
+extern uint32_t _ssram1;
+extern uint32_t _esram1;
 extern uint32_t _sstack;
 extern uint32_t _estack;
 
@@ -263,6 +265,11 @@ void Reset_Handler(void)
 		*pDest++ = 0;
 	}
 
+	/* ...and the statics placed in SRAM1 (see SRAM_DMA in tinyg2.h) */
+	for (pDest = &_ssram1; pDest < &_esram1;) {
+		*pDest++ = 0;
+	}
+
 	/* Set the vector table base address */
 	pSrc = (uint32_t *) & _sfixed;
 	SCB->VTOR = ((uint32_t) pSrc & SCB_VTOR_TBLOFF_Msk);
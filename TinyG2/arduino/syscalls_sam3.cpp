@@ -111,9 +111,12 @@ extern int _read(int file, char *ptr, int len)
     return 0 ;
 }
 
+extern size_t xio_write(const uint8_t *buffer, size_t size);	// see TinyG2 xio.cpp
+
 extern int _write( int file, char *ptr, int len )
 {
-	return SerialUSB.write((const uint8_t *)ptr, len);
+	return xio_write((const uint8_t *)ptr, len);	// queued - sent from the SysTick interrupt
+//	return SerialUSB.write((const uint8_t *)ptr, len);
 /*
     int iIndex ;
 //    for ( ; *ptr != 0 ; ptr++ )
@@ -0,0 +1,399 @@
+/*
+ * benchmark.cpp - planner throughput benchmark over the built-in Gcode corpus
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	$bench=N runs corpus file N through gc_gcode_parser() and mp_aline() with the 
+ *	planner in dry-run mode - nothing is executed and the motors don't move. Results 
+ *	are read back with $bm (text) or {"bm":""} (JSON):
+ *
+ *	  bmfl	corpus file that was run
+ *	  bmbl	Gcode blocks parsed
+ *	  bmmv	moves planned (mp_aline() calls, including arcs and arc segments)
+ *	  bmpr	blocks/sec through the parser, not counting time spent in mp_aline()
+ *	  bmpl	moves/sec through mp_aline()
+ *	  bmpp	average blocks visited per planning pass
+ *	  bmpt	total planned move & dwell time in ms
+ *	  bmwt	wall time for the run in ms
+ *
+ *	The oldest planner buffers are freed as needed to keep the queue full, so 
+ *	planning runs at full look-ahead depth like it does when streaming. The machine 
+ *	must be idle. The Gcode model, planner position and machine states are restored 
+ *	afterwards, so the run leaves no trace other than the results. Times come from the 
+ *	DWT cycle counter, which limits a run to about 51 seconds of wall time.
+ *
+ *	$jit=N measures step timing jitter with interrupt priority map N (see hwIrqMap - 
+ *	1 is the default map). Start a long move first so the DDA is running. For 
+ *	BENCHMARK_JITTER_MS the console is sent blank lines as fast as it will take them, 
+ *	then the default map is put back. Results are in the same group:
+ *
+ *	  bmjm	priority map that was run
+ *	  bmjb	bytes of console output sent
+ *	  bmjs	DDA periods measured
+ *	  bmjn	shortest DDA latency in cycles (timer period start to ISR entry)
+ *	  bmjx	longest DDA latency in cycles - the jitter is bmjx - bmjn
+ *
+ *	$kern runs the kernel microbenchmarks - see Microbenchmarks in benchmark.h.
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "controller.h"
+#include "canonical_machine.h"
+#include "gcode_parser.h"
+#include "json_parser.h"
+#include "plan_arc.h"
+#include "planner.h"
+#include "stepper.h"
+#include "hardware.h"
+#include "benchmark.h"
+#include "text_parser.h"
+#include "util.h"
+#include "xio.h"
+
+// Corpus files - several declare the same array name, so each gets its own namespace
+namespace bm_zoetrope {
+#include "gcode/gcode_zoetrope.h"
+}
+namespace bm_braid2d {
+#include "gcode/gcode_braid2d.h"
+}
+namespace bm_mudflap {
+#include "gcode/gcode_mudflap.h"
+}
+namespace bm_roadrunner {
+#include "gcode/gcode_roadrunner.h"
+}
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+static const char *const bm_corpus[] = {	// $bench=N runs bm_corpus[N-1]
+	bm_zoetrope::zoetrope,
+	bm_braid2d::gcode_file,
+	bm_mudflap::gcode_file,
+	bm_roadrunner::roadrunner
+};
+#define BENCHMARK_FILES (sizeof(bm_corpus) / sizeof(bm_corpus[0]))
+
+#ifndef BENCHMARK_JITTER_MS
+#define BENCHMARK_JITTER_MS 2000	// length of a $jit run
+#endif
+
+#ifndef BENCHMARK_KERNEL_RUNS
+#define BENCHMARK_KERNEL_RUNS 63	// calls timed per kernel - odd, for the median
+#endif
+
+bmBenchmarkSingleton_t bm;
+
+static void _free_oldest_buffers(uint8_t headroom);
+
+/*
+ * bm_run_bench() - run a corpus file through the parser and planner
+ */
+
+stat_t bm_run_bench(cmdObj_t *cmd)
+{
+	uint8_t file = (uint8_t)cmd->value;
+	if ((file < 1) || (file > BENCHMARK_FILES)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if ((mp_get_runtime_busy() == true) || 
+		(mp_get_planner_buffers_available() < PLANNER_BUFFER_POOL_SIZE)) { 
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+
+	// save everything the corpus will change
+	GCodeState_t gm_saved = gm;
+	GCodeStateX_t gmx_saved = gmx;
+	float position[AXES];
+	copy_axis_vector(position, mm.position);
+	uint8_t machine_state = cm.machine_state;
+	uint8_t cycle_state = cm.cycle_state;
+	uint8_t motion_state = cm.motion_state;
+
+	mp_set_dry_run(true);
+	mm.aline_count = 0;
+	mm.aline_cycles = 0;
+	mm.plan_passes = 0;
+	mm.plan_blocks = 0;
+	uint32_t time_queued = mb.time_queued;
+
+	memset(&bm, 0, sizeof(bm));
+	bm.file = file;
+	char_t line[INPUT_BUFFER_LEN];
+	const char *p = bm_corpus[file-1];
+	uint32_t gc_cycles = 0;
+	uint32_t start = hw_get_cycle_count();
+
+	while (*p != NUL) {
+		uint8_t i = 0;							// copy out the next line
+		while ((*p != NUL) && (*p != LF) && (*p != CR)) {
+			if (i < INPUT_BUFFER_LEN-1) { line[i++] = *p;}
+			p++;
+		}
+		line[i] = NUL;
+		while ((*p == LF) || (*p == CR)) { p++;}
+		if (i == 0) { continue;}
+
+		_free_oldest_buffers(PLANNER_BUFFER_HEADROOM);
+		uint32_t gc_start = hw_get_cycle_count();
+		gc_gcode_parser(line);
+		while (cm_arc_callback() == STAT_EAGAIN) {	// arcs are generated behind the block
+			_free_oldest_buffers(PLANNER_BUFFER_HEADROOM);
+		}
+		gc_cycles += hw_get_cycle_count() - gc_start;
+		bm.blocks++;
+	}
+	float wall_cycles = (float)(hw_get_cycle_count() - start);
+
+	// put everything back
+	mp_plan_batch();							// count the time of a batch still waiting
+	uint32_t time_planned = mb.time_queued - time_queued;	// read before the flush clears the pool
+	mp_flush_planner();
+	mp_set_dry_run(false);
+	gm = gm_saved;
+	gmx = gmx_saved;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		mp_set_planner_position(axis, position[axis]);
+	}
+	cm.machine_state = machine_state;
+	cm.cycle_state = cycle_state;
+	cm.motion_state = motion_state;
+
+	bm.moves = mm.aline_count;
+	float parse_cycles = (float)(gc_cycles - mm.aline_cycles);
+	if (parse_cycles > 0) { bm.parse_rate = bm.blocks * F_CPU / parse_cycles;}
+	if (mm.aline_cycles > 0) { bm.plan_rate = mm.aline_count * (float)F_CPU / mm.aline_cycles;}
+	if (mm.plan_passes > 0) { bm.pass_length = (float)mm.plan_blocks / mm.plan_passes;}
+	bm.planned_time = (float)time_planned / 1000;
+	bm.wall_time = wall_cycles * 1000 / F_CPU;
+	return (STAT_OK);
+}
+
+/*
+ * bm_run_jitter() - measure DDA latency under heavy console output
+ */
+
+stat_t bm_run_jitter(cmdObj_t *cmd)
+{
+	static const uint8_t filler[] = "                                                               \n";
+	uint8_t map = (uint8_t)cmd->value;
+	if ((map < 1) || (map > HW_IRQ_MAPS)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if (stepper_isbusy() == false) { return (STAT_COMMAND_NOT_ACCEPTED);}
+
+	fflush(stderr);								// keep the output in order
+	hw_set_irq_priorities(map-1);
+	st_set_isrz(cmd);
+	bm.jitter_map = map;
+	bm.jitter_bytes = 0;
+
+	uint32_t end = SysTickTimer.getValue() + BENCHMARK_JITTER_MS;
+	while ((SysTickTimer.getValue() < end) && (stepper_isbusy() == true)) {
+		bm.jitter_bytes += xio_write(filler, sizeof(filler)-1);	// waits whenever the ring is full
+	}
+	hw_set_irq_priorities(HW_IRQ_MAP_DEFAULT);
+
+	__disable_irq();							// take a consistent copy
+	stIsrTiming_t t = st_isr.dda_latency;
+	__enable_irq();
+	bm.jitter_samples = t.count;
+	bm.latency_min = (t.count == 0) ? 0 : t.min;
+	bm.latency_max = t.max;
+	return (STAT_OK);
+}
+
+#ifdef __MICROBENCHMARKS
+
+volatile float bm_sink;
+
+static uint32_t _bench_get_index(const uint8_t n);
+static uint32_t _bench_serialize(const uint8_t n);
+
+typedef struct bmKernel {
+	const char *name;
+	uint32_t (*run)(const uint8_t n);	// times one call on input case n - returns the cycles
+} bmKernel_t;
+
+static const bmKernel_t bm_kernels[BENCHMARK_KERNELS] = {
+	{ "trap",  mp_bench_trapezoid },
+	{ "jvmax", mp_bench_junction_vmax },
+	{ "tvel",  mp_bench_target_velocity },
+	{ "index", _bench_get_index },
+	{ "json",  _bench_serialize },
+	{ "gword", gc_bench_gcode_word }
+};
+
+/*
+ * bm_run_kernels() - time the microbenchmark kernels
+ *
+ *	The value is the number of kernels. See ev_get_evl() for the pattern - JSON prints 
+ *	the results here, text in bm_print_kern().
+ */
+
+stat_t bm_run_kernels(cmdObj_t *cmd)
+{
+	if (mp_get_runtime_busy() == true) { return (STAT_COMMAND_NOT_ACCEPTED);}
+
+	uint32_t cycles[BENCHMARK_KERNEL_RUNS];
+	for (uint8_t k=0; k<BENCHMARK_KERNELS; k++) {
+		for (uint8_t i=0; i<BENCHMARK_KERNEL_RUNS; i++) {
+			__disable_irq();
+			uint32_t c = bm_kernels[k].run(i);
+			__enable_irq();
+
+			uint8_t j = i;						// insertion sort as they come
+			for (; (j > 0) && (cycles[j-1] > c); j--) { cycles[j] = cycles[j-1];}
+			cycles[j] = c;
+		}
+		bm.kernel_cycles[k][0] = cycles[0];
+		bm.kernel_cycles[k][1] = cycles[BENCHMARK_KERNEL_RUNS/2];
+		bm.kernel_cycles[k][2] = cycles[BENCHMARK_KERNEL_RUNS-1];
+	}
+	cmd->value = BENCHMARK_KERNELS;
+	cmd->objtype = TYPE_INTEGER;
+	if (cfg.comm_mode != JSON_MODE) { return (STAT_OK);}
+
+	fprintf_P(stderr, PSTR("{\"kern\":["));
+	for (uint8_t k=0; k<BENCHMARK_KERNELS; k++) {
+		fprintf_P(stderr, PSTR("%s[\"%s\",%lu,%lu,%lu]"), (k == 0) ? "" : ",", bm_kernels[k].name,
+				  (unsigned long)bm.kernel_cycles[k][0], (unsigned long)bm.kernel_cycles[k][1],
+				  (unsigned long)bm.kernel_cycles[k][2]);
+	}
+	fprintf_P(stderr, PSTR("]}\n"));
+	return (STAT_OK);
+}
+
+/*
+ * _bench_get_index() - time cmd_get_index() on input case n
+ * _bench_serialize() - time json_serialize() on input case n
+ *
+ *	The index cases are tokens from the front, middle and end of the table and one that
+ *	isn't there. The serialize case is a status report built on the stack, with the
+ *	values changing from case to case.
+ */
+
+static uint32_t _bench_get_index(const uint8_t n)
+{
+	static const char *const tokens[] = { "fb", "xvm", "g54x", "1mi", "sr", "ja", "4po", "zzzz" };
+	const char *token = tokens[n % (sizeof(tokens) / sizeof(tokens[0]))];
+
+	uint32_t start = hw_get_cycle_count();
+	index_t index = cmd_get_index((const char_t *)"", (const char_t *)token);
+	uint32_t cycles = hw_get_cycle_count() - start;
+	bm_sink = (float)index;
+	return (cycles);
+}
+
+static uint32_t _bench_serialize(const uint8_t n)
+{
+	static const char *const tokens[] = { "sr", "posx", "posy", "posz", "vel", "feed", "stat" };
+	const uint8_t objects = sizeof(tokens) / sizeof(tokens[0]);
+	cmdObj_t list[objects];
+	char_t out[80];
+
+	for (uint8_t i=0; i<objects; i++) {
+		cmdObj_t *cmd = &list[i];
+		cmd->pv = (i == 0) ? NULL : &list[i-1];
+		cmd->nx = (i == objects-1) ? NULL : &list[i+1];
+		cmd->index = 0;
+		cmd->depth = (i == 0) ? 0 : 1;
+		cmd->objtype = (i == 0) ? TYPE_PARENT : TYPE_FLOAT;
+		cmd->precision = 3;
+		cmd->value = (float)(n * 37 + i) * 1.0625;
+		strncpy((char *)cmd->token, tokens[i], CMD_TOKEN_LEN+1);
+		cmd->group[0] = NUL;
+	}
+	list[objects-1].objtype = TYPE_INTEGER;
+	list[objects-1].value = (float)(n % 10);
+
+	uint32_t start = hw_get_cycle_count();
+	uint16_t length = json_serialize(list, out, sizeof(out));
+	uint32_t cycles = hw_get_cycle_count() - start;
+	bm_sink = (float)length;
+	return (cycles);
+}
+
+#endif // __MICROBENCHMARKS
+
+/*
+ * _free_oldest_buffers() - stand in for the runtime by freeing buffers from the run end
+ *
+ *	Only safe in dry-run mode, when the exec never takes the run buffer.
+ */
+
+static void _free_oldest_buffers(uint8_t headroom)
+{
+	while (mp_get_planner_buffers_available() < headroom) {
+		if (mp_get_run_buffer() == NULL) { return;}
+		mp_free_run_buffer();
+	}
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_bmfl[] PROGMEM = "[bmfl] benchmark file%20d\n";
+static const char fmt_bmbl[] PROGMEM = "[bmbl] blocks parsed%21lu\n";
+static const char fmt_bmmv[] PROGMEM = "[bmmv] moves planned%21lu\n";
+static const char fmt_bmpr[] PROGMEM = "[bmpr] parse rate%24.0f blocks/sec\n";
+static const char fmt_bmpl[] PROGMEM = "[bmpl] plan rate%25.0f moves/sec\n";
+static const char fmt_bmpp[] PROGMEM = "[bmpp] planning pass length%14.2f blocks\n";
+static const char fmt_bmpt[] PROGMEM = "[bmpt] planned time%22.0f ms\n";
+static const char fmt_bmwt[] PROGMEM = "[bmwt] wall time%25.0f ms\n";
+static const char fmt_bmjm[] PROGMEM = "[bmjm] jitter priority map%15d\n";
+static const char fmt_bmjb[] PROGMEM = "[bmjb] jitter output sent%16lu bytes\n";
+static const char fmt_bmjs[] PROGMEM = "[bmjs] jitter DDA periods%16lu\n";
+static const char fmt_bmjn[] PROGMEM = "[bmjn] DDA latency min%19lu cycles\n";
+static const char fmt_bmjx[] PROGMEM = "[bmjx] DDA latency max%19lu cycles\n";
+static const char fmt_kern[] PROGMEM = "[kern] kernel microbenchmarks%12lu kernels\n";
+static const char fmt_kern_head[] PROGMEM = "kernel         min     median        max cycles\n";
+static const char fmt_kern_row[] PROGMEM = "%-6s  %10lu %10lu %10lu\n";
+
+void bm_print_fl(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_bmfl);}
+void bm_print_bl(cmdObj_t *cmd) { text_print_int(cmd, fmt_bmbl);}
+void bm_print_mv(cmdObj_t *cmd) { text_print_int(cmd, fmt_bmmv);}
+void bm_print_pr(cmdObj_t *cmd) { text_print_flt(cmd, fmt_bmpr);}
+void bm_print_pl(cmdObj_t *cmd) { text_print_flt(cmd, fmt_bmpl);}
+void bm_print_pp(cmdObj_t *cmd) { text_print_flt(cmd, fmt_bmpp);}
+void bm_print_pt(cmdObj_t *cmd) { text_print_flt(cmd, fmt_bmpt);}
+void bm_print_wt(cmdObj_t *cmd) { text_print_flt(cmd, fmt_bmwt);}
+void bm_print_jm(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_bmjm);}
+void bm_print_jb(cmdObj_t *cmd) { text_print_int(cmd, fmt_bmjb);}
+void bm_print_js(cmdObj_t *cmd) { text_print_int(cmd, fmt_bmjs);}
+void bm_print_jn(cmdObj_t *cmd) { text_print_int(cmd, fmt_bmjn);}
+void bm_print_jx(cmdObj_t *cmd) { text_print_int(cmd, fmt_bmjx);}
+
+#ifdef __MICROBENCHMARKS
+void bm_print_kern(cmdObj_t *cmd)
+{
+	text_print_int(cmd, fmt_kern);
+	fprintf_P(stderr, fmt_kern_head);
+	for (uint8_t k=0; k<BENCHMARK_KERNELS; k++) {
+		fprintf_P(stderr, fmt_kern_row, bm_kernels[k].name, (unsigned long)bm.kernel_cycles[k][0],
+				  (unsigned long)bm.kernel_cycles[k][1], (unsigned long)bm.kernel_cycles[k][2]);
+	}
+}
+#endif
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
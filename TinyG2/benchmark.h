@@ -0,0 +1,130 @@
+/*
+ * benchmark.h - planner throughput benchmark over the built-in Gcode corpus
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_H_ONCE
+#define BENCHMARK_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/* Microbenchmarks
+ *	$kern times the kernels the planner, config and parser spend their time in, one call
+ *	at a time with the DWT cycle counter, so a regression shows up against the kernel
+ *	that caused it rather than somewhere in the corpus totals:
+ *
+ *	  trap		_calculate_trapezoid()	- planner blocks from Mudflap and braid_600mm
+ *	  jvmax		_get_junction_vmax()	- XY corners from straight to reversal
+ *	  tvel		_get_target_velocity()	- head and tail velocities
+ *	  index		cmd_get_index()			- common tokens and a miss
+ *	  json		json_serialize()		- a 6 value status report
+ *	  gword		_get_next_gcode_word()	- Gcode words
+ *
+ *	Each kernel runs BENCHMARK_KERNEL_RUNS times over a fixed set of inputs, with
+ *	interrupts masked for each call, and reports the min, median and max cycles. The
+ *	counts include the two counter reads (a few cycles). Text mode prints a table; JSON
+ *	prints {"kern":[["trap",min,median,max],...]} ahead of the response. The machine
+ *	must be idle. Compare runs of the same inputs only - the inputs are part of the
+ *	results. The simulator counts simulated time, so it reports zeros.
+ *
+ *	Kernels that are static to their module are timed by a bench function there; the
+ *	function sets up case n, times one call and returns the cycles.
+ */
+#define __MICROBENCHMARKS				// comment out to drop the kernel microbenchmarks
+#define BENCHMARK_KERNELS 6
+
+typedef struct bmBenchmarkSingleton {	// results of the last benchmark run
+	uint8_t file;				// corpus file that was run (1 - BENCHMARK_FILES)
+	uint32_t blocks;			// Gcode blocks parsed
+	uint32_t moves;				// mp_aline() calls - includes arc segments
+	float parse_rate;			// blocks/sec through the parser, excluding planning
+	float plan_rate;			// moves/sec through mp_aline()
+	float pass_length;			// average blocks visited per planning pass
+	float planned_time;			// total planned move & dwell time in ms
+	float wall_time;			// total wall time in ms
+
+	uint8_t jitter_map;			// interrupt priority map the jitter run used (1 - HW_IRQ_MAPS)
+	uint32_t jitter_bytes;		// console output sent during the run
+	uint32_t jitter_samples;	// DDA periods measured
+	uint32_t latency_min;		// DDA latency in cycles - see st_isr.dda_latency
+	uint32_t latency_max;
+
+#ifdef __MICROBENCHMARKS
+	uint32_t kernel_cycles[BENCHMARK_KERNELS][3];	// min, median and max cycles of each $kern kernel
+#endif
+} bmBenchmarkSingleton_t;
+
+extern bmBenchmarkSingleton_t bm;
+
+stat_t bm_run_bench(cmdObj_t *cmd);
+stat_t bm_run_jitter(cmdObj_t *cmd);
+
+#ifdef __MICROBENCHMARKS
+
+extern volatile float bm_sink;			// kernel results go here so they aren't optimized away
+
+stat_t bm_run_kernels(cmdObj_t *cmd);
+uint32_t mp_bench_trapezoid(const uint8_t n);			// see plan_line.cpp
+uint32_t mp_bench_junction_vmax(const uint8_t n);
+uint32_t mp_bench_target_velocity(const uint8_t n);
+uint32_t gc_bench_gcode_word(const uint8_t n);			// see gcode_parser.cpp
+
+#endif // __MICROBENCHMARKS
+
+#ifdef __TEXT_MODE
+
+	void bm_print_fl(cmdObj_t *cmd);
+	void bm_print_bl(cmdObj_t *cmd);
+	void bm_print_mv(cmdObj_t *cmd);
+	void bm_print_pr(cmdObj_t *cmd);
+	void bm_print_pl(cmdObj_t *cmd);
+	void bm_print_pp(cmdObj_t *cmd);
+	void bm_print_pt(cmdObj_t *cmd);
+	void bm_print_wt(cmdObj_t *cmd);
+	void bm_print_jm(cmdObj_t *cmd);
+	void bm_print_jb(cmdObj_t *cmd);
+	void bm_print_js(cmdObj_t *cmd);
+	void bm_print_jn(cmdObj_t *cmd);
+	void bm_print_jx(cmdObj_t *cmd);
+	void bm_print_kern(cmdObj_t *cmd);
+
+#else
+
+	#define bm_print_fl tx_print_stub
+	#define bm_print_bl tx_print_stub
+	#define bm_print_mv tx_print_stub
+	#define bm_print_pr tx_print_stub
+	#define bm_print_pl tx_print_stub
+	#define bm_print_pp tx_print_stub
+	#define bm_print_pt tx_print_stub
+	#define bm_print_wt tx_print_stub
+	#define bm_print_jm tx_print_stub
+	#define bm_print_jb tx_print_stub
+	#define bm_print_js tx_print_stub
+	#define bm_print_jn tx_print_stub
+	#define bm_print_jx tx_print_stub
+	#define bm_print_kern tx_print_stub
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCHMARK_H_ONCE
@@ -0,0 +1,294 @@
+/*
+ * block_log.cpp - planned vs run time of each executed block
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	See Block log in block_log.h
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "block_log.h"
+#include "planner.h"
+#include "text_parser.h"
+#include "util.h"
+#include "xio.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#ifdef __BLOCK_LOG
+
+blLogSingleton_t bll;
+
+static uint8_t _block_copy(uint32_t n, blLogEntry_t *e);
+static uint32_t _first_block(uint32_t count);
+static void _hist_copy(blHistograms_t *h);
+
+/*
+ * bl_start()	- start measuring a block, or carry on with it (exec)
+ * bl_segment() - add a segment the block ran as, in the section it ran in (exec)
+ * bl_end()		- record the block (exec)
+ * bl_drop()	- forget the block being measured - its buffer was flushed
+ *
+ *	A block that is held and resumed is started again with the same buffer and goes
+ *	on being measured; its planned time stays as it was when it first started. The
+ *	planned time of each section is its length over its average velocity. A block goes
+ *	into the length histogram when it is recorded.
+ */
+
+void bl_start(mpBuf_t *bf)
+{
+	if (bll.bf == bf) { return;}
+	bll.bf = bf;
+	bll.run.linenum = bf->gm->linenum;
+	bll.run.planned = (uint32_t)uSec(mp_get_block_time(bf));
+	bll.vmax = bf->cruise_vmax;
+	bll.bins_per_vmax = (bf->cruise_vmax > EPSILON) ? ((BL_VELOCITY_BINS-1) / bf->cruise_vmax) : 0;
+	bll.vmax_over = bf->cruise_vmax * BL_VELOCITY_OVER;
+	bll.length = bf->length;
+	bll.vpeak = 0;
+	bll.usec = 0;
+}
+
+void bl_segment(const float microseconds, const float velocity, const uint8_t move_state)
+{
+	bll.usec += microseconds;
+	if (velocity > bll.vpeak) { bll.vpeak = velocity;}
+
+	uint32_t bin = BL_VELOCITY_BINS-1;
+	if (velocity <= bll.vmax_over) { bin = min((uint32_t)(velocity * bll.bins_per_vmax), (uint32_t)BL_VELOCITY_BINS-2);}
+	bll.hist.velocity[bin] += (uint32_t)microseconds;
+	if ((move_state >= MOVE_STATE_HEAD) && (move_state <= MOVE_STATE_TAIL)) {
+		bll.hist.section[move_state - MOVE_STATE_HEAD] += (uint32_t)microseconds;
+	}
+}
+
+void bl_end()
+{
+	if (bll.bf == NULL) { return;}
+	bll.bf = NULL;
+	bll.run.actual = (uint32_t)bll.usec;
+	float vpeak = (bll.vmax > EPSILON) ? (bll.vpeak * 1000 / bll.vmax) : 0;
+	bll.run.vpeak = (uint16_t)min(vpeak + 0.5, 65535);
+	bll.entry[bll.count & (BL_LOG_ENTRIES-1)] = bll.run;
+	bll.count++;								// the main loop reads up to count
+
+	uint8_t bin = 0;
+	for (float edge = BL_LENGTH_BIN0; (bin < BL_LENGTH_BINS-1) && (bll.length >= edge); edge *= 2) { bin++;}
+	bll.hist.length[bin]++;
+	bll.hist.blocks++;
+}
+
+void bl_drop() { bll.bf = NULL;}
+
+/*
+ * _block_copy() - copy out record n. Returns false if it has been overwritten
+ * _first_block() - number of the oldest record to dump when count were recorded
+ */
+
+static uint8_t _block_copy(uint32_t n, blLogEntry_t *e)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint8_t valid = ((bll.count - n) <= BL_LOG_ENTRIES) ? true : false;
+	*e = bll.entry[n & (BL_LOG_ENTRIES-1)];
+	__set_PRIMASK(primask);
+	return (valid);
+}
+
+static uint32_t _first_block(uint32_t count)
+{
+	uint32_t oldest = (count > BL_LOG_ENTRIES) ? count - BL_LOG_ENTRIES : 0;
+	return ((bll.read > oldest) ? bll.read : oldest);
+}
+
+/*
+ * _hist_copy() - copy out the histograms - the exec adds to them from its interrupt
+ */
+
+static void _hist_copy(blHistograms_t *h)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	*h = bll.hist;
+	__set_PRIMASK(primask);
+}
+
+/*
+ * bl_get_tml()  - dump the unread records. JSON mode only - text mode prints them in bl_print_tml()
+ * bl_get_tmb()  - dump them in binary
+ * bl_set_tmlz() - clear the ring
+ *
+ *	The value is the number of blocks recorded. A dump stops at the records there
+ *	when it started and the next one carries on from there.
+ */
+
+stat_t bl_get_tml(cmdObj_t *cmd)
+{
+	uint32_t count = bll.count;
+	cmd->value = (float)count;
+	cmd->objtype = TYPE_INTEGER;
+	if (cfg.comm_mode != JSON_MODE) { return (STAT_OK);}
+
+	uint32_t first = _first_block(count);
+	blLogEntry_t e;
+	fprintf_P(stderr, PSTR("{\"tml\":["));
+	for (uint32_t n = first; n < count; n++) {
+		if (_block_copy(n, &e) == false) { continue;}
+		fprintf_P(stderr, PSTR("%s[%lu,%lu,%lu,%lu,%d]"), (n == first) ? "" : ",", (unsigned long)n,
+				  (unsigned long)e.linenum, (unsigned long)e.planned, (unsigned long)e.actual, e.vpeak);
+	}
+	fprintf_P(stderr, PSTR("]}\n"));
+	bll.read = count;
+	return (STAT_OK);
+}
+
+stat_t bl_get_tmb(cmdObj_t *cmd)
+{
+	uint32_t count = bll.count;
+	uint32_t first = _first_block(count);
+	blLogEntry_t e;
+
+	fprintf_P(stderr, PSTR("{\"tmb\":{\"n\":%lu,\"sz\":%d,\"seq\":%lu}}\n"),
+			  (unsigned long)(count - first), (int)sizeof(blLogEntry_t), (unsigned long)first);
+	fflush(stderr);								// the header goes ahead of the records
+	for (uint32_t n = first; n < count; n++) {
+		_block_copy(n, &e);
+		xio_write((const uint8_t *)&e, sizeof(e));
+	}
+	bll.read = count;
+	cmd->value = (float)count;
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t bl_set_tmlz(cmdObj_t *cmd)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	bll.count = 0;
+	bll.read = 0;
+	__set_PRIMASK(primask);
+	return (STAT_OK);
+}
+
+/*
+ * bl_get_tmh()  - dump the histograms. JSON mode only - text mode prints them in bl_print_tmh()
+ * bl_set_tmhz() - clear them
+ *
+ *	Times are sent in ms.
+ */
+
+static void _print_bins(const char *key, const uint64_t *usec, const uint32_t *count, uint8_t bins)
+{
+	fprintf_P(stderr, PSTR("\"%s\":["), key);
+	for (uint8_t i=0; i<bins; i++) {
+		unsigned long value = (usec != NULL) ? (unsigned long)(usec[i] / 1000) : (unsigned long)count[i];
+		fprintf_P(stderr, PSTR("%s%lu"), (i == 0) ? "" : ",", value);
+	}
+	fprintf_P(stderr, PSTR("]"));
+}
+
+stat_t bl_get_tmh(cmdObj_t *cmd)
+{
+	blHistograms_t h;
+	_hist_copy(&h);
+	cmd->value = (float)h.blocks;
+	cmd->objtype = TYPE_INTEGER;
+	if (cfg.comm_mode != JSON_MODE) { return (STAT_OK);}
+
+	fprintf_P(stderr, PSTR("{\"tmh\":{"));
+	_print_bins("v", h.velocity, NULL, BL_VELOCITY_BINS);
+	fprintf_P(stderr, PSTR(","));
+	_print_bins("l", NULL, h.length, BL_LENGTH_BINS);
+	fprintf_P(stderr, PSTR(","));
+	_print_bins("s", h.section, NULL, BL_SECTIONS);
+	fprintf_P(stderr, PSTR("}}\n"));
+	return (STAT_OK);
+}
+
+stat_t bl_set_tmhz(cmdObj_t *cmd)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	memset(&bll.hist, 0, sizeof(bll.hist));
+	__set_PRIMASK(primask);
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_tml[] PROGMEM = "[tml]  block log%19lu blocks\n";
+static const char fmt_tml_head[] PROGMEM = "     seq     line    planned     actual vpeak\n";
+static const char fmt_tml_block[] PROGMEM = "%8lu %8lu %10lu %10lu %5d\n";
+
+void bl_print_tml(cmdObj_t *cmd)
+{
+	uint32_t count = bll.count;
+	text_print_int(cmd, fmt_tml);
+
+	uint32_t first = _first_block(count);
+	blLogEntry_t e;
+	fprintf_P(stderr, fmt_tml_head);
+	for (uint32_t n = first; n < count; n++) {
+		if (_block_copy(n, &e) == false) { continue;}
+		fprintf_P(stderr, fmt_tml_block, (unsigned long)n, (unsigned long)e.linenum,
+				  (unsigned long)e.planned, (unsigned long)e.actual, e.vpeak);
+	}
+	bll.read = count;
+}
+
+static const char fmt_tmh[] PROGMEM = "[tmh]  motion histograms%16lu blocks\n";
+static const char fmt_tmh_velocity[] PROGMEM = "  velocity %3d-%3d%% %12lu ms\n";
+static const char fmt_tmh_over[] PROGMEM = "  velocity >%3d%%    %12lu ms\n";
+static const char fmt_tmh_length[] PROGMEM = "  length   <%8.3f mm %9lu\n";
+static const char fmt_tmh_longer[] PROGMEM = "  length  >=%8.3f mm %9lu\n";
+static const char fmt_tmh_section[] PROGMEM = "  %-17s %12lu ms\n";
+
+void bl_print_tmh(cmdObj_t *cmd)
+{
+	blHistograms_t h;
+	_hist_copy(&h);
+	fprintf_P(stderr, fmt_tmh, (unsigned long)h.blocks);
+
+	for (uint8_t i=0; i<BL_VELOCITY_BINS-1; i++) {
+		fprintf_P(stderr, fmt_tmh_velocity, i*10, (i+1)*10, (unsigned long)(h.velocity[i] / 1000));
+	}
+	fprintf_P(stderr, fmt_tmh_over, (BL_VELOCITY_BINS-1)*10, (unsigned long)(h.velocity[BL_VELOCITY_BINS-1] / 1000));
+	float edge = BL_LENGTH_BIN0;
+	for (uint8_t i=0; i<BL_LENGTH_BINS-1; i++, edge *= 2) {
+		fprintf_P(stderr, fmt_tmh_length, edge, (unsigned long)h.length[i]);
+	}
+	fprintf_P(stderr, fmt_tmh_longer, edge/2, (unsigned long)h.length[BL_LENGTH_BINS-1]);
+	fprintf_P(stderr, fmt_tmh_section, "head", (unsigned long)(h.section[0] / 1000));
+	fprintf_P(stderr, fmt_tmh_section, "body", (unsigned long)(h.section[1] / 1000));
+	fprintf_P(stderr, fmt_tmh_section, "tail", (unsigned long)(h.section[2] / 1000));
+}
+
+#endif // __TEXT_MODE
+
+#endif // __BLOCK_LOG
+
+#ifdef __cplusplus
+}
+#endif
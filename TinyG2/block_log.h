@@ -0,0 +1,148 @@
+/*
+ * block_log.h - planned vs run time of each executed block
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Block log
+ *	Where the cycle time of a job goes. Each feed move (line or arc block) the exec
+ *	finishes leaves one record in a RAM ring of BL_LOG_ENTRIES:
+ *
+ *	  line			Gcode line number of the block
+ *	  planned		usec the trapezoid was planned to take when the block started
+ *	  actual		usec of the segments it ran as - overrides and feedholds included
+ *	  vpeak			fastest segment, per mille of the block's cruise_vmax (the feed
+ *					or axis limit it was asked to run at)
+ *
+ *	A region that runs well below its programmed feed shows up as blocks with a low
+ *	vpeak - held back by look-ahead or junction limits - and actual against planned
+ *	shows what overrides and holds added. Time the steppers were starved isn't in
+ *	actual; see the underrun events in event_log.h.
+ *
+ *	The ring is read as a stream: each dump sends the records not sent yet and moves
+ *	the read point past them, so a host polling it sees every record once. Records are
+ *	numbered from the last clear; ones overwritten before they were read leave a gap.
+ *
+ *	  $tml	dump the unread records - {"tml":""} dumps them as
+ *			{"tml":[[seq,line,planned,actual,vpeak],...]} ahead of the response
+ *	  $tmb	dump them in binary: a {"tmb":{"n":N,"sz":16,"seq":S}} line, then N records
+ *			of sz bytes as in blLogEntry_t (little endian), S being the first's number
+ *	  $tmlz	clear the ring
+ *
+ *	Costs BL_LOG_ENTRIES * 16 bytes of RAM.
+ */
+/* Motion histograms
+ *	Alongside the ring the exec adds every segment and block into histograms that run
+ *	until they are cleared - a job's worth, for tuning jerk, junctions and CAM 
+ *	tolerances against:
+ *
+ *	  velocity	ms run at each tenth of the block's cruise_vmax (0-10%, 10-20%...), and
+ *				over it by more than BL_VELOCITY_OVER - the last bin (feed overrides)
+ *	  length	blocks run by length - under BL_LENGTH_BIN0 mm, then doubling, and the 
+ *				last bin the rest
+ *	  section	ms run in the heads, bodies and tails of the blocks
+ *
+ *	  $tmh	dump them - {"tmh":""} dumps them as {"tmh":{"v":[...],"l":[...],"s":[h,b,t]}}
+ *			ahead of the response. The value is the number of blocks in them
+ *	  $tmhz	clear them
+ *
+ *	A segment costs a multiply and a few adds, a block a few compares.
+ */
+
+#ifndef BLOCK_LOG_H_ONCE
+#define BLOCK_LOG_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define __BLOCK_LOG					// comment out to drop the block log
+
+#ifndef BL_LOG_ENTRIES
+#define BL_LOG_ENTRIES 64			// blocks kept - must be a power of 2
+#endif
+#define BL_VELOCITY_BINS 11			// tenths of cruise_vmax, and over it
+#define BL_VELOCITY_OVER 1.01		// fraction of cruise_vmax that counts as over it
+#define BL_LENGTH_BINS 12			// doubling from BL_LENGTH_BIN0
+#define BL_LENGTH_BIN0 0.03125		// mm - top of the shortest length bin
+#define BL_SECTIONS 3				// head, body, tail
+
+typedef struct blLogEntry {			// one block - 16 bytes
+	uint32_t linenum;				// Gcode line of the block
+	uint32_t planned;				// usec planned
+	uint32_t actual;				// usec run
+	uint16_t vpeak;					// peak velocity per mille of cruise_vmax
+	uint8_t reserved[2];
+} blLogEntry_t;
+
+typedef struct blHistograms {
+	uint64_t velocity[BL_VELOCITY_BINS];// usec run at each fraction of cruise_vmax
+	uint32_t length[BL_LENGTH_BINS];// blocks run by length
+	uint64_t section[BL_SECTIONS];	// usec run in heads, bodies and tails
+	uint32_t blocks;				// blocks run
+} blHistograms_t;
+
+typedef struct blLogSingleton {
+	uint32_t count;					// blocks recorded since the last clear
+	uint32_t read;					// number of the next record to dump
+	struct mpBuffer *bf;			// block being measured - NULL if none
+	blLogEntry_t run;				// its record so far
+	float vmax;						// its cruise_vmax
+	float bins_per_vmax;			// BL_VELOCITY_BINS-1 over cruise_vmax - 0 if it has none
+	float vmax_over;				// velocities over this go in the last bin
+	float length;					// its length
+	float vpeak;					// fastest segment so far (mm/min)
+	float usec;						// run time so far
+	blLogEntry_t entry[BL_LOG_ENTRIES];	// entry[count % BL_LOG_ENTRIES] is written next
+	blHistograms_t hist;			// motion histograms
+} blLogSingleton_t;
+
+#ifdef __BLOCK_LOG
+
+extern blLogSingleton_t bll;
+
+void bl_start(struct mpBuffer *bf);
+void bl_segment(const float microseconds, const float velocity, const uint8_t move_state);
+void bl_end(void);
+void bl_drop(void);
+
+stat_t bl_get_tml(cmdObj_t *cmd);
+stat_t bl_get_tmb(cmdObj_t *cmd);
+stat_t bl_set_tmlz(cmdObj_t *cmd);
+stat_t bl_get_tmh(cmdObj_t *cmd);
+stat_t bl_set_tmhz(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+	void bl_print_tml(cmdObj_t *cmd);
+	void bl_print_tmh(cmdObj_t *cmd);
+#else
+	#define bl_print_tml tx_print_stub
+	#define bl_print_tmh tx_print_stub
+#endif // __TEXT_MODE
+
+#else
+
+#define bl_start(bf)
+#define bl_segment(microseconds, velocity, move_state)
+#define bl_end()
+#define bl_drop()
+
+#endif // __BLOCK_LOG
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLOCK_LOG_H_ONCE
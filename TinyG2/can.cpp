@@ -0,0 +1,418 @@
+/*
+ * can.cpp - CAN bus transport for remote consoles and multi-board sync
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* See "CAN bus" in can.h. The console side is in xio.cpp (XIO_DEV_CAN).
+ */
+#include "tinyg2.h"
+#include "config.h"
+#include "can.h"
+#include "canonical_machine.h"
+#include "encoder.h"
+#include "planner.h"
+#include "hardware.h"
+#include "text_parser.h"
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+canSingleton_t can;
+
+static void _configure(void);
+static void _hw_start(void);
+static void _hw_kick(const uint8_t box);
+static bool _send(const uint8_t box, const canFrame_t *f);
+static void _send_sync(const uint8_t event);
+static void _receive(const canFrame_t *f);
+
+/*
+ * can_init() - start the controller if the board has a node number
+ */
+void can_init()
+{
+	_configure();
+}
+
+/*
+ * _configure() - empty the rings and (re)start the controller on the current config
+ */
+static void _configure()
+{
+	can.rx.head = can.rx.tail = 0;
+	for (uint8_t box=0; box<CAN_TX_MAILBOXES; box++) {
+		can.tx[box].head = can.tx[box].tail = 0;
+	}
+	can.reply_node = 0;
+	can.state = COMBINED_INITIALIZING;
+	can.enable = ((can.node != 0) && (can.baud != 0)) ? true : false;	// (the bit rate is set first at startup)
+	if (en_enabled() == true) { can.enable = false;}	// the encoder has the pins - see can.h
+	_hw_start();
+}
+
+/*
+ * can_callback() - broadcast the machine state when it changes, and as a heartbeat
+ *
+ *	Only with $cansy=1. Going into alarm is sent as an event so the peers hold.
+ */
+stat_t can_callback()
+{
+	if ((can.enable == false) || (can.sync == false)) { return (STAT_NOOP);}
+
+	uint8_t state = cm_get_combined_state();
+	if (state != can.state) {
+		_send_sync((state == COMBINED_ALARM) ? CAN_SYNC_ALARM : CAN_SYNC_STATE);
+	} else if ((SysTickTimer.getValue() - can.sent_tick) >= CAN_HEARTBEAT_MS) {
+		_send_sync(CAN_SYNC_STATE);
+	}
+	return (STAT_OK);
+}
+
+/*
+ * can_sync_event() - send a feedhold or cycle start to the peers. Any interrupt level
+ *
+ *	Called by xio for the realtime characters from the host. Events received from the
+ *	bus are acted on directly and never sent on, so they can't echo round the cell.
+ */
+void can_sync_event(const uint8_t event)
+{
+	if ((can.enable == false) || (can.sync == false)) { return;}
+	_send_sync(event);
+}
+
+static void _send_sync(const uint8_t event)
+{
+	canFrame_t f;
+	uint32_t linenum = cm_get_linenum(RUNTIME);
+
+	f.id = (CAN_TYPE_SYNC << 4) | can.node;
+	f.len = 6;
+	f.data[0] = event;
+	f.data[1] = cm_get_combined_state();
+	f.data[2] = linenum;
+	f.data[3] = linenum >> 8;
+	f.data[4] = linenum >> 16;
+	f.data[5] = linenum >> 24;
+	can.state = f.data[1];
+	can.sent_tick = SysTickTimer.getValue();
+	if (_send(CAN_TX_SYNC, &f) == false) { can.errors++;}
+}
+
+/*
+ * can_is_connected() - true while the controller is running
+ * can_read_text()	  - take the characters of the next text frame. Returns how many - 0 if none
+ * can_write_text()	  - queue up to CAN_TEXT_LEN characters for the node the console replies to
+ *
+ *	Called by xio from the SysTick interrupt. can_write_text() returns false if the
+ *	ring is full - xio leaves the characters where they are and tries next tick.
+ */
+bool can_is_connected() { return (can.enable);}
+
+uint8_t can_read_text(uint8_t *buf)
+{
+	if (can.rx.tail == can.rx.head) { return (0);}
+	canFrame_t *f = &can.rx.frame[can.rx.tail];
+	uint8_t len = f->len - 1;
+
+	can.reply_node = f->data[0] & (CAN_NODES-1);
+	memcpy(buf, &f->data[1], len);
+	can.rx.tail = (can.rx.tail + 1) & (CAN_RX_FRAMES-1);
+	return (len);
+}
+
+bool can_write_text(const uint8_t *buf, const uint8_t len)
+{
+	canFrame_t f;
+
+	f.id = (CAN_TYPE_TEXT << 4) | can.reply_node;
+	f.len = len + 1;
+	f.data[0] = can.node;
+	memcpy(&f.data[1], buf, len);
+	return (_send(CAN_TX_TEXT, &f));
+}
+
+/*
+ * _send() - queue a frame for a transmit mailbox. Returns false if its ring is full
+ *
+ *	Frames are queued from the main loop and from SysTick, so the ring is updated
+ *	with interrupts masked.
+ */
+static bool _send(const uint8_t box, const canFrame_t *f)
+{
+	canTxRing_t *t = &can.tx[box];
+	bool queued = false;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint16_t next = (t->head + 1) & (CAN_TX_FRAMES-1);
+	if (next != t->tail) {
+		t->frame[t->head] = *f;
+		t->head = next;
+		_hw_kick(box);
+		queued = true;
+	}
+	__set_PRIMASK(primask);
+	return (queued);
+}
+
+/*
+ * _receive() - take a frame the filters let through. Called from the CAN interrupt
+ *
+ *	Text goes into the ring for xio. Sync frames update the peer table and, with
+ *	$cansy=1, hold or start the machine.
+ */
+static void _receive(const canFrame_t *f)
+{
+	can.rx_frames++;
+	if ((f->id >> 4) == CAN_TYPE_TEXT) {
+		uint16_t next = (can.rx.head + 1) & (CAN_RX_FRAMES-1);
+		if ((f->len < 2) || (next == can.rx.tail)) {	// nothing in it, or xio has fallen behind
+			can.errors++;
+			return;
+		}
+		can.rx.frame[can.rx.head] = *f;
+		can.rx.head = next;
+		return;
+	}
+	if (f->len < 6) {
+		can.errors++;
+		return;
+	}
+	canPeer_t *p = &can.peer[f->id & (CAN_NODES-1)];
+	p->state = f->data[1];
+	p->linenum = (uint32_t)f->data[2] | ((uint32_t)f->data[3] << 8) |
+				 ((uint32_t)f->data[4] << 16) | ((uint32_t)f->data[5] << 24);
+	p->tick = SysTickTimer.getValue();
+	if (can.sync == false) { return;}
+
+	switch (f->data[0]) {
+		case CAN_SYNC_HOLD:
+		case CAN_SYNC_ALARM: { cm_request_feedhold(); break;}
+		case CAN_SYNC_START: { cm_request_cycle_start(); break;}
+	}
+}
+
+/*
+ * Hardware
+ *
+ * _hw_start()	 - set up the controller and its mailboxes, or turn it off if can.enable is false
+ * _hw_kick()	 - load a transmit mailbox from its ring if the mailbox is free. Interrupts masked
+ * CAN0_Handler() - take received frames oldest first and refill the transmit mailboxes
+ *
+ *	The bit time is 12 quanta sampled at 75%, so the bit rate must divide F_CPU/12
+ *	(84 MHz: 125, 250, 500 and 1000 kbit/s all do). The controller goes bus off by
+ *	itself after too many errors and comes back after 128 idle periods, as CAN does.
+ */
+#define CAN_MB_SYNC_RX	0				// first of 2 sync receive mailboxes
+#define CAN_MB_TEXT_RX	2				// first of 4 text receive mailboxes
+#define CAN_MB_RX		6				// receive mailboxes
+#define CAN_MB_TX		6				// first transmit mailbox - in canTxMailbox order
+#define CAN_ID_MASK		0x7FF
+
+#ifndef __SIM
+
+static uint32_t _le32(const uint8_t *b)
+{
+	return ((uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24));
+}
+
+static void _hw_start()
+{
+	NVIC_DisableIRQ(CAN0_IRQn);
+	if (can.enable == false) {
+		if (PMC->PMC_PCSR1 & (1u << (ID_CAN0 - 32))) { CAN0->CAN_MR = 0;}
+		return;
+	}
+	PMC->PMC_PCER1 = (1u << (ID_CAN0 - 32));	// clock the controller
+	PIOA->PIO_PDR = PIO_PA1A_CANRX0 | PIO_PA0A_CANTX0;	// hand the pins to the peripheral...
+	PIOA->PIO_ABSR &= ~(PIO_PA1A_CANRX0 | PIO_PA0A_CANTX0);	// ...peripheral A
+
+	CAN0->CAN_MR = 0;							// off while it's set up
+	CAN0->CAN_IDR = 0xFFFFFFFF;
+	CAN0->CAN_BR = CAN_BR_PHASE2(2) | CAN_BR_PHASE1(3) | CAN_BR_PROPAG(3) | CAN_BR_SJW(1) |
+				   CAN_BR_BRP(F_CPU / (can.baud * 12000) - 1) | CAN_BR_SMP_ONCE;
+
+	for (uint8_t box=0; box<CANMB_NUMBER; box++) {
+		CanMb *m = &CAN0->CAN_MB[box];
+		if (box < CAN_MB_TEXT_RX) {				// sync from any node
+			m->CAN_MMR = CAN_MMR_MOT_MB_RX;
+			m->CAN_MAM = CAN_MAM_MIDvA(CAN_ID_MASK & ~(CAN_NODES-1));
+			m->CAN_MID = CAN_MID_MIDvA(CAN_TYPE_SYNC << 4);
+		} else if (box < CAN_MB_RX) {			// text to this node
+			m->CAN_MMR = CAN_MMR_MOT_MB_RX;
+			m->CAN_MAM = CAN_MAM_MIDvA(CAN_ID_MASK);
+			m->CAN_MID = CAN_MID_MIDvA((CAN_TYPE_TEXT << 4) | can.node);
+		} else {
+			m->CAN_MMR = CAN_MMR_MOT_MB_TX;
+			m->CAN_MAM = 0;
+			m->CAN_MID = 0;
+		}
+		if (box < CAN_MB_RX) { m->CAN_MCR = CAN_MCR_MTCR;}	// ready to receive
+	}
+	CAN0->CAN_IER = (1u << CAN_MB_RX) - 1;		// the transmit mailboxes are enabled as they're loaded
+	NVIC_EnableIRQ(CAN0_IRQn);
+	CAN0->CAN_MR = CAN_MR_CANEN;
+}
+
+static void _hw_kick(const uint8_t box)
+{
+	canTxRing_t *t = &can.tx[box];
+	CanMb *m = &CAN0->CAN_MB[CAN_MB_TX + box];
+
+	if (t->tail == t->head) {					// nothing to send - stop the ready interrupt
+		CAN0->CAN_IDR = (1u << (CAN_MB_TX + box));
+		return;
+	}
+	if ((m->CAN_MSR & CAN_MSR_MRDY) == 0) { return;}	// still sending - the interrupt calls back
+	canFrame_t *f = &t->frame[t->tail];
+	m->CAN_MID = CAN_MID_MIDvA(f->id);
+	m->CAN_MDL = _le32(&f->data[0]);
+	m->CAN_MDH = _le32(&f->data[4]);
+	m->CAN_MCR = CAN_MCR_MDLC(f->len) | CAN_MCR_MTCR;
+	t->tail = (t->tail + 1) & (CAN_TX_FRAMES-1);
+	can.tx_frames++;
+	CAN0->CAN_IER = (1u << (CAN_MB_TX + box));
+}
+
+void CAN0_Handler(void)
+{
+	canFrame_t f;
+
+	while (true) {								// received frames, oldest first
+		uint8_t oldest = CAN_MB_RX;
+		uint16_t oldest_time = 0;
+		for (uint8_t box=0; box<CAN_MB_RX; box++) {
+			uint32_t msr = CAN0->CAN_MB[box].CAN_MSR;
+			if ((msr & CAN_MSR_MRDY) == 0) { continue;}
+			uint16_t time = (msr & CAN_MSR_MTIMESTAMP_Msk) >> CAN_MSR_MTIMESTAMP_Pos;
+			if ((oldest == CAN_MB_RX) || ((int16_t)(time - oldest_time) < 0)) {
+				oldest = box;
+				oldest_time = time;
+			}
+		}
+		if (oldest == CAN_MB_RX) { break;}
+
+		CanMb *m = &CAN0->CAN_MB[oldest];
+		uint32_t low = m->CAN_MDL;
+		uint32_t high = m->CAN_MDH;
+		f.id = (m->CAN_MID & CAN_MID_MIDvA_Msk) >> CAN_MID_MIDvA_Pos;
+		f.len = min((m->CAN_MSR & CAN_MSR_MDLC_Msk) >> CAN_MSR_MDLC_Pos, (uint32_t)8);
+		for (uint8_t i=0; i<4; i++) {
+			f.data[i] = low >> (8*i);
+			f.data[i+4] = high >> (8*i);
+		}
+		m->CAN_MCR = CAN_MCR_MTCR;				// free the mailbox for the next frame
+		_receive(&f);
+	}
+	for (uint8_t box=0; box<CAN_TX_MAILBOXES; box++) {
+		if (CAN0->CAN_MB[CAN_MB_TX + box].CAN_MSR & CAN_MSR_MRDY) { _hw_kick(box);}
+	}
+}
+
+#else // __SIM
+
+static void _hw_start() {}
+
+static void _hw_kick(const uint8_t box)			// the simulator's bus has no other nodes
+{
+	canTxRing_t *t = &can.tx[box];
+	while (t->tail != t->head) {
+		t->tail = (t->tail + 1) & (CAN_TX_FRAMES-1);
+		can.tx_frames++;
+	}
+}
+
+#endif // __SIM
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * can_set_id() - set the node number and restart the controller - 0 turns it off
+ * can_set_br() - set the bit rate in kbit/s and restart the controller
+ *
+ *	Either one that would turn the controller on is refused while the encoder is on.
+ * can_get_pr() - get the peers heard from lately - a bit per node
+ */
+stat_t can_set_id(cmdObj_t *cmd)
+{
+	if ((cmd->value < 0) || (cmd->value >= CAN_NODES)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if ((cmd->value >= 1) && (can.baud != 0) && (en_enabled() == true)) { return (STAT_PIN_IN_USE);}
+	set_ui8(cmd);
+	_configure();
+	return (STAT_OK);
+}
+
+stat_t can_set_br(cmdObj_t *cmd)
+{
+	uint32_t baud = (uint32_t)cmd->value;
+	if ((baud == 0) || ((F_CPU % (baud * 12000)) != 0) ||
+		(F_CPU / (baud * 12000) < 2) || (F_CPU / (baud * 12000) > 128)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	if ((can.node != 0) && (en_enabled() == true)) { return (STAT_PIN_IN_USE);}
+	set_int(cmd);
+	_configure();
+	return (STAT_OK);
+}
+
+stat_t can_get_pr(cmdObj_t *cmd)
+{
+	uint32_t now = SysTickTimer.getValue();
+	uint32_t peers = 0;
+
+	for (uint8_t n=0; n<CAN_NODES; n++) {
+		if ((can.peer[n].tick != 0) && ((now - can.peer[n].tick) < CAN_PEER_TIMEOUT_MS)) {
+			peers |= (1u << n);
+		}
+	}
+	cmd->value = (float)peers;
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_canid[] PROGMEM = "[canid] CAN node%25d [0=off,1-15]\n";
+static const char fmt_canbr[] PROGMEM = "[canbr] CAN bit rate%21lu kbit/s\n";
+static const char fmt_cansy[] PROGMEM = "[cansy] CAN sync%25d [0=off,1=on]\n";
+static const char fmt_canpr[] PROGMEM = "[canpr] CAN peers%24lu [bit per node]\n";
+static const char fmt_canrx[] PROGMEM = "[canrx] CAN frames received%14lu\n";
+static const char fmt_cantx[] PROGMEM = "[cantx] CAN frames sent%18lu\n";
+static const char fmt_caner[] PROGMEM = "[caner] CAN frames dropped%15lu\n";
+
+void can_print_id(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_canid);}
+void can_print_br(cmdObj_t *cmd) { text_print_int(cmd, fmt_canbr);}
+void can_print_sy(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_cansy);}
+void can_print_pr(cmdObj_t *cmd) { text_print_int(cmd, fmt_canpr);}
+void can_print_rx(cmdObj_t *cmd) { text_print_int(cmd, fmt_canrx);}
+void can_print_tx(cmdObj_t *cmd) { text_print_int(cmd, fmt_cantx);}
+void can_print_er(cmdObj_t *cmd) { text_print_int(cmd, fmt_caner);}
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,177 @@
+/*
+ * can.h - CAN bus transport for remote consoles and multi-board sync
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CAN_H_ONCE
+#define CAN_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/* CAN bus
+ *
+ *	CAN0 on PA1 (CANRX0) and PA0 (CANTX0) - DAC0/CANRX and CANTX on a Due - through a
+ *	3.3V transceiver. Each board on the bus has a node number ($canid 1-15, 0 leaves
+ *	the controller off) and all run at the same $canbr kbit/s. The encoder's phase
+ *	inputs are on the same pins (see encoder.h), so CAN can't be turned on while the
+ *	encoder is - $canid and $canbr return STAT_PIN_IN_USE - and stays off at startup
+ *	if both were stored. Frames have 11 bit identifiers made of a type and a node:
+ *
+ *	  id = type << 4 | node
+ *
+ *	so the type also sets the priority on the bus - sync frames win over text.
+ *
+ *	  type		node		payload
+ *	  0 sync	sender		event, combined state, Gcode line (uint32) - broadcast
+ *	  1 text	receiver	sender's node, then up to 7 characters
+ *	  2 - 127	-			free for I/O modules - not taken by the filters
+ *
+ *	Text frames carry a console (xio device XIO_DEV_CAN). A board with $ci=2 takes its
+ *	commands from the text sent to its node and sends responses and reports back to the
+ *	node it last heard from, so a host on a USB-CAN adapter (node 0 by convention) runs
+ *	a whole cell over one bus. Realtime characters act as they do from USB. There is no
+ *	flow control on the bus - stream with the flow control footer ($fs=2), as on the USART.
+ *
+ *	Sync frames coordinate the boards of a cell. With $cansy=1 a board broadcasts its
+ *	state when it changes and every CAN_HEARTBEAT_MS otherwise, and the feedholds and
+ *	cycle starts its host sends it (! and ~) go out to the bus as events. Every board
+ *	with $cansy=1 holds and starts with them, and holds if a peer goes into alarm.
+ *	$canpr has a bit per node heard from in the last CAN_PEER_TIMEOUT_MS.
+ *
+ *	The hardware filters the traffic: mailboxes 0-1 take sync frames from any node and
+ *	2-5 text frames sent to this node, so nothing else reaches the interrupt. The CAN
+ *	controller has no DMA - the interrupt moves received text into a ring of frames for
+ *	xio and feeds the transmit mailboxes (6 sync, 7 text - one each so frames go out in
+ *	order) from rings of their own. Received frames are taken in timestamp order.
+ */
+#ifndef CAN_HEARTBEAT_MS
+#define CAN_HEARTBEAT_MS 100			// state broadcast interval when nothing changes
+#endif
+#define CAN_PEER_TIMEOUT_MS (3 * CAN_HEARTBEAT_MS)	// a peer is gone after missing this many
+#ifndef CAN_RX_FRAMES
+#define CAN_RX_FRAMES 32				// received text frames held for xio - must be a power of 2
+#endif
+#ifndef CAN_TX_FRAMES
+#define CAN_TX_FRAMES 16				// frames queued per transmit mailbox - must be a power of 2
+#endif
+
+#define CAN_NODES 16					// node numbers 0 - 15
+#define CAN_TEXT_LEN 7					// characters in a text frame
+
+enum canFrameType {						// see CAN bus, above
+	CAN_TYPE_SYNC = 0,
+	CAN_TYPE_TEXT
+};
+
+enum canSyncEvent {						// byte 0 of a sync frame
+	CAN_SYNC_STATE = 0,					// state broadcast - no event
+	CAN_SYNC_HOLD,						// feedhold
+	CAN_SYNC_START,						// cycle start
+	CAN_SYNC_ALARM						// the sender went into alarm
+};
+
+enum canTxMailbox {						// transmit rings - in mailbox order
+	CAN_TX_SYNC = 0,
+	CAN_TX_TEXT,
+	CAN_TX_MAILBOXES
+};
+
+typedef struct canFrame {				// one frame - 12 bytes
+	uint16_t id;
+	uint8_t len;
+	uint8_t data[8];
+} canFrame_t;
+
+typedef struct canRxRing {				// text for xio - the interrupt only writes head
+	volatile uint16_t head;
+	volatile uint16_t tail;
+	canFrame_t frame[CAN_RX_FRAMES];
+} canRxRing_t;
+
+typedef struct canTxRing {				// frames for a transmit mailbox - the interrupt only writes tail
+	volatile uint16_t head;
+	volatile uint16_t tail;
+	canFrame_t frame[CAN_TX_FRAMES];
+} canTxRing_t;
+
+typedef struct canPeer {				// last sync frame from a node
+	uint8_t state;						// combined state
+	uint32_t linenum;
+	uint32_t tick;						// SysTick ms it was received
+} canPeer_t;
+
+typedef struct canSingleton {
+	// config
+	uint8_t node;						// $canid
+	uint32_t baud;						// $canbr kbit/s
+	uint8_t sync;						// $cansy
+
+	// runtime
+	uint8_t enable;						// the controller is running
+	volatile uint8_t reply_node;		// node console output goes to - the last text sender
+	uint8_t state;						// combined state last broadcast
+	uint32_t sent_tick;					// ...and when
+	uint32_t rx_frames;					// frames received
+	uint32_t tx_frames;					// frames sent
+	uint32_t errors;					// frames dropped and bus errors
+	canPeer_t peer[CAN_NODES];
+
+	canRxRing_t rx;
+	canTxRing_t tx[CAN_TX_MAILBOXES];
+} canSingleton_t;
+extern canSingleton_t can;
+
+/*
+ * Global Scope Functions
+ */
+
+void can_init(void);
+stat_t can_callback(void);
+bool can_is_connected(void);
+uint8_t can_read_text(uint8_t *buf);
+bool can_write_text(const uint8_t *buf, const uint8_t len);
+void can_sync_event(const uint8_t event);
+
+stat_t can_set_id(cmdObj_t *cmd);
+stat_t can_set_br(cmdObj_t *cmd);
+stat_t can_get_pr(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+	void can_print_id(cmdObj_t *cmd);
+	void can_print_br(cmdObj_t *cmd);
+	void can_print_sy(cmdObj_t *cmd);
+	void can_print_pr(cmdObj_t *cmd);
+	void can_print_rx(cmdObj_t *cmd);
+	void can_print_tx(cmdObj_t *cmd);
+	void can_print_er(cmdObj_t *cmd);
+#else
+	#define can_print_id tx_print_stub
+	#define can_print_br tx_print_stub
+	#define can_print_sy tx_print_stub
+	#define can_print_pr tx_print_stub
+	#define can_print_rx tx_print_stub
+	#define can_print_tx tx_print_stub
+	#define can_print_er tx_print_stub
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // End of include Guard: CAN_H_ONCE
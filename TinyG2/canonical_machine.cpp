@@ -72,9 +72,12 @@
  *		function, which is the runtime execution routine, and any arguments that are needed 
  *		by the runtime. See typedef for *exec in planner.h for details
  *
- *	  - mp_queue_command() stores the callback and the args in a planner buffer.
+ *	  - mp_queue_command() stores the callback and the args in the planner's command side 
+ *		queue. Commands that must run with motion stopped use mp_queue_stop_command(), 
+ *		which stores them in a planner buffer. Commands that only set outputs (S, coolant)
+ *		use mp_queue_output_command() so they take effect when the motors get there.
  *
- *	  - When planner execution reaches the buffer it executes the callback w/ the args. 
+ *	  - When planner execution reaches the command it executes the callback w/ the args. 
  *		Take careful note that the callback executes under an interrupt, so beware of 
  *		variables that may need to be volatile.
  *
@@ -88,15 +91,20 @@
 #include "tinyg2.h"		// #1
 #include "config.h"		// #2
 #include "text_parser.h"
+#include "controller.h"
 #include "canonical_machine.h"
+#include "gcode_parser.h"
 #include "plan_arc.h"
 #include "planner.h"
 #include "stepper.h"
+#include "kinematics.h"
 #include "spindle.h"
+#include "pwm.h"
 #include "report.h"
 //#include "gpio.h"
 #include "switch.h"
 #include "hardware.h"
+#include "event_log.h"
 #include "util.h"
 //#include "xio.h"			// for serial queue flush
 
@@ -128,9 +136,13 @@ static void _exec_mist_coolant_control(float *value, float *flag);
 static void _exec_flood_coolant_control(float *value, float *flag);
 static void _exec_absolute_origin(float *value, float *flag);
 static void _exec_program_finalize(float *value, float *flag);
+static void _seek_resume(void);
+static void _seek_approach(float target[], uint8_t motion_mode);
 
 static int8_t _get_axis(const index_t index);
 static int8_t _get_axis_type(const index_t index);
+static void _set_junction_terms(void);
+static stat_t _canned_cycle_move(uint8_t motion_mode);
 
 /***********************************************************************************
  **** CODE *************************************************************************
@@ -172,6 +184,7 @@ uint8_t cm_get_homing_state() { return cm.homing_state;}
 void cm_set_motion_state(uint8_t motion_state) 
 { 
 	cm.motion_state = motion_state;
+	sr_mark_changed(SR_CHANGED_STATE | SR_CHANGED_BLOCK);	// the active model changes too
 
 	switch (motion_state) {
 		case (MOTION_STOP): { ACTIVE_MODEL = MODEL; break; }
@@ -204,6 +217,7 @@ void cm_set_tool_number(GCodeState_t *gcode_state, uint8_t tool) { gcode_state->
 
 void cm_set_absolute_override(GCodeState_t *gcode_state, uint8_t absolute_override)
 {
+	if (gcode_state->absolute_override != absolute_override) { cm_offsets_changed();}
 	gcode_state->absolute_override = absolute_override;
 	cm_set_work_offsets(MODEL);	// must reset offsets if you change absolute override
 }
@@ -262,6 +276,12 @@ void cm_set_model_linenum(uint32_t linenum)
  *
  * The offsets themselves are considered static, are kept in cm, and are supposed to be persistent.
  *
+ * cm_set_model_target() and the position getters run for every block, so the offset in effect
+ *	(G5x + G92, or 0 under G53) and the units scale are combined once into gmx.active_offset[] 
+ *	and gmx.units_scale. Anything that changes a part of them - coordinate system, G10, the G92
+ *	family, absolute override, units mode or a $g54x style config write - calls 
+ *	cm_offsets_changed(), and they are rebuilt the next time they are used.
+ *
  * To reduce complexity and data load the following is done:
  *	- Full data for coordinates/offsets is only accessible by the canonical machine, not the downstream
  *	- A fully resolved set of coord and G92 offsets, with per-move exceptions can be captured as "work_offsets"
@@ -277,12 +297,26 @@ void cm_set_model_linenum(uint32_t linenum)
  *	which merely returns what's in the work_offset[] array.
  */
 
+void cm_offsets_changed() { gmx.active_offset_valid = false;}
+
+static void _update_active_offsets()
+{
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		float offset = 0;								// no offset if in absolute override mode
+		if (gm.absolute_override == false) {
+			offset = cm.offset[gm.coord_system][axis];
+			if (gmx.origin_offset_enable == true) offset += gmx.origin_offset[axis]; // includes G5x and G92 compoenents
+		}
+		gmx.active_offset[axis] = offset;
+	}
+	gmx.units_scale = (gm.units_mode == INCHES) ? MM_PER_INCH : 1;
+	gmx.active_offset_valid = true;
+}
+
 float cm_get_active_coord_offset(uint8_t axis)
 {
-	if (gm.absolute_override == true) return (0);		// no offset if in absolute override mode
-	float offset = cm.offset[gm.coord_system][axis];
-	if (gmx.origin_offset_enable == true) offset += gmx.origin_offset[axis]; // includes G5x and G92 compoenents
-	return (offset); 
+	if (gmx.active_offset_valid == false) { _update_active_offsets();}
+	return (gmx.active_offset[axis]);
 }
 
 /*
@@ -299,9 +333,8 @@ float cm_get_work_offset(GCodeState_t *gcode_state, uint8_t axis)
  */
 void cm_set_work_offsets(GCodeState_t *gcode_state)
 {
-	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
-		gcode_state->work_offset[axis] = cm_get_active_coord_offset(axis);
-	}
+	if (gmx.active_offset_valid == false) { _update_active_offsets();}
+	copy_axis_vector(gcode_state->work_offset, gmx.active_offset);
 }
 
 /*
@@ -313,7 +346,7 @@ void cm_set_work_offsets(GCodeState_t *gcode_state)
 float cm_get_absolute_position(GCodeState_t *gcode_state, uint8_t axis) 
 {
 	if (gcode_state == MODEL) return (gmx.position[axis]);
-	return (mp_get_runtime_absolute_position(axis));
+	return (mp_get_runtime_reported_position(axis));
 }
 
 /*
@@ -374,7 +407,7 @@ static float _calc_ABC(uint8_t axis, float target[], float flag[])
 	if ((cm.a[axis].axis_mode == AXIS_STANDARD) || (cm.a[axis].axis_mode == AXIS_INHIBITED)) {
 		return(target[axis]);	// no mm conversion - it's in degrees
 	}
-	return(_to_millimeters(target[axis]) * 360 / (2 * M_PI * cm.a[axis].radius));
+	return(target[axis] * gmx.units_scale * cm.radius_factor[axis]);
 }
 
 void cm_set_model_target(float target[], float flag[])
@@ -382,27 +415,29 @@ void cm_set_model_target(float target[], float flag[])
 	uint8_t axis;
 	float tmp = 0;
 
+	if (gmx.active_offset_valid == false) { _update_active_offsets();}
+
 	// process XYZABC for lower modes
 	for (axis=AXIS_X; axis<=AXIS_Z; axis++) {
 		if ((fp_FALSE(flag[axis])) || (cm.a[axis].axis_mode == AXIS_DISABLED)) {
 			continue;		// skip axis if not flagged for update or its disabled
 		} else if ((cm.a[axis].axis_mode == AXIS_STANDARD) || (cm.a[axis].axis_mode == AXIS_INHIBITED)) {
 			if (gm.distance_mode == ABSOLUTE_MODE) {
-				gm.target[axis] = cm_get_active_coord_offset(axis) + _to_millimeters(target[axis]);
+				gm.target[axis] = gmx.active_offset[axis] + target[axis] * gmx.units_scale;
 			} else {
-				gm.target[axis] += _to_millimeters(target[axis]);
+				gm.target[axis] += target[axis] * gmx.units_scale;
 			}
 		}
 	}
 	// FYI: The ABC loop below relies on the XYZ loop having been run first
-	for (axis=AXIS_A; axis<=AXIS_C; axis++) {
+	for (axis=AXIS_A; axis<AXES; axis++) {
 		if ((fp_FALSE(flag[axis])) || (cm.a[axis].axis_mode == AXIS_DISABLED)) {
 			continue;		// skip axis if not flagged for update or its disabled
 		} else {
 			tmp = _calc_ABC(axis, target, flag);
 		}
 		if (gm.distance_mode == ABSOLUTE_MODE) {
-			gm.target[axis] = tmp + cm_get_active_coord_offset(axis); // sacidu93's fix to Issue #22
+			gm.target[axis] = tmp + gmx.active_offset[axis]; // sacidu93's fix to Issue #22
 		} else {
 			gm.target[axis] += tmp;
 		}
@@ -451,6 +486,10 @@ void cm_conditional_set_model_position(stat_t status)
  *	Sets the following variables in the gcode_state struct
  *	  - move_time is set to optimal time
  *	  - minimum_time is set to minimum time
+ *
+ *	This runs for every block, so the axis limits are kept as reciprocals (see cm_set_vm())
+ *	and only the axes that move are looked at. An axis that doesn't move has a time of 
+ *	zero, which still sets minimum_time to zero.
  */
 /* --- NIST RS274NGC_v3 Guidance ---
  *
@@ -503,7 +542,8 @@ void cm_set_move_times(GCodeState_t *gcode_state)
 	//		 the canonical machine will be the target, but this is not required.
 
 	// compute times for feed motion
-	if (gm.motion_mode == MOTION_MODE_STRAIGHT_FEED) {
+	uint8_t feed = ((gm.motion_mode == MOTION_MODE_STRAIGHT_FEED) || (gm.motion_mode == MOTION_MODE_SPINDLE_SYNC));
+	if (feed == true) {
 		if (gm.inverse_feed_rate_mode == true) {
 			inv_time = gmx.inverse_feed_rate;
 		} else {
@@ -511,18 +551,20 @@ void cm_set_move_times(GCodeState_t *gcode_state)
 							square(gm.target[AXIS_Y] - gmx.position[AXIS_Y]) +
 							square(gm.target[AXIS_Z] - gmx.position[AXIS_Z])) / gm.feed_rate; // in linear units
 			if (fp_ZERO(xyz_time)) {
-				abc_time = sqrt(square(gm.target[AXIS_A] - gmx.position[AXIS_A]) + // in deg
-								square(gm.target[AXIS_B] - gmx.position[AXIS_B]) +
-								square(gm.target[AXIS_C] - gmx.position[AXIS_C])) / gm.feed_rate; // in degree units
+				float abc = 0;
+				for (uint8_t axis = AXIS_A; axis < AXES; axis++) { abc += square(gm.target[axis] - gmx.position[axis]);}
+				abc_time = sqrt(abc) / gm.feed_rate;	// in degree units
 			}
 		}
 	}
+	float *recip_max = (feed == true) ? cm.recip_feedrate_max : cm.recip_velocity_max;
 	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
-		if (gm.motion_mode == MOTION_MODE_STRAIGHT_FEED) {
-			tmp_time = fabs(gm.target[axis] - gmx.position[axis]) / cm.a[axis].feedrate_max;
-		} else { // gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE
-			tmp_time = fabs(gm.target[axis] - gmx.position[axis]) / cm.a[axis].velocity_max;
+		float travel = fabs(gm.target[axis] - gmx.position[axis]);
+		if (fp_ZERO(travel)) {
+			gcode_state->minimum_time = 0;
+			continue;
 		}
+		tmp_time = travel * recip_max[axis];
 		max_time = max(max_time, tmp_time);
 		gcode_state->minimum_time = min(gcode_state->minimum_time, tmp_time);
 	}
@@ -530,14 +572,16 @@ void cm_set_move_times(GCodeState_t *gcode_state)
 }
 
 /* 
- * _test_soft_limits() - return error code if soft limit is exceeded
+ * cm_test_soft_limits() - return error code if soft limit is exceeded
  *
- *	Must be called with target properly set in GM struct. Best done after cm_set_model_target() 
+ *	Tests a target in machine coordinates - for the model that is gm.target, best 
+ *	after cm_set_model_target(). Disabled axes and axes with no travel set aren't tested.
  */
-stat_t _test_soft_limits()
+stat_t cm_test_soft_limits(const float target[])
 {
 	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
-		if ((gm.target[axis] < 0) || (gm.target[axis] > cm.a[axis].travel_max)) {
+		if ((cm.a[axis].axis_mode == AXIS_DISABLED) || (fp_ZERO(cm.a[axis].travel_max))) { continue;}
+		if ((target[axis] < 0) || (target[axis] > cm.a[axis].travel_max)) {
 			return (STAT_SOFT_LIMIT_EXCEEDED);
 		}
 	}
@@ -574,10 +618,12 @@ void canonical_machine_init()
 	cm_set_units_mode(cm.units_mode);
 	cm_set_coord_system(cm.coord_system);
 	cm_select_plane(cm.select_plane);
-	cm_set_path_control(cm.path_control);
+	cm_set_path_control(cm.path_control, 0);
 	cm_set_distance_mode(cm.distance_mode);
 
 	gmx.block_delete_switch = true;
+	gmx.feed_rate_override_factor = 1;	// overrides are off, but enabling one starts at 100%
+	gmx.traverse_override_factor = 1;
 
 	// never start a machine in a motion mode
 	gm.motion_mode = MOTION_MODE_CANCEL_MOTION_MODE;
@@ -614,6 +660,7 @@ stat_t cm_alarm(stat_t status)
 //	gpio_set_bit_off(FLOOD_COOLANT_BIT);	//###### replace with exec function
 
 	cm.machine_state = MACHINE_ALARM;
+	sr_mark_changed(SR_CHANGED_STATE);
 	rpt_exception(status);					// send shutdown message
 	return (status);
 }
@@ -680,6 +727,7 @@ stat_t cm_select_plane(uint8_t plane)
 stat_t cm_set_units_mode(uint8_t mode)
 {
 	gm.units_mode = mode;		// 0 = inches, 1 = mm.
+	cm_offsets_changed();
 	return(STAT_OK);
 }
 
@@ -713,6 +761,7 @@ stat_t cm_set_coord_offsets(uint8_t coord_system, float offset[], float flag[])
 			cm.g10_persist_flag = true;		// this will persist offsets to NVM once move has stopped
 		}
 	}
+	cm_offsets_changed();
 	return (STAT_OK);
 }
 
@@ -723,8 +772,9 @@ stat_t cm_set_coord_offsets(uint8_t coord_system, float offset[], float flag[])
 stat_t cm_set_coord_system(uint8_t coord_system)
 {
 	gm.coord_system = coord_system;
+	cm_offsets_changed();
 
-	float value[AXES] = { (float)coord_system,0,0,0,0,0 };	// pass coordinate system in value[0] element
+	float value[AXES] = { (float)coord_system };	// pass coordinate system in value[0] element
 	mp_queue_command(_exec_offset, value, value);			// second vector (flags) is not used, so fake it
 	return (STAT_OK);
 }
@@ -810,7 +860,8 @@ stat_t cm_set_origin_offsets(float offset[], float flag[])
 		}
 	}
 	// now pass the offset to the callback - setting the coordinate system also applies the offsets
-	float value[AXES] = { (float)gm.coord_system,0,0,0,0,0 }; // pass coordinate system in value[0] element
+	cm_offsets_changed();
+	float value[AXES] = { (float)gm.coord_system }; // pass coordinate system in value[0] element
 	mp_queue_command(_exec_offset, value, value);				  // second vector is not used
 	return (STAT_OK);
 }
@@ -821,7 +872,8 @@ stat_t cm_reset_origin_offsets()
 	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
 		gmx.origin_offset[axis] = 0;
 	}
-	float value[AXES] = { (float)gm.coord_system,0,0,0,0,0 };
+	cm_offsets_changed();
+	float value[AXES] = { (float)gm.coord_system };
 	mp_queue_command(_exec_offset, value, value);
 	return (STAT_OK);
 }
@@ -829,7 +881,8 @@ stat_t cm_reset_origin_offsets()
 stat_t cm_suspend_origin_offsets()
 {
 	gmx.origin_offset_enable = 0;
-	float value[AXES] = { (float)gm.coord_system,0,0,0,0,0 };
+	cm_offsets_changed();
+	float value[AXES] = { (float)gm.coord_system };
 	mp_queue_command(_exec_offset, value, value);
 	return (STAT_OK);
 }
@@ -837,7 +890,8 @@ stat_t cm_suspend_origin_offsets()
 stat_t cm_resume_origin_offsets()
 {
 	gmx.origin_offset_enable = 1;
-	float value[AXES] = { (float)gm.coord_system,0,0,0,0,0 };
+	cm_offsets_changed();
+	float value[AXES] = { (float)gm.coord_system };
 	mp_queue_command(_exec_offset, value, value);
 	return (STAT_OK);
 }
@@ -854,16 +908,52 @@ stat_t cm_straight_traverse(float target[], float flags[])
 	gm.motion_mode = MOTION_MODE_STRAIGHT_TRAVERSE;
 	cm_set_model_target(target,flags);
 	if (vector_equal(gm.target, gmx.position)) { return (STAT_OK); }
-//	ritorno(_test_soft_limits());
+//	ritorno(cm_test_soft_limits(gm.target));
 
 	cm_set_work_offsets(&gm);					// capture the fully resolved offsets to the state
 	cm_set_move_times(&gm);						// set move time and minimum time in the state
 	cm_cycle_start();							// required for homing & other cycles
-	stat_t status = mp_aline(&gm);				// run the move
+	stat_t status = (cm.rapid_mode == RAPID_MODE_DOGLEG) ? mp_dogleg(&gm) : mp_aline(&gm);	// run the move
 	cm_conditional_set_model_position(status);	// update position if the move was successful
 	return (status);
 }
 
+/*
+ * cm_spindle_sync_feed() - G33
+ *
+ *	Feeds along the line at pitch (K) per revolution of the spindle at its programmed
+ *	speed. The runtime follows the spindle's measured speed from there (see spindle.h).
+ *	F is not changed. The move is refused if the axes can't go fast enough for the 
+ *	pitch at that speed.
+ */
+stat_t cm_spindle_sync_feed(float target[], float flags[], float pitch)
+{
+	gm.motion_mode = MOTION_MODE_SPINDLE_SYNC;
+
+	if (gm.inverse_feed_rate_mode == true) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if ((spindle.pulses_per_rev == 0) || (spindle.programmed_mode == SPINDLE_OFF) || 
+		(spindle.programmed_speed <= 0)) { return (STAT_SPINDLE_SYNC_ERROR);}
+	if (pitch <= 0) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+
+	cm_set_model_target(target, flags);
+	if (vector_equal(gm.target, gmx.position)) { return (STAT_OK); }
+
+	float feed_rate = gm.feed_rate;
+	gm.feed_rate = _to_millimeters(pitch) * spindle.programmed_speed;
+	cm_set_move_times(&gm);
+	float sync_time = get_axis_vector_length(gm.target, gmx.position) / gm.feed_rate;
+	gm.feed_rate = feed_rate;
+	if (gm.move_time > sync_time * 1.001) { return (STAT_MAX_SPINDLE_SPEED_EXCEEDED);}
+
+	cm_set_work_offsets(&gm);
+	cm_cycle_start();
+	gm.spindle_sync = spindle.programmed_speed;
+	stat_t status = mp_aline(&gm);
+	gm.spindle_sync = 0;
+	cm_conditional_set_model_position(status);
+	return (status);
+}
+
 /*
  * cm_set_g28_position()  - G28.1
  * cm_goto_g28_position() - G28
@@ -938,11 +1028,20 @@ stat_t cm_set_inverse_feed_rate_mode(uint8_t mode)
 
 /*
  * cm_set_path_control() - G61, G61.1, G64 (affects MODEL only)
+ *
+ *	The tolerance is the G64 P word. It sets how far the path may deviate from a 
+ *	corner so the planner can carry more velocity through junctions (see _get_blend_vmax()).
+ *	G64 with no P, G61 and G61.1 all clear it.
  */
 
-stat_t cm_set_path_control(uint8_t mode)
+stat_t cm_set_path_control(uint8_t mode, float tolerance)
 {
 	gm.path_control = mode;
+	gm.path_tolerance = 0;
+	if (mode == PATH_CONTINUOUS) {
+		if (tolerance < 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+		gm.path_tolerance = _to_millimeters(tolerance);
+	}
 	return (STAT_OK);
 }
 
@@ -953,6 +1052,11 @@ stat_t cm_set_path_control(uint8_t mode)
  * cm_arc_feed()
  */
 // see plan_arc.cpp
+
+/* 
+ * cm_spline_feed()
+ */
+// see plan_spline.cpp
  
 /*
  * cm_dwell() - G4, P parameter (seconds)
@@ -964,6 +1068,77 @@ stat_t cm_dwell(float seconds)
 	return (STAT_OK);
 }
 
+/*
+ * cm_pvt() - queue a position-velocity-time point (see mp_pvt())
+ *
+ *	The target is in machine coordinates and mm - units, offsets and distance mode
+ *	don't apply, as the host has planned the motion in the machine frame. Velocities
+ *	are in mm/min and the time in seconds, at least one minimum segment time.
+ */
+stat_t cm_pvt(float target[], float velocity[], float seconds)
+{
+	if ((seconds * 1000000) < MIN_SEGMENT_USEC) { return (STAT_MINIMUM_TIME_MOVE_ERROR);}
+	copy_axis_vector(gm.target, target);
+	cm_cycle_start();
+	stat_t status = mp_pvt(target, velocity, seconds);
+	cm_conditional_set_model_position(status);	// lines go on from the point
+	return (status);
+}
+
+/*
+ * cm_raster() - queue a laser raster line (see RASTER LINES in planner.h)
+ *
+ *	The line starts at start[] - X and Y in machine coordinates and mm, as for cm_pvt()
+ *	- and runs count pixels of pitch mm along direction[]. If the machine isn't at the 
+ *	start it traverses there first. The feed rate is in mm/min, 0 for the modal F, and 
+ *	the modal state is left as it was. A pixel's power is its level [0..255] of the S 
+ *	power, so dynamic power mode ($p1dyn) must be on. The line accelerates and 
+ *	decelerates like any feed, so lead in and out with off pixels to keep the ramps 
+ *	out of the image.
+ */
+stat_t cm_raster(float start[], float direction[], float pitch, float feed_rate, const uint8_t pixels[], uint16_t count)
+{
+	if (pwm.c[PWM_1].dynamic_power == false) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	float norm = sqrt(square(direction[0]) + square(direction[1]));
+	if ((count == 0) || (pitch <= 0) || (fp_ZERO(norm))) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if (fp_ZERO(feed_rate)) { feed_rate = gm.feed_rate;}
+	if (feed_rate <= 0) { return (STAT_GCODE_FEEDRATE_ERROR);}
+
+	stat_t status;
+	uint8_t motion_mode = gm.motion_mode;
+	copy_axis_vector(gm.target, gmx.position);
+	gm.target[AXIS_X] = start[0];
+	gm.target[AXIS_Y] = start[1];
+	if (vector_equal(gm.target, gmx.position) == false) {
+		gm.motion_mode = MOTION_MODE_STRAIGHT_TRAVERSE;
+		cm_set_work_offsets(&gm);
+		cm_set_move_times(&gm);
+		cm_cycle_start();
+		status = mp_aline(&gm);
+		cm_conditional_set_model_position(status);
+		if (status != STAT_OK) {
+			gm.motion_mode = motion_mode;
+			return (status);
+		}
+	}
+	float feed = gm.feed_rate;
+	uint8_t inverse_feed_rate_mode = gm.inverse_feed_rate_mode;
+	gm.motion_mode = MOTION_MODE_STRAIGHT_FEED;
+	gm.feed_rate = feed_rate;
+	gm.inverse_feed_rate_mode = false;
+	gm.target[AXIS_X] += direction[0] / norm * pitch * count;
+	gm.target[AXIS_Y] += direction[1] / norm * pitch * count;
+	cm_set_work_offsets(&gm);
+	cm_set_move_times(&gm);
+	cm_cycle_start();
+	status = mp_raster(&gm, pixels, count);
+	cm_conditional_set_model_position(status);
+	gm.motion_mode = motion_mode;
+	gm.feed_rate = feed;
+	gm.inverse_feed_rate_mode = inverse_feed_rate_mode;
+	return (status);
+}
+
 /*
  * cm_straight_feed() - G1
  */
@@ -984,7 +1159,7 @@ stat_t cm_straight_feed(float target[], float flags[])
 
 	cm_set_model_target(target, flags);
 	if (vector_equal(gm.target, gmx.position)) { return (STAT_OK); }
-//	ritorno(_test_soft_limits());
+//	ritorno(cm_test_soft_limits(gm.target));
 
 	cm_set_work_offsets(&gm);					// capture the fully resolved offsets to the state
 	cm_set_move_times(&gm);						// set move time and minimum time in the state
@@ -994,6 +1169,288 @@ stat_t cm_straight_feed(float target[], float flags[])
 	return (status);
 }
 
+/*
+ * cm_set_retract_mode() - G98, G99 (affects MODEL only)
+ */
+stat_t cm_set_retract_mode(uint8_t mode)
+{
+	gmx.retract_mode = mode;
+	return (STAT_OK);
+}
+
+/*
+ * cm_canned_cycle() 			- G81, G82, G83 drilling and G84 tapping cycles
+ * cm_canned_cycle_callback() 	- queue the cycle moves as the planner frees up
+ * cm_abort_canned_cycle() 		- stop a cycle in process (OK to call if none is running)
+ *
+ *	A cycle block drills L holes (default 1) along the axis normal to the selected plane,
+ *	which is Z for G17. Like arcs the block is set up by the canonical function and the 
+ *	moves are queued by the callback, so one block can drill a hole of any number of pecks. 
+ *	For each hole:
+ *	  - traverse in the plane to the hole (after first traversing up to the R plane if the 
+ *		tool starts below it)
+ *	  - traverse to the R plane
+ *	  - G81: feed to the bottom
+ *	  - G82: feed to the bottom and dwell for P seconds
+ *	  - G83: feed down Q at a time, traversing back up to the R plane after each peck 
+ *		and back down to CANNED_CYCLE_PECK_CLEARANCE above the last depth 
+ *	  - G84: feed to the bottom synchronized with the spindle, reverse the spindle and 
+ *		dwell P, feed back out to the R plane, then restore the spindle and dwell P. 
+ *		The spindle must be on CW (M3) with a tach and S set - see spindle.h
+ *	  - traverse to the R plane (G99) or to the starting level if it is higher (G98)
+ *
+ *	R, Z, Q and P are sticky while the motion mode stays a canned cycle, so subsequent 
+ *	holes only need their plane words; a block with none of the plane, depth or R words 
+ *	doesn't drill. R and the depth must be given when the cycle is started. In G90 R and 
+ *	Z are work coordinates. In G91 R is relative to the starting level, Z to the R plane,
+ *	and the plane words are the increment to each hole (repeated L times). 
+ *
+ *	The callback queues one step per pass, waiting for the buffers that step takes - 
+ *	one for a move or dwell, two for the spindle reversals of G84 (a stop and a dwell).
+ */
+enum cmCannedCycleStep {
+	CYCLE_STEP_PRELIMINARY = 0,		// up to the R plane if starting below it
+	CYCLE_STEP_POSITION,			// to the hole in the plane
+	CYCLE_STEP_R_PLANE,				// down to the R plane
+	CYCLE_STEP_FEED,				// feed to the bottom or the next peck depth
+	CYCLE_STEP_DWELL,				// G82 dwell
+	CYCLE_STEP_PECK_RETRACT,		// G83 clear the chips
+	CYCLE_STEP_PECK_RETURN,			// G83 back down to just above the last depth
+	CYCLE_STEP_TAP_REVERSE,			// G84 reverse the spindle at the bottom
+	CYCLE_STEP_TAP_RETRACT,			// G84 feed back out to the R plane
+	CYCLE_STEP_TAP_RESTORE,			// G84 spindle forward again
+	CYCLE_STEP_RETRACT				// up to the retract level
+};
+
+struct cmCannedCycle {				// canned cycle runtime
+	uint8_t run_state;				// runtime state machine sequence
+	uint8_t step;					// next move of the current hole
+	uint8_t motion_mode;			// G81, G82, G83, G84
+	uint8_t holes;					// holes left including the current one
+	uint8_t axis;					// drill axis
+	uint8_t axis_0;					// plane axes
+	uint8_t axis_1;
+	float hole[2];					// position of the hole in the plane (machine coordinates)
+	float increment[2];				// hole to hole increment in the plane (G91 L repeats)
+	float r_plane;					// machine coordinates along the drill axis...
+	float bottom;
+	float clear;					// ...retract level
+	float depth;					// depth reached so far
+	float peck;						// G83 peck increment, or 0
+	float dwell;					// G82, G84 dwell, or 0
+	float sync;						// G84 spindle RPM the feeds follow, or 0
+	float position[AXES];			// next move target
+};
+static struct cmCannedCycle cc;
+
+stat_t cm_canned_cycle(float target[], float flags[], uint8_t motion_mode)
+{
+	uint8_t axis = gmx.plane_axis_2;
+	uint8_t in_cycle = ((gm.motion_mode >= MOTION_MODE_CANNED_CYCLE_81) && 
+						(gm.motion_mode <= MOTION_MODE_CANNED_CYCLE_89));
+
+	if ((gm.inverse_feed_rate_mode == true) || (motion_mode > MOTION_MODE_CANNED_CYCLE_84)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	if (fp_ZERO(gm.feed_rate)) { return (STAT_GCODE_FEEDRATE_ERROR);}
+	if (in_cycle == false) {
+		if (fp_FALSE(flags[axis])) { return (STAT_GCODE_AXIS_WORD_MISSING);}
+		if (fp_FALSE(gf.arc_radius)) { return (STAT_GCODE_INPUT_ERROR);}
+		gmx.cycle_peck_depth = 0;
+		gmx.cycle_dwell = 0;
+	}
+
+	// collect the sticky words
+	if (fp_TRUE(flags[axis])) { gmx.cycle_depth = _to_millimeters(target[axis]);}
+	if (fp_TRUE(gf.arc_radius)) { gmx.cycle_r_plane = _to_millimeters(gn.arc_radius);}
+	if (fp_TRUE(gf.peck_depth)) { gmx.cycle_peck_depth = _to_millimeters(gn.peck_depth);}
+	if (fp_TRUE(gf.parameter)) { gmx.cycle_dwell = gn.parameter;}
+	if ((motion_mode == MOTION_MODE_CANNED_CYCLE_83) && (gmx.cycle_peck_depth <= 0)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+
+	// resolve the cycle levels to machine coordinates
+	float initial = gmx.position[axis];
+	if (gm.distance_mode == ABSOLUTE_MODE) {
+		cc.r_plane = cm_get_active_coord_offset(axis) + gmx.cycle_r_plane;
+		cc.bottom = cm_get_active_coord_offset(axis) + gmx.cycle_depth;
+	} else {
+		cc.r_plane = initial + gmx.cycle_r_plane;
+		cc.bottom = cc.r_plane + gmx.cycle_depth;
+	}
+	if (cc.bottom > cc.r_plane) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+
+	gm.motion_mode = motion_mode;				// the block is good - the cycle is the motion mode
+	if (fp_FALSE(flags[gmx.plane_axis_0]) && fp_FALSE(flags[gmx.plane_axis_1]) && 
+		fp_FALSE(flags[axis]) && fp_FALSE(gf.arc_radius)) {
+		return (STAT_OK);
+	}
+	if ((motion_mode == MOTION_MODE_CANNED_CYCLE_84) && ((spindle.pulses_per_rev == 0) || 
+		(spindle.programmed_mode != SPINDLE_CW) || (spindle.programmed_speed <= 0))) {
+		return (STAT_SPINDLE_SYNC_ERROR);
+	}
+	if (gmx.retract_mode == RETRACT_TO_R_PLANE) {
+		cc.clear = cc.r_plane;
+	} else {
+		cc.clear = max(initial, cc.r_plane);
+	}
+
+	// resolve the holes
+	cc.axis_0 = gmx.plane_axis_0;
+	cc.axis_1 = gmx.plane_axis_1;
+	for (uint8_t i=0; i<2; i++) {
+		uint8_t plane_axis = (i == 0) ? cc.axis_0 : cc.axis_1;
+		cc.hole[i] = gmx.position[plane_axis];
+		cc.increment[i] = 0;
+		if (fp_FALSE(flags[plane_axis])) { continue;}
+		if (gm.distance_mode == ABSOLUTE_MODE) {
+			cc.hole[i] = cm_get_active_coord_offset(plane_axis) + _to_millimeters(target[plane_axis]);
+		} else {
+			cc.increment[i] = _to_millimeters(target[plane_axis]);
+			cc.hole[i] += cc.increment[i];
+		}
+	}
+	cc.holes = (gf.l_word == true) ? gn.l_word : 1;
+	if (cc.holes == 0) { return (STAT_OK);}
+	if (cm.seek_line != 0) {					// seeking a restart line - end up over the last hole
+		gmx.position[cc.axis_0] = cc.hole[0] + cc.increment[0] * (cc.holes - 1);
+		gmx.position[cc.axis_1] = cc.hole[1] + cc.increment[1] * (cc.holes - 1);
+		gmx.position[axis] = cc.clear;
+		copy_axis_vector(gm.target, gmx.position);
+		return (STAT_OK);
+	}
+
+	cc.motion_mode = motion_mode;
+	cc.axis = axis;
+	cc.peck = (motion_mode == MOTION_MODE_CANNED_CYCLE_83) ? gmx.cycle_peck_depth : 0;
+	cc.dwell = ((motion_mode == MOTION_MODE_CANNED_CYCLE_82) || (motion_mode == MOTION_MODE_CANNED_CYCLE_84)) ? gmx.cycle_dwell : 0;
+	cc.sync = (motion_mode == MOTION_MODE_CANNED_CYCLE_84) ? spindle.programmed_speed : 0;
+	copy_axis_vector(cc.position, gmx.position);
+	cc.step = (initial < cc.r_plane) ? CYCLE_STEP_PRELIMINARY : CYCLE_STEP_POSITION;
+	cc.run_state = MOVE_STATE_RUN;
+	controller_set_ready(CTL_TASK_CANNED_CYCLE);
+	return (STAT_OK);
+}
+
+stat_t cm_canned_cycle_callback()
+{
+	if (cc.run_state == MOVE_STATE_OFF) { return (STAT_NOOP);}
+	uint8_t need = ((cc.step == CYCLE_STEP_TAP_REVERSE) || (cc.step == CYCLE_STEP_TAP_RESTORE)) ? 2 : 1;	// spindle stop and dwell
+	if (!controller_wait_until(CTL_TASK_CANNED_CYCLE, CTL_EVENT_BUFFER, 
+			mp_get_planner_buffers_available() >= need)) { return (STAT_EAGAIN);}
+
+	switch (cc.step) {
+		case CYCLE_STEP_PRELIMINARY: {
+			cc.position[cc.axis] = cc.r_plane;
+			_canned_cycle_move(MOTION_MODE_STRAIGHT_TRAVERSE);
+			cc.step = CYCLE_STEP_POSITION;
+			break;
+		}
+		case CYCLE_STEP_POSITION: {
+			cc.position[cc.axis_0] = cc.hole[0];
+			cc.position[cc.axis_1] = cc.hole[1];
+			_canned_cycle_move(MOTION_MODE_STRAIGHT_TRAVERSE);
+			cc.step = CYCLE_STEP_R_PLANE;
+			break;
+		}
+		case CYCLE_STEP_R_PLANE: {
+			cc.position[cc.axis] = cc.r_plane;
+			_canned_cycle_move(MOTION_MODE_STRAIGHT_TRAVERSE);
+			cc.depth = cc.r_plane;
+			cc.step = CYCLE_STEP_FEED;
+			break;
+		}
+		case CYCLE_STEP_FEED: {
+			cc.depth = (cc.peck > 0) ? max(cc.depth - cc.peck, cc.bottom) : cc.bottom;
+			cc.position[cc.axis] = cc.depth;
+			_canned_cycle_move(MOTION_MODE_STRAIGHT_FEED);
+			if (cc.sync > 0) { cc.step = CYCLE_STEP_TAP_REVERSE;}
+			else if (cc.dwell > 0) { cc.step = CYCLE_STEP_DWELL;}
+			else if (cc.depth > cc.bottom) { cc.step = CYCLE_STEP_PECK_RETRACT;}
+			else { cc.step = CYCLE_STEP_RETRACT;}
+			break;
+		}
+		case CYCLE_STEP_DWELL: {
+			cm_dwell(cc.dwell);
+			cc.step = CYCLE_STEP_RETRACT;
+			break;
+		}
+		case CYCLE_STEP_PECK_RETRACT: {
+			cc.position[cc.axis] = cc.r_plane;
+			_canned_cycle_move(MOTION_MODE_STRAIGHT_TRAVERSE);
+			cc.step = CYCLE_STEP_PECK_RETURN;
+			break;
+		}
+		case CYCLE_STEP_PECK_RETURN: {
+			cc.position[cc.axis] = min(cc.depth + CANNED_CYCLE_PECK_CLEARANCE, cc.r_plane);
+			_canned_cycle_move(MOTION_MODE_STRAIGHT_TRAVERSE);
+			cc.step = CYCLE_STEP_FEED;
+			break;
+		}
+		case CYCLE_STEP_TAP_REVERSE: {
+			cm_spindle_control(SPINDLE_CCW);
+			if (cc.dwell > 0) { cm_dwell(cc.dwell);}
+			cc.step = CYCLE_STEP_TAP_RETRACT;
+			break;
+		}
+		case CYCLE_STEP_TAP_RETRACT: {
+			cc.position[cc.axis] = cc.r_plane;
+			_canned_cycle_move(MOTION_MODE_STRAIGHT_FEED);
+			cc.step = CYCLE_STEP_TAP_RESTORE;
+			break;
+		}
+		case CYCLE_STEP_TAP_RESTORE: {
+			cm_spindle_control(SPINDLE_CW);
+			if (cc.dwell > 0) { cm_dwell(cc.dwell);}
+			cc.step = CYCLE_STEP_RETRACT;
+			break;
+		}
+		case CYCLE_STEP_RETRACT: {
+			cc.position[cc.axis] = cc.clear;
+			_canned_cycle_move(MOTION_MODE_STRAIGHT_TRAVERSE);
+			if (--cc.holes == 0) {
+				cc.run_state = MOVE_STATE_OFF;
+				return (STAT_OK);
+			}
+			cc.hole[0] += cc.increment[0];
+			cc.hole[1] += cc.increment[1];
+			cc.step = CYCLE_STEP_POSITION;
+			break;
+		}
+	}
+	return (STAT_EAGAIN);
+}
+
+void cm_abort_canned_cycle()
+{
+	cc.run_state = MOVE_STATE_OFF;
+}
+
+/*
+ * _canned_cycle_move() - queue one cycle move to cc.position
+ *
+ *	The move runs as a G0 or G1, but the cycle stays the modal motion mode. G84 feeds
+ *	follow the spindle.
+ */
+static stat_t _canned_cycle_move(uint8_t motion_mode)
+{
+	stat_t status = STAT_OK;
+
+	gm.motion_mode = motion_mode;
+	gm.spindle_sync = (motion_mode == MOTION_MODE_STRAIGHT_FEED) ? cc.sync : 0;
+	copy_axis_vector(gm.target, cc.position);
+	if (vector_equal(gm.target, gmx.position) == false) {
+		cm_set_work_offsets(&gm);
+		cm_set_move_times(&gm);
+		cm_cycle_start();
+		status = mp_aline(&gm);
+		cm_conditional_set_model_position(status);
+	}
+	gm.motion_mode = cc.motion_mode;
+	gm.spindle_sync = 0;
+	return (status);
+}
+
 /***************************** 
  * Spindle Functions (4.3.7) *
  *****************************/
@@ -1014,7 +1471,7 @@ stat_t cm_straight_feed(float target[], float flags[])
  */
 stat_t cm_select_tool(uint8_t tool_select)
 {
-	float value[AXES] = { (float)tool_select,0,0,0,0,0 };
+	float value[AXES] = { (float)tool_select };
 	mp_queue_command(_exec_select_tool, value, value);
 	return (STAT_OK);
 }
@@ -1026,8 +1483,8 @@ static void _exec_select_tool(float *value, float *flag)
 
 stat_t cm_change_tool(uint8_t tool_change)
 {
-	float value[AXES] = { (float)gm.tool_select,0,0,0,0,0 };
-	mp_queue_command(_exec_change_tool, value, value);
+	float value[AXES] = { (float)gm.tool_select };
+	mp_queue_stop_command(_exec_change_tool, value, value);
 	return (STAT_OK);
 }
 
@@ -1046,8 +1503,8 @@ static void _exec_change_tool(float *value, float *flag)
 
 stat_t cm_mist_coolant_control(uint8_t mist_coolant)
 {
-	float value[AXES] = { (float)mist_coolant,0,0,0,0,0 };
-	mp_queue_command(_exec_mist_coolant_control, value, value);
+	float value[AXES] = { (float)mist_coolant };
+	mp_queue_output_command(_exec_mist_coolant_control, value, value);
 	return (STAT_OK);
 }
 static void _exec_mist_coolant_control(float *value, float *flag)
@@ -1055,22 +1512,26 @@ static void _exec_mist_coolant_control(float *value, float *flag)
 	gm.mist_coolant = (uint8_t)value[0];
 
 #ifdef __AVR
-	if (gm.mist_coolant == true)
-		gpio_set_bit_on(MIST_COOLANT_BIT);	// if
-	gpio_set_bit_off(MIST_COOLANT_BIT);		// else
+	if (gm.mist_coolant == true) {
+		gpio_set_bit_on(MIST_COOLANT_BIT);
+	} else {
+		gpio_set_bit_off(MIST_COOLANT_BIT);
+	}
 #endif // __AVR
 
 #ifdef __ARM
-	if (gm.mist_coolant == true)
-		coolant_enable_pin.set();	// if
-	coolant_enable_pin.clear();		// else
+	if (gm.mist_coolant == true) {
+		coolant_enable_pin.set();
+	} else {
+		coolant_enable_pin.clear();
+	}
 #endif // __ARM
 }
 
 stat_t cm_flood_coolant_control(uint8_t flood_coolant)
 {
-	float value[AXES] = { (float)flood_coolant,0,0,0,0,0 };
-	mp_queue_command(_exec_flood_coolant_control, value, value);
+	float value[AXES] = { (float)flood_coolant };
+	mp_queue_output_command(_exec_flood_coolant_control, value, value);
 	return (STAT_OK);
 }
 static void _exec_flood_coolant_control(float *value, float *flag)
@@ -1098,6 +1559,54 @@ static void _exec_flood_coolant_control(float *value, float *flag)
 #endif // __ARM
 }
 
+/*
+ * cm_sync_output() - M62, M63 Pn
+ *
+ *	Switch output n on (M62) or off (M63) in step with the next move - Q (length 
+ *	units) or E (ms) into it, or as it starts. See mp_queue_output_trigger()
+ */
+
+stat_t cm_sync_output(uint8_t state)
+{
+	uint8_t output = (uint8_t)gn.parameter;
+	if ((output < 1) || (output > DIGITAL_OUTPUTS)) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+	if ((gn.peck_depth < 0) || (gn.output_time < 0)) { return (STAT_INPUT_VALUE_TOO_SMALL);}
+	mp_queue_output_trigger(output, state, _to_millimeters(gn.peck_depth), gn.output_time);
+	return (STAT_OK);
+}
+
+/*
+ * cm_motion_profile()		  - M150 Pn
+ * cm_select_motion_profile() - put profile N's settings in effect for the next block
+ *
+ *	See MOTION PROFILES in canonical_machine.h
+ */
+
+stat_t cm_motion_profile(uint8_t flag)				// M150
+{
+	return (cm_select_motion_profile((uint8_t)gn.parameter));
+}
+
+stat_t cm_select_motion_profile(uint8_t profile)
+{
+	if ((profile < 1) || (profile > MOTION_PROFILES)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	cmProfile_t *p = &cm.profile[profile-1];
+	if (p->stored == false) { return (STAT_COMMAND_NOT_ACCEPTED);}
+
+	cm.junction_acceleration = p->junction_acceleration;
+	cm.junction_model = p->junction_model;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		cm.a[axis].jerk_max = p->jerk_max[axis];
+		cm.a[axis].junction_dev = p->junction_dev[axis];
+		cm.a[axis].velocity_max = p->velocity_max[axis];
+		cm.a[axis].feedrate_max = p->feedrate_max[axis];
+		cm.junction_dev_sq[axis] = p->junction_dev_sq[axis];
+	}
+	cm_set_move_terms();
+	cm.motion_profile = profile;
+	return (STAT_OK);
+}
+
 /*
  * cm_override_enables() - M48, M49
  * cm_feed_rate_override_enable() - M50
@@ -1116,6 +1625,8 @@ stat_t cm_override_enables(uint8_t flag)			// M48, M49
 	gmx.feed_rate_override_enable = flag;
 	gmx.traverse_override_enable = flag;
 	gmx.spindle_override_enable = flag;
+	mp_feed_rate_override(flag, gmx.feed_rate_override_factor);
+	mp_traverse_override(flag, gmx.traverse_override_factor);
 	return (STAT_OK);
 }
 
@@ -1126,6 +1637,7 @@ stat_t cm_feed_rate_override_enable(uint8_t flag)	// M50
 	} else {
 		gmx.feed_rate_override_enable = true;
 	}
+	mp_feed_rate_override(gmx.feed_rate_override_enable, gmx.feed_rate_override_factor);
 	return (STAT_OK);
 }
 
@@ -1133,7 +1645,7 @@ stat_t cm_feed_rate_override_factor(uint8_t flag)	// M50.1
 {
 	gmx.feed_rate_override_enable = flag;
 	gmx.feed_rate_override_factor = gn.parameter;
-//	mp_feed_rate_override(flag, gn.parameter);		// replan the queue for new feed rate
+	mp_feed_rate_override(flag, gn.parameter);		// takes effect at the next segment
 	return (STAT_OK);
 }
 
@@ -1144,6 +1656,7 @@ stat_t cm_traverse_override_enable(uint8_t flag)	// M50.2
 	} else {
 		gmx.traverse_override_enable = true;
 	}
+	mp_traverse_override(gmx.traverse_override_enable, gmx.traverse_override_factor);
 	return (STAT_OK);
 }
 
@@ -1151,7 +1664,7 @@ stat_t cm_traverse_override_factor(uint8_t flag)	// M51
 {
 	gmx.traverse_override_enable = flag;
 	gmx.traverse_override_factor = gn.parameter;
-//	mp_feed_rate_override(flag, gn.parameter);		// replan the queue for new feed rate
+	mp_traverse_override(flag, gn.parameter);		// takes effect at the next segment
 	return (STAT_OK);
 }
 
@@ -1235,9 +1748,14 @@ void cm_message(char_t *message)
  *		should start to run anything in the planner queue
  */
 
-void cm_request_feedhold(void) { cm.feedhold_requested = true; }
-void cm_request_queue_flush(void) { cm.queue_flush_requested = true; }
-void cm_request_cycle_start(void) { cm.cycle_start_requested = true; }
+void cm_request_feedhold(void)
+{
+	ev_record(EV_HOLD, cm_get_linenum(RUNTIME), 0);	// where the motors are
+	cm.feedhold_requested = true;
+	controller_set_ready(CTL_TASK_FEEDHOLD);
+}
+void cm_request_queue_flush(void) { cm.queue_flush_requested = true; controller_set_ready(CTL_TASK_FEEDHOLD);}
+void cm_request_cycle_start(void) { cm.cycle_start_requested = true; controller_set_ready(CTL_TASK_FEEDHOLD);}
 
 stat_t cm_feedhold_sequencing_callback()
 {
@@ -1261,7 +1779,8 @@ stat_t cm_feedhold_sequencing_callback()
 		cm_cycle_start();
 		mp_end_hold();
 	}
-	return (STAT_OK);
+	if (cm.queue_flush_requested == true) { return (STAT_OK);}	// deferred - keep checking
+	return (STAT_NOOP);
 }
 
 stat_t cm_queue_flush()
@@ -1270,6 +1789,8 @@ stat_t cm_queue_flush()
 	xio_reset_usb_rx_buffers();		// flush serial queues
 #endif
 	mp_flush_planner();				// flush planner queue
+	gc_flush_read_ahead();			// ...and the Gcode blocks parsed ahead of it
+	controller_line_check_reset();	// a new job numbers its lines afresh
 
 	// Note: The following uses low-level mp calls for absolute position.
 	//		 It could also use cm_get_absolute_position(RUNTIME, axis);
@@ -1279,11 +1800,126 @@ stat_t cm_queue_flush()
 		gmx.position[axis] = mp_get_runtime_absolute_position(axis);
 		gm.target[axis] = gmx.position[axis];
 	}
-	float value[AXES] = { (float)MACHINE_PROGRAM_STOP, 0,0,0,0,0 };
+	float value[AXES] = { (float)MACHINE_PROGRAM_STOP };
 	_exec_program_finalize(value, value);			// finalize now, not later
 	return (STAT_OK);
 }
 
+/*
+ * Jogging
+ *
+ * cm_jog_frame()		 - read a jog frame a character at a time
+ * cm_request_jog()		 - set the jog velocities - from any interrupt level
+ * cm_get_jog_velocity() - the velocities in effect, zero once they time out
+ * cm_jog_callback()	 - start a jog and hold commands off while it runs
+ *
+ *	A jog key or a pendant wheel asks for a velocity, not a place to go, and the 
+ *	machine should stop when it is let go. Gcode lines can't do that - they queue up 
+ *	behind each other and the machine runs on to the end of the last. A jog skips the
+ *	planner and the command line altogether. The host sends jog frames:
+ *
+ *	  DC2 (0x12), an axis mask, then a velocity byte for each axis in the mask
+ *
+ *	The mask has a bit per axis, bit 0 X to bit 5 C. Each velocity is a signed byte,
+ *	-127 to 127, taken as that many 127ths of the axis $xfr. Axes not in the mask go
+ *	to zero, so DC2 0 stops them all. Frames are acted on as they are taken from any
+ *	input device, as ! and ~ are, so they never wait behind queued lines. The bytes of
+ *	a frame are never taken as realtime characters.
+ *
+ *	The velocities hold for $jgt milliseconds. The host repeats the frame while the key
+ *	is down or the wheel turning, a few times in that; when the frames stop coming - the 
+ *	key is let go, the cable pulled - the axes stop on their own. $jgt=0 turns jogging 
+ *	off.
+ *
+ *	A jog starts when the machine is idle - no cycle running, nothing queued, no hold 
+ *	or alarm - and runs as a cycle of its own (stat 10). Frames that arrive while a 
+ *	program runs are dropped. The runtime follows the velocities segment by segment 
+ *	(see mp_jog()), so a new velocity or a stop is taken up within a segment and the 
+ *	axes brake from there under their jerk limits. A feedhold stops the jog as well. 
+ *	Commands wait until the jog has ended, and the Gcode model then takes up the 
+ *	position it ended at.
+ */
+uint8_t cm_jog_frame(cmJogFrame_t *f, const uint8_t c)
+{
+	if (f->pending == 0) {						// between frames
+		if (c != JOG_FRAME_START) { return (false);}
+		f->pending = 1;
+		f->mask = JOG_MASK_UNREAD;
+		return (true);
+	}
+	if (f->mask == JOG_MASK_UNREAD) {
+		if (c >= (1 << AXES)) {					// not a mask - drop the frame
+			f->pending = 0;
+			return (true);
+		}
+		f->mask = c;
+		f->axis = 0;
+		f->pending = 0;
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			f->velocity[axis] = 0;
+			if ((c & (1 << axis)) != 0) { f->pending++;}
+		}
+	} else {
+		while ((f->mask & (1 << f->axis)) == 0) { f->axis++;}
+		f->velocity[f->axis++] = max((int8_t)c, -127);
+		f->pending--;
+	}
+	if (f->pending == 0) {						// the frame is complete
+		float velocity[AXES];
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			velocity[axis] = f->velocity[axis] * cm.a[axis].feedrate_max / 127;
+		}
+		cm_request_jog(velocity);
+	}
+	return (true);
+}
+
+void cm_request_jog(const float velocity[])
+{
+	if (cm.jog_timeout == 0) { return;}			// jogging is off
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		float limit = 1 / cm.recip_velocity_max[axis];	// velocity_max or the step rate limit
+		cm.jog_velocity[axis] = max(-limit, min(velocity[axis], limit));
+	}
+	cm.jog_tick = SysTickTimer.getValue();
+	controller_set_ready(CTL_TASK_JOG);
+}
+
+uint8_t cm_get_jog_velocity(float velocity[])	// returns true if any axis is to move
+{
+	uint8_t live = ((SysTickTimer.getValue() - cm.jog_tick) <= cm.jog_timeout);
+	uint8_t moving = false;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		velocity[axis] = (live == true) ? cm.jog_velocity[axis] : 0;
+		if (fp_NOT_ZERO(velocity[axis])) { moving = true;}
+	}
+	return (moving);
+}
+
+stat_t cm_jog_callback()
+{
+	if (cm.cycle_state == CYCLE_JOG) { return (STAT_EAGAIN);}	// commands wait for the jog to end
+	if (cm.jog_ended == true) {					// take up the position the jog ended at
+		cm.jog_ended = false;
+		for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+			mp_set_planner_position(axis, mp_get_runtime_absolute_position(axis));
+			gmx.position[axis] = mp_get_runtime_absolute_position(axis);
+			gm.target[axis] = gmx.position[axis];
+		}
+	}
+	float velocity[AXES];
+	if (cm_get_jog_velocity(velocity) == false) { return (STAT_NOOP);}
+	if ((cm.cycle_state != CYCLE_OFF) || (cm.hold_state != FEEDHOLD_OFF) ||
+		(cm.machine_state == MACHINE_ALARM) || 
+		(mp_get_planner_buffers_available() < PLANNER_BUFFER_POOL_SIZE)) {
+		return (STAT_NOOP);						// not idle - the frame is dropped
+	}
+	cm.cycle_state = CYCLE_JOG;
+	sr_mark_changed(SR_CHANGED_STATE);
+	mp_jog();
+	return (STAT_EAGAIN);
+}
+
 /*
  * Program and cycle state functions
  *
@@ -1324,7 +1960,7 @@ static void _exec_program_finalize(float *value, float *flag)
 {
 	cm.machine_state = (uint8_t)value[0];;
 	cm_set_motion_state(MOTION_STOP);
-	if (cm.cycle_state == CYCLE_MACHINING) {
+	if ((cm.cycle_state == CYCLE_MACHINING) || (cm.cycle_state == CYCLE_JOG)) {
 		cm.cycle_state = CYCLE_OFF;					// don't end cycle if homing, probing, etc.
 	}
 	cm.hold_state = FEEDHOLD_OFF;					// end feedhold (if in feed hold)
@@ -1353,6 +1989,7 @@ static void _exec_program_finalize(float *value, float *flag)
 void cm_cycle_start()
 {
 	cm.machine_state = MACHINE_CYCLE;
+	sr_mark_changed(SR_CHANGED_STATE);
 	if (cm.cycle_state == CYCLE_OFF) {
 		cm.cycle_state = CYCLE_MACHINING;			// don't change homing, probe or other cycles
 		qr_clear_queue_report();					// clear queue reporting buffer counts
@@ -1361,28 +1998,141 @@ void cm_cycle_start()
 
 void cm_cycle_end() 
 {
+	sr_mark_changed(SR_CHANGED_STATE);				// homing and probing set their cycle state themselves
 	if (cm.cycle_state != CYCLE_OFF) {
-		float value[AXES] = { (float)MACHINE_PROGRAM_STOP, 0,0,0,0,0 };
+		float value[AXES] = { (float)MACHINE_PROGRAM_STOP };
 		_exec_program_finalize(value,value);
 	}
 }
 
 void cm_program_stop() 
 { 
-	float value[AXES] = { (float)MACHINE_PROGRAM_STOP, 0,0,0,0,0 };
-	mp_queue_command(_exec_program_finalize, value, value);
+	float value[AXES] = { (float)MACHINE_PROGRAM_STOP };
+	mp_queue_stop_command(_exec_program_finalize, value, value);
 }
 
 void cm_optional_program_stop()	
 { 
-	float value[AXES] = { (float)MACHINE_PROGRAM_STOP, 0,0,0,0,0 };
-	mp_queue_command(_exec_program_finalize, value, value);
+	float value[AXES] = { (float)MACHINE_PROGRAM_STOP };
+	mp_queue_stop_command(_exec_program_finalize, value, value);
 }
 
 void cm_program_end()
 {
-	float value[AXES] = { (float)MACHINE_PROGRAM_END, 0,0,0,0,0 };
-	mp_queue_command(_exec_program_finalize, value, value);
+	float value[AXES] = { (float)MACHINE_PROGRAM_END };
+	mp_queue_stop_command(_exec_program_finalize, value, value);
+}
+
+/*
+ * Job restart
+ *
+ * cm_seek_block()	  - count a block. TRUE if it comes before the restart line
+ * cm_seek_outputs()  - record the spindle, coolant and tool words of a skipped block
+ * cm_seek_motion()	  - take the model to the end of a skipped move
+ * cm_seek_position() - ...or to a position in machine coordinates (G28, G30)
+ * _seek_resume()	  - set the recorded outputs and approach the restart point
+ * _seek_approach()	  - queue one approach move
+ *
+ *	A job that stopped part way through (a broken tool, a power cut) is restarted by 
+ *	setting $rsl to the line to restart at and sending the job - or running it from the
+ *	file device - from the beginning. The blocks before that line are parsed and only
+ *	update the model: modal state, offsets, G28/G30 positions and the model position. 
+ *	Nothing is queued but offset changes, so they run at parser speed. Lines are 
+ *	matched by their N word or their line in a stored job; a stream without N words 
+ *	is counted from the first block after $rsl was set. 
+ *
+ *	Moves, arcs and canned cycles (which end over their last hole at the retract level)
+ *	set the position. Spindle, coolant and tool words are recorded. Dwells, stops,
+ *	homing, probing and G28.3 are skipped - a job that probes for its offsets must set
+ *	them again by hand. When the restart line arrives the recorded outputs are set and
+ *	the machine approaches the point the line starts from: up in Z to $rsz (machine 
+ *	coordinates) or the higher of where it is and where it is going, across to the 
+ *	point, and down at the program's feed rate. The restart line then runs as usual. 
+ *	{"rsl":0} cancels the seek - a queue flush doesn't, as the flush a host connection
+ *	starts with may run after the host has set $rsl.
+ */
+uint8_t cm_seek_block(uint32_t linenum)
+{
+	if (cm.seek_line == 0) { return (false);}
+	cm.seek_blocks++;
+	if (((linenum != 0) ? linenum : cm.seek_blocks) < cm.seek_line) { return (true);}
+	cm.seek_line = 0;
+	_seek_resume();
+	return (false);
+}
+
+void cm_seek_outputs()
+{
+	if (fp_TRUE(gf.spindle_speed)) { spindle.programmed_speed = gn.spindle_speed;}
+	if (gf.tool_select == true) { cm.seek_tool_select = gn.tool_select;}
+	if (gf.tool_change == true) { cm.seek_tool = cm.seek_tool_select;}
+	if (gf.spindle_mode == true) { spindle.programmed_mode = gn.spindle_mode;}
+	if (gf.mist_coolant == true) { cm.seek_mist_coolant = gn.mist_coolant;}
+	if (gf.flood_coolant == true) {
+		cm.seek_flood_coolant = gn.flood_coolant;
+		if (gn.flood_coolant == false) { cm.seek_mist_coolant = false;}	// M9
+	}
+}
+
+void cm_seek_motion(float target[], float flags[], uint8_t motion_mode)
+{
+	gm.motion_mode = motion_mode;
+	cm_set_model_target(target, flags);
+	copy_axis_vector(gmx.position, gm.target);
+}
+
+void cm_seek_position(float position[])
+{
+	copy_axis_vector(gm.target, position);
+	copy_axis_vector(gmx.position, position);
+}
+
+static void _seek_resume()
+{
+	float resume[AXES];
+	copy_axis_vector(resume, gmx.position);			// where the restart line starts from
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		gmx.position[axis] = mp_get_runtime_absolute_position(axis);	// where the machine is
+		gm.target[axis] = gmx.position[axis];
+	}
+	gm.tool_select = cm.seek_tool_select;			// the tool is in - no M6 stop
+	gm.tool = cm.seek_tool;
+	cm_set_spindle_speed(spindle.programmed_speed);
+	cm_spindle_control(spindle.programmed_mode);
+	cm_flood_coolant_control(cm.seek_flood_coolant);
+	cm_mist_coolant_control(cm.seek_mist_coolant);
+
+	float target[AXES];
+	copy_axis_vector(target, gmx.position);
+	target[AXIS_Z] = max3(cm.restart_clearance, gmx.position[AXIS_Z], resume[AXIS_Z]);
+	_seek_approach(target, MOTION_MODE_STRAIGHT_TRAVERSE);
+	copy_axis_vector(target, resume);
+	target[AXIS_Z] = gmx.position[AXIS_Z];
+	_seek_approach(target, MOTION_MODE_STRAIGHT_TRAVERSE);
+	_seek_approach(resume, MOTION_MODE_STRAIGHT_FEED);
+}
+
+static void _seek_approach(float target[], uint8_t motion_mode)
+{
+	if (vector_equal(target, gmx.position)) { return;}
+	uint8_t program_motion_mode = gm.motion_mode;
+	uint8_t inverse_feed_rate_mode = gm.inverse_feed_rate_mode;
+	float feed_rate = gm.feed_rate;
+
+	gm.motion_mode = motion_mode;
+	gm.inverse_feed_rate_mode = false;				// G93 - feed in at the Z maximum
+	if ((inverse_feed_rate_mode == true) || fp_ZERO(gm.feed_rate)) { 
+		gm.feed_rate = cm.a[AXIS_Z].feedrate_max;
+	}
+	copy_axis_vector(gm.target, target);
+	cm_set_work_offsets(&gm);
+	cm_set_move_times(&gm);
+	cm_cycle_start();
+	cm_conditional_set_model_position(mp_aline(&gm));
+
+	gm.motion_mode = program_motion_mode;
+	gm.inverse_feed_rate_mode = inverse_feed_rate_mode;
+	gm.feed_rate = feed_rate;
 }
 
 /**************************************
@@ -1474,7 +2224,21 @@ static const char msg_g01[] PROGMEM = "G1  - linear feed";
 static const char msg_g02[] PROGMEM = "G2  - clockwise arc feed";
 static const char msg_g03[] PROGMEM = "G3  - counter clockwise arc feed";
 static const char msg_g80[] PROGMEM = "G80 - cancel motion mode (none active)";
-static const char *const msg_momo[] PROGMEM = { msg_g00, msg_g01, msg_g02, msg_g03, msg_g80 };
+static const char msg_g382[] PROGMEM = "G38.2 - straight probe";
+static const char msg_g81[] PROGMEM = "G81 - drilling cycle";
+static const char msg_g82[] PROGMEM = "G82 - drilling cycle with dwell";
+static const char msg_g83[] PROGMEM = "G83 - peck drilling cycle";
+static const char msg_g84[] PROGMEM = "G84 - tapping cycle";
+static const char msg_g85[] PROGMEM = "G85 - boring cycle";
+static const char msg_g86[] PROGMEM = "G86 - boring cycle, spindle stop";
+static const char msg_g87[] PROGMEM = "G87 - back boring cycle";
+static const char msg_g88[] PROGMEM = "G88 - boring cycle, manual out";
+static const char msg_g89[] PROGMEM = "G89 - boring cycle with dwell";
+static const char msg_g33[] PROGMEM = "G33 - spindle synchronized motion";
+static const char msg_g05[] PROGMEM = "G5  - cubic spline feed";
+static const char msg_g051[] PROGMEM = "G5.1 - quadratic spline feed";
+static const char *const msg_momo[] PROGMEM = { msg_g00, msg_g01, msg_g02, msg_g03, msg_g80, msg_g382, 
+	msg_g81, msg_g82, msg_g83, msg_g84, msg_g85, msg_g86, msg_g87, msg_g88, msg_g89, msg_g33, msg_g05, msg_g051 };
 
 static const char msg_g17[] PROGMEM = "G17 - XY plane";
 static const char msg_g18[] PROGMEM = "G18 - XZ plane";
@@ -1524,7 +2288,7 @@ static const char *const msg_frmo[] PROGMEM = { msg_g94, msg_g93 };
 char_t cm_get_axis_char(const int8_t axis)
 {
 	char_t axis_char[] = "XYZABC";
-	if ((axis < 0) || (axis > AXES)) return (' ');
+	if ((axis < 0) || (axis >= AXES)) return (' ');
 	return (axis_char[axis]);
 }
 
@@ -1534,7 +2298,7 @@ static int8_t _get_axis(const index_t index)
 	char_t tmp[CMD_TOKEN_LEN+1];
 	char_t axes[] = {"xyzabc"};
 
-	strcpy_P(tmp, cfgArray[index].token);			// kind of a hack. Looks for an axis
+	strcpy_P(tmp, cfgTokens[index].token);			// kind of a hack. Looks for an axis
 	if ((ptr = strchr(axes, tmp[0])) == NULL) { 	// character in the 0 and 3 positions
 		if ((ptr = strchr(axes, tmp[3])) == NULL) { // to accommodate 'xam' and 'g54x' styles
 			return (-1);
@@ -1588,7 +2352,11 @@ stat_t _get_msg_helper(cmdObj_t *cmd, const char *const msg_array[], uint8_t val
 {
 	cmd->value = (float)value;
 	cmd->objtype = TYPE_INTEGER;
-	return(cmd_copy_string(cmd, (const char_t *)GET_TEXT_ITEM(msg_array, value)));
+#ifdef __AVR
+	return(cmd_copy_string(cmd, (const char_t *)GET_TEXT_ITEM(msg_array, value)));	// text is in shared_buf
+#else
+	return(cmd_link_string(cmd, (const char_t *)GET_TEXT_ITEM(msg_array, value)));	// text is in flash
+#endif
 }
 
 stat_t cm_get_stat(cmdObj_t *cmd) { return(_get_msg_helper(cmd, msg_stat, cm_get_combined_state()));}
@@ -1635,7 +2403,7 @@ stat_t cm_get_vel(cmdObj_t *cmd)
 		cmd->value = mp_get_runtime_velocity();
 		if (cm_get_units_mode(RUNTIME) == INCHES) cmd->value *= INCH_PER_MM;
 	}
-	cmd->precision = GET_TABLE_WORD(precision);
+	cmd->precision = GET_TABLE_BYTE(precision);
 	cmd->objtype = TYPE_FLOAT;
 	return (STAT_OK);
 }
@@ -1643,7 +2411,7 @@ stat_t cm_get_vel(cmdObj_t *cmd)
 stat_t cm_get_pos(cmdObj_t *cmd) 
 {
 	cmd->value = cm_get_work_position(ACTIVE_MODEL, _get_axis(cmd->index));
-	cmd->precision = GET_TABLE_WORD(precision);
+	cmd->precision = GET_TABLE_BYTE(precision);
 	cmd->objtype = TYPE_FLOAT;
 	return (STAT_OK);
 }
@@ -1651,7 +2419,7 @@ stat_t cm_get_pos(cmdObj_t *cmd)
 stat_t cm_get_mpo(cmdObj_t *cmd) 
 {
 	cmd->value = cm_get_absolute_position(RUNTIME, _get_axis(cmd->index));
-	cmd->precision = GET_TABLE_WORD(precision);
+	cmd->precision = GET_TABLE_BYTE(precision);
 	cmd->objtype = TYPE_FLOAT;
 	return (STAT_OK);
 }
@@ -1659,7 +2427,7 @@ stat_t cm_get_mpo(cmdObj_t *cmd)
 stat_t cm_get_ofs(cmdObj_t *cmd) 
 {
 	cmd->value = cm_get_work_offset(ACTIVE_MODEL, _get_axis(cmd->index));
-	cmd->precision = GET_TABLE_WORD(precision);
+	cmd->precision = GET_TABLE_BYTE(precision);
 	cmd->objtype = TYPE_FLOAT;
 	return (STAT_OK);
 }
@@ -1669,6 +2437,7 @@ stat_t cm_get_ofs(cmdObj_t *cmd)
  *
  * cm_get_am()	- get axis mode w/enumeration string
  * cm_set_am()	- set axis mode w/exception handling for axis type
+ * cm_set_bl()	- set backlash and rebuild the motor map that carries it
  * cm_set_sw()	- run this any time you change a switch setting
  */
 
@@ -1686,9 +2455,137 @@ stat_t cm_set_am(cmdObj_t *cmd)		// axis mode
 		if (cmd->value > AXIS_MODE_MAX_ROTARY) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
 	}
 	set_ui8(cmd);
+	_set_junction_terms();
+	ik_update_motor_map();
+	return(STAT_OK);
+}
+
+stat_t cm_set_bl(cmdObj_t *cmd)		// backlash - the take-up steps are worked out in the motor map
+{
+	if (cmd->value < 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if (_get_axis_type(cmd->index) == 0) {	// linear
+		set_flu(cmd);
+	} else {
+		set_flt(cmd);
+	}
+	ik_update_motor_map();
+	return(STAT_OK);
+}
+
+stat_t cm_set_cofs(cmdObj_t *cmd)	// coordinate system offset - $g54x etc.
+{
+	set_flu(cmd);
+	cm_offsets_changed();
+	return(STAT_OK);
+}
+
+/*
+ * cm_set_jd()	- set junction deviation
+ *
+ *	_get_junction_vmax() runs for every new block, so the squared deviations and the 
+ *	list of axes that can corner are worked out here instead. Axis mode changes also 
+ *	call _set_junction_terms() as disabled and inhibited axes are left out of the list.
+ */
+
+stat_t cm_set_jd(cmdObj_t *cmd)
+{
+	if (_get_axis_type(cmd->index) == 0) {	// linear
+		set_flu(cmd);
+	} else {
+		set_flt(cmd);
+	}
+	_set_junction_terms();
+	return(STAT_OK);
+}
+
+static void _set_junction_terms()
+{
+	cm.junction_axes = 0;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		cm.junction_dev_sq[axis] = square(cm.a[axis].junction_dev);
+		if ((cm.a[axis].axis_mode == AXIS_DISABLED) || (cm.a[axis].axis_mode == AXIS_INHIBITED)) continue;
+		cm.junction_axis[cm.junction_axes++] = axis;
+	}
+}
+
+/*
+ * cm_set_vm()	- set velocity maximum
+ * cm_set_fr()	- set feedrate maximum
+ * cm_set_ra()	- set rotary axis radius
+ * cm_set_move_terms() - derive the move time terms from the axis and motor settings
+ *
+ *	cm_set_move_times() and cm_set_model_target() run for every block, so the divisions
+ *	by these settings are done here once and kept in the cm struct.
+ *
+ *	The velocity and feedrate maximums are also held to the step rate limit - the
+ *	velocity at which the axis' motor with the most steps per unit steps at 
+ *	ST_STEP_RATE_MAX (see stepper.h). Move times are taken from the lower of the two,
+ *	so cruise velocities never ask a motor for more steps than the DDA can give. 
+ *	$xvs reports the limit, and setting a maximum over it warns. Called again by
+ *	ik_update_motor_map() when a motor's map or steps per unit changes.
+ */
+
+static stat_t _set_axis_flu(cmdObj_t *cmd)
+{
+	if (_get_axis_type(cmd->index) == 0) {	// linear
+		return (set_flu(cmd));
+	}
+	return (set_flt(cmd));
+}
+
+static void _warn_step_rate(cmdObj_t *cmd)
+{
+	uint8_t axis = _get_axis(cmd->index);
+	float limit = cm.step_velocity_max[axis];
+	if ((limit > EPSILON) && (max(cm.a[axis].velocity_max, cm.a[axis].feedrate_max) > limit)) {
+		cmd_add_conditional_message((const char_t *)"*** WARNING *** Over the step rate limit - see $xvs");
+	}
+}
+
+stat_t cm_set_vm(cmdObj_t *cmd)
+{
+	_set_axis_flu(cmd);
+	cm_set_move_terms();
+	_warn_step_rate(cmd);
+	return(STAT_OK);
+}
+
+stat_t cm_set_fr(cmdObj_t *cmd)
+{
+	_set_axis_flu(cmd);
+	cm_set_move_terms();
+	_warn_step_rate(cmd);
+	return(STAT_OK);
+}
+
+stat_t cm_set_ra(cmdObj_t *cmd)
+{
+	set_flt(cmd);
+	cm_set_move_terms();
 	return(STAT_OK);
 }
 
+void cm_set_move_terms()
+{
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		float steps_per_unit = 0;
+		for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) {
+			if (st.m[motor].motor_map == axis) { steps_per_unit = max(steps_per_unit, st.m[motor].steps_per_unit);}
+		}
+		float velocity_max = cm.a[axis].velocity_max;
+		float feedrate_max = cm.a[axis].feedrate_max;
+		cm.step_velocity_max[axis] = 0;						// no motor - no limit
+		if (steps_per_unit > EPSILON) {
+			cm.step_velocity_max[axis] = ST_STEP_RATE_MAX * 60 / steps_per_unit;
+			velocity_max = min(velocity_max, cm.step_velocity_max[axis]);
+			feedrate_max = min(feedrate_max, cm.step_velocity_max[axis]);
+		}
+		cm.recip_velocity_max[axis] = 1 / velocity_max;
+		cm.recip_feedrate_max[axis] = 1 / feedrate_max;
+		cm.radius_factor[axis] = 360 / (2 * M_PI * cm.a[axis].radius);
+	}
+}
+
 /*
  * cm_get_jrk()	- get jerk value 
  * cm_set_jrk()	- set jerk value 
@@ -1724,12 +2621,122 @@ stat_t cm_run_qf(cmdObj_t *cmd)
 	return (STAT_OK);
 }
 
+/*
+ * cm_run_profw() - store the motion settings in effect in profile slot N
+ * cm_set_prof()  - select motion profile N ($prof=N, {"prof":N})
+ */
+
+stat_t cm_run_profw(cmdObj_t *cmd)
+{
+	uint8_t profile = (uint8_t)cmd->value;
+	if ((profile < 1) || (profile > MOTION_PROFILES)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	cmProfile_t *p = &cm.profile[profile-1];
+
+	p->junction_acceleration = cm.junction_acceleration;
+	p->junction_model = cm.junction_model;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		p->jerk_max[axis] = cm.a[axis].jerk_max;
+		p->junction_dev[axis] = cm.a[axis].junction_dev;
+		p->velocity_max[axis] = cm.a[axis].velocity_max;
+		p->feedrate_max[axis] = cm.a[axis].feedrate_max;
+		p->junction_dev_sq[axis] = cm.junction_dev_sq[axis];
+	}
+	p->stored = true;
+	cm.motion_profile = profile;			// the slot now matches the settings in effect
+	return (STAT_OK);
+}
+
+stat_t cm_set_prof(cmdObj_t *cmd)
+{
+	return (cm_select_motion_profile((uint8_t)cmd->value));
+}
+
 stat_t cm_run_home(cmdObj_t *cmd)
 {
 	if (fp_TRUE(cmd->value)) { cm_homing_cycle_start();}
 	return (STAT_OK);
 }
 
+/*
+ * cm_set_pvt() - queue a PVT point from the pvt group, e.g. {"pvt":{"x":10,"vx":600,"t":0.02}}
+ *
+ *	Axes left out of the group stay where they are, at zero velocity. JSON only.
+ */
+stat_t cm_set_pvt(cmdObj_t *cmd)
+{
+	if (cfg.comm_mode == TEXT_MODE) { return (STAT_UNRECOGNIZED_COMMAND);}
+	copy_axis_vector(cm.pvt_target, gmx.position);
+	for (uint8_t axis=0; axis<AXES; axis++) { cm.pvt_velocity[axis] = 0;}
+	cm.pvt_time = 0;
+	set_grp(cmd);
+	return (cm_pvt(cm.pvt_target, cm.pvt_velocity, cm.pvt_time));
+}
+
+/*
+ * cm_set_ras()  - queue a raster line from the ras group (see cm_raster()), e.g.
+ *				   {"ras":{"x":10,"y":5,"i":1,"j":0,"p":0.1,"f":3000,"d":"AECA/w=="}}
+ * cm_set_rasd() - decode the pixel levels, one byte a pixel in base64
+ *
+ *	x and y default to where the machine is, i and j to +X and f to the modal feed 
+ *	rate. The pixels are answered with their count rather than echoed. A 255 character
+ *	line carries about 130 pixels, so a longer scan is sent as several lines that go on
+ *	in the same direction. They run together at the feed rate. JSON only.
+ */
+static uint8_t _raster_pixels[RASTER_PIXELS_MAX];
+
+stat_t cm_set_ras(cmdObj_t *cmd)
+{
+	if (cfg.comm_mode == TEXT_MODE) { return (STAT_UNRECOGNIZED_COMMAND);}
+	cm.raster_start[0] = gmx.position[AXIS_X];
+	cm.raster_start[1] = gmx.position[AXIS_Y];
+	cm.raster_direction[0] = 1;
+	cm.raster_direction[1] = 0;
+	cm.raster_pitch = 0;
+	cm.raster_feed = 0;
+	cm.raster_count = 0;
+	set_grp(cmd);
+	return (cm_raster(cm.raster_start, cm.raster_direction, cm.raster_pitch, cm.raster_feed, 
+					  _raster_pixels, cm.raster_count));
+}
+
+stat_t cm_set_rasd(cmdObj_t *cmd)
+{
+	if (cmd->objtype != TYPE_STRING) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	uint16_t count = 0;
+	uint16_t bits = 0;
+	uint8_t nbits = 0;
+	for (char_t *rd = *cmd->stringp; (*rd != 0) && (*rd != '='); rd++) {
+		int8_t sextet = base64_value(*rd);
+		if (sextet < 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}	// no pixels - the line is refused
+		bits = (bits << 6) | sextet;
+		if ((nbits += 6) >= 8) {
+			if (count >= RASTER_PIXELS_MAX) { return (STAT_INPUT_EXCEEDS_MAX_LENGTH);}
+			nbits -= 8;
+			_raster_pixels[count++] = (uint8_t)(bits >> nbits);
+		}
+	}
+	cm.raster_count = count;
+	cmd->value = (float)count;
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+/*
+ * cm_set_rsl() - seek line n to restart the job from it (see Job restart). 0 cancels
+ */
+stat_t cm_set_rsl(cmdObj_t *cmd)
+{
+	if (cmd->value < 0) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+	if (cm.machine_state == MACHINE_CYCLE) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	cm.seek_line = (uint32_t)cmd->value;
+	cm.seek_blocks = 0;
+	cm.seek_tool_select = gm.tool_select;			// outputs as they are now
+	cm.seek_tool = gm.tool;
+	cm.seek_mist_coolant = gm.mist_coolant;
+	cm.seek_flood_coolant = gm.flood_coolant;
+	return (STAT_OK);
+}
+
 /***********************************************************************************
  * TEXT MODE SUPPORT
  * Functions to print variables from the cfgArray table
@@ -1795,16 +2802,40 @@ void cm_print_gdi(cmdObj_t *cmd) { text_print_int(cmd, fmt_gdi);}
 /* system state print functions */
 
 const char fmt_ja[] PROGMEM = "[ja]  junction acceleration%8.0f%s\n";
+const char fmt_jmo[] PROGMEM = "[jmo] junction model%19d [0=deviation,1=jerk]\n";
+const char fmt_rmo[] PROGMEM = "[rmo] rapid mode%23d [0=straight,1=dogleg]\n";
 const char fmt_ct[] PROGMEM = "[ct]  chordal tolerance%16.3f%s\n";
+const char fmt_cot[] PROGMEM = "[cot] coalesce tolerance%15.3f%s\n";
+const char fmt_aft[] PROGMEM = "[aft] arc fit tolerance%16.3f%s\n";
+const char fmt_prof[] PROGMEM = "[prof] motion profile%18d\n";
+const char fmt_rsl[] PROGMEM = "[rsl] restart line%22lu\n";
+const char fmt_rsz[] PROGMEM = "[rsz] restart clearance Z%14.3f%s\n";
+const char fmt_jgt[] PROGMEM = "[jgt] jog timeout%23lu ms [0=no jogging]\n";
+const char fmt_sqt[] PROGMEM = "[sqt] starve queue time%17lu ms [0=off]\n";
+const char fmt_pbs[] PROGMEM = "[pbs] planner batch size%16d blocks [0=off]\n";
 const char fmt_ml[] PROGMEM = "[ml]  min line segment%17.3f%s\n";
 const char fmt_ma[] PROGMEM = "[ma]  min arc segment%18.3f%s\n";
 const char fmt_ms[] PROGMEM = "[ms]  min segment time%13.0f uSec\n";
+const char fmt_msb[] PROGMEM = "[msb] body segment time%12.0f uSec\n";
+const char fmt_mse[] PROGMEM = "[mse] segment velocity error%7.0f%s/min\n";
 
 void cm_print_ja(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_ja, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_jmo(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_jmo);}
+void cm_print_rmo(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_rmo);}
 void cm_print_ct(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_ct, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_cot(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_cot, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_aft(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_aft, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_prof(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_prof);}
+void cm_print_rsl(cmdObj_t *cmd) { text_print_int(cmd, fmt_rsl);}
+void cm_print_rsz(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_rsz, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_jgt(cmdObj_t *cmd) { text_print_int(cmd, fmt_jgt);}
+void cm_print_sqt(cmdObj_t *cmd) { text_print_int(cmd, fmt_sqt);}
+void cm_print_pbs(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_pbs);}
 void cm_print_ml(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_ml, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ma(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_ma, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ms(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_ms, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_msb(cmdObj_t *cmd) { text_print_flt(cmd, fmt_msb);}
+void cm_print_mse(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_mse, GET_UNITS(ACTIVE_MODEL));}
 
 /*
  * axis print functions
@@ -1816,6 +2847,7 @@ void cm_print_ms(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_ms, GET_UNITS(AC
  *	cm_print_am()
  *	cm_print_fr()
  *	cm_print_vm()
+ *	cm_print_vs()
  *	cm_print_tm()
  *	cm_print_jm()
  *	cm_print_jh()
@@ -1826,6 +2858,8 @@ void cm_print_ms(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_ms, GET_UNITS(AC
  *	cm_print_lv()
  *	cm_print_lb()
  *	cm_print_zb()
+ *	cm_print_hg()
+ *	cm_print_bl()
  *
  *	cm_print_pos() - print position with unit displays for MM or Inches
  * 	cm_print_mpo() - print position with fixed unit display - always in Degrees or MM
@@ -1834,6 +2868,7 @@ void cm_print_ms(cmdObj_t *cmd) { text_print_flt_units(cmd, fmt_ms, GET_UNITS(AC
 const char fmt_Xam[] PROGMEM = "[%s%s] %s axis mode%18d %s\n";
 const char fmt_Xfr[] PROGMEM = "[%s%s] %s feedrate maximum%15.3f%s/min\n";
 const char fmt_Xvm[] PROGMEM = "[%s%s] %s velocity maximum%15.3f%s/min\n";
+const char fmt_Xvs[] PROGMEM = "[%s%s] %s step rate velocity%13.3f%s/min [0=no motor]\n";
 const char fmt_Xtm[] PROGMEM = "[%s%s] %s travel maximum%17.3f%s\n";
 const char fmt_Xjm[] PROGMEM = "[%s%s] %s jerk maximum%15.0f%s/min^3 * 1 million\n";
 const char fmt_Xjh[] PROGMEM = "[%s%s] %s jerk homing%16.0f%s/min^3 * 1 million\n";
@@ -1845,6 +2880,8 @@ const char fmt_Xsv[] PROGMEM = "[%s%s] %s search velocity%16.3f%s/min\n";
 const char fmt_Xlv[] PROGMEM = "[%s%s] %s latch velocity%17.3f%s/min\n";
 const char fmt_Xlb[] PROGMEM = "[%s%s] %s latch backoff%18.3f%s\n";
 const char fmt_Xzb[] PROGMEM = "[%s%s] %s zero backoff%19.3f%s\n";
+const char fmt_Xhg[] PROGMEM = "[%s%s] %s homing group%17d [0=alone,1-3=home together]\n";
+const char fmt_Xbl[] PROGMEM = "[%s%s] %s backlash%23.4f%s\n";
 const char fmt_cofs[] PROGMEM = "[%s%s] %s %s offset%20.3f%s\n";
 const char fmt_cpos[] PROGMEM = "[%s%s] %s %s position%18.3f%s\n";
 
@@ -1891,6 +2928,7 @@ void cm_print_am(cmdObj_t *cmd)	// print axis mode with enumeration string
 
 void cm_print_fr(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xfr);}
 void cm_print_vm(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xvm);}
+void cm_print_vs(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xvs);}
 void cm_print_tm(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xtm);}
 void cm_print_jm(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xjm);}
 void cm_print_jh(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xjh);}
@@ -1902,6 +2940,8 @@ void cm_print_sv(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xsv);}
 void cm_print_lv(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xlv);}
 void cm_print_lb(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xlb);}
 void cm_print_zb(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xzb);}
+void cm_print_hg(cmdObj_t *cmd) { _print_axis_ui8(cmd, fmt_Xhg);}
+void cm_print_bl(cmdObj_t *cmd) { _print_axis_flt(cmd, fmt_Xbl);}
 
 void cm_print_cofs(cmdObj_t *cmd) { _print_axis_coord_flt(cmd, fmt_cofs);}
 void cm_print_cpos(cmdObj_t *cmd) { _print_axis_coord_flt(cmd, fmt_cpos);}
@@ -40,10 +40,17 @@ extern "C"{
 /* Defines */
 
 #define MODEL 	(GCodeState_t *)&gm			// absolute pointer from canonical machine gm model
-#define PLANNER (GCodeState_t *)&bf->gm		// relative to buffer *bf is currently pointing to
+#define PLANNER (GCodeState_t *)bf->gm		// relative to buffer *bf is currently pointing to
 #define RUNTIME (GCodeState_t *)&mr.gm		// absolute pointer from runtime mm struct
 #define ACTIVE_MODEL cm.am					// active model pointer is maintained by state management
 
+#ifndef CANNED_CYCLE_PECK_CLEARANCE
+#define CANNED_CYCLE_PECK_CLEARANCE 0.25	// mm above the last peck depth to rapid back down to (G83)
+#endif
+#ifndef PROBE_TOUCHES
+#define PROBE_TOUCHES 3						// slow touches G38.7 makes without an L word
+#endif
+
 /*****************************************************************************
  * CANONICAL MACHINE STRUCTURES
  */
@@ -61,8 +68,64 @@ typedef struct cmAxis {
 	float latch_velocity;			// homing latch velocity
 	float latch_backoff;			// backoff from switches prior to homing latch movement
 	float zero_backoff;				// backoff from switches for machine zero
+	uint8_t homing_group;			// 0 = home on its own, 1-3 = home with the other axes of the group
+	float backlash;					// taken up by the runtime on reversal - see kinematics.h
 } cfgAxis_t;
 
+enum cmJunctionModel {					// how corner velocities are limited ($jmo) - see _get_junction_vmax()
+	JUNCTION_MODEL_DEVIATION = 0,		// centripetal acceleration around a junction deviation radius
+	JUNCTION_MODEL_JERK					// each axis' velocity step within its jerk and acceleration over a segment
+};
+
+enum cmRapidMode {						// how G0 moves the axes ($rmo) - see mp_dogleg()
+	RAPID_MODE_STRAIGHT = 0,			// a straight line, as a feed
+	RAPID_MODE_DOGLEG					// each axis at its own velocity and jerk, finishing when it gets there
+};
+
+/*
+ * MOTION PROFILES - switch jerk, cornering and velocity limits mid-program
+ *
+ *	Roughing and finishing want different limits, and changing them with $ settings
+ *	means a string of config writes (each persisted) between moves. Instead the 
+ *	current axis jerk, junction deviation, velocity and feed rate maximums, and the
+ *	junction acceleration and model, can be stored in a profile slot with $profw=N, and put 
+ *	back with M150 PN, $prof=N or {"prof":N}. 
+ *
+ *	A profile carries the terms derived from its settings (see cm_set_jd() and 
+ *	cm_set_vm()), so selecting one is only copies. The planner reads these settings
+ *	as it plans each block, so the change takes effect at the next block, without
+ *	waiting for the queue to drain. Blocks already queued keep their own limits.
+ *
+ *	The selected profile's settings are what $xjm etc. show. Selecting a profile 
+ *	doesn't write them to NVM, and the slots themselves are not persisted - a reset 
+ *	goes back to the saved settings and empty slots. Store the normal settings in a 
+ *	slot too to be able to switch back to them.
+ */
+#ifndef MOTION_PROFILES
+#define MOTION_PROFILES 3				// profile slots - 1 to MOTION_PROFILES
+#endif
+
+typedef struct cmProfile {				// a stored motion profile
+	uint8_t stored;						// true once $profw has filled the slot
+	uint8_t junction_model;
+	float junction_acceleration;
+	float jerk_max[AXES];
+	float junction_dev[AXES];
+	float velocity_max[AXES];
+	float feedrate_max[AXES];
+	float junction_dev_sq[AXES];		// derived term
+} cmProfile_t;
+
+#define JOG_FRAME_START 0x12			// DC2 (^r) starts a jog frame (see Jogging in canonical_machine.cpp)
+#define JOG_MASK_UNREAD 0xFF			// the frame's axis mask hasn't come in yet
+
+typedef struct cmJogFrame {				// a jog frame being read from an input device
+	uint8_t pending;					// bytes still to come - 0 between frames
+	uint8_t mask;						// axes the frame has velocities for
+	uint8_t axis;						// next axis in the mask to take one
+	int8_t velocity[AXES];				// 127ths of the axis $xfr
+} cmJogFrame_t;
+
 typedef struct cmSingleton {		// struct to manage cm globals and cycles
 	magic_t magic_start;			// magic number to test memory integity	
 
@@ -70,12 +133,22 @@ typedef struct cmSingleton {		// struct to manage cm globals and cycles
 
 	// system group settings
 	float junction_acceleration;	// centripetal acceleration max for cornering
+	uint8_t junction_model;			// cmJunctionModel - how corners are limited
+	uint8_t rapid_mode;				// cmRapidMode - how G0 moves the axes
 	float chordal_tolerance;		// arc chordal accuracy setting in mm
+	float coalesce_tolerance;		// path deviation allowed when merging collinear feeds (0 = off)
+	float arc_fit_tolerance;		// path deviation allowed when fitting feeds to an arc (0 = off)
+	float restart_clearance;		// machine Z a job restart approaches at ($rsz - see cm_seek_block())
+	uint32_t jog_timeout;			// ms jog velocities hold without a new frame - 0 is no jogging ($jgt)
+	uint32_t starve_queue_time;		// ms of queued motion the feed is slowed to keep - 0 is off ($sqt)
+	uint8_t plan_batch;				// most blocks arriving together planned in one pass - 0 or 1 is off ($pbs)
 
 	// hidden system settings
 	float min_segment_len;			// line drawing resolution in mm
 	float arc_segment_len;			// arc drawing resolution in mm
 	float estd_segment_usec;		// approximate segment time in microseconds
+	float body_segment_usec;		// segment time for cruise sections in microseconds
+	float segment_velocity_error;	// max velocity step between head & tail segments
 
 	// gcode power-on default settings - defaults are not the same as the gm state
 	uint8_t coord_system;			// G10 active coordinate system default
@@ -90,6 +163,21 @@ typedef struct cmSingleton {		// struct to manage cm globals and cycles
 	// settings for axes X,Y,Z,A B,C
 	cfgAxis_t a[AXES];
 
+	// junction deviation terms derived from the axis settings - see cm_set_jd()
+	float junction_dev_sq[AXES];	// square of each axis junction deviation
+	uint8_t junction_axis[AXES];	// axes that participate in cornering (not disabled or inhibited)
+	uint8_t junction_axes;			// number of entries in junction_axis[]
+
+	// move time terms derived from the axis settings - see cm_set_move_terms()
+	float step_velocity_max[AXES];	// velocity at ST_STEP_RATE_MAX on the axis' motors - 0 if it has none
+	float recip_velocity_max[AXES];	// 1 / velocity_max, or the step rate limit if lower
+	float recip_feedrate_max[AXES];	// 1 / feedrate_max, or the step rate limit if lower
+	float radius_factor[AXES];		// degrees per mm for ABC axes in radius mode - 360 / (2 pi radius)
+
+	// motion profiles - see MOTION PROFILES above
+	cmProfile_t profile[MOTION_PROFILES];
+	uint8_t motion_profile;			// profile selected last - 0 if none
+
 	/**** Runtime variables (PRIVATE) ****/
 
 	uint8_t combined_state;			// stat: combination of states for display purposes
@@ -105,6 +193,23 @@ typedef struct cmSingleton {		// struct to manage cm globals and cycles
 	uint8_t feedhold_requested;		// feedhold character has been received
 	uint8_t queue_flush_requested;	// queue flush character has been received
 	uint8_t cycle_start_requested;	// cycle start character has been received (flag to end feedhold)
+	float pvt_target[AXES];			// PVT point being read in (see cm_set_pvt())
+	float pvt_velocity[AXES];
+	float pvt_time;
+	volatile float jog_velocity[AXES];// jog velocities in mm/min - set from the input interrupts (see cm_request_jog())
+	volatile uint32_t jog_tick;		// SysTick ms they were set
+	volatile uint8_t jog_ended;		// the runtime has ended a jog - the model hasn't taken up its position
+	float raster_start[2];			// raster line being read in (see cm_set_ras()) - X and Y
+	float raster_direction[2];
+	float raster_pitch;
+	float raster_feed;
+	uint32_t raster_count;			// pixels decoded by cm_set_rasd()
+	uint32_t seek_line;				// line a job restart is seeking - 0 if none ($rsl)
+	uint32_t seek_blocks;			// blocks counted since the seek started
+	uint8_t seek_tool_select;		// outputs the blocks skipped by the seek left set...
+	uint8_t seek_tool;
+	uint8_t seek_mist_coolant;
+	uint8_t seek_flood_coolant;		// ...spindle speed and mode are in spindle.programmed_*
 	struct GCodeState *am;			// active Gcode model is maintained by state management
 
 	magic_t magic_end;
@@ -152,6 +257,7 @@ typedef struct cmSingleton {		// struct to manage cm globals and cycles
 	float feed_rate; 					// F - normalized to millimeters/minute
 	float spindle_speed;				// in RPM
 	float parameter;					// P - parameter used for dwell time in seconds, G10 coord select...
+	float spindle_sync;					// G33, G84 - spindle RPM the move is planned for, 0 if not synchronized
 
 	uint8_t inverse_feed_rate_mode;		// G93 TRUE = inverse, FALSE = normal (G94)
 	uint8_t select_plane;				// G17,G18,G19 - values to set plane to
@@ -159,6 +265,7 @@ typedef struct cmSingleton {		// struct to manage cm globals and cycles
 	uint8_t coord_system;				// G54-G59 - select coordinate system 1-9
 	uint8_t absolute_override;			// G53 TRUE = move using machine coordinates - this block only (G53)
 	uint8_t path_control;				// G61... EXACT_PATH, EXACT_STOP, CONTINUOUS
+	float path_tolerance;				// G64 P - corner blending tolerance in mm (0 = sharp corners)
 	uint8_t distance_mode;				// G91   0=use absolute coords(G90), 1=incremental movement
 	uint8_t tool;						// M6 tool change - moves "tool_select" to "tool"
 	uint8_t tool_select;				// T value - T sets this value
@@ -191,12 +298,22 @@ typedef struct GCodeStateExtended {		// Gcode dynamic state extensions - used by
 	uint8_t origin_offset_enable;		// G92 offsets enabled/disabled.  0=disabled, 1=enabled
 	uint8_t block_delete_switch;		// set true to enable block deletes (true is default)
 
+	uint8_t active_offset_valid;		// FALSE once anything in active_offset has changed - see cm_offsets_changed()
+	float active_offset[AXES];			// combined G5x + G92 offset in effect, 0 in absolute override
+	float units_scale;					// mm per programmed unit - 1 or MM_PER_INCH
+
 	float spindle_override_factor;		// 1.0000 x S spindle speed. Go up or down from there
 	uint8_t	spindle_override_enable;	// TRUE = override enabled
 
 	float arc_radius;					// R - radius value in arc radius mode
 	float arc_offset[3];  				// IJK - used by arc commands
 
+	uint8_t retract_mode;				// G98, G99 - canned cycle retract level
+	float cycle_r_plane;				// R - canned cycle R plane as programmed (mm) - sticky
+	float cycle_depth;					// Z - canned cycle hole depth as programmed (mm) - sticky
+	float cycle_peck_depth;				// Q - G83 peck increment (mm) - sticky
+	float cycle_dwell;					// P - G82 dwell at the bottom (seconds) - sticky
+
 // unimplemented gcode parameters
 //	float cutter_radius;				// D - cutter radius compensation (0 is off)
 //	float cutter_length;				// H - cutter length compensation (0 is off)
@@ -210,6 +327,7 @@ typedef struct GCodeInput {				// Gcode model inputs - meaning depends on contex
 	uint8_t motion_mode;				// Group1: G0, G1, G2, G3, G38.2, G80, G81,
 										// G82, G83 G84, G85, G86, G87, G88, G89 
 	uint8_t program_flow;				// used only by the gcode_parser
+	uint16_t setters;					// setter words in the block as GC_SET bits (GN only)
 	uint32_t linenum;					// N word or autoincrement in the model
 
 	float target[AXES]; 				// XYZABC where the move should go
@@ -242,11 +360,17 @@ typedef struct GCodeInput {				// Gcode model inputs - meaning depends on contex
 	float spindle_speed;				// in RPM
 	float spindle_override_factor;		// 1.0000 x S spindle speed. Go up or down from there
 	uint8_t	spindle_override_enable;	// TRUE = override enabled
+	uint8_t motion_profile;				// M150 flag - the profile is the P word
+	uint8_t sync_output;				// TRUE = on (M62), FALSE = off (M63) - the output is the P word
+	float output_time;					// E - M62, M63 time offset (ms)
 
 	float parameter;					// P - parameter used for dwell time in seconds, G10 coord select...
-	float arc_radius;					// R - radius value in arc radius mode
+	float arc_radius;					// R - radius value in arc radius mode, R plane in canned cycles
 	float arc_offset[3];  				// IJK - used by arc commands
 
+	uint8_t retract_mode;				// G98, G99 - canned cycle retract level
+	float peck_depth;					// Q - G83 peck increment
+
 // unimplemented gcode parameters
 //	float cutter_radius;				// D - cutter radius compensation (0 is off)
 //	float cutter_length;				// H - cutter length compensation (0 is off)
@@ -365,7 +489,9 @@ enum cmNextAction {						// these are in order to optimized CASE statement
 	NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS,	// G92.2
 	NEXT_ACTION_RESUME_ORIGIN_OFFSETS,	// G92.3
 	NEXT_ACTION_DWELL,					// G4
-	NEXT_ACTION_STRAIGHT_PROBE			// G38.2
+	NEXT_ACTION_STRAIGHT_PROBE,			// G38.2
+	NEXT_ACTION_PROBE_GRID,				// G38.6
+	NEXT_ACTION_PROBE_TOUCH				// G38.7
 };
 
 enum cmMotionMode {						// G Modal Group 1
@@ -383,7 +509,10 @@ enum cmMotionMode {						// G Modal Group 1
 	MOTION_MODE_CANNED_CYCLE_86,		// G86 - boring, spindle stop, rapid out
 	MOTION_MODE_CANNED_CYCLE_87,		// G87 - back boring
 	MOTION_MODE_CANNED_CYCLE_88,		// G88 - boring, spindle stop, manual out
-	MOTION_MODE_CANNED_CYCLE_89			// G89 - boring, dwell, feed out
+	MOTION_MODE_CANNED_CYCLE_89,		// G89 - boring, dwell, feed out
+	MOTION_MODE_SPINDLE_SYNC,			// G33 - spindle synchronized motion
+	MOTION_MODE_CUBIC_SPLINE,			// G5 - cubic spline feed
+	MOTION_MODE_QUADRATIC_SPLINE		// G5.1 - quadratic spline feed
 };
 
 enum cmModalGroup {						// Used for detecting gcode errors. See NIST section 3.4
@@ -442,6 +571,11 @@ enum cmDistanceMode {
 	INCREMENTAL_MODE				// G91
 };
 
+enum cmRetractMode {				// G Modal Group 9
+	RETRACT_TO_INITIAL_LEVEL = 0,	// G98 - retract to the higher of the start level and the R plane
+	RETRACT_TO_R_PLANE				// G99 - retract to the R plane
+};
+
 enum cmOriginOffset {
 	ORIGIN_OFFSET_SET=0,			// G92 - set origin offsets
 	ORIGIN_OFFSET_CANCEL,			// G92.1 - zero out origin offsets
@@ -513,12 +647,14 @@ void cm_set_spindle_speed_parameter(GCodeState_t *gcode_state, float speed);
 void cm_set_tool_number(GCodeState_t *gcode_state, uint8_t tool);
 void cm_set_absolute_override(GCodeState_t *gcode_state, uint8_t absolute_override);
 
+void cm_offsets_changed(void);
 float cm_get_active_coord_offset(uint8_t axis);
 float cm_get_work_offset(GCodeState_t *gcode_state, uint8_t axis);
 void cm_set_work_offsets(GCodeState_t *gcode_state);
 float cm_get_absolute_position(GCodeState_t *gcode_state, uint8_t axis);
 float cm_get_work_position(GCodeState_t *gcode_state, uint8_t axis);
 void cm_set_move_times(GCodeState_t *gcode_state);
+stat_t cm_test_soft_limits(const float target[]);
 
 void cm_set_model_arc_offset(float i, float j, float k);
 void cm_set_model_arc_radius(float r);
@@ -552,6 +688,10 @@ stat_t cm_probe_cycle_start(void);								// G38.2
 stat_t cm_probe_callback(void);									// G38.2 main loop callback
 int8_t cm_probe_get_axis(void);
 void cm_probe_set_position(float);
+stat_t cm_probe_grid_start(float target[], float flags[], float offset[]);// G38.6
+stat_t cm_probe_grid_callback(void);							// G38.6 main loop callback
+stat_t cm_probe_touch_start(float target[], float flags[], uint8_t touches);// G38.7
+stat_t cm_probe_touch_callback(void);							// G38.7 main loop callback
 
 stat_t cm_set_coord_system(uint8_t coord_system);				// G54 - G59
 stat_t cm_set_coord_offsets(uint8_t coord_system, float offset[], float flag[]); // G10 L2
@@ -564,12 +704,28 @@ stat_t cm_resume_origin_offsets(void);				 			// G92.3
 stat_t cm_straight_traverse(float target[], float flags[]);
 stat_t cm_set_feed_rate(float feed_rate);						// F parameter
 stat_t cm_set_inverse_feed_rate_mode(uint8_t mode);				// True= inv mode
-stat_t cm_set_path_control(uint8_t mode);						// G61, G61.1, G64
+stat_t cm_set_path_control(uint8_t mode, float tolerance);		// G61, G61.1, G64 Pn
 stat_t cm_straight_feed(float target[], float flags[]);			// G1
+stat_t cm_spindle_sync_feed(float target[], float flags[], float pitch);	// G33
 stat_t cm_arc_feed(float target[], float flags[], 				// G2, G3
 				   float i, float j, float k, 
 				   float radius, uint8_t motion_mode);
+stat_t cm_spline_feed(float target[], float flags[],				// G5, G5.1
+					  float i, float j, uint8_t ij_flag,
+					  float p, float q, uint8_t pq_flag, uint8_t motion_mode);
 stat_t cm_dwell(float seconds);									// G4, P parameter
+stat_t cm_pvt(float target[], float velocity[], float seconds);	// (no Gcode) PVT point
+stat_t cm_raster(float start[], float direction[], float pitch,	// (no Gcode) laser raster line
+				 float feed_rate, const uint8_t pixels[], uint16_t count);
+stat_t cm_set_retract_mode(uint8_t mode);						// G98, G99
+stat_t cm_canned_cycle(float target[], float flags[], uint8_t motion_mode);	// G81, G82, G83, G84
+stat_t cm_canned_cycle_callback(void);							// G81 - G83 main loop callback
+void cm_abort_canned_cycle(void);
+
+uint8_t cm_seek_block(uint32_t linenum);						// (no Gcode) job restart
+void cm_seek_outputs(void);
+void cm_seek_motion(float target[], float flags[], uint8_t motion_mode);
+void cm_seek_position(float position[]);
 
 // see spindle.h for spindle definitions - which would go right here
 
@@ -584,6 +740,10 @@ stat_t cm_traverse_override_factor(uint8_t flag);				// M50.3
 stat_t cm_spindle_override_enable(uint8_t flag); 				// M51
 stat_t cm_spindle_override_factor(uint8_t flag);				// M51.1
 
+stat_t cm_motion_profile(uint8_t flag);							// M150 Pn
+stat_t cm_sync_output(uint8_t state);							// M62, M63 Pn
+stat_t cm_select_motion_profile(uint8_t profile);
+
 stat_t cm_select_tool(uint8_t tool);							// T parameter
 stat_t cm_change_tool(uint8_t tool);							// M6
 
@@ -591,6 +751,10 @@ stat_t cm_change_tool(uint8_t tool);							// M6
 void cm_message(char_t *message);								// msg to console (e.g. Gcode comments)
 
 stat_t cm_feedhold_sequencing_callback(void);					// process feedhold, cycle start and queue flush requests
+uint8_t cm_jog_frame(cmJogFrame_t *f, const uint8_t c);			// read a jog frame - true if c was part of one
+void cm_request_jog(const float velocity[]);
+uint8_t cm_get_jog_velocity(float velocity[]);
+stat_t cm_jog_callback(void);									// start jogs and hold commands off while they run
 void cm_request_feedhold(void);
 void cm_request_queue_flush(void);
 void cm_request_cycle_start(void);
@@ -631,11 +795,24 @@ stat_t cm_get_ofs(cmdObj_t *cmd);		// get runtime work offset...
 
 stat_t cm_run_qf(cmdObj_t *cmd);		// run queue flush
 stat_t cm_run_home(cmdObj_t *cmd);		// start homing cycle
+stat_t cm_set_pvt(cmdObj_t *cmd);		// queue a PVT point
+stat_t cm_set_ras(cmdObj_t *cmd);		// queue a raster line
+stat_t cm_set_rasd(cmdObj_t *cmd);		// read the pixels of a raster line
+stat_t cm_set_rsl(cmdObj_t *cmd);		// start a job restart seek
+stat_t cm_run_profw(cmdObj_t *cmd);		// store the motion settings in a profile slot
+stat_t cm_set_prof(cmdObj_t *cmd);		// select a motion profile
 
 stat_t cm_get_am(cmdObj_t *cmd);		// get axis mode
 stat_t cm_set_am(cmdObj_t *cmd);		// set axis mode
 stat_t cm_get_jrk(cmdObj_t *cmd);		// get jerk with 1,000,000 correction
 stat_t cm_set_jrk(cmdObj_t *cmd);		// set jerk with 1,000,000 correction
+stat_t cm_set_jd(cmdObj_t *cmd);		// set junction deviation and derived terms
+stat_t cm_set_vm(cmdObj_t *cmd);		// set velocity max and derived terms
+stat_t cm_set_fr(cmdObj_t *cmd);		// set feedrate max and derived terms
+stat_t cm_set_ra(cmdObj_t *cmd);		// set rotary axis radius and derived terms
+void cm_set_move_terms(void);			// derive the move time terms - see cm_set_vm()
+stat_t cm_set_bl(cmdObj_t *cmd);		// set backlash
+stat_t cm_set_cofs(cmdObj_t *cmd);		// set a coordinate system offset
 
 /*--- text_mode support functions ---*/
 
@@ -670,15 +847,28 @@ stat_t cm_set_jrk(cmdObj_t *cmd);		// set jerk with 1,000,000 correction
 	void cm_print_mpo(cmdObj_t *cmd);		// print runtime work position always in MM uints
 
 	void cm_print_ja(cmdObj_t *cmd);		// global CM settings
+	void cm_print_jmo(cmdObj_t *cmd);
+	void cm_print_rmo(cmdObj_t *cmd);
 	void cm_print_ct(cmdObj_t *cmd);
+	void cm_print_cot(cmdObj_t *cmd);
+	void cm_print_aft(cmdObj_t *cmd);
+	void cm_print_prof(cmdObj_t *cmd);
+	void cm_print_rsl(cmdObj_t *cmd);
+	void cm_print_rsz(cmdObj_t *cmd);
+	void cm_print_jgt(cmdObj_t *cmd);
+	void cm_print_sqt(cmdObj_t *cmd);
+	void cm_print_pbs(cmdObj_t *cmd);
 	void cm_print_ml(cmdObj_t *cmd);
 	void cm_print_ma(cmdObj_t *cmd);
 	void cm_print_ms(cmdObj_t *cmd);
+	void cm_print_msb(cmdObj_t *cmd);
+	void cm_print_mse(cmdObj_t *cmd);
 	void cm_print_st(cmdObj_t *cmd);
 
 	void cm_print_am(cmdObj_t *cmd);		// axis print functions
 	void cm_print_fr(cmdObj_t *cmd);
 	void cm_print_vm(cmdObj_t *cmd);
+	void cm_print_vs(cmdObj_t *cmd);
 	void cm_print_tm(cmdObj_t *cmd);
 	void cm_print_jm(cmdObj_t *cmd);
 	void cm_print_jh(cmdObj_t *cmd);
@@ -690,6 +880,8 @@ stat_t cm_set_jrk(cmdObj_t *cmd);		// set jerk with 1,000,000 correction
 	void cm_print_lv(cmdObj_t *cmd);
 	void cm_print_lb(cmdObj_t *cmd);
 	void cm_print_zb(cmdObj_t *cmd);
+	void cm_print_hg(cmdObj_t *cmd);
+	void cm_print_bl(cmdObj_t *cmd);
 	void cm_print_cofs(cmdObj_t *cmd);
 	void cm_print_cpos(cmdObj_t *cmd);
 
@@ -724,15 +916,28 @@ stat_t cm_set_jrk(cmdObj_t *cmd);		// set jerk with 1,000,000 correction
 	#define cm_print_mpo tx_print_stub		// print runtime work position always in MM uints
 
 	#define cm_print_ja tx_print_stub		// global CM settings
+	#define cm_print_jmo tx_print_stub
+	#define cm_print_rmo tx_print_stub
 	#define cm_print_ct tx_print_stub
+	#define cm_print_cot tx_print_stub
+	#define cm_print_aft tx_print_stub
+	#define cm_print_prof tx_print_stub
+	#define cm_print_rsl tx_print_stub
+	#define cm_print_rsz tx_print_stub
+	#define cm_print_jgt tx_print_stub
+	#define cm_print_sqt tx_print_stub
+	#define cm_print_pbs tx_print_stub
 	#define cm_print_ml tx_print_stub
 	#define cm_print_ma tx_print_stub
 	#define cm_print_ms tx_print_stub
+	#define cm_print_msb tx_print_stub
+	#define cm_print_mse tx_print_stub
 	#define cm_print_st tx_print_stub
 
 	#define cm_print_am tx_print_stub		// axis print functions
 	#define cm_print_fr tx_print_stub
 	#define cm_print_vm tx_print_stub
+	#define cm_print_vs tx_print_stub
 	#define cm_print_tm tx_print_stub
 	#define cm_print_jm tx_print_stub
 	#define cm_print_jh tx_print_stub
@@ -744,6 +949,8 @@ stat_t cm_set_jrk(cmdObj_t *cmd);		// set jerk with 1,000,000 correction
 	#define cm_print_lv tx_print_stub
 	#define cm_print_lb tx_print_stub
 	#define cm_print_zb tx_print_stub
+	#define cm_print_hg tx_print_stub
+	#define cm_print_bl tx_print_stub
 	#define cm_print_cofs tx_print_stub
 	#define cm_print_cpos tx_print_stub
 
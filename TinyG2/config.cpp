@@ -39,6 +39,7 @@
 #include "help.h"
 #include "util.h"
 #include "xio.h"
+#include "persistence.h"
 
 #ifdef __cplusplus
 extern "C"{
@@ -51,6 +52,16 @@ extern "C"{
 cmdStr_t cmdStr;
 cmdObj_t cmd_list[CMD_LIST_LEN];	// JSON header element
 
+struct cmdIndexSingleton {			// token hash index - see cmd_get_index()
+	uint8_t built;					// TRUE once the index has been built
+	index_t slot[CMD_INDEX_SLOTS];	// cfgArray index by token hash, or NO_MATCH
+}; struct cmdIndexSingleton cmdx;
+
+static uint32_t _schema_hash(void);
+static void _restore_value(cmdObj_t *cmd);
+static uint16_t _image_items(void);
+static uint32_t _image_hash(const uint8_t *image, const uint16_t length);
+
 /***********************************************************************************
  **** CODE *************************************************************************
  ***********************************************************************************/
@@ -66,6 +77,7 @@ cmdObj_t cmd_list[CMD_LIST_LEN];	// JSON header element
 stat_t cmd_set(cmdObj_t *cmd)
 {
 	if (cmd->index >= cmd_index_max()) { return (STAT_INTERNAL_RANGE_ERROR);}
+	controller_config_changed();				// restart the config checksum
 	return (((fptrCmd)GET_TABLE_WORD(set))(cmd));
 }
 
@@ -97,6 +109,10 @@ void cmd_persist(cmdObj_t *cmd)
  *	(1) if NVM is set up or out-of-rev load RAM and NVM with settings.h defaults
  *	(2) if NVM is set up and at current config version use NVM data for config
  *
+ *	NVM is at the current version if both the firmware build and the cfgArray schema 
+ *	hash match. Values are stored by index, so a table that changed under the same 
+ *	build number would otherwise load values into the wrong items.
+ *
  *	You can assume the cfg struct has been zeroed by a hard reset.
  *	Do not clear it as the version and build numbers have already been set by tg_init()
  */
@@ -108,34 +124,27 @@ void config_init()
 	cfg.magic_start = MAGICNUM;
 	cfg.magic_end = MAGICNUM;
 
-//+++++ There is a chunk of code missing from here until persistence is implemented
-/*
+	cfg.comm_mode = JSON_MODE;				// initial value until NVM is read
 	cm_set_units_mode(MILLIMETERS);			// must do inits in MM mode
-	hw.nvm_base_addr = NVM_BASE_ADDR;
-	hw.nvm_profile_base = hw.nvm_base_addr;
+	persistence_init();
 	cmd->index = 0;							// this will read the first record in NVM
 
-	cmd_read_NVM_value(cmd);
-	if (cmd->value != cs.fw_build) {
+	if ((cmd_read_NVM_value(cmd) != STAT_OK) || (fp_NE(cmd->value, cs.fw_build)) ||
+		(read_persistent_schema() != _schema_hash())) {
 		cmd->value = true;					// case (1) NVM is not setup or not in revision
 		set_defaults(cmd);
 	} else {								// case (2) NVM is setup and in revision
 		rpt_print_loading_configs_message();
 		for (cmd->index=0; cmd_index_is_single(cmd->index); cmd->index++) {
 			if (GET_TABLE_BYTE(flags) & F_INITIALIZE) {
-				strcpy_P(cmd->token, cfgArray[cmd->index].token);	// read the token from the array
-				cmd_read_NVM_value(cmd);
-				cmd_set(cmd);
+				if (cmd_read_NVM_value(cmd) != STAT_OK) {	// not persisted or added since
+					cmd->value = GET_TABLE_FLOAT(def_value);
+				}
+				_restore_value(cmd);
 			}
 		}
 		sr_init_status_report();
 	}
-*/
-// do this instead:
-	cfg.comm_mode = JSON_MODE;				// initial value until EEPROM is read
-//	persistence_init();
-	cmd->value = true;
-	set_defaults(cmd);	
 }
 
 /*
@@ -152,16 +161,231 @@ stat_t set_defaults(cmdObj_t *cmd)
 	for (cmd->index=0; cmd_index_is_single(cmd->index); cmd->index++) {
 		if (GET_TABLE_BYTE(flags) & F_INITIALIZE) {
 			cmd->value = GET_TABLE_FLOAT(def_value);
-			strcpy_P(cmd->token, cfgArray[cmd->index].token);
+			strcpy_P(cmd->token, cfgTokens[cmd->index].token);
 			cmd_set(cmd);
 			cmd_persist(cmd);				// persist must occur when no other interrupts are firing
 		}
 	}
+	write_persistent_schema(_schema_hash());
 	rpt_print_initializing_message();		// don't start TX until all the NVM persistence is done
 	sr_init_status_report();				// reset status reports
 	return (STAT_OK);
 }
 
+/*
+ * _schema_hash() - hash of the cfgArray layout: group, token and flags of every item
+ */
+static uint32_t _schema_hash()
+{
+	uint32_t hash = 0;
+	char_t flags[2] = { 0, 0 };
+
+	for (index_t i=0; cmd_index_is_single(i); i++) {
+		hash = checksum_accumulate(hash, cfgTokens[i].group, 0);
+		hash = checksum_accumulate(hash, cfgTokens[i].token, 0);
+		flags[0] = (char_t)(cfgTokens[i].flags | 0x80);	// never NUL
+		hash = checksum_accumulate(hash, flags, 0);
+	}
+	return ((hash == 0) ? 1 : hash);		// 0 reads as "no schema stored"
+}
+
+/*
+ * _restore_value() - apply a value loaded from NVM at boot
+ *
+ *	Items with plain storage setters are written straight to their targets. That 
+ *	skips the token copy and the setter call, which is most of the table. Everything 
+ *	else - derived values such as steps per unit, and hardware settings - goes 
+ *	through cmd_set(). Boot runs in MM mode, so set_flu() is plain storage here.
+ */
+static void _restore_value(cmdObj_t *cmd)
+{
+	fptrCmd set = (fptrCmd)GET_TABLE_WORD(set);
+
+	if ((set == set_flt) || (set == set_flu)) {
+		*((float *)GET_TABLE_WORD(target)) = cmd->value;
+	} else if (set == set_int) {
+		*((uint32_t *)GET_TABLE_WORD(target)) = cmd->value;
+	} else if ((set == set_ui8) || (set == set_01) || (set == set_012) || (set == set_0123)) {
+		*((uint8_t *)GET_TABLE_WORD(target)) = cmd->value;
+	} else {
+		strcpy_P(cmd->token, cfgTokens[cmd->index].token);	// read the token from the array
+		cmd_set(cmd);
+	}
+}
+
+/************************************************************************************
+ * cmd_get_image() - send the persisted config as a binary image ($cfi, {"cfi":null})
+ * cmd_set_image() - restore an image a line at a time ({"cfi":"n:..."})
+ *
+ *	Backing up or cloning a machine's settings takes one request instead of one per 
+ *	item. Every persisted item is in the image, in table order, as it is loaded from 
+ *	NVM at boot (always in mm). The image is sent as lines the host keeps as they are:
+ *
+ *	  {"cfi":"0:AQBsAk..."}		line number, ':', up to CFG_IMAGE_CHUNK bytes in base64
+ *	  {"cfi":"1:..."}
+ *
+ *	then the response, which gives the number of lines. The image (little endian) is
+ *
+ *	  [0]		CFG_IMAGE_VERSION
+ *	  [1]		0
+ *	  [2-3]		persisted items (uint16)
+ *	  [4-7]		cfgArray schema hash - see _schema_hash()
+ *	  [8...]	item values (float)
+ *	  [last 4]	_image_hash() of all the bytes before it
+ *
+ *	To restore, the lines are sent back in order as JSON, each answered with the number
+ *	of lines still to come. Line 0 starts over. The image is collected in RAM and 
+ *	nothing is set until all of it is in and it has been checked - a line out of order,
+ *	another version or schema (a different build) or a bad hash drops it. Then it is 
+ *	applied all at once the way boot applies NVM: plain values are written in place, 
+ *	the rest go through their setters so derived values are worked out once, and all 
+ *	of it is persisted. The machine must not be in a cycle. A get drops an image being
+ *	restored, as they share the buffer.
+ */
+static struct cfgImage {
+	uint16_t length;					// image bytes expected - 0 until line 0 is in
+	uint16_t received;					// image bytes collected
+	uint8_t next;						// line expected next
+	uint8_t buf[CFG_IMAGE_HEADER_LEN + NVM_INDEX_MAX*sizeof(float) + sizeof(uint32_t)];
+} cfi;
+
+stat_t cmd_get_image(cmdObj_t *cmd)
+{
+	cmdObj_t item;
+	uint16_t items = 0;
+	uint8_t *wr = cfi.buf + CFG_IMAGE_HEADER_LEN;
+	uint8_t units = cm_get_units_mode(MODEL);
+	cm_set_units_mode(MILLIMETERS);				// images are in mm, as NVM is loaded
+
+	memset(&item, 0, sizeof(item));
+	for (item.index=0; cmd_index_is_single(item.index); item.index++) {
+		if ((cfgTokens[item.index].flags & F_PERSIST) == 0) { continue;}
+		strcpy_P(item.token, cfgTokens[item.index].token);
+		cmd_get(&item);
+		memcpy(wr, &item.value, sizeof(float));
+		wr += sizeof(float);
+		items++;
+	}
+	cm_set_units_mode(units);
+
+	uint32_t schema = _schema_hash();
+	cfi.buf[0] = CFG_IMAGE_VERSION;
+	cfi.buf[1] = 0;
+	cfi.buf[2] = (uint8_t)items;
+	cfi.buf[3] = (uint8_t)(items >> 8);
+	memcpy(&cfi.buf[4], &schema, sizeof(schema));
+	uint32_t hash = _image_hash(cfi.buf, wr - cfi.buf);
+	memcpy(wr, &hash, sizeof(hash));
+	wr += sizeof(hash);
+	cfi.length = 0;								// no restore survives this
+
+	uint8_t lines = 0;
+	char_t text[(CFG_IMAGE_CHUNK*4 + 2)/3 + 1];
+	for (uint8_t *rd = cfi.buf; rd < wr; rd += CFG_IMAGE_CHUNK) {
+		base64_encode(text, rd, min(CFG_IMAGE_CHUNK, wr - rd));
+		fprintf(stderr, "{\"cfi\":\"%d:%s\"}\n", lines++, (char *)text);
+	}
+	cmd->value = lines;
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t cmd_set_image(cmdObj_t *cmd)
+{
+	if (cmd->objtype != TYPE_STRING) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if (cm.cycle_state != CYCLE_OFF) { return (STAT_COMMAND_NOT_ACCEPTED);}
+
+	char_t *rd = *cmd->stringp;
+	uint16_t line = 0;
+	for (; (*rd >= '0') && (*rd <= '9'); rd++) { line = line * 10 + (*rd - '0');}
+	if (line == 0) {							// a new image
+		cfi.length = 0;
+		cfi.received = 0;
+		cfi.next = 0;
+	}
+	if ((*rd++ != ':') || (line != cfi.next)) {
+		cfi.next = 0;							// out of order - start again from line 0
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+
+	uint16_t bits = 0;
+	uint8_t nbits = 0;
+	for (; (*rd != NUL) && (*rd != '='); rd++) {
+		int8_t sextet = base64_value(*rd);
+		if ((sextet < 0) || (cfi.received >= sizeof(cfi.buf))) {
+			cfi.next = 0;
+			return ((sextet < 0) ? STAT_INPUT_VALUE_UNSUPPORTED : STAT_INPUT_EXCEEDS_MAX_LENGTH);
+		}
+		bits = (bits << 6) | sextet;
+		if ((nbits += 6) >= 8) {
+			nbits -= 8;
+			cfi.buf[cfi.received++] = (uint8_t)(bits >> nbits);
+		}
+	}
+	cfi.next++;
+
+	if (line == 0) {							// check the header before taking any more
+		uint32_t schema;
+		memcpy(&schema, &cfi.buf[4], sizeof(schema));
+		uint16_t items = cfi.buf[2] | (cfi.buf[3] << 8);
+		if ((cfi.received < CFG_IMAGE_HEADER_LEN) || (cfi.buf[0] != CFG_IMAGE_VERSION) ||
+			(schema != _schema_hash()) || (items != _image_items())) {
+			cfi.next = 0;
+			return (STAT_INPUT_VALUE_UNSUPPORTED);
+		}
+		cfi.length = CFG_IMAGE_HEADER_LEN + items * sizeof(float) + sizeof(uint32_t);
+	}
+	if (cfi.received > cfi.length) {
+		cfi.next = 0;
+		return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
+	}
+	cmd->value = (cfi.length - cfi.received + CFG_IMAGE_CHUNK - 1) / CFG_IMAGE_CHUNK;	// lines to come
+	cmd->objtype = TYPE_INTEGER;
+	if (cfi.received < cfi.length) { return (STAT_OK);}
+
+	uint32_t hash;
+	uint8_t *value = cfi.buf + cfi.length - sizeof(hash);
+	memcpy(&hash, value, sizeof(hash));
+	cfi.next = 0;								// whatever happens next starts from line 0
+	if (hash != _image_hash(cfi.buf, value - cfi.buf)) { return (STAT_CHECKSUM_MISMATCH);}
+
+	cmdObj_t item;
+	value = cfi.buf + CFG_IMAGE_HEADER_LEN;
+	uint8_t units = cm_get_units_mode(MODEL);
+	cm_set_units_mode(MILLIMETERS);
+	memset(&item, 0, sizeof(item));
+	for (item.index=0; cmd_index_is_single(item.index); item.index++) {
+		if ((cfgTokens[item.index].flags & F_PERSIST) == 0) { continue;}
+		memcpy(&item.value, value, sizeof(float));
+		value += sizeof(float);
+		_restore_value(&item);
+		cmd_persist(&item);
+	}
+	cm_set_units_mode(units);
+	controller_config_changed();				// the plain values were written in place
+	return (STAT_OK);
+}
+
+/*
+ * _image_items() - number of persisted items
+ * _image_hash()  - hash of the image bytes - as checksum_accumulate(), for binary
+ */
+static uint16_t _image_items()
+{
+	uint16_t items = 0;
+	for (index_t i=0; cmd_index_is_single(i); i++) {
+		if (cfgTokens[i].flags & F_PERSIST) { items++;}
+	}
+	return (items);
+}
+
+static uint32_t _image_hash(const uint8_t *image, const uint16_t length)
+{
+	uint32_t h = 0;
+	for (uint16_t i=0; i<length; i++) { h = 31 * h + image[i];}
+	return (h);
+}
+
 /***** Generic Internal Functions *********************************************/
 
 /* Generic gets()
@@ -194,7 +418,7 @@ stat_t get_int(cmdObj_t *cmd)
 stat_t get_flt(cmdObj_t *cmd)
 {
 	cmd->value = *((float *)GET_TABLE_WORD(target));
-	cmd->precision = (int8_t)GET_TABLE_WORD(precision);
+	cmd->precision = (int8_t)GET_TABLE_BYTE(precision);
 	cmd->objtype = TYPE_FLOAT;
 	return (STAT_OK);
 }
@@ -245,7 +469,7 @@ stat_t set_int(cmdObj_t *cmd)
 stat_t set_flt(cmdObj_t *cmd)
 {
 	*((float *)GET_TABLE_WORD(target)) = cmd->value;
-	cmd->precision = GET_TABLE_WORD(precision);
+	cmd->precision = GET_TABLE_BYTE(precision);
 	cmd->objtype = TYPE_FLOAT;
 	return(STAT_OK);
 }
@@ -279,7 +503,7 @@ stat_t set_flu(cmdObj_t *cmd)
 	float tmp_value = cmd->value;
 	if (cm_get_units_mode(MODEL) == INCHES) tmp_value *= MM_PER_INCH; // convert to canonical units
 	*((float *)GET_TABLE_WORD(target)) = tmp_value;
-	cmd->precision = GET_TABLE_WORD(precision);
+	cmd->precision = GET_TABLE_BYTE(precision);
 	cmd->objtype = TYPE_FLOAT;
 	return(STAT_OK);
 }
@@ -330,7 +554,7 @@ stat_t get_grp(cmdObj_t *cmd)
 	char_t group[CMD_GROUP_LEN+1];			// group string retrieved from cfgArray child
 	cmd->objtype = TYPE_PARENT;				// make first object the parent 
 	for (index_t i=0; cmd_index_is_single(i); i++) {
-		strcpy_P(group, cfgArray[i].group);  // don't need strncpy as it's always terminated
+		strcpy_P(group, cfgTokens[i].group);  // don't need strncpy as it's always terminated
 		if (strcmp(parent_group, group) != 0) continue;
 		(++cmd)->index = i;
 		cmd_get_cmdObj(cmd);
@@ -386,31 +610,68 @@ uint8_t cmd_group_is_prefixed(char_t *group)
  */
 
 /* cmd_get_index() - get index from mnenonic token + group
+ * _token_match()  - TRUE if the token of table entry i matches str
+ * _token_hash()   - hash index slot for a token
+ * _build_index()  - hash all the cfgArray tokens
  *
- * cmd_get_index() is the most expensive routine in the whole config. It does a 
- * linear table scan of the PROGMEM strings, which of course could be further 
- * optimized with indexes or hashing.
+ * cmd_get_index() used to be the most expensive routine in the whole config - a
+ * linear table scan of the PROGMEM strings. It now looks the token up in a hash
+ * index that is built from cfgArray on first use (open addressing; the probe ends
+ * at an empty slot). The index is kept under half full, so a lookup is usually one
+ * compare however many config items there are. If a token appears more than once 
+ * in the table the first one is found, as with the scan.
  */
-index_t cmd_get_index(const char_t *group, const char_t *token)
+static uint8_t _token_match(index_t i, const char_t *str)
 {
 	char_t c;
-	char_t str[CMD_TOKEN_LEN+1];
-	strcpy(str, group);
-	strcat(str, token);
+	if ((c = GET_TOKEN_BYTE(token[0])) != str[0]) { return (false);}		// 1st character mismatch
+	if ((c = GET_TOKEN_BYTE(token[1])) == NUL) { return (str[1] == NUL);}	// one character match
+	if (c != str[1]) { return (false);}									// 2nd character mismatch
+	if ((c = GET_TOKEN_BYTE(token[2])) == NUL) { return (str[2] == NUL);}	// two character match
+	if (c != str[2]) { return (false);}									// 3rd character mismatch
+	if ((c = GET_TOKEN_BYTE(token[3])) == NUL) { return (str[3] == NUL);}	// three character match
+	if (c != str[3]) { return (false);}									// 4th character mismatch
+	if ((c = GET_TOKEN_BYTE(token[4])) == NUL) { return (str[4] == NUL);}	// four character match
+	if (c != str[4]) { return (false);}									// 5th character mismatch
+	return (true);															// five character match
+}
+
+static uint16_t _token_hash(const char_t *str)
+{
+	uint16_t hash = 0;
+	for (uint8_t i=0; (i < CMD_TOKEN_LEN) && (str[i] != NUL); i++) {
+		hash = hash * 37 + str[i];
+	}
+	return ((uint16_t)(hash * 40503) >> (16 - CMD_INDEX_BITS));	// Fibonacci hashing spreads similar tokens
+}
 
+static void _build_index()
+{
+	char_t str[CMD_TOKEN_LEN+1];
 	index_t index_max = cmd_index_max();
 
+	for (uint16_t s=0; s < CMD_INDEX_SLOTS; s++) { cmdx.slot[s] = NO_MATCH;}
 	for (index_t i=0; i < index_max; i++) {
-		if ((c = GET_TOKEN_BYTE(token[0])) != str[0]) {	continue; }					// 1st character mismatch
-		if ((c = GET_TOKEN_BYTE(token[1])) == NUL) { if (str[1] == NUL) return(i);}	// one character match
-		if (c != str[1]) continue;													// 2nd character mismatch
-		if ((c = GET_TOKEN_BYTE(token[2])) == NUL) { if (str[2] == NUL) return(i);}	// two character match
-		if (c != str[2]) continue;													// 3rd character mismatch
-		if ((c = GET_TOKEN_BYTE(token[3])) == NUL) { if (str[3] == NUL) return(i);}	// three character match
-		if (c != str[3]) continue;													// 4th character mismatch
-		if ((c = GET_TOKEN_BYTE(token[4])) == NUL) { if (str[4] == NUL) return(i);}	// four character match
-		if (c != str[4]) continue;													// 5th character mismatch
-		return (i);																	// five character match
+		strcpy_P(str, cfgTokens[i].token);		// token field is always terminated
+		uint16_t s = _token_hash(str);
+		for (; cmdx.slot[s] != NO_MATCH; s = (s+1) & (CMD_INDEX_SLOTS-1)) {
+			if (_token_match(cmdx.slot[s], str) == true) break;	// duplicate - keep the first
+		}
+		if (cmdx.slot[s] == NO_MATCH) { cmdx.slot[s] = i;}
+	}
+	cmdx.built = true;
+}
+
+index_t cmd_get_index(const char_t *group, const char_t *token)
+{
+	char_t str[CMD_TOKEN_LEN+1];
+	strcpy(str, group);
+	strcat(str, token);
+
+	if (cmdx.built == false) { _build_index();}
+	index_t i;
+	for (uint16_t s = _token_hash(str); (i = cmdx.slot[s]) != NO_MATCH; s = (s+1) & (CMD_INDEX_SLOTS-1)) {
+		if (_token_match(i, str) == true) { return (i);}
 	}
 	return (NO_MATCH);
 }
@@ -437,19 +698,17 @@ uint8_t cmd_get_type(cmdObj_t *cmd)
 
 stat_t cmd_persist_offsets(uint8_t flag)
 {
-/*
 	if (flag == true) {
 		cmdObj_t cmd;
 		for (uint8_t i=1; i<=COORDS; i++) {
 			for (uint8_t j=0; j<AXES; j++) {
-				sprintf(cmd.token, "g%2d%c", 53+i, ("xyzabc")[j]);
+				sprintf((char *)cmd.token, "g%2d%c", 53+i, ("xyzabc")[j]);
 				cmd.index = cmd_get_index((const char_t *)"", cmd.token);
 				cmd.value = cm.offset[i][j];
 				cmd_persist(&cmd);				// only writes changed values
 			}
 		}
 	}
-*/
 	return (STAT_OK);
 }
 
@@ -459,6 +718,7 @@ stat_t cmd_persist_offsets(uint8_t flag)
  * cmd_reset_obj()		- quick clear for a new cmd object
  * cmd_reset_list()		- clear entire header, body and footer for a new use
  * cmd_copy_string()	- used to write a string to shared string storage and link it
+ * cmd_link_string()	- link a string that outlives the cmd list without copying it
  * cmd_add_object()		- write contents of parameter to  first free object in the body
  * cmd_add_integer()	- add an integer value to end of cmd body (Note 1)
  * cmd_add_float()		- add a floating point value to end of cmd body
@@ -490,8 +750,8 @@ void cmd_get_cmdObj(cmdObj_t *cmd)
 	cmd_reset_obj(cmd);
 	cmd->index = tmp;
 
-	strcpy_P(cmd->token, cfgArray[cmd->index].token); // token field is always terminated
-	strcpy_P(cmd->group, cfgArray[cmd->index].group); // group field is always terminated
+	strcpy_P(cmd->token, cfgTokens[cmd->index].token); // token field is always terminated
+	strcpy_P(cmd->group, cfgTokens[cmd->index].group); // group field is always terminated
 
 	// special processing for system groups and stripping tokens for groups
 	if (cmd->group[0] != NUL) {
@@ -528,6 +788,7 @@ cmdObj_t *cmd_reset_obj(cmdObj_t *cmd)		// clear a single cmdObj structure
 
 cmdObj_t *cmd_reset_list()					// clear the header and response body
 {
+	json_response_finish();					// the response going out still needs the list
 	cmdStr.wp = 0;							// reset the shared string
 	cmdObj_t *cmd = cmd_list;				// set up linked list and initialize elements	
 	for (uint8_t i=0; i<CMD_LIST_LEN; i++, cmd++) {
@@ -558,6 +819,12 @@ stat_t cmd_copy_string(cmdObj_t *cmd, const char_t *src)
 	return (STAT_OK);
 }
 
+stat_t cmd_link_string(cmdObj_t *cmd, const char_t *src)
+{
+	cmd->stringp = (char_t (*)[])src;
+	return (STAT_OK);
+}
+
 /* UNUSED
 stat_t cmd_copy_string_P(cmdObj_t *cmd, const char_t *src_P)
 {
@@ -679,7 +946,7 @@ stat_t cmd_read_NVM_value(cmdObj_t *cmd)
 	memcpy(&cmd->value, &nvm_byte_array, NVM_VALUE_LEN);
 #endif // __AVR
 #ifdef __ARM
-	//+++++ No ARM persistence yet
+	return (read_persistent_value(cmd));
 #endif // __ARM
 	return (STAT_OK);
 }
@@ -699,102 +966,11 @@ stat_t cmd_write_NVM_value(cmdObj_t *cmd)
 	}
 #endif // __AVR
 #ifdef __ARM
-	//+++++ No ARM persistence yet
+	return (write_persistent_value(cmd));	// buffered - see persistence_callback()
 #endif // __ARM
 	return (STAT_OK);
 }
 
-/****************************************************************************
- ***** Config Unit Tests ****************************************************
- ****************************************************************************/
-
-#ifdef __UNIT_TESTS
-#ifdef __UNIT_TEST_CONFIG
-
-#define NVMwr(i,v) { cmd.index=i; cmd.value=v; cmd_write_NVM_value(&cmd);}
-#define NVMrd(i)   { cmd.index=i; cmd_read_NVM_value(&cmd); printf("%f\n", (char *)cmd.value);}
-
-void cfg_unit_tests()
-{
-
-// NVM tests
-/*	cmdObj_t cmd;
-	NVMwr(0, 329.01)
-	NVMwr(1, 111.01)
-	NVMwr(2, 222.02)
-	NVMwr(3, 333.03)
-	NVMwr(4, 444.04)
-	NVMwr(10, 10.10)
-	NVMwr(100, 100.100)
-	NVMwr(479, 479.479)
-
-	NVMrd(0)
-	NVMrd(1)
-	NVMrd(2)
-	NVMrd(3)
-	NVMrd(4)
-	NVMrd(10)
-	NVMrd(100)
-	NVMrd(479)
-*/
-
-// config table tests
-
-	index_t i;
-//	float val;
-
-//	print_configs("$", NUL);					// no filter (show all)
-//	print_configs("$", 'g');					// filter for general parameters
-//	print_configs("$", '1');					// filter for motor 1
-//	print_configs("$", 'x');					// filter for x axis
-
-	i = cmd_get_index((const char_t *)"fb");
-	i = cmd_get_index((const char_t *)"xfr");
-	i = cmd_get_index((const char_t *)"g54");
-
-//	i = get_pos_axis(55);
-//	i = get_pos_axis(73);
-//	i = get_pos_axis(93);
-//	i = get_pos_axis(113);
-
-/*
-	for (i=0; i<CMD_MAX_INDEX; i++) {
-
-		cmd_get(&cmd);
-
-		cmd.value = 42;
-		cmd_set(&cmd);
-
-		val = get_flt_value(i);
-		cmd_get_token(i, cmd.token);
-
-//		get_friendly(i, string);
-		get_format(i, cmd.vstring);
-		get_axis(i);							// uncomment main function to test
-		get_motor(i);
-		cmd_set(i, &cmd);
-		cmd_print(i);
-	}
-
-	_parse_config_string("$1po 1", &c);			// returns a number
-	_parse_config_string("XFR=1200", &c);		// returns a number
-	_parse_config_string("YFR 1300", &c);		// returns a number
-	_parse_config_string("zfr	1400", &c);		// returns a number
-	_parse_config_string("afr", &c);			// returns a null
-	_parse_config_string("Bfr   ", &c);			// returns a null
-	_parse_config_string("cfr=wordy", &c);		// returns a null
-
-//	i = cfgget_config_index("gc");
-//	i = cfgget_config_index("gcode");
-//	i = cfgget_config_index("c_axis_mode");
-//	i = cfgget_config_index("AINT_NOBODY_HOME");
-	i = cfgget_config_index("firmware_version");
-*/
-}
-
-#endif
-#endif
-
 #ifdef __cplusplus
 }
 #endif // __cplusplus
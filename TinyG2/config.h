@@ -55,10 +55,15 @@ extern "C"{
  *	static assignments for each variable. The cfgArray contains typed data in program 
  *	memory (PROGMEM, in the AVR).
  *
- *	Each cfgItem has:
+ *	Each config item is a row in config_table.h, built into two parallel tables at compile 
+ *	time. Token lookups and group walks only touch cfgTokens[], so they stride through 12 
+ *	bytes per item rather than the whole record. Each cfgToken has:
  *	 - group string identifying what group the variable is part of; or "" if no group
  *	 - token string - the token for that variable - pre-pended with the group (if present)
  *	 - operations flags - e.g. if the value should be initialized and/or persisted to NVM
+ *	 - decimal precision for display
+ *
+ *	and each cfgItem in cfgArray[] has:
  *	 - function pointer for formatted print() method for text-mode readouts
  *	 - function pointer for get() method - gets value from memory
  *	 - function pointer for set() method - sets value and runs functions
@@ -92,7 +97,7 @@ extern "C"{
  *
  *	Adding a new value to config (or changing an existing one) involves touching the following places:
  *
- *	 - Create a new record in cfgArray[]. Use existing ones for examples. 
+ *	 - Create a new CFG() row in config_table.h. Use existing ones for examples. 
  *
  *	 - Create functions for print, get, and set. You can often use existing generic fucntions for
  *	   get and set, and sometimes print. If print requires any custom text it requires it's own function
@@ -154,6 +159,11 @@ extern "C"{
  *	The observation is that the total rendered output in JSON or text mode cannot exceed the size of 
  *	the output buffer (typ 256 bytes), So some number less than that is sufficient for shared strings. 
  *	This is all mediated through cmd_copy_string(), cmd_copy_string_P(), and cmd_reset_list().
+ *	The shared string is allocated front to back and released all at once by cmd_reset_list().
+ *
+ *	Strings that outlive the cmd list do not need a copy at all. cmd_link_string() points 
+ *	the cmdObj at the caller's string - use it for the input buffer (which is not re-read 
+ *	until the response has gone out) and for constant text in flash on the ARM.
  */
 /*  --- Setting cmdObj indexes ---
  *
@@ -182,20 +192,29 @@ typedef uint16_t index_t;			// use this if there are > 255 indexed objects
 #define CMD_MESSAGE_LEN 128			// sufficient space to contain end-user messages
 
 									// pre-allocated defines (take RAM permanently)
-#define CMD_SHARED_STRING_LEN 512	// shared string for string values
+#ifndef CMD_SHARED_STRING_LEN
+#define CMD_SHARED_STRING_LEN 512	// shared string for string values - may be set larger from the build
+#endif
+#ifndef CMD_BODY_LEN
 #define CMD_BODY_LEN 30				// body elements - allow for 1 parent + N children
+#endif
 									// (each body element takes about 30 bytes of RAM)
+#define CMD_INDEX_BITS 10			// token hash index for cmd_get_index() has 2^bits slots
+#define CMD_INDEX_SLOTS (1 << CMD_INDEX_BITS)// (2 bytes each) - must be over twice the cfgArray size
 
 // Stuff you probably don't want to change 
 
 #define NO_MATCH (index_t)0xFFFF
 #define CMD_GROUP_LEN 3				// max length of group prefix
 #define CMD_TOKEN_LEN 5				// mnemonic token string: group prefix + short token
-#define CMD_FOOTER_LEN 18			// sufficient space to contain a JSON footer array
+#define CMD_FOOTER_LEN 32			// sufficient space to contain a JSON footer array (incl. flow control counts)
 #define CMD_LIST_LEN (CMD_BODY_LEN+2)// +2 allows for a header and a footer
 #define CMD_MAX_OBJECTS (CMD_BODY_LEN-1)// maximum number of objects in a body string
 
 #define NVM_VALUE_LEN 4				// NVM value length (float, fixed length)
+#define CFG_IMAGE_VERSION 1			// config image layout - see cmd_get_image()
+#define CFG_IMAGE_HEADER_LEN 8		// version, spare, item count, schema hash
+#define CFG_IMAGE_CHUNK 144			// image bytes a line - 192 base64 characters
 #define NVM_BASE_ADDR 0x0000		// base address of usable NVM
 
 enum tgCommunicationsMode {
@@ -276,11 +295,14 @@ typedef struct cmdObject {				// depending on use, not all elements may be popul
 typedef uint8_t (*fptrCmd)(cmdObj_t *cmd);// required for cmd table access
 typedef void (*fptrPrint)(cmdObj_t *cmd);// required for PROGMEM access
 
-typedef struct cfgItem {
+typedef struct cfgToken {				// what lookups and group walks read - 12 bytes, no padding
 	char_t group[CMD_GROUP_LEN+1];		// group prefix (with NUL termination)
 	char_t token[CMD_TOKEN_LEN+1];		// token - stripped of group prefix (w/NUL termination)
 	uint8_t flags;						// operations flags - see defines below
 	int8_t precision;					// decimal precision for display (JSON)
+} cfgToken_t;
+
+typedef struct cfgItem {				// bindings - same index as cfgTokens[]
 //	const char_t *format;				// pointer to formatted print string in FLASH
 	fptrPrint print;					// print binding: aka void (*print)(cmdObj_t *cmd);
 	fptrCmd get;						// GET binding aka uint8_t (*get)(cmdObj_t *cmd)
@@ -293,6 +315,7 @@ typedef struct cfgItem {
 
 extern cmdStr_t cmdStr;
 extern cmdObj_t cmd_list[];
+extern const cfgToken_t cfgTokens[];
 extern const cfgItem_t cfgArray[];
 
 #define cmd_header cmd_list
@@ -302,6 +325,8 @@ extern const cfgItem_t cfgArray[];
 
 void config_init(void);
 stat_t set_defaults(cmdObj_t *cmd);		// reset config to default values
+stat_t cmd_get_image(cmdObj_t *cmd);	// send the persisted config as a binary image
+stat_t cmd_set_image(cmdObj_t *cmd);	// restore it a line at a time
 
 // main entry points for core access functions
 stat_t cmd_get(cmdObj_t *cmd);			// main entry point for get value
@@ -347,6 +372,7 @@ cmdObj_t *cmd_reset_obj(cmdObj_t *cmd);
 cmdObj_t *cmd_reset_list(void);
 
 stat_t cmd_copy_string(cmdObj_t *cmd, const char_t *src);
+stat_t cmd_link_string(cmdObj_t *cmd, const char_t *src);
 cmdObj_t *cmd_add_object(const char_t *token);
 cmdObj_t *cmd_add_integer(const char_t *token, const uint32_t value);
 cmdObj_t *cmd_add_float(const char_t *token, const float value);
@@ -362,17 +388,6 @@ stat_t cmd_write_NVM_value(cmdObj_t *cmd);
  *********************************************************************************************/
 #include "config_app.h"
 
-/*** Unit tests ***/
-
-/* unit test setup */
-//#define __UNIT_TEST_CONFIG		// uncomment to enable config unit tests
-#ifdef __UNIT_TEST_CONFIG
-void cfg_unit_tests(void);
-#define	CONFIG_UNITS cfg_unit_tests();
-#else
-#define	CONFIG_UNITS
-#endif // __UNIT_TEST_CONFIG
-
 #ifdef __cplusplus
 }
 #endif
@@ -78,6 +78,10 @@ stat_t set_baud_callback(void);
 	void co_print_baud(cmdObj_t *cmd);
 	void co_print_net(cmdObj_t *cmd);
 	void co_print_rx(cmdObj_t *cmd);
+	void co_print_ai(cmdObj_t *cmd);
+	void co_print_ea(cmdObj_t *cmd);
+	void co_print_lk(cmdObj_t *cmd);
+	void co_print_cfi(cmdObj_t *cmd);
 
 #else 
 
@@ -87,6 +91,10 @@ stat_t set_baud_callback(void);
 	#define co_print_baud tx_print_stub
 	#define co_print_net tx_print_stub
 	#define co_print_rx tx_print_stub
+	#define co_print_ai tx_print_stub
+	#define co_print_ea tx_print_stub
+	#define co_print_lk tx_print_stub
+	#define co_print_cfi tx_print_stub
 
 #endif // __TEXT_MODE
 
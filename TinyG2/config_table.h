@@ -0,0 +1,948 @@
+/*
+ * config_table.h - rows of the application config table
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Each CFG() row is one config item. There is no include guard: config_app.cpp includes 
+ * this file twice with different CFG() definitions to build cfgTokens[] and cfgArray[],
+ * so the two tables always have the same rows in the same order. Include it nowhere else.
+ *
+ * See CONFIG TABLE in config_app.cpp for the rules on row order, groups and uber-groups.
+ */
+
+	// group token flags p, print_func,	 get_func,  set_func, target for get/set,   	default value
+	CFG("sys", "fb", _f07, 2, hw_print_fb, get_flt,   set_nul,  (float *)&cs.fw_build,   TINYG_FIRMWARE_BUILD ) // MUST BE FIRST!
+	CFG("sys", "fv", _f07, 3, hw_print_fv, get_flt,   set_nul,  (float *)&cs.fw_version, TINYG_FIRMWARE_VERSION )
+	CFG("sys", "hp", _f07, 0, hw_print_hp, get_flt,   set_flt,  (float *)&cs.hw_platform,TINYG_HARDWARE_PLATFORM )
+	CFG("sys", "hv", _f07, 0, hw_print_hv, get_flt,   hw_set_hv,(float *)&cs.hw_version, TINYG_HARDWARE_VERSION )
+//	CFG("sys", "id", _fns, 0, hw_print_id, hw_get_id, set_nul,  (float *)&cs.null, 0 )  // device ID (ASCII signature)
+
+	// dynamic model attributes for reporting purposes (up front for speed)
+	CFG("",   "n",   _fin, 0, cm_print_line, cm_get_mline,set_int,(float *)&gm.linenum,0 )// Model line number
+	CFG("",   "line",_fin, 0, cm_print_line, cm_get_line, set_int,(float *)&gm.linenum,0 )// Active line number - model or runtime line number
+	CFG("",   "vel", _f00, 2, cm_print_vel,  cm_get_vel,  set_nul,(float *)&cs.null, 0 )	// current velocity
+	CFG("",   "feed",_f00, 2, cm_print_feed, get_flu,  	set_nul,(float *)&cs.null, 0 )	// feed rate
+	CFG("",   "stat",_f00, 0, cm_print_stat, cm_get_stat, set_nul,(float *)&cs.null, 0 )	// combined machine state
+	CFG("",   "macs",_f00, 0, cm_print_macs, cm_get_macs, set_nul,(float *)&cs.null, 0 )	// raw machine state
+	CFG("",   "cycs",_f00, 0, cm_print_cycs, cm_get_cycs, set_nul,(float *)&cs.null, 0 )	// cycle state
+	CFG("",   "mots",_f00, 0, cm_print_mots, cm_get_mots, set_nul,(float *)&cs.null, 0 )	// motion state
+	CFG("",   "hold",_f00, 0, cm_print_hold, cm_get_hold, set_nul,(float *)&cs.null, 0 )	// feedhold state
+	CFG("",   "unit",_f00, 0, cm_print_unit, cm_get_unit, set_nul,(float *)&cs.null, 0 )	// units mode
+	CFG("",   "coor",_f00, 0, cm_print_coor, cm_get_coor, set_nul,(float *)&cs.null, 0 )	// coordinate system
+	CFG("",   "momo",_f00, 0, cm_print_momo, cm_get_momo, set_nul,(float *)&cs.null, 0 )	// motion mode
+	CFG("",   "plan",_f00, 0, cm_print_plan, cm_get_plan, set_nul,(float *)&cs.null, 0 )	// plane select
+	CFG("",   "path",_f00, 0, cm_print_path, cm_get_path, set_nul,(float *)&cs.null, 0 )	// path control mode
+	CFG("",   "dist",_f00, 0, cm_print_dist, cm_get_dist, set_nul,(float *)&cs.null, 0 )	// distance mode
+	CFG("",   "frmo",_f00, 0, cm_print_frmo, cm_get_frmo, set_nul,(float *)&cs.null, 0 )	// feed rate mode
+	CFG("",   "tool",_f00, 0, cm_print_tool, cm_get_toolv,set_nul,(float *)&cs.null, 0 )	// active tool
+//	CFG("",   "tick",_f00, 0, tx_print_int,  get_int,     set_int,(float *)&rtc.sys_ticks, 0 )// tick count
+
+	CFG("mpo","mpox",_f00, 3, cm_print_mpo, cm_get_mpo, set_nul,(float *)&cs.null, 0 )	// X machine position
+	CFG("mpo","mpoy",_f00, 3, cm_print_mpo, cm_get_mpo, set_nul,(float *)&cs.null, 0 )	// Y machine position
+	CFG("mpo","mpoz",_f00, 3, cm_print_mpo, cm_get_mpo, set_nul,(float *)&cs.null, 0 )	// Z machine position
+#if (AXES > AXIS_A)
+	CFG("mpo","mpoa",_f00, 3, cm_print_mpo, cm_get_mpo, set_nul,(float *)&cs.null, 0 )	// A machine position
+#endif
+#if (AXES > AXIS_B)
+	CFG("mpo","mpob",_f00, 3, cm_print_mpo, cm_get_mpo, set_nul,(float *)&cs.null, 0 )	// B machine position
+#endif
+#if (AXES > AXIS_C)
+	CFG("mpo","mpoc",_f00, 3, cm_print_mpo, cm_get_mpo, set_nul,(float *)&cs.null, 0 )	// C machine position
+#endif
+
+	CFG("pos","posx",_f00, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 )	// X work position
+	CFG("pos","posy",_f00, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 )	// Y work position
+	CFG("pos","posz",_f00, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 )	// Z work position
+#if (AXES > AXIS_A)
+	CFG("pos","posa",_f00, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 )	// A work position
+#endif
+#if (AXES > AXIS_B)
+	CFG("pos","posb",_f00, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 )	// B work position
+#endif
+#if (AXES > AXIS_C)
+	CFG("pos","posc",_f00, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 )	// C work position
+#endif
+
+	CFG("ofs","ofsx",_f00, 3, cm_print_mpo, cm_get_ofs, set_nul,(float *)&cs.null, 0 )	// X work offset
+	CFG("ofs","ofsy",_f00, 3, cm_print_mpo, cm_get_ofs, set_nul,(float *)&cs.null, 0 )	// Y work offset
+	CFG("ofs","ofsz",_f00, 3, cm_print_mpo, cm_get_ofs, set_nul,(float *)&cs.null, 0 )	// Z work offset
+#if (AXES > AXIS_A)
+	CFG("ofs","ofsa",_f00, 3, cm_print_mpo, cm_get_ofs, set_nul,(float *)&cs.null, 0 )	// A work offset
+#endif
+#if (AXES > AXIS_B)
+	CFG("ofs","ofsb",_f00, 3, cm_print_mpo, cm_get_ofs, set_nul,(float *)&cs.null, 0 )	// B work offset
+#endif
+#if (AXES > AXIS_C)
+	CFG("ofs","ofsc",_f00, 3, cm_print_mpo, cm_get_ofs, set_nul,(float *)&cs.null, 0 )	// C work offset
+#endif
+
+	CFG("hom","home",_f00, 0, cm_print_home, cm_get_home, cm_run_home,(float *)&cs.null, 0 )	   // homing state, invoke homing cycle
+	CFG("hom","homx",_f00, 0, cm_print_pos, get_ui8, set_nul,(float *)&cm.homed[AXIS_X], false )// X homed - Homing status group
+	CFG("hom","homy",_f00, 0, cm_print_pos, get_ui8, set_nul,(float *)&cm.homed[AXIS_Y], false )// Y homed
+	CFG("hom","homz",_f00, 0, cm_print_pos, get_ui8, set_nul,(float *)&cm.homed[AXIS_Z], false )// Z homed
+#if (AXES > AXIS_A)
+	CFG("hom","homa",_f00, 0, cm_print_pos, get_ui8, set_nul,(float *)&cm.homed[AXIS_A], false )// A homed
+#endif
+#if (AXES > AXIS_B)
+	CFG("hom","homb",_f00, 0, cm_print_pos, get_ui8, set_nul,(float *)&cm.homed[AXIS_B], false )// B homed
+#endif
+#if (AXES > AXIS_C)
+	CFG("hom","homc",_f00, 0, cm_print_pos, get_ui8, set_nul,(float *)&cm.homed[AXIS_C], false )// C homed
+#endif
+
+	CFG("pvt","pvtt",_f00, 4, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_time, 0 )				// PVT point - time in seconds (see cm_set_pvt())
+	CFG("pvt","pvtx",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_target[AXIS_X], 0 )		// X position
+	CFG("pvt","pvty",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_target[AXIS_Y], 0 )		// Y position
+	CFG("pvt","pvtz",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_target[AXIS_Z], 0 )		// Z position
+#if (AXES > AXIS_A)
+	CFG("pvt","pvta",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_target[AXIS_A], 0 )		// A position
+#endif
+#if (AXES > AXIS_B)
+	CFG("pvt","pvtb",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_target[AXIS_B], 0 )		// B position
+#endif
+#if (AXES > AXIS_C)
+	CFG("pvt","pvtc",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_target[AXIS_C], 0 )		// C position
+#endif
+	CFG("pvt","pvtvx",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_velocity[AXIS_X], 0 )	// X velocity
+	CFG("pvt","pvtvy",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_velocity[AXIS_Y], 0 )	// Y velocity
+	CFG("pvt","pvtvz",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_velocity[AXIS_Z], 0 )	// Z velocity
+#if (AXES > AXIS_A)
+	CFG("pvt","pvtva",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_velocity[AXIS_A], 0 )	// A velocity
+#endif
+#if (AXES > AXIS_B)
+	CFG("pvt","pvtvb",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_velocity[AXIS_B], 0 )	// B velocity
+#endif
+#if (AXES > AXIS_C)
+	CFG("pvt","pvtvc",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.pvt_velocity[AXIS_C], 0 )	// C velocity
+#endif
+
+	CFG("ras","rasx",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.raster_start[0], 0 )		// raster line - start X (see cm_set_ras())
+	CFG("ras","rasy",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.raster_start[1], 0 )		// start Y
+	CFG("ras","rasi",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.raster_direction[0], 0 )	// direction X
+	CFG("ras","rasj",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.raster_direction[1], 0 )	// direction Y
+	CFG("ras","rasp",_f00, 4, tx_print_nul, get_flt, set_flt,(float *)&cm.raster_pitch, 0 )		// pixel pitch
+	CFG("ras","rasf",_f00, 3, tx_print_nul, get_flt, set_flt,(float *)&cm.raster_feed, 0 )			// feed rate
+	CFG("ras","rasd",_f00, 0, tx_print_nul, get_int, cm_set_rasd,(float *)&cm.raster_count, 0 )	// pixels - base64 levels
+
+	// Reports, tests, help, and messages
+	CFG("", "sr",  _f00, 0, sr_print_sr,  sr_get,  sr_set,   (float *)&cs.null, 0 )	// status report object
+	CFG("", "su1", _f00, 0, su_print_su,  su_get,  su_set,   (float *)&cs.null, 0 )	// subscriptions - see report.h
+	CFG("", "su2", _f00, 0, su_print_su,  su_get,  su_set,   (float *)&cs.null, 0 )
+	CFG("", "su3", _f00, 0, su_print_su,  su_get,  su_set,   (float *)&cs.null, 0 )
+//	CFG("", "qri", _f00, 0, qr_print_qr,  qr_get_i,set_nul,  (float *)&cs.null, 0 )	// queue report - blocks in
+//	CFG("", "qro", _f00, 0, qr_print_qr,  qr_get_o,set_nul,  (float *)&cs.null, 0 )	// queue report - block out
+	CFG("", "qr",  _f00, 0, qr_print_qr,  qr_get,  set_nul,  (float *)&cs.null, 0 )	// queue report
+	CFG("", "qt",  _f00, 0, qr_print_qt,  qr_get_qt, set_nul, (float *)&cs.null, 0 )	// queue time in ms
+	CFG("", "er",  _f00, 0, tx_print_nul, rpt_er,  set_nul,  (float *)&cs.null, 0 )	// invoke bogus exception report for testing
+	CFG("", "qf",  _f00, 0, tx_print_nul, get_nul, cm_run_qf,(float *)&cs.null, 0 )	// queue flush
+	CFG("", "bench",_f00,0, tx_print_nul, get_nul, bm_run_bench,(float *)&cs.null, 0 )	// run planner benchmark on corpus file N
+	CFG("", "jit", _f00, 0, tx_print_nul, get_nul, bm_run_jitter,(float *)&cs.null, 0 )	// run DDA jitter benchmark with priority map N
+	CFG("", "pre", _f00, 0, pf_print_pre, get_ui8, pf_set_pre,(float *)&pf.state, 0 )	// preflight the job that follows (1) or the stored job (2)
+#ifdef __MICROBENCHMARKS
+	CFG("", "kern",_f00, 0, bm_print_kern, bm_run_kernels, set_nul,(float *)&cs.null, 0 )	// run the kernel microbenchmarks
+#endif
+	CFG("", "link",_f00, 0, tx_print_nul, get_nul, lt_run_link,(float *)&cs.null, 0 )	// run console link test pattern N
+	CFG("", "profw",_f00,0, tx_print_nul, get_nul, cm_run_profw,(float *)&cs.null, 0 )	// store motion settings in profile slot N
+//	CFG("", "rx",  _f00, 0, tx_print_int, get_rx,  set_nul,  (float *)&cs.null, 0 )	// space in RX buffer
+	CFG("", "msg", _f00, 0, tx_print_str, get_nul, set_nul,  (float *)&cs.null, 0 )	// string for generic messages
+//	CFG("", "sx",  _f00, 0, tx_print_nul, run_sx,  run_sx ,  (float *)&cs.null, 0 )	// send XOFF, XON test
+
+#ifdef __HELP_SCREENS
+	CFG("", "defa",_f00, 0, tx_print_nul, help_defa,		 set_defaults,(float *)&cs.null,0 )	// set/print defaults / help screen
+	CFG("", "cfi", _f00, 0, co_print_cfi, cmd_get_image, cmd_set_image,(float *)&cs.null,0 )	// config image backup and restore
+//	CFG("", "test",_f00, 0, tx_print_nul, help_test,		 run_test, 	  (float *)&cs.null,0 )	// run tests, print test help screen
+//	CFG("", "boot",_f00, 0, tx_print_nul, help_boot_loader,hw_run_boot, (float *)&cs.null,0 )
+	CFG("", "help",_f00, 0, tx_print_nul, help_config,	 set_nul, 	  (float *)&cs.null,0 )	// prints config help screen
+	CFG("", "h",   _f00, 0, tx_print_nul, help_config,	 set_nul, 	  (float *)&cs.null,0 )	// alias for "help"
+#endif
+
+	// Motor parameters
+	CFG("1","1ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st.m[MOTOR_1].motor_map,	M1_MOTOR_MAP )
+	CFG("1","1sa",_fip, 2, st_print_sa, get_flt, st_set_sa, (float *)&st.m[MOTOR_1].step_angle,	M1_STEP_ANGLE )
+	CFG("1","1tr",_fip, 3, st_print_tr, get_flu, st_set_tr, (float *)&st.m[MOTOR_1].travel_rev,	M1_TRAVEL_PER_REV )
+	CFG("1","1mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st.m[MOTOR_1].microsteps,	M1_MICROSTEPS )
+	CFG("1","1po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st.m[MOTOR_1].polarity,		M1_POLARITY )
+	CFG("1","1pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st.m[MOTOR_1].power_mode,	M1_POWER_MODE )
+	CFG("1","1gs",_fip, 0, st_print_gs, get_ui8, st_set_gs, (float *)&st.m[MOTOR_1].gantry_switch,	M1_GANTRY_SWITCH )
+	CFG("1","1pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st.m[MOTOR_1].power_level,	M1_POWER_LEVEL )
+	CFG("1","1pi",_fip, 3, st_print_pi, get_flt, st_set_pl, (float *)&st.m[MOTOR_1].power_idle,	M1_POWER_IDLE )
+	CFG("1","1ot",_fip, 0, sv_print_ot, get_ui8, sv_set_ot, (float *)&st.m[MOTOR_1].output,		M1_OUTPUT )
+	CFG("1","1mp",_f00, 0, st_print_mp, st_get_mp, set_nul,(float *)&cs.null, 0 )
+#if (MOTORS >= 2)
+	CFG("2","2ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st.m[MOTOR_2].motor_map,	M2_MOTOR_MAP )
+	CFG("2","2sa",_fip, 2, st_print_sa, get_flt, st_set_sa, (float *)&st.m[MOTOR_2].step_angle,	M2_STEP_ANGLE )
+	CFG("2","2tr",_fip, 3, st_print_tr, get_flu, st_set_tr, (float *)&st.m[MOTOR_2].travel_rev,	M2_TRAVEL_PER_REV )
+	CFG("2","2mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st.m[MOTOR_2].microsteps,	M2_MICROSTEPS )
+	CFG("2","2po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st.m[MOTOR_2].polarity,		M2_POLARITY )
+	CFG("2","2pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st.m[MOTOR_2].power_mode,	M2_POWER_MODE )
+	CFG("2","2gs",_fip, 0, st_print_gs, get_ui8, st_set_gs, (float *)&st.m[MOTOR_2].gantry_switch,	M2_GANTRY_SWITCH )
+	CFG("2","2pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st.m[MOTOR_2].power_level,	M2_POWER_LEVEL )
+	CFG("2","2pi",_fip, 3, st_print_pi, get_flt, st_set_pl, (float *)&st.m[MOTOR_2].power_idle,	M2_POWER_IDLE )
+	CFG("2","2ot",_fip, 0, sv_print_ot, get_ui8, sv_set_ot, (float *)&st.m[MOTOR_2].output,		M2_OUTPUT )
+	CFG("2","2mp",_f00, 0, st_print_mp, st_get_mp, set_nul,(float *)&cs.null, 0 )
+#endif
+#if (MOTORS >= 3)
+	CFG("3","3ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st.m[MOTOR_3].motor_map,	M3_MOTOR_MAP )
+	CFG("3","3sa",_fip, 2, st_print_sa, get_flt, st_set_sa, (float *)&st.m[MOTOR_3].step_angle,	M3_STEP_ANGLE )
+	CFG("3","3tr",_fip, 3, st_print_tr, get_flu, st_set_tr, (float *)&st.m[MOTOR_3].travel_rev,	M3_TRAVEL_PER_REV )
+	CFG("3","3mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st.m[MOTOR_3].microsteps,	M3_MICROSTEPS )
+	CFG("3","3po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st.m[MOTOR_3].polarity,		M3_POLARITY )
+	CFG("3","3pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st.m[MOTOR_3].power_mode,	M3_POWER_MODE )
+	CFG("3","3gs",_fip, 0, st_print_gs, get_ui8, st_set_gs, (float *)&st.m[MOTOR_3].gantry_switch,	M3_GANTRY_SWITCH )
+	CFG("3","3pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st.m[MOTOR_3].power_level,	M3_POWER_LEVEL )
+	CFG("3","3pi",_fip, 3, st_print_pi, get_flt, st_set_pl, (float *)&st.m[MOTOR_3].power_idle,	M3_POWER_IDLE )
+	CFG("3","3ot",_fip, 0, sv_print_ot, get_ui8, sv_set_ot, (float *)&st.m[MOTOR_3].output,		M3_OUTPUT )
+	CFG("3","3mp",_f00, 0, st_print_mp, st_get_mp, set_nul,(float *)&cs.null, 0 )
+#endif
+#if (MOTORS >= 4)
+	CFG("4","4ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st.m[MOTOR_4].motor_map,	M4_MOTOR_MAP )
+	CFG("4","4sa",_fip, 2, st_print_sa, get_flt, st_set_sa, (float *)&st.m[MOTOR_4].step_angle,	M4_STEP_ANGLE )
+	CFG("4","4tr",_fip, 3, st_print_tr, get_flu, st_set_tr, (float *)&st.m[MOTOR_4].travel_rev,	M4_TRAVEL_PER_REV )
+	CFG("4","4mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st.m[MOTOR_4].microsteps,	M4_MICROSTEPS )
+	CFG("4","4po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st.m[MOTOR_4].polarity,		M4_POLARITY )
+	CFG("4","4pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st.m[MOTOR_4].power_mode,	M4_POWER_MODE )
+	CFG("4","4gs",_fip, 0, st_print_gs, get_ui8, st_set_gs, (float *)&st.m[MOTOR_4].gantry_switch,	M4_GANTRY_SWITCH )
+	CFG("4","4pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st.m[MOTOR_4].power_level,	M4_POWER_LEVEL )
+	CFG("4","4pi",_fip, 3, st_print_pi, get_flt, st_set_pl, (float *)&st.m[MOTOR_4].power_idle,	M4_POWER_IDLE )
+	CFG("4","4ot",_fip, 0, sv_print_ot, get_ui8, sv_set_ot, (float *)&st.m[MOTOR_4].output,		M4_OUTPUT )
+	CFG("4","4mp",_f00, 0, st_print_mp, st_get_mp, set_nul,(float *)&cs.null, 0 )
+#endif
+#if (MOTORS >= 5)
+	CFG("5","5ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st.m[MOTOR_5].motor_map,	M5_MOTOR_MAP )
+	CFG("5","5sa",_fip, 2, st_print_sa, get_flt, st_set_sa, (float *)&st.m[MOTOR_5].step_angle,	M5_STEP_ANGLE )
+	CFG("5","5tr",_fip, 3, st_print_tr, get_flu, st_set_tr, (float *)&st.m[MOTOR_5].travel_rev,	M5_TRAVEL_PER_REV )
+	CFG("5","5mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st.m[MOTOR_5].microsteps,	M5_MICROSTEPS )
+	CFG("5","5po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st.m[MOTOR_5].polarity,		M5_POLARITY )
+	CFG("5","5pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st.m[MOTOR_5].power_mode,	M5_POWER_MODE )
+	CFG("5","5gs",_fip, 0, st_print_gs, get_ui8, st_set_gs, (float *)&st.m[MOTOR_5].gantry_switch,	M5_GANTRY_SWITCH )
+	CFG("5","5pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st.m[MOTOR_5].power_level,	M5_POWER_LEVEL )
+	CFG("5","5pi",_fip, 3, st_print_pi, get_flt, st_set_pl, (float *)&st.m[MOTOR_5].power_idle,	M5_POWER_IDLE )
+	CFG("5","5ot",_fip, 0, sv_print_ot, get_ui8, sv_set_ot, (float *)&st.m[MOTOR_5].output,		M5_OUTPUT )
+	CFG("5","5mp",_f00, 0, st_print_mp, st_get_mp, set_nul,(float *)&cs.null, 0 )
+#endif
+#if (MOTORS >= 6)
+	CFG("6","6ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st.m[MOTOR_6].motor_map,	M6_MOTOR_MAP )
+	CFG("6","6sa",_fip, 2, st_print_sa, get_flt, st_set_sa, (float *)&st.m[MOTOR_6].step_angle,	M6_STEP_ANGLE )
+	CFG("6","6tr",_fip, 3, st_print_tr, get_flu, st_set_tr, (float *)&st.m[MOTOR_6].travel_rev,	M6_TRAVEL_PER_REV )
+	CFG("6","6mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st.m[MOTOR_6].microsteps,	M6_MICROSTEPS )
+	CFG("6","6po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st.m[MOTOR_6].polarity,		M6_POLARITY )
+	CFG("6","6pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st.m[MOTOR_6].power_mode,	M6_POWER_MODE )
+	CFG("6","6gs",_fip, 0, st_print_gs, get_ui8, st_set_gs, (float *)&st.m[MOTOR_6].gantry_switch,	M6_GANTRY_SWITCH )
+	CFG("6","6pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st.m[MOTOR_6].power_level,	M6_POWER_LEVEL )
+	CFG("6","6pi",_fip, 3, st_print_pi, get_flt, st_set_pl, (float *)&st.m[MOTOR_6].power_idle,	M6_POWER_IDLE )
+	CFG("6","6ot",_fip, 0, sv_print_ot, get_ui8, sv_set_ot, (float *)&st.m[MOTOR_6].output,		M6_OUTPUT )
+	CFG("6","6mp",_f00, 0, st_print_mp, st_get_mp, set_nul,(float *)&cs.null, 0 )
+#endif
+#if (MOTORS >= 7)
+	CFG("7","7ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st.m[MOTOR_7].motor_map,	M7_MOTOR_MAP )
+	CFG("7","7sa",_fip, 2, st_print_sa, get_flt, st_set_sa, (float *)&st.m[MOTOR_7].step_angle,	M7_STEP_ANGLE )
+	CFG("7","7tr",_fip, 3, st_print_tr, get_flu, st_set_tr, (float *)&st.m[MOTOR_7].travel_rev,	M7_TRAVEL_PER_REV )
+	CFG("7","7mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st.m[MOTOR_7].microsteps,	M7_MICROSTEPS )
+	CFG("7","7po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st.m[MOTOR_7].polarity,		M7_POLARITY )
+	CFG("7","7pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st.m[MOTOR_7].power_mode,	M7_POWER_MODE )
+	CFG("7","7gs",_fip, 0, st_print_gs, get_ui8, st_set_gs, (float *)&st.m[MOTOR_7].gantry_switch,	M7_GANTRY_SWITCH )
+	CFG("7","7pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st.m[MOTOR_7].power_level,	M7_POWER_LEVEL )
+	CFG("7","7pi",_fip, 3, st_print_pi, get_flt, st_set_pl, (float *)&st.m[MOTOR_7].power_idle,	M7_POWER_IDLE )
+	CFG("7","7ot",_fip, 0, sv_print_ot, get_ui8, sv_set_ot, (float *)&st.m[MOTOR_7].output,		M7_OUTPUT )
+	CFG("7","7mp",_f00, 0, st_print_mp, st_get_mp, set_nul,(float *)&cs.null, 0 )
+#endif
+#if (MOTORS >= 8)
+	CFG("8","8ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st.m[MOTOR_8].motor_map,	M8_MOTOR_MAP )
+	CFG("8","8sa",_fip, 2, st_print_sa, get_flt, st_set_sa, (float *)&st.m[MOTOR_8].step_angle,	M8_STEP_ANGLE )
+	CFG("8","8tr",_fip, 3, st_print_tr, get_flu, st_set_tr, (float *)&st.m[MOTOR_8].travel_rev,	M8_TRAVEL_PER_REV )
+	CFG("8","8mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st.m[MOTOR_8].microsteps,	M8_MICROSTEPS )
+	CFG("8","8po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st.m[MOTOR_8].polarity,		M8_POLARITY )
+	CFG("8","8pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st.m[MOTOR_8].power_mode,	M8_POWER_MODE )
+	CFG("8","8gs",_fip, 0, st_print_gs, get_ui8, st_set_gs, (float *)&st.m[MOTOR_8].gantry_switch,	M8_GANTRY_SWITCH )
+	CFG("8","8pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st.m[MOTOR_8].power_level,	M8_POWER_LEVEL )
+	CFG("8","8pi",_fip, 3, st_print_pi, get_flt, st_set_pl, (float *)&st.m[MOTOR_8].power_idle,	M8_POWER_IDLE )
+	CFG("8","8ot",_fip, 0, sv_print_ot, get_ui8, sv_set_ot, (float *)&st.m[MOTOR_8].output,		M8_OUTPUT )
+	CFG("8","8mp",_f00, 0, st_print_mp, st_get_mp, set_nul,(float *)&cs.null, 0 )
+#endif
+
+	// Axis parameters
+	CFG("x","xam",_fip, 0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_X].axis_mode,		X_AXIS_MODE )
+	CFG("x","xvm",_fip, 0, cm_print_vm, get_flu,   cm_set_vm, (float *)&cm.a[AXIS_X].velocity_max,	X_VELOCITY_MAX )
+	CFG("x","xfr",_fip, 0, cm_print_fr, get_flu,   cm_set_fr, (float *)&cm.a[AXIS_X].feedrate_max,	X_FEEDRATE_MAX )
+	CFG("x","xvs",_f00, 0, cm_print_vs, get_flu,   set_nul,   (float *)&cm.step_velocity_max[AXIS_X],0 )
+	CFG("x","xtm",_fip, 0, cm_print_tm, get_flu,   set_flu,   (float *)&cm.a[AXIS_X].travel_max,		X_TRAVEL_MAX )
+	CFG("x","xjm",_fip, 0, cm_print_jm, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_X].jerk_max,		X_JERK_MAX )
+	CFG("x","xjh",_fip, 0, cm_print_jh, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_X].jerk_homing,		X_JERK_HOMING )
+	CFG("x","xjd",_fip, 4, cm_print_jd, get_flu,   cm_set_jd, (float *)&cm.a[AXIS_X].junction_dev,	X_JUNCTION_DEVIATION )
+	CFG("x","xsn",_fip, 0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_X][SW_MIN].mode,	X_SWITCH_MODE_MIN )
+	CFG("x","xsx",_fip, 0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_X][SW_MAX].mode,	X_SWITCH_MODE_MAX )
+	CFG("x","xsv",_fip, 0, cm_print_sv, get_flu,   set_flu,   (float *)&cm.a[AXIS_X].search_velocity,	X_SEARCH_VELOCITY )
+	CFG("x","xlv",_fip, 0, cm_print_lv, get_flu,   set_flu,   (float *)&cm.a[AXIS_X].latch_velocity,	X_LATCH_VELOCITY )
+	CFG("x","xlb",_fip, 3, cm_print_lb, get_flu,   set_flu,   (float *)&cm.a[AXIS_X].latch_backoff,	X_LATCH_BACKOFF )
+	CFG("x","xzb",_fip, 3, cm_print_zb, get_flu,   set_flu,   (float *)&cm.a[AXIS_X].zero_backoff,	X_ZERO_BACKOFF )
+	CFG("x","xhg",_fip, 0, cm_print_hg, get_ui8,   set_0123,  (float *)&cm.a[AXIS_X].homing_group,	X_HOMING_GROUP )
+	CFG("x","xif",_fip, 1, sh_print_if, get_flt,   sh_set_if, (float *)&sh.frequency[AXIS_X],		X_SHAPER_FREQUENCY )
+	CFG("x","xid",_fip, 3, sh_print_id, get_flt,   sh_set_id, (float *)&sh.damping[AXIS_X],			X_SHAPER_DAMPING )
+	CFG("x","xbl",_fip, 4, cm_print_bl, get_flu,   cm_set_bl, (float *)&cm.a[AXIS_X].backlash,		X_BACKLASH )
+
+	CFG("y","yam",_fip, 0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_Y].axis_mode,		Y_AXIS_MODE )
+	CFG("y","yvm",_fip, 0, cm_print_vm, get_flu,   cm_set_vm, (float *)&cm.a[AXIS_Y].velocity_max,	Y_VELOCITY_MAX )
+	CFG("y","yfr",_fip, 0, cm_print_fr, get_flu,   cm_set_fr, (float *)&cm.a[AXIS_Y].feedrate_max,	Y_FEEDRATE_MAX )
+	CFG("y","yvs",_f00, 0, cm_print_vs, get_flu,   set_nul,   (float *)&cm.step_velocity_max[AXIS_Y],0 )
+	CFG("y","ytm",_fip, 0, cm_print_tm, get_flu,   set_flu,   (float *)&cm.a[AXIS_Y].travel_max,		Y_TRAVEL_MAX )
+	CFG("y","yjm",_fip, 0, cm_print_jm, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_Y].jerk_max,		Y_JERK_MAX )
+	CFG("y","yjh",_fip, 0, cm_print_jh, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_Y].jerk_homing,		Y_JERK_HOMING )
+	CFG("y","yjd",_fip, 4, cm_print_jd, get_flu,   cm_set_jd, (float *)&cm.a[AXIS_Y].junction_dev,	Y_JUNCTION_DEVIATION )
+	CFG("y","ysn",_fip, 0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_Y][SW_MIN].mode,	Y_SWITCH_MODE_MIN )
+	CFG("y","ysx",_fip, 0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_Y][SW_MAX].mode,	Y_SWITCH_MODE_MAX )
+	CFG("y","ysv",_fip, 0, cm_print_sv, get_flu,   set_flu,   (float *)&cm.a[AXIS_Y].search_velocity,	Y_SEARCH_VELOCITY )
+	CFG("y","ylv",_fip, 0, cm_print_lv, get_flu,   set_flu,   (float *)&cm.a[AXIS_Y].latch_velocity,	Y_LATCH_VELOCITY )
+	CFG("y","ylb",_fip, 3, cm_print_lb, get_flu,   set_flu,   (float *)&cm.a[AXIS_Y].latch_backoff,	Y_LATCH_BACKOFF )
+	CFG("y","yzb",_fip, 3, cm_print_zb, get_flu,   set_flu,   (float *)&cm.a[AXIS_Y].zero_backoff,	Y_ZERO_BACKOFF )
+	CFG("y","yhg",_fip, 0, cm_print_hg, get_ui8,   set_0123,  (float *)&cm.a[AXIS_Y].homing_group,	Y_HOMING_GROUP )
+	CFG("y","yif",_fip, 1, sh_print_if, get_flt,   sh_set_if, (float *)&sh.frequency[AXIS_Y],		Y_SHAPER_FREQUENCY )
+	CFG("y","yid",_fip, 3, sh_print_id, get_flt,   sh_set_id, (float *)&sh.damping[AXIS_Y],			Y_SHAPER_DAMPING )
+	CFG("y","ybl",_fip, 4, cm_print_bl, get_flu,   cm_set_bl, (float *)&cm.a[AXIS_Y].backlash,		Y_BACKLASH )
+
+	CFG("z","zam",_fip, 0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_Z].axis_mode,		Z_AXIS_MODE )
+	CFG("z","zvm",_fip, 0, cm_print_vm, get_flu,   cm_set_vm, (float *)&cm.a[AXIS_Z].velocity_max,	Z_VELOCITY_MAX )
+	CFG("z","zfr",_fip, 0, cm_print_fr, get_flu,   cm_set_fr, (float *)&cm.a[AXIS_Z].feedrate_max,	Z_FEEDRATE_MAX )
+	CFG("z","zvs",_f00, 0, cm_print_vs, get_flu,   set_nul,   (float *)&cm.step_velocity_max[AXIS_Z],0 )
+	CFG("z","ztm",_fip, 0, cm_print_tm, get_flu,   set_flu,   (float *)&cm.a[AXIS_Z].travel_max,		Z_TRAVEL_MAX )
+	CFG("z","zjm",_fip, 0, cm_print_jm, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_Z].jerk_max,		Z_JERK_MAX )
+	CFG("z","zjh",_fip, 0, cm_print_jh, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_Z].jerk_homing, 	Z_JERK_HOMING )
+	CFG("z","zjd",_fip, 4, cm_print_jd, get_flu,   cm_set_jd, (float *)&cm.a[AXIS_Z].junction_dev,	Z_JUNCTION_DEVIATION )
+	CFG("z","zsn",_fip, 0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_Z][SW_MIN].mode,	Z_SWITCH_MODE_MIN )
+	CFG("z","zsx",_fip, 0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_Z][SW_MAX].mode,	Z_SWITCH_MODE_MAX )
+	CFG("z","zsv",_fip, 0, cm_print_sv, get_flu,   set_flu,   (float *)&cm.a[AXIS_Z].search_velocity,	Z_SEARCH_VELOCITY )
+	CFG("z","zlv",_fip, 0, cm_print_lv, get_flu,   set_flu,   (float *)&cm.a[AXIS_Z].latch_velocity,	Z_LATCH_VELOCITY )
+	CFG("z","zlb",_fip, 3, cm_print_lb, get_flu,   set_flu,   (float *)&cm.a[AXIS_Z].latch_backoff,	Z_LATCH_BACKOFF )
+	CFG("z","zzb",_fip, 3, cm_print_zb, get_flu,   set_flu,   (float *)&cm.a[AXIS_Z].zero_backoff,	Z_ZERO_BACKOFF )
+	CFG("z","zhg",_fip, 0, cm_print_hg, get_ui8,   set_0123,  (float *)&cm.a[AXIS_Z].homing_group,	Z_HOMING_GROUP )
+	CFG("z","zif",_fip, 1, sh_print_if, get_flt,   sh_set_if, (float *)&sh.frequency[AXIS_Z],		Z_SHAPER_FREQUENCY )
+	CFG("z","zid",_fip, 3, sh_print_id, get_flt,   sh_set_id, (float *)&sh.damping[AXIS_Z],			Z_SHAPER_DAMPING )
+	CFG("z","zbl",_fip, 4, cm_print_bl, get_flu,   cm_set_bl, (float *)&cm.a[AXIS_Z].backlash,		Z_BACKLASH )
+
+#if (AXES > AXIS_A)
+	CFG("a","aam",_fip, 0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_A].axis_mode,		A_AXIS_MODE )
+	CFG("a","avm",_fip, 0, cm_print_vm, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_A].velocity_max,	A_VELOCITY_MAX )
+	CFG("a","afr",_fip, 0, cm_print_fr, get_flt,   cm_set_fr, (float *)&cm.a[AXIS_A].feedrate_max,	A_FEEDRATE_MAX )
+	CFG("a","avs",_f00, 0, cm_print_vs, get_flt,   set_nul,   (float *)&cm.step_velocity_max[AXIS_A],0 )
+	CFG("a","atm",_fip, 0, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].travel_max,		A_TRAVEL_MAX )
+	CFG("a","ajm",_fip, 0, cm_print_jm, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_A].jerk_max,		A_JERK_MAX )
+	CFG("a","ajh",_fip, 0, cm_print_jh, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_A].jerk_homing, 	A_JERK_HOMING )
+	CFG("a","ajd",_fip, 4, cm_print_jd, get_flt,   cm_set_jd, (float *)&cm.a[AXIS_A].junction_dev,	A_JUNCTION_DEVIATION )
+	CFG("a","ara",_fip, 3, cm_print_ra, get_flt,   cm_set_ra, (float *)&cm.a[AXIS_A].radius,			A_RADIUS)
+	CFG("a","asn",_fip, 0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_A][SW_MIN].mode,	A_SWITCH_MODE_MIN )
+	CFG("a","asx",_fip, 0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_A][SW_MAX].mode,	A_SWITCH_MODE_MAX )
+	CFG("a","asv",_fip, 0, cm_print_sv, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].search_velocity,	A_SEARCH_VELOCITY )
+	CFG("a","alv",_fip, 0, cm_print_lv, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].latch_velocity,	A_LATCH_VELOCITY )
+	CFG("a","alb",_fip, 3, cm_print_lb, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].latch_backoff,	A_LATCH_BACKOFF )
+	CFG("a","azb",_fip, 3, cm_print_zb, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].zero_backoff,	A_ZERO_BACKOFF )
+	CFG("a","ahg",_fip, 0, cm_print_hg, get_ui8,   set_0123,  (float *)&cm.a[AXIS_A].homing_group,	A_HOMING_GROUP )
+	CFG("a","aif",_fip, 1, sh_print_if, get_flt,   sh_set_if, (float *)&sh.frequency[AXIS_A],		A_SHAPER_FREQUENCY )
+	CFG("a","aid",_fip, 3, sh_print_id, get_flt,   sh_set_id, (float *)&sh.damping[AXIS_A],			A_SHAPER_DAMPING )
+	CFG("a","abl",_fip, 4, cm_print_bl, get_flt,   cm_set_bl, (float *)&cm.a[AXIS_A].backlash,		A_BACKLASH )
+#endif
+
+#if (AXES > AXIS_B)
+	CFG("b","bam",_fip, 0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_B].axis_mode,		B_AXIS_MODE )
+	CFG("b","bvm",_fip, 0, cm_print_vm, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_B].velocity_max,	B_VELOCITY_MAX )
+	CFG("b","bfr",_fip, 0, cm_print_fr, get_flt,   cm_set_fr, (float *)&cm.a[AXIS_B].feedrate_max,	B_FEEDRATE_MAX )
+	CFG("b","bvs",_f00, 0, cm_print_vs, get_flt,   set_nul,   (float *)&cm.step_velocity_max[AXIS_B],0 )
+	CFG("b","btm",_fip, 0, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].travel_max,		B_TRAVEL_MAX )
+	CFG("b","bjm",_fip, 0, cm_print_jm, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_B].jerk_max,		B_JERK_MAX )
+	CFG("b","bjd",_fip, 0, cm_print_jd, get_flt,   cm_set_jd, (float *)&cm.a[AXIS_B].junction_dev,	B_JUNCTION_DEVIATION )
+	CFG("b","bra",_fip, 3, cm_print_ra, get_flt,   cm_set_ra, (float *)&cm.a[AXIS_B].radius,			B_RADIUS )
+#ifdef __ARM	// B axis extended paramters
+	CFG("b","asn",_fip, 0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_B][SW_MIN].mode,	B_SWITCH_MODE_MIN )
+	CFG("b","asx",_fip, 0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_B][SW_MAX].mode,	B_SWITCH_MODE_MAX )
+	CFG("b","bsv",_fip, 0, cm_print_sv, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].search_velocity,	B_SEARCH_VELOCITY )
+	CFG("b","blv",_fip, 0, cm_print_lv, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].latch_velocity,	B_LATCH_VELOCITY )
+	CFG("b","blb",_fip, 3, cm_print_lb, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].latch_backoff,	B_LATCH_BACKOFF )
+	CFG("b","bzb",_fip, 3, cm_print_zb, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].zero_backoff,	B_ZERO_BACKOFF )
+	CFG("b","bjh",_fip, 0, cm_print_jh, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_B].jerk_homing,		B_JERK_HOMING )
+	CFG("b","bif",_fip, 1, sh_print_if, get_flt,   sh_set_if, (float *)&sh.frequency[AXIS_B],		B_SHAPER_FREQUENCY )
+	CFG("b","bid",_fip, 3, sh_print_id, get_flt,   sh_set_id, (float *)&sh.damping[AXIS_B],			B_SHAPER_DAMPING )
+	CFG("b","bbl",_fip, 4, cm_print_bl, get_flt,   cm_set_bl, (float *)&cm.a[AXIS_B].backlash,		B_BACKLASH )
+#endif
+#endif
+
+#if (AXES > AXIS_C)
+	CFG("c","cam",_fip, 0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_C].axis_mode,		C_AXIS_MODE )
+	CFG("c","cvm",_fip, 0, cm_print_vm, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_C].velocity_max,	C_VELOCITY_MAX )
+	CFG("c","cfr",_fip, 0, cm_print_fr, get_flt,   cm_set_fr, (float *)&cm.a[AXIS_C].feedrate_max,	C_FEEDRATE_MAX )
+	CFG("c","cvs",_f00, 0, cm_print_vs, get_flt,   set_nul,   (float *)&cm.step_velocity_max[AXIS_C],0 )
+	CFG("c","ctm",_fip, 0, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].travel_max,		C_TRAVEL_MAX )
+	CFG("c","cjm",_fip, 0, cm_print_jm, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_C].jerk_max,		C_JERK_MAX )
+	CFG("c","cjd",_fip, 0, cm_print_jd, get_flt,   cm_set_jd, (float *)&cm.a[AXIS_C].junction_dev,	C_JUNCTION_DEVIATION )
+	CFG("c","cra",_fip, 3, cm_print_ra, get_flt,   cm_set_ra, (float *)&cm.a[AXIS_C].radius,			C_RADIUS )
+#ifdef __ARM	// C axis extended paramters
+	CFG("c","csn",_fip, 0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_C][SW_MIN].mode,	C_SWITCH_MODE_MIN )
+	CFG("c","csx",_fip, 0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_C][SW_MAX].mode,	C_SWITCH_MODE_MAX )
+	CFG("c","csv",_fip, 0, cm_print_sv, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].search_velocity,	C_SEARCH_VELOCITY )
+	CFG("c","clv",_fip, 0, cm_print_lv, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].latch_velocity,	C_LATCH_VELOCITY )
+	CFG("c","clb",_fip, 3, cm_print_lb, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].latch_backoff,	C_LATCH_BACKOFF )
+	CFG("c","czb",_fip, 3, cm_print_zb, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].zero_backoff,	C_ZERO_BACKOFF )
+	CFG("c","cjh",_fip, 0, cm_print_jh, cm_get_jrk,cm_set_jrk,(float *)&cm.a[AXIS_C].jerk_homing, 	C_JERK_HOMING )
+	CFG("c","cif",_fip, 1, sh_print_if, get_flt,   sh_set_if, (float *)&sh.frequency[AXIS_C],		C_SHAPER_FREQUENCY )
+	CFG("c","cid",_fip, 3, sh_print_id, get_flt,   sh_set_id, (float *)&sh.damping[AXIS_C],			C_SHAPER_DAMPING )
+	CFG("c","cbl",_fip, 4, cm_print_bl, get_flt,   cm_set_bl, (float *)&cm.a[AXIS_C].backlash,		C_BACKLASH )
+#endif
+#endif
+/*
+	// PWM settings
+	CFG("p1","p1frq",_fip, 0, pwm_print_p1frq, get_flt, pwm_set_pwm,(float *)&pwm.c[PWM_1].frequency,		P1_PWM_FREQUENCY )
+	CFG("p1","p1csl",_fip, 0, pwm_print_p1csl, get_flt, set_flt,(float *)&pwm.c[PWM_1].cw_speed_lo,	P1_CW_SPEED_LO )
+	CFG("p1","p1csh",_fip, 0, pwm_print_p1csh, get_flt, set_flt,(float *)&pwm.c[PWM_1].cw_speed_hi,	P1_CW_SPEED_HI )
+	CFG("p1","p1cpl",_fip, 3, pwm_print_p1cpl, get_flt, set_flt,(float *)&pwm.c[PWM_1].cw_phase_lo,	P1_CW_PHASE_LO )
+	CFG("p1","p1cph",_fip, 3, pwm_print_p1cph, get_flt, set_flt,(float *)&pwm.c[PWM_1].cw_phase_hi,	P1_CW_PHASE_HI )
+	CFG("p1","p1wsl",_fip, 0, pwm_print_p1wsl, get_flt, set_flt,(float *)&pwm.c[PWM_1].ccw_speed_lo,	P1_CCW_SPEED_LO )
+	CFG("p1","p1wsh",_fip, 0, pwm_print_p1wsh, get_flt, set_flt,(float *)&pwm.c[PWM_1].ccw_speed_hi,	P1_CCW_SPEED_HI )
+	CFG("p1","p1wpl",_fip, 3, pwm_print_p1wpl, get_flt, set_flt,(float *)&pwm.c[PWM_1].ccw_phase_lo,	P1_CCW_PHASE_LO )
+	CFG("p1","p1wph",_fip, 3, pwm_print_p1wph, get_flt, set_flt,(float *)&pwm.c[PWM_1].ccw_phase_hi,	P1_CCW_PHASE_HI )
+	CFG("p1","p1pof",_fip, 3, pwm_print_p1pof, get_flt, set_flt,(float *)&pwm.c[PWM_1].phase_off,		P1_PWM_PHASE_OFF )
+	CFG("p1","p1dyn",_fip, 0, pwm_print_p1dyn, get_ui8, set_01, (float *)&pwm.c[PWM_1].dynamic_power,	P1_DYNAMIC_POWER )
+*/
+	// Coordinate system offsets (G54-G59 and G92)
+	CFG("g54","g54x",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G54][AXIS_X], G54_X_OFFSET )
+	CFG("g54","g54y",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G54][AXIS_Y], G54_Y_OFFSET )
+	CFG("g54","g54z",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G54][AXIS_Z], G54_Z_OFFSET )
+#if (AXES > AXIS_A)
+	CFG("g54","g54a",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G54][AXIS_A], G54_A_OFFSET )
+#endif
+#if (AXES > AXIS_B)
+	CFG("g54","g54b",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G54][AXIS_B], G54_B_OFFSET )
+#endif
+#if (AXES > AXIS_C)
+	CFG("g54","g54c",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G54][AXIS_C], G54_C_OFFSET )
+#endif
+
+	CFG("g55","g55x",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G55][AXIS_X], G55_X_OFFSET )
+	CFG("g55","g55y",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G55][AXIS_Y], G55_Y_OFFSET )
+	CFG("g55","g55z",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G55][AXIS_Z], G55_Z_OFFSET )
+#if (AXES > AXIS_A)
+	CFG("g55","g55a",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G55][AXIS_A], G55_A_OFFSET )
+#endif
+#if (AXES > AXIS_B)
+	CFG("g55","g55b",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G55][AXIS_B], G55_B_OFFSET )
+#endif
+#if (AXES > AXIS_C)
+	CFG("g55","g55c",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G55][AXIS_C], G55_C_OFFSET )
+#endif
+
+	CFG("g56","g56x",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G56][AXIS_X], G56_X_OFFSET )
+	CFG("g56","g56y",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G56][AXIS_Y], G56_Y_OFFSET )
+	CFG("g56","g56z",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G56][AXIS_Z], G56_Z_OFFSET )
+#if (AXES > AXIS_A)
+	CFG("g56","g56a",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G56][AXIS_A], G56_A_OFFSET )
+#endif
+#if (AXES > AXIS_B)
+	CFG("g56","g56b",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G56][AXIS_B], G56_B_OFFSET )
+#endif
+#if (AXES > AXIS_C)
+	CFG("g56","g56c",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G56][AXIS_C], G56_C_OFFSET )
+#endif
+
+	CFG("g57","g57x",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G57][AXIS_X], G57_X_OFFSET )
+	CFG("g57","g57y",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G57][AXIS_Y], G57_Y_OFFSET )
+	CFG("g57","g57z",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G57][AXIS_Z], G57_Z_OFFSET )
+#if (AXES > AXIS_A)
+	CFG("g57","g57a",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G57][AXIS_A], G57_A_OFFSET )
+#endif
+#if (AXES > AXIS_B)
+	CFG("g57","g57b",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G57][AXIS_B], G57_B_OFFSET )
+#endif
+#if (AXES > AXIS_C)
+	CFG("g57","g57c",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G57][AXIS_C], G57_C_OFFSET )
+#endif
+
+	CFG("g58","g58x",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G58][AXIS_X], G58_X_OFFSET )
+	CFG("g58","g58y",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G58][AXIS_Y], G58_Y_OFFSET )
+	CFG("g58","g58z",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G58][AXIS_Z], G58_Z_OFFSET )
+#if (AXES > AXIS_A)
+	CFG("g58","g58a",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G58][AXIS_A], G58_A_OFFSET )
+#endif
+#if (AXES > AXIS_B)
+	CFG("g58","g58b",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G58][AXIS_B], G58_B_OFFSET )
+#endif
+#if (AXES > AXIS_C)
+	CFG("g58","g58c",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G58][AXIS_C], G58_C_OFFSET )
+#endif
+
+	CFG("g59","g59x",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G59][AXIS_X], G59_X_OFFSET )
+	CFG("g59","g59y",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G59][AXIS_Y], G59_Y_OFFSET )
+	CFG("g59","g59z",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G59][AXIS_Z], G59_Z_OFFSET )
+#if (AXES > AXIS_A)
+	CFG("g59","g59a",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G59][AXIS_A], G59_A_OFFSET )
+#endif
+#if (AXES > AXIS_B)
+	CFG("g59","g59b",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G59][AXIS_B], G59_B_OFFSET )
+#endif
+#if (AXES > AXIS_C)
+	CFG("g59","g59c",_fip, 3, cm_print_cofs, get_flu, cm_set_cofs,(float *)&cm.offset[G59][AXIS_C], G59_C_OFFSET )
+#endif
+
+	CFG("g92","g92x",_fin, 3, cm_print_cofs, get_flu, set_nul,(float *)&gmx.origin_offset[AXIS_X], 0 )// G92 handled differently
+	CFG("g92","g92y",_fin, 3, cm_print_cofs, get_flu, set_nul,(float *)&gmx.origin_offset[AXIS_Y], 0 )
+	CFG("g92","g92z",_fin, 3, cm_print_cofs, get_flu, set_nul,(float *)&gmx.origin_offset[AXIS_Z], 0 )
+#if (AXES > AXIS_A)
+	CFG("g92","g92a",_fin, 3, cm_print_cofs, get_flt, set_nul,(float *)&gmx.origin_offset[AXIS_A], 0 )
+#endif
+#if (AXES > AXIS_B)
+	CFG("g92","g92b",_fin, 3, cm_print_cofs, get_flt, set_nul,(float *)&gmx.origin_offset[AXIS_B], 0 )
+#endif
+#if (AXES > AXIS_C)
+	CFG("g92","g92c",_fin, 3, cm_print_cofs, get_flt, set_nul,(float *)&gmx.origin_offset[AXIS_C], 0 )
+#endif
+
+	// Coordinate positions (G28, G30)
+	CFG("g28","g28x",_fin, 3, cm_print_cpos, get_flu, set_nul,(float *)&gmx.g28_position[AXIS_X], 0 )// g28 handled differently
+	CFG("g28","g28y",_fin, 3, cm_print_cpos, get_flu, set_nul,(float *)&gmx.g28_position[AXIS_Y], 0 )
+	CFG("g28","g28z",_fin, 3, cm_print_cpos, get_flu, set_nul,(float *)&gmx.g28_position[AXIS_Z], 0 )
+#if (AXES > AXIS_A)
+	CFG("g28","g28a",_fin, 3, cm_print_cpos, get_flt, set_nul,(float *)&gmx.g28_position[AXIS_A], 0 )
+#endif
+#if (AXES > AXIS_B)
+	CFG("g28","g28b",_fin, 3, cm_print_cpos, get_flt, set_nul,(float *)&gmx.g28_position[AXIS_B], 0 )
+#endif
+#if (AXES > AXIS_C)
+	CFG("g28","g28c",_fin, 3, cm_print_cpos, get_flt, set_nul,(float *)&gmx.g28_position[AXIS_C], 0 )
+#endif
+
+	CFG("g30","g30x",_fin, 3, cm_print_cpos, get_flu, set_nul,(float *)&gmx.g30_position[AXIS_X], 0 )// g30 handled differently
+	CFG("g30","g30y",_fin, 3, cm_print_cpos, get_flu, set_nul,(float *)&gmx.g30_position[AXIS_Y], 0 )
+	CFG("g30","g30z",_fin, 3, cm_print_cpos, get_flu, set_nul,(float *)&gmx.g30_position[AXIS_Z], 0 )
+#if (AXES > AXIS_A)
+	CFG("g30","g30a",_fin, 3, cm_print_cpos, get_flt, set_nul,(float *)&gmx.g30_position[AXIS_A], 0 )
+#endif
+#if (AXES > AXIS_B)
+	CFG("g30","g30b",_fin, 3, cm_print_cpos, get_flt, set_nul,(float *)&gmx.g30_position[AXIS_B], 0 )
+#endif
+#if (AXES > AXIS_C)
+	CFG("g30","g30c",_fin, 3, cm_print_cpos, get_flt, set_nul,(float *)&gmx.g30_position[AXIS_C], 0 )
+#endif
+
+	// ISR timing (cycle counts, see stepper.h)
+	CFG("isr","isron",_f00, 0, st_print_isr, st_get_isrn, set_nul,(float *)&st_isr.dda_overflow, 0 )
+	CFG("isr","isrox",_f00, 0, st_print_isr, st_get_isrx, set_nul,(float *)&st_isr.dda_overflow, 0 )
+	CFG("isr","isroa",_f00, 0, st_print_isr, st_get_isra, set_nul,(float *)&st_isr.dda_overflow, 0 )
+	CFG("isr","isrmn",_f00, 0, st_print_isr, st_get_isrn, set_nul,(float *)&st_isr.dda_match, 0 )
+	CFG("isr","isrmx",_f00, 0, st_print_isr, st_get_isrx, set_nul,(float *)&st_isr.dda_match, 0 )
+	CFG("isr","isrma",_f00, 0, st_print_isr, st_get_isra, set_nul,(float *)&st_isr.dda_match, 0 )
+	CFG("isr","isrln",_f00, 0, st_print_isr, st_get_isrn, set_nul,(float *)&st_isr.load, 0 )
+	CFG("isr","isrlx",_f00, 0, st_print_isr, st_get_isrx, set_nul,(float *)&st_isr.load, 0 )
+	CFG("isr","isrla",_f00, 0, st_print_isr, st_get_isra, set_nul,(float *)&st_isr.load, 0 )
+	CFG("isr","isren",_f00, 0, st_print_isr, st_get_isrn, set_nul,(float *)&st_isr.exec, 0 )
+	CFG("isr","isrex",_f00, 0, st_print_isr, st_get_isrx, set_nul,(float *)&st_isr.exec, 0 )
+	CFG("isr","isrea",_f00, 0, st_print_isr, st_get_isra, set_nul,(float *)&st_isr.exec, 0 )
+	CFG("isr","isrjn",_f00, 0, st_print_isr, st_get_isrn, set_nul,(float *)&st_isr.dda_latency, 0 )
+	CFG("isr","isrjx",_f00, 0, st_print_isr, st_get_isrx, set_nul,(float *)&st_isr.dda_latency, 0 )
+	CFG("isr","isrja",_f00, 0, st_print_isr, st_get_isra, set_nul,(float *)&st_isr.dda_latency, 0 )
+	CFG("isr","isrkn",_f00, 0, st_print_isr, st_get_isrn, set_nul,(float *)&st_isr.kinematics, 0 )
+	CFG("isr","isrkx",_f00, 0, st_print_isr, st_get_isrx, set_nul,(float *)&st_isr.kinematics, 0 )
+	CFG("isr","isrka",_f00, 0, st_print_isr, st_get_isra, set_nul,(float *)&st_isr.kinematics, 0 )
+	CFG("",   "isrz", _f00, 0, tx_print_nul, get_nul,     st_set_isrz,(float *)&cs.null, 0 )	// reset ISR timing
+
+	// Controller loop profile - see controller.h
+	CFG("lpn","lpnrs",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[0], 0 )
+	CFG("lpn","lpnal",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[1], 0 )
+	CFG("lpn","lpnsw",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[2], 0 )
+	CFG("lpn","lpnfh",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[3], 0 )
+	CFG("lpn","lpnas",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[4], 0 )
+	CFG("lpn","lpnmp",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[5], 0 )
+	CFG("lpn","lpnsr",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[6], 0 )
+	CFG("lpn","lpnqr",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[7], 0 )
+	CFG("lpn","lpncy",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[8], 0 )
+	CFG("lpn","lpnra",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[9], 0 )
+	CFG("lpn","lpnsy",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[10], 0 )
+	CFG("lpn","lpncd",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[11], 0 )
+	CFG("lpn","lpnid",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[12], 0 )
+	CFG("lpn","lpnex",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[13], 0 )
+	CFG("lpn","lpnfo",_f00, 0, lp_print_lp, lp_get_n, set_nul,(float *)&lp.stage[14], 0 )
+	CFG("lpc","lpcrs",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[0], 0 )
+	CFG("lpc","lpcal",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[1], 0 )
+	CFG("lpc","lpcsw",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[2], 0 )
+	CFG("lpc","lpcfh",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[3], 0 )
+	CFG("lpc","lpcas",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[4], 0 )
+	CFG("lpc","lpcmp",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[5], 0 )
+	CFG("lpc","lpcsr",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[6], 0 )
+	CFG("lpc","lpcqr",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[7], 0 )
+	CFG("lpc","lpccy",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[8], 0 )
+	CFG("lpc","lpcra",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[9], 0 )
+	CFG("lpc","lpcsy",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[10], 0 )
+	CFG("lpc","lpccd",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[11], 0 )
+	CFG("lpc","lpcid",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[12], 0 )
+	CFG("lpc","lpcex",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[13], 0 )
+	CFG("lpc","lpcfo",_f00, 1, lp_print_lp, lp_get_c, set_nul,(float *)&lp.stage[14], 0 )
+	CFG("lpx","lpxrs",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[0], 0 )
+	CFG("lpx","lpxal",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[1], 0 )
+	CFG("lpx","lpxsw",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[2], 0 )
+	CFG("lpx","lpxfh",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[3], 0 )
+	CFG("lpx","lpxas",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[4], 0 )
+	CFG("lpx","lpxmp",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[5], 0 )
+	CFG("lpx","lpxsr",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[6], 0 )
+	CFG("lpx","lpxqr",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[7], 0 )
+	CFG("lpx","lpxcy",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[8], 0 )
+	CFG("lpx","lpxra",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[9], 0 )
+	CFG("lpx","lpxsy",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[10], 0 )
+	CFG("lpx","lpxcd",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[11], 0 )
+	CFG("lpx","lpxid",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[12], 0 )
+	CFG("lpx","lpxex",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[13], 0 )
+	CFG("lpx","lpxfo",_f00, 0, lp_print_lp, lp_get_x, set_nul,(float *)&lp.stage[14], 0 )
+	CFG("lph","lph0",_f00, 0, lp_print_lph, get_int, set_nul,(float *)&lp.pass[0], 0 )
+	CFG("lph","lph1",_f00, 0, lp_print_lph, get_int, set_nul,(float *)&lp.pass[1], 0 )
+	CFG("lph","lph2",_f00, 0, lp_print_lph, get_int, set_nul,(float *)&lp.pass[2], 0 )
+	CFG("lph","lph3",_f00, 0, lp_print_lph, get_int, set_nul,(float *)&lp.pass[3], 0 )
+	CFG("lph","lph4",_f00, 0, lp_print_lph, get_int, set_nul,(float *)&lp.pass[4], 0 )
+	CFG("lph","lph5",_f00, 0, lp_print_lph, get_int, set_nul,(float *)&lp.pass[5], 0 )
+	CFG("lph","lph6",_f00, 0, lp_print_lph, get_int, set_nul,(float *)&lp.pass[6], 0 )
+	CFG("lph","lph7",_f00, 0, lp_print_lph, get_int, set_nul,(float *)&lp.pass[7], 0 )
+	CFG("lph","lph8",_f00, 0, lp_print_lph, get_int, set_nul,(float *)&lp.pass[8], 0 )
+	CFG("lph","lph9",_f00, 0, lp_print_lph, get_int, set_nul,(float *)&lp.pass[9], 0 )
+	CFG("",   "lpz", _f00, 0, tx_print_nul, get_nul,  lp_set_z,(float *)&cs.null, 0 )	// reset loop profile
+
+	// Segment telemetry
+	CFG("seg","segun",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.underruns, 0 )
+	CFG("seg","segul",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.underrun_line, 0 )
+	CFG("seg","seglt",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.late, 0 )
+	CFG("seg","segll",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.late_line, 0 )
+	CFG("seg","segar",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.resets, 0 )
+	CFG("seg","segal",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.reset_line, 0 )
+	CFG("seg","segob",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.overbudget, 0 )
+	CFG("seg","segol",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.overbudget_line, 0 )
+	CFG("seg","segbf",_f00, 2, st_print_seg, get_flt, set_nul,(float *)&mr.segment_backoff, 0 )
+#ifdef __MOTION_SYNC
+	CFG("seg","segsy",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.sync_late, 0 )
+	CFG("seg","segsl",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.sync_late_line, 0 )
+#endif
+	CFG("seg","segrs",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.rescues, 0 )
+	CFG("seg","segrl",_f00, 0, st_print_seg, get_int, set_nul,(float *)&st_seg.rescue_line, 0 )
+
+	// Planner benchmark results (see benchmark.cpp)
+	CFG("bm","bmfl",_f00, 0, bm_print_fl, get_ui8, set_nul,(float *)&bm.file, 0 )
+	CFG("bm","bmbl",_f00, 0, bm_print_bl, get_int, set_nul,(float *)&bm.blocks, 0 )
+	CFG("bm","bmmv",_f00, 0, bm_print_mv, get_int, set_nul,(float *)&bm.moves, 0 )
+	CFG("bm","bmpr",_f00, 0, bm_print_pr, get_flt, set_nul,(float *)&bm.parse_rate, 0 )
+	CFG("bm","bmpl",_f00, 0, bm_print_pl, get_flt, set_nul,(float *)&bm.plan_rate, 0 )
+	CFG("bm","bmpp",_f00, 2, bm_print_pp, get_flt, set_nul,(float *)&bm.pass_length, 0 )
+	CFG("bm","bmpt",_f00, 0, bm_print_pt, get_flt, set_nul,(float *)&bm.planned_time, 0 )
+	CFG("bm","bmwt",_f00, 0, bm_print_wt, get_flt, set_nul,(float *)&bm.wall_time, 0 )
+	CFG("bm","bmjm",_f00, 0, bm_print_jm, get_ui8, set_nul,(float *)&bm.jitter_map, 0 )
+	CFG("bm","bmjb",_f00, 0, bm_print_jb, get_int, set_nul,(float *)&bm.jitter_bytes, 0 )
+	CFG("bm","bmjs",_f00, 0, bm_print_js, get_int, set_nul,(float *)&bm.jitter_samples, 0 )
+	CFG("bm","bmjn",_f00, 0, bm_print_jn, get_int, set_nul,(float *)&bm.latency_min, 0 )
+	CFG("bm","bmjx",_f00, 0, bm_print_jx, get_int, set_nul,(float *)&bm.latency_max, 0 )
+
+	// Preflight results (see preflight.h)
+	CFG("pf","pft", _f00, 1, pf_print_t,  get_flt, set_nul,(float *)&pf.time, 0 )
+	CFG("pf","pfb", _f00, 0, pf_print_b,  get_int, set_nul,(float *)&pf.blocks, 0 )
+	CFG("pf","pfe", _f00, 0, pf_print_e,  get_int, set_nul,(float *)&pf.limit_line, 0 )
+	CFG("pf","pfo", _f00, 0, pf_print_o,  get_int, set_nul,(float *)&pf.limit_targets, 0 )
+	CFG("pf","pfxn",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.min[AXIS_X], 0 )
+	CFG("pf","pfxx",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.max[AXIS_X], 0 )
+	CFG("pf","pfyn",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.min[AXIS_Y], 0 )
+	CFG("pf","pfyx",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.max[AXIS_Y], 0 )
+	CFG("pf","pfzn",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.min[AXIS_Z], 0 )
+	CFG("pf","pfzx",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.max[AXIS_Z], 0 )
+	CFG("pf","pfan",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.min[AXIS_A], 0 )
+	CFG("pf","pfax",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.max[AXIS_A], 0 )
+	CFG("pf","pfbn",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.min[AXIS_B], 0 )
+	CFG("pf","pfbx",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.max[AXIS_B], 0 )
+	CFG("pf","pfcn",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.min[AXIS_C], 0 )
+	CFG("pf","pfcx",_f00, 3, pf_print_env,get_flt, set_nul,(float *)&pf.max[AXIS_C], 0 )
+
+	// Console link test results (see linktest.cpp)
+	CFG("lt","ltm", _f00, 0, lt_print_m,  get_ui8, set_nul,(float *)&lt.mode, 0 )
+	CFG("lt","ltrb",_f00, 0, lt_print_rb, get_int, set_nul,(float *)&lt.rx_bytes, 0 )
+	CFG("lt","lttb",_f00, 0, lt_print_tb, get_int, set_nul,(float *)&lt.tx_bytes, 0 )
+	CFG("lt","ltrr",_f00, 0, lt_print_rr, get_flt, set_nul,(float *)&lt.rx_rate, 0 )
+	CFG("lt","lttr",_f00, 0, lt_print_tr, get_flt, set_nul,(float *)&lt.tx_rate, 0 )
+	CFG("lt","ltpn",_f00, 0, lt_print_pn, get_int, set_nul,(float *)&lt.pings, 0 )
+	CFG("lt","ltpl",_f00, 0, lt_print_pl, get_int, set_nul,(float *)&lt.lost, 0 )
+	CFG("lt","lt50",_f00, 0, lt_print_50, get_int, set_nul,(float *)&lt.latency_p50, 0 )
+	CFG("lt","lt90",_f00, 0, lt_print_90, get_int, set_nul,(float *)&lt.latency_p90, 0 )
+	CFG("lt","lt99",_f00, 0, lt_print_99, get_int, set_nul,(float *)&lt.latency_p99, 0 )
+	CFG("lt","ltpx",_f00, 0, lt_print_px, get_int, set_nul,(float *)&lt.latency_max, 0 )
+
+	// Encoder feedback (see encoder.h)
+	CFG("en","enm", _f07, 0, en_print_m, get_ui8, en_set_m,(float *)&en.en[0].motor,			ENCODER_MOTOR )
+	CFG("en","enr", _f07, 3, en_print_r, get_flt, en_set_r,(float *)&en.en[0].counts_per_step,	ENCODER_COUNTS_PER_STEP )
+	CFG("en","ene", _f07, 2, en_print_e, get_flt, set_flt, (float *)&en.en[0].error_limit,		ENCODER_ERROR_LIMIT )
+	CFG("en","enc", _f00, 0, en_print_c, en_get_c,set_nul, (float *)&cs.null, 0 )
+	CFG("en","end", _f00, 2, en_print_d, get_flt, set_nul, (float *)&en.en[0].error, 0 )
+	CFG("en","enx", _fns, 2, en_print_x, get_flt, set_flt, (float *)&en.en[0].error_max, 0 )
+	CFG("en","enk", _f00, 0, en_print_k, en_get_k,set_nul, (float *)&cs.null, 0 )
+
+	// Adaptive feed from the spindle load (see load_control.h)
+	CFG("lc","lct", _f07, 1, lc_print_t, get_flt, set_flt, (float *)&lc.target,		LOAD_CONTROL_TARGET )
+	CFG("lc","lca", _f07, 1, lc_print_a, get_flt, set_flt, (float *)&lc.air,			LOAD_CONTROL_AIR )
+	CFG("lc","lcg", _f07, 3, lc_print_g, get_flt, set_flt, (float *)&lc.gain,			LOAD_CONTROL_GAIN )
+	CFG("lc","lcf", _f07, 3, lc_print_f, get_flt, set_flt, (float *)&lc.filter_time,	LOAD_CONTROL_FILTER_TIME )
+	CFG("lc","lcn", _f07, 3, lc_print_n, get_flt, set_flt, (float *)&lc.factor_min,	LOAD_CONTROL_FACTOR_MIN )
+	CFG("lc","lcx", _f07, 3, lc_print_x, get_flt, set_flt, (float *)&lc.factor_max,	LOAD_CONTROL_FACTOR_MAX )
+	CFG("lc","lcc", _f07, 0, lc_print_c, get_ui8, lc_set_c,(float *)&lc.channel,		LOAD_CONTROL_CHANNEL )
+	CFG("lc","lcl", _f00, 1, lc_print_l, get_flt, set_nul, (float *)&lc.load, 0 )
+	CFG("lc","lco", _f00, 3, lc_print_o, get_flt, set_nul, (float *)&lc.factor, 0 )
+
+	// Analog servo axes (see servo.h)
+	CFG("ao","aok", _f07, 2, sv_print_k, get_flt, set_flt, (float *)&sv.gain,			SERVO_GAIN )
+	CFG("ao","aoa", _f07, 1, sv_print_fs,get_flt, set_flt, (float *)&sv.full_scale[0],	SERVO_FULL_SCALE_DAC0 )
+	CFG("ao","aob", _f07, 1, sv_print_fs,get_flt, set_flt, (float *)&sv.full_scale[1],	SERVO_FULL_SCALE_DAC1 )
+
+	// Spindle tach (see spindle.h)
+	CFG("sp","spp", _f07, 0, sp_print_pp, get_ui8, sp_set_pp, (float *)&spindle.pulses_per_rev,	SPINDLE_PULSES_PER_REV )
+	CFG("sp","sps", _f00, 0, sp_print_ps, sp_get_sps,set_nul, (float *)&cs.null, 0 )
+	CFG("sp","spu", _f07, 2, sp_print_pu, get_flt, set_flt, (float *)&spindle.spinup_time,	SPINDLE_SPINUP_TIME )
+	CFG("sp","spa", _f07, 0, sp_print_pa, get_flt, set_flt, (float *)&spindle.spinup_speed,	SPINDLE_SPINUP_SPEED )
+
+	// CAN bus (see can.h)
+	CFG("can","canbr",_f07, 0, can_print_br, get_int, can_set_br,(float *)&can.baud,			CAN_BAUD )
+	CFG("can","canid",_f07, 0, can_print_id, get_ui8, can_set_id,(float *)&can.node,			CAN_NODE )
+	CFG("can","cansy",_f07, 0, can_print_sy, get_ui8, set_01,    (float *)&can.sync,			CAN_SYNC )
+	CFG("can","canpr",_f00, 0, can_print_pr, can_get_pr,set_nul, (float *)&cs.null, 0 )
+	CFG("can","canrx",_f00, 0, can_print_rx, get_int, set_nul,   (float *)&can.rx_frames, 0 )
+	CFG("can","cantx",_f00, 0, can_print_tx, get_int, set_nul,   (float *)&can.tx_frames, 0 )
+	CFG("can","caner",_f00, 0, can_print_er, get_int, set_nul,   (float *)&can.errors, 0 )
+
+	// Interrupt priorities in effect - see hardware.h
+	CFG("irq","irqdd",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_DDA], 0 )
+	CFG("irq","irqax",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_AXIS], 0 )
+	CFG("irq","irqld",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_LOAD], 0 )
+	CFG("irq","irqex",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_EXEC], 0 )
+	CFG("irq","irqus",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_USB], 0 )
+	CFG("irq","irqst",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_SYSTICK], 0 )
+	CFG("irq","irqpa",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_PIOA], 0 )
+	CFG("irq","irqpb",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_PIOB], 0 )
+	CFG("irq","irqpc",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_PIOC], 0 )
+	CFG("irq","irqpd",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_PIOD], 0 )
+	CFG("irq","irqtb",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_TIMEBASE], 0 )
+	CFG("irq","irqcn",_f00, 0, hw_print_irq, hw_get_irq, set_nul,(float *)&hw_irqn[HW_IRQ_CAN], 0 )
+
+	// SRAM use - see hardware.h
+	CFG("mem","memsh",_f00, 0, hw_print_mem, hw_get_msh, set_nul,(float *)&cs.null, 0 )
+	CFG("mem","memfr",_f00, 0, hw_print_mem, hw_get_mfr, set_nul,(float *)&cs.null, 0 )
+	CFG("mem","memmb",_f00, 0, hw_print_mem, get_int, set_nul,(float *)&hw_mem_pool[HW_MEM_PLANNER], 0 )
+	CFG("mem","memcl",_f00, 0, hw_print_mem, get_int, set_nul,(float *)&hw_mem_pool[HW_MEM_CMD_LIST], 0 )
+	CFG("mem","memcs",_f00, 0, hw_print_mem, get_int, set_nul,(float *)&hw_mem_pool[HW_MEM_CMD_STRINGS], 0 )
+	CFG("mem","memib",_f00, 0, hw_print_mem, get_int, set_nul,(float *)&hw_mem_pool[HW_MEM_LINE_BUFFERS], 0 )
+
+	// Boot timing - see hardware.h
+	CFG("bt","bthw", _f00, 0, hw_print_bt, get_int, set_nul,(float *)&hw_boot[HW_BOOT_HARDWARE], 0 )
+	CFG("bt","btcf", _f00, 0, hw_print_bt, get_int, set_nul,(float *)&hw_boot[HW_BOOT_CONFIG], 0 )
+	CFG("bt","btin", _f00, 0, hw_print_bt, get_int, set_nul,(float *)&hw_boot[HW_BOOT_INIT], 0 )
+	CFG("bt","btcn", _f00, 0, hw_print_bt, get_int, set_nul,(float *)&hw_boot[HW_BOOT_CONNECT], 0 )
+	CFG("",   "plq",  _f00, 0, mp_print_plq, mp_get_plq, set_nul,(float *)&cs.null, 0 )	// dump the planned queue
+	CFG("",   "segz", _f00, 0, tx_print_nul, get_nul, st_set_segz,(float *)&cs.null, 0 )	// reset segment telemetry
+#ifdef __STEP_TRACE
+	CFG("",   "trc",  _f00, 0, st_print_trc, st_get_trc, set_nul,(float *)&cs.null, 0 )	// dump the step trace
+	CFG("",   "trcz", _f00, 0, tx_print_nul, get_nul, st_set_trcz,(float *)&cs.null, 0 )	// clear the step trace
+#endif
+#ifdef __EVENT_LOG
+	CFG("",   "evl",  _f00, 0, ev_print_evl, ev_get_evl, set_nul,(float *)&cs.null, 0 )	// dump the event log
+	CFG("",   "evb",  _f00, 0, tx_print_nul, ev_get_evb, set_nul,(float *)&cs.null, 0 )	// dump the event log in binary
+	CFG("",   "evlz", _f00, 0, tx_print_nul, get_nul, ev_set_evlz,(float *)&cs.null, 0 )	// clear the event log
+#endif
+#ifdef __BLOCK_LOG
+	CFG("",   "tml",  _f00, 0, bl_print_tml, bl_get_tml, set_nul,(float *)&cs.null, 0 )	// dump the unread block log
+	CFG("",   "tmb",  _f00, 0, tx_print_nul, bl_get_tmb, set_nul,(float *)&cs.null, 0 )	// dump the unread block log in binary
+	CFG("",   "tmlz", _f00, 0, tx_print_nul, get_nul, bl_set_tmlz,(float *)&cs.null, 0 )	// clear the block log
+	CFG("",   "tmh",  _f00, 0, bl_print_tmh, bl_get_tmh, set_nul,(float *)&cs.null, 0 )	// dump the motion histograms
+	CFG("",   "tmhz", _f00, 0, tx_print_nul, get_nul, bl_set_tmhz,(float *)&cs.null, 0 )	// clear the motion histograms
+#endif
+
+	// System parameters
+	CFG("sys","ja",  _f07, 0, cm_print_ja,  get_flu,   set_flu,    (float *)&cm.junction_acceleration,JUNCTION_ACCELERATION )
+	CFG("sys","jmo", _f07, 0, cm_print_jmo, get_ui8,   set_01,     (float *)&cm.junction_model,		JUNCTION_MODEL )
+	CFG("sys","rmo", _f07, 0, cm_print_rmo, get_ui8,   set_01,     (float *)&cm.rapid_mode,			RAPID_MODE )
+	CFG("sys","ct",  _f07, 4, cm_print_ct,  get_flu,   set_flu,    (float *)&cm.chordal_tolerance,	CHORDAL_TOLERANCE )
+	CFG("sys","cot", _f07, 4, cm_print_cot, get_flu,   set_flu,    (float *)&cm.coalesce_tolerance,	COALESCE_TOLERANCE )
+	CFG("sys","aft", _f07, 4, cm_print_aft, get_flu,   set_flu,    (float *)&cm.arc_fit_tolerance,	ARC_FIT_TOLERANCE )
+	CFG("sys","prof",_fns, 0, cm_print_prof,get_ui8,   cm_set_prof,(float *)&cm.motion_profile,		0 )
+	CFG("sys","rsl", _fns, 0, cm_print_rsl, get_int,   cm_set_rsl, (float *)&cm.seek_line,			0 )
+	CFG("sys","rsz", _f07, 3, cm_print_rsz, get_flu,   set_flu,    (float *)&cm.restart_clearance,	RESTART_CLEARANCE_Z )
+	CFG("sys","jgt", _f07, 0, cm_print_jgt, get_int,   set_int,    (float *)&cm.jog_timeout,			JOG_TIMEOUT_MS )
+	CFG("sys","sqt", _f07, 0, cm_print_sqt, get_int,   set_int,    (float *)&cm.starve_queue_time,	STARVE_QUEUE_TIME_MS )
+	CFG("sys","pbs", _f07, 0, cm_print_pbs, get_ui8,   set_ui8,    (float *)&cm.plan_batch,			PLANNER_BATCH_SIZE )
+	CFG("sys","ist", _f07, 0, sh_print_ist, get_ui8,   sh_set_ist, (float *)&sh.type,					SHAPER_TYPE )
+	CFG("sys","pae", _f07, 0, pa_print_pae, get_ui8,   pa_set_pae, (float *)&pa.axis,					PA_AXIS )
+	CFG("sys","pak", _f07, 3, pa_print_pak, get_flt,   pa_set_pa,  (float *)&pa.advance_time,			PA_ADVANCE_TIME )
+	CFG("sys","pas", _f07, 3, pa_print_pas, get_flt,   pa_set_pa,  (float *)&pa.smooth_time,			PA_SMOOTH_TIME )
+	CFG("sys","hme", _f00, 0, ik_print_hme, get_ui8,   ik_set_hme, (float *)&hmap.enable,				0 )
+//	CFG("sys","st",  _f07, 0, sw_print_st,  get_ui8,   sw_set_st,  (float *)&sw.switch_type,			SWITCH_TYPE )
+	CFG("sys","swd", _f07, 0, sw_print_swd, get_ui8,   sw_set_swd, (float *)&sw.debounce_samples,		SWITCH_DEBOUNCE_SAMPLES )
+	CFG("sys","swf", _f07, 0, sw_print_swf, get_ui8,   sw_set_swf, (float *)&sw.filter_ms,				SWITCH_FILTER_MS )
+	CFG("sys","es",  _f07, 0, sw_print_es,  get_ui8,   sw_set_es,  (float *)&sw.estop_mode,			ESTOP_MODE )
+	CFG("sys","mt",  _f07, 2, st_print_mt,  get_flt,   st_set_mt,  (float *)&st.motor_idle_timeout, 	MOTOR_IDLE_TIMEOUT)
+#ifdef __MOTION_SYNC
+	CFG("sys","syn", _f07, 0, st_print_syn, get_ui8,   st_set_syn, (float *)&st.sync_mode,			MOTION_SYNC_MODE )
+#endif
+	CFG("sys","exm", _f07, 0, st_print_exm, get_ui8,   st_set_exm, (float *)&st.exec_mode,			EXEC_MODE )
+	CFG("sys","exf", _f07, 0, st_print_exf, get_ui8,   st_set_exf, (float *)&st.exec_fill,			EXEC_FILL )
+	CFG("sys","dsu", _f07, 1, st_print_dsu, get_flt,   st_set_dsu, (float *)&st.dir_setup,			DIRECTION_SETUP )
+	CFG("sys","ai",  _f07, 0, co_print_ai,  get_int,   set_int,    (float *)&cs.assertion_interval,	ASSERTION_INTERVAL_MS )
+	CFG("",   "me",  _f00, 0, tx_print_str, st_set_me, st_set_me,  (float *)&cs.null, 0 )
+	CFG("",   "md",  _f00, 0, tx_print_str, st_set_md, st_set_md,  (float *)&cs.null, 0 )
+
+	CFG("sys","ej",  _f07, 0, js_print_ej,  get_ui8,   set_01,     (float *)&cfg.comm_mode,			COMM_MODE )
+	CFG("sys","jv",  _f07, 0, js_print_jv,  get_ui8,   json_set_jv,(float *)&js.json_verbosity,		JSON_VERBOSITY )
+	CFG("sys","fs",  _f07, 0, js_print_fs,  get_ui8,   json_set_fs,(float *)&js.json_footer_style,	JSON_FOOTER_STYLE )
+	CFG("sys","jt",  _f07, 0, js_print_jt,  get_ui8,   set_01,     (float *)&js.json_terse,			JSON_TERSE )
+	CFG("sys","ea",  _f07, 0, co_print_ea,  get_ui8,   set_01,     (float *)&cs.early_ack,			EARLY_ACK )
+	CFG("sys","lk",  _f07, 0, co_print_lk,  get_ui8,   controller_set_lk,(float *)&cs.line_check,	LINE_CHECK )
+	CFG("sys","ci",  _fns, 0, xio_print_ci, get_ui8,   xio_set_ci, (float *)&xio.console_next,		XIO_CONSOLE_DEVICE )
+	CFG("sys","fl",  _fns, 0, xio_file_print_fl, get_int, xio_file_set_fl, (float *)&xf.lines,	0 )
+	CFG("sys","fr",  _fns, 0, xio_file_print_fr, get_int, xio_file_set_fr, (float *)&xf.linenum,	0 )
+	CFG("sys","fp",  _fns, 0, xio_file_print_fp, get_ui8, xio_file_set_fp, (float *)&xf.pause,	0 )
+	CFG("sys","cz",  _fns, 0, xio_lz_print_cz, get_int, xio_lz_set_cz, (float *)&xz.window,		0 )
+	CFG("sys","tv",  _f07, 0, tx_print_tv,  get_ui8,   set_01,     (float *)&txt.text_verbosity,		TEXT_VERBOSITY )
+	CFG("sys","qv",  _f07, 0, qr_print_qv,  get_ui8,   set_0123,   (float *)&qr.queue_report_verbosity,QR_VERBOSITY )
+	CFG("sys","qi",  _f07, 0, qr_print_qi,  get_int,   set_int,    (float *)&qr.queue_report_interval,QUEUE_REPORT_INTERVAL_MS )
+	CFG("sys","qh",  _f07, 0, qr_print_qh,  get_ui8,   set_ui8,    (float *)&qr.queue_report_hysteresis,QUEUE_REPORT_HYSTERESIS )
+	CFG("sys","sv",  _f07, 0, sr_print_sv,  get_ui8,   set_0123,   (float *)&sr.status_report_verbosity,SR_VERBOSITY )
+	CFG("sys","si",  _f07, 0, sr_print_si,  get_int,   sr_set_si,  (float *)&sr.status_report_interval,STATUS_REPORT_INTERVAL_MS )
+	CFG("",   "su1i",_f00, 0, su_print_i,   get_int,   su_set_i,   (float *)&sr.sub[0].interval, 0 )
+	CFG("",   "su1v",_f00, 0, su_print_v,   get_ui8,   su_set_v,   (float *)&sr.sub[0].verbosity, 0 )
+	CFG("",   "su2i",_f00, 0, su_print_i,   get_int,   su_set_i,   (float *)&sr.sub[1].interval, 0 )
+	CFG("",   "su2v",_f00, 0, su_print_v,   get_ui8,   su_set_v,   (float *)&sr.sub[1].verbosity, 0 )
+	CFG("",   "su3i",_f00, 0, su_print_i,   get_int,   su_set_i,   (float *)&sr.sub[2].interval, 0 )
+	CFG("",   "su3v",_f00, 0, su_print_v,   get_ui8,   su_set_v,   (float *)&sr.sub[2].verbosity, 0 )
+
+//	CFG("sys","ic",  _f07, 0, print_ui8,    get_ui8,   set_ic,     (float *)&cfg.ignore_crlf,			COM_IGNORE_CRLF )
+//	CFG("sys","ec",  _f07, 0, co_print_ec,  get_ui8,   set_ec,     (float *)&cfg.enable_cr,			COM_EXPAND_CR )
+//	CFG("sys","ee",  _f07, 0, co_print_ee,  get_ui8,   set_ee,     (float *)&cfg.enable_echo,			COM_ENABLE_ECHO )
+//	CFG("sys","ex",  _f07, 0, co_print_ex,  get_ui8,   set_ex,     (float *)&cfg.enable_flow_control,	COM_ENABLE_FLOW_CONTROL )
+//	CFG("sys","baud",_fns, 0, co_print_baud,get_ui8,   set_baud,   (float *)&cfg.usb_baud_rate,		XIO_BAUD_115200 )
+//	CFG("sys","net", _fip, 0, co_print_net, get_ui8,   set_ui8,    (float *)&cs.network_mode,			NETWORK_MODE )
+
+	// switch state readers
+/*
+	CFG("ss","ss0",  _f00, 0, print_ss, get_ui8, set_nul, (float *)&sw.state[0], 0 )
+	CFG("ss","ss1",  _f00, 0, print_ss, get_ui8, set_nul, (float *)&sw.state[1], 0 )
+	CFG("ss","ss2",  _f00, 0, print_ss, get_ui8, set_nul, (float *)&sw.state[2], 0 )
+	CFG("ss","ss3",  _f00, 0, print_ss, get_ui8, set_nul, (float *)&sw.state[3], 0 )
+	CFG("ss","ss4",  _f00, 0, print_ss, get_ui8, set_nul, (float *)&sw.state[4], 0 )
+	CFG("ss","ss5",  _f00, 0, print_ss, get_ui8, set_nul, (float *)&sw.state[5], 0 )
+	CFG("ss","ss6",  _f00, 0, print_ss, get_ui8, set_nul, (float *)&sw.state[6], 0 )
+	CFG("ss","ss7",  _f00, 0, print_ss, get_ui8, set_nul, (float *)&sw.state[7], 0 )
+*/
+	// NOTE: The ordering within the gcode defaults is important for token resolution
+	CFG("sys","gpl", _f07, 0, cm_print_gpl, get_ui8, set_012, (float *)&cm.select_plane,	GCODE_DEFAULT_PLANE )
+	CFG("sys","gun", _f07, 0, cm_print_gun, get_ui8, set_01,  (float *)&cm.units_mode,	GCODE_DEFAULT_UNITS )
+	CFG("sys","gco", _f07, 0, cm_print_gco, get_ui8, set_ui8, (float *)&cm.coord_system,	GCODE_DEFAULT_COORD_SYSTEM )
+	CFG("sys","gpa", _f07, 0, cm_print_gpa, get_ui8, set_012, (float *)&cm.path_control,	GCODE_DEFAULT_PATH_CONTROL )
+	CFG("sys","gdi", _f07, 0, cm_print_gdi, get_ui8, set_01,  (float *)&cm.distance_mode,	GCODE_DEFAULT_DISTANCE_MODE )
+	CFG("",   "gc",  _f00, 0, tx_print_nul, gc_get_gc, gc_run_gc,(float *)&cs.null, 0 ) // gcode block - must be last in this group
+
+	// "hidden" parameters (not in system group)
+	CFG("",   "ms",  _fip, 0, cm_print_ms,  get_flt, set_flt, (float *)&cm.estd_segment_usec,		NOM_SEGMENT_USEC )
+	CFG("",   "msb", _fip, 0, cm_print_msb, get_flt, set_flt, (float *)&cm.body_segment_usec,		BODY_SEGMENT_USEC )
+	CFG("",   "mse", _fip, 0, cm_print_mse, get_flu, set_flu, (float *)&cm.segment_velocity_error,	SEGMENT_VELOCITY_ERROR )
+	CFG("",   "ml",  _fip, 4, cm_print_ml,  get_flu, set_flu, (float *)&cm.min_segment_len,		MIN_LINE_LENGTH )
+	CFG("",   "ma",  _fip, 4, cm_print_ma,  get_flu, set_flu, (float *)&cm.arc_segment_len,		ARC_SEGMENT_LENGTH )
+	CFG("",   "fd",  _fip, 0, tx_print_ui8, get_ui8, set_01,  (float *)&js.json_footer_depth,		JSON_FOOTER_DEPTH )
+
+	// Persistence for status report - must be in sequence
+	// *** Count must agree with CMD_STATUS_REPORT_LEN in config.h ***
+	CFG("","se00",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[0],0 )
+	CFG("","se01",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[1],0 )
+	CFG("","se02",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[2],0 )
+	CFG("","se03",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[3],0 )
+	CFG("","se04",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[4],0 )
+	CFG("","se05",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[5],0 )
+	CFG("","se06",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[6],0 )
+	CFG("","se07",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[7],0 )
+	CFG("","se08",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[8],0 )
+	CFG("","se09",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[9],0 )
+	CFG("","se10",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[10],0 )
+	CFG("","se11",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[11],0 )
+	CFG("","se12",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[12],0 )
+	CFG("","se13",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[13],0 )
+	CFG("","se14",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[14],0 )
+	CFG("","se15",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[15],0 )
+	CFG("","se16",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[16],0 )
+	CFG("","se17",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[17],0 )
+	CFG("","se18",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[18],0 )
+	CFG("","se19",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[19],0 )
+	CFG("","se20",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[20],0 )
+	CFG("","se21",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[21],0 )
+	CFG("","se22",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[22],0 )
+	CFG("","se23",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[23],0 )
+	CFG("","se24",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[24],0 )
+	CFG("","se25",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[25],0 )
+	CFG("","se26",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[26],0 )
+	CFG("","se27",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[27],0 )
+	CFG("","se28",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[28],0 )
+	CFG("","se29",_fpe, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[29],0 )
+
+	// Group lookups - must follow the single-valued entries for proper sub-string matching
+	// *** Must agree with CMD_COUNT_GROUPS in config_app.cpp ****
+	CFG("","sys",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// system group
+	CFG("","p1", _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// PWM 1 group
+	CFG("","1",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// motor groups
+	CFG("","2",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","3",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","4",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","5",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","6",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+#if (MOTORS >= 7)
+	CFG("","7",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// expansion motors
+#endif
+#if (MOTORS >= 8)
+	CFG("","8",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+#endif
+	CFG("","x",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// axis groups
+	CFG("","y",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","z",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","a",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","b",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","c",  _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+//	CFG("","ss", _f00, 0, tx_print_nul, get_grp, set_nul,(float *)&cs.null,0 )
+	CFG("","g54",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// coord offset groups
+	CFG("","g55",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","g56",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","g57",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","g58",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","g59",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","g92",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// origin offsets
+	CFG("","g28",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// g28 home position
+	CFG("","g30",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// g30 home position
+	CFG("","mpo",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// machine position group
+	CFG("","pos",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// work position group
+	CFG("","ofs",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// work offset group
+	CFG("","hom",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// axis homing state group
+	CFG("","pvt",_f00, 0, tx_print_nul, get_grp, cm_set_pvt,(float *)&cs.null,0 )	// PVT point group
+	CFG("","ras",_f00, 0, tx_print_nul, get_grp, cm_set_ras,(float *)&cs.null,0 )	// raster line group
+	CFG("","isr",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// ISR timing group
+	CFG("","lpn",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// loop profile groups
+	CFG("","lpc",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","lpx",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","lph",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )
+	CFG("","seg",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// segment telemetry group
+	CFG("","bm", _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// planner benchmark group
+	CFG("","pf", _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// preflight group
+	CFG("","lt", _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// console link test group
+	CFG("","en", _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// encoder group
+	CFG("","sp", _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// spindle tach group
+	CFG("","lc", _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// adaptive feed group
+	CFG("","ao", _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// analog servo group
+	CFG("","can",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// CAN bus group
+	CFG("","irq",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// interrupt priority group
+	CFG("","mem",_f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// SRAM use group
+	CFG("","bt", _f00, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 )	// boot timing group
+
+	// Uber-group (groups of groups, for text-mode displays only)
+	// *** Must agree with CMD_COUNT_UBER_GROUPS in config_app.cpp ****
+	CFG("", "m", _f00, 0, tx_print_nul, _do_motors, set_nul,(float *)&cs.null,0 )
+	CFG("", "q", _f00, 0, tx_print_nul, _do_axes,   set_nul,(float *)&cs.null,0 )
+	CFG("", "o", _f00, 0, tx_print_nul, _do_offsets,set_nul,(float *)&cs.null,0 )
+	CFG("", "lp",_f00, 0, tx_print_nul, _do_profile,set_nul,(float *)&cs.null,0 )
+	CFG("", "$", _f00, 0, tx_print_nul, _do_all,    set_nul,(float *)&cs.null,0 )
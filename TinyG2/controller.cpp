@@ -34,15 +34,23 @@
 #include "gcode_parser.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
+#include "plan_spline.h"
 #include "planner.h"
 #include "stepper.h"
 #include "hardware.h"
 #include "switch.h"
+#include "encoder.h"
+#include "load_control.h"
+#include "servo.h"
+#include "preflight.h"
 //#include "gpio.h"
 #include "report.h"
 #include "help.h"
 #include "util.h"
 #include "xio.h"
+#include "xio_file.h"
+#include "can.h"
+#include "persistence.h"
 
 #include "Reset.h"
 
@@ -64,6 +72,13 @@ static stat_t _system_assertions(void);
 static stat_t _sync_to_planner(void);
 static stat_t _sync_to_tx_buffer(void);
 static stat_t _command_dispatch(void);
+static stat_t _dispatch_line(void);
+static stat_t _check_line(char_t *line);
+static void _line_response(stat_t status);
+static uint8_t _input_waiting(void);
+static uint8_t _task_parked(uint8_t task);
+static uint8_t _tasks_ready(void);
+static void _idle_sleep(void);
 
 // prep for export to other modules:
 stat_t hardware_hard_reset_handler(void);
@@ -85,13 +100,16 @@ void controller_init(uint8_t std_in, uint8_t std_out, uint8_t std_err)
 	cs.hw_platform = TINYG_HARDWARE_PLATFORM;		// NB: HW version is set from EEPROM
 	
 	cs.linelen = 0;									// initialize index for read_line()
+	cs.bufp = cs.in_buf;							// the startup pass dispatches the empty buffer
+	cs.line_pending = false;
 	cs.state = CONTROLLER_NOT_CONNECTED;			// find USB next
+	controller_config_changed();					// take the config checksum once configs are loaded
 //	cs.reset_requested = false;
 //	cs.bootloader_requested = false;
 
-//	xio_set_stdin(std_in);
-//	xio_set_stdout(std_out);
-//	xio_set_stderr(std_err);
+	xio_set_stdin(std_in);
+	xio_set_stdout(std_out);
+	xio_set_stderr(std_err);
 //	cs.default_src = std_in;
 //	tg_set_primary_source(cs.default_src);
 }
@@ -113,16 +131,54 @@ void controller_init(uint8_t std_in, uint8_t std_out, uint8_t std_err)
  * and runs the next routine in the list.
  *
  * A routine that had no action (i.e. is OFF or idle) should return STAT_NOOP
+ *
+ * Event driven tasks are dispatched with DISPATCH_READY and only called while 
+ * their ready flag is set (see ctlTask in controller.h). The flag is cleared before
+ * the call and set again unless the task returns STAT_NOOP, so a task keeps running
+ * until it has nothing left to do, and a request that arrives during the call is
+ * not lost. A task parked on an event (see ctlEvent) is not called, and blocks the
+ * routines below it until the event is signaled. The rest are polled - they wait on
+ * time, input or buffer space.
+ *
+ * Each dispatch names the profile stage it is timed under (see ctlProfileStage).
+ *
+ * The simulator build (__SIM) runs one pass per call, and moves simulated time on
+ * between passes (see platform/sim).
  */
 
+#ifdef __LOOP_PROFILE
+static void _lp_record(ctlProfileStageTiming_t *t, const uint32_t start);
+static void _lp_record_pass(void);
+#define	PROFILE(lp_stage, func) ({ uint32_t _lp_start = hw_get_cycle_count(); \
+			stat_t _lp_status = func; _lp_record(&lp.stage[lp_stage], _lp_start); _lp_status; })
+#else
+#define	PROFILE(lp_stage, func) (func)
+#define _lp_record_pass()
+#endif
+
 void controller_run() 
 { 
+#ifndef __SIM
 	while (true) { 
+#endif
+		cs.pass_complete = false;
 		_controller_HSM();
+		PROFILE(LP_FLUSH, (xio_flush_output(), STAT_OK));	// send whatever this pass printed
+		_lp_record_pass();
+		_idle_sleep();
+#ifndef __SIM
 	}
+#endif
 }
 
-#define	DISPATCH(func) if (func == STAT_EAGAIN) return; 
+#define	DISPATCH(lp_stage, func) if (PROFILE(lp_stage, func) == STAT_EAGAIN) return; 
+#define	DISPATCH_READY(task, lp_stage, func) if (_task_parked(task) == true) return; \
+		if (cs.task_ready[task] == true) { \
+			cs.task_ready[task] = false; \
+			stat_t _status = PROFILE(lp_stage, func); \
+			if ((_status != STAT_NOOP) && (cs.task_wait[task] == CTL_EVENT_NONE)) { cs.task_ready[task] = true;} \
+			if (_status == STAT_EAGAIN) return; \
+		}
 static void _controller_HSM()
 {
 //----- Interrupt Service Routines are the highest priority controller functions ----//
@@ -130,33 +186,89 @@ static void _controller_HSM()
 //
 //----- kernel level ISR handlers ----(flags are set in ISRs)------------------------//
 												// Order is important:
-	DISPATCH(hw_hard_reset_handler());			// 1. handle hard reset requests
-//	DISPATCH(hw_bootloader_handler());			// 2. handle requests to enter bootloader
-	DISPATCH(_alarm_idler());					// 3. idle in alarm state (shutdown)
-	DISPATCH( poll_switches());					// 4. run a switch polling cycle
-	DISPATCH(_limit_switch_handler());			// 5. limit switch has been thrown
-
-	DISPATCH(cm_feedhold_sequencing_callback());// 6a. feedhold state machine runner
-	DISPATCH(mp_plan_hold_callback());			// 6b. plan a feedhold from line runtime
-	DISPATCH(_system_assertions());				// 7. system integrity assertions
+	DISPATCH_READY(CTL_TASK_HARD_RESET, LP_RESET, hw_hard_reset_handler());	// 1. handle hard reset requests
+	DISPATCH_READY(CTL_TASK_EXEC, LP_EXEC, st_exec_callback());	// 1a. prep segments ahead in background exec mode
+	DISPATCH(LP_DISPATCH, mp_plan_batch_callback(_input_waiting()));// 1b. plan batched blocks unless more are coming
+	DISPATCH(LP_DISPATCH, pf_preflight_callback());	// 1c. free planned blocks in place of the runtime in a preflight
+//	DISPATCH(LP_RESET, hw_bootloader_handler());	// 2. handle requests to enter bootloader
+	DISPATCH(LP_ALARM, _alarm_idler());			// 3. idle in alarm state (shutdown)
+#ifndef __SWITCH_INTERRUPTS
+	DISPATCH(LP_SWITCHES, poll_switches());		// 4. run a switch polling cycle
+#endif
+	DISPATCH_READY(CTL_TASK_LIMIT, LP_SWITCHES, _limit_switch_handler());// 5. limit switch has been thrown
+	DISPATCH(LP_SWITCHES, en_encoder_callback());	// 5a. encoder following error
+
+	DISPATCH_READY(CTL_TASK_FEEDHOLD, LP_FEEDHOLD, cm_feedhold_sequencing_callback());// 6a. feedhold state machine runner
+	DISPATCH_READY(CTL_TASK_PLAN_HOLD, LP_FEEDHOLD, mp_plan_hold_callback());	// 6b. plan a feedhold from line runtime
+	DISPATCH(LP_ASSERTIONS, _system_assertions());	// 7. system integrity assertions (rate limited)
 
 //----- planner hierarchy for gcode and cycles ---------------------------------------//
 
-	DISPATCH(st_motor_power_callback());		// stepper motor power sequencing
-//	DISPATCH(switch_debounce_callback());		// debounce switches
-	DISPATCH(sr_status_report_callback());		// conditionally send status report
-	DISPATCH(qr_queue_report_callback());		// conditionally send queue report
-	DISPATCH(cm_arc_callback());				// arc generation runs behind lines
-	DISPATCH(cm_homing_callback());				// G28.2 continuation
-//	DISPATCH(cm_probe_callback());				// G38.2 continuation
+	DISPATCH(LP_POWER, hw_deadline_callback());	// run the deadline timers that are due
+	DISPATCH(LP_POWER, st_motor_power_callback());	// stepper motor power sequencing
+	DISPATCH(LP_POWER, sv_servo_callback());	// hold stopped analog motors on their encoders
+	DISPATCH(LP_POWER, persistence_callback());	// write changed settings to flash
+//	DISPATCH(LP_SWITCHES, switch_debounce_callback());	// debounce switches
+	DISPATCH(LP_STATUS_REPORT, sr_status_report_callback());// conditionally send status report
+	DISPATCH(LP_STATUS_REPORT, sr_subscription_callback());	// send the next subscription report due
+	DISPATCH(LP_STATUS_REPORT, can_callback());	// broadcast state changes to the CAN bus peers
+	DISPATCH(LP_QUEUE_REPORT, qr_queue_report_callback());	// conditionally send queue report
+	DISPATCH(LP_QUEUE_REPORT, mp_starve_callback());	// slow the feed while the queue runs short
+	DISPATCH(LP_QUEUE_REPORT, lc_load_callback());	// adapt the feed to the spindle load
+	DISPATCH_READY(CTL_TASK_ARC, LP_CYCLES, cm_arc_callback());		// arc generation runs behind lines
+	DISPATCH_READY(CTL_TASK_SPLINE, LP_CYCLES, cm_spline_callback());	// G5 spline generation runs behind lines
+	DISPATCH_READY(CTL_TASK_CANNED_CYCLE, LP_CYCLES, cm_canned_cycle_callback());// G81 - G83 drilling moves run behind lines
+	DISPATCH_READY(CTL_TASK_SUBROUTINE, LP_CYCLES, gc_subroutine_callback());	// O-word subroutine calls run behind lines
+	DISPATCH_READY(CTL_TASK_HOMING, LP_CYCLES, cm_homing_callback());	// G28.2 continuation
+//	DISPATCH(LP_CYCLES, cm_probe_callback());	// G38.2 continuation
+	DISPATCH_READY(CTL_TASK_PROBE, LP_CYCLES, cm_probe_grid_callback());	// G38.6 continuation
+	DISPATCH_READY(CTL_TASK_PROBE_TOUCH, LP_CYCLES, cm_probe_touch_callback());	// G38.7 continuation
+	DISPATCH_READY(CTL_TASK_JOG, LP_CYCLES, cm_jog_callback());		// realtime jog - commands wait while it runs
 
 //----- command readers and parsers --------------------------------------------------//
 
-	DISPATCH(_sync_to_planner());				// ensure there is at least one free buffer in planning queue
-	DISPATCH(_sync_to_tx_buffer());				// sync with TX buffer (pseudo-blocking)
-//	DISPATCH(set_baud_callback());				// perform baud rate update (must be after TX sync)
-	DISPATCH(_command_dispatch());				// read and execute next command
-	DISPATCH(_normal_idler());					// blink LEDs slowly to show everything is OK
+	DISPATCH(LP_DISPATCH, json_response_callback());	// send the rest of a long JSON response
+	DISPATCH(LP_READ_AHEAD, gc_read_ahead_callback());	// run Gcode blocks parsed ahead as the planner frees up
+	DISPATCH(LP_READ_AHEAD, gc_batch_callback());	// run the lines of a {"gc":[...]} request as the planner frees up
+	DISPATCH(LP_SYNC, _sync_to_planner());		// ensure there is at least one free buffer in planning queue
+	DISPATCH(LP_SYNC, _sync_to_tx_buffer());	// sync with TX buffer (pseudo-blocking)
+//	DISPATCH(LP_SYNC, set_baud_callback());		// perform baud rate update (must be after TX sync)
+	DISPATCH(LP_DISPATCH, _command_dispatch());	// read and execute next command
+	DISPATCH(LP_IDLER, _normal_idler());		// blink LEDs slowly to show everything is OK
+}
+
+/*
+ * controller_wait()   - park a task on an event. CTL_EVENT_NONE unparks it
+ * controller_signal() - make the tasks parked on an event ready. OK to call from an ISR
+ * _task_parked()	   - return TRUE if a task is still parked, unparking it on timeout
+ *
+ *	Only the task sets its own wait, and only while it is running. A signal clears 
+ *	the wait before it sets the ready flag so the dispatcher never sees a ready task
+ *	that is still parked.
+ */
+void controller_wait(uint8_t task, uint8_t event)
+{
+	cs.task_wait_timeout[task] = SysTickTimer.getValue() + CONTROLLER_WAIT_TIMEOUT_MS;
+	cs.task_wait[task] = event;
+}
+
+void controller_signal(uint8_t event)
+{
+	for (uint8_t task=0; task<CTL_TASKS; task++) {
+		if (cs.task_wait[task] == event) {
+			cs.task_wait[task] = CTL_EVENT_NONE;
+			cs.task_ready[task] = true;
+		}
+	}
+}
+
+static uint8_t _task_parked(uint8_t task)
+{
+	if (cs.task_wait[task] == CTL_EVENT_NONE) return (false);
+	if (SysTickTimer.getValue() < cs.task_wait_timeout[task]) return (true);
+	cs.task_wait[task] = CTL_EVENT_NONE;		// timed out - run it and let it test again
+	cs.task_ready[task] = true;
+	return (false);
 }
 
 /***************************************************************************** 
@@ -166,22 +278,71 @@ static void _controller_HSM()
  *	Accepts commands if the move queue has room - EAGAINS if it doesn't
  *	Manages cutback to serial input from file devices (EOF)
  *	Also responsible for prompts and for flow control 
+ *
+ *	While the planner has no room, text mode Gcode lines are parsed ahead (see 
+ *	gc_read_ahead()) and each runs once the planner has the buffers it takes. Any 
+ *	other line is held in in_buf until the read-ahead queue has run and the planner 
+ *	has room, as before - room for a raster line's pixels too (see RASTER LINES in 
+ *	planner.h). So are O-word lines and the lines of a subroutine body (see 
+ *	gc_subroutine_callback()). $ settings, ? and help take no buffers, so they only
+ *	wait for the read-ahead queue. Binary Gcode frames (see gc_binary_parser()) are
+ *	read ahead in either mode, and with early acknowledge ($ea=1) so is JSON mode 
+ *	Gcode - see gc_read_ahead().
+ *
+ *	Up to CONTROLLER_LINES_PER_PASS lines already waiting in the receive ring are
+ *	run in one pass, so bursts of short lines don't each cost a trip through the
+ *	whole controller. Before each line after the first the planner and TX syncs are
+ *	checked again, and the pass ends at the first line that can't be read or run.
+ *	No line is read while a preflight is ending (see preflight.h).
+ *
+ * _dispatch_line() - read and run one line
+ *
+ *	Returns STAT_OK if a line was run (or the startup states advanced), STAT_NOOP if
+ *	there was no line and STAT_EAGAIN if the line is held for the planner.
  */
 
 static stat_t _command_dispatch()
+{
+	for (uint8_t lines=0; lines < CONTROLLER_LINES_PER_PASS; lines++) {
+		if (pf.state == PREFLIGHT_ENDING) { break;}	// lines after $pre=0 wait for the preflight to end
+		if (lines > 0) {
+			if (_sync_to_planner() == STAT_EAGAIN) { break;}
+			if (_sync_to_tx_buffer() == STAT_EAGAIN) { break;}
+			if (json_response_pending() == true) { break;}	// let the last response finish first
+			if (gc_batch_running() == true) { break;}		// its lines are packed in in_buf
+		}
+		stat_t status = _dispatch_line();
+		if (status == STAT_EAGAIN) { return (STAT_EAGAIN);}
+		if (status == STAT_NOOP) { break;}		// no line - let the idler run
+	}
+	return (STAT_OK);
+}
+
+static stat_t _dispatch_line()
 {
 	// detect USB connection and transition to disconnected state if it disconnected
-	if (SerialUSB.isConnected() == false) cs.state = CONTROLLER_NOT_CONNECTED;
+	// (a USART console is always connected)
+	if (xio_is_connected() == false) cs.state = CONTROLLER_NOT_CONNECTED;
 
 	// read input line or return if not a completed line
 	if (cs.state == CONTROLLER_READY) {
-		if (read_line(cs.in_buf, &cs.linelen, sizeof(cs.in_buf)) != STAT_OK) {
+		if (cs.line_pending == true) {			// retry a line that was held for the planner
+			cs.line_pending = false;
+		} else if (read_line(cs.in_buf, &cs.linelen, sizeof(cs.in_buf)) != STAT_OK) {
 			cs.bufp = cs.in_buf;
-			return (STAT_OK);	// returns OK for anything NOT OK, so the idler always runs
+			return (STAT_NOOP);	// no complete line yet
+		} else if (cs.line_check == true) {		// see Line checksums in controller.h
+			stat_t status = _check_line(cs.bufp);
+			if (status != STAT_OK) {
+				_line_response((status == STAT_NOOP) ? STAT_OK : status);	// NOOP - already run
+				cs.linelen = 0;
+				return (STAT_OK);
+			}
 		}
 
 	} else if (cs.state == CONTROLLER_NOT_CONNECTED) {
-		if (SerialUSB.isConnected() == false) return (STAT_OK);
+		if (xio_is_connected() == false) return (STAT_NOOP);
+		hw_boot_mark(HW_BOOT_CONNECT);
 		cm_request_queue_flush();
 		rpt_print_system_ready_message();
 		cs.state = CONTROLLER_STARTUP;
@@ -194,12 +355,31 @@ static stat_t _command_dispatch()
 		cs.state = CONTROLLER_READY;
 
 	} else {
+		return (STAT_NOOP);
+	}
+
+	// store the line if a job is being uploaded - commands still run (see xio_file.h)
+	if ((xio_file_uploading() == true) && (strchr("$?{", *cs.bufp) == NULL)) {
+		_line_response(xio_file_write_line(cs.bufp));
+		cs.linelen = 0;
 		return (STAT_OK);
 	}
 	
+	// hold the line unless it can run now or be read ahead
+	uint8_t planner_ready = controller_planner_ready();
+	uint8_t read_ahead = (((cfg.comm_mode != JSON_MODE) || (cs.early_ack == true) || (gc_is_frame(cs.bufp) == true)) && 
+						  (*cs.bufp != NUL) && (strchr("H$?{O", toupper(*cs.bufp)) == NULL) &&
+						  (gc_subroutine_defining() == false));
+	uint8_t no_buffers = ((*cs.bufp == NUL) || (strchr("H$?", toupper(*cs.bufp)) != NULL));	// settings and help
+	if ((no_buffers == true) && (gc_read_ahead_empty() == true)) { planner_ready = true;}
+	if ((planner_ready == false) && (read_ahead == false)) {
+		cs.line_pending = true;
+		return (STAT_EAGAIN);
+	}
+
 	// execute the text line
-//	strncpy(cs.saved_buf, cs.in_buf, SAVED_BUFFER_LEN-1);	// save input buffer for reporting
-	strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1);	// save input buffer for reporting
+	// Text mode Gcode is parsed without modifying the line, so only the parsers that
+	// change their input need it saved for reporting
 	cs.linelen = 0;
 
 	// dispatch the new text line
@@ -207,7 +387,7 @@ static stat_t _command_dispatch()
 
 		case NUL: { 							// blank line (just a CR)
 			if (cfg.comm_mode != JSON_MODE) {
-				text_response(STAT_OK, cs.saved_buf);
+				text_response(STAT_OK, cs.bufp);
 			}
 			break;
 		}
@@ -219,27 +399,119 @@ static stat_t _command_dispatch()
 		}
 		case '$': case '?':{ 					// text-mode configs
 			cfg.comm_mode = TEXT_MODE;
+			strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1);	// save input buffer for reporting
 			text_response(text_parser(cs.bufp), cs.saved_buf);
 			break;
 		}
 		case '{': { 							// JSON input
 			cfg.comm_mode = JSON_MODE;
+			strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1);
 			json_parser(cs.bufp);
 			break;
 		}
+		case GCODE_FRAME_CHAR: {				// pre-tokenized Gcode frame...
+			if (gc_is_frame(cs.bufp) == true) {
+				if (planner_ready == true) {
+					text_response(gc_binary_parser(cs.bufp), cs.bufp);
+				} else {
+					stat_t status = gc_read_ahead(cs.bufp);
+					if ((status != STAT_OK) || (cs.early_ack == true)) {
+						text_response(status, cs.bufp);
+					}
+				}
+				break;
+			}
+		}	// falls through					// ...or a block starting with a parameter setting
 		default: {								// anything else must be Gcode
 			if (cfg.comm_mode == JSON_MODE) {
+				strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1);
 				strncpy(cs.out_buf, cs.bufp, INPUT_BUFFER_LEN -8);					// use out_buf as temp
 				sprintf((char *)cs.bufp,"{\"gc\":\"%s\"}\n", (char *)cs.out_buf);	// '-8' is used for JSON chars
+				js.plain_line = true;			// may get a terse response ($jt)
 				json_parser(cs.bufp);
+				js.plain_line = false;
+			} else if (planner_ready == true) {
+				text_response(gc_gcode_parser(cs.bufp), cs.bufp);
 			} else {
-				text_response(gc_gcode_parser(cs.bufp), cs.saved_buf);
+				stat_t status = gc_read_ahead(cs.bufp);
+				if ((status != STAT_OK) || (cs.early_ack == true)) {	// queued blocks respond when they run...
+					text_response(status, cs.bufp);		// ...unless answered now
+				}
 			}
 		}
 	}
 	return (STAT_OK);
 }
 
+/*
+ * _line_response() - answer a line that isn't dispatched to a parser
+ */
+
+static void _line_response(stat_t status)
+{
+	if (cfg.comm_mode == JSON_MODE) {
+		cmd_reset_list();
+		json_print_response(status);
+	} else {
+		text_response(status, cs.bufp);
+	}
+}
+
+/*
+ * _check_line() 				 - check the line number and checksum of a line
+ * controller_line_check_reset() - start a new sequence (queue flush)
+ * controller_set_lk()			 - turn line checks on or off ($lk)
+ *
+ *	See Line checksums in controller.h. _check_line() returns STAT_OK if the line is
+ *	to run, with the checksum taken off, STAT_NOOP if it has already run, or the error
+ *	it is answered with.
+ */
+
+static stat_t _check_line(char_t *line)
+{
+	char *rd = (char *)line;
+	for (; (*rd == ' ') || (*rd == TAB); rd++);
+	char *star = strrchr(rd, '*');
+	char *end = star;
+	if (star != NULL) { for (end++; isdigit(*end); end++);}
+	if ((toupper(*rd) != 'N') || (star == NULL) || (end == star+1) || (*end != NUL)) {
+		return ((cs.line_resend == 0) ? STAT_OK : STAT_LINE_DISCARDED);	// not a checked line
+	}
+	uint32_t linenum = strtoul(rd+1, NULL, 10);
+	uint32_t due = (cs.line_resend != 0) ? cs.line_resend : cs.line_expected;
+
+	stat_t status = STAT_OK;
+	if (compute_checksum(line, star - (char *)line) != strtoul(star+1, NULL, 10)) {
+		status = STAT_CHECKSUM_MISMATCH;
+	} else if ((due != 0) && (linenum < due)) {
+		return (STAT_NOOP);
+	} else if ((due != 0) && (linenum > due)) {
+		status = STAT_LINE_NUMBER_ERROR;
+	} else {
+		*star = NUL;
+		cs.line_expected = linenum + 1;
+		cs.line_resend = 0;
+		return (STAT_OK);
+	}
+	if ((cs.line_resend != 0) && (status != STAT_CHECKSUM_MISMATCH)) { return (STAT_LINE_DISCARDED);}
+	cs.line_resend = (due != 0) ? due : linenum;		// the first line's number is all there is
+	rpt_line_exception(status, cs.line_resend);
+	return (status);
+}
+
+void controller_line_check_reset()
+{
+	cs.line_expected = 0;
+	cs.line_resend = 0;
+}
+
+stat_t controller_set_lk(cmdObj_t *cmd)
+{
+	ritorno(set_01(cmd));
+	controller_line_check_reset();
+	return (STAT_OK);
+}
+
 /**** Local Utilities ********************************************************/
 /*
  * _alarm_idler() - blink rapidly and prevent further activity from occurring
@@ -268,9 +540,57 @@ static stat_t _normal_idler()
 		cs.led_timer = SysTickTimer.getValue() + LED_NORMAL_TIMER;
 		IndicatorLed.toggle();
 	}
+	cs.pass_complete = true;					// nothing above blocked this pass
 	return (STAT_OK);
 }
 
+/*
+ * _input_waiting() - TRUE if more lines are on their way - console input or a job playing
+ *
+ *	Blocks taken while this is TRUE are planned together (see mp_plan_batch()).
+ */
+static uint8_t _input_waiting()
+{
+	return ((xio_input_waiting() == true) || (xf.state == XIO_FILE_PLAYING));
+}
+
+/*
+ * _idle_sleep() - sleep the core until the next interrupt if there is nothing to do
+ *
+ *	Sleeps when the last pass ran to the idler, no task or deadline is ready, the 
+ *	planner and runtime are empty and there is no input, job or response waiting. WFI stops 
+ *	the core clock until an interrupt is pending; the interrupt runs on wake up and
+ *	the loop takes another pass. Input is taken and realtime characters are acted
+ *	on in the SysTick interrupt, so everything the loop polls is looked at again 
+ *	within a millisecond - switch, USB and timer interrupts wake it sooner. Wake up 
+ *	adds a few cycles to the interrupt entry.
+ *
+ *	The ready flags and input are tested again with interrupts masked, so an interrupt
+ *	that makes work after the first test stays pending and WFI falls straight through.
+ *	The mask is short and only taken when no motion is running.
+ */
+static uint8_t _tasks_ready()
+{
+	for (uint8_t task=0; task<CTL_TASKS; task++) {
+		if (cs.task_ready[task] == true) return (true);
+	}
+	if (hw_deadline_due() == true) return (true);
+	return (xio_input_waiting());
+}
+
+static void _idle_sleep()
+{
+	if (CONTROLLER_IDLE_SLEEP != 1) return;
+	if (cs.pass_complete == false) return;
+	if ((cs.line_pending == true) || (json_response_pending() == true) || (xf.state == XIO_FILE_PLAYING)) return;
+	if ((mp_get_runtime_busy() == true) || (mp_get_planner_buffers_available() < PLANNER_BUFFER_POOL_SIZE)) return;
+	if (_tasks_ready() == true) return;
+
+	__disable_irq();
+	if (_tasks_ready() == false) { __WFI();}
+	__enable_irq();								// the interrupt that woke the core runs here
+}
+
 /*
  * tg_reset_source() 		 - reset source to default input device (see note)
  * tg_set_primary_source() 	 - set current primary input source
@@ -289,36 +609,50 @@ void tg_set_secondary_source(uint8_t dev) { cs.secondary_src = dev;}
 /*
  * _sync_to_tx_buffer() - return eagain if TX queue is backed up
  * _sync_to_planner() - return eagain if planner is not ready for a new command
+ * controller_planner_ready() - TRUE if a Gcode line can run now instead of being read ahead
+ *
+ *	Reading a new command is held off while the TX ring is above its high water 
+ *	mark, so responses never pile up behind a host that has stopped reading. 
+ *	Everything dispatched ahead of this (feedhold sequencing, hold planning, arcs...)
+ *	keeps running. Status and queue reports hold themselves off the same way.
+ *
+ *	A Gcode line that isn't parsed yet might be any block, so it runs now only with 
+ *	PLANNER_BUFFER_HEADROOM free, and not while a spline is still being queued by
+ *	cm_spline_callback(). Parsed blocks wait for what they take (see gc_read_ahead()).
  */
 
 static stat_t _sync_to_tx_buffer()
 {
-//	if ((xio_get_tx_bufcount_usart(ds[XIO_DEV_USB].x) >= XOFF_TX_LO_WATER_MARK)) {
-//		return (STAT_EAGAIN);
-//	}
+	if (xio_tx_backed_up(XIO_CONSOLE) == true) { return (STAT_EAGAIN);}
 	return (STAT_OK);
 }
 
 static stat_t _sync_to_planner()
 {
-	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) { // allow up to N planner buffers for this line
-		return (STAT_EAGAIN);
-	}
-	return (STAT_OK);
+	if (gc_read_ahead_full() == true) { return (STAT_EAGAIN);}	// queued blocks run first, even with planner room
+	return (STAT_OK);						// a line can run or be parsed ahead
+}
+
+uint8_t controller_planner_ready()
+{
+	return ((mp_get_planner_buffers_available() >= PLANNER_BUFFER_HEADROOM) && 
+			(gc_read_ahead_empty() == true) && (mp_raster_room() == true) && (spl.run_state == MOVE_STATE_OFF));
 }
 
 /*
- * _limit_switch_handler() - shut down system if limit switch fired
+ * _limit_switch_handler() - shut down system if limit switch or e-stop input fired
+ *
+ *	The switch has already stopped the steppers (see st_halt()). This puts the 
+ *	machine in alarm until it is reset. The e-stop is reported over a limit.
  */
 static stat_t _limit_switch_handler(void)
 {
-/*
-	if (cm_get_machine_state() == MACHINE_ALARM) { return (STAT_NOOP);}
-	if (cm.limit_tripped_flag == false) { return (STAT_NOOP);}
-	cm.limit_tripped_flag = false;
-//	cm_alarm(0);
-*/
-	return (STAT_OK);
+	if ((sw.limit_tripped == false) && (sw.estop_tripped == false)) { return (STAT_NOOP);}
+	stat_t status = (sw.estop_tripped == true) ? STAT_EMERGENCY_STOP : STAT_LIMIT_SWITCH_HIT;
+	sw.limit_tripped = false;
+	sw.estop_tripped = false;
+	cm_alarm(status);
+	return (STAT_NOOP);
 }
 
 /* 
@@ -330,19 +664,71 @@ stat_t _controller_assertions()
 	return (STAT_OK);
 }
 
+/*
+ * controller_config_changed() - restart the config checksum after a config write
+ * _config_assertions()		   - checksum the next chunk of the stepper configs
+ *
+ *	The stepper configs (motor maps, step angles, steps per unit...) only change
+ *	through cmd_set(), which calls controller_config_changed(). The checksum is 
+ *	accumulated CONFIG_CRC_CHUNK bytes per assertion pass. The first complete pass 
+ *	after a write is the reference; any later pass that differs is a memory fault. 
+ *	Other config blocks have runtime members (e.g. homing swaps the jerk in cm.a[]) 
+ *	and are covered by their magic numbers only.
+ */
+void controller_config_changed()
+{
+	cs.config_crc_valid = false;
+	cs.config_crc_offset = 0;
+	cs.config_crc_run = 0xFFFF;
+}
+
+static uint16_t _crc16_ccitt(uint16_t crc, const uint8_t *buf, uint16_t len)
+{
+	while (len--) {
+		crc ^= (uint16_t)*buf++ << 8;
+		for (uint8_t i=0; i<8; i++) {
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+	}
+	return (crc);
+}
+
+static stat_t _config_assertions()
+{
+	uint16_t len = min((uint16_t)CONFIG_CRC_CHUNK, (uint16_t)(sizeof(st) - cs.config_crc_offset));
+	cs.config_crc_run = _crc16_ccitt(cs.config_crc_run, (uint8_t *)&st + cs.config_crc_offset, len);
+	if ((cs.config_crc_offset += len) < sizeof(st)) return (STAT_OK);
+
+	uint16_t crc = cs.config_crc_run;
+	uint8_t valid = cs.config_crc_valid;
+	controller_config_changed();				// start the next pass
+	cs.config_crc_valid = true;
+	if (valid == false) { cs.config_crc = crc;}
+	else if (crc != cs.config_crc) return (STAT_CONFIG_ASSERTION_FAILURE);
+	return (STAT_OK);
+}
+
 /* 
  * _system_assertions() - check memory integrity and other assertions
+ *
+ *	Runs every $ai milliseconds rather than every pass - the checks look for damage
+ *	that has already happened, so running them more often only finds it sooner.
  */
 stat_t _system_assertions()
 {
 	stat_t status;
 
+	if (SysTickTimer.getValue() < cs.assertion_timer) return (STAT_NOOP);
+	cs.assertion_timer = SysTickTimer.getValue() + cs.assertion_interval;
+
 	for (;;) {	// run this loop only once, but enable breaks
 
 		if ((status = _controller_assertions()) != STAT_OK)  break;
 		if ((status = cm_assertions()) != STAT_OK) break;
 		if ((status = mp_assertions()) != STAT_OK) break;
 		if ((status = st_assertions()) != STAT_OK) break;
+		if ((status = _config_assertions()) != STAT_OK) break;
+		if ((status = hw_stack_assertions()) != STAT_OK) break;
 //+++++	if ((status = xio_assertions()) != STAT_OK) break;
 //		if (rtc.magic_end 		!= MAGICNUM) { value = 19; }
 //		xio_assertions(&value);									// run xio assertions
@@ -354,3 +740,126 @@ stat_t _system_assertions()
 	return (STAT_EAGAIN);	// do not allow main loop to advance beyond this point
 }
 
+/***********************************************************************************
+ * LOOP PROFILE
+ ***********************************************************************************/
+/*
+ * _lp_record()		 - record one call given its starting cycle count
+ * _lp_record_pass() - record the time since the last pass started
+ *
+ * lp_get_n() - get invocations - cfgArray target is the stage's timing struct
+ * lp_get_c() - get total time in ms
+ * lp_get_x() - get worst call in cycles
+ * lp_set_z() - reset the profile
+ */
+ctlProfileSingleton_t lp;
+
+static const uint32_t lp_bin_limit[LP_HISTOGRAM_BINS-1] = {	// upper limit of each bin in us - the last is open
+	10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+
+#ifdef __LOOP_PROFILE
+static void _lp_record(ctlProfileStageTiming_t *t, const uint32_t start)
+{
+	uint32_t cycles = hw_get_cycle_count() - start;	// uint32_t math handles counter wrap
+	if (cycles > t->max) { t->max = cycles;}
+	t->sum += cycles;
+	t->count++;
+}
+
+static void _lp_record_pass()
+{
+	uint32_t now = hw_get_cycle_count();
+	uint32_t us = (now - lp.pass_start) / (F_CPU / 1000000);
+	uint8_t bin = 0;
+	while ((bin < LP_HISTOGRAM_BINS-1) && (us >= lp_bin_limit[bin])) { bin++;}
+	if (lp.pass_start != 0) { lp.pass[bin]++;}	// the first pass has no start
+	lp.pass_start = now;
+}
+#endif // __LOOP_PROFILE
+
+stat_t lp_get_n(cmdObj_t *cmd)
+{
+	cmd->value = (float)((ctlProfileStageTiming_t *)GET_TABLE_WORD(target))->count;
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t lp_get_c(cmdObj_t *cmd)
+{
+	cmd->value = (float)((ctlProfileStageTiming_t *)GET_TABLE_WORD(target))->sum / (F_CPU / 1000);
+	cmd->precision = (int8_t)GET_TABLE_BYTE(precision);
+	cmd->objtype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+
+stat_t lp_get_x(cmdObj_t *cmd)
+{
+	cmd->value = (float)((ctlProfileStageTiming_t *)GET_TABLE_WORD(target))->max;
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t lp_set_z(cmdObj_t *cmd)		// Make sure this function is not part of initialization --> f00
+{
+	memset(&lp.stage, 0, sizeof(lp.stage));
+	memset(&lp.pass, 0, sizeof(lp.pass));
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char msg_lp0[] PROGMEM = "hard reset";		// in ctlProfileStage order
+static const char msg_lp1[] PROGMEM = "alarm idler";
+static const char msg_lp2[] PROGMEM = "switches";
+static const char msg_lp3[] PROGMEM = "feedhold";
+static const char msg_lp4[] PROGMEM = "assertions";
+static const char msg_lp5[] PROGMEM = "deadlines, power, persistence";
+static const char msg_lp6[] PROGMEM = "status report";
+static const char msg_lp7[] PROGMEM = "queue report";
+static const char msg_lp8[] PROGMEM = "cycles";
+static const char msg_lp9[] PROGMEM = "read ahead";
+static const char msg_lp10[] PROGMEM = "syncs";
+static const char msg_lp11[] PROGMEM = "dispatch";
+static const char msg_lp12[] PROGMEM = "idler";
+static const char msg_lp13[] PROGMEM = "background exec";
+static const char msg_lp14[] PROGMEM = "output flush";
+static const char *const msg_lp[] PROGMEM = { msg_lp0, msg_lp1, msg_lp2, msg_lp3, msg_lp4, msg_lp5, msg_lp6,
+										msg_lp7, msg_lp8, msg_lp9, msg_lp10, msg_lp11, msg_lp12, msg_lp13, msg_lp14 };
+
+static const char fmt_lpn[] PROGMEM = "[%s%s] %s calls%*lu\n";
+static const char fmt_lpc[] PROGMEM = "[%s%s] %s time%*.1f ms\n";
+static const char fmt_lpx[] PROGMEM = "[%s%s] %s worst%*lu cycles\n";
+static const char fmt_lph[] PROGMEM = "[lph%s] passes under%6lu us%15lu\n";
+static const char fmt_lph_last[] PROGMEM = "[lph%s] passes over %6lu us%15lu\n";
+
+void lp_print_lp(cmdObj_t *cmd)
+{
+	uint8_t stage = (ctlProfileStageTiming_t *)GET_TABLE_WORD(target) - lp.stage;
+	const char *name = (const char *)GET_TEXT_ITEM(msg_lp, stage);
+	int width = 28 - strlen(name);
+
+	if (cmd->group[2] == 'n') {
+		fprintf_P(stderr, fmt_lpn, cmd->group, cmd->token, name, width, (unsigned long)cmd->value);
+	} else if (cmd->group[2] == 'c') {
+		fprintf_P(stderr, fmt_lpc, cmd->group, cmd->token, name, width+1, cmd->value);
+	} else {
+		fprintf_P(stderr, fmt_lpx, cmd->group, cmd->token, name, width-1, (unsigned long)cmd->value);
+	}
+}
+
+void lp_print_lph(cmdObj_t *cmd)
+{
+	uint8_t bin = (uint32_t *)GET_TABLE_WORD(target) - lp.pass;
+	if (bin < LP_HISTOGRAM_BINS-1) {
+		fprintf_P(stderr, fmt_lph, cmd->token, (unsigned long)lp_bin_limit[bin], (unsigned long)cmd->value);
+	} else {
+		fprintf_P(stderr, fmt_lph_last, cmd->token, (unsigned long)lp_bin_limit[bin-1], (unsigned long)cmd->value);
+	}
+}
+
+#endif // __TEXT_MODE
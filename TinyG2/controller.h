@@ -38,9 +38,76 @@ extern "C"{
 #define APPLICATION_MESSAGE_LEN 64		// application message string storage allocation
 //#define STATUS_MESSAGE_LEN __			// see tinyg2.h for status message string storage allocation
 
+#ifndef CONTROLLER_LINES_PER_PASS
+#define CONTROLLER_LINES_PER_PASS 4		// most input lines run in one controller pass
+#endif
+
 #define LED_NORMAL_TIMER 1000			// blink rate for normal operation (in ms)
 #define LED_ALARM_TIMER 100				// blink rate for alarm state (in ms)
 
+#ifndef CONFIG_CRC_CHUNK
+#define CONFIG_CRC_CHUNK 32				// bytes of config checksummed per assertion pass
+#endif
+
+#ifndef CONTROLLER_IDLE_SLEEP
+#define CONTROLLER_IDLE_SLEEP 1			// 1 = sleep the core (WFI) between interrupts when idle. 0 to debug
+#endif
+
+#ifndef CONTROLLER_WAIT_TIMEOUT_MS
+#define CONTROLLER_WAIT_TIMEOUT_MS 50	// a waiting task is run anyway after this long
+#endif
+
+/*
+ * Ready tasks
+ *
+ *	Event driven tasks in _controller_HSM() only run once something has made them
+ *	ready. Whatever starts their work - a request function, a cycle start, an ISR -
+ *	calls controller_set_ready(). A ready flag is a byte per task so it can be set 
+ *	from an interrupt without a read-modify-write.
+ */
+enum ctlTask {
+	CTL_TASK_HARD_RESET = 0,			// hw_hard_reset_handler()
+	CTL_TASK_LIMIT,						// _limit_switch_handler()
+	CTL_TASK_FEEDHOLD,					// cm_feedhold_sequencing_callback()
+	CTL_TASK_PLAN_HOLD,					// mp_plan_hold_callback()
+	CTL_TASK_ARC,						// cm_arc_callback()
+	CTL_TASK_SPLINE,					// cm_spline_callback()
+	CTL_TASK_CANNED_CYCLE,				// cm_canned_cycle_callback()
+	CTL_TASK_SUBROUTINE,				// gc_subroutine_callback()
+	CTL_TASK_HOMING,					// cm_homing_callback()
+	CTL_TASK_PROBE,						// cm_probe_grid_callback()
+	CTL_TASK_PROBE_TOUCH,				// cm_probe_touch_callback()
+	CTL_TASK_EXEC,						// st_exec_callback() - background exec (see stepper.h)
+	CTL_TASK_JOG,						// cm_jog_callback()
+	CTL_TASKS
+};
+#define controller_set_ready(task) (cs.task_ready[task] = true)
+
+/*
+ * Task events
+ *
+ *	A ready task that can't go on until something else happens - a move ends, a
+ *	planner buffer frees up - waits on an event instead of being called every pass
+ *	to test for it. controller_wait() parks the task on the event, and the task is
+ *	not called again until controller_signal() reports the event, or until 
+ *	CONTROLLER_WAIT_TIMEOUT_MS has passed so a missed event costs a delay and not 
+ *	a hang. A parked task blocks the routines below it in _controller_HSM() as if
+ *	it had returned STAT_EAGAIN. Events may be signaled from interrupts.
+ *
+ *	controller_wait_until() parks the task and then tests the condition, so an event
+ *	that fires in between is not lost. If the condition is already true the task 
+ *	is unparked and it returns true. See coroutine.h for the usual way to use it.
+ */
+enum ctlEvent {
+	CTL_EVENT_NONE = 0,					// task is not waiting
+	CTL_EVENT_MOTION_STOP,				// the runtime went idle - the planner has run out and the motors stopped
+	CTL_EVENT_SWITCH,					// a switch changed state
+	CTL_EVENT_BUFFER,					// a planner buffer was freed
+	CTL_EVENTS
+};
+#define controller_wait_until(task, event, cond) \
+	(controller_wait(task, event), (cond) ? (controller_wait(task, CTL_EVENT_NONE), true) : false)
+
 typedef struct controllerSingleton {	// main TG controller struct
 	magic_t magic_start;				// magic number to test memory integrity
 	uint8_t state;						// controller state
@@ -56,6 +123,11 @@ typedef struct controllerSingleton {	// main TG controller struct
 	uint8_t default_src;				// default source device
 	uint8_t network_mode;				// 0=master, 1=repeater, 2=slave
 	uint16_t linelen;					// length of currently processing line
+	uint8_t line_pending;				// TRUE if the line in in_buf is waiting on the planner
+	uint8_t early_ack;					// answer Gcode lines as they are read ahead ($ea)
+	uint8_t line_check;					// check line numbers and checksums ($lk)
+	uint32_t line_expected;				// number of the next checked line - 0 takes any
+	uint32_t line_resend;				// line asked for again - 0 if none
 
 	// system state variables
 	uint8_t led_state;		// LEGACY	// 0=off, 1=on
@@ -63,6 +135,18 @@ typedef struct controllerSingleton {	// main TG controller struct
 	uint32_t led_timer;					// used by idlers to flash indicator LED
 	uint8_t hard_reset_requested;		// flag to perform a hard reset
 	uint8_t bootloader_requested;		// flag to enter the bootloader
+	volatile uint8_t task_ready[CTL_TASKS];// TRUE if a task has work - see ctlTask
+	volatile uint8_t task_wait[CTL_TASKS];// event a parked task is waiting on - see ctlEvent
+	uint8_t pass_complete;				// TRUE if the last HSM pass ran to the idler
+	uint32_t task_wait_timeout[CTL_TASKS];// systick a parked task is run anyway
+
+	// integrity checks
+	uint32_t assertion_interval;		// ms between integrity checks ($ai)
+	uint32_t assertion_timer;			// systick of the next integrity check
+	uint16_t config_crc;				// checksum of the stepper configs when last written
+	uint16_t config_crc_run;			// checksum being accumulated
+	uint16_t config_crc_offset;			// bytes checksummed so far
+	uint8_t config_crc_valid;			// FALSE until config_crc has been taken since the last write
 
 	// controller serial buffers
 	char_t *bufp;						// pointer to primary or secondary in buffer
@@ -82,10 +166,103 @@ enum cmControllerState {				// manages startup lines
 	CONTROLLER_READY					// controller is active and ready for use
 };
 
+/*
+ * Line checksums
+ *
+ *	With $lk=1 a host can send lines numbered and checksummed, and pipeline many of
+ *	them without a corrupted one running:
+ *
+ *	  N123 G1 X10 Y20*4567
+ *
+ *	The checksum is the compute_checksum() of the text ahead of the '*', as for binary
+ *	frames (see gcode_parser.h). It is checked as the line is read, before it is read 
+ *	ahead or stored, and taken off. The lines must run in order: the first sets the 
+ *	sequence and each after it must be the next number. A line that fails - bad 
+ *	checksum or a number that skips ahead - is answered with the error and an
+ *	exception asking for the line that was due:
+ *
+ *	  {"er":{"fb":100.00,"st":53,"msg":"Checksum mismatch","line":123}}
+ *
+ *	Every line after it is dropped and answered with STAT_LINE_DISCARDED until that 
+ *	line arrives, so the host resends from there, and a line number already run is 
+ *	answered OK and not run again. Another bad checksum while waiting repeats the 
+ *	exception, in case it was the resend. Lines without N and a checksum are run as
+ *	usual unless a resend is awaited. Setting $lk or a queue flush starts a new 
+ *	sequence. Lines wrapped in JSON aren't checked.
+ */
+
+/*
+ * Loop profile
+ *
+ *	Built with __LOOP_PROFILE (tinyg2.h) every dispatch in _controller_HSM() is timed
+ *	with the DWT cycle counter, by stage: invocations, total time and the worst single
+ *	call, plus a histogram of the time for whole passes of the controller. Otherwise 
+ *	the tokens read zero. Cycles are F_CPU clocks and include time spent in ISRs.
+ *
+ *	  $lp			print everything (text mode)
+ *	  {"lpn":""}	invocations by stage
+ *	  {"lpc":""}	total time by stage in ms
+ *	  {"lpx":""}	worst call by stage in cycles
+ *	  {"lph":""}	passes by pass time - see lp_print_lph() for the bins
+ *	  {"lpz":1}		reset
+ */
+enum ctlProfileStage {
+	LP_RESET = 0,						// hard reset handler
+	LP_ALARM,							// alarm idler
+	LP_SWITCHES,						// switch polling and limit switch handler
+	LP_FEEDHOLD,						// feedhold sequencing and hold planning
+	LP_ASSERTIONS,						// system assertions
+	LP_POWER,							// deadline timers, motor power sequencing and flash persistence
+	LP_STATUS_REPORT,
+	LP_QUEUE_REPORT,
+	LP_CYCLES,							// arcs, canned cycles, subroutines and homing
+	LP_READ_AHEAD,						// Gcode read ahead
+	LP_SYNC,							// planner and TX syncs
+	LP_DISPATCH,						// command dispatch
+	LP_IDLER,							// normal idler
+	LP_EXEC,							// background exec
+	LP_FLUSH,							// console output flush at the end of the pass
+	LP_STAGES
+};
+#define LP_HISTOGRAM_BINS 10
+
+typedef struct ctlProfileStageTiming {
+	uint32_t count;						// invocations
+	uint32_t max;						// worst call in cycles
+	uint64_t sum;						// total cycles
+} ctlProfileStageTiming_t;
+
+typedef struct ctlProfileSingleton {
+	ctlProfileStageTiming_t stage[LP_STAGES];
+	uint32_t pass[LP_HISTOGRAM_BINS];	// controller passes by pass time
+	uint32_t pass_start;				// cycle count at the start of the pass
+} ctlProfileSingleton_t;
+
+extern ctlProfileSingleton_t lp;
+
 /**** function prototypes ****/
 
 void controller_init(uint8_t std_in, uint8_t std_out, uint8_t std_err);
 void controller_run(void);
+void controller_config_changed(void);
+void controller_wait(uint8_t task, uint8_t event);
+void controller_signal(uint8_t event);
+uint8_t controller_planner_ready(void);
+void controller_line_check_reset(void);
+stat_t controller_set_lk(cmdObj_t *cmd);
+
+stat_t lp_get_n(cmdObj_t *cmd);
+stat_t lp_get_c(cmdObj_t *cmd);
+stat_t lp_get_x(cmdObj_t *cmd);
+stat_t lp_set_z(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+	void lp_print_lp(cmdObj_t *cmd);
+	void lp_print_lph(cmdObj_t *cmd);
+#else
+	#define lp_print_lp tx_print_stub
+	#define lp_print_lph tx_print_stub
+#endif
 //void controller_reset(void);
 
 //void tg_reset_source(void);
@@ -0,0 +1,62 @@
+/*
+ * coroutine.h - stackless coroutines for controller tasks
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Coroutines
+ *
+ *	A cycle that runs over many controller passes (homing, arcs...) can be written
+ *	as one function that reads top to bottom instead of a chain of state functions.
+ *	The coroutine is a ready task (see ctlTask in controller.h) whose callback is
+ *	bracketed by CO_BEGIN() and CO_END(). Each time it is called it resumes after
+ *	the point it last returned from:
+ *
+ *	  CO_YIELD(co)			return STAT_EAGAIN and resume here on the next pass
+ *	  CO_WAIT_UNTIL(co, c)	return STAT_EAGAIN until condition c is true
+ *	  CO_WAIT_EVENT(co, task, event, c)
+ *							suspend the task on a ctlEvent until condition c is
+ *							true. The task is not called until the event is signaled
+ *	  CO_EXIT(co, status)	end the coroutine early and return status
+ *	  CO_END(co)			end the coroutine and return STAT_OK
+ *
+ *	The resume point is kept in a coContext_t the caller owns - usually a member of
+ *	the cycle's singleton - which must be zeroed to start the coroutine. Rules:
+ *	  - Local variables are not kept across a yield or a wait. Keep state in the singleton
+ *	  - Don't put a yield or wait inside a switch statement in the coroutine
+ *	  - Don't declare initialized locals in a scope that encloses a yield or wait
+ *
+ *	Resume points are numbered with __COUNTER__ so macros can be nested in other
+ *	macros, and more than one can be used on a line.
+ */
+
+#ifndef COROUTINE_H_ONCE
+#define COROUTINE_H_ONCE
+
+typedef uint16_t coContext_t;			// resume point of a coroutine. 0 = start
+
+#define CO_BEGIN(co)					switch (co) { case 0:
+#define CO_END(co)						} (co) = 0; return (STAT_OK);
+#define CO_EXIT(co, status)				do { (co) = 0; return (status);} while (0)
+#define CO_YIELD(co)					_CO_YIELD(co, (__COUNTER__+1))
+#define CO_WAIT_UNTIL(co, cond)			_CO_WAIT_UNTIL(co, cond, (__COUNTER__+1))
+#define CO_WAIT_EVENT(co, task, event, cond) \
+										_CO_WAIT_UNTIL(co, controller_wait_until(task, event, cond), (__COUNTER__+1))
+
+#define _CO_YIELD(co, n)				do { (co) = n; return (STAT_EAGAIN); case n:; } while (0)
+#define _CO_WAIT_UNTIL(co, cond, n)		do { (co) = n; case n: if (!(cond)) return (STAT_EAGAIN);} while (0)
+
+#endif // COROUTINE_H_ONCE
@@ -28,11 +28,15 @@
 #include "tinyg2.h"
 #include "util.h"
 #include "config.h"
+#include "controller.h"
+#include "coroutine.h"
 #include "json_parser.h"
 #include "text_parser.h"
 #include "gcode_parser.h"
 #include "canonical_machine.h"
+#include "report.h"
 #include "planner.h"
+#include "stepper.h"
 #include "switch.h"
 
 #ifdef __cplusplus
@@ -41,6 +45,21 @@ extern "C"{
 
 /**** Homing singleton structure ****/
 
+enum hmGroupPhase {				// moves of a homing group - see _homing_group_move()
+	HM_GROUP_SEARCH = 0,		// drive to the switches
+	HM_GROUP_LATCH,				// back off until the switches open
+	HM_GROUP_ZERO,				// back off to zero
+	HM_GROUP_PHASES
+};
+
+typedef struct hmGroupAxis {	// per-axis parameters for homing in a group
+	int8_t homing_switch;		// homing switch for the axis
+	uint8_t motor_mask;			// motors mapped to the axis
+	float saved_jerk;			// max jerk restored when the axis is zeroed
+	float distance[HM_GROUP_PHASES];// signed distance of each move
+	float velocity[HM_GROUP_PHASES];// velocity of each move
+} hmGroupAxis_t;
+
 struct hmHomingSingleton {		// persistent homing runtime variables
 	// controls for homing cycle
 	int8_t axis;				// axis currently being homed
@@ -51,7 +70,7 @@ struct hmHomingSingleton {		// persistent homing runtime variables
 	uint8_t homing_closed;		// 0=open, 1=closed
 	uint8_t limit_closed;		// 0=open, 1=closed
 	uint8_t set_coordinates;	// G28.4 flag. true = set coords to zero at the end of homing cycle
-	stat_t (*func)(int8_t axis);// binding for callback function state machine
+	coContext_t co;				// resume point of the homing coroutine (see coroutine.h)
 
 	// per-axis parameters
 	float direction;			// set to 1 for positive (max), -1 for negative (to min);
@@ -60,6 +79,7 @@ struct hmHomingSingleton {		// persistent homing runtime variables
 	float latch_velocity;		// latch speed as positive number
 	float latch_backoff;		// max distance to back off switch during latch phase 
 	float zero_backoff;			// distance to back off switch before setting zero
+	float clear_backoff;		// signed distance of each move clearing a switch closed at the start
 	float max_clear_backoff;	// maximum distance of switch clearing backoffs before erring out
 
 	// state saved from gcode model
@@ -68,22 +88,41 @@ struct hmHomingSingleton {		// persistent homing runtime variables
 	uint8_t saved_coord_system;	// G54 - G59 setting
 	uint8_t saved_distance_mode;// G90,G91 global setting
 	float saved_jerk;			// saved and restored for each axis homed
+
+	// axis move engine (see stepper.h)
+	uint8_t engine_move;		// true if the last move ran on the axis move engine
+	float engine_steps_per_unit;// steps per unit of the motors in the engine move
+	float latch_overshoot;		// signed distance the latch move ran past the switch opening
+
+	// homing groups
+	uint8_t grouped;			// axes homed with a group this cycle: bit 0 = X
+	uint8_t group_mask;			// axes in the group being homed
+	volatile uint8_t group_stopped;// axes of the group with all motors stopped in this move
+	volatile uint8_t motors_stopped;// motors stopped by their switch in this move
+	uint16_t group_switches;	// switches bound for the group: bit 0 = X min
+	uint8_t switch_motors[SW_PAIRS * SW_POSITIONS];// motors each switch stops
+	hmGroupAxis_t g[AXES];		// per-axis parameters of the group
 };
 static struct hmHomingSingleton hm;
 
 
 /**** NOTE: global prototypes and other .h info is located in canonical_machine.h ****/
 
-static stat_t _set_homing_func(stat_t (*func)(int8_t axis));
-static stat_t _homing_axis_start(int8_t axis);
-static stat_t _homing_axis_clear(int8_t axis);
-static stat_t _homing_axis_backoff_home(int8_t axis);
-static stat_t _homing_axis_backoff_limit(int8_t axis);
-static stat_t _homing_axis_search(int8_t axis);
-static stat_t _homing_axis_latch(int8_t axis);
-static stat_t _homing_axis_zero_backoff(int8_t axis);
-static stat_t _homing_axis_set_zero(int8_t axis);
+static stat_t _homing_axis_start(void);
+static stat_t _homing_axis_setup(int8_t axis);
+static uint8_t _homing_axis_clear(void);
+static void _homing_axis_set_zero(int8_t axis);
 static stat_t _homing_axis_move(int8_t axis, float target, float velocity);
+#ifdef __AXIS_MOVE_ENGINE
+static stat_t _homing_axis_engine_move(int8_t axis, float target, float velocity);
+static void _homing_axis_engine_sync(int8_t axis);
+#endif
+static void _homing_latch_arm(void);
+static stat_t _homing_group_start(void);
+static stat_t _homing_group_move(uint8_t phase);
+static void _homing_group_stop(switch_t *s);
+static void _homing_group_sync(void);
+static void _homing_group_finish(void);
 static stat_t _homing_finalize_exit(int8_t axis);
 static stat_t _homing_error_exit(int8_t axis);
 static int8_t _get_next_axis(int8_t axis);
@@ -113,10 +152,10 @@ static int8_t _get_next_axis(int8_t axis);
  *	  2. Drive away from the homing switch at latch velocity until switch opens
  *	  3. Back off switch by the zero backoff distance and set zero for that axis
  *
- *	Homing works as a state machine that is driven by registering a callback 
- *	function at hm.func() for the next state to be run. Once the axis is 
- *	initialized each callback basically does two things (1) start the move 
- *	for the current function, and (2) register the next state with hm.func(). 
+ *	Homing runs as a coroutine - cm_homing_callback() - that steps through the
+ *	moves for each axis in order. Once the axis is initialized each step does
+ *	two things (1) start the move, and (2) wait for the move to stop before
+ *	going on to the next one. 
  *	When a move is started it will either be interrupted if the homing switch 
  *	changes state, This will cause the move to stop with a feedhold. The other 
  *	thing that can happen is the move will run to its full length if no switch 
@@ -124,6 +163,21 @@ static int8_t _get_next_axis(int8_t axis);
  *
  *	Once all moves for an axis are complete the next axis in the sequence is homed
  *
+ *	Axes can be put in homing groups ($xhg etc, 1-3). When the first axis of a group
+ *	comes up in the sequence all requested axes of that group are homed together:
+ *	each move drives every axis at its own velocity, and each axis stops on its own
+ *	switch while the others run on (see st_stop_motors()). The move ends when all 
+ *	switches are in. Where each axis stopped is latched in the switch interrupt. 
+ *	Group 0 homes the axis on its own. Grouped axes must have one motor map per 
+ *	motor (Cartesian) - stopping motors per axis is meaningless for mixed kinematics.
+ *
+ *	Gantries: an axis can be driven by more than one motor (motor map). A motor with
+ *	a gantry switch ($4gs etc) stops on that switch instead of the axis homing switch,
+ *	so each side of the gantry stops on its own switch and the gantry is squared. 
+ *	An axis with gantry switches always homes as a group (of one if its group is 0). 
+ *	The axis homing switch sets the axis position. Once homed the motors run 
+ *	together as usual.
+ *
  *	When a homing cycle is initiated the homing state is set to HOMING_NOT_HOMED
  *	When homing completes successfully this is set to HOMING_HOMED, otherwise it
  *	remains HOMING_NOT_HOMED.
@@ -131,7 +185,7 @@ static int8_t _get_next_axis(int8_t axis);
 /*	--- Some further details ---
  *
  *	Note: When coding a cycle (like this one) you get to perform one queued 
- *	move per entry into the continuation, then you must exit. 
+ *	move per entry into the continuation, then you must yield. 
  *
  *	Another Note: When coding a cycle (like this one) you must wait until 
  *	the last move has actually been queued (or has finished) before declaring
@@ -156,9 +210,13 @@ stat_t cm_homing_cycle_start(void)
 	hm.set_coordinates = true;
 
 	hm.axis = -1;							// set to retrieve initial axis
-	hm.func = _homing_axis_start; 			// bind initial processing function
+	hm.engine_move = false;
+	hm.grouped = 0;
+	hm.co = 0;								// start the homing coroutine
 	cm.cycle_state = CYCLE_HOMING;
 	cm.homing_state = HOMING_NOT_HOMED;
+	controller_set_ready(CTL_TASK_HOMING);
+	sr_mark_changed(SR_CHANGED_STATE);
 	return (STAT_OK);
 }
 
@@ -193,6 +251,9 @@ static stat_t _homing_finalize_exit(int8_t axis)	// third part of return to home
 
 static stat_t _homing_error_exit(int8_t axis)
 {
+	switch_reset_callbacks();					// in case a group was being set up
+	st_release_motors();
+
 	// Generate the warning message. Since the error exit returns via the homing callback
 	// - and not the main controller - it requires its own display processing
 	cmd_reset_list();
@@ -221,44 +282,98 @@ static stat_t _homing_error_exit(int8_t axis)
 
 /* Homing axis moves - these execute in sequence for each axis
  * cm_homing_callback() 		- main loop callback for running the homing cycle
- *	_set_homing_func()			- a convenience for setting the next dispatch vector and exiting
- *	_homing_axis_start()		- get next axis, initialize variables, call the clear
- *	_homing_axis_clear()		- initiate a clear to move off a switch that is thrown at the start
- *	_homing_axis_backoff_home()	- back off the cleared home switch
- *	_homing_axis_backoff_limit()- back off the cleared limit switch
- *	_homing_axis_search()		- fast search for switch, closes switch
- *	_homing_axis_latch()		- slow reverse until switch opens again
- *	_homing_axis_final()		- backoff from latch location to zero position 
- *	_homing_axis_move()			- helper that actually executes the above moves
+ *	_homing_axis_start()		- get next axis and initialize variables
+ *	_homing_axis_clear()		- set up a clear to move off a switch that is thrown at the start
+ *	_homing_axis_set_zero()		- set zero for the axis and restore the jerk
+ *	_homing_axis_move()			- helper that actually executes the moves
+ *
+ *	The callback is a coroutine (see coroutine.h) that runs the whole cycle. After
+ *	each move it yields once so the cycle start the move requested can run, then 
+ *	parks until motion stops - when the move runs out or a switch feedholds it.
+ *	It is not called at all while the move runs.
  */
 
+#ifdef __AXIS_MOVE_ENGINE
+#define _homing_engine_sync() if (hm.engine_move == true) { _homing_axis_engine_sync(hm.axis);}
+#else
+#define _homing_engine_sync()
+#endif
+
+#define _homing_wait_for_stop() \
+	CO_WAIT_EVENT(hm.co, CTL_TASK_HOMING, CTL_EVENT_MOTION_STOP, cm_get_runtime_busy() == false); \
+	_homing_engine_sync()
+
+#define _homing_run_move(target, velocity) \
+	_homing_axis_move(hm.axis, target, velocity); \
+	CO_YIELD(hm.co); \
+	_homing_wait_for_stop()
+
+#define _homing_run_group_move(phase) \
+	_homing_group_move(phase); \
+	CO_YIELD(hm.co); \
+	_homing_wait_for_stop(); \
+	_homing_group_sync()
+
 stat_t cm_homing_callback(void)
 {
 	if (cm.cycle_state != CYCLE_HOMING) { return (STAT_NOOP);} 	// exit if not in a homing cycle
-	if (cm_get_runtime_busy() == true) { return (STAT_EAGAIN);}	// sync to planner move ends
-	return (hm.func(hm.axis));									// execute the current homing move
+	stat_t status;
+
+	CO_BEGIN(hm.co);
+	while (true) {
+		_homing_wait_for_stop();									// sync to planner move ends
+		if ((status = _homing_axis_start()) == STAT_COMPLETE) break;// all axes are done
+		if (status == STAT_NOOP) continue;							// homing is disabled for the axis
+		if (status != STAT_OK) CO_EXIT(hm.co, status);				// cycle failed
+
+		if ((status = _homing_group_start()) == STAT_OK) {			// home the axis with its group
+			_homing_run_group_move(HM_GROUP_SEARCH);				// 1. search - each axis stops on its switch
+			_homing_run_group_move(HM_GROUP_LATCH);					// 2. latch - each axis stops as its switch opens
+			_homing_run_group_move(HM_GROUP_ZERO);					// 3. back off to zero
+			_homing_group_finish();
+			continue;
+		}
+		if (status != STAT_NOOP) CO_EXIT(hm.co, status);			// a group axis is misconfigured
+
+		if (_homing_axis_clear() == true) {							// 0. back off a closed switch
+			_homing_run_move(hm.clear_backoff, hm.search_velocity);
+			_homing_run_move(hm.clear_backoff, hm.search_velocity);	// ...and some more
+		}
+		cm.a[hm.axis].jerk_max = cm.a[hm.axis].jerk_homing;		// use the homing jerk for search onward
+		_homing_run_move(hm.search_travel, hm.search_velocity);	// 1. search - closes switch
+		_homing_latch_arm();
+		_homing_run_move(hm.latch_backoff, hm.latch_velocity);		// 2. latch - until switch opens
+		_homing_run_move(hm.zero_backoff - hm.latch_overshoot, hm.search_velocity);// 3. back off to zero from the latch point
+		_homing_axis_set_zero(hm.axis);
+	}
+	_homing_finalize_exit(hm.axis);
+	CO_END(hm.co);
 }
 
-static stat_t _set_homing_func(stat_t (*func)(int8_t axis))
+static stat_t _homing_axis_start()
 {
-	hm.func = func;
-	return (STAT_EAGAIN);
+	int8_t axis = hm.axis;
+
+	// get the first or next axis - skipping axes already homed with their group
+	do {
+		if ((axis = _get_next_axis(axis)) < 0) { 			// axes are done or error
+			if (axis == -1) {								// -1 is done
+				return (STAT_COMPLETE);
+			} else if (axis == -2) { 						// -2 is error
+				cm_set_units_mode(hm.saved_units_mode);
+				cm_set_distance_mode(hm.saved_distance_mode);
+				cm.cycle_state = CYCLE_OFF;
+				cm_cycle_end();
+				return (_homing_error_exit(-2));
+			}
+		}
+	} while (hm.grouped & (1<<axis));
+	return (_homing_axis_setup(axis));
 }
 
-static stat_t _homing_axis_start(int8_t axis)
+// Check the axis settings and load its homing parameters into hm
+static stat_t _homing_axis_setup(int8_t axis)
 {
-	// get the first or next axis
-	if ((axis = _get_next_axis(axis)) < 0) { 				// axes are done or error
-		if (axis == -1) {									// -1 is done
-			return (_set_homing_func(_homing_finalize_exit));
-		} else if (axis == -2) { 							// -2 is error
-			cm_set_units_mode(hm.saved_units_mode);
-			cm_set_distance_mode(hm.saved_distance_mode);
-			cm.cycle_state = CYCLE_OFF;
-			cm_cycle_end();
-			return (_homing_error_exit(-2));
-		}
-	}
 	// trap gross mis-configurations
 	if ((fp_ZERO(cm.a[axis].search_velocity)) || (fp_ZERO(cm.a[axis].latch_velocity))) {
 		return (_homing_error_exit(axis));
@@ -297,17 +412,17 @@ static stat_t _homing_axis_start(int8_t axis)
     // if homing is disabled for the axis then skip to the next axis
 	uint8_t sw_mode = get_switch_mode(hm.homing_switch);
 	if ((sw_mode != SW_MODE_HOMING) && (sw_mode != SW_MODE_HOMING_LIMIT)) {
-		return (_set_homing_func(_homing_axis_start));
+		return (STAT_NOOP);
 	}
 	// disable the limit switch parameter if there is no limit switch
 	if (get_switch_mode(hm.limit_switch) == SW_MODE_DISABLED) { hm.limit_switch = -1;}
 	hm.saved_jerk = cm.a[axis].jerk_max;					// save the max jerk value
-	return (_set_homing_func(_homing_axis_clear));			// start the clear
+	return (STAT_OK);
 }
 
-// Handle an initial switch closure by backing off switches
+// Handle an initial switch closure by backing off switches. Returns true if a clear is needed
 // NOTE: Relies on independent switches per axis (not shared)
-static stat_t _homing_axis_clear(int8_t axis)				// first clear move
+static uint8_t _homing_axis_clear()
 {
 //+++++	int8_t homing = read_switch(hm.homing_switch);
 //+++++	int8_t limit = read_switch(hm.limit_switch);
@@ -315,48 +430,183 @@ static stat_t _homing_axis_clear(int8_t axis)				// first clear move
 	int8_t limit = SW_OPEN;		//+++++
 
 	if ((homing == SW_OPEN) && (limit != SW_CLOSED)) {
- 		return (_set_homing_func(_homing_axis_search));		// OK to start the search
+ 		return (false);										// OK to start the search
 	}
 	if (homing == SW_CLOSED) {
-		_homing_axis_move(axis, hm.latch_backoff, hm.search_velocity);
- 		return (_set_homing_func(_homing_axis_backoff_home));// will backoff homing switch some more
+		hm.clear_backoff = hm.latch_backoff;				// back off the homing switch
+	} else {
+		hm.clear_backoff = -hm.latch_backoff;				// back off the limit switch
 	}
-	_homing_axis_move(axis, -hm.latch_backoff, hm.search_velocity);
- 	return (_set_homing_func(_homing_axis_backoff_limit));	// will backoff limit switch some more
+	return (true);
 }
 
-static stat_t _homing_axis_backoff_home(int8_t axis)		// back off cleared homing switch
+// Forget the last homing switch edge before the latch. If the switch opens while the 
+// latch move runs on the axis move engine, _homing_axis_engine_sync() measures how far
+// the move ran past it from the step count taken in the switch interrupt.
+static void _homing_latch_arm()
 {
-	_homing_axis_move(axis, hm.latch_backoff, hm.search_velocity);
-    return (_set_homing_func(_homing_axis_search));
+	hm.latch_overshoot = 0;
+	GET_SWITCH(hm.homing_switch)->edge = SW_NO_EDGE;
 }
 
-static stat_t _homing_axis_backoff_limit(int8_t axis)		// back off cleared limit switch
+/*
+ * _homing_group_start()  - set up the group of the current axis. STAT_NOOP if it homes alone
+ * _homing_group_move()	  - start one move of the group and bind its switches for the move
+ * _homing_group_stop()	  - switch interrupt: stop the motors of the switch that changed
+ * _homing_group_sync()	  - correct the group positions for the axes that stopped early
+ * _homing_group_finish() - set zero for the group and restore the switch bindings
+ *
+ *	Search and latch moves are stretched so every axis runs at its own velocity for 
+ *	the time the slowest one needs. These end on the switches anyway. The zero move 
+ *	runs the exact distances and is timed by the slowest axis.
+ *
+ *	The latch move stops each axis when its switch opens, so zero is set from the 
+ *	switch opening without the overshoot correction of the sequential cycle.
+ */
+
+static uint8_t _homing_axis_is_gantry(int8_t axis)
 {
-	_homing_axis_move(axis, -hm.latch_backoff, hm.search_velocity);
-    return (_set_homing_func(_homing_axis_search));
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if ((st.m[motor].motor_map == axis) && (st.m[motor].gantry_switch != 0)) { return (true);}
+	}
+	return (false);
 }
 
-static stat_t _homing_axis_search(int8_t axis)				// start the search
+static stat_t _homing_group_start()
 {
-	cm.a[axis].jerk_max = cm.a[axis].jerk_homing;			// use the homing jerk for search onward
-	_homing_axis_move(axis, hm.search_travel, hm.search_velocity);
-    return (_set_homing_func(_homing_axis_latch));
+	uint8_t group = cm.a[hm.axis].homing_group;
+	if ((group == 0) && (_homing_axis_is_gantry(hm.axis) == false)) { return (STAT_NOOP);}
+
+	int8_t first_axis = hm.axis;							// _homing_axis_setup() moves hm.axis
+	stat_t status;
+	hm.group_mask = 0;
+	hm.group_switches = 0;
+	memset(hm.switch_motors, 0, sizeof(hm.switch_motors));
+	for (int8_t axis = first_axis; axis >= 0; axis = _get_next_axis(axis)) {
+		if ((axis != first_axis) && ((group == 0) || (cm.a[axis].homing_group != group))) continue;
+		if ((axis != first_axis) && ((status = _homing_axis_setup(axis)) != STAT_OK)) {
+			if (status == STAT_NOOP) continue;				// homing is disabled for the axis
+			return (status);
+		}
+		hmGroupAxis_t *g = &hm.g[axis];
+		g->homing_switch = hm.homing_switch;
+		g->saved_jerk = hm.saved_jerk;
+		g->distance[HM_GROUP_SEARCH] = hm.search_travel;
+		g->velocity[HM_GROUP_SEARCH] = hm.search_velocity;
+		g->distance[HM_GROUP_LATCH] = hm.latch_backoff;
+		g->velocity[HM_GROUP_LATCH] = hm.latch_velocity;
+		g->distance[HM_GROUP_ZERO] = hm.zero_backoff;
+		g->velocity[HM_GROUP_ZERO] = hm.search_velocity;
+		g->motor_mask = 0;
+		hm.group_switches |= (1<<hm.homing_switch);			// sets the axis position, if nothing else
+		for (uint8_t motor=0; motor<MOTORS; motor++) {
+			if (st.m[motor].motor_map != axis) continue;
+			int8_t sw_num = hm.homing_switch;
+			if (st.m[motor].gantry_switch != 0) {
+				sw_num = st.m[motor].gantry_switch - 1;
+				if (get_switch_mode(sw_num) == SW_MODE_DISABLED) { return (_homing_error_exit(axis));}
+			}
+			g->motor_mask |= (1<<motor);
+			hm.switch_motors[sw_num] |= (1<<motor);
+			hm.group_switches |= (1<<sw_num);
+		}
+		cm.a[axis].jerk_max = cm.a[axis].jerk_homing;		// use the homing jerk throughout
+		hm.group_mask |= (1<<axis);
+	}
+	hm.axis = first_axis;
+	hm.grouped |= hm.group_mask;
+	return (STAT_OK);
 }
 
-static stat_t _homing_axis_latch(int8_t axis)				// latch to switch open
+static stat_t _homing_group_move(uint8_t phase)
 {
-	_homing_axis_move(axis, hm.latch_backoff, hm.latch_velocity);    
-	return (_set_homing_func(_homing_axis_zero_backoff)); 
+	float vect[] = {0,0,0,0,0,0};
+	float flags[] = {false, false, false, false, false, false};
+	float time = 0;
+	float length = 0;
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if ((hm.group_mask & (1<<axis)) == 0) continue;
+		float axis_time = fabs(hm.g[axis].distance[phase]) / hm.g[axis].velocity[phase];
+		if (axis_time > time) { time = axis_time;}
+	}
+	if (fp_ZERO(time)) { return (STAT_OK);}					// e.g. no zero backoff
+
+	hm.group_stopped = 0;
+	hm.motors_stopped = 0;
+	for (uint8_t sw_num=0; sw_num < (SW_PAIRS * SW_POSITIONS); sw_num++) {
+		if (phase == HM_GROUP_ZERO) {						// backing off - switches feedhold again
+			switch_reset_callbacks();
+			break;
+		}
+		if ((hm.group_switches & (1<<sw_num)) == 0) continue;
+		if (phase == HM_GROUP_SEARCH) {
+			switch_set_callbacks(sw_num, _homing_group_stop, NULL);
+		} else {
+			switch_set_callbacks(sw_num, NULL, _homing_group_stop);
+		}
+	}
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if ((hm.group_mask & (1<<axis)) == 0) continue;
+		hmGroupAxis_t *g = &hm.g[axis];
+		if (phase == HM_GROUP_ZERO) {
+			vect[axis] = g->distance[phase];
+		} else {
+			vect[axis] = copysign(g->velocity[phase] * time, g->distance[phase]);
+		}
+		st_clear_latch(axis);
+		flags[axis] = true;
+		length += square(vect[axis]);
+	}
+	cm_set_feed_rate(sqrt(length) / time);
+	mp_flush_planner();										// don't use cm_request_queue_flush() here
+	cm_request_cycle_start();
+	ritorno(cm_straight_feed(vect, flags));
+	return (STAT_EAGAIN);
+}
+
+static void _homing_group_stop(switch_t *s)
+{
+	uint8_t sw_num = GET_SWITCH_NUM(s);
+	st_stop_motors(hm.switch_motors[sw_num]);				// first - the motors are at the switch
+	hm.motors_stopped |= hm.switch_motors[sw_num];
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if ((hm.group_mask & (1<<axis)) == 0) continue;
+		if (hm.g[axis].homing_switch == sw_num) { st_latch_position(axis);}	// the axis is here
+		if ((hm.g[axis].motor_mask & ~hm.motors_stopped) == 0) { hm.group_stopped |= (1<<axis);}
+	}
+	if (hm.group_stopped == hm.group_mask) {
+		cm_request_feedhold();								// all axes are in - end the move
+	}
+}
+
+static void _homing_group_sync()
+{
+	float latched[AXES];
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if ((hm.group_mask & (1<<axis)) == 0) continue;
+		float position = mp_get_runtime_absolute_position(axis);
+		if (st_get_latched_position(axis, latched) == true) {
+			position = latched[axis];						// the axis switch changed here
+			mp_set_runtime_position(axis, position);
+		}
+		cm_set_axis_origin(axis, position);					// sets the model and planner positions
+	}
+	st_release_motors();
 }
 
-static stat_t _homing_axis_zero_backoff(int8_t axis)		// backoff to zero position
+static void _homing_group_finish()
 {
-	_homing_axis_move(axis, hm.zero_backoff, hm.search_velocity);
-	return (_set_homing_func(_homing_axis_set_zero));
+	switch_reset_callbacks();
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if ((hm.group_mask & (1<<axis)) == 0) continue;
+		hm.saved_jerk = hm.g[axis].saved_jerk;
+		_homing_axis_set_zero(axis);
+	}
 }
 
-static stat_t _homing_axis_set_zero(int8_t axis)			// set zero and finish up
+static void _homing_axis_set_zero(int8_t axis)			// set zero and finish up
 {
 	if (hm.set_coordinates != false) {						// do not set axis if in G28.4 cycle
 		cm_set_axis_origin(axis, 0);
@@ -367,7 +617,6 @@ static stat_t _homing_axis_set_zero(int8_t axis)			// set zero and finish up
 	}
 	cm.a[axis].jerk_max = hm.saved_jerk;					// restore the max jerk value
 	cm.homed[axis] = true;
-	return (_set_homing_func(_homing_axis_start));
 }
 
 static stat_t _homing_axis_move(int8_t axis, float target, float velocity)
@@ -375,6 +624,9 @@ static stat_t _homing_axis_move(int8_t axis, float target, float velocity)
 	float vect[] = {0,0,0,0,0,0};
 	float flags[] = {false, false, false, false, false, false};
 
+#ifdef __AXIS_MOVE_ENGINE
+	if (_homing_axis_engine_move(axis, target, velocity) == STAT_OK) { return (STAT_EAGAIN);}
+#endif
 	vect[axis] = target;
 	flags[axis] = true;
 	cm_set_feed_rate(velocity);
@@ -384,6 +636,62 @@ static stat_t _homing_axis_move(int8_t axis, float target, float velocity)
 	return (STAT_EAGAIN);
 }
 
+#ifdef __AXIS_MOVE_ENGINE
+/*
+ * _homing_axis_engine_move() - run a homing move on the axis move engine
+ * _homing_axis_engine_sync() - update the runtime and model positions after the move
+ *
+ *	The engine steps all motors mapped to the axis in lockstep. This requires that
+ *	they have the same steps per unit. Otherwise the move returns an error and the
+ *	caller falls back to the planner. A homing switch stops the engine through
+ *	st_axis_stop() (see switch.cpp) in place of a feedhold.
+ *
+ *	After the latch move the zero backoff is shortened by the distance the move ran
+ *	past the switch opening, so zero is set from where the switch opened and not from
+ *	where the move stopped.
+ *
+ *	The engine ramps at constant acceleration. This is set to sqrt(v*j)/2, which 
+ *	reaches velocity in the same time as a jerk limited move at the current jerk.
+ */
+
+static stat_t _homing_axis_engine_move(int8_t axis, float target, float velocity)
+{
+	uint8_t motor_mask = 0;
+	float steps_per_unit = 0;
+
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if (st.m[motor].motor_map != axis) continue;
+		if ((motor_mask != 0) && (fp_NE(st.m[motor].steps_per_unit, steps_per_unit))) {
+			return (STAT_INPUT_VALUE_UNSUPPORTED);			// motors cannot run in lockstep
+		}
+		motor_mask |= (1<<motor);
+		steps_per_unit = st.m[motor].steps_per_unit;
+	}
+	if (motor_mask == 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+
+	float acceleration = sqrt(velocity * cm.a[axis].jerk_max * JERK_MULTIPLIER) / 2;	// mm/min^2
+	mp_flush_planner();										// don't use cm_request_queue_flush() here
+	ritorno(st_axis_move(motor_mask, (int32_t)(target * steps_per_unit), 
+						 velocity * steps_per_unit / 60, acceleration * steps_per_unit / 3600));
+	hm.engine_move = true;
+	hm.engine_steps_per_unit = steps_per_unit;
+	return (STAT_OK);
+}
+
+static void _homing_axis_engine_sync(int8_t axis)
+{
+	float position = mp_get_runtime_absolute_position(axis) + st_axis_get_steps() / hm.engine_steps_per_unit;
+	mp_set_runtime_position(axis, position);
+	cm_set_axis_origin(axis, position);						// sets the model and planner positions
+	hm.engine_move = false;
+
+	switch_t *s = GET_SWITCH(hm.homing_switch);
+	if (s->edge == SW_TRAILING) {							// the switch opened during the move
+		hm.latch_overshoot = (st_axis_get_steps() - s->edge_steps) / hm.engine_steps_per_unit;
+	}
+}
+#endif // __AXIS_MOVE_ENGINE
+
 // _run_homing_dual_axis() - kernal routine for running homing on a dual axis
 //static stat_t _run_homing_dual_axis(int8_t axis) { return (STAT_OK);}
 
@@ -406,23 +714,31 @@ static int8_t _get_next_axis(int8_t axis)
 		if (fp_TRUE(gf.target[AXIS_Z])) return (AXIS_Z);
 		if (fp_TRUE(gf.target[AXIS_X])) return (AXIS_X);
 		if (fp_TRUE(gf.target[AXIS_Y])) return (AXIS_Y);
+#if (AXES > AXIS_A)
 		if (fp_TRUE(gf.target[AXIS_A])) return (AXIS_A);
+#endif
 //		if (fp_TRUE(gf.target[AXIS_B])) return (AXIS_B);
 //		if (fp_TRUE(gf.target[AXIS_C])) return (AXIS_C);
 		return (-2);	// error
 	} else if (axis == AXIS_Z) {
 		if (fp_TRUE(gf.target[AXIS_X])) return (AXIS_X);
 		if (fp_TRUE(gf.target[AXIS_Y])) return (AXIS_Y);
+#if (AXES > AXIS_A)
 		if (fp_TRUE(gf.target[AXIS_A])) return (AXIS_A);
+#endif
 //		if (fp_TRUE(gf.target[AXIS_B])) return (AXIS_B);
 //		if (fp_TRUE(gf.target[AXIS_C])) return (AXIS_C);
 	} else if (axis == AXIS_X) {
 		if (fp_TRUE(gf.target[AXIS_Y])) return (AXIS_Y);
+#if (AXES > AXIS_A)
 		if (fp_TRUE(gf.target[AXIS_A])) return (AXIS_A);
+#endif
 //		if (fp_TRUE(gf.target[AXIS_B])) return (AXIS_B);
 //		if (fp_TRUE(gf.target[AXIS_C])) return (AXIS_C);
 	} else if (axis == AXIS_Y) {
+#if (AXES > AXIS_A)
 		if (fp_TRUE(gf.target[AXIS_A])) return (AXIS_A);
+#endif
 //		if (fp_TRUE(gf.target[AXIS_B])) return (AXIS_B);
 //		if (fp_TRUE(gf.target[AXIS_C])) return (AXIS_C);
 //	} else if (axis == AXIS_A) {
@@ -28,6 +28,8 @@
 #include "tinyg2.h"
 #include "util.h"
 #include "config.h"
+#include "controller.h"
+#include "coroutine.h"
 #include "json_parser.h"
 #include "text_parser.h"
 #include "gcode_parser.h"
@@ -36,6 +38,7 @@
 #include "stepper.h"
 #include "report.h"
 #include "switch.h"
+#include "kinematics.h"
 
 #ifdef __cplusplus
 extern "C"{
@@ -70,6 +73,28 @@ struct pbProbingSingleton {		// persistent homing runtime variables
 	uint8_t saved_coord_system;	// G54 - G59 setting
 	uint8_t saved_distance_mode;// G90,G91 global setting
 	float saved_jerk;			// saved and restored for each axis homed	
+
+	// grid probing (G38.6)
+	coContext_t co;				// resume point of the grid coroutine (see coroutine.h)
+	uint8_t probe_switch;		// switch the probe is wired to
+	uint16_t point;				// grid point being probed - in probing order
+	uint16_t index;				// height map index of the point
+	float point_x;				// machine position of the point
+	float point_y;
+	float start_z;				// Z the grid is traversed at
+	float probe_z;				// lowest Z a probe may go to
+	float probe_velocity;
+	float reference_z;			// Z of the first touch. Heights are relative to it
+
+	// multi-touch probing (G38.7) - uses axis, probe_switch, direction, latch_backoff and the velocities
+	uint8_t touches;			// slow touches to make
+	uint8_t touch;				// slow touch being made
+	float probe_end;			// machine position the approach may go to
+	float touch_position;		// machine position of the last touch
+	float touch_mean;			// running mean and sum of squared deviations of the slow touches
+	float touch_m2;
+	float touch_min;
+	float touch_max;
 };
 static struct pbProbingSingleton pb;
 
@@ -89,6 +114,14 @@ static stat_t _probing_axis_move(int8_t axis, float target, float velocity);
 static stat_t _probing_finalize_exit(int8_t axis);
 static stat_t _probing_error_exit(int8_t axis);
 static int8_t _get_next_axis(int8_t axis);
+static void _probe_grid_point(void);
+static void _probe_grid_move(float x, float y, float z, float velocity);
+static stat_t _probe_grid_exit(stat_t status, const char *message);
+static void _probe_grid_touch(switch_t *s);
+static void _probe_touch_move(float position, float velocity);
+static void _probe_touch_record(float position);
+static stat_t _probe_touch_exit(stat_t status, const char *message);
+static stat_t _probe_cycle_end(stat_t status);
 
 
 /*****************************************************************************
@@ -162,6 +195,7 @@ uint8_t cm_probe_cycle_start(void)
 	pb.axis = -1;							// set to retrieve initial axis
 	pb.func = _probing_axis_start; 			// bind initial processing function
 	cm.cycle_state = CYCLE_PROBE;
+	sr_mark_changed(SR_CHANGED_STATE);
 	st_energize_motors();					// enable motors if not already enabled
 	return (STAT_OK);
 }
@@ -240,6 +274,10 @@ static stat_t _probing_error_exit(int8_t axis)
  *	_probing_axis_latch()		- slow reverse until switch opens again
  *	_probing_axis_final()		- backoff from latch location to zero position 
  *	_probing_axis_move()			- helper that actually executes the above moves
+ *
+ *	The probe position is latched in the switch interrupt when the search closes the 
+ *	switch (see st_latch_position()), so it does not depend on the feed rate or on 
+ *	how long the controller takes to see the switch. The latch records it.
  */
 
 static stat_t _probing_axis_start(int8_t axis)
@@ -340,12 +378,17 @@ static stat_t _probing_axis_backoff_limit(int8_t axis)		// back off cleared limi
 static stat_t _probing_axis_search(int8_t axis)				// start the search
 {
 	cm.a[axis].jerk_max = cm.a[axis].jerk_homing;	// use the homing jerk for search onward
+	st_clear_latch(ST_LATCH_PROBE);						// the switch latches the position it closes at
 	_probing_axis_move(axis, pb.search_travel, pb.search_velocity);
     return (_set_pb_func(_probing_axis_latch));
 }
 
 static stat_t _probing_axis_latch(int8_t axis)				// latch to switch open
 {
+	float position[AXES];
+	if (st_get_latched_position(ST_LATCH_PROBE, position) == true) {	// position the switch closed at in the search
+		cm_probe_set_position(position[axis]);
+	}
 	_probing_axis_move(axis, pb.latch_backoff, pb.latch_velocity);    
 	return (_set_pb_func(_probing_axis_zero_backoff)); 
 }
@@ -374,6 +417,371 @@ static stat_t _probing_axis_move(int8_t axis, float target, float velocity)
 	return (STAT_EAGAIN);
 }
 
+/*****************************************************************************
+ * cm_probe_grid_start()	- G38.6 probe a grid into the height map
+ * cm_probe_grid_callback() - main loop callback for running the grid cycle
+ *
+ *	G38.6 X<width> Y<depth> Z<probe depth> I<points along X> J<points along Y>
+ *
+ *	Probes a grid from the current position in +X and +Y and stores the heights in 
+ *	the height map (see kinematics.h), which is enabled when the grid is done. The 
+ *	probe is the Z min switch. Each point is traversed to at the starting Z, probed 
+ *	down at the Z latch velocity for up to the probe depth, then retracted. The touch 
+ *	position is latched in the switch interrupt (see st_latch_position()). Rows are 
+ *	probed in alternate directions to save travel. Heights are relative to the first 
+ *	point - the starting position - so Z should be zeroed on the work there.
+ *
+ *	The cycle is a coroutine run as CTL_TASK_PROBE. It fails if the probe is closed 
+ *	before a point is probed or does not touch within the probe depth.
+ */
+
+stat_t cm_probe_grid_start(float target[], float flags[], float offset[])
+{
+	float units = (gm.units_mode == INCHES) ? MM_PER_INCH : 1;
+	float width = target[AXIS_X] * units;
+	float depth = target[AXIS_Y] * units;
+	float probe_depth = target[AXIS_Z] * units;
+
+	if (fp_FALSE(flags[AXIS_X]) || fp_FALSE(flags[AXIS_Y]) || fp_FALSE(flags[AXIS_Z]) ||
+		(width < EPSILON) || (depth < EPSILON) || (probe_depth < EPSILON) || 
+		(offset[0] < 2) || (offset[1] < 2)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	if ((get_switch_mode(MIN_SWITCH(AXIS_Z)) == SW_MODE_DISABLED) || 
+		(fp_ZERO(cm.a[AXIS_Z].latch_velocity))) {
+		return (STAT_PROBING_CYCLE_FAILED);		// no probe input or velocity
+	}
+	uint8_t points_x = (uint8_t)min(offset[0], HEIGHT_MAP_AXIS_POINTS_MAX + 1);
+	uint8_t points_y = (uint8_t)min(offset[1], HEIGHT_MAP_AXIS_POINTS_MAX + 1);
+
+	// the grid starts where the queued moves end - the model position
+	ritorno(ik_height_map_init(cm_get_absolute_position(MODEL, AXIS_X), cm_get_absolute_position(MODEL, AXIS_Y),
+							   width / (points_x - 1), depth / (points_y - 1), points_x, points_y));
+	pb.start_z = cm_get_absolute_position(MODEL, AXIS_Z);
+	pb.probe_z = pb.start_z - probe_depth;
+	pb.probe_velocity = fabs(cm.a[AXIS_Z].latch_velocity);
+	pb.probe_switch = MIN_SWITCH(AXIS_Z);
+
+	// save relevant non-axis parameters from Gcode model
+	pb.saved_units_mode = gm.units_mode;
+	pb.saved_coord_system = gm.coord_system;
+	pb.saved_distance_mode = gm.distance_mode;
+	pb.saved_feed_rate = gm.feed_rate;
+
+	// set working values
+	cm_set_units_mode(MILLIMETERS);
+	cm_set_distance_mode(INCREMENTAL_MODE);
+	cm_set_coord_system(ABSOLUTE_COORDS);	// probing is done in machine coordinates
+
+	pb.co = 0;								// start the grid coroutine
+	cm.cycle_state = CYCLE_PROBE;
+	controller_set_ready(CTL_TASK_PROBE);
+	sr_mark_changed(SR_CHANGED_STATE);
+	st_energize_motors();					// enable motors if not already enabled
+	return (STAT_OK);
+}
+
+#define _probe_grid_run_move(x, y, z, velocity) \
+	_probe_grid_move(x, y, z, velocity); \
+	CO_YIELD(pb.co); \
+	CO_WAIT_EVENT(pb.co, CTL_TASK_PROBE, CTL_EVENT_MOTION_STOP, cm_get_runtime_busy() == false)
+
+stat_t cm_probe_grid_callback(void)
+{
+	if (cm.cycle_state != CYCLE_PROBE) { return (STAT_NOOP);}	// exit if not in a probing cycle
+	float position[AXES];
+
+	CO_BEGIN(pb.co);
+	CO_WAIT_EVENT(pb.co, CTL_TASK_PROBE, CTL_EVENT_MOTION_STOP, cm_get_runtime_busy() == false);
+	switch_set_callbacks(pb.probe_switch, _probe_grid_touch, NULL);
+
+	for (pb.point = 0; pb.point < (uint16_t)hmap.points_x * hmap.points_y; pb.point++) {
+		_probe_grid_point();
+		_probe_grid_run_move(pb.point_x, pb.point_y, pb.start_z, 0);	// traverse to the point
+		if (GET_SWITCH(pb.probe_switch)->state == SW_CLOSED) {
+			CO_EXIT(pb.co, _probe_grid_exit(STAT_PROBING_CYCLE_FAILED, "probe closed before probing"));
+		}
+		st_clear_latch(ST_LATCH_PROBE);
+		_probe_grid_run_move(pb.point_x, pb.point_y, pb.probe_z, pb.probe_velocity);
+		if (st_get_latched_position(ST_LATCH_PROBE, position) == false) {
+			CO_EXIT(pb.co, _probe_grid_exit(STAT_PROBING_CYCLE_FAILED, "no contact within probe depth"));
+		}
+		if (pb.point == 0) { pb.reference_z = position[AXIS_Z];}
+		ik_height_map_set(pb.index, position[AXIS_Z] - pb.reference_z);
+		_probe_grid_run_move(pb.point_x, pb.point_y, pb.start_z, 0);	// retract
+	}
+	_probe_grid_run_move(hmap.origin_x, hmap.origin_y, pb.start_z, 0);	// back to the start
+	hmap.enable = true;
+	_probe_grid_exit(STAT_OK, NULL);
+	CO_END(pb.co);
+}
+
+/*
+ * _probe_grid_point() - machine position of the current point. Odd rows run back along X
+ */
+
+static void _probe_grid_point()
+{
+	uint8_t row = pb.point / hmap.points_x;
+	uint8_t column = pb.point % hmap.points_x;
+	if (row & 1) { column = hmap.points_x - 1 - column;}
+	pb.index = (uint16_t)row * hmap.points_x + column;
+	pb.point_x = hmap.origin_x + column * hmap.spacing_x;
+	pb.point_y = hmap.origin_y + row * hmap.spacing_y;
+}
+
+/*
+ * _probe_grid_move() - move to a machine position. A velocity of 0 is a traverse
+ *
+ *	A probe move stops short with a feedhold, so the model and planner are brought 
+ *	to the runtime position before each move is queued from it.
+ */
+
+static void _probe_grid_move(float x, float y, float z, float velocity)
+{
+	float vect[] = {0,0,0,0,0,0};
+	float flags[] = {false, false, false, false, false, false};
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		cm_set_axis_origin(axis, mp_get_runtime_absolute_position(axis));
+	}
+	vect[AXIS_X] = x - mp_get_runtime_absolute_position(AXIS_X);
+	vect[AXIS_Y] = y - mp_get_runtime_absolute_position(AXIS_Y);
+	vect[AXIS_Z] = z - mp_get_runtime_absolute_position(AXIS_Z);
+	flags[AXIS_X] = true;
+	flags[AXIS_Y] = true;
+	flags[AXIS_Z] = true;
+	mp_flush_planner();										// don't use cm_request_queue_flush() here
+	cm_request_cycle_start();
+	if (velocity > 0) {
+		cm_set_feed_rate(velocity);
+		cm_straight_feed(vect, flags);
+	} else {
+		cm_straight_traverse(vect, flags);
+	}
+}
+
+/*
+ * _probe_grid_touch() - probe switch leading edge. Runs in the switch interrupt
+ *
+ *	Only the touch is acted on - the probe opening on the retract must not cycle start.
+ */
+
+static void _probe_grid_touch(switch_t *s)
+{
+	st_latch_position(ST_LATCH_PROBE);
+	cm_request_feedhold();
+}
+
+/*
+ * _probe_grid_exit() - restore the Gcode model and end the cycle. A failed cycle 
+ *						leaves no height map
+ */
+
+static stat_t _probe_grid_exit(stat_t status, const char *message)
+{
+	if (status != STAT_OK) {
+		hmap.points_x = 0;
+		cmd_reset_list();
+		char buffer[CMD_MESSAGE_LEN];
+		sprintf_P(buffer, PSTR("*** WARNING *** Probing error: %s at point %d"), message, pb.point);
+		cmd_add_conditional_message((char_t *)buffer);
+		cmd_print_list(status, TEXT_INLINE_VALUES, JSON_RESPONSE_FORMAT);
+	}
+	return (_probe_cycle_end(status));
+}
+
+/*****************************************************************************
+ * cm_probe_touch_start()	 - G38.7 touch off a surface several times and average
+ * cm_probe_touch_callback() - main loop callback for running the touch cycle
+ *
+ *	G38.7 <axis><distance> L<touches>
+ *
+ *	One of X, Y or Z gives the direction and how far from the current position the 
+ *	surface may be; L the slow touches to make (PROBE_TOUCHES without one). The probe 
+ *	is the axis min switch probing in the negative direction, else the max switch. 
+ *	The cycle approaches at the axis search velocity until the probe touches, backs 
+ *	off by the axis latch backoff, then makes the slow touches at the latch velocity, 
+ *	backing off after each. Each touch goes up to twice the backoff past where it 
+ *	started. Touch positions are latched in the switch interrupt, so they are not 
+ *	affected by the velocity or by how long the feedhold takes to stop.
+ *
+ *	The slow touches are reported when the cycle ends, in machine coordinates and in 
+ *	the units of the command, as one JSON object in text mode and JSON mode alike:
+ *
+ *	  {"prb":{"axis":"z","n":5,"mean":-12.0313,"min":-12.0325,"max":-12.0300,"rng":0.0025,"sd":0.0009}}
+ *
+ *	rng is max less min; sd the standard deviation of the touches. The approach touch 
+ *	only finds the surface and isn't in the result. The cycle is a coroutine run as 
+ *	CTL_TASK_PROBE_TOUCH, and fails if the probe is closed before the approach or after a 
+ *	backoff, or the approach or a touch doesn't touch.
+ */
+
+stat_t cm_probe_touch_start(float target[], float flags[], uint8_t touches)
+{
+	float units = (gm.units_mode == INCHES) ? MM_PER_INCH : 1;
+	int8_t axis = -1;
+
+	for (uint8_t i=0; i<AXES; i++) {
+		if (fp_FALSE(flags[i])) { continue;}
+		if ((axis != -1) || (i > AXIS_Z)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}	// one of X, Y or Z
+		axis = i;
+	}
+	if ((axis == -1) || (fabs(target[axis]) < EPSILON) || (touches == 0)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	pb.direction = (target[axis] < 0) ? -1 : 1;
+	pb.probe_switch = (pb.direction < 0) ? MIN_SWITCH(axis) : MAX_SWITCH(axis);
+	if ((get_switch_mode(pb.probe_switch) == SW_MODE_DISABLED) || 
+		(fp_ZERO(cm.a[axis].search_velocity)) || (fp_ZERO(cm.a[axis].latch_velocity)) ||
+		(cm.a[axis].latch_backoff <= 0)) {
+		return (STAT_PROBING_CYCLE_FAILED);		// no probe input, velocity or backoff
+	}
+	pb.axis = axis;
+	pb.touches = touches;
+	pb.search_velocity = fabs(cm.a[axis].search_velocity);
+	pb.latch_velocity = fabs(cm.a[axis].latch_velocity);
+	pb.latch_backoff = cm.a[axis].latch_backoff;
+	pb.probe_end = cm_get_absolute_position(MODEL, axis) + target[axis] * units;	// from where the queued moves end
+
+	// save relevant non-axis parameters from Gcode model
+	pb.saved_units_mode = gm.units_mode;
+	pb.saved_coord_system = gm.coord_system;
+	pb.saved_distance_mode = gm.distance_mode;
+	pb.saved_feed_rate = gm.feed_rate;
+
+	// set working values
+	cm_set_units_mode(MILLIMETERS);
+	cm_set_distance_mode(INCREMENTAL_MODE);
+	cm_set_coord_system(ABSOLUTE_COORDS);	// probing is done in machine coordinates
+
+	pb.co = 0;								// start the touch coroutine
+	cm.cycle_state = CYCLE_PROBE;
+	controller_set_ready(CTL_TASK_PROBE_TOUCH);
+	sr_mark_changed(SR_CHANGED_STATE);
+	st_energize_motors();					// enable motors if not already enabled
+	return (STAT_OK);
+}
+
+#define _probe_touch_run_move(position, velocity) \
+	_probe_touch_move(position, velocity); \
+	CO_YIELD(pb.co); \
+	CO_WAIT_EVENT(pb.co, CTL_TASK_PROBE_TOUCH, CTL_EVENT_MOTION_STOP, cm_get_runtime_busy() == false)
+
+stat_t cm_probe_touch_callback(void)
+{
+	if (cm.cycle_state != CYCLE_PROBE) { return (STAT_NOOP);}	// exit if not in a probing cycle
+	float position[AXES];
+
+	CO_BEGIN(pb.co);
+	CO_WAIT_EVENT(pb.co, CTL_TASK_PROBE_TOUCH, CTL_EVENT_MOTION_STOP, cm_get_runtime_busy() == false);
+	switch_set_callbacks(pb.probe_switch, _probe_grid_touch, NULL);
+
+	pb.touch = 0;
+	if (GET_SWITCH(pb.probe_switch)->state == SW_CLOSED) {
+		CO_EXIT(pb.co, _probe_touch_exit(STAT_PROBING_CYCLE_FAILED, "probe closed before probing"));
+	}
+	st_clear_latch(ST_LATCH_PROBE);
+	_probe_touch_run_move(pb.probe_end, pb.search_velocity);		// approach
+	if (st_get_latched_position(ST_LATCH_PROBE, position) == false) {
+		CO_EXIT(pb.co, _probe_touch_exit(STAT_PROBING_CYCLE_FAILED, "no contact within probe distance"));
+	}
+	pb.touch_position = position[pb.axis];
+
+	for (pb.touch = 1; pb.touch <= pb.touches; pb.touch++) {
+		_probe_touch_run_move(pb.touch_position - pb.direction * pb.latch_backoff, pb.search_velocity);	// back off
+		if (GET_SWITCH(pb.probe_switch)->state == SW_CLOSED) {
+			CO_EXIT(pb.co, _probe_touch_exit(STAT_PROBING_CYCLE_FAILED, "probe still closed after backoff"));
+		}
+		st_clear_latch(ST_LATCH_PROBE);
+		_probe_touch_run_move(pb.touch_position + pb.direction * pb.latch_backoff, pb.latch_velocity);
+		if (st_get_latched_position(ST_LATCH_PROBE, position) == false) {
+			CO_EXIT(pb.co, _probe_touch_exit(STAT_PROBING_CYCLE_FAILED, "no contact within backoff"));
+		}
+		pb.touch_position = position[pb.axis];
+		_probe_touch_record(pb.touch_position);
+	}
+	_probe_touch_run_move(pb.touch_position - pb.direction * pb.latch_backoff, pb.search_velocity);	// leave the probe open
+	_probe_touch_exit(STAT_OK, NULL);
+	CO_END(pb.co);
+}
+
+/*
+ * _probe_touch_move() - move the probing axis to a machine position
+ */
+
+static void _probe_touch_move(float position, float velocity)
+{
+	float target[] = {0,0,0};
+	for (uint8_t axis=AXIS_X; axis<=AXIS_Z; axis++) {
+		target[axis] = mp_get_runtime_absolute_position(axis);
+	}
+	target[pb.axis] = position;
+	_probe_grid_move(target[AXIS_X], target[AXIS_Y], target[AXIS_Z], velocity);
+}
+
+/*
+ * _probe_touch_record() - add a slow touch to the result (Welford's running variance)
+ */
+
+static void _probe_touch_record(float position)
+{
+	if (pb.touch == 1) {
+		pb.touch_mean = position;
+		pb.touch_m2 = 0;
+		pb.touch_min = position;
+		pb.touch_max = position;
+		return;
+	}
+	float delta = position - pb.touch_mean;
+	pb.touch_mean += delta / pb.touch;
+	pb.touch_m2 += delta * (position - pb.touch_mean);
+	pb.touch_min = min(pb.touch_min, position);
+	pb.touch_max = max(pb.touch_max, position);
+}
+
+/*
+ * _probe_touch_exit() - report the result or the error and end the cycle
+ */
+
+static stat_t _probe_touch_exit(stat_t status, const char *message)
+{
+	if (status == STAT_OK) {
+		float units = (pb.saved_units_mode == INCHES) ? MM_PER_INCH : 1;
+		printf_P(PSTR("{\"prb\":{\"axis\":\"%c\",\"n\":%d,\"mean\":%0.4f,\"min\":%0.4f,\"max\":%0.4f,\"rng\":%0.4f,\"sd\":%0.4f}}\n"),
+			tolower(cm_get_axis_char(pb.axis)), pb.touches, pb.touch_mean / units, pb.touch_min / units, pb.touch_max / units,
+			(pb.touch_max - pb.touch_min) / units, sqrt(pb.touch_m2 / pb.touches) / units);
+	} else {
+		cmd_reset_list();
+		char buffer[CMD_MESSAGE_LEN];
+		sprintf_P(buffer, PSTR("*** WARNING *** Probing error: %s on touch %d"), message, pb.touch);
+		cmd_add_conditional_message((char_t *)buffer);
+		cmd_print_list(status, TEXT_INLINE_VALUES, JSON_RESPONSE_FORMAT);
+	}
+	return (_probe_cycle_end(status));
+}
+
+/*
+ * _probe_cycle_end() - restore the Gcode model and end a grid or touch cycle
+ */
+
+static stat_t _probe_cycle_end(stat_t status)
+{
+	switch_reset_callbacks();
+	mp_flush_planner(); 						// should be stopped, but in case of switch closure
+	for (uint8_t axis=0; axis<AXES; axis++) {	// the planner continues from where the probe stopped
+		cm_set_axis_origin(axis, mp_get_runtime_absolute_position(axis));
+	}
+	cm_set_coord_system(pb.saved_coord_system);	// restore to work coordinate system
+	cm_set_units_mode(pb.saved_units_mode);
+	cm_set_distance_mode(pb.saved_distance_mode);
+	cm_set_feed_rate(pb.saved_feed_rate);
+	cm_set_motion_mode(MODEL, MOTION_MODE_CANCEL_MOTION_MODE);
+	cm.cycle_state = CYCLE_OFF;
+	cm_cycle_end();
+	return (status);
+}
+
 /* _run_homing_dual_axis() - kernal routine for running homing on a dual axis */
 //static stat_t _run_homing_dual_axis(int8_t axis) { return (STAT_OK);}
 
@@ -407,23 +815,31 @@ int8_t _get_next_axis(int8_t axis)
 		if (fp_TRUE(gf.target[AXIS_Z])) return (AXIS_Z);
 		if (fp_TRUE(gf.target[AXIS_X])) return (AXIS_X);
 		if (fp_TRUE(gf.target[AXIS_Y])) return (AXIS_Y);
+#if (AXES > AXIS_A)
 		if (fp_TRUE(gf.target[AXIS_A])) return (AXIS_A);
+#endif
 //		if (fp_TRUE(gf.target[AXIS_B])) return (AXIS_B);
 //		if (fp_TRUE(gf.target[AXIS_C])) return (AXIS_C);
 		return (-2);	// error
 	} else if (axis == AXIS_Z) {
 		if (fp_TRUE(gf.target[AXIS_X])) return (AXIS_X);
 		if (fp_TRUE(gf.target[AXIS_Y])) return (AXIS_Y);
+#if (AXES > AXIS_A)
 		if (fp_TRUE(gf.target[AXIS_A])) return (AXIS_A);
+#endif
 //		if (fp_TRUE(gf.target[AXIS_B])) return (AXIS_B);
 //		if (fp_TRUE(gf.target[AXIS_C])) return (AXIS_C);
 	} else if (axis == AXIS_X) {
 		if (fp_TRUE(gf.target[AXIS_Y])) return (AXIS_Y);
+#if (AXES > AXIS_A)
 		if (fp_TRUE(gf.target[AXIS_A])) return (AXIS_A);
+#endif
 //		if (fp_TRUE(gf.target[AXIS_B])) return (AXIS_B);
 //		if (fp_TRUE(gf.target[AXIS_C])) return (AXIS_C);
 	} else if (axis == AXIS_Y) {
+#if (AXES > AXIS_A)
 		if (fp_TRUE(gf.target[AXIS_A])) return (AXIS_A);
+#endif
 //		if (fp_TRUE(gf.target[AXIS_B])) return (AXIS_B);
 //		if (fp_TRUE(gf.target[AXIS_C])) return (AXIS_C);
 //	} else if (axis == AXIS_A) {
@@ -0,0 +1,315 @@
+/*
+ * encoder.cpp - quadrature encoder feedback for step loss detection
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	See Encoders in encoder.h
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "encoder.h"
+#include "can.h"
+#include "hardware.h"
+#include "stepper.h"
+#include "text_parser.h"
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+enEncoderSingleton_t en;
+
+#ifdef __ENCODERS
+
+static void _decoder_init(const uint8_t encoder);
+static void _decoder_stop(const uint8_t encoder);
+static int32_t _read_count(const uint8_t encoder, const int64_t substeps);
+static float _following_error(const enEncoder_t *e, const int32_t count, const int64_t substeps);
+
+/*
+ * encoder_init() - start the decoders of the encoders that are on
+ *
+ *	The settings are loaded (and en_set_m() may have run) before this is called.
+ */
+
+void encoder_init()
+{
+	for (uint8_t i=0; i<ENCODERS; i++) {
+		if (en.en[i].motor != 0) { _decoder_init(i);}
+	}
+	en_resync();
+}
+
+/*
+ * en_sample() - record the encoder count and the motor position together (loader ISR)
+ */
+
+void en_sample(const uint8_t encoder, const int64_t substeps)
+{
+	enEncoder_t *e = &en.en[encoder];
+	e->sequence++;									// odd - the callback waits for the next one
+	e->sample_count = _read_count(encoder, substeps);
+	e->sample_substeps = substeps;
+	e->sequence++;
+}
+
+/*
+ * en_resync() - compare the encoders from where they are now
+ */
+
+void en_resync()
+{
+	for (uint8_t i=0; i<ENCODERS; i++) { en.en[i].resync = true;}
+}
+
+/*
+ * en_encoder_callback() - compare the encoders with the motors and alarm on a following error
+ *
+ *	Runs every controller pass, but only does the math when the loader has taken a
+ *	new sample. A sample being written is skipped; the next segment brings another.
+ *	Edges the decoder missed alarm first - the count they leave can't be compared.
+ */
+
+stat_t en_encoder_callback()
+{
+	for (uint8_t i=0; i<ENCODERS; i++) {
+		enEncoder_t *e = &en.en[i];
+		if (e->motor == 0) { continue;}
+
+		uint32_t missed = e->missed_edges;
+		if (missed != e->missed_reported) {
+			e->missed_reported = missed;
+			if ((e->error_limit > 0) && (cm.machine_state != MACHINE_ALARM)) {
+				st_halt();
+				en_resync();
+				return (cm_alarm(STAT_ENCODER_EDGES_MISSED));
+			}
+		}
+		uint32_t sequence = e->sequence;
+		if ((sequence == e->last_sequence) || (sequence & 1)) { continue;}
+		int32_t count = e->sample_count;
+		int64_t substeps = e->sample_substeps;
+		if (sequence != e->sequence) { continue;}	// the loader took another meanwhile
+		e->last_sequence = sequence;
+		e->count = count;
+
+		if ((e->resync == true) || (cm.cycle_state == CYCLE_HOMING)) {
+			e->ref_count = count;					// the axis move engine isn't in the motor position
+			e->ref_substeps = substeps;
+			e->resync = false;
+			e->error = 0;
+			continue;
+		}
+		e->error = _following_error(e, count, substeps);
+		if (fabs(e->error) > e->error_max) { e->error_max = fabs(e->error);}
+
+		if ((e->error_limit > 0) && (fabs(e->error) > e->error_limit) &&
+			(cm.machine_state != MACHINE_ALARM)) {
+			st_halt();								// stop dead - the position is already wrong
+			en_resync();							// start over once the alarm is cleared
+			return (cm_alarm(STAT_ENCODER_FOLLOWING_ERROR));
+		}
+	}
+	return (STAT_OK);
+}
+
+/*
+ * en_read_error()	  - following error now, in steps. For the main loop, with the motor stopped
+ * _following_error() - encoder steps less motor steps, from the reference
+ */
+
+float en_read_error(const uint8_t encoder, const int64_t substeps)
+{
+	enEncoder_t *e = &en.en[encoder];
+	if (e->resync == true) { return (0);}
+	return (_following_error(e, _read_count(encoder, substeps), substeps));
+}
+
+static float _following_error(const enEncoder_t *e, const int32_t count, const int64_t substeps)
+{
+	float motor_steps = (float)(substeps - e->ref_substeps) / DDA_SUBSTEPS;
+	float encoder_steps = (float)(count - e->ref_count) / e->counts_per_step;
+	return (encoder_steps - motor_steps);
+}
+
+/*
+ * _decoder_init()		 - enable change interrupts on the encoder phase pins
+ * _decoder_stop()		 - disable them - the pins may go to CAN0
+ * en_quadrature_edge() - count an edge. Called from the PIO interrupt of the encoder port
+ * _read_count()		 - read the decoder count
+ *
+ *	The phases are decoded from a table indexed by the last and the new pin states
+ *	(A is the high bit). A jump of two states - an edge missed - counts nothing and is
+ *	recorded in missed_edges, for en_encoder_callback() to alarm on.
+ */
+
+#ifndef __SIM
+
+#define _en_a Motate::Pin<encoder_a_pin_num>
+#define _en_b Motate::Pin<encoder_b_pin_num>
+
+static Pio *_en_pio()
+{
+	if (_en_a::portLetter == 'A') { return (PIOA);}
+	if (_en_a::portLetter == 'B') { return (PIOB);}
+	if (_en_a::portLetter == 'C') { return (PIOC);}
+	return (PIOD);
+}
+
+static IRQn_Type _en_irqn()
+{
+	if (_en_a::portLetter == 'A') { return (PIOA_IRQn);}
+	if (_en_a::portLetter == 'B') { return (PIOB_IRQn);}
+	if (_en_a::portLetter == 'C') { return (PIOC_IRQn);}
+	return (PIOD_IRQn);
+}
+
+static void _decoder_init(const uint8_t encoder)
+{
+	Motate::InputPin<encoder_a_pin_num> encoder_a_pin(Motate::kPullUp);
+	Motate::InputPin<encoder_b_pin_num> encoder_b_pin(Motate::kPullUp);
+	Pio *pio = _en_pio();
+
+	__disable_irq();
+	uint32_t pins = pio->PIO_PDSR;
+	en.en[encoder].decoder_state = ((pins & _en_a::mask) ? 2 : 0) | ((pins & _en_b::mask) ? 1 : 0);
+	__enable_irq();
+	pio->PIO_AIMDR = _en_a::mask | _en_b::mask;		// interrupt on both edges
+	pio->PIO_IER = _en_a::mask | _en_b::mask;
+	NVIC_EnableIRQ(_en_irqn());
+}
+
+static void _decoder_stop(const uint8_t encoder)
+{
+	_en_pio()->PIO_IDR = _en_a::mask | _en_b::mask;	// the switches keep the port interrupt
+}
+
+void en_quadrature_edge(const uint32_t pins)
+{
+	static const int8_t quadrature[16] = { 0,1,-1,0, -1,0,0,1, 1,0,0,-1, 0,-1,1,0 };
+	enEncoder_t *e = &en.en[0];
+	uint8_t state = ((pins & _en_a::mask) ? 2 : 0) | ((pins & _en_b::mask) ? 1 : 0);
+	if ((e->decoder_state ^ state) == 3) { e->missed_edges++;}	// both phases changed
+	e->decoder_count += quadrature[(e->decoder_state << 2) | state];
+	e->decoder_state = state;
+}
+
+static int32_t _read_count(const uint8_t encoder, const int64_t substeps)
+{
+	return (en.en[encoder].decoder_count);
+}
+
+#else // __SIM
+
+static void _decoder_init(const uint8_t encoder) {}
+static void _decoder_stop(const uint8_t encoder) {}
+
+static int32_t _read_count(const uint8_t encoder, const int64_t substeps)
+{
+	return ((int32_t)((double)substeps * en.en[encoder].counts_per_step / DDA_SUBSTEPS));	// a perfect encoder
+}
+
+#endif // __SIM
+
+/*
+ * en_enabled() - TRUE if an encoder is on - it has the CAN pins, see encoder.h
+ * en_set_m() - set the motor an encoder is on, and start its decoder. Refused while CAN is on
+ * en_set_r() - set the counts per step, comparing from here
+ * en_get_c() - get the last encoder count (signed)
+ * en_get_k() - get the count of edges the decoder missed
+ */
+
+uint8_t en_enabled()
+{
+	return (en.en[0].motor != 0);
+}
+
+stat_t en_set_m(cmdObj_t *cmd)
+{
+	if ((cmd->value < 0) || (cmd->value > MOTORS)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if ((cmd->value >= 1) && (can.enable == true)) { return (STAT_PIN_IN_USE);}
+	set_ui8(cmd);
+	if (en.en[0].motor != 0) { _decoder_init(0);} else { _decoder_stop(0);}
+	en_resync();
+	return (STAT_OK);
+}
+
+stat_t en_set_r(cmdObj_t *cmd)
+{
+	if (fp_ZERO(cmd->value)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_flt(cmd);
+	en_resync();
+	return (STAT_OK);
+}
+
+#else // __ENCODERS
+
+void encoder_init() {}
+void en_sample(const uint8_t encoder, const int64_t substeps) {}
+void en_resync() {}
+float en_read_error(const uint8_t encoder, const int64_t substeps) { return (0);}
+stat_t en_encoder_callback() { return (STAT_NOOP);}
+uint8_t en_enabled() { return (false);}
+stat_t en_set_m(cmdObj_t *cmd) { return (STAT_OK);}
+stat_t en_set_r(cmdObj_t *cmd) { return (STAT_OK);}
+
+#endif // __ENCODERS
+
+stat_t en_get_c(cmdObj_t *cmd)
+{
+	cmd->value = (float)en.en[0].count;
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t en_get_k(cmdObj_t *cmd)
+{
+	cmd->value = (float)en.en[0].missed_edges;
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_enm[] PROGMEM = "[enm]  encoder motor%21d [0=off,1-6]\n";
+static const char fmt_enr[] PROGMEM = "[enr]  encoder counts per step%11.3f\n";
+static const char fmt_ene[] PROGMEM = "[ene]  following error limit%13.2f steps\n";
+static const char fmt_enc[] PROGMEM = "[enc]  encoder count%22.0f\n";
+static const char fmt_end[] PROGMEM = "[end]  following error%19.2f steps\n";
+static const char fmt_enx[] PROGMEM = "[enx]  following error max%15.2f steps\n";
+static const char fmt_enk[] PROGMEM = "[enk]  encoder edges missed%15.0f\n";
+
+void en_print_m(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_enm);}
+void en_print_r(cmdObj_t *cmd) { text_print_flt(cmd, fmt_enr);}
+void en_print_e(cmdObj_t *cmd) { text_print_flt(cmd, fmt_ene);}
+void en_print_c(cmdObj_t *cmd) { text_print_flt(cmd, fmt_enc);}
+void en_print_d(cmdObj_t *cmd) { text_print_flt(cmd, fmt_end);}
+void en_print_x(cmdObj_t *cmd) { text_print_flt(cmd, fmt_enx);}
+void en_print_k(cmdObj_t *cmd) { text_print_flt(cmd, fmt_enk);}
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
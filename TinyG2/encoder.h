@@ -0,0 +1,140 @@
+/*
+ * encoder.h - quadrature encoder feedback for step loss detection
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Encoders
+ *	An encoder on a motor (or its axis) is decoded from change interrupts on its two
+ *	phase pins, in the PIO handler the switches use (see switch.cpp). Each time _load_move() starts a segment
+ *	the motors have just finished the last one, so the loader samples the encoder
+ *	count next to the motor position the DDA stepped to (see Motor positions in
+ *	stepper.h) - a register read and a copy. The main loop compares the two in
+ *	en_encoder_callback(). If they drift apart by more than $ene steps the motor has
+ *	lost (or gained) steps, and the steppers are halted and the machine put in alarm
+ *	with STAT_ENCODER_FOLLOWING_ERROR, as for a limit switch. An analog motor also
+ *	closes its position loop on the encoder (see servo.h).
+ *
+ *	The encoder and the motor are compared from where they were when the encoder was
+ *	enabled, and again after each homing cycle (the axis move engine is not counted
+ *	in the motor positions) and each alarm. A few steps of following error are
+ *	normal - the encoder is read as the segment ends, and the motor lags the DDA
+ *	under load - so $ene should be a few full steps, not a microstep.
+ *
+ *	  $enm	motor the encoder is on, 1-6 (0 is off)
+ *	  $enr	encoder counts per motor step (microstep) - negative if it counts backwards
+ *	  $ene	following error limit in steps (0 only watches)
+ *	  $enc	last encoder count sampled
+ *	  $end	following error at the last sample, in steps
+ *	  $enx	largest following error seen, in steps - set it to 0 to start over
+ *	  $enk	edges missed by the decoder since reset
+ *
+ *	The SAM3X timer counters have quadrature decoders, but TC1 and TC2 run the
+ *	stepper and axis timers and the TC0 inputs are the motor 1 step and spindle
+ *	direction pins. So the phases are decoded in software, on encoder_a_pin_num and
+ *	encoder_b_pin_num (hardware.h, the CAN pins). An edge costs about as much as a
+ *	switch change, which is good for some tens of thousands of counts per second -
+ *	enough for a motor encoder of a few hundred lines. Past that the interrupt sees
+ *	both phases change between two edges - a jump of two states, with no direction.
+ *	It can't move the count, so it's tallied in $enk, and with $ene set it halts the
+ *	steppers and raises STAT_ENCODER_EDGES_MISSED, as a following error does - the
+ *	count is off and can't be trusted. The simulator has no encoder; it reads back
+ *	the motor position, so it never reports an error.
+ *
+ *	The encoder and the CAN bus (see can.h) share PA0 and PA1, so only one can be on.
+ *	$enm is refused with STAT_PIN_IN_USE while CAN is on, and $canid and $canbr while
+ *	the encoder is. If both were stored, the encoder wins at startup and CAN stays off.
+ */
+
+#ifndef ENCODER_H_ONCE
+#define ENCODER_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define __ENCODERS					// comment out to drop encoder support
+
+#define ENCODERS 1					// encoders with phase pins assigned in hardware.h
+
+typedef struct enEncoder {			// one encoder
+	uint8_t motor;					// motor the encoder is on, 1-6 - 0 is off ($enm)
+	float counts_per_step;			// encoder counts per motor step ($enr)
+	float error_limit;				// following error that raises the alarm, in steps ($ene)
+
+	volatile uint32_t sequence;		// odd while the loader is writing a sample
+	int32_t sample_count;			// encoder count at the end of the last segment...
+	int64_t sample_substeps;		// ...and the motor position the DDA stepped to
+
+	volatile int32_t decoder_count;	// running count kept by the edge interrupt
+	uint8_t decoder_state;			// last phase pin states, A high
+	volatile uint32_t missed_edges;	// two-state jumps seen by the edge interrupt ($enk)
+	uint32_t missed_reported;		// missed edges the callback has already acted on
+
+	uint8_t resync;					// TRUE to take the next sample as the new reference
+	uint32_t last_sequence;			// sample the callback last compared
+	int32_t ref_count;				// reference encoder count...
+	int64_t ref_substeps;			// ...and motor position
+	int32_t count;					// last encoder count compared ($enc)
+	float error;					// following error at the last sample, in steps ($end)
+	float error_max;				// largest following error seen, in steps ($enx)
+} enEncoder_t;
+
+typedef struct enEncoderSingleton {
+	enEncoder_t en[ENCODERS];
+} enEncoderSingleton_t;
+
+extern enEncoderSingleton_t en;
+
+void encoder_init(void);
+uint8_t en_enabled(void);
+void en_sample(const uint8_t encoder, const int64_t substeps) RAMFUNC;
+void en_quadrature_edge(const uint32_t pins);
+void en_resync(void);
+float en_read_error(const uint8_t encoder, const int64_t substeps);
+stat_t en_encoder_callback(void);
+
+stat_t en_set_m(cmdObj_t *cmd);
+stat_t en_set_r(cmdObj_t *cmd);
+stat_t en_get_c(cmdObj_t *cmd);
+stat_t en_get_k(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+
+	void en_print_m(cmdObj_t *cmd);
+	void en_print_r(cmdObj_t *cmd);
+	void en_print_e(cmdObj_t *cmd);
+	void en_print_c(cmdObj_t *cmd);
+	void en_print_d(cmdObj_t *cmd);
+	void en_print_x(cmdObj_t *cmd);
+	void en_print_k(cmdObj_t *cmd);
+
+#else
+
+	#define en_print_m tx_print_stub
+	#define en_print_r tx_print_stub
+	#define en_print_e tx_print_stub
+	#define en_print_c tx_print_stub
+	#define en_print_d tx_print_stub
+	#define en_print_x tx_print_stub
+	#define en_print_k tx_print_stub
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENCODER_H_ONCE
@@ -0,0 +1,176 @@
+/*
+ * event_log.cpp - timestamped event ring for after-the-fact diagnostics
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	See Event log in event_log.h
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "event_log.h"
+#include "hardware.h"
+#include "text_parser.h"
+#include "xio.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#ifdef __EVENT_LOG
+
+evLogSingleton_t evl;
+
+static uint8_t _event_copy(uint32_t n, evLogEntry_t *e);
+static uint32_t _first_event(uint32_t count);
+
+/*
+ * ev_record() - record an event. Any interrupt level
+ */
+
+void ev_record(const uint8_t event, const uint32_t linenum, const uint32_t arg)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	evLogEntry_t *e = &evl.entry[evl.count++ & (EV_LOG_ENTRIES-1)];
+	e->usec = hw_get_usec();
+	e->linenum = linenum;
+	e->arg = arg;
+	e->event = event;
+	__set_PRIMASK(primask);
+}
+
+/*
+ * _event_copy() - copy out event n. Returns false if it has been overwritten
+ * _first_event() - number of the oldest event in the ring when count were recorded
+ */
+
+static uint8_t _event_copy(uint32_t n, evLogEntry_t *e)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint8_t valid = ((evl.count - n) <= EV_LOG_ENTRIES) ? true : false;
+	*e = evl.entry[n & (EV_LOG_ENTRIES-1)];
+	__set_PRIMASK(primask);
+	return (valid);
+}
+
+static uint32_t _first_event(uint32_t count)
+{
+	return ((count > EV_LOG_ENTRIES) ? count - EV_LOG_ENTRIES : 0);
+}
+
+/*
+ * ev_get_evl()  - dump the ring oldest first. JSON mode only - text mode prints it in ev_print_evl()
+ * ev_get_evb()  - dump the ring in binary
+ * ev_set_evlz() - clear the ring
+ *
+ *	The value is the number of events recorded. A dump stops at the events recorded
+ *	when it started - its own tx stalls wait for the next one. Events overwritten
+ *	while it runs are skipped in JSON and text (look for gaps in the numbers) and
+ *	sent as they are in binary, which has promised the count in its header.
+ */
+
+stat_t ev_get_evl(cmdObj_t *cmd)
+{
+	uint32_t count = evl.count;
+	cmd->value = (float)count;
+	cmd->objtype = TYPE_INTEGER;
+	if (cfg.comm_mode != JSON_MODE) { return (STAT_OK);}
+
+	uint32_t first = _first_event(count);
+	evLogEntry_t e;
+	fprintf_P(stderr, PSTR("{\"evl\":["));
+	for (uint32_t n = first; n < count; n++) {
+		if (_event_copy(n, &e) == false) { continue;}
+		fprintf_P(stderr, PSTR("%s[%lu,%lu,%d,%lu,%lu]"), (n == first) ? "" : ",", (unsigned long)n,
+				  (unsigned long)e.usec, e.event, (unsigned long)e.linenum, (unsigned long)e.arg);
+	}
+	fprintf_P(stderr, PSTR("]}\n"));
+	return (STAT_OK);
+}
+
+stat_t ev_get_evb(cmdObj_t *cmd)
+{
+	uint32_t count = evl.count;
+	uint32_t first = _first_event(count);
+	evLogEntry_t e;
+
+	fprintf_P(stderr, PSTR("{\"evb\":{\"n\":%lu,\"sz\":%d,\"seq\":%lu}}\n"),
+			  (unsigned long)(count - first), (int)sizeof(evLogEntry_t), (unsigned long)first);
+	fflush(stderr);								// the header goes ahead of the records
+	for (uint32_t n = first; n < count; n++) {
+		_event_copy(n, &e);
+		xio_write((const uint8_t *)&e, sizeof(e));
+	}
+	cmd->value = (float)count;
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t ev_set_evlz(cmdObj_t *cmd)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	evl.count = 0;
+	__set_PRIMASK(primask);
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_evl[] PROGMEM = "[evl]  event log%19lu events\n";
+static const char fmt_evl_head[] PROGMEM = "     seq       usec event         line        arg\n";
+static const char fmt_evl_event[] PROGMEM = "%8lu %10lu %-10s %8lu %10lu\n";
+
+static const char msg_ev0[] PROGMEM = "-";
+static const char msg_ev1[] PROGMEM = "queued";
+static const char msg_ev2[] PROGMEM = "start";
+static const char msg_ev3[] PROGMEM = "underrun";
+static const char msg_ev4[] PROGMEM = "hold";
+static const char msg_ev5[] PROGMEM = "switch";
+static const char msg_ev6[] PROGMEM = "tx stall";
+static const char msg_ev7[] PROGMEM = "plan pass";
+static const char *const msg_ev[] PROGMEM = { msg_ev0, msg_ev1, msg_ev2, msg_ev3, msg_ev4, msg_ev5, msg_ev6, msg_ev7 };
+
+void ev_print_evl(cmdObj_t *cmd)
+{
+	uint32_t count = evl.count;
+	text_print_int(cmd, fmt_evl);
+
+	uint32_t first = _first_event(count);
+	evLogEntry_t e;
+	fprintf_P(stderr, fmt_evl_head);
+	for (uint32_t n = first; n < count; n++) {
+		if (_event_copy(n, &e) == false) { continue;}
+		fprintf_P(stderr, fmt_evl_event, (unsigned long)n, (unsigned long)e.usec,
+				  (e.event < EV_EVENTS) ? (const char *)GET_TEXT_ITEM(msg_ev, e.event) : "?",
+				  (unsigned long)e.linenum, (unsigned long)e.arg);
+	}
+}
+
+#endif // __TEXT_MODE
+
+#endif // __EVENT_LOG
+
+#ifdef __cplusplus
+}
+#endif
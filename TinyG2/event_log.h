@@ -0,0 +1,109 @@
+/*
+ * event_log.h - timestamped event ring for after-the-fact diagnostics
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Event log
+ *	The last EV_LOG_ENTRIES events are kept in a RAM ring so a job that stuttered can
+ *	be looked at after it ran. Each record has the timebase time (hw_get_usec(), see
+ *	hardware.h), the Gcode line number the event belongs to, the event and an argument:
+ *
+ *	  event			line					arg
+ *	  1 queued		block's line			move type - the planner queued a block
+ *	  2 start		block's line			move type - the exec started running it
+ *	  3 underrun	runtime line			0 - the loader was starved mid-move
+ *	  4 hold		runtime line			0 - a feedhold was requested
+ *	  5 switch		runtime line			switch number * 2 + 1 if closed - a switch changed
+ *	  6 tx stall	runtime line			usec the main loop waited on a full tx ring
+ *	  7 plan pass	block's line			blocks the planner pass recomputed
+ *
+ *	Commands and dwells get the line that queued them. A record is written with
+ *	interrupts masked - a copy of 16 bytes - so any interrupt level may record.
+ *
+ *	  $evl	dump the ring oldest first - {"evl":""} dumps it as
+ *			{"evl":[[seq,usec,event,line,arg],...]} ahead of the response
+ *	  $evb	dump it in binary: a {"evb":{"n":N,"sz":16,"seq":S}} line, then N records
+ *			of sz bytes as in evLogEntry_t (little endian), S being the first's number
+ *	  $evlz	clear it
+ *
+ *	Records are numbered from the last clear. Costs EV_LOG_ENTRIES * 16 bytes of RAM.
+ */
+
+#ifndef EVENT_LOG_H_ONCE
+#define EVENT_LOG_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define __EVENT_LOG					// comment out to drop the event log
+
+#ifndef EV_LOG_ENTRIES
+#define EV_LOG_ENTRIES 128			// events kept - must be a power of 2
+#endif
+
+enum evEvent {						// see Event log, above
+	EV_NONE = 0,
+	EV_BLOCK_QUEUED,
+	EV_BLOCK_START,
+	EV_UNDERRUN,
+	EV_HOLD,
+	EV_SWITCH,
+	EV_TX_STALL,
+	EV_PLAN_PASS,
+	EV_EVENTS
+};
+
+typedef struct evLogEntry {			// one event - 16 bytes
+	uint32_t usec;					// timebase time of the event
+	uint32_t linenum;				// Gcode line it belongs to
+	uint32_t arg;					// event argument - see Event log
+	uint8_t event;					// evEvent
+	uint8_t reserved[3];
+} evLogEntry_t;
+
+typedef struct evLogSingleton {
+	uint32_t count;					// events recorded since the last clear
+	evLogEntry_t entry[EV_LOG_ENTRIES];	// entry[count % EV_LOG_ENTRIES] is written next
+} evLogSingleton_t;
+
+#ifdef __EVENT_LOG
+
+extern evLogSingleton_t evl;
+
+void ev_record(const uint8_t event, const uint32_t linenum, const uint32_t arg);
+
+stat_t ev_get_evl(cmdObj_t *cmd);
+stat_t ev_get_evb(cmdObj_t *cmd);
+stat_t ev_set_evlz(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+	void ev_print_evl(cmdObj_t *cmd);
+#else
+	#define ev_print_evl tx_print_stub
+#endif // __TEXT_MODE
+
+#else
+
+#define ev_record(event, linenum, arg)
+
+#endif // __EVENT_LOG
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_LOG_H_ONCE
@@ -0,0 +1,113 @@
+/*
+ * fastmath.h - inline math kernels for the planner
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef FASTMATH_H_ONCE
+#define FASTMATH_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/* FAST MATH - the SAM3X has no FPU, so every libm sqrt(), cbrt() and pow() is a soft
+ *	float library call, and cbrt() and pow() go through log and exp. These kernels
+ *	use a few soft float multiplies instead. Seeds come from the float's bits, then
+ *	fixed Newton (or Halley) steps, so the cost does not depend on the argument.
+ *
+ *	Worst case relative error for normal floats, measured over 1e-12 to 1e12:
+ *
+ *	  fast_rsqrt()	4.8e-6		2 Newton steps
+ *	  fast_sqrt()	4.8e-6		x * fast_rsqrt(x), exact 0 at 0
+ *	  fast_cbrt()	2.2e-7		2 Halley steps - about float precision
+ *
+ *	A few ppm is invisible in a velocity or a time, so the planner's velocity, jerk
+ *	and junction math use these. Lengths and positions stay on libm - the runtime
+ *	adds them up and steps them out, so they must match the model exactly.
+ *	Arguments to the square roots must be >= 0; they return garbage, not NaN, for
+ *	negatives.
+ */
+
+static inline float fast_rsqrt(const float x)
+{
+	union { float f; uint32_t i;} u = { x };
+	u.i = 0x5f375a86 - (u.i >> 1);				// first guess - within 3.5%
+	float half_x = 0.5 * x;
+	u.f *= (1.5 - half_x * u.f * u.f);			// 1.8e-3
+	u.f *= (1.5 - half_x * u.f * u.f);			// 4.8e-6
+	return (u.f);
+}
+
+static inline float fast_sqrt(const float x) { return (x * fast_rsqrt(x));}
+
+static inline float fast_cbrt(const float x)
+{
+	union { float f; uint32_t i;} u = { fabs(x) };
+	if (u.i == 0) { return (0);}				// +/-0 - tested on the bits, not as a float
+	float a = u.f;
+	u.i = u.i/3 + 0x2a5137a0;					// first guess - within 3.2%
+	for (uint8_t i=0; i<2; i++) {				// Halley - triples the correct digits
+		float y3 = u.f * u.f * u.f;
+		u.f *= (y3 + 2*a) / (2*y3 + a);
+	}
+	return ((x < 0) ? -u.f : u.f);
+}
+
+/* Multi-value min and max - inline so the planner's min4() etc. cost a few compares
+ *
+ * Implementation tip: Order the min and max values from most to least likely in the calling args
+ */
+
+static inline float min3(float x1, float x2, float x3)
+{
+	float min = x1;
+	if (x2 < min) { min = x2;}
+	if (x3 < min) { return (x3);}
+	return (min);
+}
+
+static inline float min4(float x1, float x2, float x3, float x4)
+{
+	float min = x1;
+	if (x2 < min) { min = x2;}
+	if (x3 < min) { min = x3;}
+	if (x4 < min) { return (x4);}
+	return (min);
+}
+
+static inline float max3(float x1, float x2, float x3)
+{
+	float max = x1;
+	if (x2 > max) { max = x2;}
+	if (x3 > max) { return (x3);}
+	return (max);
+}
+
+static inline float max4(float x1, float x2, float x3, float x4)
+{
+	float max = x1;
+	if (x2 > max) { max = x2;}
+	if (x3 > max) { max = x3;}
+	if (x4 > max) { return (x4);}
+	return (max);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // End of include Guard: FASTMATH_H_ONCE
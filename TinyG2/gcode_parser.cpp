@@ -19,11 +19,18 @@
 #include "tinyg2.h"			// #1
 #include "config.h"			// #2
 #include "controller.h"
+#include "json_parser.h"
+#include "hardware.h"
 #include "gcode_parser.h"
 #include "canonical_machine.h"
+#include "planner.h"
+#include "report.h"
 #include "spindle.h"
+#include "text_parser.h"
 #include "util.h"
+#include "benchmark.h"
 #include "xio.h"			// for char definitions
+#include "xio_file.h"
 
 #ifdef __cplusplus
 extern "C"{
@@ -31,65 +38,560 @@ extern "C"{
 
 struct gcodeParserSingleton {	 	  // struct to manage globals
 	uint8_t modals[MODAL_GROUP_COUNT];// collects modal groups in a block
+	uint8_t integer;				  // TRUE if the value of the last word had no fraction
+	uint8_t point;					  // first decimal digit of the last word (e.g. 2 for G38.2)
 }; struct gcodeParserSingleton gp;
 
+typedef struct gcReadAheadBlock {	// a block parsed ahead of running it
+	GCodeInput_t gn;				// parsed values
+	GCodeInput_t gf;				// parsed flags
+	char_t line[SAVED_BUFFER_LEN];	// input line for the response
+	uint8_t acked;					// TRUE if the line was answered when it was read ahead
+} gcReadAheadBlock_t;
+
+struct gcodeReadAhead {				// ring of blocks waiting on the planner
+	uint8_t count;					// blocks in the ring
+	uint8_t rd;						// next block to run
+	uint8_t wr;						// next block to fill
+	gcReadAheadBlock_t block[GCODE_READ_AHEAD_BLOCKS];
+}; struct gcodeReadAhead gq;
+
+struct gcodeBatch {					// lines of a {"gc":[...]} request
+	char_t *next;					// next line to run - the lines are packed in cs.in_buf
+	uint8_t lines;					// lines in the batch, 0 if there is none
+	uint8_t line;					// lines run so far
+	stat_t status;					// status of the first line that failed
+	uint8_t st[GCODE_BATCH_LINES];	// status of each line
+}; struct gcodeBatch gb;
+
+typedef struct gcSubWord {			// a pre-parsed word of a subroutine body
+	char letter;					// word letter, '#' for a parameter setting, or NUL at the end of a block
+	uint8_t integer;				// gp.integer and gp.point for the word
+	uint8_t point;
+	uint8_t compiled;				// TRUE if the value is an expression...
+	union {
+		float value;
+		uint16_t code;				// ...compiled into gs.code from here
+	};
+} gcSubWord_t;
+
+struct gcodeSubroutines {			// O-word subroutines
+	uint8_t count;					// subroutines defined
+	uint8_t defining;				// TRUE while a body is being stored
+	uint8_t running;				// TRUE while a call is being replayed
+	uint16_t define_number;			// O number of the body being stored
+	uint16_t wr;					// next free word in the arena
+	uint16_t rd;					// next word of the call being replayed
+	uint16_t rd_end;				// end of the call being replayed
+	uint16_t number[GCODE_SUBROUTINES];	// O number of each subroutine
+	uint16_t start[GCODE_SUBROUTINES];	// first word of each body
+	uint16_t end[GCODE_SUBROUTINES];	// one past the last word of each body
+	uint16_t code_wr;				// next free byte in the code arena
+	uint16_t code_start[GCODE_SUBROUTINES];	// expression code of each body
+	uint16_t code_end[GCODE_SUBROUTINES];
+	gcSubWord_t word[GCODE_SUBROUTINE_WORDS];
+	uint8_t code[GCODE_SUBROUTINE_CODE];
+}; struct gcodeSubroutines gs;
+
+enum gcOp {							// expression code - see Parameters and expressions
+	GC_OP_END = 0,					// end of the code
+	GC_OP_NUMBER,					// push the float in the next 4 bytes
+	GC_OP_PARAMETER,				// unary - replace the top with the parameter it numbers
+	GC_OP_NEGATE,
+	GC_OP_ABS,
+	GC_OP_ACOS,
+	GC_OP_ASIN,
+	GC_OP_COS,
+	GC_OP_EXP,
+	GC_OP_FIX,
+	GC_OP_FUP,
+	GC_OP_LN,
+	GC_OP_ROUND,
+	GC_OP_SIN,
+	GC_OP_SQRT,
+	GC_OP_TAN,
+	GC_OP_POWER,					// binary - pop the right operand and replace the left
+	GC_OP_MULTIPLY,
+	GC_OP_DIVIDE,
+	GC_OP_MOD,
+	GC_OP_ADD,
+	GC_OP_SUBTRACT,
+	GC_OP_EQ,
+	GC_OP_NE,
+	GC_OP_GT,
+	GC_OP_GE,
+	GC_OP_LT,
+	GC_OP_LE,
+	GC_OP_AND,
+	GC_OP_OR,
+	GC_OP_XOR,
+	GC_OP_ATAN2
+};
+
+struct gcodeParameters {			// numbered parameters and the expression compiler
+	float value[GCODE_PARAMETERS];	// #0 is always 0
+	uint8_t settings;				// settings read in the block - they take effect at its end
+	uint16_t number[GCODE_BLOCK_SETTINGS];
+	float setting[GCODE_BLOCK_SETTINGS];
+	uint8_t len;					// code compiled for the last word - 0 if it was a plain number
+	uint8_t depth;					// stack depth the code reaches
+	uint8_t nesting;				// values being compiled inside each other
+	uint8_t code[GCODE_EXPRESSION_BYTES];
+}; struct gcodeParameters gv;
+
 // local helper functions and macros
-static void _normalize_gcode_block(char_t *cmd, char_t **com, char_t **msg, uint8_t *block_delete_flag);
 static stat_t _get_next_gcode_word(char **pstr, char *letter, float *value);
-static stat_t _point(float value);
+static stat_t _get_gcode_number(char **pstr, float *value);
+static stat_t _get_word_value(char **pstr, const char letter, float *value);
+static stat_t _compile_value(char **pstr);
+static stat_t _compile_operand(char **pstr);
+static stat_t _compile_expression(char **pstr, const uint8_t precedence);
+static stat_t _emit(const uint8_t op);
+static uint8_t _match(const char *rd, const char *name);
+static stat_t _evaluate_word(const uint8_t *code, const char letter, float *value);
+static stat_t _evaluate(const uint8_t *code, float stack[], uint8_t *depth);
+static stat_t _queue_setting(const float number, const float value);
+static void _set_parameters(void);
+static uint8_t _point(void);
 static stat_t _validate_gcode_block(void);
 static stat_t _parse_gcode_block(char_t *line);	// Parse the block into the GN/GF structs
+static stat_t _parse_gcode_frame(char_t *frame);	// Parse a binary frame into the GN/GF structs
+static stat_t _parse_gcode_word(char letter, float value);
+static stat_t _parse_o_word(char_t *block);
+static stat_t _store_subroutine_block(char_t *block);
+static int8_t _get_subroutine(uint16_t number);
+static void _delete_subroutine(int8_t index);
 static stat_t _execute_gcode_block(void);		// Execute the gcode block
+static uint16_t _get_setters(void);
+static void _drop_unchanged_modals(void);
+static uint8_t _get_buffers_needed(const GCodeInput_t *n, const GCodeInput_t *f);
+static stat_t _seek_gcode_block(void);			// Take up a block ahead of a restart line
 
 #define SET_MODAL(m,parm,val) ({gn.parm=val; gf.parm=1; gp.modals[m]+=1; break;})
 #define SET_NON_MODAL(parm,val) ({gn.parm=val; gf.parm=1; break;})
 #define EXEC_FUNC(f,v) if((uint8_t)gf.v != false) { status = f(gn.v);}
+#define DROP_UNCHANGED(bit,v,unchanged) if (((gn.setters & bit) != 0) && (unchanged)) { gf.v = false; gn.setters &= ~bit;}
+
+// setter words in a block (gn.setters) - see _drop_unchanged_modals()
+#define GC_SET_FEED_MODE		0x0001		// G93, G94
+#define GC_SET_FEED_RATE		0x0002		// F
+#define GC_SET_SPINDLE_SPEED	0x0004		// S
+#define GC_SET_OTHER_M			0x0008		// T, M3-M9, M48-M51, M62, M63, M150
+#define GC_SET_PLANE			0x0010		// G17, G18, G19
+#define GC_SET_UNITS			0x0020		// G20, G21
+#define GC_SET_PATH				0x0040		// G61, G61.1, G64
+#define GC_SET_DISTANCE			0x0080		// G90, G91
+#define GC_SET_RETRACT			0x0100		// G98, G99
+#define GC_SET_OTHER_G			0x0200		// G54-G59
+#define GC_SET_AHEAD_OF_DWELL	(GC_SET_FEED_MODE | GC_SET_FEED_RATE | GC_SET_SPINDLE_SPEED | GC_SET_OTHER_M)
+#define GC_SET_MODAL			(0x03FF & ~(GC_SET_OTHER_M | GC_SET_OTHER_G))
 
 /*
  * gc_gcode_parser() - parse a block (line) of gcode
  *
- *	Top level of gcode parser. Normalizes block and looks for special cases
+ *	Top level of gcode parser. The block is parsed in a single pass straight from the 
+ *	input line, which is not modified (see _get_next_gcode_word()).
+ *
+ *	Block delete omits the line if a / char is present in the first space
+ *	For now this is unconditional and will always delete
  */
 
 stat_t gc_gcode_parser(char_t *block)
 {
-	char_t *cmd = block;					// gcode command or NUL string
-	char_t none = NUL;
-	char_t *com = &none;					// gcode comment or NUL string
-	char_t *msg = &none;					// gcode message or NUL string
-	uint8_t block_delete_flag;
-
-	_normalize_gcode_block(cmd, &com, &msg, &block_delete_flag);
-	
-	// Block delete omits the line if a / char is present in the first space
-	// For now this is unconditional and will always delete
-//	if ((block_delete_flag == true) && (cm_get_block_delete_switch() == true)) {
-	if (block_delete_flag == true) {
+//	if ((*block == '/') && (cm_get_block_delete_switch() == true)) {
+	if (*block == '/') {
 		return (STAT_NOOP);
 	}
-//	if (*msg != NUL) { // +++++ THIS HAS A SERIOUS BUG IN IT SO FOR NOW IT'S DISABLED
-//		(void)cm_message(msg);				// queue the message
-//	}
-	return(_parse_gcode_block(block));
+	char *rd = (char *)block;
+	for (; (*rd == ' ') || (*rd == TAB); rd++);
+	if (toupper(*rd) == 'O') {
+		return (_parse_o_word((char_t *)rd));
+	}
+	if (gs.defining == true) {
+		return (_store_subroutine_block(block));
+	}
+	ritorno(_parse_gcode_block(block));
+	return (_execute_gcode_block());		// if successful execute the block
+}
+
+/*
+ * gc_binary_parser() - parse and run a pre-tokenized Gcode frame
+ *
+ *	The host does the tokenizing and number conversion. The words are loaded into
+ *	gn and gf by the same code as text blocks, so a frame behaves exactly like the 
+ *	line it was made from. Frames are answered like text mode Gcode lines.
+ */
+
+stat_t gc_binary_parser(char_t *frame)
+{
+	if (gs.defining == true) { return (STAT_COMMAND_NOT_ACCEPTED);}	// bodies are text only
+	ritorno(_parse_gcode_frame(frame));
+	return (_execute_gcode_block());
+}
+
+/*
+ * gc_is_frame() - TRUE if a line is a Gcode frame, not a block that starts with a 
+ *				   parameter setting: '#', base64 text, '*' and digits only
+ */
+uint8_t gc_is_frame(const char_t *line)
+{
+	if (*line != GCODE_FRAME_CHAR) { return (false);}
+	const char *rd = (const char *)line + 1;
+	for (; (base64_value(*rd) >= 0) || (*rd == '='); rd++);
+	if (*rd++ != '*') { return (false);}
+	for (; isdigit(*rd); rd++);
+	return (*rd == NUL);
 }
 
 /*
- * _normalize_gcode_block() - normalize a block (line) of gcode in place
+ * gc_read_ahead() 			- parse a block now and queue it to run when the planner has room
+ * gc_read_ahead_callback() - run the oldest queued block once the planner has the room it needs
+ * gc_read_ahead_full()		- TRUE if no more blocks can be parsed ahead
+ * gc_read_ahead_empty()	- TRUE if no blocks are waiting
+ * gc_flush_read_ahead()	- drop all waiting blocks, a subroutine call and a partial body (queue flush)
+ *
+ *	Parsing doesn't depend on the model state (the modal motion mode is resolved when
+ *	the block runs) so lines can be parsed while the planner is full. Parse errors are 
+ *	reported right away. Queued blocks respond when they run, in order, so a host 
+ *	still gets one response per line. Only text mode Gcode and binary frames are read
+ *	ahead - the controller holds any other line until the queue is empty (see _command_dispatch())
+ *
+ *	A queued block runs as soon as the planner has the buffers that block takes (see
+ *	_get_buffers_needed()), rather than a fixed headroom - a G1 waits for one free buffer.
+ *
+ *	With early acknowledge ($ea=1) a line is answered as soon as it has been parsed
+ *	into the queue, so a host counting characters keeps the link full while the 
+ *	planner catches up. JSON mode Gcode is read ahead too. A queued block that fails
+ *	when it runs is reported as an exception with the line number of its N word:
  *
- *	Normalization functions:
- *   - convert all letters to upper case
- *	 - remove white space, control and other invalid characters 
- *	 - remove (erroneous) leading zeros that might be taken to mean Octal
- *	 - identify and return start of comments and messages
- *	 - signal if a block-delete character (/) was encountered in the first space
+ *	  {"er":{"fb":100.00,"st":44,"msg":"...","line":1230}}
+ */
+stat_t gc_read_ahead(char_t *block)
+{
+	if (gq.count >= GCODE_READ_AHEAD_BLOCKS) { return (STAT_EAGAIN);}	// not supposed to happen
+	if (gc_is_frame(block) == true) {
+		ritorno(_parse_gcode_frame(block));
+	} else {
+		if (*block == '/') { return (STAT_NOOP);}	// block delete
+		ritorno(_parse_gcode_block(block));
+	}
+
+	gcReadAheadBlock_t *b = &gq.block[gq.wr];
+	memcpy(&b->gn, &gn, sizeof(GCodeInput_t));
+	memcpy(&b->gf, &gf, sizeof(GCodeInput_t));
+	strncpy(b->line, block, SAVED_BUFFER_LEN-1);
+	b->line[SAVED_BUFFER_LEN-1] = NUL;
+	b->acked = cs.early_ack;				// the controller answers it now
+	if (++gq.wr >= GCODE_READ_AHEAD_BLOCKS) { gq.wr = 0;}
+	gq.count++;
+	return (STAT_OK);
+}
+
+stat_t gc_read_ahead_callback()
+{
+	if (gq.count == 0) { return (STAT_NOOP);}
+	gcReadAheadBlock_t *b = &gq.block[gq.rd];
+	if (mp_get_planner_buffers_available() < _get_buffers_needed(&b->gn, &b->gf)) { return (STAT_NOOP);}	// keep reading ahead
+
+	memcpy(&gn, &b->gn, sizeof(GCodeInput_t));
+	memcpy(&gf, &b->gf, sizeof(GCodeInput_t));
+	stat_t status = _execute_gcode_block();
+	if (b->acked == false) {
+		text_response(status, b->line);
+	} else if ((status != STAT_OK) && (status != STAT_NOOP) && (status != STAT_EAGAIN)) {
+		rpt_line_exception(status, b->gn.linenum);
+	}
+	if (++gq.rd >= GCODE_READ_AHEAD_BLOCKS) { gq.rd = 0;}
+	gq.count--;
+	return (STAT_OK);
+}
+
+uint8_t gc_read_ahead_full() { return (gq.count >= GCODE_READ_AHEAD_BLOCKS);}
+uint8_t gc_read_ahead_empty() { return (gq.count == 0);}
+void gc_flush_read_ahead() 
+{
+	memset(&gq, 0, sizeof(gq));
+	gs.running = false;
+	if (gs.defining == true) {
+		gs.wr = gs.start[gs.count];
+		gs.code_wr = gs.code_start[gs.count];
+		gs.defining = false;
+	}
+}
+
+/*
+ * gc_batch_start()	   - take the lines of a {"gc":[...]} request to run one after another
+ * gc_batch_callback() - run the next lines of the batch while the planner has room
+ * gc_batch_running()  - TRUE until the batch has been run and answered
+ * gc_batch_cancel()   - drop a batch that was started (the request is answered with an error)
+ *
+ *	In JSON mode one request can carry several Gcode lines, so the JSON wrapping, 
+ *	the response and the USB round trip are paid once for all of them:
+ *
+ *	  {"gc":["n10g1x10f600","n11g1y10","n12g1x0"]}
+ *
+ *	The lines run in order, each when the planner has room as it would on its own,
+ *	and the request gets one response with the status of each line and the last line
+ *	number:
+ *
+ *	  {"r":{"gcs":[0,0,0],"n":12},"f":[1,0,0,4521]}
+ *
+ *	A line that fails doesn't stop the rest. The footer has the status of the first 
+ *	one that did. The lines are packed in place in the input buffer (see _get_nv_pair()),
+ *	so the controller reads nothing more until the batch has been answered. Like lines
+ *	still in the receive buffer, lines not yet run are kept by a queue flush.
+ *	The array must be the only item in its request and hold up to GCODE_BATCH_LINES.
+ *	Messages from the lines aren't in the response.
+ */
+stat_t gc_batch_start(char_t *lines, uint8_t count)
+{
+	if (count == 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if (count > GCODE_BATCH_LINES) { return (STAT_JSON_TOO_MANY_PAIRS);}
+	gb.next = lines;
+	gb.lines = count;
+	gb.line = 0;
+	gb.status = STAT_OK;
+	return (STAT_OK);
+}
+
+stat_t gc_batch_callback()
+{
+	if (gb.lines == 0) { return (STAT_NOOP);}
+
+	for (uint8_t lines=0; (lines < CONTROLLER_LINES_PER_PASS) && (gb.line < gb.lines); lines++) {
+		if (controller_planner_ready() == false) { return (STAT_EAGAIN);}
+		char_t *line = gb.next;
+		gb.next += strlen((char *)line) + 1;	// before the parser normalizes the line in place
+		cmd_reset_list();						// the response is made when the batch is done
+		stat_t status = gc_gcode_parser(line);
+		if ((gb.status == STAT_OK) && (status != STAT_OK) && (status != STAT_NOOP)) { gb.status = status;}
+		gb.st[gb.line++] = status;
+	}
+	if (gb.line < gb.lines) { return (STAT_EAGAIN);}
+
+	char_t st[GCODE_BATCH_LINES * 4];		// up to 3 digits and a comma per line
+	char_t *wr = st;
+	for (uint8_t i=0; i<gb.lines; i++) {
+		wr += sprintf((char *)wr, (i == 0) ? "%d" : ",%d", gb.st[i]);
+	}
+	gb.lines = 0;
+	cmd_reset_list();
+	cmdObj_t *cmd = cmd_add_string((const char_t *)"gcs", st);
+	if (cmd != NULL) { cmd->objtype = TYPE_ARRAY;}
+	cmd_add_object((const char_t *)"n");		// the last line number
+	json_print_response(gb.status);
+	sr_request_status_report(SR_IMMEDIATE_REQUEST);
+	return (STAT_OK);
+}
+
+uint8_t gc_batch_running() { return (gb.lines != 0);}
+void gc_batch_cancel() { gb.lines = 0;}
+
+/*
+ * Subroutines 
+ *
+ * gc_subroutine_callback() - replay the next block of a call if the planner has room
+ * gc_subroutine_defining() - TRUE while lines are being stored into a body
+ * _parse_o_word()			- O<n> sub, O<n> endsub, O<n> call
+ * _store_subroutine_block() - parse a body line and store its words
+ *
+ *	The lines between O<n> sub and O<n> endsub are parsed and checked as they arrive,
+ *	answered, and stored as words instead of run. O<n> call replays the body one block
+ *	per pass of the controller as the planner makes room, the way arcs are run. The 
+ *	replay skips the text and number parsing and goes straight to the gn/gf loading 
+ *	(_parse_gcode_word()). Blocks run against the model as it is when they run, so the 
+ *	caller sets the work offsets (G54-G59, G92) for each call.
+ *
+ *	The call line is answered when the call starts. An error in the body stops the call
+ *	and is reported as an exception. Redefining a subroutine replaces it. Calls and 
+ *	definitions can't be nested, and binary frames can't be stored.
+ *
+ *	Words with expressions are stored compiled and evaluated each time they are 
+ *	replayed, so a body runs with the parameters as they are when it runs. Bracketed
+ *	values after O<n> call are set into #1, #2... as the call starts:
+ *
+ *	  O100 call [25] [#7 * 2]
+ */
+stat_t gc_subroutine_callback()
+{
+	if (gs.running == false) { return (STAT_NOOP);}
+	if (!controller_wait_until(CTL_TASK_SUBROUTINE, CTL_EVENT_BUFFER, 
+			mp_get_planner_buffers_available() >= PLANNER_BUFFER_HEADROOM)) { return (STAT_EAGAIN);}
+
+	memset(&gp, 0, sizeof(gp));
+	memset(&gf, 0, sizeof(gf));
+	memset(&gn, 0, sizeof(gn));
+	gv.settings = 0;
+
+	stat_t status = STAT_OK;
+	for (gcSubWord_t *w = &gs.word[gs.rd]; w->letter != NUL; w = &gs.word[++gs.rd]) {
+		if (status != STAT_OK) { continue;}
+		float value = w->value;
+		gp.integer = w->integer;
+		gp.point = w->point;
+		if (w->compiled == true) { status = _evaluate_word(&gs.code[w->code], w->letter, &value);}
+		if ((status == STAT_OK) && (w->letter != '#')) { status = _parse_gcode_word(w->letter, value);}
+	}
+	if (status == STAT_OK) { _set_parameters();}
+	if (status == STAT_OK) { status = _validate_gcode_block();}
+	if (status == STAT_OK) { status = _execute_gcode_block();}
+	if ((status != STAT_OK) && (status != STAT_NOOP) && (status != STAT_EAGAIN)) {
+		rpt_exception(status);
+		gs.running = false;
+		return (STAT_OK);
+	}
+	if (++gs.rd >= gs.rd_end) {				// step over the end of block
+		gs.running = false;
+		return (STAT_OK);
+	}
+	return (STAT_EAGAIN);
+}
+
+uint8_t gc_subroutine_defining() { return (gs.defining);}
+
+static stat_t _parse_o_word(char_t *block)
+{
+	char *rd = (char *)block + 1;
+	float value;
+
+	for (; (*rd == ' ') || (*rd == TAB); rd++);
+	ritorno(_get_gcode_number(&rd, &value));
+	if ((gp.integer == false) || (value < 0) || (value > 65535)) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+	uint16_t number = (uint16_t)value;
+
+	for (; (*rd == ' ') || (*rd == TAB); rd++);
+	char keyword[8];
+	uint8_t i = 0;
+	for (; (isalpha(*rd)) && (i < sizeof(keyword)-1); rd++) { keyword[i++] = toupper(*rd);}
+	keyword[i] = NUL;
+
+	if (strcmp(keyword, "ENDSUB") == 0) {
+		if ((gs.defining == false) || (number != gs.define_number)) { return (STAT_COMMAND_NOT_ACCEPTED);}
+		gs.number[gs.count] = number;
+		gs.code_end[gs.count] = gs.code_wr;
+		gs.end[gs.count++] = gs.wr;			// start was set by O<n> sub
+		gs.defining = false;
+		return (STAT_OK);
+	}
+	if (gs.defining == true) { return (STAT_COMMAND_NOT_ACCEPTED);}	// no nesting
+
+	if (strcmp(keyword, "SUB") == 0) {
+		_delete_subroutine(_get_subroutine(number));
+		if (gs.count >= GCODE_SUBROUTINES) { return (STAT_NO_BUFFER_SPACE);}
+		gs.start[gs.count] = gs.wr;
+		gs.code_start[gs.count] = gs.code_wr;
+		gs.define_number = number;
+		gs.defining = true;
+		return (STAT_OK);
+	}
+	if (strcmp(keyword, "CALL") == 0) {
+		int8_t index = _get_subroutine(number);
+		if (index < 0) { return (STAT_SUBROUTINE_UNDEFINED);}
+		gv.settings = 0;
+		for (uint8_t n=1; ; n++) {				// arguments go to #1, #2...
+			for (; (*rd == ' ') || (*rd == TAB); rd++);
+			if (*rd != '[') { break;}
+			ritorno(_get_word_value(&rd, 'O', &value));
+			ritorno(_queue_setting(n, value));
+		}
+		_set_parameters();
+		if (gs.start[index] == gs.end[index]) { return (STAT_NOOP);}	// empty body
+		gs.rd = gs.start[index];
+		gs.rd_end = gs.end[index];
+		gs.running = true;
+		controller_set_ready(CTL_TASK_SUBROUTINE);
+		return (STAT_OK);
+	}
+	return (STAT_UNRECOGNIZED_COMMAND);
+}
+
+static stat_t _store_subroutine_block(char_t *block)
+{
+	char *pstr = (char *)block;
+	char letter;
+	float value = 0;
+	uint16_t wr = gs.wr;					// the block is only kept if all of it is good
+	uint16_t code_wr = gs.code_wr;
+	stat_t status;
+
+	memset(&gp, 0, sizeof(gp));
+	memset(&gf, 0, sizeof(gf));
+	memset(&gn, 0, sizeof(gn));
+
+	while((status = _get_next_gcode_word(&pstr, &letter, &value)) == STAT_OK) {
+		if (gv.len == 0) { ritorno(_parse_gcode_word(letter, value));}	// expressions are checked when they run
+		if (wr >= GCODE_SUBROUTINE_WORDS-1) { return (STAT_NO_BUFFER_SPACE);}	// leave room for the end
+		gs.word[wr].letter = letter;
+		gs.word[wr].integer = gp.integer;
+		gs.word[wr].point = gp.point;
+		gs.word[wr].compiled = (gv.len > 0);
+		if (gv.len > 0) {
+			if (code_wr + gv.len > GCODE_SUBROUTINE_CODE) { return (STAT_NO_BUFFER_SPACE);}
+			memcpy(&gs.code[code_wr], gv.code, gv.len);
+			gs.word[wr++].code = code_wr;
+			code_wr += gv.len;
+		} else {
+			gs.word[wr++].value = value;
+		}
+	}
+	if ((status != STAT_OK) && (status != STAT_COMPLETE)) return (status);
+	ritorno(_validate_gcode_block());
+	if (wr == gs.wr) { return (STAT_OK);}	// blank or comment line
+	gs.word[wr++].letter = NUL;
+	gs.wr = wr;
+	gs.code_wr = code_wr;
+	return (STAT_OK);
+}
+
+/*
+ * _get_subroutine() 	- index of a subroutine or -1 if it's not defined
+ * _delete_subroutine() - remove a subroutine and close up its words (OK to call with -1)
+ */
+static int8_t _get_subroutine(uint16_t number)
+{
+	for (uint8_t i=0; i<gs.count; i++) {
+		if (gs.number[i] == number) { return (i);}
+	}
+	return (-1);
+}
+
+static void _delete_subroutine(int8_t index)
+{
+	if (index < 0) { return;}
+	uint16_t start = gs.start[index];
+	uint16_t length = gs.end[index] - start;
+	memmove(&gs.word[start], &gs.word[start + length], (gs.wr - start - length) * sizeof(gcSubWord_t));
+	gs.wr -= length;
+	uint16_t code_start = gs.code_start[index];
+	uint16_t code_length = gs.code_end[index] - code_start;
+	memmove(&gs.code[code_start], &gs.code[code_start + code_length], gs.code_wr - code_start - code_length);
+	gs.code_wr -= code_length;
+	for (uint16_t i=start; i<gs.wr; i++) {		// the words moved down point at code that did too
+		if (gs.word[i].compiled == true) { gs.word[i].code -= code_length;}
+	}
+	for (uint8_t i=index; i<gs.count-1; i++) {
+		gs.number[i] = gs.number[i+1];
+		gs.start[i] = gs.start[i+1] - length;	// bodies are stored in order of definition
+		gs.end[i] = gs.end[i+1] - length;
+		gs.code_start[i] = gs.code_start[i+1] - code_length;
+		gs.code_end[i] = gs.code_end[i+1] - code_length;
+	}
+	gs.count--;
+}
+
+/*
+ * _get_next_gcode_word() - get gcode word consisting of a letter and a value
  *
- *	So this: "  g1 x100 Y100 f400" becomes this: "G1X100Y100F400"
+ *	Reads the raw block in place. This does what a separate normalization pass used to:
+ *	 - letters are converted to upper case
+ *	 - white space, control and other invalid characters between words are skipped,
+ *	   as is white space between a letter and its value
+ *	 - leading zeros are just digits (see _get_gcode_number()), so there is no Octal 
+ *	   or hexadecimal case to trap
+ *	 - a comment ends the block
  *
- *	Comment and message handling:
+ *	Comment handling:
  *	 - Comments field start with a '(' char or alternately a semicolon ';' 
- *	 - Comments and messages are not normalized - they are left alone
- *	 - The 'MSG' specifier in comment can have mixed case but cannot cannot have embedded white spaces
- *	 - Normalization returns true if there was a message to display, false otherwise
  *	 - Comments always terminate the block - i.e. leading or embedded comments are not supported
  *	 	- Valid cases (examples)			Notes:
  *		    G0X10							 - command only - no comment
@@ -102,97 +604,405 @@ stat_t gc_gcode_parser(char_t *block)
  *		    G0X10 comment text				 - Comment with no separator
  *		    N10 (comment) G0X10 			 - embedded comment. G0X10 will be ignored
  *		    (comment) G0X10 				 - leading comment. G0X10 will be ignored
- * 			G0X10 # comment					 - invalid separator
+ * 			G0X10 # comment					 - invalid separator (# starts a parameter setting)
  *
- *	Returns:
- *	 - com points to comment string or to NUL if no comment
- *	 - msg points to message string or to NUL if no comment
- *	 - block_delete_flag is set true if block delete encountered, false otherwise
+ *	Messages in comments (MSG) are not supported yet.
  */
-static void _normalize_gcode_block(char_t *cmd, char_t **com, char_t **msg, uint8_t *block_delete_flag)
-{
-	char_t *rd = cmd;				// read pointer
-	char_t *wr = cmd;				// write pointer
-
-	// Preset comments and messages to NUL string
-	// Not required if com and msg already point to NUL on entry
-//	for (rd = cmd; *rd != NUL; rd++) { if (*rd == NUL) { *com = rd; *msg = rd; rd = cmd;} }
-
-	// mark block deletes
-	if (*rd == '/') { *block_delete_flag = true; } 
-	else { *block_delete_flag = false; }
-	
-	// normalize the command block & find the comment (if any)
-	for (; *wr != NUL; rd++) {
-		if (*rd == NUL) { *wr = NUL; }
-		else if ((*rd == '(') || (*rd == ';')) { *wr = NUL; *com = rd+1; }
-		else if ((isalnum((char)*rd)) || (strchr("-.", *rd))) { // all valid characters
-			*(wr++) = (char_t)toupper((char)*(rd));
-		}
-	}
-	
-	// Perform Octal stripping - remove invalid leading zeros in number strings
-	rd = cmd;
-	while (*rd != NUL) {
-		if (*rd == '.') break;							// don't strip past a decimal point
-		if ((!isdigit(*rd)) && (*(rd+1) == '0') && (isdigit(*(rd+2)))) {
-			wr = rd+1;
-			while (*wr != NUL) { *wr = *(wr+1); wr++;}	// copy forward w/overwrite
-			continue;
-		}
+static stat_t _get_next_gcode_word(char **pstr, char *letter, float *value) 
+{
+	char *rd = *pstr;
+	for (; (*rd != NUL) && (isalnum(*rd) == false) && (strchr("-.(;#", *rd) == NULL); rd++);	// skip to the word
+	if ((*rd == NUL) || (*rd == '(') || (*rd == ';')) { return (STAT_COMPLETE); }	// no more words
+	gv.len = 0;
+
+	if (*rd == '#') {							// parameter setting: #<number> = <value>
+		*letter = '#';
+		gv.depth = 0;
+		gv.nesting = 0;
 		rd++;
+		ritorno(_compile_value(&rd));			// the number...
+		for (; (*rd == ' ') || (*rd == TAB); rd++);
+		if (*rd++ != '=') { return (STAT_EXPRESSION_ERROR);}
+		ritorno(_compile_value(&rd));			// ...and the value
+		ritorno(_emit(GC_OP_END));
+		*pstr = rd;
+		if (gs.defining == true) { return (STAT_OK);}	// stored to run later
+		return (_evaluate_word(gv.code, '#', value));
 	}
-	
-	// process comments and messages
-	if (**com != NUL) {
-		rd = *com;
-		while (isspace(*rd)) { rd++; }		// skip any leading spaces before "msg"
-		if ((tolower(*rd) == 'm') && (tolower(*(rd+1)) == 's') && (tolower(*(rd+2)) == 'g')) {
-			*msg = rd+3;
+
+	// get letter part
+	if(isalpha(*rd) == false) { return (STAT_EXPECTED_COMMAND_LETTER); }
+	*letter = toupper(*rd);
+	for (rd++; (*rd == ' ') || (*rd == TAB); rd++);	// allow space between letter and value
+	*pstr = rd;
+	return (_get_word_value(pstr, *letter, value));	// pointer points to next character after the word
+}
+
+/*
+ * _get_gcode_number() - read a Gcode number: [+|-]digits[.digits] or [+|-].digits
+ *
+ *	Used instead of strtof(), which is slow in soft float and reads exponents, hex, 
+ *	infinities and other forms Gcode doesn't have. The digits are collected into an 
+ *	integer mantissa (the first 9 significant digits) and scaled by a power of ten 
+ *	in one step. The result is within an ULP or so of strtof().
+ *
+ *	Also sets gp.integer and gp.point for the sub-code of G words (see _point()).
+ */
+#define GCODE_MANTISSA_LIMIT 100000000	// collect digits while the mantissa is below this
+
+static const float _pow10[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 
+								1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19 };
+#define GCODE_POW10_MAX ((int8_t)(sizeof(_pow10)/sizeof(float)) - 1)
+
+static stat_t _get_gcode_number(char **pstr, float *value)
+{
+	char *rd = *pstr;
+	uint8_t negative = false;
+	if (*rd == '-') { negative = true; rd++;} 
+	else if (*rd == '+') { rd++;}
+
+	uint32_t mantissa = 0;
+	int8_t exponent = 0;			// power of ten to apply to the mantissa
+	uint8_t digits = 0;				// count of all digits read
+	gp.integer = true;
+	gp.point = 0;
+
+	for (; isdigit(*rd); rd++, digits++) {
+		if (mantissa < GCODE_MANTISSA_LIMIT) {
+			mantissa = mantissa*10 + (*rd - '0');
+		} else if (exponent < GCODE_POW10_MAX) {
+			exponent++;				// drop integer digits past the float's precision
 		}
-		for (; *rd != NUL; rd++) {	
-			if (*rd == ')') *rd = NUL;		// NUL terminate on trailing parenthesis, if any
+	}
+	if (*rd == '.') {
+		rd++;
+		if (isdigit(*rd)) { gp.point = *rd - '0';}
+		for (; isdigit(*rd); rd++, digits++) {
+			if (*rd != '0') { gp.integer = false;}
+			if ((mantissa < GCODE_MANTISSA_LIMIT) && (exponent > -GCODE_POW10_MAX)) {
+				mantissa = mantissa*10 + (*rd - '0');
+				exponent--;
+			}
 		}
 	}
+	if (digits == 0) { return(STAT_BAD_NUMBER_FORMAT);}
+
+	float number = (float)mantissa;
+	if (exponent < 0) { 
+		number /= _pow10[-exponent];
+	} else {
+		number *= _pow10[exponent];
+	}
+	*value = (negative == true) ? -number : number;
+	*pstr = rd;
+	return (STAT_OK);
 }
 
 /*
- * _get_next_gcode_word() - get gcode word consisting of a letter and a value
+ * Parameters and expressions
+ *
+ * _get_word_value()	 - read a word's value - a number, or an expression it compiles and runs
+ * _compile_value()		 - compile a value: number, #value, [expression], function or signed value
+ * _compile_expression() - compile a run of values and binary operators down to precedence
+ * _emit()				 - add an op to the code and track the stack depth it takes
+ * _evaluate_word()		 - run a word's code and take up its value or setting
+ * _evaluate()			 - run expression code on a stack
+ * _queue_setting()		 - hold a parameter setting for the end of the block
+ * _set_parameters()	 - make the block's settings
+ *
+ *	Numbered parameters #1 to #GCODE_PARAMETERS-1 hold floats, are 0 at power up and
+ *	are set with #<number>=<value>. #0 is always 0. Anywhere a word takes a number it
+ *	takes a value instead, as in RS274NGC:
+ *
+ *	  #1 = 12.5  #2 = [#1 * 2]
+ *	  G1 X[#1 + 3] Y-#2 F[#3 * 60]
+ *
+ *	A value is a number, #value (a parameter), a bracketed expression, a function of
+ *	a bracketed expression or a signed value. Expressions take these, by precedence:
  *
- *	This function requires the Gcode string to be normalized.
- *	Normalization must remove any leading zeros or they will be converted to Octal
- *	G0X... is not interpreted as hexadecimal. This is trapped.
+ *	  **					power
+ *	  *  /  MOD				(MOD has the sign of the divisor)
+ *	  +  -
+ *	  EQ NE GT GE LT LE		1 for true, 0 for false
+ *	  AND OR XOR			non-zero is true
+ *
+ *	Functions are ABS ACOS ASIN COS EXP FIX FUP LN ROUND SIN SQRT TAN and ATAN[y]/[x],
+ *	in degrees. Settings take effect at the end of the block, so every value in a block 
+ *	reads the parameters as they were before it.
+ *
+ *	Values other than plain numbers are compiled into stack code in gv.code as they 
+ *	are read and run straight away - the value goes into gn as a number would. Plain
+ *	numbers don't touch the compiler. Subroutine bodies store the code instead of the
+ *	value and run it on each call (see Subroutines). Blocks are parsed in the order they
+ *	run, including blocks read ahead, so the parameters a block sees are the ones the 
+ *	blocks before it set. The model's own values (offsets, positions - #5161 and up in 
+ *	RS274NGC) aren't parameters here: a block read ahead is parsed before the blocks 
+ *	in front of it have run.
  */
-static stat_t _get_next_gcode_word(char **pstr, char *letter, float *value) 
+static stat_t _get_word_value(char **pstr, const char letter, float *value)
 {
-	if (**pstr == NUL) { return (STAT_COMPLETE); }	// no more words
+	char *rd = *pstr;
+	if ((*rd == '-') || (*rd == '+')) { rd++;}
+	if ((isdigit(*rd)) || (*rd == '.')) { return (_get_gcode_number(pstr, value));}	// plain number
 
-	// get letter part
-	if(isupper(**pstr) == false) { return (STAT_EXPECTED_COMMAND_LETTER); }
-	*letter = **pstr;
-	(*pstr)++;
-	
-	// X-axis-becomes-a-hexadecimal-number get-value case, e.g. G0X100 --> G255
-	if ((**pstr == '0') && (*(*pstr+1) == 'X')) {
+	gv.len = 0;
+	gv.depth = 0;
+	gv.nesting = 0;
+	ritorno(_compile_value(pstr));
+	ritorno(_emit(GC_OP_END));
+	if (gs.defining == true) {					// stored to run later
 		*value = 0;
-		(*pstr)++;
-		return (STAT_OK);		// pointer points to X
+		return (STAT_OK);
+	}
+	return (_evaluate_word(gv.code, letter, value));
+}
+
+typedef struct gcOperator {
+	char name[6];
+	uint8_t op;
+	uint8_t precedence;
+} gcOperator_t;
+
+static const gcOperator_t _operators[] = {	// longer names ahead of their prefixes
+	{ "**", GC_OP_POWER, 4 }, { "*", GC_OP_MULTIPLY, 3 }, { "/", GC_OP_DIVIDE, 3 }, { "MOD", GC_OP_MOD, 3 },
+	{ "+", GC_OP_ADD, 2 }, { "-", GC_OP_SUBTRACT, 2 },
+	{ "EQ", GC_OP_EQ, 1 }, { "NE", GC_OP_NE, 1 }, { "GT", GC_OP_GT, 1 }, { "GE", GC_OP_GE, 1 }, 
+	{ "LT", GC_OP_LT, 1 }, { "LE", GC_OP_LE, 1 },
+	{ "AND", GC_OP_AND, 0 }, { "OR", GC_OP_OR, 0 }, { "XOR", GC_OP_XOR, 0 }
+};
+
+static const gcOperator_t _functions[] = {	// precedence isn't used
+	{ "ABS", GC_OP_ABS, 0 }, { "ACOS", GC_OP_ACOS, 0 }, { "ASIN", GC_OP_ASIN, 0 }, { "ATAN", GC_OP_ATAN2, 0 },
+	{ "COS", GC_OP_COS, 0 }, { "EXP", GC_OP_EXP, 0 }, { "FIX", GC_OP_FIX, 0 }, { "FUP", GC_OP_FUP, 0 },
+	{ "LN", GC_OP_LN, 0 }, { "ROUND", GC_OP_ROUND, 0 }, { "SIN", GC_OP_SIN, 0 }, { "SQRT", GC_OP_SQRT, 0 },
+	{ "TAN", GC_OP_TAN, 0 }
+};
+
+#define GC_OPERATORS (sizeof(_operators) / sizeof(gcOperator_t))
+#define GC_FUNCTIONS (sizeof(_functions) / sizeof(gcOperator_t))
+
+static stat_t _compile_value(char **pstr)
+{
+	if (++gv.nesting > GCODE_EVAL_STACK) { return (STAT_EXPRESSION_ERROR);}
+	stat_t status = _compile_operand(pstr);
+	gv.nesting--;
+	return (status);
+}
+
+static stat_t _compile_operand(char **pstr)
+{
+	char *rd = *pstr;
+	for (; (*rd == ' ') || (*rd == TAB); rd++);
+
+	if ((*rd == '-') || (*rd == '+')) {			// signed value
+		uint8_t negate = (*rd++ == '-');
+		*pstr = rd;
+		ritorno(_compile_value(pstr));
+		return ((negate == true) ? _emit(GC_OP_NEGATE) : STAT_OK);
+	}
+	if (*rd == '#') {							// parameter
+		*pstr = rd + 1;
+		ritorno(_compile_value(pstr));
+		return (_emit(GC_OP_PARAMETER));
+	}
+	if (*rd == '[') {							// expression
+		*pstr = rd + 1;
+		ritorno(_compile_expression(pstr, 0));
+		for (rd = *pstr; (*rd == ' ') || (*rd == TAB); rd++);
+		if (*rd != ']') { return (STAT_EXPRESSION_ERROR);}
+		*pstr = rd + 1;
+		return (STAT_OK);
+	}
+	if (isalpha(*rd)) {							// function
+		const gcOperator_t *f = NULL;
+		for (uint8_t i=0; i<GC_FUNCTIONS; i++) {
+			uint8_t len = _match(rd, _functions[i].name);
+			if ((len > 0) && (isalpha(rd[len]) == false)) { f = &_functions[i]; rd += len; break;}
+		}
+		if (f == NULL) { return (STAT_BAD_NUMBER_FORMAT);}	// as for a letter with no value
+		for (; (*rd == ' ') || (*rd == TAB); rd++);
+		if (*rd != '[') { return (STAT_EXPRESSION_ERROR);}
+		*pstr = rd;
+		ritorno(_compile_value(pstr));
+		if (f->op == GC_OP_ATAN2) {				// ATAN[y]/[x]
+			for (rd = *pstr; (*rd == ' ') || (*rd == TAB); rd++);
+			if (*rd++ != '/') { return (STAT_EXPRESSION_ERROR);}
+			for (; (*rd == ' ') || (*rd == TAB); rd++);
+			if (*rd != '[') { return (STAT_EXPRESSION_ERROR);}
+			*pstr = rd;
+			ritorno(_compile_value(pstr));
+		}
+		return (_emit(f->op));
+	}
+	float number;								// number
+	ritorno(_get_gcode_number(&rd, &number));
+	*pstr = rd;
+	if (gv.len + 1 + sizeof(float) >= GCODE_EXPRESSION_BYTES) { return (STAT_EXPRESSION_ERROR);}	// room for the end
+	gv.code[gv.len++] = GC_OP_NUMBER;
+	memcpy(&gv.code[gv.len], &number, sizeof(float));
+	gv.len += sizeof(float);
+	if (++gv.depth > GCODE_EVAL_STACK) { return (STAT_EXPRESSION_ERROR);}
+	return (STAT_OK);
+}
+
+static stat_t _compile_expression(char **pstr, const uint8_t precedence)
+{
+	ritorno(_compile_value(pstr));
+	while (true) {
+		char *rd = *pstr;
+		for (; (*rd == ' ') || (*rd == TAB); rd++);
+		const gcOperator_t *o = NULL;
+		uint8_t len = 0;
+		for (uint8_t i=0; i<GC_OPERATORS; i++) {
+			if ((len = _match(rd, _operators[i].name)) > 0) { o = &_operators[i]; break;}
+		}
+		if ((o == NULL) || (o->precedence < precedence)) { return (STAT_OK);}	// left to the caller
+		*pstr = rd + len;
+		ritorno(_compile_expression(pstr, o->precedence + 1));	// operators are left associative
+		ritorno(_emit(o->op));
+	}
+}
+
+static stat_t _emit(const uint8_t op)
+{
+	if (gv.len >= GCODE_EXPRESSION_BYTES - ((op == GC_OP_END) ? 0 : 1)) { return (STAT_EXPRESSION_ERROR);}
+	gv.code[gv.len++] = op;
+	if (op >= GC_OP_POWER) { gv.depth--;}		// binary ops take two values and leave one
+	return (STAT_OK);
+}
+
+static uint8_t _match(const char *rd, const char *name)	// returns the length matched or 0
+{
+	uint8_t len = 0;
+	for (; name[len] != NUL; len++) {
+		if (toupper(rd[len]) != name[len]) { return (0);}
+	}
+	return (len);
+}
+
+static stat_t _evaluate_word(const uint8_t *code, const char letter, float *value)
+{
+	float stack[GCODE_EVAL_STACK];
+	uint8_t depth;
+	ritorno(_evaluate(code, stack, &depth));
+	if (letter == '#') {
+		ritorno(_queue_setting(stack[0], stack[1]));
+		*value = stack[1];
+		return (STAT_OK);
+	}
+	*value = stack[0];
+	uint32_t tenths = (uint32_t)lround(fabs(*value) * 10);	// for the sub-code of G words (see _point())
+	gp.point = tenths % 10;
+	gp.integer = (gp.point == 0);
+	return (STAT_OK);
+}
+
+static stat_t _evaluate(const uint8_t *code, float stack[], uint8_t *depth)
+{
+	uint8_t sp = 0;
+
+	while (true) {
+		uint8_t op = *code++;
+		if (op == GC_OP_END) { 
+			*depth = sp;
+			return (STAT_OK);
+		}
+		if (op == GC_OP_NUMBER) {
+			memcpy(&stack[sp++], code, sizeof(float));
+			code += sizeof(float);
+			continue;
+		}
+		float b = 0;
+		if (op >= GC_OP_POWER) { b = stack[--sp];}	// right operand
+		float *a = &stack[sp-1];						// operand and result
+		switch (op) {
+			case GC_OP_PARAMETER: {
+				int32_t n = lround(*a);
+				if ((n < 0) || (n >= GCODE_PARAMETERS) || (fp_NE(*a, n))) { return (STAT_EXPRESSION_VALUE_ERROR);}
+				*a = gv.value[n];
+				break;
+			}
+			case GC_OP_NEGATE: { *a = -*a; break;}
+			case GC_OP_ABS: { *a = fabs(*a); break;}
+			case GC_OP_ACOS: {
+				if (fabs(*a) > 1) { return (STAT_EXPRESSION_VALUE_ERROR);}
+				*a = acos(*a) * RADIAN;
+				break;
+			}
+			case GC_OP_ASIN: {
+				if (fabs(*a) > 1) { return (STAT_EXPRESSION_VALUE_ERROR);}
+				*a = asin(*a) * RADIAN;
+				break;
+			}
+			case GC_OP_COS: { *a = cos(*a / RADIAN); break;}
+			case GC_OP_EXP: { *a = exp(*a); break;}
+			case GC_OP_FIX: { *a = floor(*a); break;}
+			case GC_OP_FUP: { *a = ceil(*a); break;}
+			case GC_OP_LN: {
+				if (*a <= 0) { return (STAT_EXPRESSION_VALUE_ERROR);}
+				*a = log(*a);
+				break;
+			}
+			case GC_OP_ROUND: { *a = round(*a); break;}
+			case GC_OP_SIN: { *a = sin(*a / RADIAN); break;}
+			case GC_OP_SQRT: {
+				if (*a < 0) { return (STAT_EXPRESSION_VALUE_ERROR);}
+				*a = sqrt(*a);
+				break;
+			}
+			case GC_OP_TAN: { *a = tan(*a / RADIAN); break;}
+			case GC_OP_POWER: { *a = pow(*a, b); break;}
+			case GC_OP_MULTIPLY: { *a *= b; break;}
+			case GC_OP_DIVIDE: {
+				if (fp_ZERO(b)) { return (STAT_EXPRESSION_VALUE_ERROR);}
+				*a /= b;
+				break;
+			}
+			case GC_OP_MOD: {
+				if (fp_ZERO(b)) { return (STAT_EXPRESSION_VALUE_ERROR);}
+				*a -= b * floor(*a / b);
+				break;
+			}
+			case GC_OP_ADD: { *a += b; break;}
+			case GC_OP_SUBTRACT: { *a -= b; break;}
+			case GC_OP_EQ: { *a = fp_EQ(*a, b); break;}
+			case GC_OP_NE: { *a = fp_NE(*a, b); break;}
+			case GC_OP_GT: { *a = (*a > b); break;}
+			case GC_OP_GE: { *a = (*a >= b); break;}
+			case GC_OP_LT: { *a = (*a < b); break;}
+			case GC_OP_LE: { *a = (*a <= b); break;}
+			case GC_OP_AND: { *a = (fp_NOT_ZERO(*a) && fp_NOT_ZERO(b)); break;}
+			case GC_OP_OR: { *a = (fp_NOT_ZERO(*a) || fp_NOT_ZERO(b)); break;}
+			case GC_OP_XOR: { *a = (fp_NOT_ZERO(*a) != fp_NOT_ZERO(b)); break;}
+			case GC_OP_ATAN2: { *a = atan2(*a, b) * RADIAN; break;}
+			default: { return (STAT_EXPRESSION_ERROR);}
+		}
 	}
+}
+
+static stat_t _queue_setting(const float number, const float value)
+{
+	int32_t n = lround(number);
+	if ((n < 1) || (n >= GCODE_PARAMETERS) || (fp_NE(number, n))) { return (STAT_EXPRESSION_VALUE_ERROR);}
+	if (gv.settings >= GCODE_BLOCK_SETTINGS) { return (STAT_EXPRESSION_ERROR);}
+	gv.number[gv.settings] = n;
+	gv.setting[gv.settings++] = value;
+	return (STAT_OK);
+}
 
-	// get-value general case
-	char *end; 
-	*value = strtof(*pstr, &end);
-	if(end == *pstr) { return(STAT_BAD_NUMBER_FORMAT); }	// more robust test then checking for value=0;
-	*pstr = end;
-	return (STAT_OK);			// pointer points to next character after the word
+static void _set_parameters()
+{
+	for (uint8_t i=0; i<gv.settings; i++) { gv.value[gv.number[i]] = gv.setting[i];}
+	gv.settings = 0;
 }
 
 /*
- * _point() - isolate the decimal point value as an integer
+ * _point() - the decimal point value of the last word as an integer (e.g. 2 for G38.2)
  */
-static uint8_t _point(float value) 
+static uint8_t _point() 
 {
-	return((uint8_t)(value*10 - trunc(value)*10));	// isolate the decimal point as an int
+	if (gp.integer == true) { return (0);}
+	return (gp.point);
 }
 
 /*
@@ -224,8 +1034,9 @@ static stat_t _validate_gcode_block()
  * _parse_gcode_block() - parses one line of NULL terminated G-Code. 
  *
  *	All the parser does is load the state values in gn (next model state) and set flags
- *	in gf (model state flags). The execute routine applies them. The buffer is assumed to 
- *	contain only uppercase characters and signed floats (no whitespace).
+ *	in gf (model state flags). The execute routine applies them. The buffer is read as is
+ *	(see _get_next_gcode_word()). Nothing is read from the model, so a block can be parsed
+ *	ahead of the blocks before it running (see gc_read_ahead()).
  *
  *	A number of implicit things happen when the gn struct is zeroed:
  *	  - inverse feed rate mode is canceled - set back to units_per_minute mode
@@ -241,134 +1052,248 @@ static stat_t _parse_gcode_block(char_t *buf)
 	memset(&gp, 0, sizeof(gp));		// clear all parser values
 	memset(&gf, 0, sizeof(gf));		// clear all next-state flags
 	memset(&gn, 0, sizeof(gn));		// clear all next-state values
-	gn.motion_mode = cm_get_motion_mode(MODEL);// get motion mode from previous block
+	gn.linenum = xio_file_linenum();// lines of a stored job are numbered unless they have an N word
+	gv.settings = 0;
 
 	// extract commands and parameters
 	while((status = _get_next_gcode_word(&pstr, &letter, &value)) == STAT_OK) {
-		switch(letter) {
-			case 'G':
-			switch((uint8_t)value) {
-				case 0:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_TRAVERSE);
-				case 1:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_FEED);
-				case 2:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CW_ARC);
-				case 3:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CCW_ARC);
-				case 4:  SET_NON_MODAL (next_action, NEXT_ACTION_DWELL);
-				case 10: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_COORD_DATA);
-				case 17: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_XY);
-				case 18: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_XZ);
-				case 19: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_YZ);
-				case 20: SET_MODAL (MODAL_GROUP_G6, units_mode, INCHES);
-				case 21: SET_MODAL (MODAL_GROUP_G6, units_mode, MILLIMETERS);
-				case 28: {
-					switch (_point(value)) {
-						case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_GOTO_G28_POSITION);
-						case 1: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_G28_POSITION);
-						case 2: SET_NON_MODAL (next_action, NEXT_ACTION_SEARCH_HOME);
-						case 3: SET_NON_MODAL (next_action, NEXT_ACTION_SET_ABSOLUTE_ORIGIN);
-						case 4: SET_NON_MODAL (next_action, NEXT_ACTION_HOMING_NO_SET);
-						default: status = STAT_UNRECOGNIZED_COMMAND;
-					}
-					break;
+		if (letter == '#') { continue;}			// parameter setting - made at the end of the block
+		if ((status = _parse_gcode_word(letter, value)) != STAT_OK) break;
+	}
+	if ((status != STAT_OK) && (status != STAT_COMPLETE)) return (status);
+	_set_parameters();
+	gn.setters = _get_setters();
+	return (_validate_gcode_block());
+}
+
+/*
+ * _parse_gcode_frame() - parses one pre-tokenized Gcode frame (see gcode_parser.h)
+ *
+ *	The checksum is tested before anything is decoded. Values in the integer formats
+ *	set the sub-code exactly (see _point()). Sub-codes sent as floats are rounded to 
+ *	the nearest tenth, so hosts should send them as GC_FORMAT_TENTHS.
+ */
+static const uint8_t _frame_value_bytes[] = { 1, 2, 2, 3, 4, 4 };
+static const uint16_t _frame_value_scale[] = { 1, 1, 10, 1000, 10000, 1 };
+
+static stat_t _parse_gcode_frame(char_t *frame) 
+{
+	char *end = strrchr((char *)frame, '*');	// start of the checksum
+	if ((end == NULL) || (end == (char *)frame+1)) return (STAT_BINARY_FRAME_ERROR);
+	if (compute_checksum(frame+1, end - (char *)frame - 1) != strtol(end+1, NULL, 10)) {
+		return (STAT_CHECKSUM_MISMATCH);
+	}
+
+	// decode the base64 text. Trailing '=' padding is optional
+	uint8_t bytes[GCODE_FRAME_BYTES];
+	uint8_t count = 0;
+	uint16_t bits = 0;
+	uint8_t nbits = 0;
+	for (char *rd = (char *)frame+1; (rd < end) && (*rd != '='); rd++) {
+		int8_t sextet = base64_value(*rd);
+		if (sextet < 0) return (STAT_BINARY_FRAME_ERROR);
+		bits = (bits << 6) | sextet;
+		if ((nbits += 6) >= 8) {
+			if (count >= GCODE_FRAME_BYTES) return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
+			nbits -= 8;
+			bytes[count++] = (uint8_t)(bits >> nbits);
+		}
+	}
+
+	// set initial state for new move 
+	memset(&gp, 0, sizeof(gp));
+	memset(&gf, 0, sizeof(gf));
+	memset(&gn, 0, sizeof(gn));
+
+	for (uint8_t i=0; i<count;) {
+		uint8_t letter = bytes[i] & 0x1F;
+		uint8_t format = bytes[i++] >> 5;
+		if ((letter > 'Z'-'A') || (format > GC_FORMAT_FLOAT)) return (STAT_BINARY_FRAME_ERROR);
+		uint8_t size = _frame_value_bytes[format];
+		if (i + size > count) return (STAT_BINARY_FRAME_ERROR);
+
+		uint32_t raw = 0;
+		for (uint8_t j=size; j>0; j--) { raw = (raw << 8) | bytes[i+j-1];}
+		i += size;
+
+		float value;
+		if (format == GC_FORMAT_FLOAT) {
+			memcpy(&value, &raw, sizeof(float));
+			float fraction = fabs(value) - trunc(fabs(value));
+			gp.integer = fp_ZERO(fraction);
+			gp.point = (uint8_t)(fraction * 10 + 0.5);
+		} else {
+			uint8_t shift = 32 - (size << 3);
+			int32_t fixed = (int32_t)(raw << shift) >> shift;	// sign extend
+			uint16_t scale = _frame_value_scale[format];
+			uint16_t fraction = (uint32_t)labs(fixed) % scale;
+			gp.integer = (fraction == 0);
+			gp.point = fraction * 10 / scale;
+			value = (float)fixed / scale;
+		}
+		ritorno(_parse_gcode_word('A' + letter, value));
+	}
+	gn.setters = _get_setters();
+	return (_validate_gcode_block());
+}
+
+/*
+ * _parse_gcode_word() - load one word into the GN/GF structs 
+ *
+ *	gp.integer and gp.point must already be set for the word (see _point())
+ */
+static stat_t _parse_gcode_word(char letter, float value) 
+{
+	stat_t status = STAT_OK;
+
+	switch(letter) {
+		case 'G':
+		switch((uint8_t)value) {
+			case 0:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_TRAVERSE);
+			case 1:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_FEED);
+			case 2:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CW_ARC);
+			case 3:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CCW_ARC);
+			case 4:  SET_NON_MODAL (next_action, NEXT_ACTION_DWELL);
+			case 5: {
+				switch (_point()) {
+					case 0: SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CUBIC_SPLINE);
+					case 1: SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_QUADRATIC_SPLINE);
+					default: status = STAT_UNRECOGNIZED_COMMAND;
 				}
-				case 30: {
-					switch (_point(value)) {
-						case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_GOTO_G30_POSITION);
-						case 1: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_G30_POSITION);
-						default: status = STAT_UNRECOGNIZED_COMMAND;
-					}
-					break;
+				break;
+			}
+			case 10: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_COORD_DATA);
+			case 17: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_XY);
+			case 18: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_XZ);
+			case 19: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_YZ);
+			case 20: SET_MODAL (MODAL_GROUP_G6, units_mode, INCHES);
+			case 21: SET_MODAL (MODAL_GROUP_G6, units_mode, MILLIMETERS);
+			case 28: {
+				switch (_point()) {
+					case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_GOTO_G28_POSITION);
+					case 1: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_G28_POSITION);
+					case 2: SET_NON_MODAL (next_action, NEXT_ACTION_SEARCH_HOME);
+					case 3: SET_NON_MODAL (next_action, NEXT_ACTION_SET_ABSOLUTE_ORIGIN);
+					case 4: SET_NON_MODAL (next_action, NEXT_ACTION_HOMING_NO_SET);
+					default: status = STAT_UNRECOGNIZED_COMMAND;
 				}
-				case 38: {
-					switch (_point(value)) {
-						case 2: SET_NON_MODAL (next_action, NEXT_ACTION_STRAIGHT_PROBE);
-						default: status = STAT_UNRECOGNIZED_COMMAND;
-					}
-					break;
+				break;
+			}
+			case 30: {
+				switch (_point()) {
+					case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_GOTO_G30_POSITION);
+					case 1: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_G30_POSITION);
+					default: status = STAT_UNRECOGNIZED_COMMAND;
 				}
-				case 40: break;	// ignore cancel cutter radius compensation
-				case 49: break;	// ignore cancel tool length offset comp.
-				case 53: SET_NON_MODAL (absolute_override, true);
-				case 54: SET_MODAL (MODAL_GROUP_G12, coord_system, G54);
-				case 55: SET_MODAL (MODAL_GROUP_G12, coord_system, G55);
-				case 56: SET_MODAL (MODAL_GROUP_G12, coord_system, G56);
-				case 57: SET_MODAL (MODAL_GROUP_G12, coord_system, G57);
-				case 58: SET_MODAL (MODAL_GROUP_G12, coord_system, G58);
-				case 59: SET_MODAL (MODAL_GROUP_G12, coord_system, G59);
-				case 61: {
-					switch (_point(value)) {
-						case 0: SET_MODAL (MODAL_GROUP_G13, path_control, PATH_EXACT_PATH);
-						case 1: SET_MODAL (MODAL_GROUP_G13, path_control, PATH_EXACT_STOP);
-						default: status = STAT_UNRECOGNIZED_COMMAND;
-					}
-					break;
+				break;
+			}
+			case 33: SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_SPINDLE_SYNC);
+			case 38: {
+				switch (_point()) {
+					case 2: SET_NON_MODAL (next_action, NEXT_ACTION_STRAIGHT_PROBE);
+					case 6: SET_NON_MODAL (next_action, NEXT_ACTION_PROBE_GRID);
+					case 7: SET_NON_MODAL (next_action, NEXT_ACTION_PROBE_TOUCH);
+					default: status = STAT_UNRECOGNIZED_COMMAND;
 				}
-				case 64: SET_MODAL (MODAL_GROUP_G13,path_control, PATH_CONTINUOUS);
-				case 80: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANCEL_MOTION_MODE);
-				case 90: SET_MODAL (MODAL_GROUP_G3, distance_mode, ABSOLUTE_MODE);
-				case 91: SET_MODAL (MODAL_GROUP_G3, distance_mode, INCREMENTAL_MODE);
-				case 92: {
-					switch (_point(value)) {
-						case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_ORIGIN_OFFSETS);
-						case 1: SET_NON_MODAL (next_action, NEXT_ACTION_RESET_ORIGIN_OFFSETS);
-						case 2: SET_NON_MODAL (next_action, NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS);
-						case 3: SET_NON_MODAL (next_action, NEXT_ACTION_RESUME_ORIGIN_OFFSETS);
-						default: status = STAT_UNRECOGNIZED_COMMAND;
-					}
-					break;
+				break;
+			}
+			case 40: break;	// ignore cancel cutter radius compensation
+			case 49: break;	// ignore cancel tool length offset comp.
+			case 53: SET_NON_MODAL (absolute_override, true);
+			case 54: SET_MODAL (MODAL_GROUP_G12, coord_system, G54);
+			case 55: SET_MODAL (MODAL_GROUP_G12, coord_system, G55);
+			case 56: SET_MODAL (MODAL_GROUP_G12, coord_system, G56);
+			case 57: SET_MODAL (MODAL_GROUP_G12, coord_system, G57);
+			case 58: SET_MODAL (MODAL_GROUP_G12, coord_system, G58);
+			case 59: SET_MODAL (MODAL_GROUP_G12, coord_system, G59);
+			case 61: {
+				switch (_point()) {
+					case 0: SET_MODAL (MODAL_GROUP_G13, path_control, PATH_EXACT_PATH);
+					case 1: SET_MODAL (MODAL_GROUP_G13, path_control, PATH_EXACT_STOP);
+					default: status = STAT_UNRECOGNIZED_COMMAND;
 				}
-				case 93: SET_MODAL (MODAL_GROUP_G5, inverse_feed_rate_mode, true);
-				case 94: SET_MODAL (MODAL_GROUP_G5, inverse_feed_rate_mode, false);
-				default: status = STAT_UNRECOGNIZED_COMMAND;
+				break;
 			}
-			break;
-
-			case 'M':
-			switch((uint8_t)value) {
-				case 0: case 1: case 60:
-						SET_MODAL (MODAL_GROUP_M4, program_flow, PROGRAM_STOP);
-				case 2: case 30:
-						SET_MODAL (MODAL_GROUP_M4, program_flow, PROGRAM_END);
-				case 3: SET_MODAL (MODAL_GROUP_M7, spindle_mode, SPINDLE_CW);
-				case 4: SET_MODAL (MODAL_GROUP_M7, spindle_mode, SPINDLE_CCW);
-				case 5: SET_MODAL (MODAL_GROUP_M7, spindle_mode, SPINDLE_OFF);
-				case 6: SET_NON_MODAL (tool_change, true);
-				case 7: SET_MODAL (MODAL_GROUP_M8, mist_coolant, true);
-				case 8: SET_MODAL (MODAL_GROUP_M8, flood_coolant, true);
-				case 9: SET_MODAL (MODAL_GROUP_M8, flood_coolant, false);
-				case 48: SET_MODAL (MODAL_GROUP_M9, override_enables, true);
-				case 49: SET_MODAL (MODAL_GROUP_M9, override_enables, false);
-				case 50: SET_MODAL (MODAL_GROUP_M9, feed_rate_override_enable, true); // conditionally true
-				case 51: SET_MODAL (MODAL_GROUP_M9, spindle_override_enable, true);	  // conditionally true
-				default: status = STAT_UNRECOGNIZED_COMMAND;
+			case 64: SET_MODAL (MODAL_GROUP_G13,path_control, PATH_CONTINUOUS);
+			case 80: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANCEL_MOTION_MODE);
+			case 81: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANNED_CYCLE_81);
+			case 82: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANNED_CYCLE_82);
+			case 83: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANNED_CYCLE_83);
+			case 84: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANNED_CYCLE_84);
+			case 90: SET_MODAL (MODAL_GROUP_G3, distance_mode, ABSOLUTE_MODE);
+			case 91: SET_MODAL (MODAL_GROUP_G3, distance_mode, INCREMENTAL_MODE);
+			case 92: {
+				switch (_point()) {
+					case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_ORIGIN_OFFSETS);
+					case 1: SET_NON_MODAL (next_action, NEXT_ACTION_RESET_ORIGIN_OFFSETS);
+					case 2: SET_NON_MODAL (next_action, NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS);
+					case 3: SET_NON_MODAL (next_action, NEXT_ACTION_RESUME_ORIGIN_OFFSETS);
+					default: status = STAT_UNRECOGNIZED_COMMAND;
+				}
+				break;
 			}
-			break;
+			case 93: SET_MODAL (MODAL_GROUP_G5, inverse_feed_rate_mode, true);
+			case 94: SET_MODAL (MODAL_GROUP_G5, inverse_feed_rate_mode, false);
+			case 98: SET_MODAL (MODAL_GROUP_G9, retract_mode, RETRACT_TO_INITIAL_LEVEL);
+			case 99: SET_MODAL (MODAL_GROUP_G9, retract_mode, RETRACT_TO_R_PLANE);
+			default: status = STAT_UNRECOGNIZED_COMMAND;
+		}
+		break;
 
-			case 'T': SET_NON_MODAL (tool_select, (uint8_t)trunc(value));
-			case 'F': SET_NON_MODAL (feed_rate, value);
-			case 'P': SET_NON_MODAL (parameter, value);				// used for dwell time, G10 coord select
-			case 'S': SET_NON_MODAL (spindle_speed, value);
-			case 'X': SET_NON_MODAL (target[AXIS_X], value);
-			case 'Y': SET_NON_MODAL (target[AXIS_Y], value);
-			case 'Z': SET_NON_MODAL (target[AXIS_Z], value);
-			case 'A': SET_NON_MODAL (target[AXIS_A], value);
-			case 'B': SET_NON_MODAL (target[AXIS_B], value);
-			case 'C': SET_NON_MODAL (target[AXIS_C], value);
-		//	case 'U': SET_NON_MODAL (target[AXIS_U], value);		// reserved
-		//	case 'V': SET_NON_MODAL (target[AXIS_V], value);		// reserved
-		//	case 'W': SET_NON_MODAL (target[AXIS_W], value);		// reserved
-			case 'I': SET_NON_MODAL (arc_offset[0], value);
-			case 'J': SET_NON_MODAL (arc_offset[1], value);
-			case 'K': SET_NON_MODAL (arc_offset[2], value);
-			case 'R': SET_NON_MODAL (arc_radius, value);
-			case 'N': SET_NON_MODAL (linenum,(uint32_t)value);		// line number
-			case 'L': break;										// not used for anything
+		case 'M':
+		switch((uint8_t)value) {
+			case 0: case 1: case 60:
+					SET_MODAL (MODAL_GROUP_M4, program_flow, PROGRAM_STOP);
+			case 2: case 30:
+					SET_MODAL (MODAL_GROUP_M4, program_flow, PROGRAM_END);
+			case 3: SET_MODAL (MODAL_GROUP_M7, spindle_mode, SPINDLE_CW);
+			case 4: SET_MODAL (MODAL_GROUP_M7, spindle_mode, SPINDLE_CCW);
+			case 5: SET_MODAL (MODAL_GROUP_M7, spindle_mode, SPINDLE_OFF);
+			case 6: SET_NON_MODAL (tool_change, true);
+			case 7: SET_MODAL (MODAL_GROUP_M8, mist_coolant, true);
+			case 8: SET_MODAL (MODAL_GROUP_M8, flood_coolant, true);
+			case 9: SET_MODAL (MODAL_GROUP_M8, flood_coolant, false);
+			case 48: SET_MODAL (MODAL_GROUP_M9, override_enables, true);
+			case 49: SET_MODAL (MODAL_GROUP_M9, override_enables, false);
+			case 50: SET_MODAL (MODAL_GROUP_M9, feed_rate_override_enable, true); // conditionally true
+			case 51: SET_MODAL (MODAL_GROUP_M9, spindle_override_enable, true);	  // conditionally true
+			case 62: SET_NON_MODAL (sync_output, true);	// output number is the P word
+			case 63: SET_NON_MODAL (sync_output, false);
+			case 150: SET_NON_MODAL (motion_profile, true);	// profile number is the P word
 			default: status = STAT_UNRECOGNIZED_COMMAND;
 		}
-		if(status != STAT_OK) break;
+		break;
+
+		case 'T': SET_NON_MODAL (tool_select, (uint8_t)trunc(value));
+		case 'F': SET_NON_MODAL (feed_rate, value);
+		case 'P': SET_NON_MODAL (parameter, value);				// used for dwell time, G10 coord select
+		case 'S': SET_NON_MODAL (spindle_speed, value);
+		case 'X': SET_NON_MODAL (target[AXIS_X], value);
+		case 'Y': SET_NON_MODAL (target[AXIS_Y], value);
+		case 'Z': SET_NON_MODAL (target[AXIS_Z], value);
+#if (AXES > AXIS_A)
+		case 'A': SET_NON_MODAL (target[AXIS_A], value);
+#endif
+#if (AXES > AXIS_B)
+		case 'B': SET_NON_MODAL (target[AXIS_B], value);
+#endif
+#if (AXES > AXIS_C)
+		case 'C': SET_NON_MODAL (target[AXIS_C], value);
+#endif
+	//	case 'U': SET_NON_MODAL (target[AXIS_U], value);		// reserved
+	//	case 'V': SET_NON_MODAL (target[AXIS_V], value);		// reserved
+	//	case 'W': SET_NON_MODAL (target[AXIS_W], value);		// reserved
+		case 'I': SET_NON_MODAL (arc_offset[0], value);
+		case 'J': SET_NON_MODAL (arc_offset[1], value);
+		case 'K': SET_NON_MODAL (arc_offset[2], value);
+		case 'R': SET_NON_MODAL (arc_radius, value);			// also the canned cycle R plane
+		case 'Q': SET_NON_MODAL (peck_depth, value);			// also the M62, M63 distance offset
+		case 'N': SET_NON_MODAL (linenum,(uint32_t)value);		// line number
+		case 'L': SET_NON_MODAL (l_word, (uint8_t)value);		// canned cycle repeats
+		case 'E': SET_NON_MODAL (output_time, value);			// M62, M63 time offset
+		default: status = STAT_UNRECOGNIZED_COMMAND;
 	}
-	if ((status != STAT_OK) && (status != STAT_COMPLETE)) return (status);
-	ritorno(_validate_gcode_block());
-	return (_execute_gcode_block());		// if successful execute the block
+	return (status);
 }
 
 /*
@@ -391,6 +1316,7 @@ static stat_t _parse_gcode_block(char_t *buf)
  *		7. spindle on or off (M3, M4, M5)
  *		8. coolant on or off (M7, M8, M9)
  *		9. enable or disable overrides (M48, M49, M50, M51)
+ *		9a. select motion profile (M150 Pn)
  *		10. dwell (G4)
  *		11. set active plane (G17, G18, G19)
  *		12. set length units (G20, G21)
@@ -414,34 +1340,49 @@ static stat_t _execute_gcode_block()
 {
 	stat_t status = STAT_OK;
 
+	if (gf.motion_mode == false) {					// get motion mode from previous block
+		gn.motion_mode = cm_get_motion_mode(MODEL);
+	}
 	cm_set_model_linenum(gn.linenum);
-	EXEC_FUNC(cm_set_inverse_feed_rate_mode, inverse_feed_rate_mode);
-	EXEC_FUNC(cm_set_feed_rate, feed_rate);
-	EXEC_FUNC(cm_feed_rate_override_factor, feed_rate_override_factor);
-	EXEC_FUNC(cm_traverse_override_factor, traverse_override_factor);
-	EXEC_FUNC(cm_set_spindle_speed, spindle_speed);
-	EXEC_FUNC(cm_spindle_override_factor, spindle_override_factor);
-	EXEC_FUNC(cm_select_tool, tool_select);			// tool_select is where it's written
-	EXEC_FUNC(cm_change_tool, tool_change);
-	EXEC_FUNC(cm_spindle_control, spindle_mode); 	// spindle on or off
-	EXEC_FUNC(cm_mist_coolant_control, mist_coolant); 
-	EXEC_FUNC(cm_flood_coolant_control, flood_coolant);	// also disables mist coolant if OFF 
-	EXEC_FUNC(cm_feed_rate_override_enable, feed_rate_override_enable);
-	EXEC_FUNC(cm_traverse_override_enable, traverse_override_enable);
-	EXEC_FUNC(cm_spindle_override_enable, spindle_override_enable);
-	EXEC_FUNC(cm_override_enables, override_enables);
+	if ((cm.seek_line != 0) && (cm_seek_block(gn.linenum) == true)) {
+		return (_seek_gcode_block());
+	}
+	_drop_unchanged_modals();						// most blocks are left with none - just motion
+	if ((gn.setters & GC_SET_AHEAD_OF_DWELL) != 0) {
+		EXEC_FUNC(cm_set_inverse_feed_rate_mode, inverse_feed_rate_mode);
+		EXEC_FUNC(cm_set_feed_rate, feed_rate);
+		EXEC_FUNC(cm_feed_rate_override_factor, feed_rate_override_factor);
+		EXEC_FUNC(cm_traverse_override_factor, traverse_override_factor);
+		EXEC_FUNC(cm_set_spindle_speed, spindle_speed);
+		EXEC_FUNC(cm_spindle_override_factor, spindle_override_factor);
+		EXEC_FUNC(cm_select_tool, tool_select);		// tool_select is where it's written
+		EXEC_FUNC(cm_change_tool, tool_change);
+		EXEC_FUNC(cm_spindle_control, spindle_mode); // spindle on or off
+		EXEC_FUNC(cm_mist_coolant_control, mist_coolant); 
+		EXEC_FUNC(cm_flood_coolant_control, flood_coolant);	// also disables mist coolant if OFF 
+		EXEC_FUNC(cm_feed_rate_override_enable, feed_rate_override_enable);
+		EXEC_FUNC(cm_traverse_override_enable, traverse_override_enable);
+		EXEC_FUNC(cm_spindle_override_enable, spindle_override_enable);
+		EXEC_FUNC(cm_override_enables, override_enables);
+		if (gf.motion_profile == true) {			// M150 - return if error, otherwise complete the block
+			ritorno(cm_motion_profile(gn.motion_profile));
+		}
+		EXEC_FUNC(cm_sync_output, sync_output);		// M62, M63
+	}
 
 	if (gn.next_action == NEXT_ACTION_DWELL) { 		// G4 - dwell
 		ritorno(cm_dwell(gn.parameter));			// return if error, otherwise complete the block
 	}
-	EXEC_FUNC(cm_select_plane, select_plane);
-	EXEC_FUNC(cm_set_units_mode, units_mode);
-	//--> cutter radius compensation goes here
-	//--> cutter length compensation goes here
-	EXEC_FUNC(cm_set_coord_system, coord_system);
-	EXEC_FUNC(cm_set_path_control, path_control);
-	EXEC_FUNC(cm_set_distance_mode, distance_mode);
-	//--> set retract mode goes here
+	if ((gn.setters & ~GC_SET_AHEAD_OF_DWELL) != 0) {
+		EXEC_FUNC(cm_select_plane, select_plane);
+		EXEC_FUNC(cm_set_units_mode, units_mode);
+		//--> cutter radius compensation goes here
+		//--> cutter length compensation goes here
+		EXEC_FUNC(cm_set_coord_system, coord_system);
+		if (gf.path_control == true) { status = cm_set_path_control(gn.path_control, gn.parameter);}	// G64 Pn
+		EXEC_FUNC(cm_set_distance_mode, distance_mode);
+		EXEC_FUNC(cm_set_retract_mode, retract_mode);
+	}
 
 	switch (gn.next_action) {
 		case NEXT_ACTION_SET_G28_POSITION:  { status = cm_set_g28_position(); break;}							// G28.1
@@ -454,6 +1395,8 @@ static stat_t _execute_gcode_block()
 		case NEXT_ACTION_HOMING_NO_SET: { status = cm_homing_cycle_start_no_set(); break;}						// G28.4
 
 		case NEXT_ACTION_STRAIGHT_PROBE: { status = cm_probe_cycle_start(); break;}								// G38.2
+		case NEXT_ACTION_PROBE_GRID: { status = cm_probe_grid_start(gn.target, gf.target, gn.arc_offset); break;}	// G38.6
+		case NEXT_ACTION_PROBE_TOUCH: { status = cm_probe_touch_start(gn.target, gf.target, (gf.l_word == true) ? gn.l_word : PROBE_TOUCHES); break;}	// G38.7
 
 		case NEXT_ACTION_SET_COORD_DATA: { status = cm_set_coord_offsets(gn.parameter, gn.target, gf.target); break;}
 		case NEXT_ACTION_SET_ORIGIN_OFFSETS: { status = cm_set_origin_offsets(gn.target, gf.target); break;}
@@ -471,6 +1414,15 @@ static stat_t _execute_gcode_block()
 					// gf.radius sets radius mode if radius was collected in gn
 					{ status = cm_arc_feed(gn.target, gf.target, gn.arc_offset[0], gn.arc_offset[1],
 								gn.arc_offset[2], gn.arc_radius, gn.motion_mode); break;}
+				case MOTION_MODE_SPINDLE_SYNC: { status = cm_spindle_sync_feed(gn.target, gf.target, gn.arc_offset[2]); break;}
+				case MOTION_MODE_CUBIC_SPLINE: case MOTION_MODE_QUADRATIC_SPLINE:
+					// P and Q are the second control point of a G5
+					{ status = cm_spline_feed(gn.target, gf.target, gn.arc_offset[0], gn.arc_offset[1], 
+								(fp_TRUE(gf.arc_offset[0]) || fp_TRUE(gf.arc_offset[1])), gn.parameter, gn.peck_depth, 
+								(fp_TRUE(gf.parameter) || fp_TRUE(gf.peck_depth)), gn.motion_mode); break;}
+				case MOTION_MODE_CANNED_CYCLE_81: case MOTION_MODE_CANNED_CYCLE_82: 
+				case MOTION_MODE_CANNED_CYCLE_83: case MOTION_MODE_CANNED_CYCLE_84:
+					{ status = cm_canned_cycle(gn.target, gf.target, gn.motion_mode); break;}
 			}
 		}
 	}
@@ -484,6 +1436,198 @@ static stat_t _execute_gcode_block()
 	return (status);
 }
 
+/*
+ * _get_setters() 			- the setter words in the parsed block as GC_SET bits
+ * _drop_unchanged_modals() - drop modal words that only repeat the model
+ *
+ *	CAM posts repeat F, G90, G21, G17 and S on nearly every line. The parser notes 
+ *	which kinds of setter words a block has in gn.setters, and when the block runs
+ *	any modal word whose value the model already has is dropped from gf and from
+ *	the mask. Most blocks are then left with none, so _execute_gcode_block() goes
+ *	straight to the motion. This is done as the block runs, not as it is parsed, as
+ *	a block read ahead is parsed before the ones ahead of it have set the model.
+ *
+ *	A word is only dropped if running it would leave everything as it is:
+ *	  - F in inverse time mode (G93) is for the block and is always kept. Otherwise it
+ *		is compared in mm/min in the units it would be read in (those before the block)
+ *	  - S queues a command to the planner. It is dropped if the last S queued is the 
+ *		same and has run, so a queue flush that drops a queued S doesn't lose the next
+ *	  - G64 with a P word is kept, G64 without one only if the model has no tolerance
+ *	  - G54-G59 are always kept, as they also reload the runtime offsets
+ */
+static uint16_t _get_setters()
+{
+	uint16_t setters = 0;
+	if (gf.inverse_feed_rate_mode == true) { setters |= GC_SET_FEED_MODE;}
+	if (fp_TRUE(gf.feed_rate)) { setters |= GC_SET_FEED_RATE;}
+	if (fp_TRUE(gf.spindle_speed)) { setters |= GC_SET_SPINDLE_SPEED;}
+	if (fp_TRUE(gf.feed_rate_override_factor) || fp_TRUE(gf.traverse_override_factor) || 
+		fp_TRUE(gf.spindle_override_factor) || (gf.tool_select == true) || (gf.tool_change == true) ||
+		(gf.spindle_mode == true) || (gf.mist_coolant == true) || (gf.flood_coolant == true) ||
+		(gf.feed_rate_override_enable == true) || (gf.traverse_override_enable == true) ||
+		(gf.spindle_override_enable == true) || (gf.override_enables == true) ||
+		(gf.motion_profile == true) || (gf.sync_output == true)) { setters |= GC_SET_OTHER_M;}
+	if (gf.select_plane == true) { setters |= GC_SET_PLANE;}
+	if (gf.units_mode == true) { setters |= GC_SET_UNITS;}
+	if (gf.path_control == true) { setters |= GC_SET_PATH;}
+	if (gf.distance_mode == true) { setters |= GC_SET_DISTANCE;}
+	if (gf.retract_mode == true) { setters |= GC_SET_RETRACT;}
+	if (gf.coord_system == true) { setters |= GC_SET_OTHER_G;}
+	return (setters);
+}
+
+static void _drop_unchanged_modals()
+{
+	if ((gn.setters & GC_SET_MODAL) == 0) { return;}
+
+	DROP_UNCHANGED(GC_SET_FEED_MODE, inverse_feed_rate_mode, (gn.inverse_feed_rate_mode == gm.inverse_feed_rate_mode));
+	uint8_t inverse = (gf.inverse_feed_rate_mode == true) ? gn.inverse_feed_rate_mode : gm.inverse_feed_rate_mode;
+	float feed_rate = (gm.units_mode == INCHES) ? (gn.feed_rate * MM_PER_INCH) : gn.feed_rate;
+	DROP_UNCHANGED(GC_SET_FEED_RATE, feed_rate, ((inverse == false) && (fp_EQ(feed_rate, gm.feed_rate))));
+	DROP_UNCHANGED(GC_SET_SPINDLE_SPEED, spindle_speed, 
+				   ((fp_EQ(gn.spindle_speed, spindle.programmed_speed)) && (fp_EQ(gn.spindle_speed, spindle.speed))));
+	DROP_UNCHANGED(GC_SET_PLANE, select_plane, (gn.select_plane == gm.select_plane));
+	DROP_UNCHANGED(GC_SET_UNITS, units_mode, (gn.units_mode == gm.units_mode));
+	DROP_UNCHANGED(GC_SET_PATH, path_control, ((gn.path_control == gm.path_control) && 
+				   ((gn.path_control != PATH_CONTINUOUS) || ((fp_FALSE(gf.parameter)) && (fp_ZERO(gm.path_tolerance))))));
+	DROP_UNCHANGED(GC_SET_DISTANCE, distance_mode, (gn.distance_mode == gm.distance_mode));
+	DROP_UNCHANGED(GC_SET_RETRACT, retract_mode, (gn.retract_mode == gmx.retract_mode));
+}
+
+/*
+ * _get_buffers_needed() - planner buffers a parsed block takes as it runs
+ *
+ *	A move or a dwell takes one, and G28 and G30 take two as they go by their 
+ *	intermediate point. A dogleg rapid takes up to MP_DOGLEG_POINTS per axis word (see
+ *	mp_dogleg()). Spindle control (M3-M5), tool change (M6) and program stops
+ *	run stopped, so each takes one as well. Other words that queue a command (S, T,
+ *	M7-M9, G54-G59, G92...) go in the command side queue and only take a buffer if 
+ *	that is full, so one is kept for them. Settings that only change the model take
+ *	none. Cycles that queue their moves from a callback - homing, probing, canned 
+ *	cycles, splines and non-native arcs - wait for the room for each move themselves.
+ */
+
+static uint8_t _get_buffers_needed(const GCodeInput_t *n, const GCodeInput_t *f)
+{
+	uint8_t need = 0;
+	if (f->spindle_mode == true) { need++;}
+	if (f->tool_change == true) { need++;}
+	if (f->program_flow == true) { need++;}
+	uint8_t commands = ((fp_TRUE(f->spindle_speed)) || (f->tool_select == true) || (f->mist_coolant == true) || 
+						(f->flood_coolant == true) || (f->coord_system == true));
+	switch (n->next_action) {
+		case NEXT_ACTION_DEFAULT: {
+			uint8_t motion_mode = (f->motion_mode == true) ? n->motion_mode : cm_get_motion_mode(MODEL);
+			if (motion_mode == MOTION_MODE_CANCEL_MOTION_MODE) { break;}
+			uint8_t moves = (fp_TRUE(f->arc_radius) || fp_TRUE(f->arc_offset[0]) || 
+							 fp_TRUE(f->arc_offset[1]) || fp_TRUE(f->arc_offset[2]));
+			uint8_t axes = 0;
+			for (uint8_t axis=0; axis<AXES; axis++) { 
+				if (fp_TRUE(f->target[axis])) { moves = true; axes++;}
+			}
+			if ((motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) && (cm.rapid_mode == RAPID_MODE_DOGLEG) && (axes > 1)) {
+				need += min(axes * MP_DOGLEG_POINTS, PLANNER_BUFFER_POOL_SIZE - PLANNER_BUFFER_HEADROOM);
+			} else if (moves == true) { need++;}
+			break;
+		}
+		case NEXT_ACTION_GOTO_G28_POSITION: case NEXT_ACTION_GOTO_G30_POSITION: { need += 2; break;}
+		case NEXT_ACTION_DWELL: case NEXT_ACTION_SEARCH_HOME: case NEXT_ACTION_HOMING_NO_SET:
+		case NEXT_ACTION_STRAIGHT_PROBE: case NEXT_ACTION_PROBE_GRID: case NEXT_ACTION_PROBE_TOUCH: { need++; break;}
+		case NEXT_ACTION_SET_G28_POSITION: case NEXT_ACTION_SET_G30_POSITION: { break;}
+		default: { commands = true; break;}			// G10, G28.3, G92...
+	}
+	if (commands == true) { need++;}
+	return (need);
+}
+
+/*
+ * _seek_gcode_block() - take up a block ahead of the line a job restarts at
+ *
+ *	Runs the block against the model as _execute_gcode_block() would, but nothing
+ *	moves: spindle, coolant and tool words are recorded for the restart, moves only
+ *	set the model position, and dwells, stops, homing and probing are skipped.
+ *	See Job restart in canonical_machine.cpp
+ */
+
+static stat_t _seek_gcode_block()
+{
+	stat_t status = STAT_OK;
+
+	EXEC_FUNC(cm_set_inverse_feed_rate_mode, inverse_feed_rate_mode);
+	EXEC_FUNC(cm_set_feed_rate, feed_rate);
+	EXEC_FUNC(cm_feed_rate_override_factor, feed_rate_override_factor);
+	EXEC_FUNC(cm_traverse_override_factor, traverse_override_factor);
+	EXEC_FUNC(cm_spindle_override_factor, spindle_override_factor);
+	cm_seek_outputs();								// S, T, M6, M3-M5, M7-M9
+	EXEC_FUNC(cm_feed_rate_override_enable, feed_rate_override_enable);
+	EXEC_FUNC(cm_traverse_override_enable, traverse_override_enable);
+	EXEC_FUNC(cm_spindle_override_enable, spindle_override_enable);
+	EXEC_FUNC(cm_override_enables, override_enables);
+	if (gf.motion_profile == true) {
+		ritorno(cm_motion_profile(gn.motion_profile));
+	}
+	EXEC_FUNC(cm_select_plane, select_plane);
+	EXEC_FUNC(cm_set_units_mode, units_mode);
+	EXEC_FUNC(cm_set_coord_system, coord_system);
+	if (gf.path_control == true) { status = cm_set_path_control(gn.path_control, gn.parameter);}
+	EXEC_FUNC(cm_set_distance_mode, distance_mode);
+	EXEC_FUNC(cm_set_retract_mode, retract_mode);
+
+	switch (gn.next_action) {
+		case NEXT_ACTION_SET_G28_POSITION:  { status = cm_set_g28_position(); break;}
+		case NEXT_ACTION_GOTO_G28_POSITION: { cm_seek_position(gmx.g28_position); break;}
+		case NEXT_ACTION_SET_G30_POSITION:  { status = cm_set_g30_position(); break;}
+		case NEXT_ACTION_GOTO_G30_POSITION: { cm_seek_position(gmx.g30_position); break;}
+
+		case NEXT_ACTION_SET_COORD_DATA: { status = cm_set_coord_offsets(gn.parameter, gn.target, gf.target); break;}
+		case NEXT_ACTION_SET_ORIGIN_OFFSETS: { status = cm_set_origin_offsets(gn.target, gf.target); break;}
+		case NEXT_ACTION_RESET_ORIGIN_OFFSETS: { status = cm_reset_origin_offsets(); break;}
+		case NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS: { status = cm_suspend_origin_offsets(); break;}
+		case NEXT_ACTION_RESUME_ORIGIN_OFFSETS: { status = cm_resume_origin_offsets(); break;}
+
+		case NEXT_ACTION_DEFAULT: { 
+			cm_set_absolute_override(MODEL, gn.absolute_override);
+			switch (gn.motion_mode) {
+				case MOTION_MODE_CANCEL_MOTION_MODE: { gm.motion_mode = gn.motion_mode; break;}
+				case MOTION_MODE_CANNED_CYCLE_81: case MOTION_MODE_CANNED_CYCLE_82: 
+				case MOTION_MODE_CANNED_CYCLE_83: case MOTION_MODE_CANNED_CYCLE_84:
+					{ status = cm_canned_cycle(gn.target, gf.target, gn.motion_mode); break;}
+				default: { cm_seek_motion(gn.target, gf.target, gn.motion_mode); break;}
+			}
+			break;
+		}
+		default: break;								// dwell, homing, probing, G28.3
+	}
+	cm_set_absolute_override(MODEL, false);
+	return (status);
+}
+
+#ifdef __MICROBENCHMARKS
+/*
+ * gc_bench_gcode_word() - time _get_next_gcode_word() on input case n
+ *
+ *	See Microbenchmarks in benchmark.h. Words as CAM output writes them. Run between 
+ *	blocks - it changes the point flags of the parser state.
+ */
+
+static const char *const _bench_words[] = {
+	"G1", "X12.3456", "Y-0.0625", "Z.5", "F1200", "M3", "S12000", "N12345", "I-3.25", "j 4.125", "G61.1"
+};
+
+uint32_t gc_bench_gcode_word(const uint8_t n)
+{
+	char *pstr = (char *)_bench_words[n % (sizeof(_bench_words) / sizeof(_bench_words[0]))];
+	char letter;
+	float value;
+
+	uint32_t start = hw_get_cycle_count();
+	_get_next_gcode_word(&pstr, &letter, &value);
+	uint32_t cycles = hw_get_cycle_count() - start;
+	bm_sink = value;
+	return (cycles);
+}
+
+#endif // __MICROBENCHMARKS
 
 /***********************************************************************************
  * CONFIGURATION AND INTERFACE FUNCTIONS
@@ -492,13 +1636,19 @@ static stat_t _execute_gcode_block()
 
 stat_t gc_get_gc(cmdObj_t *cmd)
 {
-	ritorno(cmd_copy_string(cmd, cs.in_buf));
+	ritorno(cmd_link_string(cmd, cs.in_buf));	// in_buf holds until the response is sent
 	cmd->objtype = TYPE_STRING;
 	return (STAT_OK);
 }
 
 stat_t gc_run_gc(cmdObj_t *cmd)
 {
+	if (cmd->objtype == TYPE_ARRAY) {		// several lines - see gc_batch_start()
+		return (gc_batch_start(*cmd->stringp, (uint8_t)cmd->value));
+	}
+	if ((cs.early_ack == true) && (controller_planner_ready() == false)) {	// read ahead and answered now
+		return (gc_read_ahead(*cmd->stringp));
+	}
 	return(gc_gcode_parser(*cmd->stringp));
 }
 
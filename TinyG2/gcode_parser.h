@@ -24,10 +24,91 @@
 extern "C"{
 #endif
 
+/* GCODE_READ_AHEAD_BLOCKS
+ *	Text mode Gcode lines are parsed ahead into up to this many blocks while the 
+ *	planner has no room for them, and run as buffers free up. See gc_read_ahead()
+ */
+#ifndef GCODE_READ_AHEAD_BLOCKS
+#define GCODE_READ_AHEAD_BLOCKS 4
+#endif
+
+/* GCODE_BATCH_LINES
+ *	Most lines a JSON mode {"gc":[...]} request can carry - see gc_batch_start()
+ */
+#ifndef GCODE_BATCH_LINES
+#define GCODE_BATCH_LINES 64
+#endif
+
+/* GCODE_SUBROUTINES, GCODE_SUBROUTINE_WORDS
+ *	O-word subroutine bodies are stored pre-parsed, one gcSubWord_t per word and one
+ *	more per block. These set how many subroutines and how many words can be stored
+ */
+#ifndef GCODE_SUBROUTINES
+#define GCODE_SUBROUTINES 8
+#endif
+#ifndef GCODE_SUBROUTINE_WORDS
+#define GCODE_SUBROUTINE_WORDS 512		// 8 bytes each
+#endif
+#ifndef GCODE_SUBROUTINE_CODE
+#define GCODE_SUBROUTINE_CODE 1024		// bytes of compiled expressions for all the bodies
+#endif
+
+/* GCODE_PARAMETERS, GCODE_BLOCK_SETTINGS, GCODE_EXPRESSION_BYTES, GCODE_EVAL_STACK
+ *	Numbered parameters run from #0 to GCODE_PARAMETERS-1, 4 bytes each. A block can
+ *	set up to GCODE_BLOCK_SETTINGS of them. A word's expression compiles to at most 
+ *	GCODE_EXPRESSION_BYTES of code (a number takes 5) and GCODE_EVAL_STACK values deep.
+ *	See Parameters and expressions in gcode_parser.cpp
+ */
+#ifndef GCODE_PARAMETERS
+#define GCODE_PARAMETERS 1000
+#endif
+#ifndef GCODE_BLOCK_SETTINGS
+#define GCODE_BLOCK_SETTINGS 16
+#endif
+#ifndef GCODE_EXPRESSION_BYTES
+#define GCODE_EXPRESSION_BYTES 128
+#endif
+#define GCODE_EVAL_STACK 16
+
+/* Pre-tokenized Gcode frames
+ *	A frame is a line holding '#', the base64 encoded word list, '*' and the decimal 
+ *	compute_checksum() of the base64 text, e.g. "#BgEXCg*7654" for G1X10. Each word is a header 
+ *	byte - the letter in the low 5 bits (0 = 'A') and the value format in the high 
+ *	3 bits - followed by the value in little endian order. See gc_binary_parser()
+ *	A line that starts with '#' but isn't in that form is a parameter setting (see 
+ *	gc_is_frame())
+ */
+#define GCODE_FRAME_CHAR '#'
+#ifndef GCODE_FRAME_BYTES
+#define GCODE_FRAME_BYTES 96		// max decoded word list length
+#endif
+
+enum gcFrameFormat {				// value formats for frame words
+	GC_FORMAT_INT8 = 0,				// 1 byte signed integer
+	GC_FORMAT_INT16,				// 2 byte signed integer
+	GC_FORMAT_TENTHS,				// 2 byte signed, value x 10 (e.g. 382 for G38.2)
+	GC_FORMAT_THOUSANDTHS,			// 3 byte signed, value x 1000
+	GC_FORMAT_FIXED,				// 4 byte signed, value x 10000
+	GC_FORMAT_FLOAT					// 4 byte IEEE 754 float
+};
+
 /*
  * Global Scope Functions
  */
 stat_t gc_gcode_parser(char_t *block);
+stat_t gc_binary_parser(char_t *frame);
+uint8_t gc_is_frame(const char_t *line);
+stat_t gc_read_ahead(char_t *block);
+stat_t gc_read_ahead_callback(void);
+stat_t gc_subroutine_callback(void);
+uint8_t gc_subroutine_defining(void);
+uint8_t gc_read_ahead_full(void);
+uint8_t gc_read_ahead_empty(void);
+void gc_flush_read_ahead(void);
+stat_t gc_batch_start(char_t *lines, uint8_t count);
+stat_t gc_batch_callback(void);
+uint8_t gc_batch_running(void);
+void gc_batch_cancel(void);
 stat_t gc_get_gc(cmdObj_t *cmd);
 stat_t gc_run_gc(cmdObj_t *cmd);
 
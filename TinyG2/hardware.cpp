@@ -34,6 +34,7 @@
 #include "hardware.h"
 #include "switch.h"
 #include "controller.h"
+#include "planner.h"
 #include "text_parser.h"
 
 #ifdef __cplusplus
@@ -46,9 +47,147 @@ extern "C"{
 
 void hardware_init()
 {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;	// enable the DWT unit
+	HW_DWT_CYCCNT = 0;
+	HW_DWT_CTRL |= HW_DWT_CTRL_CYCCNTENA;			// start the cycle counter
+	hw_timebase_init();
 	return;
 }
 
+/*
+ * Microsecond timebase and deadlines - see hardware.h
+ *
+ * hw_timebase_init()	  - start the timebase
+ * hw_deadline_start()	  - call func from the main loop usec from now
+ * hw_deadline_stop()	  - cancel a deadline (OK to call if it isn't armed)
+ * hw_deadline_callback() - run the deadlines that are due (called by controller)
+ * _deadline_rearm()	  - find the earliest deadline and set the wake up compare to it.
+ *						    Called with interrupts masked
+ */
+
+hwDeadlineSingleton_t dl;
+
+static void _deadline_rearm(void);
+
+#ifndef __SIM
+
+static Motate::Timer<timebase_clock_timer_num> timebase_clock;
+static Motate::Timer<timebase_timer_num> timebase_timer;
+
+void hw_timebase_init()
+{
+	timebase_clock.enablePeripheralClock();
+	timebase_timer.enablePeripheralClock();
+
+	TcChannel *clock = timebase_clock.tcChan();		// TIOA: set at RA, cleared at RC
+	clock->TC_CCR = TC_CCR_CLKDIS;
+	clock->TC_IDR = 0xFFFFFFFF;
+	clock->TC_CMR = TC_CMR_TCCLKS_TIMER_CLOCK1 | TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | 
+					TC_CMR_ACPA_SET | TC_CMR_ACPC_CLEAR;
+	clock->TC_RC = (F_CPU / 2) / HW_TIMEBASE_FREQ;
+	clock->TC_RA = clock->TC_RC / 2;
+
+	Tc *tc = timebase_timer.tc();					// timer 8 counts the clock's TIOA...
+	tc->TC_BMR = (tc->TC_BMR & ~TC_BMR_TC2XC2S_Msk) | TC_BMR_TC2XC2S_TIOA1;
+	TcChannel *count = timebase_timer.tcChan();		// ...up to 0xFFFFFFFF and around
+	count->TC_CCR = TC_CCR_CLKDIS;
+	count->TC_IDR = 0xFFFFFFFF;
+	count->TC_CMR = TC_CMR_TCCLKS_XC2 | TC_CMR_WAVE;
+	count->TC_SR;
+
+	count->TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+	clock->TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+	NVIC_EnableIRQ(timebase_timer.tcIRQ());
+}
+
+static void _set_wake_up(uint8_t armed, uint32_t when)
+{
+	TcChannel *count = timebase_timer.tcChan();
+	count->TC_IDR = TC_IDR_CPAS;
+	if (armed == false) { return;}
+	count->TC_RA = when;
+	count->TC_SR;									// drop a compare from the last deadline
+	count->TC_IER = TC_IER_CPAS;
+}
+
+#ifdef __cplusplus
+}	// the Motate interrupt is a C++ template specialization - it can't have C linkage
+#endif
+
+namespace Motate {			// Must define timer interrupts inside the Motate namespace
+template<> void Timer<timebase_timer_num>::interrupt()
+{
+	tcChan()->TC_IDR = TC_IDR_CPAS;					// one wake up per deadline - the loop does the rest
+	tcChan()->TC_SR;
+}
+} // namespace Motate
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#else // __SIM
+
+void hw_timebase_init() {}
+static void _set_wake_up(uint8_t armed, uint32_t when) {}
+
+#endif // __SIM
+
+void hw_deadline_start(uint8_t deadline, uint32_t usec, hwDeadlineFunc_t func)
+{
+	if (usec > HW_DEADLINE_MAX_USEC) { usec = HW_DEADLINE_MAX_USEC;}
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	dl.when[deadline] = hw_get_usec() + usec;
+	dl.func[deadline] = func;
+	dl.armed |= (1 << deadline);
+	_deadline_rearm();
+	__set_PRIMASK(primask);
+}
+
+void hw_deadline_stop(uint8_t deadline)
+{
+	if ((dl.armed & (1 << deadline)) == 0) { return;}
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	dl.armed &= ~(1 << deadline);
+	_deadline_rearm();
+	__set_PRIMASK(primask);
+}
+
+stat_t hw_deadline_callback()
+{
+	if (hw_deadline_due() == false) { return (STAT_NOOP);}
+
+	for (uint8_t i=0; i<HW_DEADLINES; i++) {
+		hwDeadlineFunc_t func = NULL;
+		__disable_irq();
+		if ((dl.armed & (1 << i)) && ((int32_t)(hw_get_usec() - dl.when[i]) >= 0)) {
+			dl.armed &= ~(1 << i);					// before the call, which may start it again
+			func = dl.func[i];
+		}
+		__enable_irq();
+		if (func != NULL) { func();}
+	}
+	__disable_irq();
+	_deadline_rearm();
+	__enable_irq();
+	return (STAT_OK);
+}
+
+static void _deadline_rearm()
+{
+	uint8_t first = true;
+	for (uint8_t i=0; i<HW_DEADLINES; i++) {
+		if ((dl.armed & (1 << i)) == 0) { continue;}
+		if ((first == true) || ((int32_t)(dl.when[i] - dl.next) < 0)) {
+			dl.next = dl.when[i];
+			first = false;
+		}
+	}
+	_set_wake_up((dl.armed != 0), dl.next);
+}
+
 /*
  * _get_id() - get a human readable signature
  *
@@ -67,7 +206,7 @@ void _get_id(char_t *id)
  * hw_hard_reset()			- hard reset using watchdog timer
  * hw_hard_reset_handler()	- controller's rest handler
  */
-void hw_request_hard_reset() { cs.hard_reset_requested = true; }
+void hw_request_hard_reset() { cs.hard_reset_requested = true; controller_set_ready(CTL_TASK_HARD_RESET);}
 
 void hw_hard_reset(void)			// software hard reset using the watchdog timer
 {
@@ -99,6 +238,97 @@ stat_t hw_bootloader_handler(void)
 	return (STAT_EAGAIN);				// never gets here but keeps the compiler happy
 }
 
+/*
+ * Interrupt priorities
+ *
+ * hw_set_irq_priorities() - apply a priority map - see hardware.h
+ *
+ *	Called once all the interrupts are set up, as Motate sets priorities of its own
+ *	when timers and USB are started. The default map is made from the IRQ_PRIORITY_xxx
+ *	settings. The others are only there to be measured against it by $jit.
+ */
+const IRQn_Type hw_irqn[HW_IRQS] = {		// in hwIrq order
+	(IRQn_Type)(TC0_IRQn + dda_timer_num),
+	(IRQn_Type)(TC0_IRQn + axis_timer_num),
+	(IRQn_Type)(TC0_IRQn + load_timer_num),
+	(IRQn_Type)(TC0_IRQn + exec_timer_num),
+	UOTGHS_IRQn,
+	SysTick_IRQn,
+	PIOA_IRQn,
+	PIOB_IRQn,
+	PIOC_IRQn,
+	PIOD_IRQn,
+	(IRQn_Type)(TC0_IRQn + timebase_timer_num),
+	CAN0_IRQn
+};
+
+static const uint8_t hw_irq_map[HW_IRQ_MAPS][HW_IRQS] = {	// in hwIrqMap order
+	{ IRQ_PRIORITY_DDA, IRQ_PRIORITY_DDA, IRQ_PRIORITY_LOAD, 
+	  IRQ_PRIORITY_EXEC, IRQ_PRIORITY_USB, IRQ_PRIORITY_SYSTICK,
+	  IRQ_PRIORITY_SWITCH, IRQ_PRIORITY_SWITCH, IRQ_PRIORITY_SWITCH, IRQ_PRIORITY_SWITCH,
+	  IRQ_PRIORITY_SYSTICK, IRQ_PRIORITY_USB },
+	{ 0, 0, 0, 0, 0, 15, 0, 0, 0, 0, 15, 0 },
+	{ 1, 1, 2, 3, 0, 15, 1, 1, 1, 1, 15, 0 }
+};
+
+void hw_set_irq_priorities(uint8_t map)
+{
+	if (map >= HW_IRQ_MAPS) { return;}
+	for (uint8_t i=0; i<HW_IRQS; i++) {
+		NVIC_SetPriority(hw_irqn[i], hw_irq_map[map][i]);
+	}
+}
+
+/*
+ * SRAM use - see hardware.h
+ *
+ * hw_paint_stack()		 - fill the unused SRAM below the stack with HW_STACK_PAINT
+ * hw_stack_assertions() - STAT_STACK_OVERFLOW once the stack has reached the statics
+ * _paint_end()			 - lowest word the stack has written to
+ *
+ *	hw_paint_stack() must not be inlined into main() - the paint stops at its own stack
+ *	pointer, so nothing below it may be live when it returns.
+ */
+const uint32_t hw_mem_pool[HW_MEM_POOLS] = {	// in hwMemPool order
+	sizeof(mb),
+	sizeof(cmdObj_t) * CMD_LIST_LEN,
+	sizeof(cmdStr),
+	sizeof(cs.in_buf) + sizeof(cs.out_buf) + sizeof(cs.saved_buf)
+};
+
+#ifndef __SIM
+
+extern uint32_t _end;					// end of the statics - see gcc_flash.ld
+extern uint32_t _estack;				// top of SRAM - the stack grows down from here
+
+void __attribute__((noinline)) hw_paint_stack()
+{
+	uint32_t *sp = (uint32_t *)__get_MSP();
+	for (uint32_t *p = &_end; p < sp; p++) { *p = HW_STACK_PAINT;}
+}
+
+stat_t hw_stack_assertions()
+{
+	for (uint8_t i=0; i<HW_STACK_GUARD; i++) {
+		if ((&_end)[i] != HW_STACK_PAINT) return (STAT_STACK_OVERFLOW);
+	}
+	return (STAT_OK);
+}
+
+static uint32_t *_paint_end()
+{
+	uint32_t *p = &_end;
+	while ((p < &_estack) && (*p == HW_STACK_PAINT)) { p++;}
+	return (p);
+}
+
+#else // __SIM
+
+void hw_paint_stack() {}
+stat_t hw_stack_assertions() { return (STAT_OK);}
+
+#endif // __SIM
+
 /***** END OF SYSTEM FUNCTIONS *****/
 
 
@@ -137,6 +367,49 @@ stat_t hw_set_hv(cmdObj_t *cmd)
 	return (STAT_OK);
 }
 
+/*
+ * hw_get_msh() - get the stack high-water mark in bytes
+ * hw_get_mfr() - get the free SRAM in bytes - never touched since boot
+ */
+stat_t hw_get_msh(cmdObj_t *cmd)
+{
+#ifndef __SIM
+	cmd->value = (float)((uint32_t)&_estack - (uint32_t)_paint_end());
+#else
+	cmd->value = 0;
+#endif
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t hw_get_mfr(cmdObj_t *cmd)
+{
+#ifndef __SIM
+	cmd->value = (float)((uint32_t)_paint_end() - (uint32_t)&_end);
+#else
+	cmd->value = 0;
+#endif
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+/*
+ * hw_boot_mark() - record the ms a boot phase finished at - see Boot timing in hardware.h
+ */
+uint32_t hw_boot[HW_BOOT_PHASES];
+
+void hw_boot_mark(uint8_t phase) { hw_boot[phase] = hw_get_usec() / 1000;}
+
+/*
+ * hw_get_irq() - get the priority an interrupt is running at - cfgArray target is its hw_irqn[] entry
+ */
+stat_t hw_get_irq(cmdObj_t *cmd)
+{
+	cmd->value = (float)NVIC_GetPriority(*(const IRQn_Type *)GET_TABLE_WORD(target));
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
 
 /***********************************************************************************
  * TEXT MODE SUPPORT
@@ -157,6 +430,58 @@ void hw_print_hp(cmdObj_t *cmd) { text_print_flt(cmd, fmt_hp);}
 void hw_print_hv(cmdObj_t *cmd) { text_print_flt(cmd, fmt_hv);}
 void hw_print_id(cmdObj_t *cmd) { text_print_str(cmd, fmt_id);}
 
+static const char msg_irq0[] PROGMEM = "DDA timer";	// in hwIrq order
+static const char msg_irq1[] PROGMEM = "axis timer";
+static const char msg_irq2[] PROGMEM = "load interrupt";
+static const char msg_irq3[] PROGMEM = "exec interrupt";
+static const char msg_irq4[] PROGMEM = "USB";
+static const char msg_irq5[] PROGMEM = "SysTick";
+static const char msg_irq6[] PROGMEM = "PIO A switches";
+static const char msg_irq7[] PROGMEM = "PIO B switches";
+static const char msg_irq8[] PROGMEM = "PIO C switches";
+static const char msg_irq9[] PROGMEM = "PIO D switches";
+static const char msg_irq10[] PROGMEM = "timebase deadline";
+static const char msg_irq11[] PROGMEM = "CAN";
+static const char *const msg_irq[] PROGMEM = { msg_irq0, msg_irq1, msg_irq2, msg_irq3, msg_irq4, msg_irq5, 
+											   msg_irq6, msg_irq7, msg_irq8, msg_irq9, msg_irq10, msg_irq11 };
+static const char fmt_irq[] PROGMEM = "[irq%s] %s priority%*d [0=highest]\n";
+
+void hw_print_irq(cmdObj_t *cmd)
+{
+	const char *name = (const char *)GET_TEXT_ITEM(msg_irq, (const IRQn_Type *)GET_TABLE_WORD(target) - hw_irqn);
+	fprintf_P(stderr, fmt_irq, cmd->token, name, (int)(25 - strlen(name)), (int)cmd->value);
+}
+
+static const char msg_mem0[] PROGMEM = "stack high-water mark";	// in cfgArray order
+static const char msg_mem1[] PROGMEM = "free SRAM";
+static const char msg_mem2[] PROGMEM = "planner buffer pool";
+static const char msg_mem3[] PROGMEM = "cmdObj list";
+static const char msg_mem4[] PROGMEM = "cmdObj string pool";
+static const char msg_mem5[] PROGMEM = "line buffers";
+static const char *const msg_mem[] PROGMEM = { msg_mem0, msg_mem1, msg_mem2, msg_mem3, msg_mem4, msg_mem5 };
+static const char fmt_mem[] PROGMEM = "[%s%s] %s%*lu bytes\n";
+
+void hw_print_mem(cmdObj_t *cmd)
+{
+	uint8_t i = cmd->index - cmd_get_index((const char_t *)"", (const char_t *)"memsh");
+	const char *name = (const char *)GET_TEXT_ITEM(msg_mem, i);
+	fprintf_P(stderr, fmt_mem, cmd->group, cmd->token, name, (int)(29 - strlen(name)), (unsigned long)cmd->value);
+}
+
+static const char msg_bt0[] PROGMEM = "boot hardware up";	// in hwBootPhase order
+static const char msg_bt1[] PROGMEM = "boot configs loaded";
+static const char msg_bt2[] PROGMEM = "boot init done";
+static const char msg_bt3[] PROGMEM = "host connected";
+static const char *const msg_bt[] PROGMEM = { msg_bt0, msg_bt1, msg_bt2, msg_bt3 };
+static const char fmt_bt[] PROGMEM = "[%s%s] %s%*lu ms\n";
+
+void hw_print_bt(cmdObj_t *cmd)
+{
+	uint8_t i = cmd->index - cmd_get_index((const char_t *)"", (const char_t *)"bthw");
+	const char *name = (const char *)GET_TEXT_ITEM(msg_bt, i);
+	fprintf_P(stderr, fmt_bt, cmd->group, cmd->token, name, (int)(30 - strlen(name)), (unsigned long)cmd->value);
+}
+
 #endif //__TEXT_MODE 
 
 #ifdef __cplusplus
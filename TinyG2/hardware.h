@@ -34,8 +34,8 @@
 /////// ARM VERSION ////////
 ////////////////////////////
 
-#include "motatePins.h"
-#include "motateTimers.h" // for Motate::timer_number
+#include "MotatePins.h"
+#include "MotateTimers.h" // for Motate::timer_number
 
 #ifdef __cplusplus
 extern "C"{
@@ -67,31 +67,207 @@ extern "C"{
 
 /* Interrupt usage and priority
  *
- * The following interrupts are defined w/indicated priorities
+ *	All interrupt priorities are set here and applied by hw_set_irq_priorities() once 
+ *	the peripherals are up - Motate's priority flags and defaults are not relied on.
+ *	0 is the highest priority. The SAM3X has 4 priority bits (levels 0 - 15).
  *
- *	 0	DDA_TIMER (3) for step pulse generation
- *	 1	DWELL_TIMER (4) for dwell timing
- *	 2	LOADER software generated interrupt (STIR / SGI)
- *	 3	Serial read character interrupt
- *	 4	EXEC software generated interrupt (STIR / SGI)
- *	 5	Serial write character interrupt  
+ *	  IRQ_PRIORITY_DDA		DDA and axis move timers - step pulse timing and dwells
+ *	  IRQ_PRIORITY_SWITCH	PIO change interrupts - limit and homing switches
+ *	  IRQ_PRIORITY_LOAD		loader software interrupt - loads the next segment
+ *	  IRQ_PRIORITY_EXEC		exec software interrupt - prepares the segment after that
+ *	  IRQ_PRIORITY_USB		USB controller, and the CAN controller (see can.h)
+ *	  IRQ_PRIORITY_SYSTICK	1 ms tick - serial RX fill and TX drain. Also the timebase
+ *							deadline compare, which only wakes the loop
+ *
+ *	Each must have a higher priority (lower number) than the next, which is checked at
+ *	compile time. The priorities in effect are reported at startup and read back with 
+ *	{"irq":""}. The other maps in hardware.cpp are only for comparison with $jit.
  */
+#ifndef IRQ_PRIORITY_DDA
+#define IRQ_PRIORITY_DDA		0
+#endif
+#ifndef IRQ_PRIORITY_SWITCH
+#define IRQ_PRIORITY_SWITCH		1
+#endif
+#ifndef IRQ_PRIORITY_LOAD
+#define IRQ_PRIORITY_LOAD		3
+#endif
+#ifndef IRQ_PRIORITY_EXEC
+#define IRQ_PRIORITY_EXEC		7
+#endif
+#ifndef IRQ_PRIORITY_USB
+#define IRQ_PRIORITY_USB		11
+#endif
+#ifndef IRQ_PRIORITY_SYSTICK
+#define IRQ_PRIORITY_SYSTICK	15
+#endif
+
+#if !((IRQ_PRIORITY_DDA >= 0) && (IRQ_PRIORITY_DDA < IRQ_PRIORITY_SWITCH) && \
+	  (IRQ_PRIORITY_SWITCH < IRQ_PRIORITY_LOAD) && \
+	  (IRQ_PRIORITY_LOAD < IRQ_PRIORITY_EXEC) && (IRQ_PRIORITY_EXEC < IRQ_PRIORITY_USB) && \
+	  (IRQ_PRIORITY_USB < IRQ_PRIORITY_SYSTICK) && (IRQ_PRIORITY_SYSTICK <= 15))
+#error "Interrupt priorities must run DDA > switch > load > exec > USB > SysTick, within 0 - 15"
+#endif
 
-/**** Stepper DDA and dwell timer settings ****/
+enum hwIrq {						// interrupts with a priority in the map
+	HW_IRQ_DDA = 0,
+	HW_IRQ_AXIS,
+	HW_IRQ_LOAD,
+	HW_IRQ_EXEC,
+	HW_IRQ_USB,
+	HW_IRQ_SYSTICK,
+	HW_IRQ_PIOA,					// switch ports
+	HW_IRQ_PIOB,
+	HW_IRQ_PIOC,
+	HW_IRQ_PIOD,
+	HW_IRQ_TIMEBASE,				// deadline wake up - see hw_deadline_start()
+	HW_IRQ_CAN,						// CAN bus - see can.h
+	HW_IRQS
+};
+
+enum hwIrqMap {						// priority maps - see hw_irq_map[]
+	HW_IRQ_MAP_DEFAULT = 0,			// the priorities above
+	HW_IRQ_MAP_MOTATE,				// as Motate left them - timers, USB and PIO all at 0
+	HW_IRQ_MAP_USB_FIRST,			// USB ahead of the stepper interrupts
+	HW_IRQ_MAPS
+};
+
+/**** Stepper DDA timer settings ****/
 
 //#define FREQUENCY_DDA		50000UL
 #define FREQUENCY_DDA		100000UL
-#define FREQUENCY_DWELL		1000UL
 #define FREQUENCY_SGI		200000UL		// 200,000 Hz means software interrupts will fire 5 uSec after being called
 
+/**** DWT cycle counter ****
+ *
+ *	The Cortex-M3 DWT CYCCNT register counts CPU clocks (F_CPU) and wraps every ~51 
+ *	seconds at 84 MHz. It is enabled in hardware_init(). Take differences of two 
+ *	readings as uint32_t and the wrap takes care of itself. Used for ISR timing.
+ */
+#ifndef __SIM									// the simulator counts simulated time - see platform/sim
+#define HW_DWT_CTRL				(*(volatile uint32_t *)0xE0001000UL)	// not in this version of CMSIS
+#define HW_DWT_CYCCNT			(*(volatile uint32_t *)0xE0001004UL)
+#endif
+#define HW_DWT_CTRL_CYCCNTENA	0x00000001UL
+
+#define hw_get_cycle_count() (HW_DWT_CYCCNT)
+
+/**** Microsecond timebase and deadlines ****
+ *
+ *	hw_get_usec() reads a free running 32 bit count of microseconds - one register 
+ *	read and no divide. It wraps every ~71 minutes, so take differences as int32_t, 
+ *	as with SysTick. Timer 7 divides MCK/2 down to a 1 MHz square wave on its TIOA 
+ *	(internal - the pin is left to the PIO) and timer 8 is clocked from it. 
+ *
+ *	Deadlines are one-shot timers on the timebase, one per user (see hwDeadline). 
+ *	hw_deadline_start() arms one for usec from now, and its function is called from 
+ *	the main loop once the time is up. hw_deadline_callback() only compares the 
+ *	earliest deadline on each pass, however many are armed, and timer 8's RA compare
+ *	is set to the same deadline so an idle loop sleeping in WFI wakes up on time, not
+ *	at the next SysTick. A deadline's function may start it again. Deadlines may be 
+ *	started and stopped from any interrupt level (the runtime requests status reports),
+ *	but the functions always run in the main loop. Times longer than 
+ *	HW_DEADLINE_MAX_USEC are cut to it - the user finds it is early and starts it again.
+ *
+ *	The simulator's timebase is simulated time. Deadlines are seen at the next segment
+ *	boundary or SysTick.
+ */
+#define HW_TIMEBASE_FREQ		1000000UL	// counts per second
+#define HW_DEADLINE_MAX_USEC	0x40000000UL// ~18 minutes - well inside the wrap
+#ifndef __SIM
+#define HW_TIMEBASE_CV			(TC2->TC_CHANNEL[2].TC_CV)	// timer 8
+#endif
+#define hw_get_usec() ((uint32_t)HW_TIMEBASE_CV)
+
+enum hwDeadline {					// deadline timers - one per user
+	HW_DEADLINE_STATUS_REPORT = 0,	// status report interval - report.cpp
+	HW_DEADLINE_QUEUE_REPORT,		// queue report holdoff - report.cpp
+	HW_DEADLINE_MOTOR_POWER,		// earliest motor idle timeout - stepper.cpp
+	HW_DEADLINE_SPINDLE,			// spindle spin-up - spindle.cpp
+	HW_DEADLINES
+};
+
+typedef void (*hwDeadlineFunc_t)(void);
+
+typedef struct hwDeadlineSingleton {
+	volatile uint8_t armed;			// a bit per hwDeadline
+	uint32_t next;					// earliest armed deadline (usec)
+	uint32_t when[HW_DEADLINES];	// deadlines (usec)
+	hwDeadlineFunc_t func[HW_DEADLINES];// called from hw_deadline_callback() when due
+} hwDeadlineSingleton_t;
+
+extern hwDeadlineSingleton_t dl;
+
+#define hw_deadline_due() ((dl.armed != 0) && ((int32_t)(hw_get_usec() - dl.next) >= 0))
+
+/**** SRAM use ****
+ *
+ *	main() calls hw_paint_stack() as soon as the clocks are up. It fills the SRAM from 
+ *	the end of the statics (_end - see gcc_flash.ld) up to the stack pointer with 
+ *	HW_STACK_PAINT. The interrupts run on the same stack, so the paint that is left 
+ *	is SRAM nothing has ever used, and the stack's high-water mark is where it stops:
+ *
+ *	  {"mem":n}	memsh	stack high-water mark in bytes - the deepest the stack has been
+ *				memfr	free SRAM in bytes - the paint left between the statics and that
+ *				memmb	planner buffer pool (mb) - in SRAM1, not counted in memfr
+ *				memcl	cmdObj list (cmd_list)
+ *				memcs	cmdObj string pool (cmdStr)
+ *				memib	controller line buffers (cs.in_buf, out_buf and saved_buf)
+ *
+ *	memsh and memfr scan the paint, so they are only worked out when asked for. The 
+ *	system assertions check the HW_STACK_GUARD words just above the statics and alarm 
+ *	with STAT_STACK_OVERFLOW once the stack has reached them. The simulator has no SRAM 
+ *	of its own - memsh and memfr read 0 and the pool sizes are the host's.
+ *
+ *	The link prints the SRAM budget of the image and the largest statics, and warns 
+ *	if less than STACK_MIN bytes are left for the stack - see memory_budget.awk. The 
+ *	statics and the stack are in SRAM0; SRAM1 holds the SRAM_DMA statics (tinyg2.h).
+ */
+#define HW_STACK_PAINT			0xC5C5C5C5UL	// not a valid address or a likely value
+#define HW_STACK_GUARD			8				// words at the bottom of the paint checked by the assertions
+
+enum hwMemPool {					// static pools reported by $mem - see hw_mem_pool[]
+	HW_MEM_PLANNER = 0,
+	HW_MEM_CMD_LIST,
+	HW_MEM_CMD_STRINGS,
+	HW_MEM_LINE_BUFFERS,
+	HW_MEM_POOLS
+};
+
+/**** Boot timing ****
+ *
+ *	main() attaches USB and goes straight on to the application init, so the host 
+ *	enumerates the board while the hardware, configs and planner come up. SYSTEM READY
+ *	goes out once both are done - the controller sends it from the main loop, which 
+ *	starts after the init, when it sees the host connected. The phases are marked in 
+ *	ms of the timebase, which hardware_init() starts, and the startup messages carry 
+ *	the ones reached so far:
+ *
+ *	  {"bt":n}	bthw	hardware up
+ *				btcf	configs loaded
+ *				btin	planner, machine and steppers up - the init is done
+ *				btcn	host connected (the last time it connected)
+ */
+enum hwBootPhase {					// boot phases - see hw_boot[]
+	HW_BOOT_HARDWARE = 0,
+	HW_BOOT_CONFIG,
+	HW_BOOT_INIT,
+	HW_BOOT_CONNECT,
+	HW_BOOT_PHASES
+};
+
 /**** Motate Definitions ****/
 
 // Timer definitions. See stepper.h and other headers for setup
 
+Motate::timer_number servo_timer_num = 0;	// DAC sample clock in servo.cpp - TIOA0 triggers the DACC, the pin isn't used
 Motate::timer_number dda_timer_num   = 2;	// stepper pulse generation in stepper.cpp
-Motate::timer_number dwell_timer_num = 3;	// dwell timing in stepper.cpp
+// timer 3 is free - dwells run on the DDA timer (see st_prep_dwell())
 Motate::timer_number load_timer_num  = 4;	// request load timer in stepper.cpp
 Motate::timer_number exec_timer_num  = 5;	// request exec timer in stepper.cpp
+Motate::timer_number axis_timer_num  = 6;	// axis move engine in stepper.cpp
+Motate::timer_number timebase_clock_timer_num = 7;	// 1 MHz clock for the timebase in hardware.cpp
+Motate::timer_number timebase_timer_num = 8;	// microsecond timebase and deadlines in hardware.cpp
 
 // Pin assignments
 
@@ -118,9 +294,30 @@ Motate::pin_number grbl_cycle_start_pin_num = 56;
 Motate::pin_number motor_common_enable_pin_num = 8;
 Motate::pin_number spindle_enable_pin_num = 12;
 Motate::pin_number spindle_dir_pin_num	  = 13;
-Motate::pin_number spindle_pwm_pin_num	  = 11;
-Motate::pin_number secondary_pwm_pin_num  = 9;
+Motate::pin_number spindle_pwm_pin_num	  = 9;		// PC21 - PWML4 on peripheral B
+Motate::pin_number secondary_pwm_pin_num  = 11;		// PD7 - no PWM controller output
 Motate::pin_number coolant_enable_pin_num = 57;
+Motate::pin_number spindle_index_pin_num  = 70;		// PA17 - SDA1. Spindle tach - see spindle.h
+
+// digital outputs switched in step with the motion - M62, M63 (see st_set_outputs())
+#define DIGITAL_OUTPUTS 4
+Motate::pin_number output_1_pin_num = 71;			// PA18 - SCL1
+Motate::pin_number output_2_pin_num = 72;			// PC30 - RX LED
+Motate::pin_number output_3_pin_num = 73;			// PA21 - TX LED
+Motate::pin_number output_4_pin_num = 78;			// PB23
+
+// emergency stop input - see "Emergency stop" in switch.h
+Motate::pin_number estop_pin_num = 74;				// PA25 - SPI MISO on the ICSP header. Not with the file device, see xio_file.h
+#define ESTOP_PWM_FAULT -1							// PWM fault input on estop_pin_num: 0=PA5, 1=PA3, 2=PD6. -1 if none
+
+// encoder phase inputs - see encoder.h. Both must be on one port
+Motate::pin_number encoder_a_pin_num = 69;			// PA0 - CANTX
+Motate::pin_number encoder_b_pin_num = 68;			// PA1 - CANRX
+
+// PWM controller channels driving the PWM pins, -1 if the pin has none.
+// Channels 0 - 3 carry the motor vref pins and are not used for PWM outputs
+#define SPINDLE_PWM_CHANNEL 4
+#define SECONDARY_PWM_CHANNEL -1
 
 // axes
 Motate::pin_number axis_X_min_pin_num = 14;
@@ -216,6 +413,20 @@ Motate::pin_number motor_6_microstep_1_pin_num	= -1;
 Motate::pin_number motor_6_vref_pin_num			= -1;
 #endif
 
+/* Motor current
+ *	The vref pins of motors 1 - 4 are PWML0 - PWML3 of the PWM controller (peripheral B)
+ *	and set the driver current as a filtered PWM (see st_set_motor_power()). Motor 5 is
+ *	on PWMH3, the complement of motor 4's channel, and motor 6 shares PWML0 with motor 1,
+ *	so their current can't be set independently and their vref pins are not driven (-1).
+ */
+#define MOTOR_1_VREF_CHANNEL 0
+#define MOTOR_2_VREF_CHANNEL 1
+#define MOTOR_3_VREF_CHANNEL 2
+#define MOTOR_4_VREF_CHANNEL 3
+#define MOTOR_5_VREF_CHANNEL -1
+#define MOTOR_6_VREF_CHANNEL -1
+#define VREF_PWM_FREQUENCY 25000		// Hz - well above the corner of the vref filters
+
 /**** Motate Global Pin Allocations ****/
 
 static Motate::OutputPin<spi_ss1_pin_num> spi_ss1_pin;
@@ -237,6 +448,11 @@ static Motate::OutputPin<spindle_pwm_pin_num> spindle_pwm_pin;
 static Motate::OutputPin<secondary_pwm_pin_num> secondary_pwm_pin;
 static Motate::OutputPin<coolant_enable_pin_num> coolant_enable_pin;
 
+static Motate::OutputPin<output_1_pin_num> output_1_pin;
+static Motate::OutputPin<output_2_pin_num> output_2_pin;
+static Motate::OutputPin<output_3_pin_num> output_3_pin;
+static Motate::OutputPin<output_4_pin_num> output_4_pin;
+
 static Motate::InputPin<axis_X_min_pin_num> axis_X_min_pin(Motate::kPullUp);
 static Motate::InputPin<axis_X_max_pin_num> axis_X_max_pin(Motate::kPullUp);
 static Motate::InputPin<axis_Y_min_pin_num> axis_Y_min_pin(Motate::kPullUp);
@@ -251,6 +467,8 @@ static Motate::InputPin<axis_B_max_pin_num> axis_B_max_pin(Motate::kPullUp);
 static Motate::InputPin<axis_C_min_pin_num> axis_C_min_pin(Motate::kPullUp);
 static Motate::InputPin<axis_C_max_pin_num> axis_C_max_pin(Motate::kPullUp);
 
+static Motate::InputPin<estop_pin_num> estop_pin(Motate::kPullUp);
+
 /*** function prototypes ***/
 
 void hardware_init(void);			// master hardware init
@@ -265,6 +483,24 @@ stat_t hw_run_boot(cmdObj_t *cmd);
 stat_t hw_set_hv(cmdObj_t *cmd);
 stat_t hw_get_id(cmdObj_t *cmd);
 
+void hw_timebase_init(void);
+void hw_deadline_start(uint8_t deadline, uint32_t usec, hwDeadlineFunc_t func);
+void hw_deadline_stop(uint8_t deadline);
+stat_t hw_deadline_callback(void);
+
+extern const IRQn_Type hw_irqn[HW_IRQS];
+void hw_set_irq_priorities(uint8_t map);
+stat_t hw_get_irq(cmdObj_t *cmd);
+
+extern const uint32_t hw_mem_pool[HW_MEM_POOLS];
+void hw_paint_stack(void);
+stat_t hw_stack_assertions(void);
+stat_t hw_get_msh(cmdObj_t *cmd);
+stat_t hw_get_mfr(cmdObj_t *cmd);
+
+extern uint32_t hw_boot[HW_BOOT_PHASES];
+void hw_boot_mark(uint8_t phase);
+
 #ifdef __TEXT_MODE
 
 	void hw_print_fb(cmdObj_t *cmd);
@@ -272,6 +508,9 @@ stat_t hw_get_id(cmdObj_t *cmd);
 	void hw_print_hp(cmdObj_t *cmd);
 	void hw_print_hv(cmdObj_t *cmd);
 	void hw_print_id(cmdObj_t *cmd);
+	void hw_print_irq(cmdObj_t *cmd);
+	void hw_print_mem(cmdObj_t *cmd);
+	void hw_print_bt(cmdObj_t *cmd);
 
 #else
 
@@ -280,6 +519,9 @@ stat_t hw_get_id(cmdObj_t *cmd);
 	#define hw_print_hp tx_print_stub
 	#define hw_print_hv tx_print_stub
 	#define hw_print_id tx_print_stub
+	#define hw_print_irq tx_print_stub
+	#define hw_print_mem tx_print_stub
+	#define hw_print_bt tx_print_stub
 
 #endif // __TEXT_MODE
 
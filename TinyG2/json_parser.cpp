@@ -32,6 +32,8 @@
 #include "text_parser.h"
 #include "canonical_machine.h"
 #include "report.h"
+#include "planner.h"
+#include "gcode_parser.h"
 #include "util.h"
 #include "xio.h"					// for char definitions
 
@@ -45,15 +47,19 @@ jsSingleton_t js;
 
 /**** local scope stuff ****/
 
-static stat_t _json_parser_kernal(char_t *str);
-static stat_t _get_nv_pair_strict(cmdObj_t *cmd, char_t **pstr, int8_t *depth);
-static stat_t _normalize_json_string(char_t *str, uint16_t size);
+static stat_t _json_parser_kernal(char_t **pstr, uint8_t *more);
+static stat_t _json_parser_stream(char_t **pstr, stat_t status);
+static cmdObj_t *_json_filter_response_body(void);
+static uint8_t _json_terse_response(uint8_t status);
+static stat_t _get_nv_pair(cmdObj_t *cmd, char_t **pstr, int8_t *depth);
+static stat_t _get_json_number(char_t **pstr, float *value);
 
 /****************************************************************************
  * json_parser() - exposed part of JSON parser
  * _json_parser_kernal()
- * _normalize_json_string()
- * _get_nv_pair_strict()
+ * _json_parser_stream()
+ * _get_nv_pair()
+ * _get_json_number()
  *
  *	This is a dumbed down JSON parser to fit in limited memory with no malloc
  *	or practical way to do recursion ("depth" tracks parent/child levels).
@@ -65,6 +71,7 @@ static stat_t _normalize_json_string(char_t *str, uint16_t size);
  *	  {"parent_name":""}
  *	  {"parent_name":{"name":"value"}}
  *	  {"parent_name":{"name1":"value1", "n2":"v2", ... "nN":"vN"}}
+ *	  {"name1":"value1", "parent_name":{"name":"value"}, ... "nN":"vN"}
  *
  *	  "value" can be a string, number, true, false, or null (2 types)
  *
@@ -74,12 +81,28 @@ static stat_t _normalize_json_string(char_t *str, uint16_t size);
  *	  - exponentiated numbers are handled OK. 
  *	  - hexadecimal or other non-decimal number bases are not supported
  *
+ *	Names are converted to lower case. White space is allowed anywhere outside of 
+ *	names and strings. String values are taken as is - they are terminated in place
+ *	in the input buffer and referenced from there, not copied, so the input must not
+ *	be reused until the command has been run and its response sent.
+ *
  *	The parser:
  *	  - extracts an array of one or more JSON object structs from the input string
  *	  - once the array is built it executes the object(s) in order in the array
  *	  - passes the executed array to the response handler to generate the response string
  *	  - returns the status and the JSON response string
  *
+ *	Top level items are parsed and run one at a time. If an input has more than one 
+ *	(e.g. {"xvm":16000,"yvm":16000,"z":""}) each item is run and its part of the 
+ *	response is sent before the next is parsed, so the cmdObj list and the output
+ *	buffer only have to hold the largest single item - see _json_parser_stream().
+ *	The response is the same single {"r":{...},"f":[...]} it would be otherwise.
+ *	Processing stops at the first item that fails; its status goes in the footer.
+ *
+ *	Arrays are only taken for Gcode, as an array of lines: {"gc":["g1x10f600","g1y10"]}.
+ *	The strings are packed one after another in place and the batch answers for 
+ *	itself once its lines have run, so it must be the only item - see gc_batch_start().
+ *
  *	Separation of concerns
  *	  json_parser() is the only exposed part. It does parsing, display, and status reports.
  *	  _get_nv_pair() only does parsing and syntax; no semantic validation or group handling
@@ -89,25 +112,47 @@ static stat_t _normalize_json_string(char_t *str, uint16_t size);
 
 void json_parser(char_t *str)
 {
-	stat_t status = _json_parser_kernal(str);
-	cmd_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
+	stat_t status = STAT_INPUT_EXCEEDS_MAX_LENGTH;
+	uint8_t more = false;
+
+	if (strlen(str) <= JSON_OUTPUT_STRING_MAX) { 
+		status = _json_parser_kernal(&str, &more);
+	}
+	if (gc_batch_running() == true) {				// a batch answers when its lines have run...
+		if (more == false) { return;}
+		gc_batch_cancel();							// ...but must be the only item
+		status = STAT_INPUT_VALUE_UNSUPPORTED;
+		more = false;
+	}
+	if (more == true) {
+		_json_parser_stream(&str, status);			// multiple items - prints its own response
+	} else {
+		cmd_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
+	}
 	sr_request_status_report(SR_IMMEDIATE_REQUEST); // generate incremental status report to show any changes
 }
 
-static stat_t _json_parser_kernal(char_t *str)
+/*
+ * _json_parser_kernal() - parse and run the next top level item
+ *
+ *	Parses one item - a name-value pair or a parent and its children - from *pstr 
+ *	into a fresh cmdObj list and runs it. Sets more true if another item follows, 
+ *	leaving *pstr at its start.
+ */
+static stat_t _json_parser_kernal(char_t **pstr, uint8_t *more)
 {
 	stat_t status;
-	int8_t depth;
+	int8_t depth = 1;								// items start at the top level of the object
 	cmdObj_t *cmd = cmd_reset_list();				// get a fresh cmdObj list
 	char_t group[CMD_GROUP_LEN+1] = {""};			// group identifier - starts as NUL
 	int8_t i = CMD_BODY_LEN;
 
-	ritorno(_normalize_json_string(str, JSON_OUTPUT_STRING_MAX));	// return if error
+	*more = false;
 
 	// parse the JSON command into the cmd body
 	do {
 		if (--i == 0) { return (STAT_JSON_TOO_MANY_PAIRS); } // length error
-		if ((status = _get_nv_pair_strict(cmd, &str, &depth)) > STAT_EAGAIN) { // erred out
+		if ((status = _get_nv_pair(cmd, pstr, &depth)) > STAT_EAGAIN) { // erred out
 			return (status);
 		}
 		// propagate the group from previous NV pair (if relevant)
@@ -118,9 +163,17 @@ static stat_t _json_parser_kernal(char_t *str)
 		if ((cmd->index = cmd_get_index(cmd->group, cmd->token)) == NO_MATCH) {
 			return (STAT_UNRECOGNIZED_COMMAND);
 		}
+		if ((cmd->objtype == TYPE_ARRAY) && (cmd_get_type(cmd) != CMD_TYPE_GCODE)) {
+			return (STAT_INPUT_VALUE_UNSUPPORTED);	// only Gcode takes an array
+		}
 		if ((cmd_index_is_group(cmd->index)) && (cmd_group_is_prefixed(cmd->token))) {
 			strncpy(group, cmd->token, CMD_GROUP_LEN);// record the group ID
 		}
+		if (cmd->objtype == TYPE_PARENT) { depth++;}
+		else if ((status == STAT_EAGAIN) && (depth == 1)) {	// item is complete and another follows
+			*more = true;
+			status = STAT_OK;
+		}
 		if ((cmd = cmd->nx) == NULL) return (STAT_JSON_TOO_MANY_PAIRS);// Not supposed to encounter a NULL
 	} while (status != STAT_OK);					// breaks when parsing is complete
 
@@ -136,130 +189,265 @@ static stat_t _json_parser_kernal(char_t *str)
 }
 
 /*
- * _normalize_json_string - normalize a JSON string in place
+ * _json_parser_stream() - run the remaining items of a multi-item input
  *
- *	Validate string size limits, remove all whitespace and convert 
- *	to lower case, with the exception of gcode comments
+ *	Called with the first item already run. Each item's body is filtered and 
+ *	serialized as in json_print_response(), stripped of its enclosing curlies and 
+ *	sent as the next piece of the "r" object. The footer checksum is accumulated 
+ *	over the pieces as they go out. Returns the status reported in the footer.
  */
+static uint32_t _stream_hash;
 
-static stat_t _normalize_json_string(char_t *str, uint16_t size)
+static void _json_stream_write(const char_t *str, uint16_t length)	// length 0 is the whole string
 {
-	char_t *wr;								// write pointer
-	uint8_t in_comment = false;
-
-	if (strlen(str) > size) return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
-
-	for (wr = str; *str != NUL; str++) {
-		if (!in_comment) {					// normal processing
-			if (*str == '(') in_comment = true;
-			if ((*str <= ' ') || (*str == DEL)) continue; // toss ctrls, WS & DEL
-			*wr++ = tolower(*str);
-		} else {							// Gcode comment processing	
-			if (*str == ')') in_comment = false;
-			*wr++ = *str;
+	if (length == 0) { length = strlen((const char *)str);}
+	_stream_hash = checksum_accumulate(_stream_hash, str, length);
+	fprintf(stderr, "%.*s", (int)length, (char *)str);
+}
+
+/*
+ * _json_footer_values() - write the footer array, less its checksum, into buf
+ *
+ *	Style 1 is [1,status,bytes,...] where bytes is the length of the line that was
+ *	consumed. Style 2 adds the free space in the rx ring and the free planner buffers
+ *	at the time of the response, [2,status,bytes,rx_free,planner_free,...], so a host
+ *	can stream by counting characters instead of waiting for each response:
+ *	keep sending while the bytes in flight fit in the last rx_free reported.
+ *	Queue reports in footer mode ($qv=3) send style 2 regardless of $fs.
+ */
+static void _json_footer_values(char_t *buf, stat_t status)
+{
+	if ((js.json_footer_style == FOOTER_REVISION_FLOW) || (qr.queue_report_verbosity == QR_FOOTER)) {
+		sprintf((char *)buf, "%d,%d,%d,%d,%d", FOOTER_REVISION_FLOW, status, cs.linelen,
+				xio_get_rx_free(), mp_get_planner_buffers_available());
+	} else {
+		sprintf((char *)buf, "%d,%d,%d", FOOTER_REVISION, status, cs.linelen);
+	}
+	cs.linelen = 0;									// reset linelen so it's only reported once
+}
+
+static stat_t _json_parser_stream(char_t **pstr, stat_t status)
+{
+	uint8_t more = true;
+	uint8_t need_a_comma = false;
+
+	_stream_hash = 0;
+	if (js.json_verbosity != JV_SILENT) { _json_stream_write((const char_t *)"{\"r\":{", 0);}
+
+	while (true) {
+		if ((status != STAT_OK) && (status != STAT_NOOP) && (status != STAT_EAGAIN)) { break;}
+		if (js.json_verbosity != JV_SILENT) {
+			_json_filter_response_body();
+			int16_t length = json_serialize(cmd_body, cs.out_buf, sizeof(cs.out_buf));
+			if (length < 0) { status = STAT_BUFFER_FULL; break;}	// this item alone overruns the output buffer
+			if (length > 3) {						// skip items that filtered down to nothing - "{}\n"
+				if (need_a_comma) { _json_stream_write((const char_t *)",", 0);}
+				_json_stream_write(cs.out_buf+1, length-3);	// strip the curlies and the newline
+				need_a_comma = true;
+			}
+		}
+		if (more == false) { break;}
+		status = _json_parser_kernal(pstr, &more);
+		if (gc_batch_running() == true) {			// a batch must be the only item
+			gc_batch_cancel();
+			status = STAT_INPUT_VALUE_UNSUPPORTED;
 		}
 	}
-	*wr = NUL;
-	return (STAT_OK);
+	if (js.json_verbosity == JV_SILENT) { return (status);}
+
+	char_t footer[CMD_FOOTER_LEN];
+	_json_footer_values(footer, status);
+	_json_stream_write((const char_t *)((js.json_footer_depth == 0) ? "},\"f\":[" : ",\"f\":["), 0);
+	_json_stream_write(footer, 0);
+	fprintf(stderr, (js.json_footer_depth == 0) ? ",%d]}\n" : ",%d]}}\n", checksum_finish(_stream_hash));
+	return (status);
 }
 
 /*
- * _get_nv_pair_strict() - get the next name-value pair w/strict JSON rules
+ * _get_nv_pair() - get the next name-value pair
  *
- *	Parse the next statement and populate the command object (cmdObj).
+ *	Parse the next statement straight from the input and populate the command 
+ *	object (cmdObj). The input is read once, front to back. 
  *
  *	Leaves string pointer (str) on the first character following the object.
  *	Which is the character just past the ',' separator if it's a multi-valued 
- *	object or the terminating NUL if single object or the last in a multi.
+ *	object or the character after the last closing curly if single object or 
+ *	the last in a multi.
  *
  *	Keeps track of tree depth and closing braces as much as it has to.
  *	If this were to be extended to track multiple parents or more than two
  *	levels deep it would have to track closing curlies - which it does not.
  *
- *	ASSUMES INPUT STRING HAS FIRST BEEN NORMALIZED BY _normalize_json_string()
- *
  *	If a group prefix is passed in it will be pre-pended to any name parsed
  *	to form a token string. For example, if "x" is provided as a group and 
  *	"fr" is found in the name string the parser will search for "xfr" in the 
  *	cfgArray.
  */
-static stat_t _get_nv_pair_strict(cmdObj_t *cmd, char_t **pstr, int8_t *depth)
+#define _is_json_space(c) ((c <= ' ') || (c == DEL))	// also skips control characters
+#define _skip_json_space(p) for (; (*p != NUL) && _is_json_space(*p); p++)
+
+static stat_t _get_nv_pair(cmdObj_t *cmd, char_t **pstr, int8_t *depth)
 {
-	char_t *tmp;
-	char_t terminators[] = {"},"};
+	char_t *rd = *pstr;
+	uint8_t i = 0;
 
 	cmd_reset_obj(cmd);							// wipes the object and sets the depth
 
 	// --- Process name part ---
-	// find leading and trailing name quotes and set pointers.
-	if ((*pstr = strchr(*pstr, '\"')) == NULL) { return (STAT_JSON_SYNTAX_ERROR);}
-	if ((tmp = strchr(++(*pstr), '\"')) == NULL) { return (STAT_JSON_SYNTAX_ERROR);}
-	*tmp = NUL;
-	strncpy(cmd->token, *pstr, CMD_TOKEN_LEN);	// copy the string to the token
+	// skip the opening curly of the first pair, then copy the name to the token
+	_skip_json_space(rd);
+	if (*rd == '{') { rd++; _skip_json_space(rd);}
+	if (*rd++ != '\"') { return (STAT_JSON_SYNTAX_ERROR);}
+	for (; *rd != '\"'; rd++) {
+		if (*rd == NUL) { return (STAT_JSON_SYNTAX_ERROR);}
+		if (i < CMD_TOKEN_LEN) { cmd->token[i++] = tolower(*rd);}	// longer names are truncated
+	}
+	cmd->token[i] = NUL;
+	rd++;
+	_skip_json_space(rd);
+	if (*rd++ != ':') { return (STAT_JSON_SYNTAX_ERROR);}
+	_skip_json_space(rd);
 
 	// --- Process value part ---  (organized from most to least frequently encountered)
-	*pstr = ++tmp;
-	if ((*pstr = strchr(*pstr, ':')) == NULL) return (STAT_JSON_SYNTAX_ERROR);
-	(*pstr)++;									// advance to start of value field
-
 	// nulls (gets)
-	if ((**pstr == 'n') || ((**pstr == '\"') && (*(*pstr+1) == '\"'))) { // process null value
+	if ((tolower(*rd) == 'n') || ((*rd == '\"') && (*(rd+1) == '\"'))) { // process null value
 		cmd->objtype = TYPE_NULL;
 		cmd->value = TYPE_NULL;
-	
+		rd += (*rd == '\"') ? 2 : 1;
+
 	// numbers
-	} else if (isdigit(**pstr) || (**pstr == '-')) {// value is a number
-		cmd->value = strtof(*pstr, &tmp);			// tmp is the end pointer
-		if(tmp == *pstr) { return (STAT_BAD_NUMBER_FORMAT);}
+	} else if (isdigit(*rd) || (*rd == '-')) {	// value is a number
+		ritorno(_get_json_number(&rd, &cmd->value));
 		cmd->objtype = TYPE_FLOAT;
 
 	// object parent
-	} else if (**pstr == '{') { 
+	} else if (*rd == '{') { 
 		cmd->objtype = TYPE_PARENT;
 //		*depth += 1;							// cmd_reset_obj() sets the next object's level so this is redundant
-		(*pstr)++;
+		*pstr = ++rd;
 		return(STAT_EAGAIN);					// signal that there is more to parse
 
 	// strings
-	} else if (**pstr == '\"') { 				// value is a string
-		(*pstr)++;
+	} else if (*rd == '\"') { 					// value is a string
 		cmd->objtype = TYPE_STRING;
-		if ((tmp = strchr(*pstr, '\"')) == NULL) { return (STAT_JSON_SYNTAX_ERROR);} // find the end of the string
-		*tmp = NUL;
-		ritorno(cmd_copy_string(cmd, *pstr));
-		*pstr = ++tmp;
+		cmd->stringp = (char_t (*)[])++rd;		// referenced in place
+		for (; *rd != '\"'; rd++) {				// find the end of the string
+			if (*rd == NUL) { return (STAT_JSON_SYNTAX_ERROR);}
+		}
+		*rd++ = NUL;
 
 	// boolean true/false
-	} else if (**pstr == 't') { 
+	} else if (tolower(*rd) == 't') { 
 		cmd->objtype = TYPE_BOOL;
 		cmd->value = true;
-	} else if (**pstr == 'f') { 
+	} else if (tolower(*rd) == 'f') { 
 		cmd->objtype = TYPE_BOOL;
 		cmd->value = false;
 
-	// arrays
-	} else if (**pstr == '[') {
+	// arrays - of strings only. They are packed in place, each NUL terminated, and 
+	// value is how many there are (see gc_batch_start())
+	} else if (*rd == '[') {
 		cmd->objtype = TYPE_ARRAY;
-		ritorno(cmd_copy_string(cmd, *pstr));	// copy array into string for error displays
-		return (STAT_INPUT_VALUE_UNSUPPORTED);	// return error as the parser doesn't do input arrays yet
+		char_t *wr = ++rd;
+		cmd->stringp = (char_t (*)[])wr;
+		_skip_json_space(rd);
+		while (*rd != ']') {
+			if (*rd++ != '\"') { *wr = NUL; return (STAT_INPUT_VALUE_UNSUPPORTED);}	// not a string
+			for (; *rd != '\"'; rd++) {
+				if (*rd == NUL) { return (STAT_JSON_SYNTAX_ERROR);}
+				*wr++ = *rd;
+			}
+			*wr++ = NUL;						// at most over the closing quote
+			cmd->value++;
+			rd++;
+			_skip_json_space(rd);
+			if (*rd == ',') { rd++; _skip_json_space(rd);}
+			else if (*rd != ']') { return (STAT_JSON_SYNTAX_ERROR);}
+		}
+		*wr = NUL;								// an empty array is an empty string
+		rd++;
 
 	// general error condition
 	} else { return (STAT_JSON_SYNTAX_ERROR); }	// ill-formed JSON
 
-	// process comma separators and end curlies
-	if ((*pstr = strpbrk(*pstr, terminators)) == NULL) { // advance to terminator or err out
-		return (STAT_JSON_SYNTAX_ERROR);
+	// process comma separators and end curlies (skips the rest of a true, false or null)
+	for (; (*rd != '}') && (*rd != ','); rd++) {
+		if (*rd == NUL) { return (STAT_JSON_SYNTAX_ERROR);}
 	}
-	if (**pstr == '}') { 
+	if (*rd == '}') { 
 		*depth -= 1;							// pop up a nesting level
-		(*pstr)++;								// advance to comma or whatever follows
+		rd++;									// advance to comma or whatever follows
+		_skip_json_space(rd);
 	}
-	if (**pstr == ',') { return (STAT_EAGAIN);}	// signal that there is more to parse
-
-	(*pstr)++;
+	if (*rd == ',') {
+		*pstr = ++rd;
+		return (STAT_EAGAIN);					// signal that there is more to parse
+	}
+	*pstr = rd;
 	return (STAT_OK);							// signal that parsing is complete
 }
 
+/*
+ * _get_json_number() - read a JSON number: -?digits[.digits][(e|E)[+|-]digits]
+ *
+ *	Used instead of strtof(), which is slow in soft float. The digits are collected
+ *	into an integer mantissa (the first 9 significant digits) and scaled by a power 
+ *	of ten in one step, as in the Gcode parser.
+ */
+#define JSON_MANTISSA_LIMIT 100000000	// collect digits while the mantissa is below this
+
+static const float _json_pow10[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10 };
+
+static stat_t _get_json_number(char_t **pstr, float *value)
+{
+	char_t *rd = *pstr;
+	uint8_t negative = false;
+	if (*rd == '-') { negative = true; rd++;}
+
+	uint32_t mantissa = 0;
+	int16_t exponent = 0;					// power of ten to apply to the mantissa
+	uint8_t digits = 0;
+
+	for (; isdigit(*rd); rd++, digits++) {
+		if (mantissa < JSON_MANTISSA_LIMIT) { mantissa = mantissa*10 + (*rd - '0');}
+		else { exponent++;}					// drop digits past the float's precision
+	}
+	if (*rd == '.') {
+		for (rd++; isdigit(*rd); rd++, digits++) {
+			if (mantissa < JSON_MANTISSA_LIMIT) {
+				mantissa = mantissa*10 + (*rd - '0');
+				exponent--;
+			}
+		}
+	}
+	if (digits == 0) { return (STAT_BAD_NUMBER_FORMAT);}
+
+	if ((*rd == 'e') || (*rd == 'E')) {		// exponent - only taken if it has digits
+		char_t *ex = rd+1;
+		int8_t sign = 1;
+		int16_t e = 0;
+		if (*ex == '-') { sign = -1; ex++;}
+		else if (*ex == '+') { ex++;}
+		if (isdigit(*ex)) {
+			for (; isdigit(*ex); ex++) {
+				if (e < 100) { e = e*10 + (*ex - '0');}
+			}
+			exponent += sign * e;
+			rd = ex;
+		}
+	}
+
+	float result = (float)mantissa;
+	for (; exponent > 10; exponent -= 10) { result *= _json_pow10[10];}
+	for (; exponent < -10; exponent += 10) { result /= _json_pow10[10];}
+	if (exponent > 0) { result *= _json_pow10[exponent];}
+	else if (exponent < 0) { result /= _json_pow10[-exponent];}
+
+	*value = (negative == true) ? -result : result;
+	*pstr = rd;
+	return (STAT_OK);
+}
+
 /****************************************************************************
  * json_serialize() - make a JSON object string from JSON object array
  *
@@ -294,6 +482,35 @@ static stat_t _get_nv_pair_strict(cmdObj_t *cmd, char_t **pstr, int8_t *depth)
 
 #define BUFFER_MARGIN 8			// safety margin to avoid buffer overruns during footer checksum generation
 
+static char_t *_json_serialize_pair(cmdObj_t *cmd, char_t *str)	// write "token":value - returns the new end
+{
+	*str++ = '"';
+	for (char_t *tok = cmd->token; *tok != NUL; ) { *str++ = *tok++;}
+	*str++ = '"';
+	*str++ = ':';
+
+	// check for illegal float values
+	if (cmd->objtype == TYPE_FLOAT) {
+		if (isnan((double)cmd->value) || isinf((double)cmd->value)) { cmd->value = 0;}
+	}
+
+	// serialize output value
+	if		(cmd->objtype == TYPE_NULL)		{ *str++ = '"'; *str++ = '"';} // Note that that "" is NOT null.
+	else if (cmd->objtype == TYPE_INTEGER)	{ str += fntoa(str, cmd->value, 0);}
+	else if (cmd->objtype == TYPE_STRING)	{ str += (char_t)sprintf((char *)str, "\"%s\"",(char *)*cmd->stringp);}
+	else if (cmd->objtype == TYPE_ARRAY)	{ str += (char_t)sprintf((char *)str, "[%s]",  (char *)*cmd->stringp);}
+	else if (cmd->objtype == TYPE_FLOAT) {
+		if ((cmd->precision >= 0) && (cmd->precision <= 4)) { str += fntoa(str, cmd->value, cmd->precision);}
+		else { str += fntoa(str, cmd->value, 6);}	// same as the %f default
+	}
+	else if (cmd->objtype == TYPE_BOOL) {
+		if (fp_FALSE(cmd->value)) { strcpy((char *)str, "false"); str += 5;}
+		else { strcpy((char *)str, "true"); str += 4;}
+	}
+	if (cmd->objtype == TYPE_PARENT) { *str++ = '{';}
+	return (str);
+}
+
 uint16_t json_serialize(cmdObj_t *cmd, char_t *out_buf, uint16_t size)
 {
 	char_t *str = out_buf;
@@ -307,37 +524,8 @@ uint16_t json_serialize(cmdObj_t *cmd, char_t *out_buf, uint16_t size)
 	while (true) {
 		if (cmd->objtype != TYPE_EMPTY) {
 			if (need_a_comma) { *str++ = ',';}
-			need_a_comma = true;
-			str += sprintf((char *)str, "\"%s\":", cmd->token);
-
-			// check for illegal float values
-			if (cmd->objtype == TYPE_FLOAT) {
-				if (isnan((double)cmd->value) || isinf((double)cmd->value)) { cmd->value = 0;}
-			}
-
-			// serialize output value
-			if		(cmd->objtype == TYPE_NULL)		{ str += (char_t)sprintf((char *)str, "\"\"");} // Note that that "" is NOT null.
-			else if (cmd->objtype == TYPE_INTEGER)	{
-				str += (char_t)sprintf((char *)str, "%1.0f", (double)cmd->value);
-			}
-			else if (cmd->objtype == TYPE_STRING)	{ str += (char_t)sprintf((char *)str, "\"%s\"",(char *)*cmd->stringp);}
-			else if (cmd->objtype == TYPE_ARRAY)	{ str += (char_t)sprintf((char *)str, "[%s]",  (char *)*cmd->stringp);}
-			else if (cmd->objtype == TYPE_FLOAT) {
-				if 		(cmd->precision == 0) { str += (char_t)sprintf((char *)str, "%0.0f", (double)cmd->value);}
-				else if (cmd->precision == 1) { str += (char_t)sprintf((char *)str, "%0.1f", (double)cmd->value);}
-				else if (cmd->precision == 2) { str += (char_t)sprintf((char *)str, "%0.2f", (double)cmd->value);}
-				else if (cmd->precision == 3) { str += (char_t)sprintf((char *)str, "%0.3f", (double)cmd->value);}
-				else if (cmd->precision == 4) { str += (char_t)sprintf((char *)str, "%0.4f", (double)cmd->value);}
-				else 						  { str += (char_t)sprintf((char *)str, "%f",    (double)cmd->value);}
-			}
-			else if (cmd->objtype == TYPE_BOOL) {
-				if (fp_FALSE(cmd->value)) { str += sprintf((char *)str, "false");}
-				else { str += (char_t)sprintf((char *)str, "true"); }
-			}
-			if (cmd->objtype == TYPE_PARENT) {
-				*str++ = '{';
-				need_a_comma = false;
-			}
+			need_a_comma = (cmd->objtype != TYPE_PARENT);
+			str = _json_serialize_pair(cmd, str);
 		}
 		if (str >= str_max) { return (-1);}		// signal buffer overrun
 		if ((cmd = cmd->nx) == NULL) { break;}	// end of the list
@@ -399,20 +587,42 @@ void json_print_list(stat_t status, uint8_t flags)
  *	which you may or may not want to display. This is followed by zero or more displayable objects. 
  *	Then if you want a gcode line number you add that here to the end. Finally, a footer goes 
  *	on all the (non-silent) responses.
+ *
+ *	The response is sent as it is serialized, JSON_RESPONSE_OBJECTS_PER_PASS objects at a time
+ *	(see json_response_callback()), so a long response doesn't hold the controller for its
+ *	whole length. The footer checksum is accumulated over the pieces as they go out.
+ *
+ *	Terse acknowledgements ($jt=1): when streaming, the response to each Gcode line is
+ *	most of the traffic back to the host. A Gcode line sent as is (not as {"gc":"..."})
+ *	that succeeds and has no message to show is answered with one short array instead:
+ *
+ *	  [status,line,planner_free]	e.g. [0,57,28]
+ *
+ *	line is the N word of the line, 0 if it has none, and planner_free is the number of
+ *	free planner buffers. Failures and lines with messages get the full response, as
+ *	does the same line wrapped in JSON - the way to ask for it explicitly.
  */
-#define MAX_TAIL_LEN 8
-
-void json_print_response(uint8_t status)
+static uint8_t _json_terse_response(uint8_t status)	// returns TRUE if it answered
+{
+	if ((js.json_terse == false) || (js.plain_line == false) || 
+		((status != STAT_OK) && (status != STAT_NOOP))) { return (false);}
+
+	uint32_t linenum = 0;
+	for (cmdObj_t *cmd = cmd_body; (cmd != NULL) && (cmd->objtype != TYPE_EMPTY); cmd = cmd->nx) {
+		uint8_t cmd_type = cmd_get_type(cmd);
+		if ((cmd_type == CMD_TYPE_MESSAGE) && (js.echo_json_messages == true)) { return (false);}
+		if (cmd_type == CMD_TYPE_LINENUM) { linenum = (uint32_t)cmd->value;}
+	}
+	fprintf(stderr, "[%d,%lu,%d]\n", status, (unsigned long)linenum, mp_get_planner_buffers_available());
+	cs.linelen = 0;
+	return (true);
+}
+
+static cmdObj_t *_json_filter_response_body()	// returns the object the filtering stopped on
 {
-	if (js.json_verbosity == JV_SILENT) return;			// silent responses
-
-	// Body processing
 	cmdObj_t *cmd = cmd_body;
-	if (status == STAT_JSON_SYNTAX_ERROR) {
-		cmd_reset_list();
-		cmd_add_string((const char_t *)"err", escape_string(cs.in_buf, cs.saved_buf));
 
-	} else if (cm.machine_state != MACHINE_INITIALIZING) {	// always do full echo during startup
+	if (cm.machine_state != MACHINE_INITIALIZING) {		// always do full echo during startup
 		uint8_t cmd_type;
 		do {
 			if ((cmd_type = cmd_get_type(cmd)) == CMD_TYPE_NULL) break;
@@ -439,6 +649,22 @@ void json_print_response(uint8_t status)
 			}
 		} while ((cmd = cmd->nx) != NULL);
 	}
+	return (cmd);
+}
+
+void json_print_response(uint8_t status)
+{
+	if (js.json_verbosity == JV_SILENT) return;			// silent responses
+	if (_json_terse_response(status) == true) return;
+
+	// Body processing
+	cmdObj_t *cmd = cmd_body;
+	if (status == STAT_JSON_SYNTAX_ERROR) {
+		cmd_reset_list();
+		cmd_add_string((const char_t *)"err", escape_string(cs.in_buf, cs.saved_buf));
+	} else {
+		cmd = _json_filter_response_body();
+	}
 
 	// Footer processing
 	while(cmd->objtype != TYPE_EMPTY) {						// find a free cmdObj at end of the list...
@@ -448,29 +674,74 @@ void json_print_response(uint8_t status)
 		}
 	}
 	char_t footer_string[CMD_FOOTER_LEN];
-	sprintf((char *)footer_string, "%d,%d,%d,0", FOOTER_REVISION, status, cs.linelen);
-	cs.linelen = 0;										// reset linelen so it's only reported once
+	_json_footer_values(footer_string, status);
 
-	cmd_copy_string(cmd, footer_string);				// link string to cmd object
+	cmd_copy_string(cmd, footer_string);				// link string to cmd object - the checksum is added as it goes out
 //	cmd->depth = 0;										// footer 'f' is a peer to response 'r' (hard wired to 0)
 	cmd->depth = js.json_footer_depth;					// 0=footer is peer to response 'r', 1=child of response 'r'
 	cmd->objtype = TYPE_ARRAY;
 	strcpy(cmd->token, "f");							// terminate the list
 	cmd->nx = NULL;
 
-	// do all this to avoid having to serialize it twice
-	int16_t strcount = json_serialize(cmd_header, cs.out_buf, sizeof(cs.out_buf));// make JSON string w/o checksum
-	if (strcount < 0) { return;}						// encountered an overrun during serialization
-	if (strcount > OUTPUT_BUFFER_LEN - MAX_TAIL_LEN) { return;}	// would overrun during checksum generation
-	int16_t strcount2 = strcount;
-	char tail[MAX_TAIL_LEN];
+	_stream_hash = 0;
+	_json_stream_write((const char_t *)"{", 0);			// opening curly of the response
+	js.response_next = cmd_header;
+	js.response_depth = 0;
+	js.response_comma = false;
+	json_response_callback();							// short responses are done here
+}
+
+/*
+ * json_response_callback() - send the next objects of a response started by json_print_response()
+ * json_response_finish()	- send the rest of the response now
+ *
+ *	The callback returns EAGAIN while there is more to send so the controller runs nothing
+ *	that could start other output until the response is done. The cmd list must not change
+ *	until then, so cmd_reset_list() finishes any response still going out.
+ *
+ *	The objects of a piece are serialized into the output buffer up to half full and the
+ *	object that takes it past half must fit in the rest - as json_serialize() requires of 
+ *	a whole response. If it doesn't the response is dropped.
+ */
+stat_t json_response_callback()
+{
+	if (js.response_next == NULL) { return (STAT_NOOP);}
 
-	while (cs.out_buf[strcount] != '0') { strcount--; }	// find end of checksum
-	strcpy(tail, cs.out_buf + strcount + 1);			// save the json termination
+	char_t *str = cs.out_buf;
+	char_t *str_max = cs.out_buf + sizeof(cs.out_buf) - BUFFER_MARGIN;
+	uint8_t objects = JSON_RESPONSE_OBJECTS_PER_PASS;
 
-	while (cs.out_buf[strcount2] != ',') { strcount2--; }// find start of checksum
-	sprintf((char *)cs.out_buf + strcount2 + 1, "%d%s", compute_checksum(cs.out_buf, strcount2), tail);
-	fprintf(stderr, "%s", cs.out_buf);
+	while ((objects-- > 0) && (str < cs.out_buf + sizeof(cs.out_buf)/2)) {
+		cmdObj_t *cmd = js.response_next;
+		if (cmd->objtype != TYPE_EMPTY) {
+			if (js.response_comma) { *str++ = ',';}
+			js.response_comma = (cmd->objtype != TYPE_PARENT);
+			str = _json_serialize_pair(cmd, str);
+		}
+		if (str >= str_max) {							// overrun - drop the rest of the response
+			js.response_next = NULL;
+			return (STAT_BUFFER_FULL);
+		}
+		if ((js.response_next = cmd->nx) == NULL) {		// that was the footer
+			_json_stream_write(cs.out_buf, (--str) - cs.out_buf);// all but its closing bracket
+			fprintf(stderr, ",%d]", checksum_finish(_stream_hash));
+			while (js.response_depth-- > 0) { fprintf(stderr, "}");}
+			fprintf(stderr, "}\n");
+			return (STAT_OK);
+		}
+		while (js.response_next->depth < js.response_depth--) {	// iterate the closing curlies
+			js.response_comma = true;
+			*str++ = '}';
+		}
+		js.response_depth = js.response_next->depth;
+	}
+	if (str > cs.out_buf) { _json_stream_write(cs.out_buf, str - cs.out_buf);}
+	return (STAT_EAGAIN);
+}
+
+void json_response_finish()
+{
+	while (json_response_callback() == STAT_EAGAIN);
 }
 
 /***********************************************************************************
@@ -502,6 +773,19 @@ stat_t json_set_jv(cmdObj_t *cmd)
 	return(STAT_OK);
 }
 
+/*
+ * json_set_fs() - set footer style - 1=standard, 2=with flow control counts
+ */
+
+stat_t json_set_fs(cmdObj_t *cmd)
+{
+	if ((cmd->value < FOOTER_REVISION) || (cmd->value > FOOTER_REVISION_FLOW)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	js.json_footer_style = cmd->value;
+	return(STAT_OK);
+}
+
 
 /***********************************************************************************
  * TEXT MODE SUPPORT
@@ -514,15 +798,18 @@ stat_t json_set_jv(cmdObj_t *cmd)
  * js_print_ej()
  * js_print_jv()
  * js_print_fs()
+ * js_print_jt()
  */
 
 static const char fmt_ej[] PROGMEM = "[ej]  enable json mode%13d [0=text,1=JSON]\n";
 static const char fmt_jv[] PROGMEM = "[jv]  json verbosity%15d [0=silent,1=footer,2=messages,3=configs,4=linenum,5=verbose]\n";
-static const char fmt_fs[] PROGMEM = "[fs]  footer style%17d [0=new,1=old]\n";
+static const char fmt_fs[] PROGMEM = "[fs]  footer style%17d [1=standard,2=flow control counts]\n";
+static const char fmt_jt[] PROGMEM = "[jt]  json terse acks%14d [0=off,1=on]\n";
 
 void js_print_ej(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_ej);}
 void js_print_jv(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_jv);}
 void js_print_fs(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_fs);}
+void js_print_jt(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_jt);}
 
 #endif // __TEXT_MODE
 
@@ -38,9 +38,14 @@ extern "C"{
 // for now there is only one JSON array in use - the footer
 // if you add these make sure there are no collisions w/present or past numbers
 
-#define FOOTER_REVISION 1
+#define FOOTER_REVISION 1			// [1,status,bytes,checksum]
+#define FOOTER_REVISION_FLOW 2		// [2,status,bytes,rx_free,planner_free,checksum] - see _json_footer_values()
 #define JSON_OUTPUT_STRING_MAX (OUTPUT_BUFFER_LEN)
 
+#ifndef JSON_RESPONSE_OBJECTS_PER_PASS
+#define JSON_RESPONSE_OBJECTS_PER_PASS 8	// objects of a response serialized per controller pass
+#endif
+
 enum jsonVerbosity {
 	JV_SILENT = 0,					// no response is provided for any command
 	JV_FOOTER,						// returns footer only (no command echo, gcode blocks or messages)
@@ -61,7 +66,8 @@ typedef struct jsSingleton {
 	/*** config values (PUBLIC) ***/
 	uint8_t json_verbosity;			// see enum in this file for settings
 	uint8_t json_footer_depth;		// 0=footer is peer to response 'r', 1=child of response 'r'
-//	uint8_t json_footer_style;		// select footer style
+	uint8_t json_footer_style;		// footer revision to send - FOOTER_REVISION or FOOTER_REVISION_FLOW
+	uint8_t json_terse;				// answer plain Gcode lines that succeed with a short token ($jt)
 
 	uint8_t echo_json_footer;		// flags for JSON responses serialization
 	uint8_t echo_json_messages;
@@ -70,6 +76,10 @@ typedef struct jsSingleton {
 	uint8_t echo_json_gcode_block;
 
 	/*** runtime values (PRIVATE) ***/
+	cmdObj_t *response_next;		// next object of the response going out - NULL if none
+	int8_t response_depth;			// depth of the last object sent
+	uint8_t response_comma;			// TRUE if the next object needs a leading comma
+	uint8_t plain_line;				// TRUE while a Gcode line sent without JSON wrapping runs
 
 } jsSingleton_t;
 
@@ -84,20 +94,26 @@ uint16_t json_serialize(cmdObj_t *cmd, char_t *out_buf, uint16_t size);
 void json_print_object(cmdObj_t *cmd);
 void json_print_response(uint8_t status);
 void json_print_list(stat_t status, uint8_t flags);
+stat_t json_response_callback(void);
+void json_response_finish(void);
+#define json_response_pending() (js.response_next != NULL)
 
 stat_t json_set_jv(cmdObj_t *cmd);
+stat_t json_set_fs(cmdObj_t *cmd);
 
 #ifdef __TEXT_MODE
 
 	void js_print_ej(cmdObj_t *cmd);
 	void js_print_jv(cmdObj_t *cmd);
 	void js_print_fs(cmdObj_t *cmd);
+	void js_print_jt(cmdObj_t *cmd);
 
 #else
 
 	#define js_print_ej tx_print_stub
 	#define js_print_jv tx_print_stub
 	#define js_print_fs tx_print_stub
+	#define js_print_jt tx_print_stub
 
 #endif // __TEXT_MODE
 
@@ -29,71 +29,404 @@
 #include "config.h"
 #include "canonical_machine.h"
 #include "stepper.h"
+#include "hardware.h"
 #include "kinematics.h"
+#include "text_parser.h"
+#include "util.h"
 
 #ifdef __cplusplus
 extern "C"{
 #endif
 
-//static void _inverse_kinematics(float travel[], float joint[], float microseconds);
+#if (KINEMATICS != KINE_CARTESIAN)
+static void _inverse_kinematics(float travel[], float joint[]);
+#endif
+static void _take_up_backlash(float steps[], const float microseconds) RAMFUNC;
+
+typedef struct ikMotorTable {		// motors that move, in the order they are converted
+	uint8_t motors;					// number of entries in use
+	uint8_t motor[MOTORS];			// motor to load
+	uint8_t axis[MOTORS];			// axis that drives it
+	float steps_per_unit[MOTORS];	// copy of st.m[motor].steps_per_unit
+	uint8_t fixed;					// true if ik_kinematics_fixed() can convert the travel
+	int64_t substeps_per_unit[MOTORS];// steps_per_unit * DDA_SUBSTEPS with shift[] fraction bits
+	uint8_t shift[MOTORS];
+	uint8_t backlash_enable;		// true if any motor has backlash
+	float backlash[MOTORS];			// steps across the gap
+	float takeup_rate[MOTORS];		// most take-up steps per microsecond
+	int8_t direction[MOTORS];		// 1 or -1 as last moved, 0 before the first move
+	float takeup[MOTORS];			// steps taken up - 0 to backlash
+	int8_t staged_direction[MOTORS];// ...as of the segment being prepped
+	float staged_takeup[MOTORS];
+	int32_t residual[MOTORS];		// fraction of a substep carried to the next segment (Q24, by motor)
+	int32_t staged_residual[MOTORS];
+#ifdef KINEMATICS_NONLINEAR
+	float position[AXES];			// cartesian position at the end of the last segment
+	float joint[AXES];				// joint positions at the end of the last segment
+#endif
+} ikMotorTable_t;
+static ikMotorTable_t ik;
+
+/*
+ * ik_update_motor_map() - rebuild the motor to axis table used by ik_kinematics()
+ *
+ *	Must be called whenever a motor map, steps-per-unit term or axis mode changes. Motors 
+ *	that are mapped to an inhibited or out-of-range axis are left out of the table, so 
+ *	ik_kinematics() returns zero steps for them. Backlash starts over - see kinematics.h.
+ */
+
+void ik_update_motor_map()
+{
+	uint8_t motors = 0;
+	ik.backlash_enable = false;
+	ik.fixed = (KINEMATICS == KINE_CARTESIAN);
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		ik.residual[motor] = 0;
+		uint8_t axis = st.m[motor].motor_map;
+		if ((axis >= AXES) || (cm.a[axis].axis_mode == AXIS_INHIBITED)) { continue;}
+		ik.motor[motors] = motor;
+		ik.axis[motors] = axis;
+		ik.steps_per_unit[motors] = st.m[motor].steps_per_unit;
+		double substeps_per_unit = (double)st.m[motor].steps_per_unit * DDA_SUBSTEPS;
+		uint8_t shift = 0;
+		while ((shift < IK_FRACTION_BITS_MAX) && (substeps_per_unit * 2 < IK_SUBSTEPS_PER_UNIT_MAX)) {
+			substeps_per_unit *= 2;
+			shift++;
+		}
+		substeps_per_unit = round(substeps_per_unit);
+		if ((substeps_per_unit < 0) || (substeps_per_unit >= IK_SUBSTEPS_PER_UNIT_MAX)) { ik.fixed = false;}
+		ik.substeps_per_unit[motors] = (int64_t)substeps_per_unit;
+		ik.shift[motors] = shift;
+		ik.backlash[motors] = cm.a[axis].backlash * st.m[motor].steps_per_unit;
+		ik.takeup_rate[motors] = BACKLASH_VELOCITY / MICROSECONDS_PER_MINUTE * st.m[motor].steps_per_unit;
+		ik.direction[motors] = 0;
+		ik.takeup[motors] = 0;
+		if (ik.backlash[motors] > 0) { ik.backlash_enable = true;}
+		motors++;
+	}
+	ik.motors = motors;
+	if (ik.backlash_enable == true) { ik.fixed = false;}	// the take-up is worked in float steps
+	cm_set_move_terms();							// the step rate limits go with the steps per unit
+}
 
 /*
  * ik_kinematics() - wrapper routine for inverse kinematics
  *
  *	Calls kinematics function(s). 
- *	Performs axis mapping & conversion of length units to steps (and deals with inhibited axes)
+ *	Performs axis mapping & conversion of length units to steps using the table built by
+ *	ik_update_motor_map() (which also deals with inhibited axes)
  *
- *	The reason steps are returned as floats (as opposed to, say, uint32_t) is to accommodate 
- *	fractional DDA steps. The DDA deals with fractional step values as fixed-point binary in 
- *	order to get the smoothest possible operation. Steps are passed to the move prep routine 
- *	as floats and converted to fixed-point binary during queue loading. See stepper.c for details.
+ *	Steps are returned as DDA substeps (steps * DDA_SUBSTEPS) ready for st_prep_line_substeps(). 
+ *	The fraction of a substep each motor's segment doesn't fill is carried into its next 
+ *	segment, staged like the backlash take-up. More substeps than an int32 holds is more than 
+ *	the DDA could step in any segment, so they are clamped rather than left to wrap.
  */
 
-void ik_kinematics(float travel[], float steps[], float microseconds)
+RAMFUNC void ik_kinematics(float travel[], int32_t substeps[], float microseconds)
 {
+	uint32_t start = hw_get_cycle_count();
+#if (KINEMATICS == KINE_CARTESIAN)
+	float *joint = travel;							// cartesian machines use the travel as-is
+#else
 	float joint[AXES];
-
-//	_inverse_kinematics(travel, joint, microseconds);// you can insert inverse kinematics transformations here
-	memcpy(joint, travel, sizeof(float)*AXES);		 //...or just do a memcopy for cartesian machines
+	_inverse_kinematics(travel, joint);				// joint travel for this segment
+#endif
 
 	// Map motors to axes and convert length units to steps
 	// Most of the conversion math has already been done in during config in steps_per_unit()
 	// which takes axis travel, step angle and microsteps into account.
-	for (uint8_t axis=0; axis<AXES; axis++) {
-		if (cm.a[axis].axis_mode == AXIS_INHIBITED) { joint[axis] = 0;}
-		if (st.m[MOTOR_1].motor_map == axis) { steps[MOTOR_1] = joint[axis] * st.m[MOTOR_1].steps_per_unit;}
-		if (st.m[MOTOR_2].motor_map == axis) { steps[MOTOR_2] = joint[axis] * st.m[MOTOR_2].steps_per_unit;}
-		if (st.m[MOTOR_3].motor_map == axis) { steps[MOTOR_3] = joint[axis] * st.m[MOTOR_3].steps_per_unit;}
-		if (st.m[MOTOR_4].motor_map == axis) { steps[MOTOR_4] = joint[axis] * st.m[MOTOR_4].steps_per_unit;}
-		if (st.m[MOTOR_5].motor_map == axis) { steps[MOTOR_5] = joint[axis] * st.m[MOTOR_5].steps_per_unit;}
-		if (st.m[MOTOR_6].motor_map == axis) { steps[MOTOR_6] = joint[axis] * st.m[MOTOR_6].steps_per_unit;}
-	}	
-	// the above is a loop unrolled version of this:
-	//	for (uint8_t motor=0; motor<MOTORS; motor++) {
-	//		if (st.m[motor].motor_map == axis) { steps[motor] = joint[axis] * st.m[motor].steps_per_unit;}
-	//	}
+	float steps[MOTORS];
+	for (uint8_t motor=0; motor<MOTORS; motor++) { steps[motor] = 0; substeps[motor] = 0;}
+	for (uint8_t i=0; i<ik.motors; i++) {
+		steps[ik.motor[i]] = joint[ik.axis[i]] * ik.steps_per_unit[i];
+	}
+	if (ik.backlash_enable == true) { _take_up_backlash(steps, microseconds);}
+
+	for (uint8_t i=0; i<ik.motors; i++) {
+		uint8_t motor = ik.motor[i];
+		float exact = steps[motor] * DDA_SUBSTEPS + ik.residual[motor] / IK_RESIDUAL_ONE;
+		exact = min(max(exact, -DDA_SUBSTEPS_LIMIT), DDA_SUBSTEPS_LIMIT);
+		substeps[motor] = (int32_t)exact;
+		ik.staged_residual[motor] = (int32_t)((exact - substeps[motor]) * IK_RESIDUAL_ONE);
+	}
+	st_record_kinematics_time(start);
 }
 
 /*
- * _inverse_kinematics() - inverse kinematics - example is for a cartesian machine
+ * ik_kinematics_fixed() - ik_kinematics() in integer math for the fixed point runtime
  *
- *	You can glue in inverse kinematics here, but be aware of time budget constrants.
- *	This function is run during the _exec() portion of the cycle and will therefore
- *	be run once per interpolation segment. The total time for the segment load, 
- *	including the inverse kinematics transformation cannot exceed the segment time, 
- *	and ideally should be no more than 25-50% of the segment time. Currently segments 
- *	run avery 5 ms, but this might be lowered. To profile this time look at the 
- *	time it takes to complete the mp_exec_move() function.
+ *	travel[] is in Q8.24 mm, as the __FIXED_POINT_RUNTIME works it out (see planner.h). 
+ *	Travel in Q8.24 times the substeps per mm is substeps in Q24, the same as the residual 
+ *	carried between segments, so each motor costs one 64 bit multiply and a shift. The 
+ *	substeps per mm keep as many fraction bits as fit 32 bits (up to IK_FRACTION_BITS_MAX), 
+ *	so the rounding of a low steps per unit doesn't add up over a long move. Only cartesian 
+ *	machines without backlash convert this way; returns false for the others so the 
+ *	caller can use ik_kinematics().
  */
+
+RAMFUNC uint8_t ik_kinematics_fixed(const int32_t travel[], int32_t substeps[])
+{
+	if (ik.fixed == false) { return (false);}
+	uint32_t start = hw_get_cycle_count();
+	for (uint8_t motor=0; motor<MOTORS; motor++) { substeps[motor] = 0;}
+	for (uint8_t i=0; i<ik.motors; i++) {
+		uint8_t motor = ik.motor[i];
+		int64_t exact = (((int64_t)travel[ik.axis[i]] * ik.substeps_per_unit[i]) >> ik.shift[i]) + ik.residual[motor];
+		int64_t whole = exact >> IK_RESIDUAL_BITS;			// floor - the residual is left positive
+		substeps[motor] = (int32_t)min(max(whole, -IK_SUBSTEPS_MAX), IK_SUBSTEPS_MAX);
+		ik.staged_residual[motor] = (int32_t)(exact - (whole << IK_RESIDUAL_BITS));
+	}
+	st_record_kinematics_time(start);
+	return (true);
+}
+
+/*
+ * _take_up_backlash() - add the backlash take-up to the segment being prepped
+ * ik_commit()		   - keep the take-up and the substep residuals once the segment has been prepped
+ * ik_settled()		   - true if no take-up is due
+ *
+ *	The take-up is staged like the input shaper's output so a segment that fails to 
+ *	prep doesn't count. Call ik_commit() where sh_commit() is called.
+ */
+static void _take_up_backlash(float steps[], const float microseconds)
+{
+	for (uint8_t i=0; i<ik.motors; i++) {
+		float s = steps[ik.motor[i]];
+		int8_t direction = ik.direction[i];
+		if (s > BACKLASH_MIN_STEPS) { direction = 1;}
+		else if (s < -BACKLASH_MIN_STEPS) { direction = -1;}
+		float target = (direction > 0) ? ik.backlash[i] : 0;
+
+		float takeup = ik.takeup[i];
+		if (ik.direction[i] == 0) {			// first move - the screw is loaded its way
+			takeup = target;
+		} else {
+			float limit = ik.takeup_rate[i] * microseconds;
+			float extra = min(max(target - takeup, -limit), limit);
+			steps[ik.motor[i]] += extra;
+			takeup += extra;
+		}
+		ik.staged_direction[i] = direction;
+		ik.staged_takeup[i] = takeup;
+	}
+}
+
+void ik_commit()
+{
+	for (uint8_t i=0; i<ik.motors; i++) {
+		ik.residual[ik.motor[i]] = ik.staged_residual[ik.motor[i]];
+	}
+	if (ik.backlash_enable == false) { return;}
+	for (uint8_t i=0; i<ik.motors; i++) {
+		ik.direction[i] = ik.staged_direction[i];
+		ik.takeup[i] = ik.staged_takeup[i];
+	}
+}
+
+uint8_t ik_settled()
+{
+	if (ik.backlash_enable == false) { return (true);}
+	for (uint8_t i=0; i<ik.motors; i++) {
+		float target = (ik.direction[i] > 0) ? ik.backlash[i] : 0;
+		if (fp_NE(ik.takeup[i], target)) { return (false);}
+	}
+	return (true);
+}
+
 /*
-static void _inverse_kinematics(float travel[], float joint[], float microseconds)
+ * ik_set_position() - set the cartesian position the non-linear kinematics start from
+ *
+ *	Non-linear kinematics keep the absolute position and joints of the last segment so 
+ *	each segment costs one transform. _exec_aline() calls this at the start of every 
+ *	move so the two can't drift apart, e.g. after homing or a segment that didn't load.
+ */
+
+#ifdef KINEMATICS_NONLINEAR
+static void _get_joints(const float position[], float joint[]);
+
+void ik_set_position(const float position[])
 {
+	copy_axis_vector(ik.position, position);
+	_get_joints(ik.position, ik.joint);
+}
+#else
+void ik_set_position(const float position[]) {}
+#endif
+
+/*
+ * _inverse_kinematics() - convert cartesian travel to joint travel for one segment
+ *
+ *	Be aware of time budget constraints. This function is run during the _exec() 
+ *	portion of the cycle and will therefore be run once per interpolation segment. 
+ *	The total time for the segment load, including the inverse kinematics 
+ *	transformation cannot exceed the segment time, and ideally should be no more than 
+ *	25-50% of the segment time. The ISR timing {"isrk?"} values report the cost.
+ */
+
+/*
+ * ik_height_map_init() - set up an empty map for a grid of points
+ * ik_height_map_set() 	- store the height of a point. Points are numbered along X first
+ *
+ *	The map is disabled when it is set up and is enabled by the cycle that fills it. 
+ *	Heights beyond the range of the integer format are clamped.
+ */
+
+ikHeightMap_t hmap;
+
+stat_t ik_height_map_init(float origin_x, float origin_y, float spacing_x, float spacing_y, 
+						  uint8_t points_x, uint8_t points_y)
+{
+	hmap.enable = false;
+	hmap.points_x = 0;
+	if ((points_x < 2) || (points_x > HEIGHT_MAP_AXIS_POINTS_MAX) || 
+		(points_y < 2) || (points_y > HEIGHT_MAP_AXIS_POINTS_MAX) ||
+		(((uint16_t)points_x * points_y) > HEIGHT_MAP_POINTS_MAX) ||
+		(spacing_x < EPSILON) || (spacing_y < EPSILON)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	hmap.origin_x = origin_x;
+	hmap.origin_y = origin_y;
+	hmap.spacing_x = spacing_x;
+	hmap.spacing_y = spacing_y;
+	hmap.points_y = points_y;
+	memset(hmap.height, 0, sizeof(hmap.height));
+	hmap.points_x = points_x;
+	return (STAT_OK);
+}
+
+void ik_height_map_set(uint16_t point, float height)
+{
+	if (point >= HEIGHT_MAP_POINTS_MAX) { return;}
+	float counts = min(max(height / HEIGHT_MAP_UNIT, -32767), 32767);
+	hmap.height[point] = (int16_t)lround(counts);
+}
+
+/*
+ * ik_height_map_z() - surface height at a machine XY position, or 0 if the map is off
+ *
+ *	Bilinear interpolation between the four points of the cell the position is in.
+ *	Called once per segment from the runtime, so it is kept to a few multiplies.
+ */
+
+float ik_height_map_z(float x, float y)
+{
+	if (hmap.enable == false) { return (0);}
+
+	float fx = min(max((x - hmap.origin_x) / hmap.spacing_x, 0), hmap.points_x - 1);
+	float fy = min(max((y - hmap.origin_y) / hmap.spacing_y, 0), hmap.points_y - 1);
+	uint8_t i = min((uint8_t)fx, hmap.points_x - 2);	// the last row and column are 
+	uint8_t j = min((uint8_t)fy, hmap.points_y - 2);	// ...the far side of a cell
+	fx -= i;
+	fy -= j;
+
+	int16_t *h = &hmap.height[j * hmap.points_x + i];
+	float row_0 = h[0] + (h[1] - h[0]) * fx;
+	float row_1 = h[hmap.points_x] + (h[hmap.points_x+1] - h[hmap.points_x]) * fx;
+	return ((row_0 + (row_1 - row_0) * fy) * HEIGHT_MAP_UNIT);
+}
+
+/*
+ * ik_height_map_segment_length() - longest segment that follows the map, or 0 if the map is off
+ */
+
+float ik_height_map_segment_length()
+{
+	if (hmap.enable == false) { return (0);}
+	return (min(hmap.spacing_x, hmap.spacing_y) * HEIGHT_MAP_SEGMENT_RATIO);
+}
+
+#if (KINEMATICS == KINE_COREXY)
+static void _inverse_kinematics(float travel[], float joint[])
+{
+	joint[AXIS_X] = travel[AXIS_X] + travel[AXIS_Y];
+	joint[AXIS_Y] = travel[AXIS_X] - travel[AXIS_Y];
+	for (uint8_t axis=AXIS_Z; axis<AXES; axis++) { joint[axis] = travel[axis];}
+}
+#endif
+
+#ifdef KINEMATICS_NONLINEAR
+static void _inverse_kinematics(float travel[], float joint[])
+{
+	float next[AXES];
+	for (uint8_t i=0; i<AXES; i++) { ik.position[i] += travel[i];}
+	_get_joints(ik.position, next);
 	for (uint8_t i=0; i<AXES; i++) {
-		joint[i] = travel[i];
-	}	
+		joint[i] = next[i] - ik.joint[i];
+		ik.joint[i] = next[i];
+	}
 }
-*/
+#endif
+
+/*
+ * _get_joints() - absolute joint positions for a cartesian position
+ *
+ *	Unreachable positions are clamped to the edge of the work envelope rather than 
+ *	handing NaNs to the steppers.
+ */
 
+#if (KINEMATICS == KINE_DELTA)
+#define SIN_60 ((float)0.8660254)
+static void _get_joints(const float position[], float joint[])
+{
+	static const float tower_x[3] = { -SIN_60 * DELTA_RADIUS, SIN_60 * DELTA_RADIUS, 0 };
+	static const float tower_y[3] = { -0.5 * DELTA_RADIUS, -0.5 * DELTA_RADIUS, DELTA_RADIUS };
+	for (uint8_t i=0; i<3; i++) {	// towers A,B,C drive joints X,Y,Z
+		float height = square(DELTA_DIAGONAL_ROD) - square(tower_x[i] - position[AXIS_X]) 
+												  - square(tower_y[i] - position[AXIS_Y]);
+		joint[AXIS_X+i] = position[AXIS_Z] + sqrt(max(height, 0));
+	}
+	for (uint8_t axis=AXIS_A; axis<AXES; axis++) { joint[axis] = position[axis];}
+}
+#endif
+
+#if (KINEMATICS == KINE_SCARA)
+static void _get_joints(const float position[], float joint[])
+{
+	float x = position[AXIS_X];
+	float y = position[AXIS_Y];
+	float cos_elbow = (square(x) + square(y) - square(SCARA_LINK_1) - square(SCARA_LINK_2)) / 
+					  (2 * SCARA_LINK_1 * SCARA_LINK_2);
+	float elbow = acos(min(max(cos_elbow, -1), 1));
+	float shoulder = atan2(y, x) - atan2(SCARA_LINK_2 * sin(elbow), SCARA_LINK_1 + SCARA_LINK_2 * cos(elbow));
+
+	shoulder *= (180 / M_PI);
+	while ((shoulder - ik.joint[AXIS_X]) > 180) { shoulder -= 360;}	// keep the shoulder from 
+	while ((shoulder - ik.joint[AXIS_X]) < -180) { shoulder += 360;}// ...jumping across +/-180
+	joint[AXIS_X] = shoulder;
+	joint[AXIS_Y] = elbow * (180 / M_PI);
+	for (uint8_t axis=AXIS_Z; axis<AXES; axis++) { joint[axis] = position[axis];}
+}
+#endif
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ ***********************************************************************************/
+
+/*
+ * ik_set_hme() - enable or disable the height map
+ *
+ *	A map must have been probed first. The change takes effect on the next segment, 
+ *	so Z steps by the height under the tool if it is changed while moving.
+ */
+
+stat_t ik_set_hme(cmdObj_t *cmd)
+{
+	if ((fp_NOT_ZERO(cmd->value)) && (hmap.points_x == 0)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	return (set_01(cmd));
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_hme[] PROGMEM = "[hme] height map enable%12d [0=off,1=on]\n";
+
+void ik_print_hme(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_hme);}
+
+#endif // __TEXT_MODE
+
 //############## UNIT TESTS ################
 
 //#define __UNIT_TEST_KINEMATICS
@@ -32,11 +32,131 @@
 extern "C"{
 #endif
 
+/* KINEMATICS - select the machine kinematics at compile time, e.g. -DKINEMATICS=KINE_COREXY
+ *
+ *	KINE_CARTESIAN	each axis drives the motors mapped to it
+ *	KINE_COREXY		CoreXY and H-bot. Joints are X = X+Y and Y = X-Y; map the two belt 
+ *					motors to X and Y. Linear, so it works on the relative travel
+ *	KINE_DELTA		linear delta. Joints X, Y and Z are the carriage heights of the towers 
+ *					at 210, 330 and 90 degrees
+ *	KINE_SCARA		two-link SCARA. Joints X and Y are the shoulder and elbow angles in 
+ *					degrees; set those motors' travel per revolution to 360
+ *
+ *	Delta and SCARA are non-linear: the joints are computed from absolute positions and 
+ *	the DDA moves the joints in a straight line across each segment, so segments are 
+ *	limited to KINEMATICS_SEGMENT_LENGTH to bound the joint-space error (the error 
+ *	grows with the square of the segment length). The cost of the transform and motor 
+ *	mapping is recorded with the ISR timing as {"isrkx":n} etc.
+ */
+#define KINE_CARTESIAN	0
+#define KINE_COREXY		1
+#define KINE_DELTA		2
+#define KINE_SCARA		3
+
+#ifndef KINEMATICS
+#define KINEMATICS KINE_CARTESIAN
+#endif
+
+#if (KINEMATICS == KINE_DELTA) || (KINEMATICS == KINE_SCARA)
+#define KINEMATICS_NONLINEAR
+#ifndef KINEMATICS_SEGMENT_LENGTH
+#define KINEMATICS_SEGMENT_LENGTH	((float)1.0)	// max mm per segment
+#endif
+#else
+#define KINEMATICS_SEGMENT_LENGTH	((float)0)		// segments are not length limited
+#endif
+
+#ifndef DELTA_DIAGONAL_ROD
+#define DELTA_DIAGONAL_ROD	((float)250.0)		// length of the diagonal rods in mm
+#endif
+#ifndef DELTA_RADIUS
+#define DELTA_RADIUS		((float)124.0)		// horizontal distance from effector center to towers, less effector and carriage offsets
+#endif
+#ifndef SCARA_LINK_1
+#define SCARA_LINK_1		((float)150.0)		// shoulder to elbow in mm
+#endif
+#ifndef SCARA_LINK_2
+#define SCARA_LINK_2		((float)150.0)		// elbow to tool in mm
+#endif
+
+/* HEIGHT MAP - Z compensation from a probed grid (G38.6, see cycle_probing.cpp)
+ *
+ *	The map is a grid of surface heights in machine coordinates, stored as integer 
+ *	microns relative to the first point probed - which is where the work Z should be 
+ *	set. While it is enabled ({"hme":1}) the runtime adds the bilinear height under 
+ *	each segment to its Z travel, so the tool follows the surface without the Gcode 
+ *	or the planned positions changing. Outside the grid the edge heights are used. 
+ *	Segments are limited to HEIGHT_MAP_SEGMENT_RATIO of the grid spacing so long 
+ *	moves are broken up and follow the surface between the points.
+ */
+#ifndef HEIGHT_MAP_POINTS_MAX
+#define HEIGHT_MAP_POINTS_MAX	256				// grid points held in RAM - 2 bytes each
+#endif
+#define HEIGHT_MAP_AXIS_POINTS_MAX 64			// most points along X or along Y
+#define HEIGHT_MAP_UNIT			((float)0.001)	// mm per count - heights are +/-32 mm
+#define HEIGHT_MAP_SEGMENT_RATIO ((float)0.25)	// max segment length as a fraction of the spacing
+
+/* BACKLASH - screw and gear backlash taken up in the runtime
+ *
+ *	An axis with backlash ({"xbl":0.05}) gets extra steps on its motors when they 
+ *	reverse, so the nut crosses the gap without a move from the host or a planner 
+ *	block of its own. ik_kinematics() follows each motor's direction and adds the 
+ *	take-up to the segments after a reversal, no faster than BACKLASH_VELOCITY, so a 
+ *	large gap is spread over a few segments. The planned trajectory and the reported 
+ *	positions don't change - only the motor positions ({"1mp":""}) carry the offset. 
+ *	The first move after power-up or a config change is taken to have loaded the 
+ *	screw in its direction. Take-up still due when motion stops is run out like the 
+ *	input shaper's delay (see mp_exec_shaper()).
+ *
+ *	Direction is per motor, so it works for any kinematics - a CoreXY belt motor or a 
+ *	delta tower reverses when its own joint does.
+ */
+#ifndef BACKLASH_VELOCITY
+#define BACKLASH_VELOCITY		((float)600.0)	// mm/min (deg/min) the gap is taken up at
+#endif
+#define BACKLASH_MIN_STEPS		((float)0.001)	// less motion than this keeps the direction
+#define IK_RESIDUAL_BITS		24				// the residual carried between segments is Q24 substeps
+#define IK_RESIDUAL_ONE			((float)16777216.0)	// 1 substep in the Q24 residual
+#define IK_SUBSTEPS_MAX			((int64_t)2147483647)	// most substeps a segment can carry (int32)
+#define IK_SUBSTEPS_PER_UNIT_MAX ((double)4294967296.0)// Q8.24 travel times this stays in 64 bits
+#define IK_FRACTION_BITS_MAX	16				// most fraction bits kept in the substeps per unit
+
+typedef struct ikHeightMap {
+	uint8_t enable;						// TRUE applies the map in the runtime
+	uint8_t points_x;					// grid points along X (0 if no map is loaded)
+	uint8_t points_y;					// grid points along Y
+	float origin_x;						// machine position of the first point
+	float origin_y;
+	float spacing_x;					// grid spacing in mm
+	float spacing_y;
+	int16_t height[HEIGHT_MAP_POINTS_MAX];// in HEIGHT_MAP_UNITs. Rows along X from the origin
+} ikHeightMap_t;
+extern ikHeightMap_t hmap;
+
 /*
  * Global Scope Functions
  */
 
-void ik_kinematics(float travel[], float steps[], float microseconds);
+void ik_update_motor_map(void);
+void ik_set_position(const float position[]);
+void ik_kinematics(float travel[], int32_t substeps[], float microseconds);
+uint8_t ik_kinematics_fixed(const int32_t travel[], int32_t substeps[]);
+void ik_commit(void);
+uint8_t ik_settled(void);
+
+stat_t ik_height_map_init(float origin_x, float origin_y, float spacing_x, float spacing_y, 
+						  uint8_t points_x, uint8_t points_y);
+void ik_height_map_set(uint16_t point, float height);
+float ik_height_map_z(float x, float y);
+float ik_height_map_segment_length(void);
+
+stat_t ik_set_hme(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+	void ik_print_hme(cmdObj_t *cmd);
+#else
+	#define ik_print_hme tx_print_stub
+#endif
 
 //#ifdef __UNIT_TESTS
 //void ik_unit_tests(void);
@@ -0,0 +1,274 @@
+/*
+ * linktest.cpp - console link throughput and latency self-test
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	$link=N (or {"link":N}) takes over the console for LINK_TEST_MS and runs pattern N
+ *	through the same path commands and responses take - the SysTick rx fill, read_line(),
+ *	xio_write() and the tx ring drain - so the numbers are what a host streaming Gcode
+ *	will see, USB or USART ($ci):
+ *
+ *	  1	loopback	every line read is sent straight back
+ *	  2	sink		lines are read and dropped - host to board throughput
+ *	  3	source		64 byte pattern lines are sent as fast as the host takes them
+ *	  4	ping		"ping <n>" lines are sent one at a time and the host echoes each
+ *					back - round trip time from the write to the echo's read_line()
+ *
+ *	In loopback and sink the run ends early on a line reading "end" - send it last, as
+ *	anything that arrives after the run goes to the parser. In ping the host must echo
+ *	within LINK_PING_TIMEOUT_MS or the ping is counted lost. The machine must be idle.
+ *	Results are read back with $lt (text) or {"lt":""} (JSON):
+ *
+ *	  ltm	mode that was run
+ *	  ltrb	bytes read, line terminators included
+ *	  lttb	bytes sent
+ *	  ltrr	read rate in bytes/sec, first line to last
+ *	  lttr	send rate in bytes/sec, start until the tx ring has drained
+ *	  ltpn	round trips completed
+ *	  ltpl	pings lost
+ *	  lt50	median round trip in us
+ *	  lt90	90th percentile round trip in us
+ *	  lt99	99th percentile round trip in us
+ *	  ltpx	longest round trip in us
+ *
+ *	Round trips are counted in power of 2 bins, so the percentiles are the upper edge
+ *	of the bin they fall in (ltpx is exact). Times come from the DWT cycle counter.
+ *	The simulator's clocks don't move while this runs, so it is refused there.
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "controller.h"
+#include "planner.h"
+#include "hardware.h"
+#include "linktest.h"
+#include "text_parser.h"
+#include "util.h"
+#include "xio.h"
+#include "xio_file.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+ltLinkTestSingleton_t lt;
+
+#ifndef __SIM
+
+#define CYCLES_PER_USEC (F_CPU / 1000000)
+
+static void _run_rx(uint8_t echo);
+static void _run_source(void);
+static void _run_ping(void);
+static void _wait_for_drain(void);
+static uint32_t _percentile(uint8_t percent);
+
+#endif // __SIM
+
+/*
+ * lt_run_link() - run link test pattern N
+ */
+
+stat_t lt_run_link(cmdObj_t *cmd)
+{
+	uint8_t mode = (uint8_t)cmd->value;
+	if ((mode <= LINK_TEST_OFF) || (mode >= LINK_TEST_MODES)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+#ifdef __SIM
+	return (STAT_NO_SUCH_DEVICE);
+#else
+	if ((mp_get_runtime_busy() == true) || (xf.state == XIO_FILE_PLAYING)) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+
+	fflush(stderr);								// anything already printed goes first
+	memset(&lt, 0, sizeof(lt));
+	lt.mode = mode;
+
+	switch (mode) {
+		case LINK_TEST_LOOPBACK: { _run_rx(true); break;}
+		case LINK_TEST_SINK: { _run_rx(false); break;}
+		case LINK_TEST_SOURCE: { _run_source(); break;}
+		case LINK_TEST_PING: { _run_ping(); break;}
+	}
+	if (lt.pings > 0) {
+		lt.latency_p50 = _percentile(50);
+		lt.latency_p90 = _percentile(90);
+		lt.latency_p99 = _percentile(99);
+	}
+	return (STAT_OK);
+#endif // __SIM
+}
+
+#ifndef __SIM
+
+/*
+ * _run_rx() - read lines until the time is up or the host sends "end", echoing them if asked
+ */
+
+static void _run_rx(uint8_t echo)
+{
+	uint8_t line[INPUT_BUFFER_LEN];
+	uint16_t index = 0;
+	uint32_t first = 0;
+	uint32_t last = 0;
+	uint32_t counted = 0;						// bytes read after the first line
+	uint32_t start = hw_get_cycle_count();
+	uint32_t end = SysTickTimer.getValue() + LINK_TEST_MS;
+
+	while (SysTickTimer.getValue() < end) {
+		stat_t status = read_line(line, &index, sizeof(line));
+		if (status == STAT_EAGAIN) { continue;}
+		if ((status == STAT_OK) && (strcmp((char *)line, "end") == 0)) { break;}
+
+		uint32_t now = hw_get_cycle_count();
+		uint16_t bytes = (status == STAT_OK) ? index+1 : index;	// the terminator was read too
+		if (lt.rx_bytes == 0) { first = now;} else { counted += bytes;}
+		last = now;
+		lt.rx_bytes += bytes;
+		if (echo == true) {
+			lt.tx_bytes += xio_write(line, index);
+			if (status == STAT_OK) { lt.tx_bytes += xio_write((const uint8_t *)"\n", 1);}
+		}
+		index = 0;
+	}
+	if (last != first) { lt.rx_rate = (float)counted * F_CPU / (last - first);}
+	if (echo == true) {
+		_wait_for_drain();
+		lt.tx_rate = (float)lt.tx_bytes * F_CPU / (hw_get_cycle_count() - start);
+	}
+}
+
+/*
+ * _run_source() - send the pattern as fast as the host will take it
+ */
+
+static void _run_source()
+{
+	static const uint8_t pattern[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz-\n";
+	uint32_t start = hw_get_cycle_count();
+	uint32_t end = SysTickTimer.getValue() + LINK_TEST_MS;
+
+	while (SysTickTimer.getValue() < end) {
+		lt.tx_bytes += xio_write(pattern, sizeof(pattern)-1);	// waits whenever the ring is full
+	}
+	_wait_for_drain();
+	lt.tx_rate = (float)lt.tx_bytes * F_CPU / (hw_get_cycle_count() - start);
+}
+
+/*
+ * _run_ping() - time echoed lines one at a time
+ */
+
+static void _run_ping()
+{
+	char out[16];
+	uint8_t line[INPUT_BUFFER_LEN];
+	uint16_t index = 0;
+	uint32_t seq = 0;
+	uint32_t end = SysTickTimer.getValue() + LINK_TEST_MS;
+
+	while (SysTickTimer.getValue() < end) {
+		uint8_t len = sprintf(out, "ping %lu\n", (unsigned long)++seq);
+		uint32_t sent = hw_get_cycle_count();
+		lt.tx_bytes += xio_write((const uint8_t *)out, len);
+
+		stat_t status;
+		uint32_t rtt;
+		index = 0;
+		do {
+			status = read_line(line, &index, sizeof(line));
+			rtt = hw_get_cycle_count() - sent;
+		} while ((status == STAT_EAGAIN) && (rtt < LINK_PING_TIMEOUT_MS * (F_CPU / 1000)));
+
+		if (status != STAT_EAGAIN) { lt.rx_bytes += (status == STAT_OK) ? index+1 : index;}
+		if ((status != STAT_OK) || (strncmp((char *)line, "ping ", 5) != 0) ||
+			(strtoul((char *)&line[5], NULL, 10) != seq)) {
+			lt.lost++;
+			continue;
+		}
+		uint32_t usec = rtt / CYCLES_PER_USEC;
+		uint8_t bin = 0;
+		while (((usec >> bin) != 0) && (bin < LINK_LATENCY_BINS-1)) { bin++;}
+		lt.bins[bin]++;
+		lt.pings++;
+		if (usec > lt.latency_max) { lt.latency_max = usec;}
+	}
+}
+
+/*
+ * _wait_for_drain() - wait for the tx ring to empty, or for another LINK_TEST_MS
+ */
+
+static void _wait_for_drain()
+{
+	uint32_t end = SysTickTimer.getValue() + LINK_TEST_MS;
+	while ((xio_get_tx_bufcount(XIO_CONSOLE) != 0) && (xio_is_connected() == true) &&
+		   (SysTickTimer.getValue() < end));
+}
+
+/*
+ * _percentile() - upper edge of the latency bin holding the given percentile
+ */
+
+static uint32_t _percentile(uint8_t percent)
+{
+	uint32_t need = (lt.pings * percent + 99) / 100;
+	uint32_t sum = 0;
+	for (uint8_t bin=0; bin < LINK_LATENCY_BINS-1; bin++) {
+		sum += lt.bins[bin];
+		if (sum >= need) { return (1UL << bin);}
+	}
+	return (lt.latency_max);					// the last bin is open ended
+}
+
+#endif // __SIM
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_ltm[] PROGMEM = "[ltm]  link test mode%20d [1=loopback,2=sink,3=source,4=ping]\n";
+static const char fmt_ltrb[] PROGMEM = "[ltrb] bytes read%24lu\n";
+static const char fmt_lttb[] PROGMEM = "[lttb] bytes sent%24lu\n";
+static const char fmt_ltrr[] PROGMEM = "[ltrr] read rate%25.0f bytes/sec\n";
+static const char fmt_lttr[] PROGMEM = "[lttr] send rate%25.0f bytes/sec\n";
+static const char fmt_ltpn[] PROGMEM = "[ltpn] round trips%23lu\n";
+static const char fmt_ltpl[] PROGMEM = "[ltpl] pings lost%24lu\n";
+static const char fmt_lt50[] PROGMEM = "[lt50] round trip 50%%%20lu us\n";
+static const char fmt_lt90[] PROGMEM = "[lt90] round trip 90%%%20lu us\n";
+static const char fmt_lt99[] PROGMEM = "[lt99] round trip 99%%%20lu us\n";
+static const char fmt_ltpx[] PROGMEM = "[ltpx] round trip max%20lu us\n";
+
+void lt_print_m(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_ltm);}
+void lt_print_rb(cmdObj_t *cmd) { text_print_int(cmd, fmt_ltrb);}
+void lt_print_tb(cmdObj_t *cmd) { text_print_int(cmd, fmt_lttb);}
+void lt_print_rr(cmdObj_t *cmd) { text_print_flt(cmd, fmt_ltrr);}
+void lt_print_tr(cmdObj_t *cmd) { text_print_flt(cmd, fmt_lttr);}
+void lt_print_pn(cmdObj_t *cmd) { text_print_int(cmd, fmt_ltpn);}
+void lt_print_pl(cmdObj_t *cmd) { text_print_int(cmd, fmt_ltpl);}
+void lt_print_50(cmdObj_t *cmd) { text_print_int(cmd, fmt_lt50);}
+void lt_print_90(cmdObj_t *cmd) { text_print_int(cmd, fmt_lt90);}
+void lt_print_99(cmdObj_t *cmd) { text_print_int(cmd, fmt_lt99);}
+void lt_print_px(cmdObj_t *cmd) { text_print_int(cmd, fmt_ltpx);}
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
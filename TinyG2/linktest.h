@@ -0,0 +1,97 @@
+/*
+ * linktest.h - console link throughput and latency self-test
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LINKTEST_H_ONCE
+#define LINKTEST_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+enum ltMode {					// $link=N
+	LINK_TEST_OFF = 0,
+	LINK_TEST_LOOPBACK,			// echo every line back to the host
+	LINK_TEST_SINK,				// read and discard lines - measures host to board
+	LINK_TEST_SOURCE,			// send a fixed pattern - measures board to host
+	LINK_TEST_PING,				// send numbered lines the host echoes back - measures round trips
+	LINK_TEST_MODES
+};
+
+#ifndef LINK_TEST_MS
+#define LINK_TEST_MS 5000		// length of a $link run
+#endif
+#ifndef LINK_PING_TIMEOUT_MS
+#define LINK_PING_TIMEOUT_MS 100// a ping not echoed by then is counted lost
+#endif
+#define LINK_LATENCY_BINS 16	// bin N holds round trips under 2^N us - the last takes the rest
+
+typedef struct ltLinkTestSingleton {	// results of the last link test
+	uint8_t mode;				// mode that was run - see ltMode
+	uint32_t rx_bytes;			// bytes read from the console, terminators included
+	uint32_t tx_bytes;			// bytes sent to the console
+	float rx_rate;				// bytes/sec from the first line read to the last
+	float tx_rate;				// bytes/sec from the start until the tx ring drained
+	uint32_t pings;				// round trips completed
+	uint32_t lost;				// pings timed out or echoed wrong
+	uint32_t latency_p50;		// round trip percentiles in us - upper edge of the bin
+	uint32_t latency_p90;
+	uint32_t latency_p99;
+	uint32_t latency_max;		// longest round trip in us - exact
+	uint32_t bins[LINK_LATENCY_BINS];
+} ltLinkTestSingleton_t;
+
+extern ltLinkTestSingleton_t lt;
+
+stat_t lt_run_link(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+
+	void lt_print_m(cmdObj_t *cmd);
+	void lt_print_rb(cmdObj_t *cmd);
+	void lt_print_tb(cmdObj_t *cmd);
+	void lt_print_rr(cmdObj_t *cmd);
+	void lt_print_tr(cmdObj_t *cmd);
+	void lt_print_pn(cmdObj_t *cmd);
+	void lt_print_pl(cmdObj_t *cmd);
+	void lt_print_50(cmdObj_t *cmd);
+	void lt_print_90(cmdObj_t *cmd);
+	void lt_print_99(cmdObj_t *cmd);
+	void lt_print_px(cmdObj_t *cmd);
+
+#else
+
+	#define lt_print_m tx_print_stub
+	#define lt_print_rb tx_print_stub
+	#define lt_print_tb tx_print_stub
+	#define lt_print_rr tx_print_stub
+	#define lt_print_tr tx_print_stub
+	#define lt_print_pn tx_print_stub
+	#define lt_print_pl tx_print_stub
+	#define lt_print_50 tx_print_stub
+	#define lt_print_90 tx_print_stub
+	#define lt_print_99 tx_print_stub
+	#define lt_print_px tx_print_stub
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LINKTEST_H_ONCE
@@ -0,0 +1,204 @@
+/*
+ * load_control.cpp - adaptive feed from the spindle load
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	See Adaptive feed in load_control.h
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "load_control.h"
+#include "planner.h"
+#include "hardware.h"
+#include "text_parser.h"
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+lcSingleton_t lc;
+
+static void _adc_init(void);
+static uint8_t _adc_read(float *load);
+
+/*
+ * load_control_init() - start the conversions
+ *
+ *	The settings are loaded before this is called.
+ */
+
+void load_control_init()
+{
+	lc.factor = 1;
+	lc.sample_usec = hw_get_usec();
+	_adc_init();
+}
+
+/*
+ * lc_load_callback() - filter a new load reading and adjust the load factor
+ *
+ *	Runs every controller pass, but only does the math when a buffer of conversions
+ *	has filled (see load_control.h).
+ */
+
+stat_t lc_load_callback()
+{
+	if (lc.target <= 0) {
+		mr.load_override = 1;
+		return (STAT_NOOP);
+	}
+	float load;
+	if (_adc_read(&load) == false) { return (STAT_NOOP);}
+
+	uint32_t now = hw_get_usec();
+	float dt = min((float)(now - lc.sample_usec) / 1000000, LC_MAX_DT);	// uint32_t math handles wrap
+	lc.sample_usec = now;
+	lc.load += (load - lc.load) * ((lc.filter_time > dt) ? dt / lc.filter_time : 1);
+
+	if (cm.cycle_state == CYCLE_OFF) {
+		lc.factor = 1;
+	} else if ((cm.cycle_state == CYCLE_MACHINING) && (cm.hold_state == FEEDHOLD_OFF) &&
+			   (mr.move_state > MOVE_STATE_NEW) && (mr.gm.motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) &&
+			   (fp_ZERO(mr.gm.spindle_sync))) {
+		if (lc.load < lc.air) {						// cutting air - back to the programmed feed
+			lc.factor += (1 - lc.factor) * min(lc.gain * dt, 1);
+		} else {
+			lc.factor += lc.gain * (lc.target - lc.load) / 100 * dt;
+		}
+		lc.factor = max(lc.factor_min, min(lc.factor, lc.factor_max));
+	}
+	mr.load_override = lc.factor;
+	return (STAT_OK);
+}
+
+/*
+ * _adc_init() - convert the channel continuously into the PDC buffers
+ * _adc_read() - average the buffer filled since the last call. FALSE if none has
+ *
+ *	The PDC fills the buffer at RPR, then takes RNPR as the next one and zeroes RNCR.
+ *	So RNCR at 0 means lc.fill has filled, and it goes back in as the next buffer.
+ *	If the main loop was away long enough for both to fill the PDC stops; the newer
+ *	one is read and both are handed back.
+ */
+
+#ifndef __SIM
+
+static void _adc_init()
+{
+	PMC->PMC_PCER1 = (1u << (ID_ADC - 32));	// clock the ADC
+	ADC->ADC_PTCR = ADC_PTCR_RXTDIS;
+	ADC->ADC_CR = ADC_CR_SWRST;
+	ADC->ADC_MR = ADC_MR_FREERUN | ADC_MR_PRESCAL(255) | ADC_MR_STARTUP_SUT64 |	// MCK/512 - slow on purpose
+				  ADC_MR_SETTLING_AST17 | ADC_MR_TRACKTIM(15) | ADC_MR_TRANSFER(3);
+	ADC->ADC_CHDR = 0xFFFF;
+	ADC->ADC_CHER = 1 << (lc.channel & 0x0F);
+
+	ADC->ADC_RPR = (uint32_t)lc.sample[0];
+	ADC->ADC_RCR = LC_ADC_SAMPLES;
+	ADC->ADC_RNPR = (uint32_t)lc.sample[1];
+	ADC->ADC_RNCR = LC_ADC_SAMPLES;
+	lc.fill = 0;
+	ADC->ADC_PTCR = ADC_PTCR_RXTEN;
+	ADC->ADC_CR = ADC_CR_START;
+}
+
+static uint8_t _adc_read(float *load)
+{
+	if (ADC->ADC_RNCR != 0) { return (false);}	// the first buffer is still filling
+	uint8_t stopped = (ADC->ADC_RCR == 0);
+	uint8_t done = (stopped == true) ? (lc.fill ^ 1) : lc.fill;
+
+	uint32_t sum = 0;
+	for (uint16_t i=0; i<LC_ADC_SAMPLES; i++) { sum += lc.sample[done][i] & ADC_LCDR_LDATA_Msk;}
+	*load = (float)sum * 100 / (LC_ADC_SAMPLES * LC_ADC_FULL_SCALE);
+
+	if (stopped == true) {
+		ADC->ADC_RPR = (uint32_t)lc.sample[0];
+		ADC->ADC_RCR = LC_ADC_SAMPLES;
+		ADC->ADC_RNPR = (uint32_t)lc.sample[1];
+		lc.fill = 0;
+	} else {
+		ADC->ADC_RNPR = (uint32_t)lc.sample[lc.fill];
+		lc.fill ^= 1;
+	}
+	ADC->ADC_RNCR = LC_ADC_SAMPLES;
+	return (true);
+}
+
+#else // __SIM
+
+static void _adc_init() {}
+
+static uint8_t _adc_read(float *load)
+{
+	if ((int32_t)(hw_get_usec() - lc.sample_usec) < LC_SIM_SAMPLE_USEC) { return (false);}
+	float feed = 0;
+	if ((cm_get_spindle_mode(MODEL) != SPINDLE_OFF) && (mr.gm.motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE)) {
+		feed = st_sim_velocity();
+	}
+	*load = min(feed / LC_SIM_FULL_LOAD_FEED, 1) * 100;
+	return (true);
+}
+
+#endif // __SIM
+
+/*
+ * lc_set_c() - set the ADC channel and restart the conversions on it
+ */
+
+stat_t lc_set_c(cmdObj_t *cmd)
+{
+	if ((cmd->value < 0) || (cmd->value > 15)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	_adc_init();
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_lct[] PROGMEM = "[lct]  load target%23.1f %% [0=off]\n";
+static const char fmt_lca[] PROGMEM = "[lca]  air cut load%22.1f %%\n";
+static const char fmt_lcg[] PROGMEM = "[lcg]  load gain%25.3f /sec\n";
+static const char fmt_lcf[] PROGMEM = "[lcf]  load filter time%18.3f sec\n";
+static const char fmt_lcn[] PROGMEM = "[lcn]  load factor min%19.3f\n";
+static const char fmt_lcx[] PROGMEM = "[lcx]  load factor max%19.3f\n";
+static const char fmt_lcc[] PROGMEM = "[lcc]  load ADC channel%18d\n";
+static const char fmt_lcl[] PROGMEM = "[lcl]  load%30.1f %%\n";
+static const char fmt_lco[] PROGMEM = "[lco]  load factor%23.3f\n";
+
+void lc_print_t(cmdObj_t *cmd) { text_print_flt(cmd, fmt_lct);}
+void lc_print_a(cmdObj_t *cmd) { text_print_flt(cmd, fmt_lca);}
+void lc_print_g(cmdObj_t *cmd) { text_print_flt(cmd, fmt_lcg);}
+void lc_print_f(cmdObj_t *cmd) { text_print_flt(cmd, fmt_lcf);}
+void lc_print_n(cmdObj_t *cmd) { text_print_flt(cmd, fmt_lcn);}
+void lc_print_x(cmdObj_t *cmd) { text_print_flt(cmd, fmt_lcx);}
+void lc_print_c(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_lcc);}
+void lc_print_l(cmdObj_t *cmd) { text_print_flt(cmd, fmt_lcl);}
+void lc_print_o(cmdObj_t *cmd) { text_print_flt(cmd, fmt_lco);}
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,128 @@
+/*
+ * load_control.h - adaptive feed from the spindle load
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Adaptive feed
+ *	A spindle drive's load output (or any 0 - 3.3v signal that rises with the cut - a
+ *	current sensor, a laser's reflected power) on ADC channel $lcc is held at $lct
+ *	percent of full scale by slowing the feed in heavy cuts and speeding it up in
+ *	light ones.
+ *
+ *	The ADC converts the channel continuously and the PDC writes the conversions into
+ *	two buffers of LC_ADC_SAMPLES in turn, with no interrupts - about 20 ms a buffer.
+ *	lc_load_callback() checks on each controller pass for a buffer that has filled,
+ *	hands the PDC it back as the next one, and averages it. The average is filtered
+ *	(first order, time constant $lcf) and an integral controller moves the load factor
+ *	by $lcg per second for each 100% the load is off $lct:
+ *
+ *	  factor += $lcg * ($lct - load) / 100 * dt		kept within $lcn..$lcx
+ *
+ *	The factor scales the feed on top of the dial and the starved queue factor (see
+ *	mp_feed_rate_override()). It is applied by the runtime on the next segment, without
+ *	the override ramp - the controller is the ramp - so it takes effect in a segment
+ *	time rather than after the planner queue.
+ *
+ *	It only changes while the runtime runs a feed in a machining cycle. Below $lca
+ *	percent the spindle is taken to be cutting air and the factor goes back towards 1,
+ *	so each cut is entered at the programmed feed. It holds through traverses, holds
+ *	and commands, is 1 when the cycle ends, and doesn't apply to traverses or spindle
+ *	synchronized blocks (G33, G84).
+ *
+ *	  $lct	load to hold, percent of full scale - 0 turns it off
+ *	  $lca	load below which the cutter is in air, percent
+ *	  $lcg	gain - factor change per second per 100% load error
+ *	  $lcf	load filter time constant, seconds
+ *	  $lcn	lowest factor
+ *	  $lcx	highest factor
+ *	  $lcc	ADC channel (7 is A0 on the Due)
+ *	  $lcl	filtered load, percent
+ *	  $lco	load factor in effect
+ *
+ *	Start with a low gain and raise it until the load follows a change of cut in a
+ *	second or so without overshooting. The simulator has no ADC. Its spindle load goes
+ *	with the velocity of the running feed - full scale at LC_SIM_FULL_LOAD_FEED with
+ *	the spindle on.
+ */
+
+#ifndef LOAD_CONTROL_H_ONCE
+#define LOAD_CONTROL_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define LC_ADC_SAMPLES 128				// conversions averaged for each update
+#define LC_ADC_FULL_SCALE 4095			// 12 bit conversions
+#define LC_MAX_DT ((float)0.1)			// longest update interval the controller integrates (seconds)
+#define LC_SIM_SAMPLE_USEC 20000		// simulator load update interval
+#define LC_SIM_FULL_LOAD_FEED 2000		// simulator feed (mm/min) that reads as full load
+
+typedef struct lcSingleton {
+	// config
+	float target;						// load to hold, percent - 0 is off ($lct)
+	float air;							// load below which the cutter is in air, percent ($lca)
+	float gain;							// factor change per second per 100% error ($lcg)
+	float filter_time;					// load filter time constant, seconds ($lcf)
+	float factor_min;					// factor range ($lcn, $lcx)
+	float factor_max;
+	uint8_t channel;					// ADC channel ($lcc)
+
+	// main loop
+	uint8_t fill;						// buffer the PDC is writing
+	uint32_t sample_usec;				// hw_get_usec() of the last update
+	float load;							// filtered load, percent ($lcl)
+	float factor;						// load factor ($lco)
+	uint16_t sample[2][LC_ADC_SAMPLES];	// PDC buffers
+} lcSingleton_t;
+
+extern lcSingleton_t lc;
+
+void load_control_init(void);
+stat_t lc_load_callback(void);
+stat_t lc_set_c(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+
+	void lc_print_t(cmdObj_t *cmd);
+	void lc_print_a(cmdObj_t *cmd);
+	void lc_print_g(cmdObj_t *cmd);
+	void lc_print_f(cmdObj_t *cmd);
+	void lc_print_n(cmdObj_t *cmd);
+	void lc_print_x(cmdObj_t *cmd);
+	void lc_print_c(cmdObj_t *cmd);
+	void lc_print_l(cmdObj_t *cmd);
+	void lc_print_o(cmdObj_t *cmd);
+
+#else
+
+	#define lc_print_t tx_print_stub
+	#define lc_print_a tx_print_stub
+	#define lc_print_g tx_print_stub
+	#define lc_print_f tx_print_stub
+	#define lc_print_n tx_print_stub
+	#define lc_print_x tx_print_stub
+	#define lc_print_c tx_print_stub
+	#define lc_print_l tx_print_stub
+	#define lc_print_o tx_print_stub
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOAD_CONTROL_H_ONCE
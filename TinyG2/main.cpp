@@ -33,7 +33,12 @@
 //#include "gpio.h"
 //#include "test.h"
 #include "pwm.h"
-#include "xio.h"
+#include "encoder.h"
+#include "load_control.h"
+#include "servo.h"
+#include "can.h"
+#include "xio.h"
+#include "xio_file.h"
 
 #include "MotateTimers.h"
 using Motate::delay;
@@ -55,6 +60,8 @@ static void _application_init(void);
 
 /******************** Application Code ************************/
 
+#ifndef __SIM
+
 const Motate::USBSettings_t Motate::USBSettings = {
 	/*gVendorID         = */ 0x1d50,
 	/*gProductID        = */ 0x606d,
@@ -64,11 +71,14 @@ const Motate::USBSettings_t Motate::USBSettings = {
 };
 	/*gProductVersion   = */ //0.1,
 
+#if (XIO_TELEMETRY_PORT == 1)
+Motate::USBDevice< Motate::USBCDC, Motate::USBCDC > usb;
+typeof usb._mixin_1_type::Serial &SerialUSB1 = usb._mixin_1_type::Serial;
+#else
 Motate::USBDevice< Motate::USBCDC > usb;
-//Motate::USBDevice< Motate::USBCDC, Motate::USBCDC > usb;
+#endif
 
 typeof usb._mixin_0_type::Serial &SerialUSB = usb._mixin_0_type::Serial;
-//typeof usb._mixin_1_type::Serial &SerialUSB1 = usb._mixin_1_type::Serial;
 
 MOTATE_SET_USB_VENDOR_STRING( {'S' ,'y', 'n', 't', 'h', 'e', 't', 'o', 's'} )
 MOTATE_SET_USB_PRODUCT_STRING( {'T', 'i', 'n', 'y', 'G', ' ', 'v', '2'} )
@@ -90,12 +100,12 @@ int main(void)
 {
 	// system initialization
 	init();
+	hw_paint_stack();				// before anything runs deep - see "SRAM use" in hardware.h
 	delay(1);
-	usb.attach();					// USB setup
-	delay(1000);
+	usb.attach();					// USB setup - the host enumerates it while the init runs
 
 	// TinyG application setup
-	_application_init();
+	_application_init();			// SYSTEM READY goes out once the host is connected too
 
 	// main loop
 	for (;;) {
@@ -104,6 +114,21 @@ int main(void)
 	return 0;
 }
 
+#else // __SIM
+
+int main(int argc, char *argv[])
+{
+	sim_init(argc, argv);			// simulator options and input - see platform/sim/sim.h
+	_application_init();
+
+	while (sim_run() == true) {		// moves simulated time on after each pass
+		controller_run( );
+	}
+	return (sim_exit());
+}
+
+#endif // __SIM
+
 static void _application_init(void)
 {
 	// There are a lot of dependencies in the order of these inits.
@@ -111,7 +136,11 @@ static void _application_init(void)
 
 	// do these first
 	hardware_init();				// system hardware setup 			- must be first
+	hw_boot_mark(HW_BOOT_HARDWARE);	// see Boot timing in hardware.h
+	xio_init();						// USART and buffered console output	- before anything prints
 	config_init();					// config records from eeprom 		- must be second
+	hw_boot_mark(HW_BOOT_CONFIG);
+	xio_file_init();				// after the settings - see SPI0 in xio_file.h
 	switch_init();					// switches and other inputs
 	pwm_init();						// pulse width modulation drivers
 
@@ -122,6 +151,13 @@ static void _application_init(void)
 
 	// do these last
 	stepper_init();
+	encoder_init();					// after the settings - see encoder.h
+	load_control_init();			// after the settings - see load_control.h
+	servo_init();					// after the settings - see servo.h
+	can_init();						// after the settings - see can.h
+	hw_set_irq_priorities(HW_IRQ_MAP_DEFAULT);// after everything that starts an interrupt
+	hw_boot_mark(HW_BOOT_INIT);
+	rpt_print_irq_message();		// report the interrupt priorities in effect
 
 	// now get started
 //	rpt_print_system_ready_message();// (LAST) announce system is ready
@@ -204,13 +240,13 @@ static const char stat_49[] PROGMEM = "JSON input has too many pairs";	// curren
 static const char stat_50[] PROGMEM = "JSON output too long";
 static const char stat_51[] PROGMEM = "Out of buffer space";
 static const char stat_52[] PROGMEM = "Config rejected during cycle";
-static const char stat_53[] PROGMEM = "53";
-static const char stat_54[] PROGMEM = "54";
-static const char stat_55[] PROGMEM = "55";
-static const char stat_56[] PROGMEM = "56";
-static const char stat_57[] PROGMEM = "57";
-static const char stat_58[] PROGMEM = "58";
-static const char stat_59[] PROGMEM = "59";
+static const char stat_53[] PROGMEM = "Checksum mismatch";
+static const char stat_54[] PROGMEM = "Binary frame error";
+static const char stat_55[] PROGMEM = "Subroutine not defined";
+static const char stat_56[] PROGMEM = "Gcode expression error";
+static const char stat_57[] PROGMEM = "Gcode expression value error";
+static const char stat_58[] PROGMEM = "Line number out of sequence";
+static const char stat_59[] PROGMEM = "Line discarded - resend pending";
 
 static const char stat_60[] PROGMEM = "Move less than minimum length";
 static const char stat_61[] PROGMEM = "Move less than minimum time";
@@ -226,13 +262,13 @@ static const char stat_70[] PROGMEM = "Arc specification error";
 static const char stat_71[] PROGMEM = "Soft limit exceeded";
 static const char stat_72[] PROGMEM = "Command not accepted";
 static const char stat_73[] PROGMEM = "Probing cycle failed";
-static const char stat_74[] PROGMEM = "74";
-static const char stat_75[] PROGMEM = "75";
-static const char stat_76[] PROGMEM = "76";
-static const char stat_77[] PROGMEM = "77";
-static const char stat_78[] PROGMEM = "78";
-static const char stat_79[] PROGMEM = "79";
-static const char stat_80[] PROGMEM = "80";
+static const char stat_74[] PROGMEM = "Limit switch hit";
+static const char stat_75[] PROGMEM = "Encoder following error";
+static const char stat_76[] PROGMEM = "No spindle tach or speed for synchronized move";
+static const char stat_77[] PROGMEM = "Spline specification error";
+static const char stat_78[] PROGMEM = "Emergency stop";
+static const char stat_79[] PROGMEM = "Pins in use by another feature";
+static const char stat_80[] PROGMEM = "Encoder edges missed";
 static const char stat_81[] PROGMEM = "81";
 static const char stat_82[] PROGMEM = "82";
 static const char stat_83[] PROGMEM = "83";
@@ -262,6 +298,7 @@ static const char stat_105[] PROGMEM = "Canonical machine assertion failure";
 static const char stat_106[] PROGMEM = "Planner assertion failure";
 static const char stat_107[] PROGMEM = "Stepper assertion failure";
 static const char stat_108[] PROGMEM = "Extended IO assertion failure";
+static const char stat_109[] PROGMEM = "Configuration assertion failure";
 
 static const char *const stat_msg[] PROGMEM = {
 	stat_00, stat_01, stat_02, stat_03, stat_04, stat_05, stat_06, stat_07, stat_08, stat_09,
@@ -274,7 +311,7 @@ static const char *const stat_msg[] PROGMEM = {
 	stat_70, stat_71, stat_72, stat_73, stat_74, stat_75, stat_76, stat_77, stat_78, stat_79,
 	stat_80, stat_81, stat_82, stat_83, stat_84, stat_85, stat_86, stat_87, stat_88, stat_89,
 	stat_90, stat_91, stat_92, stat_93, stat_94, stat_95, stat_96, stat_97, stat_98, stat_99,
-	stat_100, stat_101, stat_102, stat_103, stat_104, stat_105, stat_106, stat_107, stat_108
+	stat_100, stat_101, stat_102, stat_103, stat_104, stat_105, stat_106, stat_107, stat_108, stat_109
 };
 
 char *get_status_message(stat_t status)
@@ -291,11 +328,9 @@ static void _unit_tests(void)
 #ifdef __UNIT_TESTS
 	XIO_UNITS;				// conditional unit tests for xio sub-system
 //	EEPROM_UNITS;			// if you want this you must include the .h file in this file
-	CONFIG_UNITS;
 	JSON_UNITS;
 	GPIO_UNITS;
 	REPORT_UNITS;
-	PLANNER_UNITS;
 	PWM_UNITS;
 #endif
 }
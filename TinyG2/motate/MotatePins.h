@@ -59,4 +59,8 @@ namespace Motate {
 #include <utility/SamPins.h>
 #endif
 
+#if defined(__SIM)
+#include <utility/SimPins.h>
+#endif
+
 #endif /* end of include guard: MOTATEPINS_H_ONCE */
\ No newline at end of file
@@ -237,6 +237,7 @@ namespace Motate {
 		const uint8_t control_endpoint;
 		const uint8_t read_endpoint;
 		const uint8_t write_endpoint;
+		const uint8_t control_interface;	// interface number - class requests are addressed to it
 
 		struct _line_info_t
 		{
@@ -258,12 +259,14 @@ namespace Motate {
 		volatile _line_info_t _line_info;
 
 		USBSerial(usb_parent_type &usb_parent,
-					const uint8_t new_endpoint_offset
+					const uint8_t new_endpoint_offset,
+					const uint8_t new_interface_offset
 					)
 		: usb(usb_parent),
 		control_endpoint(new_endpoint_offset),
 		read_endpoint(new_endpoint_offset+1),
 		write_endpoint(new_endpoint_offset+2),
+		control_interface(new_interface_offset),
 		_line_state(0x00)
 		{};
 
@@ -271,6 +274,23 @@ namespace Motate {
 			return usb.readByte(read_endpoint);
 		};
 
+		// Non-blocking bulk read: copies whatever is waiting in the endpoint (up to length)
+		// and returns the count, 0 if nothing is waiting or -1 if not configured.
+		int16_t readAvailable(uint8_t *buffer, const uint16_t length) {
+			return usb.read(read_endpoint, buffer, length);
+		};
+
+		// Zero-copy read: points data at the bytes waiting in the current endpoint bank and
+		// returns the count (0 or -1 as readAvailable). Read them in order, each once, then
+		// hand back how many were read with releaseRead(). The rest stay for the next borrow.
+		int16_t borrowRead(const volatile uint8_t **data) {
+			return usb.borrow(read_endpoint, data);
+		};
+
+		void releaseRead(const int16_t used) {
+			usb.release(read_endpoint, used);
+		};
+
 		uint16_t read(const uint8_t *buffer, const uint16_t length) {
 			int16_t total_read = 0;
 			int16_t to_read = length;
@@ -320,6 +340,18 @@ namespace Motate {
 			usb.flush(write_endpoint);
 		}
 
+		// Non-blocking write: fills what the endpoint banks have room for and returns the count.
+		// Full banks go out on their own; a partly filled one waits for flushPartial().
+		int16_t writeAvailable(const uint8_t *data, const uint16_t length) {
+			return usb.write(write_endpoint, data, length);
+		};
+
+		// Send a partly filled bank, if there is one.
+		void flushPartial() {
+			if (usb.availableToRead(write_endpoint) > 0)
+				usb.flush(write_endpoint);
+		}
+
 		bool isConnected() {
 			return _line_state & (0x01 << 1);
 		}
@@ -333,6 +365,10 @@ namespace Motate {
 		}
 
 		bool handleNonstandardRequest(Setup_t &setup) {
+			// With more than one CDC interface each only answers requests addressed to it
+			if (setup.index() != control_interface)
+				return false;
+
 			if (setup.isADeviceToHostClassInterfaceRequest()) {
 				if (setup.requestIs(kGetLineEncoding)) {
 					usb.writeToControl(usb.master_control_endpoint, (uint8_t*)&_line_info, sizeof(_line_info));
@@ -373,6 +409,10 @@ namespace Motate {
 		void begin(uint32_t baud_count) {};
 		void end(void){};
 
+		const EndpointBufferSettings_t _bank_flags() {
+			return (control_interface == 0) ? kEndpointBufferBlocksUpTo3 : kEndpointBufferBlocks1;
+		};
+
 		const EndpointBufferSettings_t getEndpointSettings(const uint8_t endpoint, const bool otherSpeed) {
 			if (endpoint == control_endpoint)
 			{
@@ -382,12 +422,15 @@ namespace Motate {
 			else if (endpoint == read_endpoint)
 			{
 				const EndpointBufferSettings_t _buffer_speed = getBufferSizeFlags(Motate::getEndpointSize(read_endpoint, kEndpointTypeBulk, otherSpeed));
-				return kEndpointBufferOutputFromHost | _buffer_speed | kEndpointBufferBlocksUpTo2 | kEndpointBufferTypeBulk;
+				// Ask for as many banks as the hardware has - the host fills one while we read the others
+				// A second CDC interface gets one bank per endpoint - two interfaces fully banked don't fit the DPRAM
+				return kEndpointBufferOutputFromHost | _buffer_speed | _bank_flags() | kEndpointBufferTypeBulk;
 			}
 			else if (endpoint == write_endpoint)
 			{
 				const EndpointBufferSettings_t _buffer_speed = getBufferSizeFlags(Motate::getEndpointSize(write_endpoint, kEndpointTypeBulk, otherSpeed));
-				return kEndpointBufferInputToHost | _buffer_speed | kEndpointBufferBlocksUpTo2 | kEndpointBufferTypeBulk;
+				// Same for the host-bound side - the tx drain fills one bank while the host takes another
+				return kEndpointBufferInputToHost | _buffer_speed | _bank_flags() | kEndpointBufferTypeBulk;
 			}
 			return kEndpointBufferNull;
 		};
@@ -422,7 +465,8 @@ namespace Motate {
 
 		USBMixin< USBCDC, usbIFB, usbIFC, 0 > (usb_parent_type &usb_parent,
 											   const uint8_t new_endpoint_offset
-											   ) : Serial(usb_parent, new_endpoint_offset) {};
+											   ) : Serial(usb_parent, new_endpoint_offset,
+														  USBDescriptorConfiguration_t<USBCDC, usbIFB, usbIFC>::_interface_0_number) {};
 
 		static const EndpointBufferSettings_t getEndpointConfigFromMixin(const uint8_t endpoint, const bool other_speed) {
 			return usb_parent_type::_singleton->this_type::Serial.getEndpointSettings(endpoint, other_speed);
@@ -447,7 +491,8 @@ namespace Motate {
 
 		USBMixin< usbIFA, USBCDC, usbIFC, 1 > (usb_parent_type &usb_parent,
 											   const uint8_t new_endpoint_offset
-											   ) : Serial(usb_parent, new_endpoint_offset) {};
+											   ) : Serial(usb_parent, new_endpoint_offset,
+														  USBDescriptorConfiguration_t<usbIFA, USBCDC, usbIFC>::_interface_1_number) {};
 
 		static const EndpointBufferSettings_t getEndpointConfigFromMixin(uint8_t endpoint, const bool other_speed) {
 			return usb_parent_type::_singleton->this_type::Serial.getEndpointSettings(endpoint, other_speed);
@@ -472,7 +517,8 @@ namespace Motate {
 
 		USBMixin< usbIFA, usbIFB, USBCDC, 2 > (usb_parent_type &usb_parent,
 											   const uint8_t new_endpoint_offset
-											   ) : Serial(usb_parent, new_endpoint_offset) {};
+											   ) : Serial(usb_parent, new_endpoint_offset,
+														  USBDescriptorConfiguration_t<usbIFA, usbIFB, USBCDC>::_interface_2_number) {};
 
 		static const EndpointBufferSettings_t getEndpointConfigFromMixin(uint8_t endpoint, const bool other_speed) {
 			return usb_parent_type::_singleton->this_type::Serial.getEndpointSettings(endpoint, other_speed);
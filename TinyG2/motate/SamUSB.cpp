@@ -99,6 +99,10 @@ namespace Motate {
 		} else {
 			// Enpoint 1 config - max 1024b buffer, with three blocks
 			// Enpoint 2 config - max 1024b buffer, with three blocks
+			// Enpoints 3-9 - max 1024b buffer, with two blocks
+			// Requests for more banks than an endpoint has are cut back here, so interfaces can ask for UpTo3.
+			// At high speed a CDC interface on endpoints 1-3 uses 64 + 3*512 + 2*512 bytes of the 4K DPRAM.
+			// A second CDC interface (endpoints 4-6) asks for one bank each so it still fits: 64 + 512 + 512.
 
 			if ((config & kEnpointBufferSizeMask) > kEnpointBufferSizeUpTo1024)
 				config = (config & ~kEnpointBufferSizeMask) | kEnpointBufferSizeUpTo1024;
@@ -398,6 +402,41 @@ namespace Motate {
 		return read;
 	}
 
+	/* Borrowing a bank lets the caller read the received data itself rather than have it
+	 * copied to a buffer first. The bank is a window on the endpoint FIFO, not plain
+	 * memory: each byte must be read once, in order, and the bank can't be written.
+	 *
+	 * _borrowFromEndpoint() points data at what is left of the bank being read and returns
+	 * the count, or 0 if no bank is waiting. _releaseToEndpoint() returns the bank with
+	 * used bytes read from it - once it is empty it goes back to the host.
+	 */
+	int16_t _borrowFromEndpoint(const uint8_t endpoint, const volatile uint8_t **data) {
+		while (_isFIFOControlAvailable(endpoint)) {
+			int16_t available = _getEndpointBufferCount(endpoint);
+
+			if (available) {
+				*data = _endpointBuffer[endpoint];
+				return available;
+			}
+
+			// Empty bank - flush it. See the notes in _readFromEndpoint().
+			_clearReceiveOUT(endpoint);
+			_clearFIFOControl(endpoint);
+			_resetEndpointBuffer(endpoint);
+		}
+		return 0;
+	}
+
+	void _releaseToEndpoint(const uint8_t endpoint, const int16_t used) {
+		_endpointBuffer[endpoint] += used;
+
+		if (!_getEndpointBufferCount(endpoint)) {
+			_clearReceiveOUT(endpoint);
+			_clearFIFOControl(endpoint);
+			_resetEndpointBuffer(endpoint);
+		}
+	}
+
 	// Flush an endpoint after sending data.
 	void _flushEndpoint(uint8_t endpoint) {
 		_clearFIFOControl(endpoint);
@@ -177,6 +177,42 @@ namespace Motate {
 	
 	// TODO: Make the Pin<> use the appropriate Port<>, reducing duplication when there's no penalty
 	
+	/* Bit-band pin access (Cortex-M3)
+	 *
+	 * Each bit of the peripheral region 0x40000000..0x400FFFFF has a word alias at
+	 * 0x42000000 + offset*32 + bit*4. A load from the alias returns the bit as 0 or 1, and
+	 * a store to it is done by the bus as one atomic read-modify-write of that bit only.
+	 *
+	 * With MOTATE_SAM_BITBAND defined, Pin<> write() and toggle() store to the pin's ODSR
+	 * alias - no branch on the value and no masking - and get(), getInputValue() and
+	 * getOutputValue() load the PDSR and ODSR aliases. set() and clear() are single SODR
+	 * and CODR stores either way, so are already safe from any interrupt level.
+	 *
+	 * ODSR writes need the pin's OWER bit, which setMode(kOutput) sets in this mode.
+	 * WARNING: Port32::write() clears OWER for the pins it writes, so don't use it and
+	 * Pin<>::write() on the same pins.
+	 */
+	#define _MOTATE_BITBAND(reg, bit) (*(volatile uint32_t *)(0x42000000u + ((((uint32_t)&(reg)) - 0x40000000u) << 5) + ((bit) << 2)))
+
+#ifdef MOTATE_SAM_BITBAND
+	#define _MOTATE_PIN_ENABLE_ODSR(registerLetter, mask) (*PIO ## registerLetter).PIO_OWER = mask;
+	#define _MOTATE_PIN_WRITE(registerLetter, registerPin, mask, value)\
+		_MOTATE_BITBAND((*PIO ## registerLetter).PIO_ODSR, registerPin) = (value);
+	#define _MOTATE_PIN_TOGGLE(registerLetter, registerPin, mask)\
+		_MOTATE_BITBAND((*PIO ## registerLetter).PIO_ODSR, registerPin) ^= 1;
+	#define _MOTATE_PIN_READ(registerLetter, registerPin, mask, reg)\
+		return _MOTATE_BITBAND((*PIO ## registerLetter).reg, registerPin);
+#else
+	#define _MOTATE_PIN_ENABLE_ODSR(registerLetter, mask)
+	#define _MOTATE_PIN_WRITE(registerLetter, registerPin, mask, value)\
+		if (!(value)) (*PIO ## registerLetter).PIO_CODR = mask; else (*PIO ## registerLetter).PIO_SODR = mask;
+	#define _MOTATE_PIN_TOGGLE(registerLetter, registerPin, mask)\
+		(*PIO ## registerLetter).PIO_OWER = mask; /*Enable writing thru ODSR*/\
+		(*PIO ## registerLetter).PIO_ODSR ^= mask;
+	#define _MOTATE_PIN_READ(registerLetter, registerPin, mask, reg)\
+		return (((*PIO ## registerLetter).reg & mask) != 0);
+#endif // MOTATE_SAM_BITBAND
+
 	// (type == OutputOpendrain) ? PIO_OPENDRAIN : PIO_DEFAULT
 	#define _MAKE_MOTATE_PIN(pinNum, registerLetter, registerChar, registerPin)\
 		template<>\
@@ -204,6 +240,7 @@ namespace Motate {
 					case kOutput:\
 						(*PIO ## registerLetter).PIO_OER = mask ;\
 						(*PIO ## registerLetter).PIO_PER = mask ;\
+						_MOTATE_PIN_ENABLE_ODSR(registerLetter, mask)\
 						/* if all pins are output, disable PIO Controller clocking, reduce power consumption */\
 						if (!fromConstructor) {\
 							if ( (*PIO ## registerLetter).PIO_OSR == 0xffffffff )\
@@ -280,23 +317,19 @@ namespace Motate {
 				(*PIO ## registerLetter).PIO_CODR = mask;\
 			};\
 			void write(const bool value) {\
-				if (!value)\
-					clear();\
-				else\
-					set();\
+				_MOTATE_PIN_WRITE(registerLetter, registerPin, mask, value)\
 			};\
 			void toggle()  {\
-				(*PIO ## registerLetter).PIO_OWER = mask; /*Enable writing thru ODSR*/\
-				(*PIO ## registerLetter).PIO_ODSR ^= mask;\
+				_MOTATE_PIN_TOGGLE(registerLetter, registerPin, mask)\
 			};\
 			uint8_t get() { /* WARNING: This will fail if the peripheral clock is disabled for this pin!!! Use getOutputValue() instead. */\
-				return (*PIO ## registerLetter).PIO_PDSR & mask;\
+				_MOTATE_PIN_READ(registerLetter, registerPin, mask, PIO_PDSR)\
 			};\
 			uint8_t getInputValue() {\
-				return (*PIO ## registerLetter).PIO_PDSR & mask;\
+				_MOTATE_PIN_READ(registerLetter, registerPin, mask, PIO_PDSR)\
 			};\
 			uint8_t getOutputValue() {\
-				return (*PIO ## registerLetter).PIO_OSR & mask;\
+				_MOTATE_PIN_READ(registerLetter, registerPin, mask, PIO_ODSR)\
 			};\
 			bool isNull() { return false; };\
 			static uint32_t maskForPort(const uint8_t otherPortLetter) {\
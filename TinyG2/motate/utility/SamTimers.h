@@ -115,9 +115,38 @@ namespace Motate {
 	};
 
 	typedef const uint8_t timer_number;
-    
+
+	/* Compile-time clock selection for a range of frequencies.
+	 * Picks the smallest divisor (finest period resolution) that can still reach minFreq
+	 * with a 16 bit TOP, and can reach maxFreq at all. The frequency can then be moved
+	 * anywhere in the range with setPeriod() without changing the clock. Fails to compile
+	 * if no divisor covers the range. Use with setModeAndFrequency<>().
+	 *
+	 *   typedef TimerPrescaler<F_CPU, 1000, 200000> my_prescaler;
+	 */
+	template <uint32_t masterClock, uint32_t minFreq, uint32_t maxFreq>
+	struct TimerPrescaler {
+		static const uint32_t divisor =
+			((((masterClock / 2)   / minFreq) < 0x10000) && (maxFreq < (masterClock / 2)))   ? 2 :
+			((((masterClock / 8)   / minFreq) < 0x10000) && (maxFreq < (masterClock / 8)))   ? 8 :
+			((((masterClock / 32)  / minFreq) < 0x10000) && (maxFreq < (masterClock / 32)))  ? 32 :
+			((((masterClock / 128) / minFreq) < 0x10000) && (maxFreq < (masterClock / 128))) ? 128 : 0;
+
+		static const uint32_t clockSelect =
+			(divisor == 2)  ? TC_CMR_TCCLKS_TIMER_CLOCK1 :
+			(divisor == 8)  ? TC_CMR_TCCLKS_TIMER_CLOCK2 :
+			(divisor == 32) ? TC_CMR_TCCLKS_TIMER_CLOCK3 : TC_CMR_TCCLKS_TIMER_CLOCK4;
+
+		static const uint32_t clock = masterClock / (divisor ? divisor : 1);	// timer ticks per second
+
+		typedef char frequency_range_unattainable[(divisor != 0) ? 1 : -1];
+	};
+
 	template <uint8_t timerNum>
 	struct Timer {
+		// Period change deferred to the next overflow - see setPeriodAtOverflow()
+		volatile uint32_t _pendingTop;
+		volatile uint32_t _pendingA;
 
 		// NOTE: Notice! The *pointers* are const, not the *values*.
 		static Tc * const tc();
@@ -138,6 +167,7 @@ namespace Motate {
 		};
 
 		void init() {
+			_pendingTop = 0;
 			/* Unlock this thing */
 			unlock();
 		}
@@ -262,6 +292,25 @@ namespace Motate {
 			return masterClock/(divisor*0xFFFF);
 		};
 
+		// Set the mode and frequency using a clock picked at compile time - see TimerPrescaler.
+		// Only for the modes that count to RC. Returns the actual frequency.
+		template <class prescaler>
+		int32_t setModeAndFrequency(const TimerMode mode, uint32_t freq) {
+			tcChan()->TC_CCR = TC_CCR_CLKDIS;
+			tcChan()->TC_IDR = 0xFFFFFFFF;
+			tcChan()->TC_SR;
+			enablePeripheralClock();
+
+			if (mode == kTimerUpDownToMatch)
+				freq *= 2;
+
+			tcChan()->TC_CMR = mode | prescaler::clockSelect;
+			_pendingTop = 0;
+			uint32_t newTop = prescaler::clock / freq;
+			setTop(newTop);
+			return prescaler::clock / newTop;
+		};
+
 		// Set the TOP value for modes that use it.
 		// WARNING: No sanity checking is done to verify that you are, indeed, in a mode that uses it.
 		void setTop(const uint32_t topValue) {
@@ -281,6 +330,32 @@ namespace Motate {
 			return tcChan()->TC_CV;
 		}
 
+		// Change the period (RC) and channel A match (RA) of a running timer without stopping it.
+		// The TC has no buffered RC, so a TOP written below the counter would let it run on to
+		// 0xFFFFFFFF. If the counter has already passed the new TOP the period is restarted
+		// with a software trigger instead, which only cuts the current period short. 
+		// Best called from the overflow interrupt, when the counter is near zero.
+		void setPeriod(const uint32_t topValue, const uint32_t matchA) {
+			tcChan()->TC_RA = matchA;
+			tcChan()->TC_RC = topValue;
+			if (tcChan()->TC_CV >= topValue) {
+				tcChan()->TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+			}
+		};
+
+		// Change the period and channel A match at the next overflow. The current period
+		// runs out unchanged. The values are written by getInterruptCause() when it sees the
+		// overflow, so the overflow interrupt must be on and its handler must call
+		// getInterruptCause() first. A later call before the overflow replaces an earlier one.
+		// Safe to call from any interrupt level.
+		void setPeriodAtOverflow(const uint32_t topValue, const uint32_t matchA) {
+			uint32_t primask = __get_PRIMASK();
+			__disable_irq();
+			_pendingA = matchA;
+			_pendingTop = topValue;
+			if (primask == 0) { __enable_irq(); }
+		};
+
 		void start() {
 			tcChan()->TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
 		};
@@ -394,6 +469,10 @@ namespace Motate {
 			uint32_t sr = tcChan()->TC_SR;
 					// if it is either an overflow or a RC compare
 			if (sr & (TC_SR_COVFS | TC_SR_CPCS)) {
+				if (_pendingTop != 0) {		// the new period starts now - see setPeriodAtOverflow()
+					setPeriod(_pendingTop, _pendingA);
+					_pendingTop = 0;
+				}
 				return kInterruptOnOverflow;
 			}
 			else if (sr & (TC_SR_CPAS)) {
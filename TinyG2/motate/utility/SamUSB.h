@@ -151,6 +151,8 @@ namespace Motate {
 	extern int16_t _readFromControlEndpoint(const uint8_t endpoint, uint8_t* data, int16_t len);
 	extern int16_t _readFromEndpoint(const uint8_t endpoint, uint8_t* data, int16_t len);
 	extern int16_t _readByteFromEndpoint(const uint8_t endpoint);
+	extern int16_t _borrowFromEndpoint(const uint8_t endpoint, const volatile uint8_t **data);
+	extern void _releaseToEndpoint(const uint8_t endpoint, const int16_t used);
 	extern int16_t _sendToEndpoint(const uint8_t endpoint, const uint8_t* data, int16_t length);
 	extern int16_t _sendToControlEndpoint(const uint8_t endpoint, const uint8_t* data, int16_t length);
 	extern void _unfreezeUSBClock();
@@ -338,6 +340,18 @@ namespace Motate {
 			return _readFromEndpoint(endpoint, buffer, length);
 		};
 
+		/* Zero-copy read - see _borrowFromEndpoint(). Every borrow must be released. */
+		static int16_t borrow(const uint8_t endpoint, const volatile uint8_t **data) {
+			if (!_configuration)
+				return -1;
+
+			return _borrowFromEndpoint(endpoint, data);
+		};
+
+		static void release(const uint8_t endpoint, const int16_t used) {
+			_releaseToEndpoint(endpoint, used);
+		};
+
 		/* Data is const. The pointer to data is not. */
 		static int16_t write(const uint8_t endpoint, const uint8_t * buffer, int16_t length) {
 			if (!_configuration || length < 0)
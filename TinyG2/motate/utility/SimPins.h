@@ -0,0 +1,110 @@
+/*
+  utility/SimPins.h - Host simulation pins for the Motate system
+  http://tinkerin.gs/
+
+  Copyright (c) 2013 Robert Giseburt
+
+	This file is part of the Motate Library.
+
+	This file ("the software") is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License, version 2 as published by the
+	Free Software Foundation. You should have received a copy of the GNU General Public
+	License, version 2 along with the software. If not, see <http://www.gnu.org/licenses/>.
+
+	As a special exception, you may use this file as part of a software library without
+	restriction. Specifically, if other files instantiate templates or use macros or
+	inline functions from this file, or you compile this file and link it with  other
+	files to produce an executable, this file does not by itself cause the resulting
+	executable to be covered by the GNU General Public License. This exception does not
+	however invalidate any other reasons why the executable file might be covered by the
+	GNU General Public License.
+
+	THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+	WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+	OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+	SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+	OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SIMPINS_H_ONCE
+#define SIMPINS_H_ONCE
+
+#include "sim.h"				// CMSIS and register stand-ins - see platform/sim
+
+/* Pins for the host simulator build (__SIM). Every numbered pin exists and keeps
+ * the last value written to it. Inputs read high, as an open switch does on a 
+ * pulled-up input. Negative pin numbers are null pins, as on the Sam.
+ */
+
+namespace Motate {
+	enum PinMode {
+		kUnchanged      = 0,
+		kOutput         = 1,
+		kInput          = 2,
+		kPeripheralA    = 3,
+		kPeripheralB    = 4,
+	};
+
+	enum PinOptions {
+		kNormal         = 0,
+		kTotem          = 0, // alias
+		kPullUp         = 1<<1,
+		kWiredAnd       = 1<<2,
+		kDriveLowOnly   = 1<<2, // alias
+		kWiredAndPull   = kWiredAnd|kPullUp,
+		kDriveLowPullUp = kDriveLowOnly|kPullUp, // alias
+		kDeglitch       = 1<<4,
+		kDebounce       = 1<<5,
+	};
+
+	template<int8_t pinNum>
+	struct Pin {
+		static const int8_t number = pinNum;
+		uint8_t _value;
+		PinMode _mode;
+
+		Pin() : _value(1), _mode(kUnchanged) {};
+		Pin(const PinMode type, const PinOptions options = kNormal) : _value(1), _mode(type) {};
+		void operator=(const bool value) { write(value); };
+		operator bool() { return (_value != 0); };
+
+		void init(const PinMode type, const uint16_t options = kNormal, const bool fromConstructor=false) { _mode = type; };
+		void setMode(const PinMode type, const bool fromConstructor=false) { _mode = type; };
+		PinMode getMode() { return _mode; };
+		void setOptions(const uint16_t options, const bool fromConstructor=false) {};
+		uint16_t getOptions() { return kNormal; };
+		void set() { _value = 1; };
+		void clear() { _value = 0; };
+		void write(const bool value) { _value = value; };
+		void toggle() { _value = !_value; };
+		uint8_t get() { return _value; };
+		uint8_t getInputValue() { return _value; };
+		uint8_t getOutputValue() { return _value; };
+		bool isNull() { return (pinNum < 0); };
+	};
+
+	template<int8_t pinNum>
+	struct InputPin : Pin<pinNum> {
+		InputPin() : Pin<pinNum>(kInput) {};
+		InputPin(const PinOptions options) : Pin<pinNum>(kInput, options) {};
+		void init(const PinOptions options = kNormal  ) {Pin<pinNum>::init(kInput, options);};
+		uint8_t get() { return Pin<pinNum>::getInputValue(); };
+		operator bool() { return (get() != 0); };
+	};
+
+	template<int8_t pinNum>
+	struct OutputPin : Pin<pinNum> {
+		OutputPin() : Pin<pinNum>(kOutput) {};
+		OutputPin(const PinOptions options) : Pin<pinNum>(kOutput, options) {};
+		void init(const PinOptions options = kNormal) {Pin<pinNum>::init(kOutput, options);};
+		uint8_t get() { return Pin<pinNum>::getOutputValue(); };
+		void operator=(const bool value) { Pin<pinNum>::write(value); };
+		operator bool() { return (get() != 0); };
+	};
+
+	typedef const int8_t pin_number;
+
+} // namespace Motate
+
+#endif /* end of include guard: SIMPINS_H_ONCE */
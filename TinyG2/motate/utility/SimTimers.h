@@ -0,0 +1,130 @@
+/*
+  utility/SimTimers.h - Host simulation timers for the Motate system
+  http://tinkerin.gs/
+
+  Copyright (c) 2013 Robert Giseburt
+
+	This file is part of the Motate Library.
+
+	This file ("the software") is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License, version 2 as published by the
+	Free Software Foundation. You should have received a copy of the GNU General Public
+	License, version 2 along with the software. If not, see <http://www.gnu.org/licenses/>.
+
+	As a special exception, you may use this file as part of a software library without
+	restriction. Specifically, if other files instantiate templates or use macros or
+	inline functions from this file, or you compile this file and link it with  other
+	files to produce an executable, this file does not by itself cause the resulting
+	executable to be covered by the GNU General Public License. This exception does not
+	however invalidate any other reasons why the executable file might be covered by the
+	GNU General Public License.
+
+	THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+	WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+	OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+	SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+	OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SIMTIMERS_H_ONCE
+#define SIMTIMERS_H_ONCE
+
+/* Timers for the host simulator build (__SIM). Nothing here counts by itself - the
+ * simulator advances SysTickTimer as simulated time passes (see platform/sim), so 
+ * everything timed off the tick runs on simulated time, faster than real time.
+ */
+
+namespace Motate {
+	enum TimerMode {
+		kTimerInputCapture         = 0,
+		kTimerInputCaptureToMatch  = 1,
+		kTimerUp                   = 2,
+		kTimerUpToMatch            = 3,
+		kTimerUpDown               = 4,
+		kTimerUpDownToMatch        = 5,
+	};
+
+	enum TimerChannelInterruptOptions {
+		kInterruptsOff              = 0,
+		kInterruptUnknown           = 0,
+		kInterruptOnMatchA          = 1<<1,
+		kInterruptOnMatchB          = 1<<2,
+		kInterruptOnOverflow        = 1<<3,
+		kInterruptOnSoftwareTrigger = 1<<4,
+		kInterruptPriorityHighest   = 1<<5,
+		kInterruptPriorityHigh      = 1<<6,
+		kInterruptPriorityMedium    = 1<<7,
+		kInterruptPriorityLow       = 1<<8,
+		kInterruptPriorityLowest    = 1<<9,
+	};
+
+	enum TimerErrorCodes {
+		kFrequencyUnattainable = -1,
+	};
+
+	typedef const uint8_t timer_number;
+
+	template <uint32_t masterClock, uint32_t minFreq, uint32_t maxFreq>
+	struct TimerPrescaler {		// as SamTimers.h, less the clock select bits
+		static const uint32_t divisor =
+			((((masterClock / 2)   / minFreq) < 0x10000) && (maxFreq < (masterClock / 2)))   ? 2 :
+			((((masterClock / 8)   / minFreq) < 0x10000) && (maxFreq < (masterClock / 8)))   ? 8 :
+			((((masterClock / 32)  / minFreq) < 0x10000) && (maxFreq < (masterClock / 32)))  ? 32 :
+			((((masterClock / 128) / minFreq) < 0x10000) && (maxFreq < (masterClock / 128))) ? 128 : 0;
+		static const uint32_t clock = masterClock / (divisor ? divisor : 1);
+		typedef char frequency_range_unattainable[(divisor != 0) ? 1 : -1];
+	};
+
+	template <uint8_t timerNum>
+	struct Timer {
+		uint32_t _top;
+		uint32_t _interrupts;
+
+		Timer() : _top(0), _interrupts(0) {};
+		Timer(const TimerMode mode, const uint32_t freq) : _top(0), _interrupts(0) {};
+
+		int32_t setModeAndFrequency(const TimerMode mode, uint32_t freq) { return (freq); };
+		template <class prescaler>
+		int32_t setModeAndFrequency(const TimerMode mode, uint32_t freq) { _top = prescaler::clock / freq; return (freq); };
+		void setTop(const uint32_t topValue) { _top = topValue; };
+		void setPeriod(const uint32_t topValue, const uint32_t matchA) { _top = topValue; };
+		void setPeriodAtOverflow(const uint32_t topValue, const uint32_t matchA) { _top = topValue; };
+		uint32_t getTopValue() { return _top; };
+		uint32_t getValue() { return 0; };
+		void start() {};
+		void stop() {};
+		void setDutyCycleA(const float ratio) {};
+		void setExactDutyCycleA(const uint32_t absolute) {};
+		void setInterrupts(const uint32_t interrupts) { _interrupts = interrupts; };
+		void setInterruptPending() {};
+		TimerChannelInterruptOptions getInterruptCause() { return kInterruptUnknown; };
+
+		static void interrupt();
+	};
+
+	static const timer_number SysTickTimerNum = 0xFF;
+	template <>
+	struct Timer<SysTickTimerNum> {
+		static volatile uint32_t _motateTickCount;
+
+		Timer() { init(); };
+		Timer(const TimerMode mode, const uint32_t freq) { init(); };
+
+		void init() { _motateTickCount = 0; };
+		uint32_t getValue() { return _motateTickCount; };
+		void _increment() { _motateTickCount++; };
+
+		static void interrupt() __attribute__ ((weak));
+	};
+	extern Timer<SysTickTimerNum> SysTickTimer;
+
+	// Blocking delays would never end on simulated time - the tick only moves
+	// when the simulator moves it - so delay() returns at once.
+	inline void delay( uint32_t microseconds ) {}
+
+} // namespace Motate
+
+#define MOTATE_TIMER_INTERRUPT(number) template<> void Timer<number>::interrupt()
+
+#endif /* end of include guard: SIMTIMERS_H_ONCE */
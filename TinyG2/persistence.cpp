@@ -25,64 +25,356 @@
  * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include "tinyg2.h"
+#include "config.h"
 #include "persistence.h"
-
-#ifdef __cplusplus
-extern "C"{
-#endif
+#include "canonical_machine.h"
+#include "hardware.h"
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
 
 /***********************************************************************************
  **** STRUCTURE ALLOCATIONS ********************************************************
  ***********************************************************************************/
+/*
+ *	The SAM3X has no EEPROM, so values persist in a log kept in the reserved pages
+ *	at the top of flash bank 1 (see the nvm region in gcc_flash.ld). Each page holds
+ *	a header and a run of (index, value) records appended in the order they were
+ *	written. Replaying the log from the oldest live page to the newest leaves the
+ *	latest value of every index.
+ *
+ *	Pages are used round-robin by sequence number (page = seq % NVM_PAGES), so erases
+ *	are spread evenly over the region. The newest page is re-programmed in place as
+ *	records are appended to it - flash bits only go from 1 to 0, so programming the
+ *	erased slots of a page needs no erase. A page is erased only when it is reopened.
+ *
+ *	Writes only update a RAM shadow and mark the index dirty - this is the write-back
+ *	queue. persistence_callback() appends the dirty records once no value has changed
+ *	for NVM_FLUSH_DELAY_MS, so a burst of $ commands costs one page program. Pages
+ *	are programmed in the background while the machine runs if that is safe (see
+ *	_flash_command()), otherwise only once the cycle has ended.
+ *
+ *	When the ring is about to run out of room the log is compacted: a snapshot of
+ *	every stored value is appended and becomes the new oldest live page. The last
+ *	snapshot page is the first to carry the new base, so a reset part way through
+ *	a snapshot still replays the old log.
+ */
+typedef struct nvmRecord {
+	uint16_t index;						// config index, 0xFFFF if the slot is empty
+	uint16_t check;						// ~index - catches empty and torn slots
+	float value;
+} nvmRecord_t;
+
+#define NVM_HEADER_WORDS 4
+#define NVM_RECORDS_PER_PAGE ((NVM_PAGE_SIZE - NVM_HEADER_WORDS*sizeof(uint32_t)) / sizeof(nvmRecord_t))
+#define NVM_SNAPSHOT_PAGES ((NVM_INDEX_MAX + NVM_RECORDS_PER_PAGE - 1) / NVM_RECORDS_PER_PAGE)
 
+typedef struct nvmPage {
+	uint32_t magic;
+	uint32_t seq;						// page sequence number. Page lives at seq % NVM_PAGES
+	uint32_t base;						// seq of the oldest live page when this one was written
+	uint32_t check;						// ~(seq ^ base)
+	nvmRecord_t record[NVM_RECORDS_PER_PAGE];
+} nvmPage_t;
+
+typedef struct nvmSingleton {
+	uint32_t base;						// oldest live page
+	uint8_t used;						// records in the page image
+	uint8_t written;					// records of the page image already in flash
+	uint8_t programming;				// records being programmed
+	uint8_t busy;						// a page program is running
+	uint8_t async;						// firmware is all in bank 0 - program in the background
+	uint8_t failed;						// set by a flash error - stop writing until reset
+	uint8_t snapshot;					// a snapshot is being written
+	index_t cursor;						// next index to snapshot
+	uint32_t snapshot_start;			// first page of the snapshot
+	uint32_t status;					// EFC1 status of the running program
+	uint16_t dirty_count;
+	uint32_t flush_time;				// SysTick time the next flush may start
+	nvmPage_t page;						// image of the newest page
+	uint32_t valid[(NVM_INDEX_MAX+31)/32];	// index has a stored value
+	uint32_t dirty[(NVM_INDEX_MAX+31)/32];	// index has not been flushed
+	float value[NVM_INDEX_MAX];			// RAM shadow of the stored values
+} nvmSingleton_t;
+static nvmSingleton_t nvm;
 
 /***********************************************************************************
  **** GENERIC STATIC FUNCTIONS AND VARIABLES ***************************************
  ***********************************************************************************/
 
+#define NVM_MAGIC 0x314D564E			// "NVM1"
+#define NVM_FLUSH_DELAY_MS 500			// quiet time before dirty values are written
+#define NVM_ADDR (IFLASH1_ADDR + IFLASH1_SIZE - NVM_PAGES*NVM_PAGE_SIZE)
+#define NVM_FIRST_PAGE ((NVM_ADDR - IFLASH1_ADDR) / NVM_PAGE_SIZE)	// EFC1 page number
+
+#define EFC_FCMD_WP 0x01				// write page
+#define EFC_FCMD_EWP 0x03				// erase page and write page
+#define EFC_FCMD_CLB 0x09				// clear lock bit
+#define EFC_KEY 0x5A
+
+extern uint32_t _etext;					// end of the code in flash - see gcc_flash.ld
+
+#define _is_set(map,i) (map[(i)>>5] & (1UL << ((i) & 31)))
+#define _set(map,i) (map[(i)>>5] |= (1UL << ((i) & 31)))
+#define _clear(map,i) (map[(i)>>5] &= ~(1UL << ((i) & 31)))
+
+static const nvmPage_t *_flash_page(uint32_t seq)
+{
+	return ((const nvmPage_t *)(NVM_ADDR + (seq % NVM_PAGES) * NVM_PAGE_SIZE));
+}
+
+static bool _page_is_valid(const nvmPage_t *page, uint32_t seq)
+{
+	return ((page->magic == NVM_MAGIC) && (page->seq == seq) &&
+			(page->check == ~(page->seq ^ page->base)));
+}
+
+/*
+ * _flash_command() - start an EFC1 command, and optionally wait for it to finish
+ *
+ *	Nothing may be fetched from bank 1 while a command is running on it. When the
+ *	firmware fits in bank 0 (nvm.async) the command runs in the background and
+ *	persistence_callback() polls for the end, so motion and the ISRs never notice.
+ *	Otherwise it runs from RAM with interrupts off until done - a few ms - so it
+ *	is only started with the machine idle.
+ */
+__attribute__ ((long_call, section (".ramfunc")))
+static uint32_t _flash_command(uint32_t command, uint32_t page, bool wait)
+{
+	uint32_t status = 0;
+	if (wait == true) __disable_irq();
+	EFC1->EEFC_FCR = EEFC_FCR_FKEY(EFC_KEY) | EEFC_FCR_FARG(page) | EEFC_FCR_FCMD(command);
+	if (wait == true) {
+		while (((status = EFC1->EEFC_FSR) & EEFC_FSR_FRDY) == 0);
+		__enable_irq();
+	}
+	return (status);
+}
+
+/*
+ * _program_page() - start writing the page image to flash if it has unwritten records
+ * _program_done() - account for a finished page program
+ *
+ *	The image is copied into the page latch buffer by writing it to the page address.
+ *	A freshly opened page is erased on the way; later programs only fill empty slots.
+ */
+static stat_t _program_done()
+{
+	nvm.busy = false;
+	if (nvm.status & (EEFC_FSR_FCMDE | EEFC_FSR_FLOCKE)) {
+		nvm.failed = true;
+		return (STAT_INTERNAL_ERROR);
+	}
+	nvm.written = nvm.programming;
+	return (STAT_OK);
+}
+
+static stat_t _program_page()
+{
+	if ((nvm.written == nvm.used) && (nvm.written != 0)) return (STAT_NOOP);
+
+	uint32_t seq = nvm.page.seq;
+	volatile uint32_t *latch = (volatile uint32_t *)_flash_page(seq);
+	const uint32_t *image = (const uint32_t *)&nvm.page;
+	for (uint8_t i=0; i < NVM_PAGE_SIZE/sizeof(uint32_t); i++) {
+		latch[i] = image[i];
+	}
+	uint32_t command = (nvm.written == 0) ? EFC_FCMD_EWP : EFC_FCMD_WP;
+	nvm.programming = nvm.used;
+	nvm.busy = true;
+	nvm.status = _flash_command(command, NVM_FIRST_PAGE + (seq % NVM_PAGES), !nvm.async);
+	if (nvm.async == false) return (_program_done());
+	return (STAT_OK);
+}
+
+static void _open_page(uint32_t seq)
+{
+	memset(&nvm.page, 0xFF, sizeof(nvm.page));
+	nvm.page.magic = NVM_MAGIC;
+	nvm.page.seq = seq;
+	nvm.page.base = nvm.base;
+	nvm.page.check = ~(seq ^ nvm.base);
+	nvm.used = 0;
+	nvm.written = 0;
+}
+
+static void _append_record(index_t index)
+{
+	nvmRecord_t *record = &nvm.page.record[nvm.used++];
+	record->index = index;
+	record->check = ~index;
+	record->value = nvm.value[index];
+	if (_is_set(nvm.dirty, index)) {
+		_clear(nvm.dirty, index);
+		nvm.dirty_count--;
+	}
+}
+
+/*
+ * _flush_step() - fill the page image and start programming it
+ *
+ *	One page is programmed per call. A new page is opened only while there is still
+ *	room behind it for a full snapshot. Otherwise a snapshot of every stored value is
+ *	started instead and written a page at a time, which takes the dirty values along.
+ */
+static stat_t _flush_step()
+{
+	if (nvm.used == NVM_RECORDS_PER_PAGE) {		// the page is full and written
+		uint32_t next = nvm.page.seq + 1;
+		if ((nvm.snapshot == false) && ((next + 1 + NVM_SNAPSHOT_PAGES - nvm.base) > NVM_PAGES)) {
+			nvm.snapshot = true;
+			nvm.snapshot_start = next;
+			nvm.cursor = 0;
+		}
+		_open_page(next);
+	}
+	if (nvm.snapshot == true) {
+		for (; (nvm.cursor < NVM_INDEX_MAX) && (nvm.used < NVM_RECORDS_PER_PAGE); nvm.cursor++) {
+			if (_is_set(nvm.valid, nvm.cursor)) _append_record(nvm.cursor);
+		}
+		if (nvm.cursor == NVM_INDEX_MAX) {		// the last snapshot page moves the base up
+			nvm.snapshot = false;
+			nvm.base = nvm.snapshot_start;
+			nvm.page.base = nvm.base;
+			nvm.page.check = ~(nvm.page.seq ^ nvm.base);
+		}
+	} else {
+		for (index_t i=0; (i < NVM_INDEX_MAX) && (nvm.used < NVM_RECORDS_PER_PAGE); i++) {
+			if (_is_set(nvm.dirty, i)) _append_record(i);
+		}
+	}
+	return (_program_page());
+}
 
 /***********************************************************************************
  **** CODE *************************************************************************
  ***********************************************************************************/
 
+/*
+ * persistence_init() - find the newest page and replay the log into the RAM shadow
+ */
 void persistence_init()
 {
-//	cs.nvm_base_addr = NVM_BASE_ADDR;
-//	cs.nvm_profile_base = cfg.nvm_base_addr;
-	return;	
+	memset(&nvm, 0, sizeof(nvm));
+	nvm.async = ((uint32_t)&_etext <= IFLASH1_ADDR);
+	_flash_command(EFC_FCMD_CLB, NVM_FIRST_PAGE, true);	// the region is one lock region
+
+	bool found = false;
+	uint32_t head = 0;
+	for (uint32_t p=0; p<NVM_PAGES; p++) {
+		const nvmPage_t *page = (const nvmPage_t *)(NVM_ADDR + p * NVM_PAGE_SIZE);
+		if ((page->seq % NVM_PAGES != p) || (_page_is_valid(page, page->seq) == false)) continue;
+		if ((found == false) || (page->seq > head)) {
+			head = page->seq;
+			found = true;
+		}
+	}
+	if (found == false) {						// empty region - the first flush opens seq 0
+		nvm.page.seq = (uint32_t)-1;
+		nvm.used = NVM_RECORDS_PER_PAGE;
+		nvm.written = NVM_RECORDS_PER_PAGE;
+		return;
+	}
+	nvm.base = _flash_page(head)->base;
+	if ((head - nvm.base) >= NVM_PAGES) { nvm.base = head;}	// corrupt base - keep what can be trusted
+
+	for (uint32_t seq = nvm.base; seq - nvm.base <= head - nvm.base; seq++) {
+		const nvmPage_t *page = _flash_page(seq);
+		if (_page_is_valid(page, seq) == false) continue;
+		for (uint8_t r=0; r<NVM_RECORDS_PER_PAGE; r++) {
+			const nvmRecord_t *record = &page->record[r];
+			if (record->index == 0xFFFF) break;
+			if ((record->check != (uint16_t)~record->index) || (record->index >= NVM_INDEX_MAX)) continue;
+			nvm.value[record->index] = record->value;
+			_set(nvm.valid, record->index);
+		}
+	}
+
+	// continue appending to the newest page where it left off
+	memcpy(&nvm.page, _flash_page(head), sizeof(nvm.page));
+	for (nvm.used = 0; nvm.used < NVM_RECORDS_PER_PAGE; nvm.used++) {
+		if (nvm.page.record[nvm.used].index == 0xFFFF) break;
+	}
+	nvm.written = nvm.used;
 }
 
-/* 
+/*
+ * persistence_callback() - flush dirty values once they have been quiet a while
+ *
+ *	Each pass either waits on a running page program or starts the next one.
+ */
+stat_t persistence_callback()
+{
+	if (nvm.busy == true) {
+		nvm.status |= EFC1->EEFC_FSR;			// error bits clear on read, so keep them
+		if ((nvm.status & EEFC_FSR_FRDY) == 0) return (STAT_NOOP);
+		if (_program_done() != STAT_OK) return (STAT_INTERNAL_ERROR);
+	}
+	if (nvm.failed == true) return (STAT_NOOP);
+	if ((nvm.dirty_count == 0) && (nvm.snapshot == false)) return (STAT_NOOP);
+	if ((nvm.async == false) && (cm.cycle_state != CYCLE_OFF)) return (STAT_NOOP);	// would stall the ISRs
+	if ((int32_t)(SysTickTimer.getValue() - nvm.flush_time) < 0) return (STAT_NOOP);
+	return (_flush_step());
+}
+
+/*
  * read_persistent_value()	- return value (as float) by index
  * write_persistent_value() - write to NVM by index, but only if the value has changed
  *
- *	It's the responsibility of the caller to make sure the index does not exceed range
+ *	read_persistent_value() returns STAT_NOOP if nothing is stored for the index.
+ *	write_persistent_value() only updates the RAM shadow - the callback does the write.
  */
 
 stat_t read_persistent_value(cmdObj_t *cmd)
 {
-//	int8_t nvm_byte_array[NVM_VALUE_LEN];
-//	uint16_t nvm_address = cfg.nvm_profile_base + (cmd->index * NVM_VALUE_LEN);
-//	(void)EEPROM_ReadBytes(nvm_address, nvm_byte_array, NVM_VALUE_LEN);
-//	memcpy(&cmd->value, &nvm_byte_array, NVM_VALUE_LEN);
+	if (cmd->index >= NVM_INDEX_MAX) return (STAT_INTERNAL_RANGE_ERROR);
+	if (_is_set(nvm.valid, cmd->index) == 0) return (STAT_NOOP);
+	cmd->value = nvm.value[cmd->index];
 	return (STAT_OK);
 }
 
+/*
+ * read_persistent_schema()  - return the stored cfgArray schema hash, 0 if none
+ * write_persistent_schema() - store the cfgArray schema hash
+ *
+ *	The hash is kept bit for bit in the value slot of a reserved index.
+ */
+uint32_t read_persistent_schema()
+{
+	uint32_t schema = 0;
+	if (_is_set(nvm.valid, NVM_SCHEMA_INDEX)) {
+		memcpy(&schema, &nvm.value[NVM_SCHEMA_INDEX], sizeof(schema));
+	}
+	return (schema);
+}
+
+void write_persistent_schema(uint32_t schema)
+{
+	cmdObj_t cmd;
+	cmd.index = NVM_SCHEMA_INDEX;
+	memcpy(&cmd.value, &schema, sizeof(schema));
+	write_persistent_value(&cmd);
+}
+
 stat_t write_persistent_value(cmdObj_t *cmd)
 {
-//	float tmp = cmd->value;
-//	ritorno(cmd_read_NVM_value(cmd));
-//	if (cmd->value != tmp) {		// catches the isnan() case as well
-//		cmd->value = tmp;
-//		int8_t nvm_byte_array[NVM_VALUE_LEN];
-//		memcpy(&nvm_byte_array, &tmp, NVM_VALUE_LEN);
-//		uint16_t nvm_address = cfg.nvm_profile_base + (cmd->index * NVM_VALUE_LEN);
-//		(void)EEPROM_WriteBytes(nvm_address, nvm_byte_array, NVM_VALUE_LEN);
-//	}
+	if (cmd->index >= NVM_INDEX_MAX) return (STAT_INTERNAL_RANGE_ERROR);
+	if (_is_set(nvm.valid, cmd->index) &&
+		(memcmp(&nvm.value[cmd->index], &cmd->value, sizeof(float)) == 0)) {	// catches the isnan() case as well
+		return (STAT_OK);
+	}
+	nvm.value[cmd->index] = cmd->value;
+	_set(nvm.valid, cmd->index);
+	if (_is_set(nvm.dirty, cmd->index) == 0) {
+		_set(nvm.dirty, cmd->index);
+		nvm.dirty_count++;
+	}
+	nvm.flush_time = SysTickTimer.getValue() + NVM_FLUSH_DELAY_MS;
 	return (STAT_OK);
 }
 
-#ifdef __cplusplus
-}
-#endif
-
+#ifdef __cplusplus
+}
+#endif
@@ -29,11 +29,22 @@
 
 #include "config.h"
 
-#ifdef __cplusplus
-extern "C"{
-#endif 
+#ifdef __cplusplus
+extern "C"{
+#endif 
+
+/* The reserved flash region must match the nvm region in gcc_flash.ld
+ * NVM_INDEX_MAX must cover every persisted config index - see cmd_index_max()
+ */
+#define NVM_PAGE_SIZE IFLASH1_PAGE_SIZE	// 256 bytes
+#define NVM_PAGES 64					// 16K at the top of flash bank 1
+#define NVM_INDEX_MAX 640				// size of the RAM shadow
+#define NVM_SCHEMA_INDEX (NVM_INDEX_MAX-1)	// reserved for the cfgArray schema hash
 
 void persistence_init(void);
+stat_t persistence_callback(void);
+uint32_t read_persistent_schema(void);
+void write_persistent_schema(uint32_t schema);
 stat_t read_persistent_value(cmdObj_t *cmd);
 stat_t write_persistent_value(cmdObj_t *cmd);
 
@@ -23,6 +23,8 @@
 
 #include "tinyg2.h"
 #include "config.h"
+#include "controller.h"
+#include "coroutine.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
 #include "planner.h"
@@ -43,6 +45,7 @@ static stat_t _compute_center_arc(void);
 static stat_t _get_arc_radius(void);
 static float _get_arc_time (const float linear_travel, const float angular_travel, const float radius);
 static float _get_theta(const float x, const float y);
+static void _get_arc_tangent(const float radius_1, const float radius_2, float unit[]);
 
 static stat_t _setup_arc(const GCodeState_t *gm_arc, 	// gcode model state
 			  const float i, const float j, const float k,
@@ -75,7 +78,8 @@ void cm_arc_init()
  *
  * Generates an arc by queueing line segments to the move buffer.
  * The arc is approximated by generating a large number of tiny, linear
- * segments.
+ * segments. With __NATIVE_ARCS the arc is queued as a single block that
+ * the runtime interpolates instead (see mp_arc()).
  */
 stat_t cm_arc_feed(float target[], float flags[],	// arc endpoints
 				   float i, float j, float k, 		// offsets
@@ -97,10 +101,9 @@ stat_t cm_arc_feed(float target[], float flags[],	// arc endpoints
 	// This can happen when a F word or M word is by itself.
 	// (The tests below are organized for execution efficiency)
 	if ( fp_ZERO(i) && fp_ZERO(j) && fp_ZERO(k) && fp_ZERO(radius) ) {
-		if ( fp_ZERO((flags[AXIS_X] + flags[AXIS_Y] + flags[AXIS_Z] + 
-					  flags[AXIS_A] + flags[AXIS_B] + flags[AXIS_C]))) {
-			return (STAT_OK);
-		}
+		float flagged = 0;
+		for (uint8_t axis=0; axis<AXES; axis++) { flagged += flags[axis];}
+		if (fp_ZERO(flagged)) { return (STAT_OK);}
 	}
 	// set parameters and model state
 	cm_set_model_target(target,flags);
@@ -133,9 +136,19 @@ stat_t cm_arc_feed(float target[], float flags[],	// arc endpoints
 /*
  * cm_arc_callback() - generate an arc
  *
- *	cm_arc_callback() is structured as a continuation called by mp_move_dispatcher.
- *	Each time it's called it queues as many arc segments (lines) as it can 
- *	before it blocks, then returns.
+ *	cm_arc_callback() is a coroutine (see coroutine.h) run by the controller. It 
+ *	queues one arc segment (line) per pass, and parks while the planner is short of
+ *	buffers until one is freed.
+ *
+ *	Segments are generated by rotating the radius vector by segment_theta with a rotation
+ *	recurrence instead of calling sin() and cos() for each segment:
+ *
+ *		r1' = r1*cos(d) + r2*sin(d)		(theta is measured from the axis 2 direction)
+ *		r2' = r2*cos(d) - r1*sin(d)
+ *
+ *	Every ARC_CORRECTION_SEGMENTS segments the vector is recomputed exactly from the 
+ *	angle. The last segment goes to the exact endpoint. Each segment is queued with
+ *	the arc tangents at its ends so the planner can blend the segments at full feed.
  *
  *  Parts of this routine were originally sourced from the grbl project.
  */
@@ -143,22 +156,34 @@ stat_t cm_arc_feed(float target[], float flags[],	// arc endpoints
 stat_t cm_arc_callback() 
 {
 	if (arc.run_state == MOVE_STATE_OFF) { return (STAT_NOOP);}
-	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) { return (STAT_EAGAIN);}
-	if (arc.run_state == MOVE_STATE_RUN) {
-		if (--arc.segment_count > 0) {
-			arc.theta += arc.segment_theta;
-			arc.gm.target[arc.axis_1] = arc.center_1 + sin(arc.theta) * arc.radius;
-			arc.gm.target[arc.axis_2] = arc.center_2 + cos(arc.theta) * arc.radius;
-			arc.gm.target[arc.axis_linear] += arc.segment_linear_travel;
-			mp_aline(&arc.gm);								// run the line
-			copy_axis_vector(arc.position, arc.gm.target);	// update arc current position	
-			return (STAT_EAGAIN);
+
+	CO_BEGIN(arc.co);
+	while (true) {
+		CO_WAIT_EVENT(arc.co, CTL_TASK_ARC, CTL_EVENT_BUFFER, mp_get_planner_buffers_available() >= 1);
+		_get_arc_tangent(arc.radius_1, arc.radius_2, arc.entry_unit);
+		if (--arc.segment_count <= 0) break;
+		arc.theta += arc.segment_theta;
+		if ((arc.segment_count % ARC_CORRECTION_SEGMENTS) == 0) {
+			arc.radius_1 = sin(arc.theta) * arc.radius;	// exact correction
+			arc.radius_2 = cos(arc.theta) * arc.radius;
 		} else {
-			mp_aline(&arc.gm);		// do last segment to the exact endpoint
-			arc.run_state = MOVE_STATE_OFF;
+			float radius_1 = arc.radius_1 * arc.cos_segment + arc.radius_2 * arc.sin_segment;
+			arc.radius_2 = arc.radius_2 * arc.cos_segment - arc.radius_1 * arc.sin_segment;
+			arc.radius_1 = radius_1;
 		}
+		arc.gm.target[arc.axis_1] = arc.center_1 + arc.radius_1;
+		arc.gm.target[arc.axis_2] = arc.center_2 + arc.radius_2;
+		arc.gm.target[arc.axis_linear] += arc.segment_linear_travel;
+		_get_arc_tangent(arc.radius_1, arc.radius_2, arc.exit_unit);
+		mp_arc_segment(&arc.gm, arc.entry_unit, arc.exit_unit, arc.radius);	// run the line
+		copy_axis_vector(arc.position, arc.gm.target);	// update arc current position	
+		CO_YIELD(arc.co);
 	}
-	return (STAT_OK);
+	copy_axis_vector(arc.gm.target, arc.endpoint);
+	_get_arc_tangent(arc.endpoint[arc.axis_1] - arc.center_1, arc.endpoint[arc.axis_2] - arc.center_2, arc.exit_unit);
+	mp_arc_segment(&arc.gm, arc.entry_unit, arc.exit_unit, arc.radius);	// do last segment to the exact endpoint
+	arc.run_state = MOVE_STATE_OFF;
+	CO_END(arc.co);
 }
 
 /*
@@ -183,6 +208,14 @@ void cm_abort_arc()
 /*
  * _setup_arc() - setup an arc move for runtime
  *
+ *	The feed is capped once for the whole arc so the centripetal acceleration stays 
+ *	under the junction acceleration ($ja): v = sqrt(ja * r). Only the arc plane part 
+ *	of a helix turns, so the cap is divided by that part of the path. A capped arc 
+ *	takes longer, which is what the segments are sized and timed from - they ask the
+ *	planner for the capped velocity as their cruise, and a small arc at a high feed
+ *	gets the segments its run time allows rather than those of the feed it was given.
+ *	Large arcs run at full feed.
+ *
  *  Parts of this routine were originally sourced from the grbl project.
  */
 static stat_t _setup_arc(const GCodeState_t *gm_arc, 	// gcode model state
@@ -199,20 +232,25 @@ static stat_t _setup_arc(const GCodeState_t *gm_arc, 	// gcode model state
 {
 	if (arc.run_state != MOVE_STATE_OFF) { return (STAT_INTERNAL_ERROR); } // (not supposed to fail)
 
+#ifdef __NATIVE_ARCS
+	return (mp_arc(gm_arc, gmx.position[axis_1] - sin(theta) * radius,	// arc center
+						   gmx.position[axis_2] - cos(theta) * radius,
+				   theta, radius, angular_travel, linear_travel, axis_1, axis_2, axis_linear));
+#else
 	arc.gm.linenum = cm_get_linenum(MODEL);
 
 	// length is the total mm of travel of the helix (or just a planar arc)
 	arc.length = hypot(angular_travel * radius, fabs(linear_travel));
-	if (arc.length < cm.arc_segment_len) return (STAT_MINIMUM_LENGTH_MOVE_ERROR); // too short to draw
+	if (arc.length < MIN_LENGTH_MOVE) return (mp_aline(gm_arc));	// too short to draw - held as a residual
 
 	// load the arc controller singleton
 	memcpy(&arc.gm, gm_arc, sizeof(GCodeState_t));	// get the entire GCode context - some will be overwritten to run segments
 	copy_axis_vector(arc.position, gmx.position);	// set initial arc position from gcode model
 
-	arc.endpoint[axis_1] = gm_arc->target[0];		// save the arc endpoint
-	arc.endpoint[axis_2] = gm_arc->target[1];
-	arc.endpoint[axis_linear] = gm_arc->target[2];
-	arc.arc_time = gm_arc->move_time;
+	copy_axis_vector(arc.endpoint, gm_arc->target);	// save the arc endpoint
+	float planar = fabs(angular_travel) * radius / arc.length;	// arc plane part of the path
+	float vmax = sqrt(radius * cm.junction_acceleration) / max(planar, EPSILON);
+	arc.arc_time = max(gm_arc->move_time, arc.length / vmax);	// centripetal limit
 	arc.theta = theta;
 	arc.radius = radius;
 	arc.axis_1 = axis_1;
@@ -221,13 +259,16 @@ static stat_t _setup_arc(const GCodeState_t *gm_arc, 	// gcode model state
 	arc.angular_travel = angular_travel;
 	arc.linear_travel = linear_travel;
 	
-	// Find the minimum number of segments that meets these constraints...
-	float segments_required_for_chordal_accuracy = arc.length / sqrt(4*cm.chordal_tolerance * (2 * radius - cm.chordal_tolerance));
-	float segments_required_for_minimum_distance = arc.length / cm.arc_segment_len;
-	float segments_required_for_minimum_time = arc.arc_time * MICROSECONDS_PER_MINUTE / MIN_ARC_SEGMENT_USEC;
-	arc.segments = floor(min3(segments_required_for_chordal_accuracy,
-							  segments_required_for_minimum_distance,
-							  segments_required_for_minimum_time));
+	// The chordal tolerance sets the number of segments from the radius...
+	float segments = 1;
+	if (cm.chordal_tolerance < radius) {
+		float chord = sqrt(4*cm.chordal_tolerance * (2 * radius - cm.chordal_tolerance));
+		segments = ceil(fabs(angular_travel) * radius / max(chord, EPSILON));
+	}
+	//...unless the segments would be shorter or quicker than the planner can run
+	float segments_allowed_by_minimum_distance = floor(arc.length / cm.arc_segment_len);
+	float segments_allowed_by_minimum_time = floor(arc.arc_time * MICROSECONDS_PER_MINUTE / MIN_SEGMENT_USEC);
+	arc.segments = min3(segments, segments_allowed_by_minimum_distance, segments_allowed_by_minimum_time);
 
 	arc.segments = max(arc.segments,1);				//...but is at least 1 segment
 	arc.gm.move_time = arc.arc_time / arc.segments;	// gcode state struct gets segment_time, not arc time
@@ -235,11 +276,22 @@ static stat_t _setup_arc(const GCodeState_t *gm_arc, 	// gcode model state
 	arc.segment_count = (uint32_t)arc.segments;
 	arc.segment_theta = arc.angular_travel / arc.segments;
 	arc.segment_linear_travel = arc.linear_travel / arc.segments;
-	arc.center_1 = arc.position[arc.axis_1] - sin(arc.theta) * arc.radius;
-	arc.center_2 = arc.position[arc.axis_2] - cos(arc.theta) * arc.radius;
+	arc.sin_segment = sin(arc.segment_theta);
+	arc.cos_segment = cos(arc.segment_theta);
+	arc.radius_1 = sin(arc.theta) * arc.radius;
+	arc.radius_2 = cos(arc.theta) * arc.radius;
+	arc.center_1 = arc.position[arc.axis_1] - arc.radius_1;
+	arc.center_2 = arc.position[arc.axis_2] - arc.radius_2;
+	for (uint8_t axis=0; axis<AXES; axis++) {		// only the arc axes have tangent components
+		arc.entry_unit[axis] = 0;
+		arc.exit_unit[axis] = 0;
+	}
 	arc.gm.target[arc.axis_linear] = arc.position[arc.axis_linear];
 	arc.run_state = MOVE_STATE_RUN;
+	arc.co = 0;
+	controller_set_ready(CTL_TASK_ARC);
 	return (STAT_OK);
+#endif // __NATIVE_ARCS
 }
 
 /*
@@ -297,8 +349,6 @@ static stat_t _compute_center_arc()
 
 	// Trace the arc
 	cm_set_work_offsets(&gm);						// capture the fully resolved offsets to the state
-	set_vector(gm.target[gmx.plane_axis_0], gm.target[gmx.plane_axis_1], gm.target[gmx.plane_axis_2],
-			   gm.target[AXIS_A], gm.target[AXIS_B], gm.target[AXIS_C]);
 
 	return(_setup_arc(&gm, gmx.arc_offset[gmx.plane_axis_0],
 					   gmx.arc_offset[gmx.plane_axis_1],
@@ -443,18 +493,33 @@ static float _get_arc_time (const float linear_travel, 		// in mm
 	} else {
 		move_time = sqrt(square(planar_travel) + square(linear_travel)) / gm.feed_rate;
 	}
-	if ((tmp = planar_travel/cm.a[gmx.plane_axis_0].feedrate_max) > move_time) {
+	if ((tmp = planar_travel * cm.recip_feedrate_max[gmx.plane_axis_0]) > move_time) {
 		move_time = tmp;
 	}
-	if ((tmp = planar_travel/cm.a[gmx.plane_axis_1].feedrate_max) > move_time) {
+	if ((tmp = planar_travel * cm.recip_feedrate_max[gmx.plane_axis_1]) > move_time) {
 		move_time = tmp;
 	}
-	if ((tmp = fabs(linear_travel/cm.a[gmx.plane_axis_2].feedrate_max)) > move_time) {
+	if ((tmp = fabs(linear_travel * cm.recip_feedrate_max[gmx.plane_axis_2])) > move_time) {
 		move_time = tmp;
 	}
 	return (move_time);
 }
 
+/*
+ * _get_arc_tangent() - unit tangent of the arc at the point with the given radius vector
+ *
+ *	Theta is measured from the axis 2 direction, so the radius vector is R*(sin, cos) 
+ *	and its derivative along the path is (cos, -sin) scaled by the radians per mm.
+ */
+
+static void _get_arc_tangent(const float radius_1, const float radius_2, float unit[])
+{
+	float dtheta = arc.angular_travel / arc.length;	// radians per mm of path
+	unit[arc.axis_1] = radius_2 * dtheta;
+	unit[arc.axis_2] = -radius_1 * dtheta;
+	unit[arc.axis_linear] = arc.linear_travel / arc.length;
+}
+
 /* 
  * _get_theta(float x, float y)
  *
@@ -477,21 +542,6 @@ static float _get_theta(const float x, const float y)
 	}
 }
 
-//##########################################
-//############## UNIT TESTS ################
-//##########################################
-
-#ifdef __UNIT_TESTS
-#ifdef __UNIT_TEST_PLANNER
-
-void mp_plan_arc_unit_tests()
-{
-//	_mp_test_buffers();
-}
-
-#endif
-#endif
-
 #ifdef __cplusplus
 }
 #endif
@@ -26,9 +26,17 @@ extern "C"{
 
 // See planner.h for MM_PER_ARC_SEGMENT setting
 
+/* ARC_CORRECTION_SEGMENTS
+ *	Segments are generated by rotating the radius vector by a fixed step angle.
+ *	Every ARC_CORRECTION_SEGMENTS segments the vector is recomputed with sin() and cos()
+ *	so the rounding error of the recurrence can't build up. See cm_arc_callback()
+ */
+#define ARC_CORRECTION_SEGMENTS 12
+
 typedef struct arArcSingleton {	// persistent planner and runtime variables
 	magic_t magic_start;
 	uint8_t run_state;			// runtime state machine sequence
+	uint16_t co;				// resume point of cm_arc_callback() - a coContext_t (see coroutine.h)
 
 	float endpoint[AXES];		// arc endpoint position
 	float position[AXES];		// accumulating runtime position
@@ -49,6 +57,12 @@ typedef struct arArcSingleton {	// persistent planner and runtime variables
 	float segment_linear_travel;// linear motion per segment
 	float center_1;				// center of circle at axis 1 (typ X)
 	float center_2;				// center of circle at axis 2 (typ Y)
+	float radius_1;				// radius vector from the center at axis 1
+	float radius_2;				// radius vector from the center at axis 2
+	float sin_segment;			// sin and cos of segment_theta for the rotation recurrence
+	float cos_segment;
+	float entry_unit[AXES];		// arc tangents at the segment ends (see mp_arc_segment())
+	float exit_unit[AXES];
 
 	GCodeState_t gm;			// Gcode state struct is passed for each arc segment. Usage:
 //	uint32_t linenum;			// line number of the arc feed move - same for each segment
@@ -28,13 +28,22 @@
 
 #include "tinyg2.h"
 #include "config.h"
+#include "hardware.h"
 #include "controller.h"
 #include "canonical_machine.h"
 #include "plan_line.h"
 #include "planner.h"
 #include "kinematics.h"
+#include "shaper.h"
+#include "pressure.h"
 #include "stepper.h"
+#include "pwm.h"
+#include "spindle.h"
 #include "report.h"
+#include "event_log.h"
+#include "block_log.h"
+#include "benchmark.h"
+#include "preflight.h"
 #include "util.h"
 
 #ifdef __cplusplus
@@ -42,38 +51,293 @@ extern "C"{
 #endif
 
 // aline planner routines / feedhold planning
+static stat_t _plan_aline(const GCodeState_t *gm_line, const mpArc_t *tangents);
+static uint8_t _coalesce_aline(const GCodeState_t *gm_line);
+static void _extend_aline(mpBuf_t *bf, const uint32_t linenum, const float target[], const float move_time);
+static uint8_t _extendable(const mpBuf_t *bf);
+static uint8_t _unreached(const mpBuf_t *bf);
+static uint8_t _mergeable(const mpBuf_t *bf, const GCodeState_t *gm_line);
+static uint8_t _batch_ready(const mpBuf_t *bf);
+static uint8_t _batch_lead(void);
+static stat_t _hold_residual(const GCodeState_t *gm_line);
+static float _take_residual_time(void);
+static void _set_aline_terms(mpBuf_t *bf, const float position[], const float length);
+static void _set_velocity_terms(mpBuf_t *bf, const float cruise_vmax);
+static const float *_get_entry_unit(const mpBuf_t *bf);
+static const float *_get_exit_unit(const mpBuf_t *bf);
+static float _update_override_factor(void);
 static void _plan_block_list(mpBuf_t *bf, uint8_t *mr_flag);
 static void _calculate_trapezoid(mpBuf_t *bf);
+static void _compute_trapezoid(mpBuf_t *bf);
+static float _get_ht_velocity(const mpBuf_t *bf);
 static float _get_target_length(const float Vi, const float Vt, const mpBuf_t *bf);
 static float _get_target_velocity(const float Vi, const float L, const mpBuf_t *bf);
 //static float _get_intersection_distance(const float Vi_squared, const float Vt_squared, const float L, const mpBuf_t *bf);
 static float _get_junction_vmax(const float a_unit[], const float b_unit[]);
-static void _reset_replannable_list(void);
+static float _get_jerk_junction_vmax(const float a_unit[], const float b_unit[]);
+static float _get_blend_vmax(const mpBuf_t *bf);
+static void _plan_forward(mpBuf_t *bp, const mpBuf_t *end, float entry_velocity, const uint8_t lazy);
+static void _plan_restart(void);
+static void _raise_running_exit(mpBuf_t *bp);
+static void _prep_sections(mpBuf_t *bf);
+static void _prep_section(mpSection_t *s, const uint8_t section, const float length, const float v_start,
+						  const float v_end, const float length_max, const float backoff);
+static float _get_segment_length_max(const mpBuf_t *bf);
 
 // execute routines (NB: These are all called from the LO interrupt)
-static stat_t _exec_aline(mpBuf_t *bf);
-static stat_t _exec_aline_head(void);
-static stat_t _exec_aline_body(void);
-static stat_t _exec_aline_tail(void);
-static stat_t _exec_aline_segment(uint8_t correction_flag);
-static void _init_forward_diffs(float t0, float t2);
+static stat_t _exec_aline(mpBuf_t *bf) RAMFUNC;		// see __RAM_ISR
+static stat_t _exec_aline_head(void) RAMFUNC;
+static stat_t _exec_aline_body(void) RAMFUNC;
+static stat_t _exec_aline_tail(void) RAMFUNC;
+static stat_t _exec_aline_segment(uint8_t correction_flag) RAMFUNC;
+static stat_t _load_section(const uint8_t section, const float length, const float v_start, const float v_end) RAMFUNC;
+static void _init_forward_diffs(mpSection_t *s, float t0, float t2) RAMFUNC;
+static float _get_segment_velocity(uint8_t next) RAMFUNC;
+static float _get_scurve_segments(float half_usec, float delta_v, float length, float length_max, float backoff);
+static float _get_height_offset(const float target[]);
+#ifdef __FIXED_POINT_RUNTIME
+static void _segment_kinematics(const int32_t counts[], float travel[], int32_t substeps[], 
+								const float microseconds, const float height_offset);
+#endif
+static float _get_segment_power(void);
+#ifdef __NATIVE_ARCS
+static uint8_t _fit_arc(const GCodeState_t *gm_line);
+static float _get_fit_travel(const float theta, const float theta_to, const float direction);
+static void _set_arc_terms(mpBuf_t *bf, const float theta, const float angular_travel, const float linear_travel);
+static void _get_arc_unit(const mpArc_t *arc, const float theta, float unit[]);
+static void _advance_arc(const float length, float target[]);
+#endif
+static stat_t _exec_pvt(mpBuf_t *bf) RAMFUNC;
+static stat_t _queue_pvt(const GCodeState_t *gm_line, const float target[], const float velocity[], const float seconds);
+static float _get_profile_time(const float length, float *velocity, const float jerk);
+static float _get_dogleg_position(const float t, const float length, const float velocity, const float jerk, 
+								  const float head, const float time, float *v);
+static void _get_pvt_position(const float s, float position[]);
+static stat_t _exec_jog(mpBuf_t *bf) RAMFUNC;
+static float _get_jog_travel(const uint8_t axis, const float velocity) RAMFUNC;
+static int32_t _raster_alloc(const uint16_t count);
+static void _prep_raster(const float target[]);
 //static float _compute_next_segment_velocity(void);
 
 /* Runtime-specific setters and getters
  *
  * mp_get_runtime_velocity() 		- returns current velocity (aggregate)
- * mp_get_runtime_machine_position() - returns current axis position in machine coordinates
+ * mp_get_runtime_absolute_position() - returns current axis position in machine coordinates
+ * mp_get_runtime_reported_position() - ...the same, from the runtime snapshot
  * mp_get_runtime_work_position() 	- returns current axis position in work coordinates
  *									  that were in effect at move planning time
  * mp_set_runtime_work_offset()
  * mp_zero_segment_velocity() 		- correct velocity in last segment for reporting purposes
+ * mp_publish_runtime()				- update the runtime snapshot (exec level)
+ * mp_hold_runtime_snapshot()		- hold one snapshot for the whole of a report
+ *
+ *	The velocity, work position and reported position are for reports and come from
+ *	the runtime snapshot (see RUNTIME SNAPSHOT in planner.h). The absolute position 
+ *	is the live value the exec and the cycles work from. With __FIXED_POINT_RUNTIME 
+ *	it is a 64 bit value the exec interrupt may be writing while it is being read, 
+ *	so it is read until two reads agree.
  */
 
-float mp_get_runtime_velocity(void) { return (mr.segment_velocity);}
+#ifdef __FIXED_POINT_RUNTIME
+static fixed_t _fx_read(const volatile fixed_t *fx)
+{
+	fixed_t value;
+	do { value = *fx;} while (value != *fx);
+	return (value);
+}
+
+#define _to_runtime_at(v,t) ((fixed_t)((v) * (t) * FX_ONE))	// mm/min to Q32.32 mm per segment of t minutes
+#define _to_runtime(v) _to_runtime_at(v, mr.segment_move_time)
+
+float mp_get_runtime_absolute_position(uint8_t axis) { return ((float)_fx_read(&mr.position[axis]) / FX_ONE);}
+#else
+#define _to_runtime_at(v,t) (v)
+#define _to_runtime(v) (v)
+
 float mp_get_runtime_absolute_position(uint8_t axis) { return (mr.position[axis]);}
-float mp_get_runtime_work_position(uint8_t axis) { return (mr.position[axis] - mr.gm.work_offset[axis]);}
-void mp_set_runtime_work_offset(float offset[]) { copy_axis_vector(mr.gm.work_offset, offset);}
-void mp_zero_segment_velocity() { mr.segment_velocity = 0;}
+#endif
+
+static mpRuntimeSnapshot_t mrs;			// the main loop's copy of mr.snapshot
+static uint8_t mrs_held = false;		// TRUE while a report holds mrs
+
+void mp_publish_runtime()
+{
+	mr.snapshot.sequence++;				// odd - readers retry
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		mr.snapshot.position[axis] = mp_get_runtime_absolute_position(axis);
+		mr.snapshot.work_offset[axis] = mr.gm.work_offset[axis];
+	}
+	mr.snapshot.velocity = _get_segment_velocity(false) * mr.override_factor;
+	mr.snapshot.sequence++;				// even - whole again
+}
+
+static const mpRuntimeSnapshot_t *_get_snapshot()
+{
+	if (mrs_held == true) { return (&mrs);}
+	uint32_t sequence;
+	do {
+		while ((sequence = mr.snapshot.sequence) & 1);	// the exec is writing (only from an interrupt)
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			mrs.position[axis] = mr.snapshot.position[axis];
+			mrs.work_offset[axis] = mr.snapshot.work_offset[axis];
+		}
+		mrs.velocity = mr.snapshot.velocity;
+	} while (sequence != mr.snapshot.sequence);
+	mrs.sequence = sequence;
+	return (&mrs);
+}
+
+void mp_hold_runtime_snapshot(uint8_t hold)
+{
+	mrs_held = false;
+	if (hold == true) {
+		_get_snapshot();
+		mrs_held = true;
+	}
+}
+
+float mp_get_runtime_velocity(void) { return (_get_snapshot()->velocity);}
+float mp_get_runtime_reported_position(uint8_t axis) { return (_get_snapshot()->position[axis]);}
+float mp_get_runtime_work_position(uint8_t axis) 
+{
+	const mpRuntimeSnapshot_t *snap = _get_snapshot();
+	return (snap->position[axis] - snap->work_offset[axis]);
+}
+void mp_set_runtime_work_offset(float offset[]) { copy_axis_vector(mr.gm.work_offset, offset); mp_publish_runtime();}
+void mp_zero_segment_velocity() { mr.segment_velocity = 0; mp_publish_runtime();}
+
+/*
+ * mp_check_exec_budget() - check an exec run against the segment time and back off if over
+ * mp_reset_exec_budget() - return to nominal segment times
+ *
+ *	mp_check_exec_budget() is called from the exec ISR with the cycles taken by an 
+ *	mp_exec_move() that prepped a line segment. Returns true if it was over budget. 
+ *	The longer segment times take effect from the next section, so the backoff
+ *	steps up at most once per section. See EXEC_BUDGET_RATIO
+ */
+uint8_t mp_check_exec_budget(uint32_t cycles)
+{
+	if (cycles < (mr.microseconds * EXEC_BUDGET_RATIO * (F_CPU / 1000000))) { return (false);}
+	if (mr.backoff_section == false) {			// back off once per section
+		mr.segment_backoff = min(mr.segment_backoff * EXEC_BACKOFF_STEP, EXEC_BACKOFF_MAX);
+		mr.backoff_section = true;
+	}
+	return (true);
+}
+
+void mp_reset_exec_budget() { mr.segment_backoff = 1;}
+
+/*
+ * mp_feed_rate_override() - set feed override factor (M50, M50.1)
+ * mp_traverse_override()  - set traverse override factor (M50.2, M50.3)
+ * _update_override_factor() - step the runtime override ramp by one segment
+ *
+ *	Overrides are done by time-scaling in the runtime. The planned path and velocity 
+ *	profile stay as they are, and _exec_aline_segment() divides each segment's time by
+ *	the override factor. The change takes effect on the next segment, rather than after
+ *	the planner queue drains. Time-scaling applies to every queued block the same way, 
+ *	so the queue does not need replanning. Velocity scales with the factor, accel with 
+ *	its square and jerk with its cube. The blocks are planned up to the velocity, accel 
+ *	and jerk limits, so time-scaling can only slow them: the factor is limited to 
+ *	FEED_OVERRIDE_MIN..MAX, and MAX is 1. A dial above 100% runs at 100%.
+ *
+ *	The factor follows a smoothstep ramp lasting FEED_OVERRIDE_RAMP_TIME, so its rate 
+ *	of change starts and ends at zero and steps in the dial don't show up as jerk. A 
+ *	new request mid-ramp starts a new ramp from the current factor. Traverses (G0) 
+ *	use the traverse override. Everything else uses the feed override.
+ *
+ *	Spindle synchronized blocks (G33, G84) take measured / programmed spindle speed 
+ *	as the factor instead, every segment and with no ramp - the spindle's own inertia 
+ *	is the ramp (see spindle.h). A block after them ramps back from there.
+ *
+ *	The starved queue factor (see mp_starve_callback()) scales both on top of the dial.
+ *	The spindle load factor (see load_control.h) scales feeds on top of the ramp, every
+ *	segment - its controller already changes it smoothly.
+ *
+ *	These are called from the main loop. They only write the requested factors, which 
+ *	are single floats, so the runtime can pick them up at any segment.
+ */
+
+stat_t mp_feed_rate_override(uint8_t flag, float parameter)
+{
+	mr.feed_override = (flag == true) ? max(FEED_OVERRIDE_MIN, min(parameter, FEED_OVERRIDE_MAX)) : 1;
+	return (STAT_OK);
+}
+
+stat_t mp_traverse_override(uint8_t flag, float parameter)
+{
+	mr.traverse_override = (flag == true) ? max(FEED_OVERRIDE_MIN, min(parameter, FEED_OVERRIDE_MAX)) : 1;
+	return (STAT_OK);
+}
+
+/*
+ * mp_starve_callback() - slow the feed while the planner queue runs short
+ *
+ *	When the host sends moves slower than the machine runs them, the queue drains, the
+ *	last block is planned to a stop each time, and the motion goes stop-start. With 
+ *	$sqt set the feed is slowed instead, in proportion to how far the queued motion 
+ *	time is below $sqt and down to STARVE_OVERRIDE_MIN. Slowing the whole queue makes
+ *	it last longer, so it settles at the feed the host can keep up with. As the queue
+ *	refills the factor goes back up to 1.
+ *
+ *	A queue that runs short because the input has stopped - the end of a job - isn't
+ *	starved: nothing slower would keep it going. So the feed is only slowed while 
+ *	blocks are still coming in, one within the last STARVE_IDLE_INTERVALS. It is held
+ *	through a stop between blocks (cycle off) so the next ones start slow too, and is 1 
+ *	in homing, probing and jogging cycles and in a feedhold.
+ *
+ *	It is an override factor like the dial (see mp_feed_rate_override()), so the 
+ *	runtime ramps to it and nothing is replanned. It is adjusted every STARVE_INTERVAL_MS,
+ *	the ramp time, so each ramp finishes before the next starts.
+ */
+
+stat_t mp_starve_callback()
+{
+	if ((SysTickTimer.getValue() - mm.starve_tick) < STARVE_INTERVAL_MS) { return (STAT_NOOP);}
+	mm.starve_tick = SysTickTimer.getValue();
+
+	if (mm.starve_seq != mb.seq_taken) {
+		mm.starve_seq = mb.seq_taken;
+		mm.starve_idle = 0;
+	} else if (mm.starve_idle < STARVE_IDLE_INTERVALS) {
+		mm.starve_idle++;
+	}
+	float factor = 1;
+	if ((cm.starve_queue_time > 0) && (mm.starve_idle < STARVE_IDLE_INTERVALS) && (cm.hold_state == FEEDHOLD_OFF) &&
+		((cm.cycle_state == CYCLE_MACHINING) || (cm.cycle_state == CYCLE_OFF))) {
+		factor = max(STARVE_OVERRIDE_MIN, min((float)mp_get_planner_queue_time() / cm.starve_queue_time, 1));
+	}
+	mr.starve_override = factor;
+	return (STAT_OK);
+}
+
+static float _update_override_factor()
+{
+	if (mr.gm.spindle_sync > 0) {				// follow the spindle
+		mr.override_factor = max(FEED_OVERRIDE_MIN, min(cm_get_spindle_rpm() / mr.gm.spindle_sync, FEED_OVERRIDE_MAX));
+		mr.override_end = mr.override_factor;
+		return (mr.override_factor);
+	}
+	float target = (mr.gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) ? mr.traverse_override : mr.feed_override;
+	target = max(target * mr.starve_override, FEED_OVERRIDE_MIN);
+
+	if (fp_NE(target, mr.override_end)) {		// start a new ramp
+		mr.override_begin = mr.override_factor;
+		mr.override_end = target;
+		mr.override_elapsed = 0;
+	}
+	if (fp_NE(mr.override_factor, mr.override_end)) {
+		mr.override_elapsed += mr.segment_move_time / mr.override_factor;	// real time of the last segment
+		float u = mr.override_elapsed / FEED_OVERRIDE_RAMP_TIME;
+		if (u >= 1) {
+			mr.override_factor = mr.override_end;
+		} else {
+			mr.override_factor = mr.override_begin + (mr.override_end - mr.override_begin) * square(u) * (3 - 2*u);
+		}
+	}
+	if (mr.gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) { return (mr.override_factor);}
+	return (max(mr.override_factor * mr.load_override, FEED_OVERRIDE_MIN));
+}
 
 /* 
  * mp_get_runtime_busy() - return TRUE if motion control busy (i.e. robot is moving)
@@ -101,62 +365,349 @@ uint8_t mp_get_runtime_busy()
  * 	Note: All math is done in absolute coordinates using "float precision" 
  *	floating point (even though AVRgcc does this as single precision)
  *
- *	Note: Returning a status that is not STAT_OK means the endpoint is NOT
- *	advanced. So lines that are too short to move will accumulate and get 
- *	executed once the accumulated error exceeds the minimums 
+ *	Note: Moves shorter than MIN_LENGTH_MOVE are not rejected. They are held as
+ *	a residual (see _hold_residual()) and return STAT_OK, so the model moves on 
+ *	to their endpoint. The planner position stays put, so the next move that is 
+ *	long enough to plan starts from there and takes the residual with it. 
+ *
+ *	mp_aline() counts calls and CPU cycles in mm for the planner benchmark
  */
 
 stat_t mp_aline(const GCodeState_t *gm_line)
+{
+	uint32_t start = hw_get_cycle_count();
+	stat_t status = _plan_aline(gm_line, NULL);
+	mm.aline_cycles += hw_get_cycle_count() - start;	// uint32_t math handles counter wrap
+	mm.aline_count++;
+	return (status);
+}
+
+/*
+ * mp_arc_segment() - plan a line segment of an arc
+ *
+ *	The segment runs as a line along its chord, but junctions are planned with the
+ *	tangents of the arc at its ends. Consecutive segments of an arc then blend at 
+ *	full feed, and so do tangential transitions between arcs and lines. The segment
+ *	time already holds the centripetal limit of the arc (see _setup_arc()), so its 
+ *	cruise is planned as for any line. See cm_arc_callback()
+ */
+
+stat_t mp_arc_segment(const GCodeState_t *gm_line, const float entry_unit[], const float exit_unit[], const float radius)
+{
+	mpArc_t tangents;
+	memset(&tangents, 0, sizeof(mpArc_t));
+	copy_axis_vector(tangents.entry_unit, entry_unit);
+	copy_axis_vector(tangents.exit_unit, exit_unit);
+	tangents.radius = radius;
+
+	uint32_t start = hw_get_cycle_count();
+	stat_t status = _plan_aline(gm_line, &tangents);
+	mm.aline_cycles += hw_get_cycle_count() - start;
+	mm.aline_count++;
+	return (status);
+}
+
+static stat_t _plan_aline(const GCodeState_t *gm_line, const mpArc_t *tangents)
 {
 	mpBuf_t *bf; 						// current move pointer
-	float exact_stop = 0;
-	float junction_velocity;
 
-	// trap error conditions
+	if (pf.state != PREFLIGHT_OFF) { pf_target(gm_line);}	// extents and soft limits of the job
+
+	// merge short collinear feeds into the newest block
+	if (_coalesce_aline(gm_line) == true) { return (STAT_OK);}
+#ifdef __NATIVE_ARCS
+	if (_fit_arc(gm_line) == true) { return (STAT_OK);}	// or fit it and the newest block to an arc
+#endif
+
+	// hold moves too short to plan until there is enough to plan
 	float length = get_axis_vector_length(gm_line->target, mm.position);
-	if (length < MIN_LENGTH_MOVE) { return (STAT_MINIMUM_LENGTH_MOVE_ERROR);}
+	if ((length < MIN_LENGTH_MOVE) || 
+		(((mm.residual_time + gm_line->move_time) < MIN_TIME_MOVE) && (length < cm.coalesce_tolerance / 2))) {
+		return (_hold_residual(gm_line));
+	}
 //	if (gm_line->move_time < MIN_TIME_MOVE) { return (STAT_MINIMUM_TIME_MOVE_ERROR);}	// remove this line
 
 	// get a cleared buffer and setup move variables
 	if ((bf = mp_get_write_buffer()) == NULL) { return(cm_alarm(STAT_BUFFER_FULL_FATAL));} // never supposed to fail
 
-	memcpy(&bf->gm, gm_line, sizeof(GCodeState_t));	// copy model state into planner
-	bf->bf_func = _exec_aline;					// register the callback to the exec function
-	bf->length = length;
-
-	// compute both the unit vector and the jerk term in the same pass for efficiency
-	float diff = bf->gm.target[AXIS_X] - mm.position[AXIS_X];
-	if (fp_NOT_ZERO(diff)) {
-		bf->unit[AXIS_X] = diff / length;
-		bf->jerk = square(bf->unit[AXIS_X] * cm.a[AXIS_X].jerk_max);
-	}
-	if (fp_NOT_ZERO(diff = bf->gm.target[AXIS_Y] - mm.position[AXIS_Y])) {
-		bf->unit[AXIS_Y] = diff / length;
-		bf->jerk += square(bf->unit[AXIS_Y] * cm.a[AXIS_Y].jerk_max);
+	mp_bind_gcode_state(bf, gm_line);			// load the block record from the model
+	bf->gm->move_time += _take_residual_time();	// the block runs any held moves too
+	bf->bf_func = _exec_aline;					// register the callback to the exec function
+	if (tangents != NULL) {						// arc segments plan junctions on the arc tangents
+		memcpy(bf->arc, tangents, sizeof(mpArc_t));
+		bf->move_code = MOVE_CODE_ARC_SEGMENT;
 	}
-	if (fp_NOT_ZERO(diff = bf->gm.target[AXIS_Z] - mm.position[AXIS_Z])) {
-		bf->unit[AXIS_Z] = diff / length;
-		bf->jerk += square(bf->unit[AXIS_Z] * cm.a[AXIS_Z].jerk_max);
+	_set_aline_terms(bf, mm.position, length);
+	copy_axis_vector(mm.coalesce_start, mm.position);	// setup for coalescing following moves
+	copy_axis_vector(mm.coalesce_unit, bf->unit);
+	copy_axis_vector(mm.position, bf->gm->target);		// update planning position
+
+	bf->move_type = MOVE_TYPE_ALINE;					// as it will be queued - the next block looks
+	mb.batch++;
+	if (_batch_ready(bf) == true) { mp_plan_batch();}	// replan block list and commit the batch
+	return (STAT_OK);
+}
+
+/*
+ * mp_plan_batch()			- plan the blocks taken since the last queued one in one pass and queue them
+ * mp_plan_batch_callback() - plan the batch unless more blocks are coming (main loop)
+ * _batch_ready()			- true if the batch ending in block bf should be planned now
+ * _batch_lead()			- true if enough motion is queued after the running block to wait
+ *
+ *	Planning each block as it is taken replans the same tail of the queue once for 
+ *	every line of a packet of short lines. While more input is waiting, up to $pbs
+ *	line blocks are taken, their vmax terms set and left LOADING after mb.q. The exec
+ *	only runs QUEUED blocks, so it can't reach them - the queue ahead of them ends in a
+ *	block planned to stop as it always does. Then one _plan_block_list() pass plans
+ *	from the newest back through the batch, and the blocks are queued.
+ *
+ *	The backward pass stops at the first braking velocity that doesn't change. A batched
+ *	block has never been planned, so each one but the newest is given a braking velocity
+ *	no pass can compute first. A block that can't be replanned (exact stop) is planned 
+ *	at once with the batch before it, as a backward pass stops at it.
+ *
+ *	The batch is planned when it is full, when the input runs dry, the planner runs out 
+ *	of buffers or a feedhold is asked for (mp_plan_batch_callback(), ahead of everything
+ *	else on each controller pass), and as soon as less than PLANNER_BATCH_QUEUE_MS of 
+ *	motion is queued after the running block, so the runtime doesn't stop while blocks
+ *	wait. Anything else that queues - a command, dwell, native arc or hold - plans it 
+ *	first (see mp_plan_residual()). Coalescing and arc fitting extend a batched block 
+ *	in place, and leave its planning and queue time to the pass.
+ *	With $pbs at 0 or 1 every block is planned and queued as it is taken.
+ */
+
+void mp_plan_batch()
+{
+	if (mb.batch == 0) { return;}
+	mpBuf_t *bf = mb.w->pv;							// newest block
+	for (mpBuf_t *bp = mb.q; bp != bf; bp = bp->nx) {
+		bp->braking_velocity = -1;					// not planned yet - the backward pass can't stop in them
 	}
-	if (fp_NOT_ZERO(diff = bf->gm.target[AXIS_A] - mm.position[AXIS_A])) {
-		bf->unit[AXIS_A] = diff / length;
-		bf->jerk += square(bf->unit[AXIS_A] * cm.a[AXIS_A].jerk_max);
+	uint8_t mr_flag = false;
+	_plan_block_list(bf, &mr_flag);
+	for (; mb.batch > 0; mb.batch--) { mp_queue_write_buffer(MOVE_TYPE_ALINE);}
+}
+
+stat_t mp_plan_batch_callback(const uint8_t more)
+{
+	mm.batch_more = ((more == true) && (cm.feedhold_requested == false) && (cm.hold_state == FEEDHOLD_OFF) &&
+					 (mp_get_planner_buffers_available() >= PLANNER_BUFFER_HEADROOM) &&	// full - no line runs until it drains
+					 (_batch_lead() == true));
+	if ((mm.batch_more == true) || (mb.batch == 0)) { return (STAT_NOOP);}
+	mp_plan_batch();
+	return (STAT_OK);
+}
+
+static uint8_t _batch_ready(const mpBuf_t *bf)
+{
+	return ((mm.batch_more == false) || (mb.batch >= min(cm.plan_batch, PLANNER_BATCH_MAX)) ||
+			(bf->replannable == false) || (cm.hold_state != FEEDHOLD_OFF) ||
+			(_batch_lead() == false));
+}
+
+static uint8_t _batch_lead()
+{
+	int32_t usec = (int32_t)(mb.time_queued - mb.time_freed);
+	const mpBuf_t *bp = mp_get_first_buffer();
+	if (bp != NULL) { usec -= bp->queue_time;}		// the running block may be nearly done
+	return (usec >= PLANNER_BATCH_QUEUE_MS * 1000);
+}
+
+/*
+ * _coalesce_aline() - merge a straight feed into the newest block
+ *
+ *	CAM posts often emit long runs of tiny, nearly collinear G1s. Each one would
+ *	otherwise take a planner buffer and a planning pass. If the move continues 
+ *	the newest block closely enough, that block is stretched to the new target
+ *	and replanned instead. This deepens the effective look-ahead for free.
+ *
+ *	A move is merged if the newest block is an aline with the same feed, path 
+ *	tolerance and modal state (see MODAL STATE TABLE in planner.h), and the new target is within half the coalescing tolerance 
+ *	($cot) of the line through the block start along the first merged direction.
+ *	Every merged point lies in that cylinder, so the finished chord stays within 
+ *	the tolerance of all of them. The move must also advance along that line.
+ *	Setting $cot to 0 disables coalescing.
+ *
+ *	The block must have another unstarted block ahead of it, or be waiting in a batch
+ *	(see mp_plan_batch()). The runtime can't reach the block while it's being changed.
+ *	The merged block carries the line number of the last move merged into it, so line
+ *	reporting runs through the whole range. Move times are summed so the requested feed rate is kept. A
+ *	held residual (see _hold_residual()) is merged along with the move.
+ *
+ *	Returns true if the move was merged, false if it needs its own block.
+ */
+
+static uint8_t _coalesce_aline(const GCodeState_t *gm_line)
+{
+	if (fp_ZERO(cm.coalesce_tolerance)) { return (false);}
+	mpBuf_t *bf = mb.w->pv;						// newest block - queued or batched
+	if ((_extendable(bf) == false) || (_mergeable(bf, gm_line) == false)) { return (false);}
+
+	float advance = 0;							// progress of the new move along the block line
+	float along = 0;							// distance of the new target along the block line
+	float dist_sq = 0;							// squared distance of the new target from the block start
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		float offset = gm_line->target[axis] - mm.coalesce_start[axis];
+		advance += (gm_line->target[axis] - mm.position[axis]) * mm.coalesce_unit[axis];
+		along += offset * mm.coalesce_unit[axis];
+		dist_sq += square(offset);
 	}
-	if (fp_NOT_ZERO(diff = bf->gm.target[AXIS_B] - mm.position[AXIS_B])) {
-		bf->unit[AXIS_B] = diff / length;
-		bf->jerk += square(bf->unit[AXIS_B] * cm.a[AXIS_B].jerk_max);
+	if (advance <= 0) { return (false);}
+	if ((dist_sq - square(along)) > square(cm.coalesce_tolerance / 2)) { return (false);}
+
+	_extend_aline(bf, gm_line->linenum, gm_line->target, gm_line->move_time + _take_residual_time());
+	return (true);
+}
+
+/*
+ * _extend_aline() - stretch the newest block to a new target and replan it
+ * _extendable()   - true if the block is the newest line and the runtime can't reach it yet
+ * _unreached()	   - true if the block is the newest aline and the runtime can't reach it yet
+ * _mergeable()	   - true if a straight feed can be merged into the block
+ *
+ *	The block start is mm.coalesce_start, which _plan_aline() sets for every line.
+ *	A feed is mergeable if it and the block are straight feeds with the same feed, path
+ *	tolerance and modal state (see MODAL STATE TABLE in planner.h), neither in inverse 
+ *	time, exact stop or spindle sync, and no output trigger waits between them.
+ */
+
+static void _extend_aline(mpBuf_t *bf, const uint32_t linenum, const float target[], const float move_time)
+{
+	mpBlock_t *gb = bf->gm;
+	gb->linenum = linenum;
+	copy_axis_vector(gb->target, target);
+	gb->move_time += move_time;
+
+	memset(bf->unit, 0, sizeof(bf->unit));		// terms are recomputed from the block start
+	bf->jerk = 0;
+	_set_aline_terms(bf, mm.coalesce_start, get_axis_vector_length(gb->target, mm.coalesce_start));
+	copy_axis_vector(mm.position, gb->target);
+	if (bf->buffer_state == MP_BUFFER_LOADING) { return;}	// batched - timed and planned when queued
+
+	mp_add_queue_time(bf, move_time * 60);
+	uint8_t mr_flag = false;
+	_plan_block_list(bf, &mr_flag);
+}
+
+static uint8_t _extendable(const mpBuf_t *bf)
+{
+	if ((bf->move_code == MOVE_CODE_ARC) || (bf->gm->raster_count != 0)) { return (false);}
+	return (_unreached(bf));
+}
+
+static uint8_t _unreached(const mpBuf_t *bf)
+{
+	if (bf->move_type != MOVE_TYPE_ALINE) { return (false);}
+	if (bf->buffer_state != MP_BUFFER_LOADING) {		// a batched block isn't queued yet (see mp_plan_batch())
+		if (bf->buffer_state != MP_BUFFER_QUEUED) { return (false);}
+		if ((bf->pv->buffer_state != MP_BUFFER_QUEUED) && (bf->pv->buffer_state != MP_BUFFER_PENDING)) { return (false);}
 	}
-	if (fp_NOT_ZERO(diff = bf->gm.target[AXIS_C] - mm.position[AXIS_C])) {
-		bf->unit[AXIS_C] = diff / length;
-		bf->jerk += square(bf->unit[AXIS_C] * cm.a[AXIS_C].jerk_max);
+	return (vector_equal(mm.position, bf->gm->target));	// false if the planner position was reset
+}
+
+static uint8_t _mergeable(const mpBuf_t *bf, const GCodeState_t *gm_line)
+{
+	if ((gm_line->motion_mode != MOTION_MODE_STRAIGHT_FEED) || (gm_line->inverse_feed_rate_mode == true) ||
+		(gm_line->path_control == PATH_EXACT_STOP) || (gm_line->spindle_sync > 0)) { return (false);}
+	const mpBlock_t *gb = bf->gm;
+	if ((gb->motion_mode != MOTION_MODE_STRAIGHT_FEED) || (fp_NE(gb->feed_rate, gm_line->feed_rate)) || (gb->spindle_sync > 0) ||
+		(fp_NE(gb->path_tolerance, gm_line->path_tolerance))) { return (false);}
+	if (mp_output_trigger_waiting() == true) { return (false);}	// M62, M63 switch between them
+	return (mp_modal_matches(bf, gm_line));
+}
+
+/*
+ * _hold_residual()	   - hold a move too short to plan
+ * _take_residual_time() - return the held move time and clear the residual
+ * mp_plan_residual()	   - put a held residual into the newest block
+ *
+ *	High resolution CAM output is full of moves shorter than MIN_LENGTH_MOVE. They can't
+ *	be planned as blocks of their own, but dropping them loses their endpoint and makes 
+ *	hosts see errors. Instead the planner remembers the last one's line number and 
+ *	endpoint and adds up their move times, and leaves its own position where it was. 
+ *	The next move long enough to plan runs from there, through the held endpoints - 
+ *	all within MIN_LENGTH_MOVE of its start - and its block gets their move time so 
+ *	the feed rate is kept.
+ *
+ *	Moves under MIN_TIME_MOVE at their feed rate would be skipped by the runtime if 
+ *	they can't run a segment (MOVE_STATE_SKIP). They are held the same way while the
+ *	held endpoints stay within half the coalescing tolerance ($cot) of the start, the 
+ *	same cylinder _coalesce_aline() allows.
+ *
+ *	mp_plan_residual() runs before a dwell or a queued command, so a held endpoint 
+ *	is reached before them. It plans and queues a batch first (see mp_plan_batch()),
+ *	then stretches the newest block to the endpoint, with the held line number, if 
+ *	the runtime hasn't started that block yet. Otherwise the
+ *	residual stays held for the next move, as it does at the end of a program.
+ *	mp_flush_planner() and mp_set_planner_position() drop it.
+ */
+
+static stat_t _hold_residual(const GCodeState_t *gm_line)
+{
+	mm.residual = true;
+	mm.residual_linenum = gm_line->linenum;
+	copy_axis_vector(mm.residual_target, gm_line->target);
+	mm.residual_time += gm_line->move_time;
+	return (STAT_OK);
+}
+
+static float _take_residual_time()
+{
+	float move_time = mm.residual_time;
+	mm.residual = false;
+	mm.residual_time = 0;
+	return (move_time);
+}
+
+void mp_plan_residual()
+{
+	mp_plan_batch();
+	if (mm.residual == false) { return;}
+	mpBuf_t *bf = mb.q->pv;						// newest queued block
+	if (_extendable(bf) == false) { return;}
+	_extend_aline(bf, mm.residual_linenum, mm.residual_target, _take_residual_time());
+}
+
+/*
+ * _set_aline_terms() - set length, unit vector, jerk and velocity limits for an aline block
+ *
+ *	Position is the start of the block. The unit vector and jerk must be zero on entry.
+ */
+
+static void _set_aline_terms(mpBuf_t *bf, const float position[], const float length)
+{
+	bf->length = length;
+
+	// compute both the unit vector and the jerk term in the same pass for efficiency
+	// The loop is unrolled by the compiler for the axes built in (see AXES)
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		float diff = bf->gm->target[axis] - position[axis];
+		if (fp_NOT_ZERO(diff)) {
+			bf->unit[axis] = diff / length;
+			bf->jerk += square(bf->unit[axis] * cm.a[axis].jerk_max);
+		}
 	}
-	bf->jerk = sqrt(bf->jerk) * JERK_MULTIPLIER;
+	bf->jerk = fast_sqrt(bf->jerk) * JERK_MULTIPLIER;
+
+	_set_velocity_terms(bf, bf->length / bf->gm->move_time);	// target velocity requested
+}
+
+/*
+ * _set_velocity_terms() - set jerk terms and velocity limits for a block
+ *
+ *	Length, unit vector and jerk must already be set. Shared by lines and native arcs.
+ */
+
+static void _set_velocity_terms(mpBuf_t *bf, const float cruise_vmax)
+{
+	float exact_stop = 0;
+	float junction_velocity;
 
 	if (fabs(bf->jerk - mm.prev_jerk) < JERK_MATCH_PRECISION) {	// can we re-use jerk terms?
 		bf->cbrt_jerk = mm.prev_cbrt_jerk;
 		bf->recip_jerk = mm.prev_recip_jerk;
 	} else {
-		bf->cbrt_jerk = cbrt(bf->jerk);
+		bf->cbrt_jerk = fast_cbrt(bf->jerk);
 		bf->recip_jerk = 1/bf->jerk;
 		mm.prev_jerk = bf->jerk;
 		mm.prev_cbrt_jerk = bf->cbrt_jerk;
@@ -168,27 +719,276 @@ stat_t mp_aline(const GCodeState_t *gm_line)
 		bf->replannable = true;
 		exact_stop = 8675309;								// an arbitrarily large floating point number (Jenny)
 	}
-	bf->cruise_vmax = bf->length / bf->gm.move_time;		// target velocity requested
-	junction_velocity = _get_junction_vmax(bf->pv->unit, bf->unit);
+	bf->cruise_vmax = cruise_vmax;
+	junction_velocity = _get_junction_vmax(_get_exit_unit(bf->pv), _get_entry_unit(bf));
+	if (bf->gm->path_tolerance > 0) {									// G64 Pn corner blending
+		junction_velocity = max(junction_velocity, _get_blend_vmax(bf));
+	}
 	bf->entry_vmax = min3(bf->cruise_vmax, junction_velocity, exact_stop);
+	if ((bf->gm->motion_mode == MOTION_MODE_SPINDLE_SYNC) && ((bf->pv->move_type != MOVE_TYPE_ALINE) || 
+		(bf->pv->gm->motion_mode != MOTION_MODE_SPINDLE_SYNC))) {
+		bf->entry_vmax = 0;									// a thread starts from rest on the index
+	}
+	if ((spindle.spinup_pending == true) && (bf->gm->motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE)) {
+		spindle.spinup_pending = false;
+		bf->spinup = true;
+		bf->entry_vmax = 0;									// the first feed after M3/M4 starts from rest
+	}
 	bf->delta_vmax = _get_target_velocity(0, bf->length, bf);
 	bf->exit_vmax = min3(bf->cruise_vmax, (bf->entry_vmax + bf->delta_vmax), exact_stop);
 	bf->braking_velocity = bf->delta_vmax;
+}
+
+/*
+ * _get_entry_unit() - path tangent at the start of a block
+ * _get_exit_unit()	 - path tangent at the end of a block
+ *
+ *	The tangents of lines are their unit vectors. Arcs and arc segments carry theirs
+ *	in the arc record.
+ */
+
+static const float *_get_entry_unit(const mpBuf_t *bf)
+{
+	if (bf->move_code != MOVE_CODE_LINE) { return (bf->arc->entry_unit);}
+	return (bf->unit);
+}
+
+static const float *_get_exit_unit(const mpBuf_t *bf)
+{
+	if (bf->move_code != MOVE_CODE_LINE) { return (bf->arc->exit_unit);}
+	return (bf->unit);
+}
+
+#ifdef __NATIVE_ARCS
+/*
+ * mp_arc() - plan an arc or helix as a single block
+ *
+ *	The arc is planned like a line of the same (helical) length. The junction at its
+ *	start uses the tangent at the start point and the next junction uses the tangent at
+ *	the end point (arc->exit_unit). The jerk is the lowest the arc plane axes allow in
+ *	any direction, and cruise is limited to the velocity that keeps the centripetal
+ *	acceleration of the arc plane part under the junction acceleration. The runtime steps along the circle in
+ *	segments short enough to hold the chordal tolerance (see _advance_arc()).
+ *
+ *	Theta is the start angle measured from the axis_2 direction, as in plan_arc.cpp.
+ *	Arcs are counted with the lines in the planner benchmark statistics (see mp_aline()).
+ */
+
+stat_t mp_arc(const GCodeState_t *gm_arc, const float center_1, const float center_2,
+			  const float theta, const float radius, const float angular_travel, const float linear_travel,
+			  const uint8_t axis_1, const uint8_t axis_2, const uint8_t axis_linear)
+{
+	mpBuf_t *bf; 						// current move pointer
+
+	float length = hypot(angular_travel * radius, linear_travel);
+	if (length < MIN_LENGTH_MOVE) { return (_plan_aline(gm_arc, NULL));}	// held as a residual
+	if (pf.state != PREFLIGHT_OFF) { pf_arc(gm_arc, center_1, center_2, theta, radius, angular_travel, axis_1, axis_2);}
+	mp_plan_batch();							// the lines batched ahead of it go first
+	if ((bf = mp_get_write_buffer()) == NULL) { return(cm_alarm(STAT_BUFFER_FULL_FATAL));} // never supposed to fail
+
+	uint32_t start = hw_get_cycle_count();
+	mp_bind_gcode_state(bf, gm_arc);			// load the block record from the model
+	bf->bf_func = _exec_aline;					// arcs run as alines with an arc record
+	bf->move_code = MOVE_CODE_ARC;
+
+	mpArc_t *arc = bf->arc;
+	arc->fitted = false;
+	arc->center_1 = center_1;
+	arc->center_2 = center_2;
+	arc->radius = radius;
+	arc->axis_1 = axis_1;
+	arc->axis_2 = axis_2;
+	arc->axis_linear = axis_linear;
+	_set_arc_terms(bf, theta, angular_travel, linear_travel);
 
 	uint8_t mr_flag = false;
-	_plan_block_list(bf, &mr_flag);							// replan block list and commit current block
-	copy_axis_vector(mm.position, bf->gm.target);			// update planning position
+	_plan_block_list(bf, &mr_flag);				// replan block list and commit current block
+	copy_axis_vector(mm.position, bf->gm->target);	// update planning position
 	mp_queue_write_buffer(MOVE_TYPE_ALINE);
+	mm.aline_cycles += hw_get_cycle_count() - start;
+	mm.aline_count++;
 	return (STAT_OK);
 }
 
+/*
+ * _set_arc_terms() - set length, tangents, jerk and velocity limits for an arc block
+ *
+ *	The center, radius and axes must already be in the arc record.
+ */
+
+static void _set_arc_terms(mpBuf_t *bf, const float theta, const float angular_travel, const float linear_travel)
+{
+	mpArc_t *arc = bf->arc;
+	bf->length = hypot(angular_travel * arc->radius, linear_travel);
+	arc->dtheta = angular_travel / bf->length;
+	arc->dlinear = linear_travel / bf->length;
+	_get_arc_unit(arc, theta, bf->unit);
+	copy_axis_vector(arc->entry_unit, bf->unit);
+	_get_arc_unit(arc, theta + angular_travel, arc->exit_unit);
+
+	// longest chord within the chordal tolerance, scaled from the arc plane to the helix
+	float radius = arc->radius;
+	float planar = radius * fabs(arc->dtheta);	// arc plane travel per mm of path
+	arc->segment_length = bf->length;
+	if ((cm.chordal_tolerance < radius) && (planar > EPSILON)) {
+		arc->segment_length = max(sqrt(4*cm.chordal_tolerance * (2*radius - cm.chordal_tolerance)) / planar,
+								  MIN_SEGMENT_LENGTH);
+	}
+
+	float jerk_plane = min(cm.a[arc->axis_1].jerk_max, cm.a[arc->axis_2].jerk_max);
+	bf->jerk = fast_sqrt(square(planar * jerk_plane) + square(arc->dlinear * cm.a[arc->axis_linear].jerk_max)) * JERK_MULTIPLIER;
+	_set_velocity_terms(bf, min(bf->length / bf->gm->move_time, fast_sqrt(radius * cm.junction_acceleration) / max(planar, EPSILON)));
+}
+
+/*
+ * _fit_arc() - fit a straight feed and the newest block to an arc
+ *
+ *	Curved surfaces come out of CAM as runs of short G1 chords. Every vertex is a 
+ *	junction, and the few mm of path the planner buffers can see can't take the run
+ *	up to feed. If the feed and the newest block lie on a common circle, the block 
+ *	is turned into a native arc through them (see mp_arc()), and following feeds that
+ *	stay on the circle extend it. The run plans as one block, cruise limited by the
+ *	centripetal acceleration of the arc, and the runtime steps it within $ct.
+ *
+ *	A line block is fitted with the circle through its start, its end and the new 
+ *	target. A fitted arc takes a target within the arc fit tolerance ($aft) of its 
+ *	circle that carries on in the same direction, and ends on the target. The sagitta
+ *	of each chord - how far its middle is from the arc - must be within $aft too, so
+ *	the arc stays within $aft of the programmed path. Fitted arcs are under one turn.
+ *
+ *	Only arcs in the selected plane are fitted: the other axes must not move. Flatter
+ *	than ARC_FIT_RADIUS_MAX is left to _coalesce_aline(). The feed must be mergeable 
+ *	and the block out of the runtime's reach, as for coalescing, and the move times 
+ *	and line numbers are taken the same way. Setting $aft to 0 disables fitting.
+ *
+ *	Returns true if the move was fitted, false if it needs its own block.
+ */
+
+static uint8_t _fit_arc(const GCodeState_t *gm_line)
+{
+	static const uint8_t plane_axes[][3] = {{AXIS_X, AXIS_Y, AXIS_Z}, {AXIS_X, AXIS_Z, AXIS_Y}, {AXIS_Y, AXIS_Z, AXIS_X}};
+
+	if (fp_ZERO(cm.arc_fit_tolerance)) { return (false);}
+	mpBuf_t *bf = mb.w->pv;						// newest block - queued or batched
+	mpArc_t *arc = bf->arc;
+	uint8_t fitted = ((bf->move_code == MOVE_CODE_ARC) && (arc->fitted == true));
+	if (fitted == true) {
+		if (_unreached(bf) == false) { return (false);}
+	} else if ((bf->move_code != MOVE_CODE_LINE) || (_extendable(bf) == false)) { return (false);}
+	if (_mergeable(bf, gm_line) == false) { return (false);}
+
+	const float *start = mm.coalesce_start;		// block start
+	uint8_t axis_1 = arc->axis_1;
+	uint8_t axis_2 = arc->axis_2;
+	uint8_t axis_linear = arc->axis_linear;
+	if (fitted == false) {
+		axis_1 = plane_axes[gm_line->select_plane][0];
+		axis_2 = plane_axes[gm_line->select_plane][1];
+		axis_linear = plane_axes[gm_line->select_plane][2];
+	}
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if ((axis == axis_1) || (axis == axis_2)) { continue;}
+		if (fp_NOT_ZERO(gm_line->target[axis] - start[axis]) || fp_NOT_ZERO(mm.position[axis] - start[axis])) { return (false);}
+	}
+
+	float center_1, center_2, radius, theta, angular_travel, direction;
+	if (fitted == true) {
+		center_1 = arc->center_1;
+		center_2 = arc->center_2;
+		radius = arc->radius;
+		theta = atan2(start[axis_1] - center_1, start[axis_2] - center_2);
+		angular_travel = arc->dtheta * bf->length;
+		direction = (angular_travel < 0) ? -1 : 1;
+		if (fabs(hypot(gm_line->target[axis_1] - center_1, gm_line->target[axis_2] - center_2) - radius) > cm.arc_fit_tolerance) {
+			return (false);
+		}
+	} else {
+		// circle through the block start (origin), the block end (a) and the target (b)
+		float a_1 = mm.position[axis_1] - start[axis_1];
+		float a_2 = mm.position[axis_2] - start[axis_2];
+		float b_1 = gm_line->target[axis_1] - start[axis_1];
+		float b_2 = gm_line->target[axis_2] - start[axis_2];
+		float det = 2 * (a_1*b_2 - a_2*b_1);
+		if (fabs(det) < EPSILON) { return (false);}	// collinear
+		float a_sq = square(a_1) + square(a_2);
+		float b_sq = square(b_1) + square(b_2);
+		float offset_1 = (b_2*a_sq - a_2*b_sq) / det;
+		float offset_2 = (a_1*b_sq - b_1*a_sq) / det;
+		radius = hypot(offset_1, offset_2);
+		if (radius > ARC_FIT_RADIUS_MAX) { return (false);}
+		center_1 = start[axis_1] + offset_1;
+		center_2 = start[axis_2] + offset_2;
+		theta = atan2(-offset_1, -offset_2);
+		direction = (det > 0) ? -1 : 1;			// counterclockwise in the plane is decreasing theta
+		angular_travel = _get_fit_travel(theta, atan2(a_1 - offset_1, a_2 - offset_2), direction);
+		if (2*radius * square(sin(angular_travel/4)) > cm.arc_fit_tolerance) { return (false);}
+	}
+	float step = _get_fit_travel(theta + angular_travel, 
+								 atan2(gm_line->target[axis_1] - center_1, gm_line->target[axis_2] - center_2), direction);
+	if (2*radius * square(sin(step/4)) > cm.arc_fit_tolerance) { return (false);}	// chord sagitta
+	angular_travel += step;
+	if (fabs(angular_travel) >= 2*M_PI) { return (false);}
+
+	// take the move and turn the block into (or extend) the arc
+	mpBlock_t *gb = bf->gm;
+	float move_time = gm_line->move_time + _take_residual_time();
+	gb->linenum = gm_line->linenum;
+	copy_axis_vector(gb->target, gm_line->target);
+	gb->move_time += move_time;
+	if (fitted == false) {
+		bf->move_code = MOVE_CODE_ARC;
+		arc->fitted = true;
+		arc->center_1 = center_1;
+		arc->center_2 = center_2;
+		arc->radius = radius;
+		arc->axis_1 = axis_1;
+		arc->axis_2 = axis_2;
+		arc->axis_linear = axis_linear;
+	}
+	_set_arc_terms(bf, theta, angular_travel, 0);
+	copy_axis_vector(mm.position, gb->target);
+	if (bf->buffer_state == MP_BUFFER_LOADING) { return (true);}	// batched - timed and planned when queued
+
+	mp_add_queue_time(bf, move_time * 60);
+	uint8_t mr_flag = false;
+	_plan_block_list(bf, &mr_flag);
+	return (true);
+}
+
+/*
+ * _get_fit_travel() - angle from theta to theta_to, going in the direction (+1 or -1)
+ */
+
+static float _get_fit_travel(const float theta, const float theta_to, const float direction)
+{
+	float travel = fmod(theta_to - theta, 2*M_PI);
+	if (travel * direction < 0) { travel += direction * 2*M_PI;}
+	return (travel);
+}
+
+/*
+ * _get_arc_unit() - tangent unit vector of an arc at angle theta
+ */
+
+static void _get_arc_unit(const mpArc_t *arc, const float theta, float unit[])
+{
+	for (uint8_t axis=0; axis<AXES; axis++) { unit[axis] = 0;}
+	unit[arc->axis_1] = arc->radius * arc->dtheta * cos(theta);
+	unit[arc->axis_2] = -arc->radius * arc->dtheta * sin(theta);
+	unit[arc->axis_linear] = arc->dlinear;
+}
+#endif // __NATIVE_ARCS
+
 /***** ALINE HELPERS *****
  * _plan_block_list()
  * _calculate_trapezoid()
  * _get_target_length()
  * _get_target_velocity()
  * _get_junction_vmax()
- * _reset_replannable_list()
+ * _get_blend_vmax()
+ * _plan_forward()
+ * _plan_restart()
+ * _raise_running_exit()
  */
 
 /* _plan_block_list() - plans the entire block list
@@ -205,6 +1005,14 @@ stat_t mp_aline(const GCodeState_t *gm_line)
  *	_plan_block_list() plans all blocks between and including the (effective) first block 
  *	and the bf. It sets entry, exit and cruise v's from vmax's then calls trapezoid generation. 
  *
+ *	Planning is incremental when a new block is added: the backward pass stops at the 
+ *	first block whose braking velocity is unchanged, and the forward pass only recomputes 
+ *	trapezoids for blocks whose entry, exit or cruise velocity changed. This makes the cost 
+ *	per new block independent of queue depth in the common case. mr_flag set replans the 
+ *	entire list. A block left to restart from rest by a feedhold is planned first (see 
+ *	mp_end_hold()). If the backward pass reaches the running block its exit may still be 
+ *	raised to meet the list (see _raise_running_exit()).
+ *
  *	Variables that must be provided in the mpBuffers that will be processed:
  *
  *	  bf (function arg)		- end of block list (last block in time)
@@ -259,26 +1067,51 @@ stat_t mp_aline(const GCodeState_t *gm_line)
 static void _plan_block_list(mpBuf_t *bf, uint8_t *mr_flag)
 {
 	mpBuf_t *bp = bf;
+	uint8_t incremental = (*mr_flag == false);	// mr_flag set replans everything
+	float braking_velocity;
+	uint32_t plan_blocks = mm.plan_blocks;
 
+	_plan_restart();
+	mm.plan_passes++;
 	// Backward planning pass. Find first block and update the braking velocities.
 	// At the end *bp points to the buffer before the first block.
+	// Incremental: stop at the first block whose braking velocity does not change. That block
+	// must still be replanned (its next block changed), but the blocks before it are unchanged.
 	while ((bp = mp_get_prev_buffer(bp)) != bf) {
 		if (bp->replannable == false) { break; }
-		bp->braking_velocity = min(bp->nx->entry_vmax, bp->nx->braking_velocity) + bp->delta_vmax;
+		braking_velocity = min(bp->nx->entry_vmax, bp->nx->braking_velocity) + bp->delta_vmax;
+		if ((incremental == true) && (fp_EQ(braking_velocity, bp->braking_velocity))) {
+			bp = mp_get_prev_buffer(bp);			// planned-optimal frontier
+			break;
+		}
+		bp->braking_velocity = braking_velocity;
 	}
+	_raise_running_exit(bp);
 
 	// forward planning pass - recomputes trapezoids in the list from the first block to the bf block.
+	// Incremental: trapezoids are only recomputed for blocks whose velocities changed.
+	float entry_velocity;
+	float exit_velocity;
 	while ((bp = mp_get_next_buffer(bp)) != bf) {
+		mm.plan_blocks++;
 		if ((bp->pv == bf) || (*mr_flag == true))  {
-			bp->entry_velocity = bp->entry_vmax;		// first block in the list
+			entry_velocity = bp->entry_vmax;		// first block in the list
 			*mr_flag = false;
 		} else {
-			bp->entry_velocity = bp->pv->exit_velocity;	// other blocks in the list
+			entry_velocity = bp->pv->exit_velocity;	// other blocks in the list
+		}
+		exit_velocity = min4(bp->exit_vmax, bp->nx->braking_velocity, bp->nx->entry_vmax,
+							(entry_velocity + bp->delta_vmax));
+
+		if ((incremental == false) || 
+			(fp_NE(entry_velocity, bp->entry_velocity)) ||
+			(fp_NE(exit_velocity, bp->exit_velocity)) ||
+			(fp_NE(bp->cruise_vmax, bp->cruise_velocity))) {
+			bp->entry_velocity = entry_velocity;
+			bp->cruise_velocity = bp->cruise_vmax;
+			bp->exit_velocity = exit_velocity;
+			_calculate_trapezoid(bp);
 		}
-		bp->cruise_velocity = bp->cruise_vmax;
-		bp->exit_velocity = min4(bp->exit_vmax, bp->nx->braking_velocity, bp->nx->entry_vmax,
-								(bp->entry_velocity + bp->delta_vmax));
-		_calculate_trapezoid(bp);
 
 		// test for optimally planned trapezoids - only need to check various exit conditions
 		if ( ( (fp_EQ(bp->exit_velocity, bp->exit_vmax)) ||
@@ -287,26 +1120,185 @@ static void _plan_block_list(mpBuf_t *bf, uint8_t *mr_flag)
 			   (fp_EQ(bp->exit_velocity, (bp->entry_velocity + bp->delta_vmax))) ) ) {
 
 			bp->replannable = false;
+			_prep_sections(bp);				// set up for the exec now it won't change
 		}
 	}
 	// finish up the last block move
+	mm.plan_blocks++;
 	bp->entry_velocity = bp->pv->exit_velocity;
 	bp->cruise_velocity = bp->cruise_vmax;
 	bp->exit_velocity = 0;
 	_calculate_trapezoid(bp);
+	ev_record(EV_PLAN_PASS, bf->gm->linenum, mm.plan_blocks - plan_blocks);
 }
 
 /*
- *	_reset_replannable_list() - resets all blocks in the planning list to be replannable
- */	
-static void _reset_replannable_list()
+ * _plan_forward() - forward plan bp through end, entering bp at entry_velocity and using 
+ *					 the braking velocities already in place
+ * _plan_restart() - plan the block left to restart from rest by a feedhold, if any
+ *
+ *	With lazy set planning stops at the first block after bp whose velocities don't 
+ *	change, as nothing after it changes either. Blocks are marked replannable unless 
+ *	the optimal test in _plan_block_list() passes, so velocities lowered here are 
+ *	raised again as blocks are added. The last queued block (mb.q->pv - a block being 
+ *	loaded isn't queued yet) exits at zero and stays replannable.
+ */
+static void _plan_forward(mpBuf_t *bp, const mpBuf_t *end, float entry_velocity, const uint8_t lazy)
 {
-	mpBuf_t *bf = mp_get_first_buffer();
-	if (bf == NULL) { return;}
-	mpBuf_t *bp = bf;
-	do {
+	const mpBuf_t *first = bp;
+	const mpBuf_t *last = mb.q->pv;
+
+	mm.plan_passes++;
+	while (true) {
+		mm.plan_blocks++;
+		float exit_velocity = 0;
+		if (bp != last) {
+			exit_velocity = min4(bp->exit_vmax, bp->nx->braking_velocity, bp->nx->entry_vmax,
+								(entry_velocity + bp->delta_vmax));
+		}
+		if ((lazy == true) && (bp != first) &&
+			(fp_EQ(entry_velocity, bp->entry_velocity)) &&
+			(fp_EQ(exit_velocity, bp->exit_velocity)) &&
+			(fp_EQ(bp->cruise_vmax, bp->cruise_velocity))) {
+			return;
+		}
+		bp->entry_velocity = entry_velocity;
+		bp->cruise_velocity = bp->cruise_vmax;
+		bp->exit_velocity = exit_velocity;
+		_calculate_trapezoid(bp);
 		bp->replannable = true;
-	} while (((bp = mp_get_next_buffer(bp)) != bf) && (bp->move_state != MOVE_STATE_OFF));
+		if (bp == last) { return;}
+		if ( ( (fp_EQ(bp->exit_velocity, bp->exit_vmax)) ||
+			   (fp_EQ(bp->exit_velocity, bp->nx->entry_vmax)) )  ||
+			 ( (bp->pv->replannable == false) &&
+			   (fp_EQ(bp->exit_velocity, (bp->entry_velocity + bp->delta_vmax))) ) ) {
+
+			bp->replannable = false;
+			_prep_sections(bp);				// set up for the exec now it won't change
+		}
+		if (bp == end) { return;}
+		entry_velocity = bp->exit_velocity;
+		bp = mp_get_next_buffer(bp);
+	}
+}
+
+static void _plan_restart()
+{
+	if (mb.restart == NULL) { return;}
+	mpBuf_t *bp = mb.restart;
+	mb.restart = NULL;
+	_plan_forward(bp, mb.q->pv, 0, true);
+}
+
+/*
+ * _raise_running_exit() - raise the exit velocity of the running block to meet the next one
+ *
+ *	A block planned as the last in the queue exits at zero. When the host streams slowly
+ *	the next block often arrives while that one is running, and the machine would still
+ *	slow toward zero and speed up again - a sawtooth in the velocity. Until the runtime 
+ *	starts the tail its exit can still be raised: to the most the next block can enter 
+ *	at, up to the cruise velocity. The tail is shortened to suit, and the length it no
+ *	longer needs runs at cruise. Before the body starts that just lengthens the body. A
+ *	running body gets whole segments added, and the part of a segment left over goes on
+ *	the tail - a longer tail than needed only lowers its jerk.
+ *
+ *	The exec runs mr from an interrupt, so the check of where it is and the change are
+ *	made with interrupts off: it sees all of the change or none of it, and the block's
+ *	exit velocity, which the next block enters at, is only raised if mr was. Blocks in 
+ *	a feedhold and rasters are left alone, as are gains under a segment's worth.
+ *
+ *	bp is where the backward pass of _plan_block_list() stopped. Nothing happens unless
+ *	it is the running block.
+ */
+static void _raise_running_exit(mpBuf_t *bp)
+{
+	if ((bp->move_type != MOVE_TYPE_ALINE) || (bp->move_state != MOVE_STATE_RUN) || 
+		(bp != mp_get_first_buffer()) || (cm.hold_state != FEEDHOLD_OFF) || (mr.raster != NULL)) { return;}
+
+	float exit_velocity = min4(bp->exit_vmax, bp->nx->braking_velocity, bp->nx->entry_vmax, mr.cruise_velocity);
+	if (exit_velocity <= mr.exit_velocity) { return;}
+	float tail_length = 0;
+	if (exit_velocity < mr.cruise_velocity) {		// the tail still needs two segments
+		tail_length = max(_get_target_length(exit_velocity, mr.cruise_velocity, bp), 
+						  (mr.cruise_velocity + exit_velocity) * MIN_SEGMENT_TIME);
+	}
+	float gained = mr.tail_length - tail_length;	// length the tail no longer needs
+	if (gained < mr.cruise_velocity * MIN_SEGMENT_TIME) { return;}
+
+	__disable_irq();
+	if ((mr.move_state == MOVE_STATE_BODY) && (mr.section_state == MOVE_STATE_RUN)) {
+		float segment_length = mr.body_length / mr.segments;
+		uint32_t segments = (uint32_t)(gained / segment_length);
+		tail_length += gained - segments * segment_length;
+		if ((segments > 0) && (tail_length < segment_length)) {	// not a sliver of a tail
+			segments--;
+			tail_length += segment_length;
+		}
+		mr.segment_count += segments;
+		mr.body_length += segments * segment_length;
+	} else if ((mr.move_state == MOVE_STATE_HEAD) || (mr.move_state == MOVE_STATE_BODY)) {
+		mr.body_length += gained;
+	} else {
+		__enable_irq();								// the tail has started
+		return;
+	}
+	mr.tail_length = tail_length;
+	mr.exit_velocity = exit_velocity;
+	mr.sections = NULL;								// the exec sets up the rest of mr itself
+	__enable_irq();
+	bp->exit_velocity = exit_velocity;
+}
+
+/*
+ * _prep_sections() - set up the exec parameters of a block that is no longer replannable
+ * _get_segment_length_max() - longest segment the block may run in mm (0 is unlimited)
+ *
+ *	See SECTION PARAMETERS in planner.h. Called from the main loop. The exec takes
+ *	the parameters only once ready is set, so they are written ahead of it. Kinematics,
+ *	the height map, raster lines and native arcs each limit the segment length.
+ */
+static void _prep_sections(mpBuf_t *bf)
+{
+	mpSections_t *p = bf->sect;
+	if ((p->ready == true) || (bf->bf_func != _exec_aline) || (bf->move_state == MOVE_STATE_SKIP)) { return;}
+	p->segment_backoff = mr.segment_backoff;
+	p->segment_length_max = _get_segment_length_max(bf);
+	if (fp_NOT_ZERO(bf->head_length)) {
+		_prep_section(&p->section[SECTION_HEAD], SECTION_HEAD, bf->head_length, bf->entry_velocity, 
+					  bf->cruise_velocity, p->segment_length_max, p->segment_backoff);
+	}
+	if (fp_NOT_ZERO(bf->body_length)) {
+		_prep_section(&p->section[SECTION_BODY], SECTION_BODY, bf->body_length, bf->cruise_velocity, 
+					  bf->cruise_velocity, p->segment_length_max, p->segment_backoff);
+	}
+	if (fp_NOT_ZERO(bf->tail_length)) {
+		_prep_section(&p->section[SECTION_TAIL], SECTION_TAIL, bf->tail_length, bf->cruise_velocity, 
+					  bf->exit_velocity, p->segment_length_max, p->segment_backoff);
+	}
+	mp_release_barrier();
+	p->ready = true;
+}
+
+static float _get_segment_length_max(const mpBuf_t *bf)
+{
+	float length_max = KINEMATICS_SEGMENT_LENGTH;
+	float map_segment = ik_height_map_segment_length();	// follow the height map across XY moves
+	if ((map_segment > 0) && (fp_NOT_ZERO(bf->unit[AXIS_X]) || fp_NOT_ZERO(bf->unit[AXIS_Y])) &&
+		((fp_ZERO(length_max)) || (map_segment < length_max))) {
+		length_max = map_segment;
+	}
+	if (bf->gm->raster_count != 0) {					// a segment only holds so many pixels
+		float raster_segment = bf->gm->raster_pitch * (ST_RASTER_PIXELS - 2);
+		if ((fp_ZERO(length_max)) || (raster_segment < length_max)) {
+			length_max = raster_segment;
+		}
+	}
+#ifdef __NATIVE_ARCS
+	if ((bf->move_code == MOVE_CODE_ARC) && ((fp_ZERO(length_max)) || (bf->arc->segment_length < length_max))) {
+		length_max = bf->arc->segment_length;
+	}
+#endif
+	return (length_max);
 }
 
 /*
@@ -369,7 +1361,7 @@ static void _reset_replannable_list()
  *
  *	  Rate-Limited cases - Ve and Vx can be satisfied but Vt cannot
  *	  	HT	(Ve=Vx)<Vt	symmetric case. Split the length and compute Vt.
- *	  	HT'	(Ve!=Vx)<Vt	asymmetric case. Find H and T by successive approximation.
+ *	  	HT'	(Ve!=Vx)<Vt	asymmetric case. Solve for Vt at constant cost (see _get_ht_velocity())
  *		HBT'			body length < min body length - treated as an HT case
  *		H'				body length < min body length - reduce J to fit H to length
  *		T'				body length < min body length - reduce J to fit T to length
@@ -383,6 +1375,11 @@ static void _reset_replannable_list()
  *		No fit			this block will be skipped as it can't be drawn
  *
  *	The order of the cases/tests in the code is pretty important
+ *
+ *	_calculate_trapezoid() keeps the inputs and results of the last trapezoid in mm.trap.
+ *	Runs of identical blocks (arc segments, repeated CAM moves) copy the cached result
+ *	instead of recomputing it. The compare is on the floats' bits, so a hit always gives the
+ *	same result.
  */
 
 // The minimum lengths are dynamic and depend on the velocity
@@ -392,7 +1389,45 @@ static void _reset_replannable_list()
 #define MIN_TAIL_LENGTH (MIN_SEGMENT_TIME * (bf->cruise_velocity + bf->exit_velocity))
 #define MIN_BODY_LENGTH (MIN_SEGMENT_TIME * bf->cruise_velocity)
 
+static inline uint8_t _same_bits(const float a, const float b) { return (memcmp(&a, &b, sizeof(float)) == 0);}
+
 static void _calculate_trapezoid(mpBuf_t *bf) 
+{
+	mpTrapezoidCache_t *c = &mm.trap;
+
+	bf->sect->ready = false;	// the section parameters follow the trapezoid
+	if ((_same_bits(bf->length, c->length)) && (_same_bits(bf->jerk, c->jerk)) &&
+		(_same_bits(bf->cruise_vmax, c->cruise_vmax)) && (_same_bits(bf->entry_velocity, c->entry_velocity)) &&
+		(_same_bits(bf->cruise_velocity, c->cruise_velocity)) && (_same_bits(bf->exit_velocity, c->exit_velocity))) {
+		bf->entry_velocity = c->entry_velocity_out;
+		bf->cruise_velocity = c->cruise_velocity_out;
+		bf->exit_velocity = c->exit_velocity_out;
+		bf->head_length = c->head_length;
+		bf->body_length = c->body_length;
+		bf->tail_length = c->tail_length;
+		if (c->skip == true) { bf->move_state = MOVE_STATE_SKIP;}
+		return;
+	}
+	c->length = bf->length;
+	c->jerk = bf->jerk;
+	c->cruise_vmax = bf->cruise_vmax;
+	c->entry_velocity = bf->entry_velocity;
+	c->cruise_velocity = bf->cruise_velocity;
+	c->exit_velocity = bf->exit_velocity;
+
+	uint8_t move_state = bf->move_state;
+	_compute_trapezoid(bf);
+
+	c->entry_velocity_out = bf->entry_velocity;
+	c->cruise_velocity_out = bf->cruise_velocity;
+	c->exit_velocity_out = bf->exit_velocity;
+	c->head_length = bf->head_length;
+	c->body_length = bf->body_length;
+	c->tail_length = bf->tail_length;
+	c->skip = ((bf->move_state == MOVE_STATE_SKIP) && (move_state != MOVE_STATE_SKIP));
+}
+
+static void _compute_trapezoid(mpBuf_t *bf) 
 {
 	bf->head_length = 0;		// inialize the lengths
 	bf->body_length = 0;
@@ -452,25 +1487,9 @@ static void _calculate_trapezoid(mpBuf_t *bf)
 			return;
 		}
 
-		// Rate-limited HT' case (asymmetric) - this is relatively expensive but it's not called very often
-		float computed_velocity = bf->cruise_vmax;
-		uint8_t i=0;
-		do {
-			bf->cruise_velocity = computed_velocity;	// initialize from previous iteration 
-			bf->head_length = _get_target_length(bf->entry_velocity, bf->cruise_velocity, bf);
-			bf->tail_length = _get_target_length(bf->exit_velocity, bf->cruise_velocity, bf);
-			if (bf->head_length > bf->tail_length) {
-				bf->head_length = (bf->head_length / (bf->head_length + bf->tail_length)) * bf->length;
-				computed_velocity = _get_target_velocity(bf->entry_velocity, bf->head_length, bf);
-			} else {
-				bf->tail_length = (bf->tail_length / (bf->head_length + bf->tail_length)) * bf->length;
-				computed_velocity = _get_target_velocity(bf->exit_velocity, bf->tail_length, bf);
-			}
-			if (++i > TRAPEZOID_ITERATION_MAX) { fprintf_P(stderr,PSTR("_calculate_trapezoid() failed to converge"));}
-		} while ((fabs(bf->cruise_velocity - computed_velocity) / computed_velocity) > TRAPEZOID_ITERATION_ERROR_PERCENT);
-
+		// Rate-limited HT' case (asymmetric) - constant cost solution
 		// set velocity and clean up any parts that are too short 
-		bf->cruise_velocity = computed_velocity;
+		bf->cruise_velocity = min(bf->cruise_vmax, _get_ht_velocity(bf));
 		bf->head_length = _get_target_length(bf->entry_velocity, bf->cruise_velocity, bf);
 		bf->tail_length = bf->length - bf->head_length;
 		if (bf->head_length < MIN_HEAD_LENGTH) {
@@ -558,12 +1577,44 @@ static void _calculate_trapezoid(mpBuf_t *bf)
 
 static float _get_target_length(const float Vi, const float Vt, const mpBuf_t *bf)
 {
-	return (fabs(Vi-Vt) * sqrt(fabs(Vi-Vt) * bf->recip_jerk));
+	return (fabs(Vi-Vt) * fast_sqrt(fabs(Vi-Vt) * bf->recip_jerk));
+}
+
+static float _get_target_velocity(const float Vi, const float L, const mpBuf_t *bf)
+{
+	return (square(fast_cbrt(L)) * bf->cbrt_jerk + Vi);		// L^(2/3)
 }
 
-static float _get_target_velocity(const float Vi, const float L, const mpBuf_t *bf)
+/*
+ * _get_ht_velocity() - cruise velocity for the rate-limited asymmetric HT' case
+ *
+ *	Finds Vt so the head (Ve->Vt) and tail (Vt->Vx) exactly fill the length. Using 
+ *	the length equation c) above, with Vh = max(Ve,Vx), d = |Ve-Vx| and u = Vt-Vh:
+ *
+ *	  u^(3/2) + (u+d)^(3/2) = L*sqrt(Jm)
+ *
+ *	Normalizing u = d*x gives g(x) = x^(3/2) + (1+x)^(3/2) = k, where k = L*sqrt(Jm) / d^(3/2).
+ *	There's no tidy closed form, so start from the asymptotic solution x = (k/2)^(2/3) - 1/2
+ *	and take TRAPEZOID_NEWTON_ITERATIONS Newton steps. g is convex, so the steps converge 
+ *	from any start. The cost is fixed at 1 cbrt and 6 sqrts. With 2 steps the velocity 
+ *	error is under 0.1% over the whole range of k. The old successive approximation 
+ *	loop allowed 10% and could run up to 10 passes.
+ */
+
+static float _get_ht_velocity(const mpBuf_t *bf)
 {
-	return (pow(L, 0.66666666) * bf->cbrt_jerk + Vi);
+	float v_high = max(bf->entry_velocity, bf->exit_velocity);
+	float d = fabs(bf->entry_velocity - bf->exit_velocity);
+	float k = bf->length * fast_rsqrt(bf->recip_jerk * d*d*d);
+	float x = max(0, square(fast_cbrt(k/2)) - 0.5);
+
+	for (uint8_t i=0; i<TRAPEZOID_NEWTON_ITERATIONS; i++) {
+		float sx = fast_sqrt(x);
+		float s1 = fast_sqrt(1+x);
+		x -= (x*sx + (1+x)*s1 - k) / (1.5 * (sx + s1));
+		if (x < 0) { x = 0;}
+	}
+	return (v_high + d*x);
 }
 
 /*	
@@ -678,35 +1729,100 @@ static float _get_target_velocity(const float Vi, const float L, const mpBuf_t *
  *	 	U[i]	Unit sum of i'th axis	fabs(unit_a[i]) + fabs(unit_b[i])
  *	 	Usum	Length of sums			Ux + Uy
  *	 	d		Delta of sums			(Dx*Ux+DY*UY)/Usum
+ *
+ *	With $jmo=1 (JUNCTION_MODEL_JERK) the jerk model below is used instead.
  */
 static float _get_junction_vmax(const float a_unit[], const float b_unit[])
 {
-	float costheta = - (a_unit[AXIS_X] * b_unit[AXIS_X]) - (a_unit[AXIS_Y] * b_unit[AXIS_Y]) 
-					 - (a_unit[AXIS_Z] * b_unit[AXIS_Z]) - (a_unit[AXIS_A] * b_unit[AXIS_A]) 
-					 - (a_unit[AXIS_B] * b_unit[AXIS_B]) - (a_unit[AXIS_C] * b_unit[AXIS_C]);
+	if (cm.junction_model == JUNCTION_MODEL_JERK) { return (_get_jerk_junction_vmax(a_unit, b_unit));}
+
+	float costheta = 0;
+	for (uint8_t axis=0; axis<AXES; axis++) { costheta -= a_unit[axis] * b_unit[axis];}
 
 	if (costheta < -0.99) { return (10000000); } 		// straight line cases
 	if (costheta > 0.99)  { return (0); } 				// reversal cases
 
-	// Fuse the junction deviations into a vector sum
-	float a_delta = square(a_unit[AXIS_X] * cm.a[AXIS_X].junction_dev);
-	a_delta += square(a_unit[AXIS_Y] * cm.a[AXIS_Y].junction_dev);
-	a_delta += square(a_unit[AXIS_Z] * cm.a[AXIS_Z].junction_dev);
-	a_delta += square(a_unit[AXIS_A] * cm.a[AXIS_A].junction_dev);
-	a_delta += square(a_unit[AXIS_B] * cm.a[AXIS_B].junction_dev);
-	a_delta += square(a_unit[AXIS_C] * cm.a[AXIS_C].junction_dev);
-
-	float b_delta = square(b_unit[AXIS_X] * cm.a[AXIS_X].junction_dev);
-	b_delta += square(b_unit[AXIS_Y] * cm.a[AXIS_Y].junction_dev);
-	b_delta += square(b_unit[AXIS_Z] * cm.a[AXIS_Z].junction_dev);
-	b_delta += square(b_unit[AXIS_A] * cm.a[AXIS_A].junction_dev);
-	b_delta += square(b_unit[AXIS_B] * cm.a[AXIS_B].junction_dev);
-	b_delta += square(b_unit[AXIS_C] * cm.a[AXIS_C].junction_dev);
-
-	float delta = (sqrt(a_delta) + sqrt(b_delta))/2;
-	float sintheta_over2 = sqrt((1 - costheta)/2);
+	// Fuse the junction deviations into a vector sum. Only axes that can corner are summed
+	float a_delta = 0;
+	float b_delta = 0;
+	for (uint8_t i=0; i<cm.junction_axes; i++) {
+		uint8_t axis = cm.junction_axis[i];
+		a_delta += square(a_unit[axis]) * cm.junction_dev_sq[axis];
+		b_delta += square(b_unit[axis]) * cm.junction_dev_sq[axis];
+	}
+
+	float delta = (fast_sqrt(a_delta) + fast_sqrt(b_delta))/2;
+	float sintheta_over2 = fast_sqrt((1 - costheta)/2);
 	float radius = delta * sintheta_over2 / (1-sintheta_over2);
-	return(sqrt(radius * cm.junction_acceleration));
+	return(fast_sqrt(radius * cm.junction_acceleration));
+}
+
+/*
+ * _get_jerk_junction_vmax() - junction velocity limited by each axis' velocity step
+ *
+ *	Going through a junction at V, axis i's velocity steps by V * |b[i] - a[i]|. The
+ *	runtime makes that step between one segment and the next, so the axis has about 
+ *	one segment time T to do it in. Keeping it within the axis jerk and the junction
+ *	acceleration over that time allows a step of
+ *
+ *		dv[i] = min(Jm[i] * T^2, ja * T)
+ *
+ *	and the junction velocity is the smallest dv[i] / |b[i] - a[i]| of the axes that
+ *	corner. There are no angle cutoffs: a shallow angle between short segments makes
+ *	a small step and runs near full speed, while a reversal still slows to the axis
+ *	step. T is the nominal segment time ($ms).
+ */
+static float _get_jerk_junction_vmax(const float a_unit[], const float b_unit[])
+{
+	float T = cm.estd_segment_usec / MICROSECONDS_PER_MINUTE;
+	float accel_step = cm.junction_acceleration * T;
+	float vmax = 10000000;								// straight line cases
+	for (uint8_t i=0; i<cm.junction_axes; i++) {
+		uint8_t axis = cm.junction_axis[i];
+		float step = fabs(b_unit[axis] - a_unit[axis]);
+		if (step < EPSILON) { continue;}
+		float dv = min(cm.a[axis].jerk_max * JERK_MULTIPLIER * square(T), accel_step);
+		vmax = min(vmax, dv / step);
+	}
+	return (vmax);
+}
+
+/*
+ * _get_blend_vmax() - junction velocity for G64 Pn corner blending
+ *
+ *	Uses the same corner model as _get_junction_vmax(), but lets the path radius grow to 
+ *	the G64 P tolerance instead of the axis junction deviations. The arc of radius R that 
+ *	deviates by P from the corner is
+ *
+ *		R = P * sin(theta/2) / (1 - sin(theta/2))
+ *
+ *	The arc also has to fit the moves it joins. That holds if its tangent points are no 
+ *	further from the corner than half the shorter move, so R <= (L/2) * tan(theta/2).
+ *	Runs of short segments with small direction changes keep their velocity, and the 
+ *	blend never reaches past the middle of a move. The path isn't actually rounded. The 
+ *	corner is run at the speed the blend would allow, within the given deviation.
+ *
+ *	Returns 0 if the previous block is not a move, which leaves the sharp corner value.
+ */
+
+static float _get_blend_vmax(const mpBuf_t *bf)
+{
+	if (bf->pv->move_type != MOVE_TYPE_ALINE) { return (0);}
+
+	const float *pv_unit = _get_exit_unit(bf->pv);
+	const float *bf_unit = _get_entry_unit(bf);
+	float costheta = 0;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		costheta -= pv_unit[axis] * bf_unit[axis];
+	}
+	if (costheta < -0.99) { return (10000000); } 		// straight line cases
+	if (costheta > 0.99)  { return (0); } 				// reversal cases
+
+	float sintheta_over2 = fast_sqrt((1 - costheta)/2);
+	float costheta_over2 = fast_sqrt((1 + costheta)/2);
+	float radius = bf->gm->path_tolerance * sintheta_over2 / (1-sintheta_over2);
+	float fit_radius = (min(bf->pv->length, bf->length) / 2) * sintheta_over2 / costheta_over2;
+	return(fast_sqrt(min(radius, fit_radius) * cm.junction_acceleration));
 }
 
 /*************************************************************************
@@ -732,8 +1848,10 @@ static float _get_junction_vmax(const float a_unit[], const float b_unit[])
  *
  *	  - Hold state == PLAN tells the planner to replan the mr buffer, the current
  *		run buffer (bf), and any subsequent bf buffers as necessary to execute a
- *		hold. Hold planning replans the planner buffer queue down to zero and then
- *		back up from zero. Hold state is set to DECEL when planning is complete.
+ *		hold. Only the deceleration is planned - the mr buffer and the blocks the
+ *		stop spans - so the time taken doesn't grow with the queue. The block that
+ *		restarts from zero is left in mb.restart. Hold state is set to DECEL when 
+ *		planning is complete.
  *
  *	  - Hold state == DECEL persists until the aline execution runs to zero 
  *		velocity, at which point hold state transitions to HOLD.
@@ -746,7 +1864,10 @@ static float _get_junction_vmax(const float a_unit[], const float b_unit[])
  *	  - mp_end_hold() is executed from cm_feedhold_sequencing_callback() once the 
  *		hold state == HOLD and a cycle_start has been requested.This sets the hold 
  *		state to OFF which enables _exec_aline() to continue processing. Move 
- *		execution begins with the first buffer after the hold.
+ *		execution begins with the first buffer after the hold. The restart block 
+ *		is planned up from zero first, as far as the blocks after it change - 
+ *		usually the blocks it takes to get back up to speed. A block queued during
+ *		the hold plans the restart first as well (see _plan_block_list()).
  *
  *	Terms used:
  *	 - mr is the runtime buffer. It was initially loaded from the bf buffer
@@ -775,17 +1896,22 @@ static float _compute_next_segment_velocity()
 stat_t mp_plan_hold_callback()
 {
 	if (cm.hold_state != FEEDHOLD_PLAN) { return (STAT_NOOP);}	// not planning a feedhold
+	mp_plan_batch();			// the hold is planned through every block taken
 
 	mpBuf_t *bp; 				// working buffer pointer
-	if ((bp = mp_get_run_buffer()) == NULL) { return (STAT_NOOP);}	// Oops! nothing's running
+	if ((bp = mp_get_first_buffer()) == NULL) { return (STAT_NOOP);}	// Oops! nothing's running
 
-	uint8_t mr_flag = true;		// used to tell replan to account for mr buffer Vx
 	float mr_available_length;	// available length left in mr buffer for deceleration
 	float braking_velocity;		// velocity left to shed to brake to zero
 	float braking_length;		// distance required to brake to zero from braking_velocity
 
 	// examine and process mr buffer
-	mr_available_length = get_axis_vector_length(mr.endpoint, mr.position);
+	float position[AXES];
+	for (uint8_t axis=0; axis<AXES; axis++) { position[axis] = mp_get_runtime_absolute_position(axis);}
+	mr_available_length = get_axis_vector_length(mr.endpoint, position);
+#ifdef __NATIVE_ARCS
+	if (mr.arc_move == true) { mr_available_length = mr.length - mr.arc_travel;}	// along the arc, not the chord
+#endif
 
 /*	mr_available_length = 
 		(sqrt(square(mr.endpoint[AXIS_X] - mr.position[AXIS_X]) +
@@ -798,8 +1924,7 @@ stat_t mp_plan_hold_callback()
 
 //	braking_velocity = _compute_next_segment_velocity();
 	// compute next_segment velocity
-	braking_velocity = mr.segment_velocity;
-	if (mr.move_state != MOVE_STATE_BODY) { braking_velocity +=	mr.forward_diff_1;}
+	braking_velocity = _get_segment_velocity(mr.move_state != MOVE_STATE_BODY);
 
 	braking_length = _get_target_length(braking_velocity, 0, bp); // bp is OK to use here
 	
@@ -812,6 +1937,8 @@ stat_t mp_plan_hold_callback()
 		braking_length = mr_available_length;
 	}
 
+	mr.sections = NULL;							// the exec sets up the replanned mr itself
+
 	// Case 1: deceleration fits entirely into the length remaining in mr buffer
 	if (braking_length <= mr_available_length) {
 		// set mr to a tail to perform the deceleration
@@ -823,13 +1950,14 @@ stat_t mp_plan_hold_callback()
 
 		// re-use bp+0 to be the hold point and to run the remaining block length
 		bp->length = mr_available_length - braking_length;
+		bp->sect->ready = false;				// set up again once replanned
 		bp->delta_vmax = _get_target_velocity(0, bp->length, bp);
 		bp->entry_vmax = 0;						// set bp+0 as hold point
 		bp->move_state = MOVE_STATE_NEW;		// tell _exec to re-use the bf buffer
 
-		_reset_replannable_list();				// make it replan all the blocks
-		_plan_block_list(mp_get_last_buffer(), &mr_flag);
+		mb.restart = bp;						// planned up from zero on the way out of the hold
 		cm.hold_state = FEEDHOLD_DECEL;			// set state to decelerate and exit
+		sr_mark_changed(SR_CHANGED_STATE);
 		return (STAT_OK);
 	}
 
@@ -845,6 +1973,7 @@ stat_t mp_plan_hold_callback()
 	// Find the point where deceleration reaches zero. This could span multiple buffers.
 	braking_velocity = mr.exit_velocity;		// adjust braking velocity downward
 	bp->move_state = MOVE_STATE_NEW;			// tell _exec to re-use buffer
+	mpBuf_t *first = bp;
 	for (uint8_t i=0; i<PLANNER_BUFFER_POOL_SIZE; i++) {// a safety to avoid wraparound
 		mp_copy_buffer(bp, bp->nx);				// copy bp+1 into bp+0 (and onward...)
 		if (bp->move_type != MOVE_TYPE_ALINE) {	// skip any non-move buffers
@@ -866,16 +1995,17 @@ stat_t mp_plan_hold_callback()
 	// Plan the first buffer of the pair as the decel, the second as the accel
 	bp->length = braking_length;
 	bp->exit_vmax = 0;
+	_plan_forward(first, bp, first->entry_vmax, false);	// plan the deceleration
 
 	bp = mp_get_next_buffer(bp);				// point to the acceleration buffer
 	bp->entry_vmax = 0;
 	bp->length -= braking_length;				// the buffers were identical (and hence their lengths)
+	bp->sect->ready = false;
 	bp->delta_vmax = _get_target_velocity(0, bp->length, bp);
 	bp->exit_vmax = bp->delta_vmax;
-
-	_reset_replannable_list();					// make it replan all the blocks
-	_plan_block_list(mp_get_last_buffer(), &mr_flag);
+	mb.restart = bp;							// planned up from zero on the way out of the hold
 	cm.hold_state = FEEDHOLD_DECEL;				// set state to decelerate and exit
+	sr_mark_changed(SR_CHANGED_STATE);
 	return (STAT_OK);
 }
 
@@ -885,7 +2015,9 @@ stat_t mp_plan_hold_callback()
 stat_t mp_end_hold()
 {
 	if (cm.hold_state == FEEDHOLD_END_HOLD) { 
+		_plan_restart();						// before the runtime can reach it
 		cm.hold_state = FEEDHOLD_OFF;
+		sr_mark_changed(SR_CHANGED_STATE);
 		mpBuf_t *bf;
 		if ((bf = mp_get_run_buffer()) == NULL) {	// NULL means nothing's running
 //			cm.motion_state = MOTION_STOP;
@@ -982,9 +2114,13 @@ static stat_t _exec_aline(mpBuf_t *bf)
 	// start a new move by setting up local context (singleton)
 	if (mr.move_state == MOVE_STATE_OFF) {
 		if (cm.hold_state == FEEDHOLD_HOLD) { return (STAT_NOOP);}// stops here if holding
+		if ((bf->gm->motion_mode == MOTION_MODE_SPINDLE_SYNC) && (mr.gm.motion_mode != MOTION_MODE_SPINDLE_SYNC) &&
+			(cm_spindle_index_wait() == true)) { return (STAT_NOOP);}	// the index restarts the exec
+		if ((bf->spinup == true) && (cm_spindle_spinup_wait() == true)) { return (STAT_NOOP);}	// the spin-up restarts the exec
 
 		// initialization to process the new incoming bf buffer
-		memcpy(&mr.gm, &(bf->gm), sizeof(GCodeState_t));// copy in the gcode model state
+		mp_load_runtime_gcode_state(bf);				// load the block's gcode model state
+		sr_mark_changed(SR_CHANGED_BLOCK);
 		bf->replannable = false;
 														// too short lines have already been removed
 		if (fp_ZERO(bf->length)) {						// ...looks for an actual zero here
@@ -1005,8 +2141,43 @@ static stat_t _exec_aline(mpBuf_t *bf)
 		mr.entry_velocity = bf->entry_velocity;
 		mr.cruise_velocity = bf->cruise_velocity;
 		mr.exit_velocity = bf->exit_velocity;
+		mr.power_velocity = bf->cruise_vmax;
+#ifdef __FIXED_POINT_RUNTIME
+		for (uint8_t axis=0; axis<AXES; axis++) { mr.unit[axis] = (int32_t)(bf->unit[axis] * FX_UNIT_ONE);}
+#else
 		copy_axis_vector(mr.unit, bf->unit);
-		copy_axis_vector(mr.endpoint, bf->gm.target);	// save the final target of the move
+#endif
+		copy_axis_vector(mr.endpoint, bf->gm->target);	// save the final target of the move
+		mr.segment_length_max = _get_segment_length_max(bf);
+		mr.sections = NULL;								// use the section parameters if set up for it
+		if ((bf->sect->ready == true) && (fp_EQ(bf->sect->segment_length_max, mr.segment_length_max))) {
+			mr.sections = bf->sect;
+		}
+		mr.raster = NULL;
+		if (bf->gm->raster_count != 0) {
+			mr.raster = &mrr.pixels[bf->gm->raster_offset];
+			mr.raster_count = bf->gm->raster_count;
+			mr.raster_pitch = bf->gm->raster_pitch;
+		}
+#ifdef __NATIVE_ARCS
+		mr.arc_move = (bf->move_code == MOVE_CODE_ARC);
+		if (mr.arc_move == true) {						// start the arc from the runtime position
+			memcpy(&mr.arc, bf->arc, sizeof(mpArc_t));	// ...so re-used (held) blocks resume in place
+			mr.arc_theta = atan2(mp_get_runtime_absolute_position(mr.arc.axis_1) - mr.arc.center_1,
+								 mp_get_runtime_absolute_position(mr.arc.axis_2) - mr.arc.center_2);
+			mr.arc_linear = mp_get_runtime_absolute_position(mr.arc.axis_linear);
+			mr.arc_travel = 0;
+			mr.length = bf->length;
+		}
+#endif
+#ifdef KINEMATICS_NONLINEAR
+		float position[AXES];							// resync the kinematics to the runtime
+		for (uint8_t axis=0; axis<AXES; axis++) { position[axis] = mp_get_runtime_absolute_position(axis);}
+		sh_get_position(position);						// ...where the motors have been sent
+		pa_get_position(position);
+		ik_set_position(position);
+#endif
+		bl_start(bf);									// time it for the block log
 	}
 	// NB: from this point on the contents of the bf buffer do not affect execution
 
@@ -1022,7 +2193,11 @@ static stat_t _exec_aline(mpBuf_t *bf)
 
 	// Feedhold processing. Refer to canonical_machine.h for state machine
 	// Catch the feedhold request and start the planning the hold
-	if (cm.hold_state == FEEDHOLD_SYNC) { cm.hold_state = FEEDHOLD_PLAN;}
+	if (cm.hold_state == FEEDHOLD_SYNC) { 
+		cm.hold_state = FEEDHOLD_PLAN;
+		controller_set_ready(CTL_TASK_PLAN_HOLD);
+	}
+	sr_mark_changed(SR_CHANGED_MOTION);		// a segment has been run
 
 	// Look for the end of the decel to go into HOLD state
 	if ((cm.hold_state == FEEDHOLD_DECEL) && (status == STAT_OK)) {
@@ -1047,6 +2222,7 @@ static stat_t _exec_aline(mpBuf_t *bf)
 		mr.section_state = MOVE_STATE_OFF;
 		bf->nx->replannable = false;			// prevent overplanning (Note 2)
 		if (bf->move_state == MOVE_STATE_RUN) {
+			bl_end();
 			mp_free_run_buffer();				// free bf if it's actually done
 		}
 	}
@@ -1073,19 +2249,121 @@ static stat_t _exec_aline(mpBuf_t *bf)
  *
  *  forward_diff_1 = Ah^2+Bh = (T[0] - 2*T[1] + T[2])h*h + (2 * (T[1] - T[0]))h
  *  forward_diff_2 = 2Ah^2 = 2*(T[0] - 2*T[1] + T[2])h*h
+ *
+ *	With __FIXED_POINT_RUNTIME the velocity and differences are converted to mm per 
+ *	segment here, so s->segments and s->segment_move_time must be set before calling 
+ *	this function. The seeds go in the section parameters (see _prep_section()).
  */
 
 // NOTE: t1 will always be == t0, so we don't pass it
-static void _init_forward_diffs(float t0, float t2)
+static void _init_forward_diffs(mpSection_t *s, float t0, float t2)
 {
-	float H_squared = square(1/mr.segments);
+	float H_squared = square(1/s->segments);
 	// A = T[0] - 2*T[1] + T[2], if T[0] == T[1], then it becomes - T[0] + T[2]
 	float AH_squared = (t2 - t0) * H_squared;
 	
 	// Ah²+Bh, and B=2 * (T[1] - T[0]), if T[0] == T[1], then it becomes simply Ah^2
-	mr.forward_diff_1 = AH_squared;
-	mr.forward_diff_2 = 2*AH_squared;
-	mr.segment_velocity = t0;
+	s->forward_diff_1 = _to_runtime_at(AH_squared, s->segment_move_time);
+	s->forward_diff_2 = _to_runtime_at(2*AH_squared, s->segment_move_time);
+	s->segment_velocity = _to_runtime_at(t0, s->segment_move_time);
+}
+
+/*
+ * _get_segment_velocity() - velocity of the last segment in mm/min, or the next one if next is true
+ */
+static float _get_segment_velocity(uint8_t next)
+{
+#ifdef __FIXED_POINT_RUNTIME
+	if (fp_ZERO(mr.segment_move_time)) { return (0);}
+	fixed_t velocity = _fx_read(&mr.segment_velocity);
+	if (next == true) { velocity += _fx_read(&mr.forward_diff_1);}
+	return ((float)velocity / (FX_ONE * mr.segment_move_time));
+#else
+	if (next == true) { return (mr.segment_velocity + mr.forward_diff_1);}
+	return (mr.segment_velocity);
+#endif
+}
+
+/*
+ * _get_scurve_segments() - number of segments for each half of a head or tail
+ *
+ *	Uses nominal segments unless the velocity step between segments would exceed
+ *	cm.segment_velocity_error. The steepest point of the S-curve has twice its average
+ *	acceleration, so each half needs about delta_v / error segments, where delta_v is
+ *	the velocity change of the whole head or tail. Non-linear kinematics, native arcs and
+ *	the height map also need each segment to be under length_max - either half is shorter 
+ *	than the whole length. Segments never drop below MIN_SEGMENT_USEC. All segment times are stretched
+ *	by the exec budget backoff (see mp_check_exec_budget())
+ */
+static float _get_scurve_segments(float half_usec, float delta_v, float length, float length_max, float backoff)
+{
+	float segments = ceil(half_usec / (cm.estd_segment_usec * backoff));
+	float fidelity = 0;
+	if (cm.segment_velocity_error > EPSILON) {
+		fidelity = ceil(fabs(delta_v) / cm.segment_velocity_error);
+	}
+	if (length_max > 0) {
+		fidelity = max(fidelity, ceil(length / length_max));
+	}
+	return (max(segments, min(fidelity, floor(half_usec / (MIN_SEGMENT_USEC * backoff)))));
+}
+
+/*
+ * _prep_section() - work out the exec parameters of a head, body or tail
+ * _load_section() - load them into the runtime as the section starts (exec)
+ *
+ *	A head runs from v_start (entry) to v_end (cruise) and a tail from cruise to exit.
+ *	Each half of their S-curve has s->segments. The body is broken into segments even 
+ *	though it is a straight line so feedholds can start part way along it.
+ *
+ *	_prep_section() runs in the main loop for blocks that are no longer replannable 
+ *	(see SECTION PARAMETERS in planner.h), and in the exec for sections that weren't.
+ *	_load_section() returns STAT_GCODE_BLOCK_SKIPPED if the segments come out under 
+ *	MIN_SEGMENT_USEC.
+ */
+static void _prep_section(mpSection_t *s, const uint8_t section, const float length, const float v_start,
+						  const float v_end, const float length_max, const float backoff)
+{
+	if (section == SECTION_BODY) {
+		float move_time = length / v_start;
+		s->segments = ceil(uSec(move_time) / (max(cm.body_segment_usec, cm.estd_segment_usec) * backoff));
+		if (length_max > 0) {
+			s->segments = max(s->segments, min(ceil(length / length_max), 
+											   floor(uSec(move_time) / (MIN_SEGMENT_USEC * backoff))));
+		}
+		s->segment_move_time = move_time / s->segments;
+		s->microseconds = uSec(s->segment_move_time);
+		_init_forward_diffs(s, v_start, v_start);			// constant velocity
+		return;
+	}
+	float midpoint_velocity = (v_start + v_end) / 2;
+	float move_time = length / midpoint_velocity;			// time for entire accel or decel region
+	s->segments = _get_scurve_segments(uSec(move_time)/2, v_end - v_start, length, length_max, backoff);
+	s->segment_move_time = move_time / (2 * s->segments);	// time to advance for each segment
+	s->microseconds = uSec(s->segment_move_time);
+	_init_forward_diffs(s, v_start, midpoint_velocity);
+}
+
+static stat_t _load_section(const uint8_t section, const float length, const float v_start, const float v_end)
+{
+	mpSection_t prep;
+	const mpSection_t *s = &prep;
+	if ((mr.sections != NULL) && (fp_EQ(mr.sections->segment_backoff, mr.segment_backoff))) {
+		s = &mr.sections->section[section];
+	} else {
+		_prep_section(&prep, section, length, v_start, v_end, mr.segment_length_max, mr.segment_backoff);
+	}
+	mr.backoff_section = false;
+	mr.segments = s->segments;
+	mr.segment_count = (uint32_t)s->segments;
+	mr.segment_move_time = s->segment_move_time;
+	if ((mr.microseconds = s->microseconds) < MIN_SEGMENT_USEC) {
+		return(STAT_GCODE_BLOCK_SKIPPED);
+	}
+	mr.segment_velocity = s->segment_velocity;
+	mr.forward_diff_1 = s->forward_diff_1;
+	mr.forward_diff_2 = s->forward_diff_2;
+	return (STAT_OK);
 }
 
 /*
@@ -1098,15 +2376,9 @@ static stat_t _exec_aline_head()
 			mr.move_state = MOVE_STATE_BODY;
 			return(_exec_aline_body());						// skip ahead to the body generator
 		}
-		mr.midpoint_velocity = (mr.entry_velocity + mr.cruise_velocity) / 2;
-		mr.gm.move_time = mr.head_length / mr.midpoint_velocity;	// time for entire accel region
-		mr.segments = ceil(uSec(mr.gm.move_time) / (2 * cm.estd_segment_usec)); // # of segments in *each half*
-		mr.segment_move_time = mr.gm.move_time / (2 * mr.segments);
-		mr.segment_count = (uint32_t)mr.segments;
-		if ((mr.microseconds = uSec(mr.segment_move_time)) < MIN_SEGMENT_USEC) {
+		if (_load_section(SECTION_HEAD, mr.head_length, mr.entry_velocity, mr.cruise_velocity) != STAT_OK) {
 			return(STAT_GCODE_BLOCK_SKIPPED);				// exit without advancing position
 		}
-		_init_forward_diffs(mr.entry_velocity, mr.midpoint_velocity);
 		mr.section_state = MOVE_STATE_RUN1;
 	}
 	if (mr.section_state == MOVE_STATE_RUN1) {				// concave part of accel curve (period 1)
@@ -1137,9 +2409,6 @@ static stat_t _exec_aline_head()
 
 /*
  * _exec_aline_body()
- *
- *	The body is broken into little segments even though it is a straight line so that 
- *	feedholds can happen in the middle of a line with a minimum of latency
  */
 static stat_t _exec_aline_body()
 {
@@ -1148,15 +2417,9 @@ static stat_t _exec_aline_body()
 			mr.move_state = MOVE_STATE_TAIL;
 			return(_exec_aline_tail());						// skip ahead to tail periods
 		}
-		mr.gm.move_time = mr.body_length / mr.cruise_velocity;
-		mr.segments = ceil(uSec(mr.gm.move_time) / cm.estd_segment_usec);
-		mr.segment_move_time = mr.gm.move_time / mr.segments;
-		mr.segment_velocity = mr.cruise_velocity;
-		mr.segment_count = (uint32_t)mr.segments;
-		if ((mr.microseconds = uSec(mr.segment_move_time)) < MIN_SEGMENT_USEC) {
+		if (_load_section(SECTION_BODY, mr.body_length, mr.cruise_velocity, mr.cruise_velocity) != STAT_OK) {
 			return(STAT_GCODE_BLOCK_SKIPPED);				// exit without advancing position
 		}
-		
 		mr.section_state = MOVE_STATE_RUN;
 	}
 	if (mr.section_state == MOVE_STATE_RUN) {				// straight part (period 3)
@@ -1176,15 +2439,9 @@ static stat_t _exec_aline_tail()
 {
 	if (mr.section_state == MOVE_STATE_NEW) {
 		if (fp_ZERO(mr.tail_length)) { return(STAT_OK);}		// end the move
-		mr.midpoint_velocity = (mr.cruise_velocity + mr.exit_velocity) / 2;
-		mr.gm.move_time = mr.tail_length / mr.midpoint_velocity;
-		mr.segments = ceil(uSec(mr.gm.move_time) / (2 * cm.estd_segment_usec));// # of segments in *each half*
-		mr.segment_move_time = mr.gm.move_time / (2 * mr.segments);// time to advance for each segment
-		mr.segment_count = (uint32_t)mr.segments;
-		if ((mr.microseconds = uSec(mr.segment_move_time)) < MIN_SEGMENT_USEC) {
+		if (_load_section(SECTION_TAIL, mr.tail_length, mr.cruise_velocity, mr.exit_velocity) != STAT_OK) {
 			return(STAT_GCODE_BLOCK_SKIPPED);					// exit without advancing position
 		}
-		_init_forward_diffs(mr.cruise_velocity, mr.midpoint_velocity);
 		mr.section_state = MOVE_STATE_RUN1;
 	}
 	if (mr.section_state == MOVE_STATE_RUN1) {				// convex part (period 4)
@@ -1209,13 +2466,138 @@ static stat_t _exec_aline_tail()
 	return(STAT_EAGAIN);									// should never get here
 }
 
+/*
+ * _get_height_offset() - height map compensation for a segment target
+ */
+static float _get_height_offset(const float target[])
+{
+	if (cm.cycle_state != CYCLE_MACHINING) { return (mr.height_offset);}
+	return (ik_height_map_z(target[AXIS_X], target[AXIS_Y]));
+}
+
+#ifdef __FIXED_POINT_RUNTIME
+/*
+ * _segment_kinematics() - motor substeps for a segment of the fixed point runtime
+ *
+ *	counts[] is the segment travel in Q8.24 mm and travel[] the same in float, as the 
+ *	height map, shaper and pressure advance have left it. While none of them has changed 
+ *	it the substeps come from the counts in integer math (see ik_kinematics_fixed()).
+ */
+static void _segment_kinematics(const int32_t counts[], float travel[], int32_t substeps[], 
+								const float microseconds, const float height_offset)
+{
+	if ((sh.enable == false) && (pa.enable == false) && (_same_bits(height_offset, mr.height_offset)) && 
+		(ik_kinematics_fixed(counts, substeps) == true)) { return;}
+	ik_kinematics(travel, substeps, microseconds);
+}
+#endif
+
+/*
+ * _get_segment_power() - spindle power ratio for a segment in dynamic power mode
+ *
+ *	The ratio is the velocity the segment runs at, overrides included, over the 
+ *	programmed velocity, so accel ramps and corners get the same energy per mm as the 
+ *	cruise. Traverses run with the power off. Returns PREP_POWER_NONE if dynamic power 
+ *	is off. Call after _update_override_factor() for the segment.
+ */
+static float _get_segment_power()
+{
+	if (pwm.c[PWM_1].dynamic_power == false) { return (PREP_POWER_NONE);}
+	if ((mr.gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) || (fp_ZERO(mr.power_velocity))) { return (0);}
+	float ratio = mp_get_runtime_velocity() / mr.power_velocity;
+	return ((ratio > 1) ? 1 : ratio);
+}
+
 /*
  * _exec_aline_segment() - segment runner helper
+ *
+ *	The fixed point version scales the segment length by the unit vector to get the 
+ *	travel for each axis: Q1.30 * Q8.24 is Q.54 in 64 bits, shifted down to Q32.32 to 
+ *	advance the position. The travel for the kinematics is the change in the position 
+ *	taken to Q8.24 - a segment is always well under 128 mm - and is converted to motor 
+ *	substeps in integer math (see _segment_kinematics()). Taking the change between the 
+ *	truncated positions, rather than truncating the delta, makes the travel of successive 
+ *	segments add up to exactly the distance moved; otherwise the segments of a cruise all 
+ *	come up short by the same few counts and the motors drift.
+ *
+ *	Native arcs replace the travel of the arc axes with the step to the next point on
+ *	the circle. The segments are chords of the circle, and the unit vector (and hence
+ *	the travel) of the other axes is zero.
+ *
+ *	The height map change across the segment is added to the Z travel only, so the
+ *	runtime position stays in the planned frame. Cycles other than machining hold the
+ *	compensation where it is (homing Z clears it, see mp_set_runtime_position()).
  */
+#ifdef __FIXED_POINT_RUNTIME
+static stat_t _exec_aline_segment(uint8_t correction_flag)
+{
+	fixed_t delta[AXES];
+	float travel[AXES];
+	int32_t substeps[MOTORS];
+
+	// Don't do the endpoint correction if you are going into a hold
+	if ((correction_flag == true) && (mr.segment_count == 1) && 
+		(cm.motion_state == MOTION_RUN) && (cm.cycle_state == CYCLE_MACHINING)) {
+		for (uint8_t i=0; i<AXES; i++) {		// correct any accumulated rounding errors in last segment
+			delta[i] = (fixed_t)(mr.endpoint[i] * FX_ONE) - mr.position[i];
+		}
+	} else {
+		int32_t length = (int32_t)(mr.segment_velocity >> 8);	// Q8.24 mm
+		for (uint8_t i=0; i<AXES; i++) {
+			delta[i] = ((int64_t)mr.unit[i] * length) >> 22;
+		}
+#ifdef __NATIVE_ARCS
+		if (mr.arc_move == true) {			// arc axes step to the next point on the circle
+			float target[AXES];
+			_advance_arc((float)mr.segment_velocity / FX_ONE, target);
+			delta[mr.arc.axis_1] = (fixed_t)(target[mr.arc.axis_1] * FX_ONE) - mr.position[mr.arc.axis_1];
+			delta[mr.arc.axis_2] = (fixed_t)(target[mr.arc.axis_2] * FX_ONE) - mr.position[mr.arc.axis_2];
+			delta[mr.arc.axis_linear] = (fixed_t)(target[mr.arc.axis_linear] * FX_ONE) - mr.position[mr.arc.axis_linear];
+		}
+#endif
+	}
+	float target[AXES];
+	int32_t counts[AXES];								// travel in Q8.24 mm
+	for (uint8_t i=0; i<AXES; i++) {
+		fixed_t position = mr.position[i] + delta[i];
+		counts[i] = (int32_t)((position >> 8) - (mr.position[i] >> 8));
+		travel[i] = (float)counts[i] * FX_TRAVEL_UNIT;
+		target[i] = (float)position / FX_ONE;
+	}
+	float height_offset = _get_height_offset(target);
+	travel[AXIS_Z] += height_offset - mr.height_offset;
+
+	// prep the segment for the steppers and adjust the variables for the next iteration
+	float microseconds = mr.microseconds / _update_override_factor();	// time-scale for overrides
+	target[AXIS_Z] += height_offset;
+	sh_shape(target, travel, microseconds);				// the motors follow the shaped position
+	pa_advance(target, travel, microseconds);
+	target[AXIS_Z] -= height_offset;
+	_segment_kinematics(counts, travel, substeps, microseconds, height_offset);
+	st_prep_position(target, travel);					// for the probe position latch
+	st_prep_power(_get_segment_power());
+	_prep_raster(target);
+	mp_prep_outputs((float)mr.segment_velocity / FX_ONE, microseconds);
+	if (st_prep_line_substeps(substeps, st_prep_ticks(microseconds)) == STAT_OK) {
+		for (uint8_t i=0; i<AXES; i++) { mr.position[i] += delta[i];}	// update runtime position
+		mp_commit_outputs((float)mr.segment_velocity / FX_ONE, microseconds);
+		mr.height_offset = height_offset;
+		mp_publish_runtime();
+		bl_segment(microseconds, mr.snapshot.velocity, mr.move_state);
+		sh_commit();
+		pa_commit();
+		ik_commit();
+	}
+	if (--mr.segment_count == 0) return (STAT_OK);		// this section has run all its segments
+	return (STAT_EAGAIN);								// this section still has more segments to run
+}
+
+#else // __FIXED_POINT_RUNTIME
+
 static stat_t _exec_aline_segment(uint8_t correction_flag)
 {
 	float travel[AXES];
-	float steps[MOTORS];
+	int32_t substeps[MOTORS];
 
 
 	// Multiply computed length by the unit vector to get the contribution for each axis. 
@@ -1223,45 +2605,43 @@ static stat_t _exec_aline_segment(uint8_t correction_flag)
 	// Don't do the endpoint correction if you are going into a hold
 	if ((correction_flag == true) && (mr.segment_count == 1) && 
 		(cm.motion_state == MOTION_RUN) && (cm.cycle_state == CYCLE_MACHINING)) {
-		mr.gm.target[AXIS_X] = mr.endpoint[AXIS_X]; // correct any accumulated rounding errors in last segment
-		mr.gm.target[AXIS_Y] = mr.endpoint[AXIS_Y];
-		mr.gm.target[AXIS_Z] = mr.endpoint[AXIS_Z];
-		mr.gm.target[AXIS_A] = mr.endpoint[AXIS_A];
-		mr.gm.target[AXIS_B] = mr.endpoint[AXIS_B];
-		mr.gm.target[AXIS_C] = mr.endpoint[AXIS_C];
-
+		copy_axis_vector(mr.gm.target, mr.endpoint);	// correct any accumulated rounding errors in last segment
+
 	} else {
 		float intermediate = mr.segment_velocity * mr.segment_move_time;
-		mr.gm.target[AXIS_X] = mr.position[AXIS_X] + (mr.unit[AXIS_X] * intermediate);
-		mr.gm.target[AXIS_Y] = mr.position[AXIS_Y] + (mr.unit[AXIS_Y] * intermediate);
-		mr.gm.target[AXIS_Z] = mr.position[AXIS_Z] + (mr.unit[AXIS_Z] * intermediate);
-		mr.gm.target[AXIS_A] = mr.position[AXIS_A] + (mr.unit[AXIS_A] * intermediate);
-		mr.gm.target[AXIS_B] = mr.position[AXIS_B] + (mr.unit[AXIS_B] * intermediate);
-		mr.gm.target[AXIS_C] = mr.position[AXIS_C] + (mr.unit[AXIS_C] * intermediate);
-	}
-
-	travel[AXIS_X] = mr.gm.target[AXIS_X] - mr.position[AXIS_X];
-	travel[AXIS_Y] = mr.gm.target[AXIS_Y] - mr.position[AXIS_Y];
-	travel[AXIS_Z] = mr.gm.target[AXIS_Z] - mr.position[AXIS_Z];
-	travel[AXIS_A] = mr.gm.target[AXIS_A] - mr.position[AXIS_A];
-	travel[AXIS_B] = mr.gm.target[AXIS_B] - mr.position[AXIS_B];
-	travel[AXIS_C] = mr.gm.target[AXIS_C] - mr.position[AXIS_C];
-
-/* The above is a re-arranged and loop unrolled version of this:
-	for (uint8_t i=0; i < AXES; i++) {	// don't do the error correction if you are going into a hold
-		if ((correction_flag == true) && (mr.segment_count == 1) && 
-			(cm.motion_state == MOTION_RUN) && (cm.cycle_state == CYCLE_STARTED)) {
-			mr.gm.target[i] = mr.endpoint[i];	// rounding error correction for last segment
-		} else {
-			mr.gm.target[i] = mr.position[i] + (mr.unit[i] * mr.segment_velocity * mr.segment_move_time);
+		for (uint8_t i=0; i<AXES; i++) {		// unrolled by the compiler for the axes built in
+			mr.gm.target[i] = mr.position[i] + (mr.unit[i] * intermediate);
 		}
-		travel[i] = mr.gm.target[i] - mr.position[i];
+#ifdef __NATIVE_ARCS
+		if (mr.arc_move == true) { _advance_arc(intermediate, mr.gm.target);}	// arc axes follow the circle
+#endif
 	}
-*/
+
+	for (uint8_t i=0; i<AXES; i++) { travel[i] = mr.gm.target[i] - mr.position[i];}
+	float height_offset = _get_height_offset(mr.gm.target);
+	travel[AXIS_Z] += height_offset - mr.height_offset;
 	// prep the segment for the steppers and adjust the variables for the next iteration
-	ik_kinematics(travel, steps, mr.microseconds);
-	if (st_prep_line(steps, mr.microseconds) == STAT_OK) {
+	float microseconds = mr.microseconds / _update_override_factor();	// time-scale for overrides
+	float position[AXES];
+	copy_axis_vector(position, mr.gm.target);
+	position[AXIS_Z] += height_offset;
+	sh_shape(position, travel, microseconds);			// the motors follow the shaped position
+	pa_advance(position, travel, microseconds);
+	position[AXIS_Z] -= height_offset;
+	ik_kinematics(travel, substeps, microseconds);
+	st_prep_position(position, travel);					// for the probe position latch
+	st_prep_power(_get_segment_power());
+	_prep_raster(mr.gm.target);
+	mp_prep_outputs(mr.segment_velocity * mr.segment_move_time, microseconds);
+	if (st_prep_line_substeps(substeps, st_prep_ticks(microseconds)) == STAT_OK) {
 		copy_axis_vector(mr.position, mr.gm.target); 	// update runtime position	
+		mp_commit_outputs(mr.segment_velocity * mr.segment_move_time, microseconds);
+		mr.height_offset = height_offset;
+		mp_publish_runtime();
+		bl_segment(microseconds, mr.snapshot.velocity, mr.move_state);
+		sh_commit();
+		pa_commit();
+		ik_commit();
 /* TRY THIS
 		mr.position[AXIS_X] = mr.gm.target[AXIS_X];
 		mr.position[AXIS_Y] = mr.gm.target[AXIS_Y];
@@ -1274,286 +2654,691 @@ static stat_t _exec_aline_segment(uint8_t correction_flag)
 	if (--mr.segment_count == 0) return (STAT_OK);		// this section has run all its segments
 	return (STAT_EAGAIN);								// this section still has more segments to run
 }
+#endif // __FIXED_POINT_RUNTIME
+
+/*
+ * mp_exec_shaper() - run a segment of the input shaper delay out
+ *
+ *	Called by mp_exec_move() in place of the next buffer until the shaped axes have 
+ *	caught up with the runtime position (see shaper.h), the extruder advance is back to
+ *	zero (see pressure.h), and until any backlash take-up has run (see kinematics.h).
+ *	The runtime doesn't move, so the segment is only the motors closing the gap. Runs at
+ *	nominal segment time.
+ */
+RAMFUNC stat_t mp_exec_shaper()
+{
+	float position[AXES];
+	float travel[AXES];
+	int32_t substeps[MOTORS];
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		position[axis] = mp_get_runtime_absolute_position(axis);
+		travel[axis] = 0;
+	}
+	position[AXIS_Z] += mr.height_offset;
+	sh_shape(position, travel, NOM_SEGMENT_USEC);
+	pa_advance(position, travel, NOM_SEGMENT_USEC);
+	position[AXIS_Z] -= mr.height_offset;
+	ik_kinematics(travel, substeps, NOM_SEGMENT_USEC);
+	st_prep_position(position, travel);
+	st_prep_power((pwm.c[PWM_1].dynamic_power == false) ? PREP_POWER_NONE : 0);
+	if (st_prep_line_substeps(substeps, st_prep_ticks(NOM_SEGMENT_USEC)) == STAT_OK) {
+		sh_commit();
+		pa_commit();
+		ik_commit();
+	}
+	return (STAT_OK);
+}
+
+#ifdef __NATIVE_ARCS
+/*
+ * _advance_arc() - advance a native arc by a segment length and set the arc axis targets
+ *
+ *	The angle is computed from the path length run since the start of the move, so 
+ *	rounding does not accumulate from segment to segment.
+ */
+static void _advance_arc(const float length, float target[])
+{
+	mr.arc_travel += length;
+	float theta = mr.arc_theta + mr.arc_travel * mr.arc.dtheta;
+	target[mr.arc.axis_1] = mr.arc.center_1 + sin(theta) * mr.arc.radius;
+	target[mr.arc.axis_2] = mr.arc.center_2 + cos(theta) * mr.arc.radius;
+	target[mr.arc.axis_linear] = mr.arc_linear + mr.arc_travel * mr.arc.dlinear;
+}
+#endif // __NATIVE_ARCS
+
+/**** PVT POINTS **********************************************************
+ * mp_pvt()			  - queue a position-velocity-time point
+ * _exec_pvt()		  - run a PVT point
+ * _get_pvt_position() - position at s (0 to 1) of the way through the running point
+ *
+ *	A PVT point is a position (machine coordinates, mm), the velocity of each axis 
+ *	there (mm/min) and the time to get there from the point before (seconds). Points 
+ *	come from a host that has already planned the motion (see cm_set_pvt()), so they 
+ *	skip mp_aline() planning altogether. Each point takes a planner buffer that the 
+ *	planner treats as a momentary hold like any other non-line block: lines before a 
+ *	stream plan down to zero and lines after it plan up from zero.
+ *
+ *	Each axis follows the cubic Hermite curve that meets the position and velocity at 
+ *	both ends of the point, in segments of about the nominal segment time, through the 
+ *	height map, shaper and kinematics as a line would. The velocities at the start are 
+ *	those at the end of the point before if that was a PVT point, otherwise zero. 
+ *	Overrides scale the time as they do for lines. The spindle power is left as it is.
+ *
+ *	The time goes in gm->move_time in seconds, as for a dwell, and counts in the planner
+ *	queue time. The host keeps the stream ahead of the runtime by the queue time in the
+ *	queue reports ("qt"). A queue that runs dry stops the motors where they are, so a 
+ *	stream should start from rest and end with all velocities at zero. A feedhold stops 
+ *	at the next point that ends at rest.
+ */
+#define pvt_exit_velocity unit		// bf->unit holds the velocities at the end of a PVT point
+
+stat_t mp_pvt(const float target[], const float velocity[], const float seconds)
+{
+	mp_plan_residual();
+	return (_queue_pvt(NULL, target, velocity, seconds));
+}
+
+static stat_t _queue_pvt(const GCodeState_t *gm_line, const float target[], const float velocity[], const float seconds)
+{
+	mpBuf_t *bf;
+
+	if ((bf = mp_get_write_buffer()) == NULL) {	// get write buffer or fail
+		return (STAT_BUFFER_FULL_FATAL);		// (not ever supposed to fail)
+	}
+	bf->bf_func = _exec_pvt;
+	if (gm_line != NULL) {
+		mp_bind_gcode_state(bf, gm_line);		// a rapid's line number and traverse override
+	} else {
+		bf->gm->motion_mode = MOTION_MODE_STRAIGHT_FEED;	// takes the feed override
+	}
+	bf->gm->move_time = seconds;
+	copy_axis_vector(bf->gm->target, target);
+	copy_axis_vector(bf->pvt_exit_velocity, velocity);
+	copy_axis_vector(mm.position, target);		// lines plan on from the point
+	mp_queue_write_buffer(MOVE_TYPE_PVT);
+	return (STAT_OK);
+}
+
+static stat_t _exec_pvt(mpBuf_t *bf)
+{
+	if (mr.move_state == MOVE_STATE_OFF) {
+		if (cm.hold_state == FEEDHOLD_HOLD) { return (STAT_NOOP);}	// stops here if holding
+
+		mp_load_runtime_gcode_state(bf);
+		sr_mark_changed(SR_CHANGED_BLOCK);
+		uint8_t stream = (mr.pvt_seq == mb.seq_freed);	// nothing ran since the last point
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			mr.pvt_start[axis] = mp_get_runtime_absolute_position(axis);
+			mr.pvt_entry[axis] = (stream == true) ? mr.pvt_exit[axis] : 0;
+		}
+		copy_axis_vector(mr.pvt_exit, bf->pvt_exit_velocity);
+		copy_axis_vector(mr.endpoint, bf->gm->target);
+		mr.pvt_time = bf->gm->move_time / 60;		// minutes, as the velocities
+
+		mr.segment_length_max = KINEMATICS_SEGMENT_LENGTH;
+		float map_segment = ik_height_map_segment_length();
+		if ((map_segment > 0) && ((fp_ZERO(mr.segment_length_max)) || (map_segment < mr.segment_length_max))) {
+			mr.segment_length_max = map_segment;
+		}
+		mr.backoff_section = false;
+		mr.segments = max(1, ceil(uSec(mr.pvt_time) / (cm.estd_segment_usec * mr.segment_backoff)));
+		if (mr.segment_length_max > 0) {			// the chord is a fair guess at the length
+			mr.segments = max(mr.segments, min(ceil(get_axis_vector_length(mr.endpoint, mr.pvt_start) / mr.segment_length_max),
+											   floor(uSec(mr.pvt_time) / (MIN_SEGMENT_USEC * mr.segment_backoff))));
+		}
+		mr.segment_count = (uint32_t)mr.segments;
+		mr.segment_move_time = mr.pvt_time / mr.segments;
+		mr.microseconds = uSec(mr.segment_move_time);
+		mr.forward_diff_1 = 0;
+#ifdef __NATIVE_ARCS
+		mr.arc_move = false;
+#endif
+		bf->move_state = MOVE_STATE_RUN;
+		mr.move_state = MOVE_STATE_RUN;
+	}
+
+	// run a segment - the last one goes to the point itself
+	float target[AXES];
+	float travel[AXES];
+	int32_t substeps[MOTORS];
+	if (mr.segment_count == 1) {
+		copy_axis_vector(target, mr.endpoint);
+	} else {
+		_get_pvt_position((mr.segments - mr.segment_count + 1) / mr.segments, target);
+	}
+#ifdef __FIXED_POINT_RUNTIME
+	fixed_t position[AXES];
+	int32_t counts[AXES];								// travel in Q8.24 mm
+	for (uint8_t i=0; i<AXES; i++) {
+		position[i] = (fixed_t)(target[i] * FX_ONE);
+		counts[i] = (int32_t)((position[i] >> 8) - (mr.position[i] >> 8));
+		travel[i] = (float)counts[i] * FX_TRAVEL_UNIT;
+	}
+#else
+	for (uint8_t i=0; i<AXES; i++) { travel[i] = target[i] - mr.position[i];}
+#endif
+	float length = 0;
+	for (uint8_t i=0; i<AXES; i++) { length += square(travel[i]);}
+	mr.segment_velocity = _to_runtime(sqrt(length) / mr.segment_move_time);	// for the reports
+
+	float height_offset = _get_height_offset(target);
+	travel[AXIS_Z] += height_offset - mr.height_offset;
+	float microseconds = mr.microseconds / _update_override_factor();	// time-scale for overrides
+	target[AXIS_Z] += height_offset;
+	sh_shape(target, travel, microseconds);				// the motors follow the shaped position
+	pa_advance(target, travel, microseconds);
+	target[AXIS_Z] -= height_offset;
+#ifdef __FIXED_POINT_RUNTIME
+	_segment_kinematics(counts, travel, substeps, microseconds, height_offset);
+#else
+	ik_kinematics(travel, substeps, microseconds);
+#endif
+	st_prep_position(target, travel);					// for the probe position latch
+	st_prep_power(PREP_POWER_NONE);
+	if (st_prep_line_substeps(substeps, st_prep_ticks(microseconds)) == STAT_OK) {
+#ifdef __FIXED_POINT_RUNTIME
+		for (uint8_t i=0; i<AXES; i++) { mr.position[i] = position[i];}	// update runtime position
+#else
+		copy_axis_vector(mr.position, target);
+#endif
+		mr.height_offset = height_offset;
+		mp_publish_runtime();
+		sh_commit();
+		pa_commit();
+		ik_commit();
+	}
+	sr_mark_changed(SR_CHANGED_MOTION);
+	if (--mr.segment_count > 0) {
+		sr_request_status_report(SR_TIMED_REQUEST);
+		return (STAT_EAGAIN);
+	}
 
+	// the point is done - a feedhold stops here if it ends at rest
+	mr.move_state = MOVE_STATE_OFF;
+	mr.section_state = MOVE_STATE_OFF;
+	if (cm.hold_state == FEEDHOLD_SYNC) {
+		uint8_t at_rest = true;
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			if (fp_NOT_ZERO(mr.pvt_exit[axis])) { at_rest = false;}
+		}
+		if (at_rest == true) {
+			cm.hold_state = FEEDHOLD_HOLD;
+			cm_set_motion_state(MOTION_HOLD);
+			sr_request_status_report(SR_IMMEDIATE_REQUEST);
+		}
+	}
+	mp_free_run_buffer();
+	mr.pvt_seq = mb.seq_freed;
+	return (STAT_OK);
+}
 
-/****** UNIT TESTS ******/
+static void _get_pvt_position(const float s, float position[])
+{
+	float s2 = square(s);
+	float s3 = s2 * s;
+	float h01 = 3*s2 - 2*s3;						// Hermite basis - the start position takes 1 - h01
+	float h10 = (s3 - 2*s2 + s) * mr.pvt_time;		// ...and the velocities scaled to the point's time
+	float h11 = (s3 - s2) * mr.pvt_time;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		position[axis] = mr.pvt_start[axis] + h01 * (mr.endpoint[axis] - mr.pvt_start[axis]) +
+						 h10 * mr.pvt_entry[axis] + h11 * mr.pvt_exit[axis];
+	}
+}
 
-#ifdef __UNIT_TESTS
-#ifdef __UNIT_TEST_PLANNER
+/**** DOGLEG RAPIDS *******************************************************
+ * mp_dogleg()			 - queue a rapid as independent axis profiles
+ * _get_profile_time()	 - time of a rest-to-rest profile - lowers the velocity if it isn't reached
+ * _get_dogleg_position() - position and velocity of one axis t minutes into its profile
+ *
+ *	With $rmo=1 a G0 that moves more than one axis doesn't go in a straight line. Each 
+ *	axis runs the jerk-limited rest-to-rest profile it would run moving alone, at its 
+ *	own velocity_max and jerk_max, so a short or slow axis doesn't hold the others back
+ *	on the ramps and an axis done early stops. The rapid takes as long as its slowest 
+ *	axis alone. For an axis of length L, velocity V and jerk J the head (and tail) 
+ *	takes Th = 2*sqrt(V/J) over V*Th/2, and if L is less than V*Th, V is lowered to
+ *	(L*sqrt(J)/2)^(2/3) so the head meets the tail.
+ *
+ *	A line's jerk is the vector sum of its axes' (see _set_aline_terms()), which lets a
+ *	minor axis go over its own jerk_max, so with a slow-jerk axis in the move the line
+ *	can be the faster of the two. The same profile math is run for the line and the
+ *	rapid goes straight unless the dogleg takes less time.
+ *
+ *	The profiles are queued as PVT points (see mp_pvt()) at the times where any axis 
+ *	changes phase - up to MP_DOGLEG_POINTS per axis. Within a point each axis is at 
+ *	constant jerk, so its position is a cubic that the point's Hermite curve follows 
+ *	exactly. Points under MIN_SEGMENT_TIME are merged with the one after.
+ *
+ *	Every axis moves one way only, so the path stays within the box between the start
+ *	and the target and inside any soft limit they are both inside. The rapid starts and
+ *	ends at rest, a feedhold stops at its end, and the traverse override applies. A 
+ *	rapid that finds fewer free buffers than it has points runs as a straight line.
+ */
+stat_t mp_dogleg(const GCodeState_t *gm_line)
+{
+	float length[AXES], velocity[AXES], jerk[AXES], head[AXES], time[AXES];
+	float knot[AXES * MP_DOGLEG_POINTS];
+	uint8_t knots = 0;
+	uint8_t axes = 0;
+	float line_length = 0;
+	float line_jerk = 0;
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		length[axis] = gm_line->target[axis] - mm.position[axis];
+		time[axis] = 0;
+		if (fp_ZERO(length[axis])) { continue;}
+		float L = fabs(length[axis]);
+		jerk[axis] = cm.a[axis].jerk_max * JERK_MULTIPLIER;
+		velocity[axis] = 1 / cm.recip_velocity_max[axis];	// velocity_max or the step rate limit
+		time[axis] = _get_profile_time(L, &velocity[axis], jerk[axis]);
+		head[axis] = 2 * sqrt(velocity[axis] / jerk[axis]);
+		line_length += square(L);
+		line_jerk += square(L * cm.a[axis].jerk_max);
+		knot[knots++] = head[axis] / 2;
+		knot[knots++] = head[axis];
+		knot[knots++] = time[axis] - head[axis];
+		knot[knots++] = time[axis] - head[axis] / 2;
+		knot[knots++] = time[axis];
+		axes++;
+	}
+	if (axes < 2) { return (mp_aline(gm_line));}		// one axis is a straight line anyway
 
-//#define JERK_TEST_VALUE (float)50000000	// set this to the value in the profile you are running
-#define JERK_TEST_VALUE (float)100000000	// set this to the value in the profile you are running
+	line_length = sqrt(line_length);					// the line as _set_aline_terms() would have it
+	float line_velocity = line_length / gm_line->move_time;
+	float line_time = _get_profile_time(line_length, &line_velocity, sqrt(line_jerk) / line_length * JERK_MULTIPLIER);
 
-static void _test_calculate_trapezoid(void);
-static void _test_get_junction_vmax(void);
-static void _test_trapezoid(float length, float Ve, float Vt, float Vx, mpBuf_t *bf);
-static void _make_unit_vector(float unit[], float x, float y, float z, float a, float b, float c);
-//static void _set_jerk(const float jerk, mpBuf_t *bf);
-static void _test_get_target_length(void);
-static void _test_get_target_velocity(void);
+	for (uint8_t i=1; i<knots; i++) {					// sort the knots...
+		float t = knot[i];
+		uint8_t j = i;
+		for (; (j > 0) && (knot[j-1] > t); j--) { knot[j] = knot[j-1];}
+		knot[j] = t;
+	}
+	float end = knot[knots-1];
+	uint8_t points = 0;
+	float t_last = 0;
+	for (uint8_t i=0; i<knots; i++) {					// ...and drop the ones too close together
+		if ((knot[i] - t_last) >= MIN_SEGMENT_TIME) { knot[points++] = t_last = knot[i];}
+	}
+	if (points == 0) { points = 1;}
+	knot[points-1] = end;								// the last point goes to the end
+	if ((end >= line_time) || (mp_get_planner_buffers_available() < points)) { return (mp_aline(gm_line));}
+
+	mp_plan_residual();
+	float start[AXES];
+	copy_axis_vector(start, mm.position);
+	t_last = 0;
+	for (uint8_t i=0; i<points; i++) {
+		float target[AXES], v[AXES];
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			if ((fp_ZERO(time[axis])) || (i == points-1)) {
+				target[axis] = (i == points-1) ? gm_line->target[axis] : start[axis];
+				v[axis] = 0;
+				continue;
+			}
+			float sign = (length[axis] > 0) ? 1 : -1;
+			target[axis] = start[axis] + sign * _get_dogleg_position(knot[i], fabs(length[axis]), velocity[axis],
+																	  jerk[axis], head[axis], time[axis], &v[axis]);
+			v[axis] *= sign;
+		}
+		ritorno(_queue_pvt(gm_line, target, v, (knot[i] - t_last) * 60));
+		t_last = knot[i];
+	}
+	return (STAT_OK);
+}
 
-void mp_unit_tests()
+static float _get_profile_time(const float length, float *velocity, const float jerk)
 {
-	_test_get_target_length();
-//	_test_get_target_velocity();
-//	_test_calculate_trapezoid();
-//	_test_get_junction_vmax();
+	if ((2 * *velocity * sqrt(*velocity / jerk)) > length) {	// never reaches the velocity
+		*velocity = pow(length * sqrt(jerk) / 2, (float)2/3);
+	}
+	return (2 * sqrt(*velocity / jerk) + length / *velocity);	// head, body and tail
 }
 
-static void _test_get_target_length()
+static float _get_dogleg_position(const float t, const float length, const float velocity, const float jerk, 
+								  const float head, const float time, float *v)
 {
-	mpBuf_t *bf = mp_get_write_buffer();
-	bf->jerk = 1800000;
-	bf->recip_jerk = 1/bf->jerk;
-	float L;
-	float Vi;
-	float Vt;
+	if (t >= time) { *v = 0; return (length);}
+	uint8_t tail = (t > (time - head));
+	float tau = (tail == true) ? (time - t) : t;		// the tail mirrors the head
+	float position;
+	if (tau > head) {									// body
+		*v = velocity;
+		return (velocity * (head/2 + t - head));
+	} else if (tau <= head/2) {							// concave half of the head
+		*v = jerk * square(tau) / 2;
+		position = jerk * tau * square(tau) / 6;
+	} else {											// convex half
+		float u = head - tau;
+		*v = velocity - jerk * square(u) / 2;
+		position = velocity * (head/2 - u) + jerk * u * square(u) / 6;
+	}
+	return ((tail == true) ? (length - position) : position);
+}
 
-	Vi = 0;
-	Vt = 300;
-	L = _get_target_length(Vi, Vt, bf);		// result: L = 3.872983
-	Vt = _get_target_velocity(Vi, L, bf);	// result: Vt = 300
+/**** JOGGING *************************************************************
+ * mp_jog()		   - queue a jog (see Jogging in canonical_machine.cpp)
+ * _exec_jog()	   - follow the jog velocities a segment at a time
+ * _get_jog_travel() - step an axis' velocity toward its jog velocity. Returns the travel
+ *
+ *	A jog is a single buffer the runtime stays in until the jog is over, so nothing is
+ *	planned ahead and a new velocity is taken up from the next segment. Each segment of
+ *	about the nominal segment time every axis moves its velocity toward the one asked for
+ *	under its jerk limit. The acceleration ramps toward the most that can still be ramped
+ *	off by the time the velocity gets there,
+ *
+ *	  a = sqrt(2 * J * |Vjog - V|)
+ *
+ *	which meets the new velocity without overshooting it. Axes follow independently -
+ *	a diagonal jog takes each axis up at its own rate. The segments go through the
+ *	height map, shaper and kinematics as a line's do. Overrides don't apply.
+ *
+ *	A feedhold or an alarm zeros the velocities. The jog ends once every axis has
+ *	stopped with nothing left to follow, which frees the buffer and ends the cycle.
+ */
+stat_t mp_jog()
+{
+	mpBuf_t *bf;
 
-	Vi = 165;
-	Vt = 300;
-	L = _get_target_length(Vi, Vt, bf);		// result: L = 4.027018
-	Vt = _get_target_velocity(Vi, L, bf);	// result: Vt = 300
+	if ((bf = mp_get_write_buffer()) == NULL) {	// get write buffer or fail
+		return (STAT_BUFFER_FULL_FATAL);		// (not ever supposed to fail)
+	}
+	bf->bf_func = _exec_jog;
+	mp_queue_write_buffer(MOVE_TYPE_JOG);
+	return (STAT_OK);
+}
 
-	Vi = 523;
-	Vt = 600;
-	L = _get_target_length(Vi, Vt, bf);		// result: L = 7.344950
-	Vt = _get_target_velocity(Vi, L, bf);	// result: Vt = 600
+static stat_t _exec_jog(mpBuf_t *bf)
+{
+	float velocity[AXES];
+	uint8_t moving = cm_get_jog_velocity(velocity);
+	if ((cm.hold_state != FEEDHOLD_OFF) || (cm.machine_state == MACHINE_ALARM)) {
+		for (uint8_t axis=0; axis<AXES; axis++) { velocity[axis] = 0;}
+		moving = false;
+	}
+	if (mr.move_state == MOVE_STATE_OFF) {
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			mr.jog_velocity[axis] = 0;
+			mr.jog_accel[axis] = 0;
+		}
+		mr.microseconds = cm.estd_segment_usec;
+		mr.segment_move_time = mr.microseconds / MICROSECONDS_PER_MINUTE;
+		mr.forward_diff_1 = 0;
+#ifdef __NATIVE_ARCS
+		mr.arc_move = false;
+#endif
+		bf->move_state = MOVE_STATE_RUN;
+		mr.move_state = MOVE_STATE_RUN;
+	}
+	if (moving == false) {						// done once everything has stopped
+		uint8_t stopped = true;
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			if (fp_NOT_ZERO(mr.jog_velocity[axis])) { stopped = false;}
+		}
+		if (stopped == true) {
+			mr.move_state = MOVE_STATE_OFF;
+			mr.section_state = MOVE_STATE_OFF;
+			mp_zero_segment_velocity();
+			cm.jog_ended = true;				// the model takes up the position (see cm_jog_callback())
+			mp_free_run_buffer();				// ends the cycle
+			return (STAT_OK);
+		}
+	}
 
-	Vi = 200;
-	Vt = 400;
-	L = _get_target_length(Vi, Vt, bf);		// result: L = 6.324555
-	Vt = _get_target_velocity(Vi, L, bf);	// result: Vt = 400
+	// run a segment
+	float target[AXES];
+	float travel[AXES];
+	int32_t substeps[MOTORS];
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		target[axis] = mp_get_runtime_absolute_position(axis) + _get_jog_travel(axis, velocity[axis]);
+	}
+#ifdef __FIXED_POINT_RUNTIME
+	fixed_t position[AXES];
+	int32_t counts[AXES];								// travel in Q8.24 mm
+	for (uint8_t i=0; i<AXES; i++) {
+		position[i] = (fixed_t)(target[i] * FX_ONE);
+		counts[i] = (int32_t)((position[i] >> 8) - (mr.position[i] >> 8));
+		travel[i] = (float)counts[i] * FX_TRAVEL_UNIT;
+	}
+#else
+	for (uint8_t i=0; i<AXES; i++) { travel[i] = target[i] - mr.position[i];}
+#endif
+	float length = 0;
+	for (uint8_t i=0; i<AXES; i++) { length += square(travel[i]);}
+	mr.segment_velocity = _to_runtime(sqrt(length) / mr.segment_move_time);	// for the reports
+
+	float height_offset = _get_height_offset(target);
+	travel[AXIS_Z] += height_offset - mr.height_offset;
+	target[AXIS_Z] += height_offset;
+	sh_shape(target, travel, mr.microseconds);
+	pa_advance(target, travel, mr.microseconds);
+	target[AXIS_Z] -= height_offset;
+#ifdef __FIXED_POINT_RUNTIME
+	_segment_kinematics(counts, travel, substeps, mr.microseconds, height_offset);
+#else
+	ik_kinematics(travel, substeps, mr.microseconds);
+#endif
+	st_prep_position(target, travel);					// for the probe position latch
+	st_prep_power(PREP_POWER_NONE);
+	if (st_prep_line_substeps(substeps, st_prep_ticks(mr.microseconds)) == STAT_OK) {
+#ifdef __FIXED_POINT_RUNTIME
+		for (uint8_t i=0; i<AXES; i++) { mr.position[i] = position[i];}	// update runtime position
+#else
+		copy_axis_vector(mr.position, target);
+#endif
+		mr.height_offset = height_offset;
+		mp_publish_runtime();
+		sh_commit();
+		pa_commit();
+		ik_commit();
+	}
+	sr_mark_changed(SR_CHANGED_MOTION);
+	sr_request_status_report(SR_TIMED_REQUEST);
+	return (STAT_EAGAIN);
+}
 
-	Vi = 174;
-	Vt = 347;
-	L = _get_target_length(Vi, Vt, bf);		// result: L = 5.107690
-	Vt = _get_target_velocity(Vi, L, bf);	// result: Vt = 347
+static float _get_jog_travel(const uint8_t axis, const float velocity)
+{
+	float v0 = mr.jog_velocity[axis];
+	float dv = velocity - v0;
+	if (fp_ZERO(dv)) {
+		mr.jog_velocity[axis] = velocity;
+		mr.jog_accel[axis] = 0;
+		return (velocity * mr.segment_move_time);
+	}
+	float jerk = cm.a[axis].jerk_max * JERK_MULTIPLIER;
+	float accel = copysignf(sqrt(2 * jerk * fabs(dv)), dv);
+	float jerk_step = jerk * mr.segment_move_time;
+	float *a = &mr.jog_accel[axis];
+	*a = (accel > *a) ? min(accel, *a + jerk_step) : max(accel, *a - jerk_step);
+	float v1 = v0 + *a * mr.segment_move_time;
+	if (((velocity - v1) * dv) <= 0) {			// got there - take it exactly
+		v1 = velocity;
+		*a = 0;
+	}
+	mr.jog_velocity[axis] = v1;
+	return ((v0 + v1) / 2 * mr.segment_move_time);
 }
 
-static void _test_get_target_velocity()
+/**** RASTER LINES ********************************************************
+ * mp_raster()		 - queue a raster line (see RASTER LINES in planner.h)
+ * mp_raster_room()	 - TRUE if a line of RASTER_PIXELS_MAX pixels can be queued
+ * _raster_alloc()	 - find room for count pixels in the ring. Returns the offset or -1
+ * _prep_raster()	 - prep the pixels of a segment ending at target (exec)
+ *
+ *	The line runs from the planning position to the target, with its pixels spread 
+ *	evenly along it. It is planned as a feed by mp_aline() would, but never merged 
+ *	with the moves around it (see _coalesce_aline()). A held residual is run into the
+ *	block before it if it can be, otherwise with the line as for any feed.
+ *
+ *	The ring is empty when rd == wr. Lines are written after wr, or at the start of
+ *	the ring if they don't fit before its end and the start is free. rd is the end of
+ *	the last line freed, so it never runs ahead of the lines still queued.
+ */
+stat_t mp_raster(const GCodeState_t *gm_line, const uint8_t pixels[], const uint16_t count)
 {
-	mpBuf_t *bf = mp_get_write_buffer();
+	mpBuf_t *bf;
+
+	mp_plan_residual();
+	float length = get_axis_vector_length(gm_line->target, mm.position);
+	if (length < MIN_LENGTH_MOVE) { return (STAT_MINIMUM_LENGTH_MOVE_ERROR);}
+	int32_t offset = _raster_alloc(count);
+	if (offset < 0) { return (STAT_BUFFER_FULL);}		// the controller waits for room (see mp_raster_room())
+	if ((bf = mp_get_write_buffer()) == NULL) { return(cm_alarm(STAT_BUFFER_FULL_FATAL));} // never supposed to fail
 
-	float L = 3.872983;
-	float Vi = 0;
-	float Vt; 			// 300
-	bf->jerk = 1800000;
+	memcpy(&mrr.pixels[offset], pixels, count);
+	mrr.wr = offset + count;
+	mp_bind_gcode_state(bf, gm_line);
+	bf->gm->move_time += _take_residual_time();
+	bf->gm->raster_offset = offset;
+	bf->gm->raster_count = count;
+	bf->gm->raster_pitch = length / count;
+	bf->bf_func = _exec_aline;
+	_set_aline_terms(bf, mm.position, length);
 
-	Vt = _get_target_velocity(Vi, L, bf);
+	uint8_t mr_flag = false;
+	_plan_block_list(bf, &mr_flag);
+	copy_axis_vector(mm.position, bf->gm->target);
+	mp_queue_write_buffer(MOVE_TYPE_ALINE);
+	return (STAT_OK);
 }
 
-static void _test_trapezoid(float length, float Ve, float Vt, float Vx, mpBuf_t *bf)
+uint8_t mp_raster_room() { return ((_raster_alloc(RASTER_PIXELS_MAX) < 0) ? false : true);}
+
+static int32_t _raster_alloc(const uint16_t count)
 {
-	bf->length = length;
-	bf->entry_velocity = Ve;
-	bf->cruise_velocity = Vt;
-	bf->exit_velocity = Vx;
-	bf->cruise_vmax = Vt;
-	bf->jerk = JERK_TEST_VALUE;
-	bf->recip_jerk = 1/bf->jerk;
-	bf->cbrt_jerk = cbrt(bf->jerk);
-	_calculate_trapezoid(bf);
+	uint16_t rd = mrr.rd;
+	uint16_t wr = mrr.wr;
+	if (wr >= rd) {
+		if ((wr + count) <= RASTER_BUFFER_LEN) { return (wr);}
+		if (count < rd) { return (0);}				// wrap - the end of the ring goes unused
+	} else if ((wr + count) < rd) {
+		return (wr);
+	}
+	return (-1);
 }
 
-static void _test_calculate_trapezoid()
+static void _prep_raster(const float target[])
 {
-	mpBuf_t *bf = mp_get_write_buffer();
+	if (mr.raster == NULL) { return;}
+	float position[AXES];
+	for (uint8_t axis=0; axis<AXES; axis++) { position[axis] = mp_get_runtime_absolute_position(axis);}
+	float first = mr.raster_count - get_axis_vector_length(mr.endpoint, position) / mr.raster_pitch;
+	float last = mr.raster_count - get_axis_vector_length(mr.endpoint, target) / mr.raster_pitch;
+	st_prep_raster(mr.raster, mr.raster_count, first, last);
+}
 
-// these tests are calibrated the following parameters:
-//	jerk_max 				50 000 000		(all axes)
-//	jerk_corner_offset		   		 0.1	(all exes)
-//	jerk_corner_acceleration   200 000		(global)
 
+/****** MICROBENCHMARK KERNELS ******/
+
+#ifdef __MICROBENCHMARKS
 /*
-// no-fit cases: line below minimum velocity or length
-//				   	L	 Ve  	Vt		Vx
-	_test_trapezoid(1.0, 0,		0.001,	0,	bf);
-	_test_trapezoid(0.0, 0,		100,	0,	bf);
-	_test_trapezoid(0.01, 0,	100,	0,	bf);
-
-// requested-fit cases
-//				   	L  	 Ve  	Vt		Vx
-	_test_trapezoid(0.8, 400,	400, 	0, 	 bf);
-	_test_trapezoid(0.8, 600,	600, 	200, bf);
-	_test_trapezoid(0.8, 0,		400, 	400, bf);
-	_test_trapezoid(0.8, 200,	600, 	600, bf);
-
-// HBT - 3 section cases
-//				   	L    Ve  	Vt		Vx
-	_test_trapezoid(0.8, 0,		190, 	0, bf);
-	_test_trapezoid(2.0, 200,	400, 	0, bf);
-
-// 2 section cases (HT)
-//				   	L   Ve  	Vt		Vx
-	_test_trapezoid(0.8, 0,		200, 	0, bf);		// requested fit HT case (exact fit)
-	_test_trapezoid(0.8, 0,		400, 	0, bf);		// symmetric rate-limited HT case
-	_test_trapezoid(0.8, 200,	400, 	0, bf);		// asymmetric rate-limited HT case
-	_test_trapezoid(2.0, 400,	400, 	0, bf);
-	_test_trapezoid(0.8, 0,		400, 	200,bf);
-
-// 1 section cases (H,B and T)
-//				   	L	 Ve  	Vt		Vx
-	_test_trapezoid(1.0, 800,	800, 	800,bf);	// B case
-	_test_trapezoid(0.8, 0,		400, 	0, bf);		// B case
-	_test_trapezoid(0.8, 200,	400, 	0, bf);
-	_test_trapezoid(2.0, 400,	400, 	0, bf);
-	_test_trapezoid(0.8, 0,		400, 	200,bf);
-*/
-// test cases drawn from Mudflap
-//				   	L		Ve  	  Vt		Vx
-//	_test_trapezoid(0.6604, 000.000,  800.000,  000.000, bf);	// line 50
-//	_test_trapezoid(0.8443, 000.000,  805.855,  000.000, bf);	// line 55
-	_test_trapezoid(0.8443, 000.000,  805.855,  393.806, bf);	// line 55'
-	_test_trapezoid(0.7890, 393.805,  955.829,  000.000, bf);	// line 60
-	_test_trapezoid(0.7890, 393.806,  955.829,  390.294, bf);	// line 60'
-	_test_trapezoid(0.9002, 390.294,  833.884,  000.000, bf);	// line 65
-
-	_test_trapezoid(0.9002, 390.294,  833.884,  455.925, bf);	// line 65'
-	_test_trapezoid(0.9002, 390.294,  833.884,  806.895, bf);	// line 65"
-	_test_trapezoid(0.9735, 455.925,  806.895,  000.000, bf);	// line 70
-	_test_trapezoid(0.9735, 455.925,  806.895,  462.101, bf);	// line 70'
-
-	_test_trapezoid(0.9735, 806.895,  806.895,  802.363, bf);	// line 70"
-
-	_test_trapezoid(0.9935, 462.101,  802.363,  000.000, bf);	// line 75
-	_test_trapezoid(0.9935, 462.101,  802.363,  000.000, bf);	// line 75'
-	_test_trapezoid(0.9935, 802.363,  802.363,  477.729, bf);	// line 75"
-	_test_trapezoid(0.9935, 802.363,  802.363,  802.363, bf);	// line 75"
-	_test_trapezoid(1.0441, 477.729,  843.274,  000.000, bf);	// line 80
-	_test_trapezoid(1.0441, 802.363,  843.274,  388.515, bf);	// line 80'
-	_test_trapezoid(1.0441, 802.363,  843.274,  803.990, bf);	// line 80"
-	_test_trapezoid(0.7658, 388.515,  803.990,  000.000, bf);	// line 85
-	_test_trapezoid(0.7658, 803.990,  803.990,  733.618, bf);	// line 85'
-	_test_trapezoid(0.7658, 803.990,  803.990,  802.363, bf);	// line 85"
-	_test_trapezoid(1.9870, 733.618,  802.363,  000.000, bf);	// line 90
-	_test_trapezoid(1.9870, 802.363,  802.363,  727.371, bf);	// line 90'
-	_test_trapezoid(1.9870, 802.363,  802.363,  802.363, bf);	// line 90'
-	_test_trapezoid(1.9617, 727.371,  802.425,  000.000, bf);	// line 95
-	_test_trapezoid(1.9617, 727.371,  802.425,  000.000, bf);	// line 95'
-	_test_trapezoid(1.9617, 802.363,  802.425,  641.920, bf);	// line 95"
-	_test_trapezoid(1.9617, 802.363,  802.425,  802.425, bf);	// line 95"'
-	_test_trapezoid(1.6264, 641.920,  826.209,  000.000, bf);	// line 100
-	_test_trapezoid(1.6264, 802.425,  826.209,  266.384, bf);	// line 100'
-	_test_trapezoid(1.6264, 802.425,  826.209,  658.149, bf);	// line 100"
-	_test_trapezoid(1.6264, 802.425,  826.209,  679.360, bf);	// line 100"'
-	_test_trapezoid(0.4348, 266.384,  805.517,  000.000, bf);	// line 105
-	_test_trapezoid(0.4348, 658.149,  805.517,  391.765, bf);	// line 105'
-	_test_trapezoid(0.4348, 679.360,  805.517,  412.976, bf);	// line 105"
-	_test_trapezoid(0.7754, 391.765,  939.343,  000.000, bf);	// line 110
-	_test_trapezoid(0.7754, 412.976,  939.343,  376.765, bf);	// line 110'
-	_test_trapezoid(0.7754, 802.425,  826.209,  679.360, bf);	// line 110"
-	_test_trapezoid(0.7754, 412.976,  939.343,  804.740, bf);	// line 110"'
-	_test_trapezoid(0.7313, 376.765,  853.107,  000.000, bf);	// line 115
-	_test_trapezoid(0.7313, 804.740,  853.107,  437.724, bf);	// line 115'
-	_test_trapezoid(0.7313, 804.740,  853.107,  683.099, bf);	// line 115"
-	_test_trapezoid(0.7313, 804.740,  853.107,  801.234, bf);	// line 115"'
-	_test_trapezoid(0.9158, 437.724,  801.233,  000.000, bf);	// line 120
-	_test_trapezoid(0.9158, 683.099,  801.233,  245.375, bf);	// line 120'
-	_test_trapezoid(0.9158, 801.233,  801.233,  617.229, bf);	// line 120"
-	_test_trapezoid(0.3843, 245.375,  807.080,  000.000, bf);	// line 125
-	_test_trapezoid(0.3843, 617.229,  807.080,  371.854, bf);	// line 125'  6,382,804 cycles
-
-
-
-	_test_trapezoid(0.8, 0,	400, 400, bf);
-
-
-// test cases drawn from braid_600mm					 		// expected results
-//				   	L   	Ve  		Vt		Vx
-	_test_trapezoid(0.327,	000.000,	600,	000.000, bf); // Ve=0 	   	Vc=110.155
-	_test_trapezoid(0.327,	000.000,	600,	174.538, bf); // Ve=0, 	   	Vc=174.744	Vx=174.537
-	_test_trapezoid(0.327,	174.873,	600,	173.867, bf); // Ve=174.873	Vc=185.356	Vx=173.867
-	_test_trapezoid(0.327,	173.593,	600,	000.000, bf); // Ve=174.873	Vc=185.356	Vx=173.867
-	_test_trapezoid(0.327,	347.082,	600,	173.214, bf); // Ve=174.873	Vc=185.356	Vx=173.867
-
-}
-
-static void _make_unit_vector(float unit[], float x, float y, float z, float a, float b, float c)
-{
-	float length = sqrt(x*x + y*y + z*z + a*a + b*b + c*c);
-	unit[AXIS_X] = x/length;
-	unit[AXIS_Y] = y/length;
-	unit[AXIS_Z] = z/length;
-	unit[AXIS_A] = a/length;
-	unit[AXIS_B] = b/length;
-	unit[AXIS_C] = c/length;
-}
-
-static void _test_get_junction_vmax()
-{
-//	cfg.a[AXIS_X].jerk_max = JERK_TEST_VALUE;
-//	cfg.a[AXIS_Y].jerk_max = JERK_TEST_VALUE;
-//	cfg.a[AXIS_Z].jerk_max = JERK_TEST_VALUE;
-//	cfg.a[AXIS_A].jerk_max = JERK_TEST_VALUE;
-//	cfg.a[AXIS_B].jerk_max = JERK_TEST_VALUE;
-//	cfg.a[AXIS_C].jerk_max = JERK_TEST_VALUE;
-//	mm.jerk_transition_size = 0.5;
-//	mm.jerk_limit_max = 184.2;
-/*
-	mm.test_case = 1;				// straight line along X axis
-	_make_unit_vector(mm.a_unit, 1.0000, 0.0000, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit, 1.0000, 0.0000, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-
-	mm.test_case = 2;				// angled straight line
-	_make_unit_vector(mm.a_unit, 0.7071, 0.7071, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit, 0.7071, 0.7071, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-
-	mm.test_case = 3;				// 5 degree bend
-	_make_unit_vector(mm.a_unit, 1.0000, 0.0000, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit, 0.9962, 0.0872, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-
-	mm.test_case = 4;				// 30 degrees
-	_make_unit_vector(mm.a_unit, 1.0000, 0.0000, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit, 0.8660, 0.5000, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-
-	mm.test_case = 5;				// 45 degrees
-	_make_unit_vector(mm.a_unit, 0.8660,	0.5000, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit, 0.2588,	0.9659, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-
-	mm.test_case = 6;				// 60 degrees
-	_make_unit_vector(mm.a_unit, 1.0000,	0.0000, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit, 0.5000,	0.8660, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-
-	mm.test_case = 7;				// 90 degrees
-	_make_unit_vector(mm.a_unit, 1.0000,	0.0000, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit, 0.0000,	1.0000, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-
-	mm.test_case = 8;				// 90 degrees rotated 45 degrees
-	_make_unit_vector(mm.a_unit, 0.7071, 0.7071, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit,-0.7071, 0.7071, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-
-	mm.test_case = 9;				// 120 degrees
-	_make_unit_vector(mm.a_unit, 1.0000,	0.0000, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit,-0.5000,	0.8660, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-
-	mm.test_case = 10;				// 150 degrees
-	_make_unit_vector(mm.a_unit, 1.0000,	0.0000, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit,-0.8660,	0.5000, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-
-	mm.test_case = 11;				// 180 degrees
-	_make_unit_vector(mm.a_unit, 0.7071, 0.7071, 0, 0, 0, 0);
-	_make_unit_vector(mm.b_unit,-0.7071,-0.7071, 0, 0, 0, 0);
-	mm.test_velocity = _get_junction_vmax(mm.a_unit, mm.b_unit);
-*/
+ * mp_bench_trapezoid()		 - time _calculate_trapezoid() on input case n
+ * mp_bench_junction_vmax()	 - time _get_junction_vmax() on input case n
+ * mp_bench_target_velocity() - time _get_target_velocity() on input case n
+ *
+ *	See Microbenchmarks in benchmark.h. The cases wrap, and each differs from the one 
+ *	before, so the trapezoid cache (mm.trap) always misses. A miss leaves a valid entry 
+ *	behind, so running them while idle does the planner no harm. The jerk is fixed so 
+ *	the results don't depend on the profile.
+ */
+#define BENCH_JERK ((float)50000000)
+
+static const float _bench_trapezoid[][4] = {	// L, Ve, Vt, Vx - blocks from Mudflap and braid_600mm
+	{ 0.8443,   0.000, 805.855, 393.806 },
+	{ 0.7890, 393.806, 955.829, 390.294 },
+	{ 0.9002, 390.294, 833.884, 455.925 },
+	{ 0.9735, 806.895, 806.895, 802.363 },
+	{ 0.9935, 462.101, 802.363,   0.000 },
+	{ 1.0441, 802.363, 843.274, 388.515 },
+	{ 0.7658, 803.990, 803.990, 733.618 },
+	{ 1.9870, 802.363, 802.363, 802.363 },
+	{ 1.9617, 802.363, 802.425, 641.920 },
+	{ 1.6264, 802.425, 826.209, 266.384 },
+	{ 0.4348, 679.360, 805.517, 412.976 },
+	{ 0.7313, 804.740, 853.107, 437.724 },
+	{ 0.3843, 617.229, 807.080, 371.854 },
+	{ 0.3270,   0.000, 600.000,   0.000 },
+	{ 0.3270, 174.873, 600.000, 173.867 },
+	{ 0.3270, 347.082, 600.000, 173.214 }
+};
+
+static const float _bench_junction[][4] = {		// X and Y of the unit vectors in and out
+	{ 1.0000, 0.0000, 1.0000, 0.0000 },			// straight
+	{ 1.0000, 0.0000, 0.9962, 0.0872 },			// 5 degrees
+	{ 1.0000, 0.0000, 0.8660, 0.5000 },			// 30
+	{ 0.8660, 0.5000, 0.2588, 0.9659 },			// 45
+	{ 1.0000, 0.0000, 0.5000, 0.8660 },			// 60
+	{ 1.0000, 0.0000, 0.0000, 1.0000 },			// 90
+	{ 0.7071, 0.7071,-0.7071, 0.7071 },			// 90 rotated 45
+	{ 1.0000, 0.0000,-0.5000, 0.8660 },			// 120
+	{ 1.0000, 0.0000,-0.8660, 0.5000 },			// 150
+	{ 0.7071, 0.7071,-0.7071,-0.7071 }			// reversal
+};
+
+static const float _bench_target[][2] = {		// Vi, L
+	{   0.000, 3.872983 },
+	{ 165.000, 4.027018 },
+	{ 523.000, 7.344950 },
+	{ 200.000, 6.324555 },
+	{ 174.000, 5.107690 }
+};
+
+#define BENCH_CASES(a) (sizeof(a) / sizeof(a[0]))
+
+static void _bench_jerk(mpBuf_t *bf)
+{
+	bf->jerk = BENCH_JERK;
+	bf->recip_jerk = 1/BENCH_JERK;
+	bf->cbrt_jerk = fast_cbrt(BENCH_JERK);
+}
+
+uint32_t mp_bench_trapezoid(const uint8_t n)
+{
+	mpBuf_t bf;
+	const float *t = _bench_trapezoid[n % BENCH_CASES(_bench_trapezoid)];
+	memset(&bf, 0, sizeof(bf));
+	_bench_jerk(&bf);
+	bf.length = t[0];
+	bf.entry_velocity = t[1];
+	bf.cruise_velocity = t[2];
+	bf.cruise_vmax = t[2];
+	bf.exit_velocity = t[3];
+
+	uint32_t start = hw_get_cycle_count();
+	_calculate_trapezoid(&bf);
+	uint32_t cycles = hw_get_cycle_count() - start;
+	bm_sink = bf.cruise_velocity;
+	return (cycles);
+}
+
+uint32_t mp_bench_junction_vmax(const uint8_t n)
+{
+	float a_unit[AXES];
+	float b_unit[AXES];
+	const float *j = _bench_junction[n % BENCH_CASES(_bench_junction)];
+	for (uint8_t axis=0; axis<AXES; axis++) { a_unit[axis] = 0; b_unit[axis] = 0;}
+	a_unit[AXIS_X] = j[0];
+	a_unit[AXIS_Y] = j[1];
+	b_unit[AXIS_X] = j[2];
+	b_unit[AXIS_Y] = j[3];
+
+	uint32_t start = hw_get_cycle_count();
+	bm_sink = _get_junction_vmax(a_unit, b_unit);
+	return (hw_get_cycle_count() - start);
+}
+
+uint32_t mp_bench_target_velocity(const uint8_t n)
+{
+	mpBuf_t bf;
+	const float *t = _bench_target[n % BENCH_CASES(_bench_target)];
+	_bench_jerk(&bf);
+
+	uint32_t start = hw_get_cycle_count();
+	bm_sink = _get_target_velocity(t[0], t[1], &bf);
+	return (hw_get_cycle_count() - start);
 }
 
-#endif // __UNIT_TEST_PLANNER
-#endif
+#endif // __MICROBENCHMARKS
 
 #ifdef __cplusplus
 }
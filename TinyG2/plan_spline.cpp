@@ -0,0 +1,247 @@
+/*
+ * plan_spline.cpp - cubic and quadratic spline feeds (G5, G5.1)
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "controller.h"
+#include "coroutine.h"
+#include "canonical_machine.h"
+#include "plan_spline.h"
+#include "planner.h"
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+spline_t spl;
+
+static void _queue_spline_segment(void);
+static void _get_spline_point(const float u, float point[]);
+static float _get_spline_tangent(const float u, float unit[]);
+
+/*
+ * cm_spline_feed() - canonical machine entry point for G5 and G5.1
+ *
+ *	Works out the curve and starts cm_spline_callback() on it. The feed is the
+ *	programmed one, or the spline length over the G93 time.
+ */
+stat_t cm_spline_feed(float target[], float flags[],	// spline endpoint
+					  float i, float j, uint8_t ij_flag,	// offset to the first control point
+					  float p, float q, uint8_t pq_flag,	// offset from the endpoint to the second (G5)
+					  uint8_t motion_mode)
+{
+	uint8_t mirror = ((gm.motion_mode == MOTION_MODE_CUBIC_SPLINE) && (spl.chained == true) && 
+					  (vector_equal(spl.endpoint, gmx.position) == true));
+	gm.motion_mode = motion_mode;
+
+	if ((gm.inverse_feed_rate_mode == false) && (fp_ZERO(gm.feed_rate))) {
+		return (STAT_GCODE_FEEDRATE_ERROR);
+	}
+	float flagged = 0;								// a modal G5 with only an F or M word on the line
+	for (uint8_t axis=0; axis<AXES; axis++) { flagged += flags[axis];}
+	if ((fp_ZERO(flagged)) && (ij_flag == false) && (pq_flag == false)) { return (STAT_OK);}
+
+	if (gm.select_plane != CANON_PLANE_XY) { return (STAT_SPLINE_SPECIFICATION_ERROR);}
+	if (motion_mode == MOTION_MODE_CUBIC_SPLINE) {
+		if ((pq_flag == false) || ((ij_flag == false) && (mirror == false))) { return (STAT_SPLINE_SPECIFICATION_ERROR);}
+	} else {
+		if ((ij_flag == false) || (pq_flag == true)) { return (STAT_SPLINE_SPECIFICATION_ERROR);}
+	}
+	if (spl.run_state != MOVE_STATE_OFF) { return (STAT_INTERNAL_ERROR);}	// (not supposed to fail)
+	cm_set_model_target(target, flags);
+
+	// control points in the machine frame, the quadratic raised to a cubic
+	float units = (gm.units_mode == INCHES) ? MM_PER_INCH : 1;
+	float p0[2], p1[2], p2[2], p3[2];
+	for (uint8_t k=0; k<2; k++) {
+		p0[k] = gmx.position[AXIS_X + k];
+		p3[k] = gm.target[AXIS_X + k];
+		float offset_1 = ((k == 0) ? i : j) * units;
+		p1[k] = (ij_flag == true) ? (p0[k] + offset_1) : (2*p0[k] - spl.control[k]);
+		if (motion_mode == MOTION_MODE_CUBIC_SPLINE) {
+			p2[k] = p3[k] + ((k == 0) ? p : q) * units;
+		} else {
+			p2[k] = p3[k] + (p1[k] - p3[k]) * 2/3;
+			p1[k] = p0[k] + (p1[k] - p0[k]) * 2/3;
+		}
+		spl.coef[0][k] = p3[k] - p0[k] + 3*(p1[k] - p2[k]);
+		spl.coef[1][k] = 3*(p0[k] - 2*p1[k] + p2[k]);
+		spl.coef[2][k] = 3*(p1[k] - p0[k]);
+		spl.coef[3][k] = p0[k];
+		spl.control[k] = p2[k];
+	}
+	copy_axis_vector(spl.start, gmx.position);
+	copy_axis_vector(spl.endpoint, gm.target);
+	for (uint8_t axis=0; axis<AXES; axis++) { spl.travel[axis] = gm.target[axis] - gmx.position[axis];}
+	spl.chained = (motion_mode == MOTION_MODE_CUBIC_SPLINE);
+
+	// measure it, and draw anything too short to segment as a line
+	float last[AXES], point[AXES];
+	copy_axis_vector(last, spl.start);
+	spl.length = 0;
+	for (uint8_t n=1; n<=SPLINE_LENGTH_CHORDS; n++) {
+		_get_spline_point((float)n / SPLINE_LENGTH_CHORDS, point);
+		spl.length += get_axis_vector_length(point, last);
+		copy_axis_vector(last, point);
+	}
+	spl.feed = (gm.inverse_feed_rate_mode == true) ? (spl.length / gmx.inverse_feed_rate) : gm.feed_rate;
+	gm.move_time = spl.length / spl.feed;
+	cm_set_work_offsets(&gm);						// capture the fully resolved offsets to the state
+
+	stat_t status = STAT_OK;
+	if (spl.length < MIN_LENGTH_MOVE) {
+		status = mp_aline(&gm);						// held as a residual
+	} else {
+		memcpy(&spl.gm, &gm, sizeof(GCodeState_t));
+		copy_axis_vector(spl.gm.target, spl.start);
+		spl.u = 0;
+		spl.du = SPLINE_FIRST_STEP;
+		spl.run_state = MOVE_STATE_RUN;
+		spl.co = 0;
+		controller_set_ready(CTL_TASK_SPLINE);
+	}
+	cm_conditional_set_model_position(status);	// set endpoint position if the move was successful
+	return (status);
+}
+
+/*
+ * cm_spline_callback() - generate a spline
+ *
+ *	A coroutine (see coroutine.h) run by the controller, as cm_arc_callback(). It queues
+ *	one segment per pass, and parks while the planner is short of buffers.
+ */
+stat_t cm_spline_callback()
+{
+	if (spl.run_state == MOVE_STATE_OFF) { return (STAT_NOOP);}
+
+	CO_BEGIN(spl.co);
+	while (spl.u < 1) {
+		CO_WAIT_EVENT(spl.co, CTL_TASK_SPLINE, CTL_EVENT_BUFFER, mp_get_planner_buffers_available() >= 1);
+		_queue_spline_segment();
+		CO_YIELD(spl.co);
+	}
+	spl.run_state = MOVE_STATE_OFF;
+	CO_END(spl.co);
+}
+
+/*
+ * cm_abort_spline() - stop a spline in process without maintaining position
+ */
+void cm_abort_spline()
+{
+	spl.run_state = MOVE_STATE_OFF;
+	spl.chained = false;
+}
+
+/*
+ * _queue_spline_segment() - queue the next line of the spline
+ *
+ *	The step along the curve starts at twice the last one and is halved until the 
+ *	curve at the middle of the step is within the chordal tolerance of the chord - 
+ *	unless the chord would be shorter than $as or the minimum segment time at the feed. 
+ *	The segment time holds the curvature limit for the largest curvature at the ends
+ *	and middle of the segment, and the axis feed rate maximums.
+ */
+static void _queue_spline_segment()
+{
+	float *start = spl.gm.target;					// the last segment's end
+	float end[AXES], middle[AXES];
+	float length_min = max(cm.arc_segment_len, spl.feed * MIN_SEGMENT_TIME);
+	float length;
+	float du = min(1 - spl.u, 2 * spl.du);
+
+	while (true) {
+		_get_spline_point(spl.u + du, end);
+		length = get_axis_vector_length(end, start);
+		if (length <= length_min) break;
+		_get_spline_point(spl.u + du/2, middle);
+		float deviation = 0;
+		for (uint8_t axis=0; axis<AXES; axis++) { deviation += square(middle[axis] - (start[axis] + end[axis])/2);}
+		if (sqrt(deviation) <= cm.chordal_tolerance) break;
+		du /= 2;
+	}
+	if ((spl.u + du) >= 1) {						// the last segment goes to the exact endpoint
+		du = 1 - spl.u;
+		copy_axis_vector(end, spl.endpoint);
+		length = get_axis_vector_length(end, start);
+	}
+
+	float curvature = max3(_get_spline_tangent(spl.u, spl.entry_unit), 
+						   _get_spline_tangent(spl.u + du/2, middle),
+						   _get_spline_tangent(spl.u + du, spl.exit_unit));
+	float velocity = spl.feed;
+	if (curvature > EPSILON) { velocity = min(velocity, sqrt(cm.junction_acceleration / curvature));}
+	float move_time = length / velocity;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		move_time = max(move_time, fabs(end[axis] - start[axis]) * cm.recip_feedrate_max[axis]);
+	}
+	spl.gm.move_time = move_time;
+	copy_axis_vector(spl.gm.target, end);
+	mp_arc_segment(&spl.gm, spl.entry_unit, spl.exit_unit, (curvature > EPSILON) ? (1 / curvature) : 0);
+	spl.u += du;
+	spl.du = du;
+}
+
+/*
+ * _get_spline_point()	 - position of the curve at u
+ * _get_spline_tangent() - unit tangent of the curve at u. Returns its curvature (1/mm)
+ *
+ *	The curvature of a path with derivative t and second derivative t' is 
+ *	sqrt(|t|^2 * |t'|^2 - (t.t')^2) / |t|^3. Only X and Y have a second derivative.
+ *	Where a control point sits on its end the derivative is zero - the tangent is 
+ *	then taken from the second derivative and the curvature is not counted.
+ */
+static void _get_spline_point(const float u, float point[])
+{
+	for (uint8_t axis=0; axis<AXES; axis++) { point[axis] = spl.start[axis] + u * spl.travel[axis];}
+	for (uint8_t k=0; k<2; k++) {
+		point[AXIS_X + k] = ((spl.coef[0][k] * u + spl.coef[1][k]) * u + spl.coef[2][k]) * u + spl.coef[3][k];
+	}
+}
+
+static float _get_spline_tangent(const float u, float unit[])
+{
+	float d2[2];
+	for (uint8_t axis=0; axis<AXES; axis++) { unit[axis] = spl.travel[axis];}
+	for (uint8_t k=0; k<2; k++) {
+		unit[AXIS_X + k] = (3 * spl.coef[0][k] * u + 2 * spl.coef[1][k]) * u + spl.coef[2][k];
+		d2[k] = 6 * spl.coef[0][k] * u + 2 * spl.coef[1][k];
+	}
+	float speed_sq = 0;
+	for (uint8_t axis=0; axis<AXES; axis++) { speed_sq += square(unit[axis]);}
+	float speed = sqrt(speed_sq);
+	float curvature = 0;
+	if (speed < EPSILON) {
+		for (uint8_t axis=0; axis<AXES; axis++) { unit[axis] = 0;}
+		speed = hypot(d2[0], d2[1]);
+		if (speed < EPSILON) { return (0);}
+		unit[AXIS_X] = d2[0];
+		unit[AXIS_Y] = d2[1];
+	} else {
+		float dot = unit[AXIS_X] * d2[0] + unit[AXIS_Y] * d2[1];
+		curvature = sqrt(max(0, speed_sq * (square(d2[0]) + square(d2[1])) - square(dot))) / (speed_sq * speed);
+	}
+	for (uint8_t axis=0; axis<AXES; axis++) { unit[axis] /= speed;}
+	return (curvature);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,79 @@
+/*
+ * plan_spline.h - cubic and quadratic spline feeds (G5, G5.1)
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Splines
+ *	  G5 X Y I J P Q	cubic Bezier from the current point to X Y. I J is the first control
+ *						point from the start, P Q the second from the end
+ *	  G5.1 X Y I J		quadratic spline - I J is the control point from the start
+ *
+ *	I J may be left off a G5 that starts where another G5 ended. The first control point
+ *	is then the last one mirrored through the start, so the curves join smoothly. The
+ *	offsets are incremental in either distance mode and in the current units. Splines 
+ *	are drawn in the XY plane (G17) only - other axis words move their axes in step 
+ *	with the curve, as the linear axis of a helix.
+ *
+ *	A spline is queued as lines by a main loop callback, one per pass, as arcs are 
+ *	without __NATIVE_ARCS (see cm_spline_callback()). Each steps along the curve as far
+ *	as the chordal tolerance ($ct) allows where it is - long lines where the curve is 
+ *	flat and short ones where it turns - and no faster than sqrt($ja * r) for the 
+ *	tightest radius of curvature r along it. The lines blend at the curve tangents as
+ *	arc segments do. One G5 stands in for the dozens of G1 moves CAM would send for it.
+ */
+
+#ifndef PLAN_SPLINE_H_ONCE
+#define PLAN_SPLINE_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define SPLINE_LENGTH_CHORDS 32		// chords the length of a spline is measured over
+#define SPLINE_FIRST_STEP 0.0625	// parameter step the first segment tries (doubled)
+
+typedef struct spSplineSingleton {	// persistent spline planner variables
+	magic_t magic_start;
+	uint8_t run_state;				// runtime state machine sequence
+	uint16_t co;					// resume point of cm_spline_callback() - a coContext_t (see coroutine.h)
+
+	float coef[4][2];				// XY polynomial a*u^3 + b*u^2 + c*u + d in coef[a-d][]
+	float start[AXES];				// position at u = 0
+	float travel[AXES];				// travel of the other axes over the spline
+	float endpoint[AXES];			// spline endpoint position
+	float control[2];				// last control point - the next G5 may mirror it
+	uint8_t chained;				// true if the last spline was a G5 ending at endpoint
+
+	float length;					// length of the spline in mm
+	float feed;						// mm/min it is drawn at (inverse time mode too)
+	float u;						// curve parameter at the end of the last segment
+	float du;						// parameter step of the last segment
+	float entry_unit[AXES];			// curve tangents at the segment ends
+	float exit_unit[AXES];
+
+	GCodeState_t gm;				// Gcode state passed for each segment - target and move_time vary
+	magic_t magic_end;
+} spline_t;
+extern spline_t spl;
+
+stat_t cm_spline_callback(void);
+void cm_abort_spline(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// End of include guard: PLAN_SPLINE_H_ONCE
@@ -53,12 +53,20 @@
  */
 #include "tinyg2.h"
 #include "config.h"
+#include "controller.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
+#include "plan_spline.h"
 #include "plan_line.h"
 #include "planner.h"
+#include "kinematics.h"
 #include "stepper.h"
+#include "shaper.h"
+#include "pressure.h"
 #include "report.h"
+#include "text_parser.h"
+#include "event_log.h"
+#include "block_log.h"
 #include "util.h"
 
 #ifdef __cplusplus
@@ -67,21 +75,25 @@ extern "C"{
 
 // Allocate planner structures
 
-mpBufferPool_t mb;				// move buffer queue
+mpBufferPool_t mb SRAM_DMA;		// move buffer queue
 mpMoveMasterSingleton_t mm;		// context for line planning
-mpMoveRuntimeSingleton_t mr;	// context for line runtime
+mpMoveRuntimeSingleton_t mr SRAM_ISR;	// context for line runtime
+mpRasterRing_t mrr;					// raster line pixels (see RASTER LINES)
 
 /*
  * Local Scope Data and Functions
  */
 #define _bump(a) ((a<PLANNER_BUFFER_POOL_SIZE-1)?(a+1):0) // buffer incr & wrap
-#define spindle_speed move_time	// local alias for spindle_speed to the time variable
-#define value_vector gm.target	// alias for vector of values
+#define value_vector gm->target	// alias for vector of values
 #define flag_vector unit		// alias for vector of flags
 
 // execution routines (NB: These are all called from the LO interrupt)
 static stat_t _exec_dwell(mpBuf_t *bf);
 static stat_t _exec_command(mpBuf_t *bf);
+static void _queue_command(mpCommandQueue_t *q, void(*cm_exec)(float[], float[]), float *value, float *flag);
+static void _dispatch_commands(mpCommandQueue_t *q, uint32_t seq);
+static void _dispatch_outputs(uint32_t seq);
+static void _exec_outputs(float *value, float *flag);
 
 #ifdef __DEBUG
 static uint8_t _get_buffer_index(mpBuf_t *bf); 
@@ -94,11 +106,19 @@ static void _dump_plan_buffer(mpBuf_t *bf);
 void planner_init()
 {
 // If you can can assume all memory has been zeroed by a hard reset you don;t need these next 2 lines
-	memset(&mr, 0, sizeof(mr));	// clear all values, pointers and status
+	memset((void *)&mr, 0, sizeof(mr));	// clear all values, pointers and status
 	memset(&mm, 0, sizeof(mm));	// clear all values, pointers and status
 
 	mr.magic_start = MAGICNUM;
 	mr.magic_end = MAGICNUM;
+	mr.feed_override = 1;		// overrides start out off
+	mr.traverse_override = 1;
+	mr.starve_override = 1;
+	mr.load_override = 1;
+	mr.override_factor = 1;
+	mr.override_begin = 1;
+	mr.override_end = 1;
+	mr.segment_backoff = 1;
 	arc.magic_start = MAGICNUM;
 	arc.magic_end = MAGICNUM;
 	mp_init_buffers();
@@ -126,7 +146,12 @@ stat_t mp_assertions()
 void mp_flush_planner()
 {
 	cm_abort_arc();
+	cm_abort_spline();
+	cm_abort_canned_cycle();
 	mp_init_buffers();
+	bl_drop();									// a held block that was flushed isn't logged
+	mm.residual = false;						// see mp_plan_residual()
+	mm.residual_time = 0;
 	cm_set_motion_state(MOTION_STOP);
 }
 
@@ -150,11 +175,20 @@ void mp_flush_planner()
 void mp_set_planner_position(uint8_t axis, const float position)
 {
 	mm.position[axis] = position;
+	mm.residual = false;						// the held endpoint no longer applies
+	mm.residual_time = 0;
 }
 
 void mp_set_runtime_position(uint8_t axis, const float position)
 {
+#ifdef __FIXED_POINT_RUNTIME
+	mr.position[axis] = (fixed_t)(position * FX_ONE);
+#else
 	mr.position[axis] = position;
+#endif
+	if (axis == AXIS_Z) { mr.height_offset = 0;}	// Z is set where the motors are
+	sh_set_position(axis, position);
+	mp_publish_runtime();
 }
 
 /*************************************************************************
@@ -162,17 +196,35 @@ void mp_set_runtime_position(uint8_t axis, const float position)
  *
  *	Dequeues the buffer queue and executes the move continuations.
  *	Manages run buffers and other details
+ *
+ *	With input shaping, pressure advance or backlash take-up the motors are off the 
+ *	runtime. They catch up (mp_exec_shaper()) before anything other than a line, PVT 
+ *	point or jog runs, at a hold, and before the runtime idles.
  */
 
-stat_t mp_exec_move()
+RAMFUNC stat_t mp_exec_move()
 {
 	mpBuf_t *bf;
 
-	if ((bf = mp_get_run_buffer()) == NULL) return (STAT_NOOP);	// NULL means nothing's running
+	if (mb.dry_run == true) {									// the planner is being benchmarked or preflighted
+		_dispatch_commands(&mb.cq, mb.seq_freed);				// ...so commands are dropped unrun as they come due
+		_dispatch_commands(&mb.oq, mb.seq_freed);
+		return (STAT_NOOP);
+	}
+	_dispatch_commands(&mb.cq, mb.seq_freed);					// run any commands that are due
+	_dispatch_commands(&mb.oq, st_get_motion_seq(mb.seq_freed));// ...and outputs the motors have reached
+	_dispatch_outputs(st_get_motion_seq(mb.seq_freed));			// ...and output triggers they have run past
+	bf = mp_get_run_buffer();
+	if (((sh_settled() == false) || (pa_settled() == false) || (ik_settled() == false)) && 
+		((bf == NULL) || ((bf->move_type != MOVE_TYPE_ALINE) && (bf->move_type != MOVE_TYPE_PVT) && (bf->move_type != MOVE_TYPE_JOG)) || 
+		 (cm.hold_state == FEEDHOLD_HOLD))) {
+		return (mp_exec_shaper());
+	}
+	if (bf == NULL) return (STAT_NOOP);							// NULL means nothing's running
 
 	// Manage cycle and motion state transitions
-	// Cycle auto-start for lines only
-	if (bf->move_type == MOVE_TYPE_ALINE) {
+	// Cycle auto-start for lines and PVT points only - a jog has its own cycle
+	if ((bf->move_type == MOVE_TYPE_ALINE) || (bf->move_type == MOVE_TYPE_PVT) || (bf->move_type == MOVE_TYPE_JOG)) {
 		if (cm.cycle_state == CYCLE_OFF) cm_cycle_start();
 		if (cm.motion_state == MOTION_STOP) cm_set_motion_state(MOTION_RUN);
 	}
@@ -181,28 +233,84 @@ stat_t mp_exec_move()
 }
 
 /************************************************************************************
- * mp_queue_command() - queue a synchronous Mcode, program control, or other command
- * _exec_command() 	  - callback to execute command
+ * mp_queue_command() 	   - queue a synchronous Mcode, program control, or other command
+ * mp_queue_stop_command() - queue a command that stops motion before it runs
+ * mp_queue_output_command() - queue an output command that runs when the motors get to it
+ * _exec_command() 	  	   - callback to execute a stop command
+ * _dispatch_commands()	   - run side queue commands whose motion has completed
  *
  *	How this works:
  *	  - The command is called by the Gcode interpreter (cm_<command>, e.g. an M code)
- *	  - cm_ function calls mp_queue_command which puts it in the planning queue.
- *		This involves setting some parameters and registering a callback to the 
- *		execution function in the canonical machine
- *	  - the planning queue gets to the function and calls _exec_command()
- *	  - ...which passes the saved parameters to the callback function
- *	  - To finish up _exec_command() needs to run a null pre and free the planner buffer
+ *	  - cm_ function calls mp_queue_command which puts it in the command side queue 
+ *		(mb.cq) along with the args and a callback to the execution function in the 
+ *		canonical machine. The entry is keyed to the number of planner buffers queued
+ *		so far - i.e. the motion it must run after.
+ *	  - When the runtime frees that many buffers it runs the callback, before the next
+ *		buffer starts. _dispatch_commands() also runs from mp_exec_move() so commands
+ *		queued on an empty planner run right away.
  *
  *	Doing it this way instead of synchronizing on queue empty simplifies the
  *	handling of feedholds, feed overrides, buffer flushes, and thread blocking,
- *	and makes keeping the queue full much easier - therefore avoiding Q starvation
+ *	and makes keeping the queue full much easier - therefore avoiding Q starvation.
+ *	Side queue commands don't take a planner buffer and don't stop motion, so 
+ *	S words, coolant and offsets don't cost look-ahead. 
+ *
+ *	Commands that need the machine stopped (spindle start/stop, tool change, program 
+ *	end) use mp_queue_stop_command(). It puts the command in a planner buffer, which 
+ *	the planner treats as a momentary hold. mp_queue_command() falls back to this if 
+ *	the side queue is full.
+ *
+ *	Commands that only set outputs (S words, coolant) use mp_queue_output_command(). 
+ *	They go in a second side queue (mb.oq) that runs when the motors start the motion
+ *	after them, not when the exec preps it - the prep ring runs up to 
+ *	PREP_BUFFER_POOL_SIZE segments ahead of the motors. Each prepped segment carries 
+ *	the buffer count it was prepped at, and the exec checks the queue after each 
+ *	segment load (see st_get_motion_seq()). Commands that change runtime state for the 
+ *	moves after them (offsets, origins) must stay in mb.cq, which runs before the exec 
+ *	preps the next buffer.
+ *
+ *	A feedhold that splits a block shifts the buffers behind it. A command keyed 
+ *	behind the split block runs at the hold point rather than at the end of the block.
  */
 
 void mp_queue_command(void(*cm_exec)(float[], float[]), float *value, float *flag)
 {
-	mpBuf_t *bf;
+	mp_plan_residual();
+	_queue_command(&mb.cq, cm_exec, value, flag);
+}
+
+void mp_queue_output_command(void(*cm_exec)(float[], float[]), float *value, float *flag)
+{
+	mp_plan_residual();
+	_queue_command(&mb.oq, cm_exec, value, flag);
+}
+
+static void _queue_command(mpCommandQueue_t *q, void(*cm_exec)(float[], float[]), float *value, float *flag)
+{
+	uint8_t next = q->w + 1;
+	if (next >= COMMAND_QUEUE_SIZE) { next = 0;}
+	if (next == q->r) {					// side queue is full
+		mp_queue_stop_command(cm_exec, value, flag);
+		return;
+	}
+	mpCommand_t *c = &q->cmd[q->w];
+	c->seq = mb.seq_queued;
+	c->cm_func = cm_exec;
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		c->value[axis] = value[axis];
+		c->flag[axis] = flag[axis];
+	}
+	mp_release_barrier();				// the entry is written before it's committed
+	q->w = next;						// commit the entry
+	st_request_exec_move();				// runs it now if the planner is empty
+}
+
+void mp_queue_stop_command(void(*cm_exec)(float[], float[]), float *value, float *flag)
+{
+	mpBuf_t *bf;
 
-	// this error is not reported as buffer availability was checked upstream in the controller
+	mp_plan_residual();
+	// this error is not reported as buffer availability was checked upstream in the controller
 	if ((bf = mp_get_write_buffer()) == NULL) return;
 
 	bf->move_type = MOVE_TYPE_COMMAND;
@@ -222,7 +330,114 @@ static stat_t _exec_command(mpBuf_t *bf)
 	st_prep_null();									// Must call a null prep to keep the loader happy. 
 	mp_free_run_buffer();
 	return (STAT_OK);
-}
+}
+
+static void _dispatch_commands(mpCommandQueue_t *q, uint32_t seq)
+{
+	while (q->r != q->w) {
+		mpCommand_t *c = &q->cmd[q->r];
+		if ((int32_t)(seq - c->seq) < 0) { return;}	// motion ahead of it is still queued
+		if (mb.dry_run == false) { c->cm_func(c->value, c->flag);}
+		q->r = (q->r + 1 < COMMAND_QUEUE_SIZE) ? q->r + 1 : 0;
+	}
+}
+
+/************************************************************************************
+ * mp_queue_output_trigger() - switch an output part way into the next motion (M62, M63)
+ * mp_output_trigger_waiting() - true if a trigger waits on the next block queued
+ * mp_prep_outputs()		 - set the outputs of the segment being prepped (exec only)
+ * mp_commit_outputs()		 - take its triggers off the queue once it is prepped (exec only)
+ * _dispatch_outputs()		 - switch the triggers whose block the motors have run past
+ *
+ *	A trigger switches a digital output (1 - DIGITAL_OUTPUTS) in the next block 
+ *	queued, a distance (mm) or a time (ms of motion) into it - or as it starts if both 
+ *	are zero. It waits in a side queue (mb.tq) so it costs neither a planner buffer
+ *	nor a stop. As the exec preps the segments of its block it counts the travel and 
+ *	time run, and the segment whose midpoint passes the offset carries the trigger 
+ *	to the loader, which switches the output as that segment starts on the motors (see
+ *	Segment outputs in stepper.h). It is late or early by at most half a segment.
+ *
+ *	The triggers of a block switch in the order given. A block that isn't a line or 
+ *	arc, or that ends before the offset, switches its triggers as the motors finish 
+ *	it. Travel and time carry on across a feedhold in the block. A full queue falls 
+ *	back to a stop command (see mp_queue_stop_command()).
+ *
+ *	A trigger waiting on the next block keeps the moves after it from being merged 
+ *	into the block before it (see mp_output_trigger_waiting()).
+ */
+
+void mp_queue_output_trigger(const uint8_t output, const uint8_t state, const float distance, const float time)
+{
+	uint8_t mask = 1 << (output-1);
+	mpOutputQueue_t *q = &mb.tq;
+
+	mp_plan_residual();
+	uint8_t next = q->w + 1;
+	if (next >= OUTPUT_TRIGGER_QUEUE_SIZE) { next = 0;}
+	if (next == q->r) {					// queue is full
+		float value[AXES] = { (state == true) ? (float)mask : 0, (state == true) ? 0 : (float)mask };
+		mp_queue_stop_command(_exec_outputs, value, value);
+		return;
+	}
+	mpOutputTrigger_t *t = &q->trig[q->w];
+	t->seq = mb.seq_queued;
+	t->on = (state == true) ? mask : 0;
+	t->off = (state == true) ? 0 : mask;
+	t->distance = distance;
+	t->time = time * 1000;
+	q->w = next;						// commit the entry
+}
+
+uint8_t mp_output_trigger_waiting()
+{
+	mpOutputQueue_t *q = &mb.tq;
+	if (q->r == q->w) { return (false);}
+	uint8_t newest = (q->w == 0) ? OUTPUT_TRIGGER_QUEUE_SIZE-1 : q->w-1;
+	return ((q->trig[newest].seq == mb.seq_queued) ? true : false);
+}
+
+void mp_prep_outputs(const float length, const float microseconds)
+{
+	mpOutputQueue_t *q = &mb.tq;
+	uint8_t on = 0;
+	uint8_t off = 0;
+
+	if (mr.output_seq != mb.seq_freed) {	// a new block
+		mr.output_seq = mb.seq_freed;
+		mr.output_travel = 0;
+		mr.output_time = 0;
+	}
+	float travel = mr.output_travel + length/2;	// the middle of the segment
+	float time = mr.output_time + microseconds/2;
+	for (q->prep = q->r; q->prep != q->w; q->prep = (q->prep + 1 < OUTPUT_TRIGGER_QUEUE_SIZE) ? q->prep + 1 : 0) {
+		mpOutputTrigger_t *t = &q->trig[q->prep];
+		if ((int32_t)(mb.seq_freed - t->seq) < 0) { break;}	// its block hasn't started
+		if ((t->seq == mb.seq_freed) && ((t->distance > travel) || (t->time > time))) { break;}
+		on = (on & ~t->off) | t->on;
+		off = (off & ~t->on) | t->off;
+	}
+	st_prep_outputs(on, off);
+}
+
+void mp_commit_outputs(const float length, const float microseconds)
+{
+	mb.tq.r = mb.tq.prep;
+	mr.output_travel += length;
+	mr.output_time += microseconds;
+}
+
+static void _dispatch_outputs(uint32_t seq)
+{
+	mpOutputQueue_t *q = &mb.tq;
+	while (q->r != q->w) {
+		mpOutputTrigger_t *t = &q->trig[q->r];
+		if ((int32_t)(seq - t->seq) <= 0) { return;}	// its block is running or still queued
+		if (mb.dry_run == false) { st_set_outputs(t->on, t->off);}
+		q->r = (q->r + 1 < OUTPUT_TRIGGER_QUEUE_SIZE) ? q->r + 1 : 0;
+	}
+}
+
+static void _exec_outputs(float *value, float *flag) { st_set_outputs((uint8_t)value[0], (uint8_t)value[1]);}
 
 /*************************************************************************
  * mp_dwell() 	 - queue a dwell
@@ -236,11 +451,12 @@ stat_t mp_dwell(float seconds)
 {
 	mpBuf_t *bf;
 
+	mp_plan_residual();
 	if ((bf = mp_get_write_buffer()) == NULL) {	// get write buffer or fail
 		return (STAT_BUFFER_FULL_FATAL);		// (not ever supposed to fail)
 	}
 	bf->bf_func = _exec_dwell;					// register callback to dwell start
-	bf->gm.move_time = seconds;					// in seconds, not minutes
+	bf->gm->move_time = seconds;					// in seconds, not minutes
 	bf->move_state = MOVE_STATE_NEW;
 	mp_queue_write_buffer(MOVE_TYPE_DWELL);
 	return (STAT_OK);
@@ -248,7 +464,7 @@ stat_t mp_dwell(float seconds)
 
 static stat_t _exec_dwell(mpBuf_t *bf)
 {
-	st_prep_dwell((uint32_t)(bf->gm.move_time * 1000000));// convert seconds to uSec
+	st_prep_dwell((uint32_t)(bf->gm->move_time * 1000000));// convert seconds to uSec
 	mp_free_run_buffer();
 	return (STAT_OK);
 }
@@ -273,8 +489,20 @@ static stat_t _exec_dwell(mpBuf_t *bf)
  *	The write buffer pointer only moves forward on _queue_write_buffer, and
  *	the read buffer pointer only moves forward on free_read calls.
  *	(test, get and unget have no effect)
+ *
+ *	The ring has one producer and one consumer (see PLANNER RING in planner.h):
+ *	the main loop owns mb.w, mb.q and seq_taken, and hands a buffer over by setting 
+ *	it QUEUED after everything else in it is written. The exec owns mb.r and 
+ *	seq_freed, and hands a buffer back by clearing it to EMPTY. Neither side writes 
+ *	the other's pointers or counters, so neither waits or masks interrupts for the 
+ *	other. The main loop looks at the running block with mp_get_first_buffer(), 
+ *	which does not change its state.
  * 
  * mp_get_planner_buffers_available()   Returns # of available planner buffers
+ * mp_get_planner_queue_time()	Returns ms of movement & dwell in the queue
+ * mp_add_queue_time(bf,s)	Add time to a buffer and to the queue time
+ * mp_get_block_time(bf)	Returns minutes the trapezoid of line block bf is planned to take
+ * mp_set_dry_run(flag)		Plan without running moves or commands
  *
  * mp_init_buffers()		Initializes or resets buffers
  *
@@ -286,23 +514,56 @@ static stat_t _exec_dwell(mpBuf_t *bf)
  * mp_queue_write_buffer()	Commit the next write buffer to the queue
  *							Advances write pointer & changes buffer state
  *
- * mp_get_run_buffer()		Get pointer to the next or current run buffer
+ * mp_get_run_buffer()		Get pointer to the next or current run buffer (exec only)
  *							Returns a new run buffer if prev buf was ENDed
  *							Returns same buf if called again before ENDing
  *							Returns NULL if no buffer available
  *							The behavior supports continuations (iteration)
  *
- * mp_free_run_buffer()		Release the run buffer & return to buffer pool.
+ * mp_free_run_buffer()		Release the run buffer & return to buffer pool (exec only)
  *
  * mp_get_prev_buffer(bf)	Returns pointer to prev buffer in linked list
  * mp_get_next_buffer(bf)	Returns pointer to next buffer in linked list 
- * mp_get_first_buffer(bf)	Returns pointer to first buffer, i.e. the running block
+ * mp_get_first_buffer(bf)	Returns pointer to first buffer, i.e. the running block (either side)
  * mp_get_last_buffer(bf)	Returns pointer to last buffer, i.e. last block (zero)
  * mp_clear_buffer(bf)		Zeroes the contents of the buffer
  * mp_copy_buffer(bf,bp)	Copies the contents of bp into bf - preserves links
+ *
+ * mp_bind_gcode_state(bf,gm)	Load a block record from the model & bind its modal record
+ * mp_modal_matches(bf,gm)	Returns true if gm has the same modal state as block bf
+ * mp_load_runtime_gcode_state(bf)	Load the Gcode state of block bf into mr.gm (see MODAL STATE TABLE)
  */
 
-uint8_t mp_get_planner_buffers_available(void) { return (mb.buffers_available);}
+uint8_t mp_get_planner_buffers_available(void) 
+{
+	return (PLANNER_BUFFER_POOL_SIZE - (uint8_t)(mb.seq_taken - mb.seq_freed));
+}
+
+/*
+ *	The queue time is kept as two running uSec counters so each one has a single
+ *	writer. Queueing adds to time_queued from the main loop, and mp_free_run_buffer()
+ *	adds to time_freed from the exec interrupt. The difference is the time in the queue, 
+ *	including the running block. Unsigned math keeps it right when the counters wrap.
+ *	Moves count their optimal move time, so this is a lower bound on the time left.
+ */
+uint32_t mp_get_planner_queue_time(void) { return ((mb.time_queued - mb.time_freed) / 1000);}
+
+void mp_set_dry_run(uint8_t flag) { mb.dry_run = flag;}
+
+void mp_add_queue_time(mpBuf_t *bf, const float seconds)
+{
+	uint32_t usec = (uint32_t)(seconds * 1000000);
+	bf->queue_time += usec;
+	mb.time_queued += usec;
+}
+
+float mp_get_block_time(const mpBuf_t *bf)
+{
+	if (bf->cruise_velocity <= EPSILON) { return (0);}
+	return ((2 * bf->head_length / (bf->entry_velocity + bf->cruise_velocity)) +	// each section over its average velocity
+			(bf->body_length / bf->cruise_velocity) +
+			(2 * bf->tail_length / (bf->cruise_velocity + bf->exit_velocity)));
+}
 
 void mp_init_buffers(void)
 {
@@ -320,9 +581,15 @@ void mp_init_buffers(void)
 	for (i=0; i < PLANNER_BUFFER_POOL_SIZE; i++) { // setup ring pointers
 		mb.bf[i].nx = &mb.bf[_bump(i)];
 		mb.bf[i].pv = pv;
+		mb.bf[i].gm = &mb.gm[i];	// bind the Gcode state record
+		mb.bf[i].arc = &mb.arc[i];	// bind the arc record
+		mb.bf[i].sect = &mb.sect[i];// ...and the section parameters
 		pv = &mb.bf[i];
 	}
-	mb.buffers_available = PLANNER_BUFFER_POOL_SIZE;
+	mr.modal_version = 0;			// versions start over with the table
+	mrr.wr = 0;						// ...and the raster pixels with the queue
+	mrr.rd = 0;
+	controller_signal(CTL_EVENT_BUFFER);
 }
 
 mpBuf_t * mp_get_write_buffer() 				// get & clear a buffer
@@ -331,11 +598,20 @@ mpBuf_t * mp_get_write_buffer() 				// get & clear a buffer
 		mpBuf_t *w = mb.w;
 		mpBuf_t *nx = mb.w->nx;					// save pointers
 		mpBuf_t *pv = mb.w->pv;
+		mpBlock_t *blk = mb.w->gm;
+		mpArc_t *arc_rec = mb.w->arc;			// the arc record is only read for arc move codes
+		mpSections_t *sect = mb.w->sect;
 		memset(mb.w, 0, sizeof(mpBuf_t));
+		memset(blk, 0, sizeof(mpBlock_t));
+		blk->modal = MP_MODAL_NONE;
 		w->nx = nx;								// restore pointers
 		w->pv = pv;
+		w->gm = blk;
+		w->arc = arc_rec;
+		w->sect = sect;
+		sect->ready = false;
 		w->buffer_state = MP_BUFFER_LOADING;
-		mb.buffers_available--;
+		mb.seq_taken++;
 		mb.w = w->nx;
 		return (w);
 	}
@@ -346,14 +622,25 @@ void mp_unget_write_buffer()
 {
 	mb.w = mb.w->pv;							// queued --> write
 	mb.w->buffer_state = MP_BUFFER_EMPTY; 		// not loading anymore
-	mb.buffers_available++;
+	mb.seq_taken--;
 }
 */
 void mp_queue_write_buffer(const uint8_t move_type)
 {
+	if (move_type == MOVE_TYPE_ALINE) {
+		mp_add_queue_time(mb.q, mb.q->gm->move_time * 60);	// minutes to seconds
+	} else if ((move_type == MOVE_TYPE_DWELL) || (move_type == MOVE_TYPE_PVT)) {
+		mp_add_queue_time(mb.q, mb.q->gm->move_time);		// dwells and PVT points are already in seconds
+	}
+	if (move_type != MOVE_TYPE_ALINE) {			// commands and dwells aren't bound to a line...
+		mb.q->gm->linenum = cm_get_linenum(MODEL);	// ...so give them the one that queued them
+	}
 	mb.q->move_type = move_type;
 	mb.q->move_state = MOVE_STATE_NEW;
+	ev_record(EV_BLOCK_QUEUED, mb.q->gm->linenum, move_type);
+	mp_release_barrier();						// the block is whole before the exec can see it
 	mb.q->buffer_state = MP_BUFFER_QUEUED;
+	mb.seq_queued++;
 	mb.q = mb.q->nx;							// advance the queued buffer pointer
 	st_request_exec_move();						// request a move exec if not busy
 	qr_request_queue_report(+1);				// add to the "added buffers" count
@@ -365,6 +652,7 @@ mpBuf_t * mp_get_run_buffer()
 	if ((mb.r->buffer_state == MP_BUFFER_QUEUED) || 
 		(mb.r->buffer_state == MP_BUFFER_PENDING)) {
 		 mb.r->buffer_state = MP_BUFFER_RUNNING;
+		 ev_record(EV_BLOCK_START, mb.r->gm->linenum, mb.r->move_type);
 	}
 	// CASE: asking for the same run buffer for the Nth time
 	if (mb.r->buffer_state == MP_BUFFER_RUNNING) {	// return same buffer
@@ -375,25 +663,39 @@ mpBuf_t * mp_get_run_buffer()
 
 void mp_free_run_buffer()						// EMPTY current run buf & adv to next
 {
+	mb.time_freed += mb.r->queue_time;			// take it out of the queue time
+	if (mb.r->gm->modal != MP_MODAL_NONE) {		// release the modal record
+		mb.modal_freed[mb.r->gm->modal]++;
+	}
+	if (mb.r->gm->raster_count != 0) {			// release the raster line's pixels
+		mrr.rd = mb.r->gm->raster_offset + mb.r->gm->raster_count;
+	}
 	mp_clear_buffer(mb.r);						// clear it out (& reset replannable)
 //	mb.r->buffer_state = MP_BUFFER_EMPTY;		// redundant after the clear, above
 	mb.r = mb.r->nx;							// advance to next run buffer
 	if (mb.r->buffer_state == MP_BUFFER_QUEUED) {// only if queued...
 		mb.r->buffer_state = MP_BUFFER_PENDING;	// pend next buffer
 	}
-	if (mb.w == mb.r) cm_cycle_end();			// end the cycle if the queue empties
-	mb.buffers_available++;
+	mb.seq_freed++;
+	_dispatch_commands(&mb.cq, mb.seq_freed);	// run commands waiting on this buffer
+	if (mb.w == mb.r) cm_cycle_end();			// end the cycle if the queue empties
+	controller_signal(CTL_EVENT_BUFFER);		// wake tasks waiting for planner room
 	qr_request_queue_report(-1);				// add to the "removed buffers" count
 }
 
 mpBuf_t * mp_get_first_buffer(void)
 {
-	return(mp_get_run_buffer());	// returns buffer or NULL if nothing's running
+	mpBuf_t *bf = mb.r;				// returns buffer or NULL if nothing's running or queued
+	if ((bf->buffer_state == MP_BUFFER_QUEUED) || (bf->buffer_state == MP_BUFFER_PENDING) ||
+		(bf->buffer_state == MP_BUFFER_RUNNING)) { 
+		return (bf);
+	}
+	return (NULL);
 }
 
 mpBuf_t * mp_get_last_buffer(void)
 {
-	mpBuf_t *bf = mp_get_run_buffer();
+	mpBuf_t *bf = mp_get_first_buffer();
 	mpBuf_t *bp = bf;
 
 	if (bf == NULL) { return(NULL);}
@@ -414,20 +716,234 @@ void mp_clear_buffer(mpBuf_t *bf)
 {
 	mpBuf_t *nx = bf->nx;			// save pointers
 	mpBuf_t *pv = bf->pv;
-	memset(bf, 0, sizeof(mpBuf_t));
+	mpBlock_t *blk = bf->gm;
+	mpArc_t *arc_rec = bf->arc;
+	mpSections_t *sect = bf->sect;
+	memset(bf, 0, sizeof(mpBuf_t));	// the block record is cleared by mp_get_write_buffer()
 	bf->nx = nx;					// restore pointers
 	bf->pv = pv;
+	bf->gm = blk;
+	bf->arc = arc_rec;
+	bf->sect = sect;
+	sect->ready = false;
 }
 
 void mp_copy_buffer(mpBuf_t *bf, const mpBuf_t *bp)
 {
 	mpBuf_t *nx = bf->nx;			// save pointers
 	mpBuf_t *pv = bf->pv;
+	mpBlock_t *blk = bf->gm;
+	uint32_t queue_time = bf->queue_time;	// queue time stays with the buffer that counted it
+	mpArc_t *arc_rec = bf->arc;
+	mpSections_t *sect = bf->sect;	// bf is replanned, so its sections are set up again
+	if (bp->move_code != MOVE_CODE_LINE) { memcpy(arc_rec, bp->arc, sizeof(mpArc_t));}
+	if (blk->modal != MP_MODAL_NONE) { mb.modal_bound[blk->modal]--;}	// bf drops its modal record...
+	if (bp->gm->modal != MP_MODAL_NONE) { mb.modal_bound[bp->gm->modal]++;}// ...and shares bp's
  	memcpy(bf, bp, sizeof(mpBuf_t));
+	memcpy(blk, bp->gm, sizeof(mpBlock_t));
 	bf->nx = nx;					// restore pointers
 	bf->pv = pv;
+	bf->gm = blk;
+	bf->arc = arc_rec;
+	bf->sect = sect;
+	sect->ready = false;
+	bf->queue_time = queue_time;
+}
+
+static void _get_modal(mpModal_t *m, const GCodeState_t *gm_in)
+{
+	memset(m, 0, sizeof(mpModal_t));	// zero the padding so records compare with memcmp()
+	copy_axis_vector(m->work_offset, gm_in->work_offset);
+	m->spindle_speed = gm_in->spindle_speed;
+	m->units_mode = gm_in->units_mode;
+	m->coord_system = gm_in->coord_system;
+	m->select_plane = gm_in->select_plane;
+	m->path_control = gm_in->path_control;
+	m->distance_mode = gm_in->distance_mode;
+	m->inverse_feed_rate_mode = gm_in->inverse_feed_rate_mode;
+	m->tool = gm_in->tool;
+	m->mist_coolant = gm_in->mist_coolant;
+	m->flood_coolant = gm_in->flood_coolant;
+	m->spindle_mode = gm_in->spindle_mode;
+}
+
+void mp_bind_gcode_state(mpBuf_t *bf, const GCodeState_t *gm_in)
+{
+	mpBlock_t *blk = bf->gm;
+	blk->linenum = gm_in->linenum;
+	blk->motion_mode = gm_in->motion_mode;
+	copy_axis_vector(blk->target, gm_in->target);
+	blk->move_time = gm_in->move_time;
+	blk->feed_rate = gm_in->feed_rate;
+	blk->path_tolerance = gm_in->path_tolerance;
+	blk->spindle_sync = gm_in->spindle_sync;
+
+	mpModal_t m;
+	_get_modal(&m, gm_in);
+	uint8_t i = mb.modal_newest;
+	if ((mb.modal_version[i] == 0) || (memcmp(&mb.modal[i], &m, sizeof(mpModal_t)) != 0)) {
+		for (i=0; i < MP_MODAL_RECORDS; i++) {		// find a record no block is using
+			if ((uint8_t)(mb.modal_bound[i] - mb.modal_freed[i]) == 0) break;
+		}
+		if (i == MP_MODAL_RECORDS) { i = mb.modal_newest;}	// all in use - rewrite the newest
+		memcpy(&mb.modal[i], &m, sizeof(mpModal_t));
+		mb.modal_version[i] = ++mb.modal_seq;
+		mb.modal_newest = i;
+	}
+	mb.modal_bound[i]++;
+	blk->modal = i;
+}
+
+uint8_t mp_modal_matches(const mpBuf_t *bf, const GCodeState_t *gm_in)
+{
+	if (bf->gm->modal == MP_MODAL_NONE) { return (false);}
+	mpModal_t m;
+	_get_modal(&m, gm_in);
+	return (memcmp(&mb.modal[bf->gm->modal], &m, sizeof(mpModal_t)) == 0);
+}
+
+void mp_load_runtime_gcode_state(const mpBuf_t *bf)
+{
+	GCodeState_t *gm_out = &mr.gm;
+	const mpBlock_t *blk = bf->gm;
+	gm_out->linenum = blk->linenum;
+	gm_out->motion_mode = blk->motion_mode;
+	copy_axis_vector(gm_out->target, blk->target);
+	gm_out->move_time = blk->move_time;
+	gm_out->feed_rate = blk->feed_rate;
+	gm_out->path_tolerance = blk->path_tolerance;
+	gm_out->spindle_sync = blk->spindle_sync;
+
+	if ((blk->modal == MP_MODAL_NONE) || (mb.modal_version[blk->modal] == mr.modal_version)) return;
+	const mpModal_t *m = &mb.modal[blk->modal];	// modal state changed since the last block
+	copy_axis_vector(gm_out->work_offset, m->work_offset);
+	gm_out->spindle_speed = m->spindle_speed;
+	gm_out->units_mode = m->units_mode;
+	gm_out->coord_system = m->coord_system;
+	gm_out->select_plane = m->select_plane;
+	gm_out->path_control = m->path_control;
+	gm_out->distance_mode = m->distance_mode;
+	gm_out->inverse_feed_rate_mode = m->inverse_feed_rate_mode;
+	gm_out->tool = m->tool;
+	gm_out->mist_coolant = m->mist_coolant;
+	gm_out->flood_coolant = m->flood_coolant;
+	gm_out->spindle_mode = m->spindle_mode;
+	mr.modal_version = mb.modal_version[blk->modal];
+}
+
+/*
+ * mp_get_plq()  - dump the planned queue. JSON mode only - text mode prints it in mp_print_plq()
+ *
+ *	One row per queued line or arc block, running block first, as the planner left it:
+ *
+ *	  [line,length,entry,cruise,exit,head,body,tail,jerk,replannable]
+ *
+ *	lengths in mm, velocities in mm/min and jerk in the units of $xjm. Dwells and
+ *	commands in the queue are skipped. The value is the number of blocks sent.
+ *
+ *	Each block is copied out with interrupts off, so the exec can free blocks under 
+ *	a dump without tearing one. It costs a pass over the queue and no planning, so 
+ *	it can be polled during a job.
+ */
+
+typedef struct mpPlanRow {
+	uint32_t linenum;
+	float length;
+	float entry_velocity;
+	float cruise_velocity;
+	float exit_velocity;
+	float head_length;
+	float body_length;
+	float tail_length;
+	float jerk;
+	uint8_t replannable;
+} mpPlanRow_t;
+
+typedef void (*mpPlanPrint_t)(const mpPlanRow_t *row, uint8_t first);
+
+/* _plan_row() - copy out a block. Returns false if it isn't a queued line or arc */
+static uint8_t _plan_row(mpBuf_t *bf, mpPlanRow_t *row)
+{
+	uint8_t valid = false;
+	__disable_irq();
+	if ((bf->move_type == MOVE_TYPE_ALINE) && ((bf->buffer_state == MP_BUFFER_QUEUED) ||
+		(bf->buffer_state == MP_BUFFER_PENDING) || (bf->buffer_state == MP_BUFFER_RUNNING))) {
+		row->linenum = bf->gm->linenum;
+		row->length = bf->length;
+		row->entry_velocity = bf->entry_velocity;
+		row->cruise_velocity = bf->cruise_velocity;
+		row->exit_velocity = bf->exit_velocity;
+		row->head_length = bf->head_length;
+		row->body_length = bf->body_length;
+		row->tail_length = bf->tail_length;
+		row->jerk = bf->jerk / JERK_MULTIPLIER;
+		row->replannable = bf->replannable;
+		valid = true;
+	}
+	__enable_irq();
+	return (valid);
 }
 
+/* _plan_walk() - pass each block in the queue to print (NULL to count them). Returns the number of blocks */
+static uint32_t _plan_walk(mpPlanPrint_t print)
+{
+	mpPlanRow_t row;
+	uint32_t rows = 0;
+	mpBuf_t *first = mp_get_first_buffer();
+	if (first == NULL) { return (0);}
+
+	mpBuf_t *bf = first;
+	do {
+		if (_plan_row(bf, &row) == true) {
+			if (print != NULL) { print(&row, (rows == 0));}
+			rows++;
+		}
+		bf = mp_get_next_buffer(bf);
+	} while ((bf != first) && ((bf->buffer_state == MP_BUFFER_QUEUED) || (bf->buffer_state == MP_BUFFER_PENDING)));
+	return (rows);
+}
+
+static void _plan_row_json(const mpPlanRow_t *r, uint8_t first)
+{
+	fprintf_P(stderr, PSTR("%s[%lu,%1.3f,%1.1f,%1.1f,%1.1f,%1.3f,%1.3f,%1.3f,%1.1f,%d]"), (first) ? "" : ",",
+			  (unsigned long)r->linenum, r->length, r->entry_velocity, r->cruise_velocity, r->exit_velocity,
+			  r->head_length, r->body_length, r->tail_length, r->jerk, r->replannable);
+}
+
+stat_t mp_get_plq(cmdObj_t *cmd)
+{
+	cmd->objtype = TYPE_INTEGER;
+	if (cfg.comm_mode != JSON_MODE) {
+		cmd->value = (float)_plan_walk(NULL);
+		return (STAT_OK);
+	}
+	fprintf_P(stderr, PSTR("{\"plq\":["));
+	cmd->value = (float)_plan_walk(_plan_row_json);
+	fprintf_P(stderr, PSTR("]}\n"));
+	return (STAT_OK);
+}
+
+#ifdef __TEXT_MODE
+
+static const char fmt_plq[] PROGMEM = "[plq]  planned queue%19lu blocks\n";
+static const char fmt_plq_head[] PROGMEM = "    line   length    entry   cruise     exit     head     body     tail    jerk rp\n";
+static const char fmt_plq_row[] PROGMEM = "%8lu %8.3f %8.1f %8.1f %8.1f %8.3f %8.3f %8.3f %7.0f %2d\n";
+
+static void _plan_row_text(const mpPlanRow_t *r, uint8_t first)
+{
+	if (first) { fprintf_P(stderr, fmt_plq_head);}
+	fprintf_P(stderr, fmt_plq_row, (unsigned long)r->linenum, r->length, r->entry_velocity, r->cruise_velocity,
+			  r->exit_velocity, r->head_length, r->body_length, r->tail_length, r->jerk, r->replannable);
+}
+
+void mp_print_plq(cmdObj_t *cmd)
+{
+	text_print_int(cmd, fmt_plq);
+	_plan_walk(_plan_row_text);
+}
+
+#endif // __TEXT_MODE
+
 #ifdef __DEBUG	// currently this routine is only used by debug routines
 uint8_t mp_get_buffer_index(mpBuf_t *bf) 
 {
@@ -462,7 +978,7 @@ static void _dump_plan_buffer(mpBuf_t *bf)
 			bf->move_state,
 			bf->replannable);
 
-	print_scalar(PSTR("line number:     "), bf->linenum);
+	print_scalar(PSTR("line number:     "), bf->gm->linenum);
 	print_vector(PSTR("position:        "), mm.position, AXES);
 	print_vector(PSTR("target:          "), bf->target, AXES);
 	print_vector(PSTR("unit:            "), bf->unit, AXES);
@@ -493,7 +1009,6 @@ void mp_dump_runtime_state(void)
 	print_scalar(PSTR("move_time:         "), mr.move_time);
 //	print_scalar(PSTR("accel_time;        "), mr.accel_time);
 //	print_scalar(PSTR("elapsed_accel_time:"), mr.elapsed_accel_time);
-	print_scalar(PSTR("midpoint_velocity: "), mr.midpoint_velocity);
 //	print_scalar(PSTR("midpoint_accel:    "), mr.midpoint_acceleration);
 //	print_scalar(PSTR("jerk_div2:         "), mr.jerk_div2);
 
@@ -43,7 +43,15 @@ enum moveType {				// bf->move_type values
 	MOVE_TYPE_TOOL,			// T command
 	MOVE_TYPE_SPINDLE_SPEED,// S command
 	MOVE_TYPE_STOP,			// program stop
-	MOVE_TYPE_END			// program end
+	MOVE_TYPE_END,			// program end
+	MOVE_TYPE_PVT,			// position-velocity-time point (see mp_pvt())
+	MOVE_TYPE_JOG			// jog velocity follower (see mp_jog())
+};
+
+enum moveCode {				// bf->move_code values for ALINE blocks
+	MOVE_CODE_LINE = 0,		// straight line
+	MOVE_CODE_ARC,			// native arc or helix (see mp_arc())
+	MOVE_CODE_ARC_SEGMENT	// line segment of an arc - tangents in bf->arc (see mp_arc_segment())
 };
 
 enum moveState {
@@ -77,17 +85,52 @@ enum moveState {
 
 /* ESTD_SEGMENT_USEC	 Microseconds per planning segment
  *	Should be experimentally adjusted if the MIN_SEGMENT_LENGTH is changed
+ *
+ *	Segment time is picked per section. Bodies run BODY_SEGMENT_USEC segments. Heads and
+ *	tails run nominal segments, or shorter ones down to MIN_SEGMENT_USEC if needed to 
+ *	keep the velocity step between segments under SEGMENT_VELOCITY_ERROR. A section
+ *	that drops the segment time by more than ACCUMULATOR_RESET_FACTOR costs the steppers
+ *	an accumulator reset, so the body default stays at twice the nominal time.
  */
 #define NOM_SEGMENT_USEC 		((float)5000)		// nominal segment time
+#define BODY_SEGMENT_USEC		((float)10000)		// cruise (body) segment time
+
+/* EXEC_BUDGET_RATIO	Exec time budget as a fraction of segment time
+ *	Each mp_exec_move() that preps a line segment is timed against the segment's 
+ *	duration. When it takes more than EXEC_BUDGET_RATIO of it, the runtime backs off 
+ *	by stretching all segment times by EXEC_BACKOFF_STEP, up to EXEC_BACKOFF_MAX. 
+ *	The violations are counted in the segment telemetry ({"segob":n}). The backoff 
+ *	is read with {"segbf":n} and stays in place until the telemetry is reset.
+ */
+#define EXEC_BUDGET_RATIO		((float)0.5)		// exec may use up to half of each segment
+#define EXEC_BACKOFF_STEP		((float)1.25)		// segment time multiplier per violation
+#define EXEC_BACKOFF_MAX		((float)4.0)		// longest backoff (x nominal segment times)
+#define SEGMENT_VELOCITY_ERROR	((float)100)		// max velocity step between head & tail segments (mm/min) 0 disables
 #define MIN_SEGMENT_USEC 		((float)2500)		// minimum segment time
-#define MIN_ARC_SEGMENT_USEC	((float)10000)		// minimum arc segment time
 #define NOM_SEGMENT_TIME 		(MIN_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
 #define MIN_SEGMENT_TIME 		(MIN_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
-#define MIN_ARC_SEGMENT_TIME 	(MIN_ARC_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
 #define MIN_TIME_MOVE  			(MIN_SEGMENT_TIME) 	// minimum time a move can be is one segment
 //#define MIN_LENGTH_MOVE 		(EPSILON)
 //#define MIN_TIME_MOVE  			((float)0.0000001)
 
+/* Feed and traverse overrides - see mp_feed_rate_override()
+ *	FEED_OVERRIDE_MIN/MAX		Range of override factors. Velocity scales by the factor, accel by its square
+ *								and jerk by its cube, so MAX is 1 - the blocks are planned to the limits
+ *	FEED_OVERRIDE_RAMP_TIME		Time to ramp between override factors (in minutes)
+ */
+#define FEED_OVERRIDE_MIN		((float)0.05)
+#define FEED_OVERRIDE_MAX		((float)1.00)
+#define FEED_OVERRIDE_RAMP_TIME	((float)(0.25 / 60))
+
+/* Feed adaptation to a starved queue - see mp_starve_callback()
+ *	STARVE_OVERRIDE_MIN			Lowest factor the feed is slowed to
+ *	STARVE_INTERVAL_MS			Time between adjustments - the override ramp time, so each ramp finishes
+ *	STARVE_IDLE_INTERVALS		Intervals without a new block after which the input counts as stopped
+ */
+#define STARVE_OVERRIDE_MIN		((float)0.25)
+#define STARVE_INTERVAL_MS		250
+#define STARVE_IDLE_INTERVALS	2
+
 /* PLANNER_STARTUP_DELAY_SECONDS
  *	Used to introduce a short dwell before planning an idle machine.
  *  If you don;t do this the first block will always plan to zero as it will
@@ -100,18 +143,51 @@ enum moveState {
  *	Should be at least the number of buffers requires to support optimal 
  *	planning in the case of very short lines or arc segments. 
  *	Suggest 12 min. Limit is 255
+ *
+ *	Each buffer is a hot planning block (mpBuf_t) plus a cold block record (mpBlock_t)
+ *	and arc record (mpArc_t) in parallel tables, about 210 bytes in all. 100 buffers 
+ *	use ~21Kb of the SAM3X's 96Kb. To change the size at build time, define 
+ *	it on the compiler command line (e.g. -DPLANNER_BUFFER_POOL_SIZE=64). It can't go in 
+ *	settings_*.h because not every file that includes planner.h includes settings.h.
+ */
+#ifndef PLANNER_BUFFER_POOL_SIZE
+#define PLANNER_BUFFER_POOL_SIZE 100
+#endif
+#define PLANNER_BUFFER_HEADROOM 4			// buffers to reserve in planner before running an unparsed Gcode line
+#define PLANNER_BATCH_MAX 16				// most blocks planned in one pass ($pbs) - see mp_plan_batch()
+#define PLANNER_BATCH_QUEUE_MS 20			// blocks are only batched with at least this much motion queued ahead
+#define MP_DOGLEG_POINTS 5					// most PVT points a dogleg rapid takes per axis (see mp_dogleg())
+#define ARC_FIT_RADIUS_MAX 1000				// mm - flatter runs of feeds aren't fitted to arcs (see _fit_arc())
+
+/* __FIXED_POINT_RUNTIME
+ *	Runs the per-segment exec math in fixed point instead of soft float (the M3 has 
+ *	no FPU). The segment velocity and forward differences are carried as Q32.32 mm 
+ *	per segment - i.e. pre-multiplied by the segment time when each section is set 
+ *	up - the unit vector as Q1.30 and the runtime position as Q32.32 mm. The segment 
+ *	travel is Q8.24 mm and goes to the motors as integer substeps through 
+ *	ik_kinematics_fixed(). The float travel is only worked when the shaper, pressure 
+ *	advance, height map, backlash or non-linear kinematics need it, and for the probe 
+ *	latch and reports. The per-section setup uses float.
+ *	Comment out to run the float runtime.
  */
-#define PLANNER_BUFFER_POOL_SIZE 28
-#define PLANNER_BUFFER_HEADROOM 4			// buffers to reserve in planner before processing new input line
+#define __FIXED_POINT_RUNTIME
+
+#ifdef __FIXED_POINT_RUNTIME
+typedef int64_t fixed_t;					// Q32.32 fixed point
+typedef fixed_t runtime_t;					// runtime velocity and forward difference type
+#define FX_ONE			((float)4294967296.0)	// 1.0 in Q32.32
+#define FX_UNIT_ONE		((float)1073741824.0)	// 1.0 in Q1.30 (unit vector)
+#define FX_TRAVEL_UNIT	((float)(1.0/16777216.0))// mm per count of Q8.24 segment travel
+#else
+typedef float runtime_t;
+#endif
 
 /* Some parameters for _generate_trapezoid()
- * TRAPEZOID_ITERATION_MAX	 				Max iterations for convergence in the HT asymmetric case.
- * TRAPEZOID_ITERATION_ERROR_PERCENT		Error percentage for iteration convergence. As percent - 0.01 = 1%
+ * TRAPEZOID_NEWTON_ITERATIONS				Fixed Newton steps for the HT asymmetric case. 2 gives < 0.1% error
  * TRAPEZOID_LENGTH_FIT_TOLERANCE			Tolerance for "exact fit" for H and T cases
  * TRAPEZOID_VELOCITY_TOLERANCE				Adaptive velocity tolerance term
  */
-#define TRAPEZOID_ITERATION_MAX				10
-#define TRAPEZOID_ITERATION_ERROR_PERCENT	((float)0.10)
+#define TRAPEZOID_NEWTON_ITERATIONS			2
 #define TRAPEZOID_LENGTH_FIT_TOLERANCE		((float)0.0001)	// allowable mm of error in planning phase
 #define TRAPEZOID_VELOCITY_TOLERANCE		(max(2,bf->entry_velocity/100))
 
@@ -135,17 +211,124 @@ enum mpBufferState {			// bf->buffer_state values
 	MP_BUFFER_RUNNING			// current running buffer
 };
 
+/* __NATIVE_ARCS
+ *	Queue each arc as a single planner block and interpolate it in the runtime (see mp_arc())
+ *	The arc geometry is kept in a cold table parallel to the buffers, like the Gcode state.
+ *	Undefine to expand arcs into line segments in cm_arc_callback() instead.
+ */
+#define __NATIVE_ARCS
+
+typedef struct mpArc {			// tangents and geometry of an arc block or arc segment
+	float center_1;				// center of circle at axis 1 (typ X)
+	float center_2;				// center of circle at axis 2 (typ Y)
+	float radius;				// radius of the circle in mm
+	float dtheta;				// radians of travel per mm of path (+CW, -CCW)
+	float dlinear;				// linear axis travel per mm of path (helical)
+	float segment_length;		// longest runtime segment that meets the chordal tolerance
+	float entry_unit[AXES];		// path tangent at the start of the block
+	float exit_unit[AXES];		// path tangent at the end of the block
+	uint8_t axis_1;				// arc plane axis
+	uint8_t axis_2;				// arc plane axis
+	uint8_t axis_linear;		// transverse axis (helical)
+	uint8_t fitted;				// true if fitted to feeds and still taking them (see _fit_arc())
+} mpArc_t;
+
+/* SECTION PARAMETERS
+ *	Setting up the head, body or tail of a block for the exec - segment count, segment 
+ *	time and forward difference seeds - takes a handful of float divides, which the 
+ *	exec interrupt does in software. The main loop works them out once the block is no 
+ *	longer replannable (see _prep_sections()) and keeps them in a cold table parallel 
+ *	to the buffers, so the exec only loads them as each section starts. 
+ *
+ *	The exec still works out a section itself if the block started while replannable 
+ *	(a short queue), if a feedhold replanned the runtime, or if the exec budget backoff 
+ *	or the segment length limit changed since they were set up.
+ */
+enum mpSectionIndex {
+	SECTION_HEAD = 0,
+	SECTION_BODY,
+	SECTION_TAIL,
+	SECTIONS
+};
+
+typedef struct mpSection {		// exec parameters of a head, body or tail
+	float segments;				// segments in the section - in each half of a head or tail
+	float segment_move_time;	// time of each segment in minutes
+	float microseconds;			// ...and in microseconds
+	runtime_t segment_velocity;	// forward difference seeds (see _init_forward_diffs())
+	runtime_t forward_diff_1;
+	runtime_t forward_diff_2;
+} mpSection_t;
+
+typedef struct mpSections {		// exec parameters of a block
+	volatile uint8_t ready;		// TRUE once set up - cleared when the trapezoid changes
+	float segment_backoff;		// mr.segment_backoff they were set up for
+	float segment_length_max;	// ...and the segment length limit
+	mpSection_t section[SECTIONS];
+} mpSections_t;
+
+/* MODAL STATE TABLE
+ *	The planner and runtime only need a block's target, times and line number. These go
+ *	in the block record (mpBlock_t), one per buffer. The rest of the Gcode state - work 
+ *	offsets, units, plane, tool, coolant... - is only read for reports, and changes far 
+ *	less often than the blocks do. It is kept once in a small table of modal records 
+ *	(mpModal_t) and each block refers to it by index. A block whose modal state matches
+ *	the newest record shares it; otherwise it takes a free record. The runtime copies a 
+ *	record into mr.gm only when the running block's record version differs from the
+ *	last one it loaded - i.e. once per modal change, not once per block.
+ *
+ *	The main loop counts the blocks bound to a record and the exec counts them as they 
+ *	are freed, so each counter has one writer. If all MP_MODAL_RECORDS are in use the 
+ *	newest record is rewritten in place - blocks already queued on it then report the 
+ *	newer modal state. Motion is never affected; it only takes that many modal changes
+ *	inside the planner queue.
+ */
+#ifndef MP_MODAL_RECORDS
+#define MP_MODAL_RECORDS 8			// Limit is 254
+#endif
+#define MP_MODAL_NONE 0xFF			// block has no modal record (dwells, commands)
+
+typedef struct mpBlock {		// per-block Gcode state - used by planner and runtime
+	uint32_t linenum;			// Gcode block line number
+	uint8_t motion_mode;		// Group1 motion mode
+	uint8_t modal;				// index into mb.modal[] or MP_MODAL_NONE
+	float target[AXES];			// XYZABC where the move should go
+	float move_time;			// optimal time for move given axis constraints
+	float feed_rate;			// F - normalized to millimeters/minute
+	float path_tolerance;		// G64 P - corner blending tolerance in mm
+	float spindle_sync;			// G33, G84 - spindle RPM the move is planned for, or 0
+	uint16_t raster_offset;		// first pixel in mrr.pixels[] - raster lines only (see RASTER LINES)
+	uint16_t raster_count;		// pixels in the raster line, 0 if the block isn't one
+	float raster_pitch;			// pixel pitch along the line in mm
+} mpBlock_t;
+
+typedef struct mpModal {		// modal and reporting state shared by queued blocks
+	float work_offset[AXES];	// offset from the work coordinate system (for reporting only)
+	float spindle_speed;		// in RPM
+	uint8_t units_mode;
+	uint8_t coord_system;
+	uint8_t select_plane;
+	uint8_t path_control;
+	uint8_t distance_mode;
+	uint8_t inverse_feed_rate_mode;
+	uint8_t tool;
+	uint8_t mist_coolant;
+	uint8_t flood_coolant;
+	uint8_t spindle_mode;
+} mpModal_t;
+
 typedef struct mpBuffer {		// See Planning Velocity Notes for variable usage
 	struct mpBuffer *pv;		// static pointer to previous buffer
 	struct mpBuffer *nx;		// static pointer to next buffer
 	stat_t (*bf_func)(struct mpBuffer *bf); // callback to buffer exec function
 	cm_exec cm_func;			// callback to canonical machine execution function
 
-	uint8_t buffer_state;		// used to manage queueing/dequeueing
+	volatile uint8_t buffer_state;// used to manage queueing/dequeueing (see PLANNER RING)
 	uint8_t move_type;			// used to dispatch to run routine
 	uint8_t move_code;			// byte that can be used by used exec functions
 	uint8_t move_state;			// move state machine sequence
 	uint8_t replannable;		// TRUE if move can be replanned
+	uint8_t spinup;				// TRUE if the move waits for the spindle to spin up (see spindle.h)
 
 	float unit[AXES];			// unit vector for axis scaling & planning
 
@@ -167,35 +350,183 @@ typedef struct mpBuffer {		// See Planning Velocity Notes for variable usage
 	float jerk;					// maximum linear jerk term for this move
 	float recip_jerk;			// 1/Jm used for planning (compute-once)
 	float cbrt_jerk;			// cube root of Jm used for planning (compute-once)
+	uint32_t queue_time;		// uSec of movement or dwell this buffer adds to the queue time
 
-	GCodeState_t gm;			// Gode model state - passed from model, used by planner and runtime
-
+	mpBlock_t *gm;				// block record - passed from model, used by planner and runtime
+								// static pointer into mb.gm[] - the planning code never touches it
+	mpArc_t *arc;				// arc record if move_code is not MOVE_CODE_LINE - static pointer into mb.arc[]
+	mpSections_t *sect;			// exec parameters of an aline - static pointer into mb.sect[]
 } mpBuf_t;
 
+/* RASTER LINES
+ *	A raster line is a straight feed with a power level for each pixel along it, so an 
+ *	engraving scan is one planner block rather than a G1 and an S word per pixel. The 
+ *	pixels are kept in a ring (mrr) until the block has run. The main loop writes 
+ *	them and the block record says where they are; the exec releases them as it frees 
+ *	the block. A line's pixels are never split across the end of the ring.
+ *
+ *	The block is planned and run like any other line, with the pixel under each point
+ *	taken from the distance left to the block's endpoint - so a line split by a 
+ *	feedhold picks up at the right pixel. The exec copies the pixels of each segment 
+ *	to the prep buffer and the DDA steps through them (see Raster pixels in stepper.h).
+ *
+ *	RASTER_BUFFER_LEN	bytes of pixels that can be queued
+ *	RASTER_PIXELS_MAX	pixels in one line. The controller holds input while the ring 
+ *						has less room than this (see mp_raster_room())
+ */
+#ifndef RASTER_BUFFER_LEN
+#define RASTER_BUFFER_LEN 2048
+#endif
+#define RASTER_PIXELS_MAX 192		// a JSON line holds fewer (see cm_set_ras())
+
+typedef struct mpRasterRing {		// pixel ring - one writer (main loop) and one reader (exec)
+	uint16_t wr;					// next free pixel (written by main loop)
+	volatile uint16_t rd;			// end of the oldest queued line's pixels (written by exec)
+	uint8_t pixels[RASTER_BUFFER_LEN];
+} mpRasterRing_t;
+
+/*
+ * Command side queue - see mp_queue_command()
+ */
+#define COMMAND_QUEUE_SIZE 16		// commands that can wait on motion without a planner buffer
+
+typedef struct mpCommand {			// a queued command and its arguments
+	uint32_t seq;					// runs once this many planner buffers have been freed
+	cm_exec cm_func;				// callback to canonical machine execution function
+	float value[AXES];				// 2 vectors used by callbacks
+	float flag[AXES];
+} mpCommand_t;
+
+typedef struct mpCommandQueue {		// ring with one writer (main loop) and one reader (exec)
+	volatile uint8_t w;				// write index
+	volatile uint8_t r;				// read index
+	mpCommand_t cmd[COMMAND_QUEUE_SIZE];
+} mpCommandQueue_t;
+
+/*
+ * Output triggers - see mp_queue_output_trigger()
+ */
+#define OUTPUT_TRIGGER_QUEUE_SIZE 8	// M62 and M63 that can wait on the motion they switch in
+
+typedef struct mpOutputTrigger {	// digital outputs to switch part way into a block
+	uint32_t seq;					// in the block run once this many planner buffers have been freed
+	uint8_t on;						// outputs switched on: bit 0 = output 1
+	uint8_t off;					// ...and off
+	float distance;					// mm into the block
+	float time;						// usec of motion into the block
+} mpOutputTrigger_t;
+
+typedef struct mpOutputQueue {		// ring with one writer (main loop) and one reader (exec)
+	volatile uint8_t w;				// write index
+	volatile uint8_t r;				// read index
+	uint8_t prep;					// read index once the segment being prepped is loaded
+	mpOutputTrigger_t trig[OUTPUT_TRIGGER_QUEUE_SIZE];
+} mpOutputQueue_t;
+
+/* PLANNER RING
+ *	The buffer pool is a single producer, single consumer ring. The main loop is the 
+ *	producer: it owns mb.w and mb.q, takes EMPTY buffers, fills them and hands them 
+ *	over by setting them QUEUED. The exec is the consumer: it owns mb.r, moves the 
+ *	head buffer from QUEUED to PENDING to RUNNING, and hands it back by clearing it 
+ *	to EMPTY. Every shared word has one writer - the buffers available count is the 
+ *	difference of seq_taken (main loop) and seq_freed (exec) rather than a counter
+ *	both sides change - so no read-modify-write is ever shared and neither side 
+ *	needs LDREX/STREX or masks interrupts.
+ *
+ *	The exec runs as an interrupt on a single core, so it always sees the main loop's
+ *	stores in program order, and the main loop never sees an exec half done. What 
+ *	remains is the compiler: mp_release_barrier() keeps the stores that fill a block 
+ *	ahead of the store that queues it. Queued blocks stay open to replanning by the 
+ *	main loop until the exec starts them and clears bf->replannable.
+ */
+#define mp_release_barrier() __asm__ __volatile__ ("" ::: "memory")
+
 typedef struct mpBufferPool {	// ring buffer for sub-moves
-	magic_t magic_start;		// magic number to test memory integrity
-	uint8_t buffers_available;	// running count of available buffers
-	mpBuf_t *w;					// get_write_buffer pointer
-	mpBuf_t *q;					// queue_write_buffer pointer
-	mpBuf_t *r;					// get/end_run_buffer pointer
-	mpBuf_t bf[PLANNER_BUFFER_POOL_SIZE];// buffer storage
+	magic_t magic_start;		// magic number to test memory integrity
+	mpBuf_t * volatile w;		// get_write_buffer pointer (written by main loop)
+	mpBuf_t *q;					// queue_write_buffer pointer (main loop only)
+	mpBuf_t *r;					// get/end_run_buffer pointer (written by exec)
+	uint32_t seq_taken;			// running count of buffers taken for writing (written by main loop)
+	uint32_t time_queued;		// running uSec of movement & dwell queued (written by main loop)
+	uint32_t time_freed;		// running uSec freed from the queue (written by exec interrupt)
+	uint32_t seq_queued;		// running count of buffers queued (written by main loop)
+	volatile uint32_t seq_freed;// running count of buffers freed (written by exec interrupt)
+	uint8_t dry_run;			// TRUE to plan without running moves or commands (see benchmark.cpp, preflight.h)
+	mpBuf_t *restart;			// block that starts from rest after a hold - planned on demand (see mp_end_hold())
+	uint8_t batch;				// blocks taken after mb.q and waiting to be planned and queued (see mp_plan_batch())
+	mpBuf_t bf[PLANNER_BUFFER_POOL_SIZE];// buffer storage - hot planning blocks
+	mpBlock_t gm[PLANNER_BUFFER_POOL_SIZE];// block record for each buffer (cold, see bf->gm)
+	mpModal_t modal[MP_MODAL_RECORDS];// modal records shared by the blocks (see MODAL STATE TABLE)
+	uint32_t modal_version[MP_MODAL_RECORDS];// changes each time a record is written
+	uint8_t modal_bound[MP_MODAL_RECORDS];// running count of blocks bound (written by main loop)
+	volatile uint8_t modal_freed[MP_MODAL_RECORDS];// running count of blocks freed (written by exec)
+	uint8_t modal_newest;		// record the last block was bound to
+	uint32_t modal_seq;			// last version number handed out
+	mpArc_t arc[PLANNER_BUFFER_POOL_SIZE];// arc record for each buffer (cold, see bf->arc)
+	mpSections_t sect[PLANNER_BUFFER_POOL_SIZE];// section parameters for each buffer (cold, see bf->sect)
+	mpCommandQueue_t cq;		// commands that run between buffers without taking one
+	mpCommandQueue_t oq;		// output commands that run when the motors reach them
+	mpOutputQueue_t tq;			// output triggers switched by the segment they fall in
 	magic_t magic_end;
 } mpBufferPool_t;
 
+typedef struct mpTrapezoidCache {	// inputs and results of the last _calculate_trapezoid()
+	float length;				// inputs...
+	float jerk;
+	float cruise_vmax;
+	float entry_velocity;		// requested velocities in, computed velocities out
+	float cruise_velocity;
+	float exit_velocity;
+	float entry_velocity_out;	// results...
+	float cruise_velocity_out;
+	float exit_velocity_out;
+	float head_length;
+	float body_length;
+	float tail_length;
+	uint8_t skip;				// true if the block was too short to run (MOVE_STATE_SKIP)
+} mpTrapezoidCache_t;
+
 typedef struct mpMoveMasterSingleton {	// common variables for planning (move master)
 	float position[AXES];		// final move position for planning purposes
-//	float ms_in_queue;			// UNUSED - total ms of movement & dwell in planner queue
 	float prev_jerk;			// jerk values cached from previous move
 	float prev_recip_jerk;
 	float prev_cbrt_jerk;
-#ifdef __UNIT_TEST_PLANNER
-	float test_case;
-	float test_velocity;
-	float a_unit[AXES];
-	float b_unit[AXES];
-#endif
+	mpTrapezoidCache_t trap;	// last trapezoid computed - reused for identical blocks
+	float coalesce_start[AXES];	// start position of the newest aline block (see _coalesce_aline())
+	float coalesce_unit[AXES];	// unit vector of the first move merged into that block
+	uint8_t residual;			// true if moves too short to plan are pending (see mp_aline())
+	uint32_t residual_linenum;	// line number of the last of them
+	float residual_target[AXES];// ...and its endpoint
+	float residual_time;		// their summed move times, in minutes
+	uint32_t starve_tick;		// SysTick of the last starved queue adjustment
+	uint32_t starve_seq;		// buffers queued by then (mb.seq_taken)
+	uint8_t starve_idle;		// adjustments since a buffer was last queued
+	uint8_t batch_more;			// true while more blocks are coming in (see mp_plan_batch_callback())
+	uint32_t aline_count;		// blocks planned by mp_aline(), mp_arc_segment() and mp_arc() - for benchmarking
+	uint32_t aline_cycles;		// CPU cycles spent planning them
+	uint32_t plan_passes;		// _plan_block_list() calls
+	uint32_t plan_blocks;		// blocks visited by the forward planning passes
 } mpMoveMasterSingleton_t;
 
+/* RUNTIME SNAPSHOT
+ *	Reports read the runtime position, velocity and work offsets from the main loop 
+ *	while the exec interrupt is changing them, and a multi-axis read can straddle a 
+ *	segment. So the exec publishes them to mr.snapshot once per segment (and where 
+ *	a queued command changes them) under a sequence count: odd while it is writing, 
+ *	even when the copy is whole. A reader copies the snapshot out and retries if the 
+ *	count was odd or moved - no interrupts are disabled and the exec never waits.
+ *
+ *	All writers run at exec level, or while the runtime is idle, so there is only 
+ *	ever one writer. A status report holds one copy for all of its elements (see 
+ *	mp_hold_runtime_snapshot()) so the axes in a report come from the same segment.
+ */
+typedef struct mpRuntimeSnapshot {	// runtime state as the reports see it
+	uint32_t sequence;			// odd while the exec is writing
+	float position[AXES];		// absolute position in mm
+	float work_offset[AXES];	// work offsets of the running block
+	float velocity;				// velocity of the last segment in mm/min, overrides applied
+} mpRuntimeSnapshot_t;
+
 typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 //	uint8_t (*run_move)(struct mpMoveRuntimeSingleton *m); // currently running move - left in for reference
 	magic_t magic_start;		// magic number to test memory integrity
@@ -203,8 +534,13 @@ typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 	uint8_t section_state;		// state within a move section
 
 	float endpoint[AXES];		// final target for bf (used to correct rounding errors)
+#ifdef __FIXED_POINT_RUNTIME
+	volatile fixed_t position[AXES];// current move position - read with mp_get_runtime_absolute_position()
+	int32_t unit[AXES];			// unit vector for axis scaling & planning (Q1.30)
+#else
 	float position[AXES];		// current move position
 	float unit[AXES];			// unit vector for axis scaling & planning
+#endif
 
 	float head_length;			// copies of bf variables of same name
 	float body_length;
@@ -214,7 +550,6 @@ typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 	float exit_velocity;
 
 	float length;				// length of line in mm
-	float midpoint_velocity;	// velocity at accel/decel midpoint
 	float jerk;					// max linear jerk
 
 	float segments;				// number of segments in arc or blend
@@ -222,12 +557,49 @@ typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 	float segment_move_time;	// actual time increment per aline segment
 	float microseconds;			// line or segment time in microseconds
 	float segment_length;		// computed length for aline segment
-	float segment_velocity;		// computed velocity for aline segment
-	float forward_diff_1;		// forward difference level 1 (Acceleration)
-	float forward_diff_2;		// forward difference level 2 (Jerk - constant)
+	runtime_t segment_velocity;	// computed velocity for aline segment (see __FIXED_POINT_RUNTIME)
+	runtime_t forward_diff_1;	// forward difference level 1 (Acceleration)
+	runtime_t forward_diff_2;	// forward difference level 2 (Jerk - constant)
+	float segment_length_max;	// longest segment the move may run in mm (0 is unlimited)
+	const mpSections_t *sections;// section parameters of the running block, or NULL (see SECTION PARAMETERS)
+	float height_offset;		// Z height map compensation the motors are at (see kinematics.h)
+	float power_velocity;		// programmed velocity the full S power is for (see pwm_set_power())
+#ifdef __NATIVE_ARCS
+	uint8_t arc_move;			// TRUE if the running move is a native arc
+	float arc_theta;			// angle of the arc at the start of the move
+	float arc_linear;			// linear axis position at the start of the move
+	float arc_travel;			// path length run so far in mm
+	mpArc_t arc;				// arc geometry copied from the bf buffer
+#endif
+	float pvt_start[AXES];		// position the running PVT point starts from
+	float pvt_entry[AXES];		// velocities at its start and end in mm/min
+	float pvt_exit[AXES];
+	float pvt_time;				// its duration in minutes
+	uint32_t pvt_seq;			// seq_freed when the last PVT point ended - its exit velocity carries on
+	float jog_velocity[AXES];	// velocity of each axis in the running jog in mm/min...
+	float jog_accel[AXES];		// ...and its acceleration in mm/min^2
+	const uint8_t *raster;		// pixels of the running raster line, or NULL (see RASTER LINES)
+	uint16_t raster_count;		// ...how many
+	float raster_pitch;			// ...and their pitch in mm
+
+	volatile float feed_override;		// requested feed override factor (written by main loop)
+	volatile float traverse_override;	// requested traverse override factor (written by main loop)
+	volatile float starve_override;		// factor for a short queue, on top of both (see mp_starve_callback())
+	volatile float load_override;		// spindle load factor on feeds, unramped (see load_control.h)
+	float override_factor;		// time scaling applied to the running segments
+	float override_begin;		// factor at the start of the override ramp
+	float override_end;			// factor at the end of the override ramp
+	float override_elapsed;		// time into the override ramp (minutes)
+	uint32_t output_seq;		// seq_freed of the block the output trigger distances are in
+	float output_travel;		// mm run in that block (see mp_prep_outputs())
+	float output_time;			// usec of motion run in that block
+	float segment_backoff;		// segment time multiplier from exec budget violations (see EXEC_BUDGET_RATIO)
+	uint8_t backoff_section;	// TRUE once the running section has backed off
 
 	GCodeState_t gm;			// gocode model state currently executing
-
+	uint32_t modal_version;		// version of the modal record last loaded into gm
+	volatile mpRuntimeSnapshot_t snapshot;	// published for the reports (see RUNTIME SNAPSHOT)
+
 	magic_t magic_end;
 } mpMoveRuntimeSingleton_t;
 
@@ -235,6 +607,7 @@ typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 extern mpBufferPool_t mb;				// move buffer queue
 extern mpMoveMasterSingleton_t mm;		// context for line planning
 extern mpMoveRuntimeSingleton_t mr;		// context for line runtime
+extern mpRasterRing_t mrr;				// raster line pixels
 
 /*
  * Global Scope Functions
@@ -249,21 +622,50 @@ void mp_set_runtime_position(uint8_t axis, const float position);
 
 stat_t mp_exec_move(void);
 void mp_queue_command(void(*cm_exec)(float[], float[]), float *value, float *flag);
+void mp_queue_stop_command(void(*cm_exec)(float[], float[]), float *value, float *flag);
+void mp_queue_output_command(void(*cm_exec)(float[], float[]), float *value, float *flag);
+void mp_queue_output_trigger(const uint8_t output, const uint8_t state, const float distance, const float time);
+uint8_t mp_output_trigger_waiting(void);
+void mp_prep_outputs(const float length, const float microseconds);
+void mp_commit_outputs(const float length, const float microseconds);
 
 stat_t mp_dwell(const float seconds);
 void mp_end_dwell(void);
 
 stat_t mp_aline(const GCodeState_t *gm_line);
+void mp_plan_residual(void);
+void mp_plan_batch(void);
+stat_t mp_plan_batch_callback(const uint8_t more);
+stat_t mp_arc_segment(const GCodeState_t *gm_line, const float entry_unit[], const float exit_unit[], const float radius);
+#ifdef __NATIVE_ARCS
+stat_t mp_arc(const GCodeState_t *gm_arc, const float center_1, const float center_2,
+			  const float theta, const float radius, const float angular_travel, const float linear_travel,
+			  const uint8_t axis_1, const uint8_t axis_2, const uint8_t axis_linear);
+#endif
+stat_t mp_pvt(const float target[], const float velocity[], const float seconds);
+stat_t mp_dogleg(const GCodeState_t *gm_line);
+stat_t mp_jog(void);
+stat_t mp_raster(const GCodeState_t *gm_line, const uint8_t pixels[], const uint16_t count);
+uint8_t mp_raster_room(void);
 
 stat_t mp_plan_hold_callback(void);
 stat_t mp_end_hold(void);
 stat_t mp_feed_rate_override(uint8_t flag, float parameter);
+stat_t mp_traverse_override(uint8_t flag, float parameter);
+stat_t mp_starve_callback(void);
 
 // planner buffer handlers
 void mp_init_buffers(void);
 uint8_t mp_get_planner_buffers_available(void);
+uint32_t mp_get_planner_queue_time(void);
+void mp_set_dry_run(uint8_t flag);
+void mp_add_queue_time(mpBuf_t *bf, const float seconds);
+float mp_get_block_time(const mpBuf_t *bf);
 void mp_clear_buffer(mpBuf_t *bf); 
 void mp_copy_buffer(mpBuf_t *bf, const mpBuf_t *bp);
+void mp_bind_gcode_state(mpBuf_t *bf, const GCodeState_t *gm_in);
+uint8_t mp_modal_matches(const mpBuf_t *bf, const GCodeState_t *gm_in);
+void mp_load_runtime_gcode_state(const mpBuf_t *bf);
 void mp_queue_write_buffer(const uint8_t move_type);
 void mp_free_run_buffer(void);
 mpBuf_t * mp_get_write_buffer(void); 
@@ -277,9 +679,22 @@ mpBuf_t * mp_get_last_buffer(void);
 float mp_get_runtime_velocity(void);
 float mp_get_runtime_work_position(uint8_t axis);
 float mp_get_runtime_absolute_position(uint8_t axis);
+float mp_get_runtime_reported_position(uint8_t axis);
+void mp_publish_runtime(void);
+void mp_hold_runtime_snapshot(uint8_t hold);
 void mp_set_runtime_work_offset(float offset[]);
 void mp_zero_segment_velocity(void);
 uint8_t mp_get_runtime_busy(void);
+uint8_t mp_check_exec_budget(uint32_t cycles);
+void mp_reset_exec_budget(void);
+stat_t mp_exec_shaper(void);
+
+stat_t mp_get_plq(cmdObj_t *cmd);
+#ifdef __TEXT_MODE
+	void mp_print_plq(cmdObj_t *cmd);
+#else
+	#define mp_print_plq tx_print_stub
+#endif
 
 #ifdef __DEBUG
 void mp_dump_running_plan_buffer(void);
@@ -287,17 +702,6 @@ void mp_dump_plan_buffer_by_index(uint8_t index);
 void mp_dump_runtime_state(void);
 #endif
 
-/*** Unit tests ***/
-
-//#define __UNIT_TEST_PLANNER	// uncomment to compile in planner unit tests
-#ifdef __UNIT_TEST_PLANNER
-void mp_unit_tests(void);
-void mp_plan_arc_unit_tests(void);
-#define	PLANNER_UNITS mp_unit_tests();
-#else
-#define	PLANNER_UNITS
-#endif // end __UNIT_TEST_PLANNER
-
 #ifdef __cplusplus
 }
 #endif
@@ -62,6 +62,13 @@ else ifeq ($(CHIP),$(findstring $(CHIP), $(SAM3XA)))
 
 BOARD:=SAM3X_EK
 SERIES:=sam3xa
+# memory for the budget printed at link: flash less the persistence region, sram0 (the
+# statics and the stack) and sram1 (see SRAM_DMA in tinyg2.h), and the least sram to 
+# leave for the stack without a warning
+ROM_SIZE:=507904
+RAM_SIZE:=65536
+RAM1_SIZE:=32768
+STACK_MIN:=8192
 
 else ifeq ($(CHIP),$(findstring $(CHIP), $(SAM4S)))
 
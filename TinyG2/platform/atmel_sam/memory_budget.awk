@@ -0,0 +1,37 @@
+#
+# memory_budget.awk - print the flash and SRAM budget of a linked image
+#
+# Usage: arm-none-eabi-size -A TinyG2.elf | awk -v rom=<bytes> -v ram=<bytes> [-v ram1=<bytes>] [-v stack_min=<bytes>] -f memory_budget.awk
+#
+# Section names are those of gcc_flash.ld. .ramfunc and .relocate are stored in flash
+# and copied to SRAM at startup, so they count against both. ram is the bank with the
+# statics and the stack, ram1 the bank .sram1 goes in (see SRAM_DMA in tinyg2.h). The
+# stack has whatever of ram the sections leave - the stack high-water mark 
+# ({"memsh":n}) says how much of that it has actually used.
+#
+
+$1 == ".text" || $1 == ".ARM.exidx"		{ flash += $2 }
+$1 == ".ramfunc"						{ ramfunc += $2; flash += $2; sram += $2 }
+$1 == ".relocate"						{ data += $2; flash += $2; sram += $2 }
+$1 == ".bss"							{ bss += $2; sram += $2 }
+$1 == ".sram1"							{ sram1 += $2 }
+$1 == ".stack_dummy"					{ stack += $2; sram += $2 }
+
+END {
+	print "--- MEMORY BUDGET ---"
+	if (rom > 0) {
+		printf("flash %7d of %7d bytes (%4.1f%%)\n", flash, rom, 100.0 * flash / rom)
+	}
+	if (ram > 0) {
+		printf("sram  %7d of %7d bytes (%4.1f%%): ramfunc %d, data %d, bss %d, stack %d\n",
+			   sram, ram, 100.0 * sram / ram, ramfunc, data, bss, stack)
+		printf("stack %7d bytes left between the statics and the top of sram\n", ram - sram + stack)
+		if (ram - sram + stack < stack_min) {
+			printf("WARNING: less than %d bytes left for the stack\n", stack_min)
+		}
+	}
+	if (ram1 > 0) {
+		printf("sram1 %7d of %7d bytes (%4.1f%%): DMA buffers and the planner pool\n",
+			   sram1, ram1, 100.0 * sram1 / ram1)
+	}
+}
@@ -35,6 +35,7 @@
 //#include "Reset.h"
 
 #include "tinyg2.h"
+#include "config.h"
 #include "xio.h"
 
 #ifdef __cplusplus
@@ -116,7 +117,8 @@ extern int _read(int file, char *ptr, int len)
 
 extern int _write( int file, char *ptr, int len )
 {
-	return SerialUSB.write((const uint8_t *)ptr, len);
+	return xio_write((const uint8_t *)ptr, len);	// queued - sent from the SysTick interrupt (see xio.cpp)
+//	return SerialUSB.write((const uint8_t *)ptr, len);
 
 /*
     int iIndex ;
@@ -0,0 +1,83 @@
+#
+# sim.mk - host simulator build: make PLATFORM=sim
+#
+# Copyright (c) 2013 Robert Giseburt
+# Copyright (c) 2013 Alden S. Hart Jr.
+#
+# This file is part of the TinyG2 project.
+#
+# This file ("the software") is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License, version 2 as published by the
+# Free Software Foundation. You should have received a copy of the GNU General Public
+# License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+#
+# THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+# WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+# OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+# SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+# OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+# Builds the firmware for the host with the host's g++. The files in SIM_REPLACED are
+# hardware drivers and are replaced by the ones in platform/sim - see platform/sim/sim.h.
+# Motate's Sam sources are left out; the Sim pins and timers are header only.
+#
+# SETTINGS=settings_xxx.h builds with that machine profile instead of the one chosen in
+# settings.h, into its own bin and build directories - see platform/sim/sim_bench.py.
+# AXES=3..6 builds with that many axes (see AXES in tinyg2.h), the same way.
+# EXPANSION_MOTORS=1..2 adds motors 7 and 8 (see Step expansion in stepper.h), the same way.
+#
+
+ifneq ("$(SETTINGS)","")
+	CPPFLAGS += -DSETTINGS_FILE='"settings/$(SETTINGS)"'
+	BIN := $(BIN)/$(basename $(SETTINGS))
+	OBJ := $(OBJ)/$(basename $(SETTINGS))
+endif
+
+ifneq ("$(AXES)","")
+	CPPFLAGS += -DAXES=$(AXES)
+	BIN := $(BIN)/axes$(AXES)
+	OBJ := $(OBJ)/axes$(AXES)
+endif
+
+ifneq ("$(EXPANSION_MOTORS)","")
+	CPPFLAGS += -DEXPANSION_MOTORS=$(EXPANSION_MOTORS)
+	BIN := $(BIN)/exp$(EXPANSION_MOTORS)
+	OBJ := $(OBJ)/exp$(EXPANSION_MOTORS)
+endif
+
+SIM_REPLACED = stepper.cpp xio.cpp xio_file.cpp persistence.cpp
+
+SIM_SOURCES  = $(filter-out $(SIM_REPLACED), $(wildcard *.cpp))
+SIM_SOURCES += $(wildcard platform/sim/*.cpp)
+SIM_OBJECTS  = $(addprefix $(OBJ)/,$(SIM_SOURCES:.cpp=.o))
+
+SIM_INCLUDES = -I. -Imotate -Iplatform/sim -Iplatform/atmel_sam
+
+CXX      ?= g++
+CPPFLAGS += -D__SIM -D__STEP_TRACE -g -O$(OPTIMIZATION) -fno-rtti -fno-exceptions $(SIM_INCLUDES)
+CPPFLAGS += -Wno-unused-parameter -Wno-unused-function -Wno-shadow -Wno-long-long
+DEPFLAGS  = -MMD -MP
+
+OUTPUT_BIN = $(BIN)/$(PROJECT)_sim
+
+all: $(OUTPUT_BIN)
+
+$(OUTPUT_BIN): $(SIM_OBJECTS)
+	@mkdir -p $(dir $@)
+	@echo $(START_BOLD)"Linking $@" $(END_BOLD)
+	$(QUIET)$(CXX) -o $@ $^ -lm
+
+$(OBJ)/%.o: %.cpp
+	@mkdir -p $(dir $@)
+	@echo $(START_BOLD)"Compiling cpp (sim) $<"; echo "    -> $@" $(END_BOLD)
+	$(QUIET)$(CXX) $(CPPFLAGS) $(DEPFLAGS) -c -o $@ $<
+
+clean:
+	-rm -fR $(OBJ) $(BIN)
+
+.PHONY: all clean
+
+-include $(SIM_OBJECTS:.o=.d)
+
+# *** EOF ***
@@ -0,0 +1,230 @@
+/*
+ * sim.h - host simulator platform
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ * Copyright (c) 2013 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* The simulator runs the firmware on the host: make PLATFORM=sim
+ *
+ *	The canonical machine, Gcode parser, planner, arcs and kinematics compile
+ *	unmodified. Underneath them sit the Sim Motate pins and timers, the stand-ins for
+ *	the CMSIS core functions and the few SAM registers used outside the drivers (this
+ *	file), and a simulated stepper backend that runs the prepped segments on simulated
+ *	time instead of stepping motors (sim_stepper.cpp). The console is stdio, there is
+ *	no file device and settings persist in RAM only (sim_xio.cpp, sim_persistence.cpp).
+ *
+ *	Usage: TinyG2_sim [-o trace.csv] [-p pass_us] [-q] [-s summary.json] [-t limit_s]
+ *					  [-x speed] [-P | file.gcode]
+ *
+ *	  -o	write the segment trace to a file instead of stdout
+ *	  -p	simulated time taken by a controller pass that reads a line (default
+ *			SIM_PASS_USEC). Sets how fast the planner is fed against the motion
+ *	  -q	drop the console output (responses and reports)
+ *	  -s	append a one line JSON summary of the run to a file (see sim_exit())
+ *	  -t	give up after this much simulated time, e.g. on a program that waits
+ *			for a cycle start. The summary has "timeout":1
+ *	  -x	hold simulated time to this many times real time (1 is real time)
+ *	  -P	put the console on a pseudo-terminal, in real time unless -x says
+ *			otherwise - see Pseudo-terminal console below
+ *
+ *	Input is read from the file (or stdin) as if streamed by a host that always has
+ *	the next line ready. Simulated time advances by the pass time when a pass reads a
+ *	line, and jumps straight to the next segment boundary or SysTick when it doesn't,
+ *	so a job runs as fast as the host can plan it. The simulator exits once the input
+ *	is done and the machine has stopped.
+ *
+ *	The trace has one CSV row per segment run by the "motors":
+ *
+ *	  time_us		segment start in simulated time
+ *	  dur_us		segment duration
+ *	  line			Gcode line number of the runtime when the segment was prepped
+ *	  type			a=aline, d=dwell
+ *	  velocity		axis space velocity over the segment (mm/min or deg/min)
+ *	  m1..m6		whole steps taken by each motor in the segment
+ *	  x..c			absolute axis position at the end of the segment
+ *
+ *	The time and velocity columns are the velocity profile of the job; the step
+ *	columns are what the DDA would have put out.
+ *
+ *	The exec and load timings ($isr) are in host nanoseconds, not cycles. They are
+ *	only good for comparing one build against another on the same host.
+ *
+ *	platform/sim/sim_bench.py runs the Gcode corpus against the settings profiles
+ *	and collects the summaries.
+ */
+/* Pseudo-terminal console
+ *	With -P the console is a pty instead of the input file and stderr, so a host 
+ *	sender can stream to the simulated machine as it would to the board's USB port -
+ *	the slave's name is printed at startup. The sender's lines arrive as the board 
+ *	would take them: SysTick moves what the sender has written into a receive ring of
+ *	XIO_RX_BUFFER_LEN, as far as it has room, and realtime characters are acted on as
+ *	they are taken (see Receive rings in xio.cpp). A sender that outruns the ring is 
+ *	held off by the pty, as USB flow control would hold it, and the footer's rx free 
+ *	count is the ring's. Output goes to the pty as it is flushed.
+ *
+ *	Simulated time is held to real time, so the sender sees the acknowledgements and
+ *	status reports at the rate the machine would send them, and its throughput, ack 
+ *	latency and flow control can be measured end to end. Passes that read a line still
+ *	take the pass time. The simulator holds the slave open itself, so senders can come
+ *	and go; output nobody reads backs up in the pty and stops the simulation when it 
+ *	fills, much as a host that stops reading stalls the board. It runs until -t or 
+ *	until interrupted (^C), and the summary has "rx_full_s", the time the ring was full.
+ *
+ *	The simulator's own messages go to the original stderr.
+ */
+#ifndef SIM_H_ONCE
+#define SIM_H_ONCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/**** Simulator ****/
+
+#define SIM_PASS_USEC 50			// default simulated time of a controller pass that reads a line
+#define SIM_NEVER UINT64_MAX		// no event pending
+
+typedef struct simSingleton {
+	uint64_t time;					// simulated time in nanoseconds
+	uint64_t pass_time;				// simulated time of a controller pass that reads a line (ns)
+	uint64_t tick_time;				// time of the next SysTick (ns)
+	uint64_t limit;					// simulated time to give up at (ns)
+	uint8_t line_read;				// set when input is taken during a pass
+	uint8_t input_done;				// the input has been read to the end
+	uint8_t timed_out;				// stopped at the time limit
+	volatile uint8_t interrupted;	// stopped by a signal
+	float speed;					// simulated time per real time - 0 runs flat out (-x)
+	int pty;						// pty master of the console - -1 if the input is a file (-P)
+	int pty_slave;					// the slave, held open between senders
+	FILE *input;					// Gcode input
+	FILE *log;						// the simulator's messages - stderr unless the console is a pty
+	FILE *trace;					// segment trace output
+	FILE *summary;					// run summary output, or NULL
+	uint32_t segments;				// segments run
+	uint32_t lines;					// input lines read
+	uint32_t rx_full_ticks;			// SysTicks the console's receive ring was full
+} simSingleton_t;
+
+extern simSingleton_t sim;
+
+void sim_init(int argc, char *argv[]);
+uint8_t sim_run(void);
+int sim_exit(void);
+
+// simulated stepper backend - see sim_stepper.cpp
+uint64_t st_sim_next_event(void);	// time the running segment ends, or SIM_NEVER
+void st_sim_event(void);			// end the running segment and load the next
+uint8_t st_sim_isbusy(void);		// TRUE if anything is running or prepped
+float st_sim_velocity(void);		// velocity of the running segment (mm/min) - 0 if none
+
+static inline uint64_t sim_host_ns(void)	// host clock - for timing the firmware's code
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return ((uint64_t)t.tv_sec * 1000000000 + t.tv_nsec);
+}
+
+/**** CMSIS stand-ins ****
+ *
+ *	There are no interrupts on the host. Everything that would run from one is called
+ *	directly by the simulator, so masking is a no-op. Priorities are kept so they can
+ *	be read back ($irq).
+ */
+
+typedef enum IRQn {
+	SysTick_IRQn	= -1,
+	PIOA_IRQn		= 11,
+	PIOB_IRQn		= 12,
+	PIOC_IRQn		= 13,
+	PIOD_IRQn		= 14,
+	TC0_IRQn		= 27,
+	PWM_IRQn		= 36,
+	UOTGHS_IRQn		= 40,
+	CAN0_IRQn		= 43,
+	SIM_IRQS		= 45
+} IRQn_Type;
+
+extern uint32_t sim_irq_priority[SIM_IRQS+1];
+
+static inline void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) { sim_irq_priority[irq+1] = priority;}
+static inline uint32_t NVIC_GetPriority(IRQn_Type irq) { return (sim_irq_priority[irq+1]);}
+static inline void NVIC_EnableIRQ(IRQn_Type irq) {}
+static inline void NVIC_DisableIRQ(IRQn_Type irq) {}
+static inline void NVIC_SetPendingIRQ(IRQn_Type irq) {}
+static inline void NVIC_ClearPendingIRQ(IRQn_Type irq) {}
+
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline uint32_t __get_PRIMASK(void) { return (0);}
+static inline void __set_PRIMASK(uint32_t primask) {}
+static inline void __WFI(void) {}	// the simulator moves time on after every pass anyway
+static inline void __NOP(void) {}
+static inline void __DSB(void) {}
+
+typedef struct {
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+extern CoreDebug_Type sim_core_debug;
+#define CoreDebug (&sim_core_debug)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+// DWT cycle counter - counts F_CPU clocks of simulated time (see hardware.h)
+extern volatile uint32_t sim_dwt_ctrl;
+extern volatile uint32_t sim_dwt_cyccnt;
+#define HW_DWT_CTRL		sim_dwt_ctrl
+#define HW_DWT_CYCCNT	sim_dwt_cyccnt
+
+// microsecond timebase - simulated time (see hardware.h)
+extern volatile uint32_t sim_timebase_cv;
+#define HW_TIMEBASE_CV	sim_timebase_cv
+
+/**** SAM register stand-ins ****
+ *
+ *	Only what pwm.cpp uses. The PWM and PMC registers are plain memory, so a channel 
+ *	reads back as disabled and the duty written last is in PWM_CDTYUPD.
+ */
+
+#define ID_PWM 36
+
+typedef struct {
+	volatile uint32_t PMC_PCER0;
+	volatile uint32_t PMC_PCER1;
+} Pmc;
+extern Pmc sim_pmc;
+#define PMC (&sim_pmc)
+
+typedef struct {
+	volatile uint32_t PWM_CMR;
+	volatile uint32_t PWM_CDTY;
+	volatile uint32_t PWM_CDTYUPD;
+	volatile uint32_t PWM_CPRD;
+	volatile uint32_t PWM_CPRDUPD;
+	volatile uint32_t PWM_CCNT;
+	volatile uint32_t PWM_DT;
+	volatile uint32_t PWM_DTUPD;
+} PwmCh_num;
+
+typedef struct {
+	volatile uint32_t PWM_ENA;
+	volatile uint32_t PWM_DIS;
+	volatile uint32_t PWM_SR;
+	PwmCh_num PWM_CH_NUM[8];
+} Pwm;
+extern Pwm sim_pwm;
+#define PWM (&sim_pwm)
+#define PWM_CMR_CPRE_Pos 0
+
+#endif // SIM_H_ONCE
@@ -0,0 +1,138 @@
+#!/usr/bin/env python
+#
+# sim_bench.py - cycle time benchmark over the Gcode corpus
+# This file is part of the TinyG2 project
+#
+# Copyright (c) 2013 Alden S. Hart, Jr.
+# Copyright (c) 2013 Robert Giseburt
+#
+# This file ("the software") is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License, version 2 as published by the
+# Free Software Foundation. You should have received a copy of the GNU General Public
+# License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+#
+# THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+# WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+# OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+# SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+# OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+"""Run every program in gcode/ on the simulator with every settings profile.
+
+Run from the TinyG2 directory:
+
+    python platform/sim/sim_bench.py [-o bench.json] [-s settings_xxx.h ...] [-g name ...]
+
+Each profile is built with make PLATFORM=sim SETTINGS=<profile>. Each string array in a
+gcode/*.h file is a program, named after the file (and the array, if the file has more
+than one). The results are written as one JSON document:
+
+    {"revision": ..., "profiles": {profile: "ok" or the build error},
+     "results": [{"profile", "program", <sim summary - see sim_exit()>,
+                  "passes_per_block", "pass_length"}, ...]}
+
+time_s is the predicted cycle time. exec_max_ns and exec_avg_ns are host times, so only
+compare them between runs on the same host. Diff two result files to compare revisions.
+"""
+
+import argparse
+import glob
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+from concurrent.futures import ThreadPoolExecutor
+
+SIM_LIMIT_S = 7200          # simulated seconds before a program is given up on
+WALL_LIMIT_S = 300          # host seconds before a run is killed
+
+
+def corpus(names):
+    """Return [(program, text)] for the string arrays in gcode/*.h"""
+    programs = []
+    for path in sorted(glob.glob('gcode/*.h')):
+        with open(path) as f:
+            source = f.read().replace('\r\n', '\n').replace('\\\n', '')    # line splices
+        source = re.sub(r'/\*.*?\*/', '', source, flags=re.S)              # comments
+        arrays = re.findall(r'(\w+)\s*\[\]\s*=\s*((?:"(?:\\.|[^"\\])*"\s*)+);', source)
+        stem = os.path.splitext(os.path.basename(path))[0].replace('gcode_', '', 1)
+        for array, literals in arrays:
+            text = ''.join(re.findall(r'"((?:\\.|[^"\\])*)"', literals))
+            text = re.sub(r'\\(.)', lambda m: {'n': '\n', 'r': '\r', 't': '\t'}.get(m.group(1), m.group(1)), text)
+            name = stem if len(arrays) == 1 else stem + ':' + array
+            if not names or stem in names or name in names:
+                programs.append((name, text))
+    return programs
+
+
+def build(profile):
+    """Build the simulator for a profile. Returns the binary, or None and the error"""
+    make = subprocess.run(['make', 'PLATFORM=sim', 'SETTINGS=' + profile, '-j%d' % os.cpu_count()],
+                          stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    if make.returncode != 0:
+        errors = [l for l in make.stdout.splitlines() if 'error' in l]
+        return None, (errors[0] if errors else 'build failed')
+    return os.path.join('bin', 'sim', os.path.splitext(profile)[0], 'TinyG2_sim'), None
+
+
+def run(binary, profile, program, text):
+    with tempfile.TemporaryDirectory() as tmp:
+        gcode = os.path.join(tmp, 'program.gcode')
+        summary = os.path.join(tmp, 'summary.json')
+        with open(gcode, 'w') as f:
+            f.write(text)
+        result = {'profile': profile, 'program': program}
+        try:
+            subprocess.run([binary, '-q', '-o', os.devnull, '-s', summary, '-t', str(SIM_LIMIT_S), gcode],
+                           timeout=WALL_LIMIT_S, check=True)
+            with open(summary) as f:
+                result.update(json.loads(f.read()))
+        except (subprocess.SubprocessError, OSError, ValueError) as e:
+            result['error'] = str(e)
+            return result
+    blocks = result['blocks']
+    result['passes_per_block'] = float(result['passes']) / blocks if blocks else 0.0
+    result['pass_length'] = float(result['pass_blocks']) / result['passes'] if result['passes'] else 0.0
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description='cycle time benchmark over the Gcode corpus')
+    parser.add_argument('-o', '--output', default='-', help='results file (default stdout)')
+    parser.add_argument('-s', '--settings', action='append', help='profile to run (default all)')
+    parser.add_argument('-g', '--gcode', action='append', help='program to run (default all)')
+    args = parser.parse_args()
+
+    profiles = args.settings or sorted(os.path.basename(p) for p in glob.glob('settings/settings_*.h'))
+    programs = corpus(args.gcode or [])
+    revision = subprocess.run(['git', 'describe', '--always', '--dirty'], stdout=subprocess.PIPE,
+                              universal_newlines=True).stdout.strip()
+    report = {'revision': revision, 'profiles': {}, 'results': []}
+
+    for profile in profiles:
+        binary, error = build(profile)
+        report['profiles'][profile] = error or 'ok'
+        if binary is None:
+            sys.stderr.write('%s: not built - %s\n' % (profile, error))
+            continue
+        with ThreadPoolExecutor(os.cpu_count()) as pool:
+            results = list(pool.map(lambda p: run(binary, profile, p[0], p[1]), programs))
+        for r in results:
+            if 'error' in r:
+                sys.stderr.write('%-24s %-32s %s\n' % (profile, r['program'], r['error']))
+            else:
+                sys.stderr.write('%-24s %-32s %10.3f s %7d blocks %5.2f passes/block %8.0f ns exec max%s\n' %
+                                 (profile, r['program'], r['time_s'], r['blocks'], r['passes_per_block'],
+                                  r['exec_max_ns'], ' (timeout)' if r['timeout'] else ''))
+        report['results'] += results
+
+    out = sys.stdout if args.output == '-' else open(args.output, 'w')
+    json.dump(report, out, indent=1, sort_keys=True)
+    out.write('\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,259 @@
+/*
+ * sim_main.cpp - host simulator: options, simulated time and exit
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ * Copyright (c) 2013 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* See sim.h for what the simulator does and how to run it. */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+
+#include "tinyg2.h"
+#include "config.h"
+#include "planner.h"
+#include "stepper.h"
+#include "hardware.h"
+#include "util.h"
+#include "MotateTimers.h"
+
+/**** Allocate structures ****/
+
+simSingleton_t sim;
+uint32_t sim_irq_priority[SIM_IRQS+1];
+CoreDebug_Type sim_core_debug;
+volatile uint32_t sim_dwt_ctrl;
+volatile uint32_t sim_dwt_cyccnt;
+volatile uint32_t sim_timebase_cv;
+Pwm sim_pwm;
+Pmc sim_pmc;
+
+namespace Motate {
+	volatile uint32_t Timer<SysTickTimerNum>::_motateTickCount = 0;
+	Timer<SysTickTimerNum> SysTickTimer;
+}
+
+#define SIM_NS_PER_TICK 1000000ULL		// SysTick is 1 ms
+
+static uint64_t sim_wall_start;			// host time at the start of the run
+
+static void _usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-o trace.csv] [-p pass_us] [-q] [-s summary.json] [-t limit_s] [-x speed] [-P | file.gcode]\n", name);
+	exit(2);
+}
+
+static void _interrupt(int sig) { sim.interrupted = true;}
+
+/*
+ * _open_pty() - put the console on a pseudo-terminal (see Pseudo-terminal console in sim.h)
+ *
+ *	The slave is raw, so nothing is echoed or translated. Its input and output go to
+ *	the master, which becomes stderr - the console output - once the simulator's 
+ *	messages have a copy of the old stderr to go to.
+ */
+static void _open_pty()
+{
+	if (((sim.pty = posix_openpt(O_RDWR | O_NOCTTY)) < 0) || (grantpt(sim.pty) != 0) || (unlockpt(sim.pty) != 0)) {
+		perror("pty");
+		exit(1);
+	}
+	const char *name = ptsname(sim.pty);
+	if ((sim.pty_slave = open(name, O_RDWR | O_NOCTTY)) < 0) {
+		perror(name);
+		exit(1);
+	}
+	struct termios raw;
+	tcgetattr(sim.pty_slave, &raw);
+	cfmakeraw(&raw);
+	tcsetattr(sim.pty_slave, TCSANOW, &raw);
+
+	if ((sim.log = fdopen(dup(STDERR_FILENO), "w")) == NULL) {
+		perror("stderr");
+		exit(1);
+	}
+	setvbuf(sim.log, NULL, _IONBF, 0);
+	dup2(sim.pty, STDERR_FILENO);
+	fprintf(sim.log, "sim: console on %s\n", name);
+}
+
+/*
+ * sim_init() - parse the options and open the input and trace
+ */
+void sim_init(int argc, char *argv[])
+{
+	const char *trace_file = NULL;
+	const char *summary_file = NULL;
+	int opt;
+
+	memset(&sim, 0, sizeof(sim));
+	sim.pass_time = SIM_PASS_USEC * 1000ULL;
+	sim.tick_time = SIM_NS_PER_TICK;
+	sim.limit = SIM_NEVER;
+	sim.input = stdin;
+	sim.trace = stdout;
+	sim.log = stderr;
+	sim.pty = -1;
+	sim.speed = -1;
+
+	while ((opt = getopt(argc, argv, "o:p:qs:t:x:P")) != -1) {
+		switch (opt) {
+			case 'o': { trace_file = optarg; break;}
+			case 'p': { sim.pass_time = (uint64_t)(atof(optarg) * 1000); break;}
+			case 'q': { if (freopen("/dev/null", "w", stderr) == NULL) { exit(1);} break;}
+			case 's': { summary_file = optarg; break;}
+			case 't': { sim.limit = (uint64_t)(atof(optarg) * 1000000000); break;}
+			case 'x': { sim.speed = atof(optarg); break;}
+			case 'P': { sim.pty = 0; break;}
+			default: _usage(argv[0]);
+		}
+	}
+	if (sim.pty == 0) {
+		if (optind < argc) { _usage(argv[0]);}
+		_open_pty();
+		sim.input = NULL;
+		if (sim.speed < 0) { sim.speed = 1;}
+	} else if (optind < argc) {
+		if ((sim.input = fopen(argv[optind], "r")) == NULL) {
+			perror(argv[optind]);
+			exit(1);
+		}
+	}
+	if (trace_file != NULL) {
+		if ((sim.trace = fopen(trace_file, "w")) == NULL) {
+			perror(trace_file);
+			exit(1);
+		}
+	}
+	if (summary_file != NULL) {
+		if ((sim.summary = fopen(summary_file, "a")) == NULL) {
+			perror(summary_file);
+			exit(1);
+		}
+	}
+	fprintf(sim.trace, "time_us,dur_us,line,type,velocity");
+	for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) { fprintf(sim.trace, ",m%d", motor+1);}
+	for (uint8_t i=0; i<AXES; i++) { fprintf(sim.trace, ",%c", "xyzabc"[i]);}
+	fprintf(sim.trace, "\n");
+	if (sim.speed < 0) { sim.speed = 0;}
+	signal(SIGINT, _interrupt);
+	signal(SIGTERM, _interrupt);
+	sim_wall_start = sim_host_ns();
+}
+
+/*
+ * sim_run() - move simulated time on after a controller pass
+ *
+ *	A pass that read a line took the pass time. A pass that didn't was idle, so time
+ *	jumps to the next thing that would wake the controller: the end of the running
+ *	segment or the next SysTick. Everything due by the new time is run in order.
+ *	With -x the host then sleeps until real time catches up. Returns false once the
+ *	input is done and the machine has stopped, at the time limit, or on a signal.
+ */
+static void _advance_to(uint64_t until)
+{
+	while (true) {
+		uint64_t segment = st_sim_next_event();
+		uint64_t next = min(segment, sim.tick_time);
+		if (next > until) break;
+		sim.time = next;
+		if (next == segment) {
+			st_sim_event();
+		} else {
+			sim.tick_time += SIM_NS_PER_TICK;
+			Motate::SysTickTimer._increment();
+			Motate::Timer<Motate::SysTickTimerNum>::interrupt();
+		}
+	}
+	sim.time = until;
+	sim_dwt_cyccnt = (uint32_t)(sim.time * (F_CPU / 1000000) / 1000);
+	sim_timebase_cv = (uint32_t)(sim.time / 1000);
+
+	if (sim.speed > 0) {
+		uint64_t due = sim_wall_start + (uint64_t)(sim.time / sim.speed);
+		uint64_t now = sim_host_ns();
+		if (due > now) {
+			struct timespec wait = { (time_t)((due - now) / 1000000000), (long)((due - now) % 1000000000) };
+			nanosleep(&wait, NULL);
+		}
+	}
+}
+
+uint8_t sim_run()
+{
+	if (sim.time >= sim.limit) {
+		sim.timed_out = true;
+		return (false);
+	}
+	if (sim.interrupted == true) { return (false);}
+	if (sim.line_read == true) {
+		sim.line_read = false;
+		_advance_to(sim.time + sim.pass_time);
+		return (true);
+	}
+	if ((sim.input_done == true) &&
+		(st_sim_isbusy() == false) &&
+		(mp_get_runtime_busy() == false) &&
+		(mp_get_planner_buffers_available() == PLANNER_BUFFER_POOL_SIZE)) {
+		return (false);
+	}
+	_advance_to(min(st_sim_next_event(), sim.tick_time));
+	return (true);
+}
+
+/*
+ * sim_exit() - close the trace and report the run
+ *
+ *	The summary (-s) is one JSON object per run:
+ *
+ *	  time_s		simulated time - the predicted cycle time of the program
+ *	  lines			input lines read
+ *	  blocks		blocks planned (mp_aline() calls, including arc segments)
+ *	  passes		planning passes (_plan_block_list() calls)
+ *	  pass_blocks	blocks visited by the planning passes
+ *	  segments		segments run
+ *	  exec_max_ns	longest mp_exec_move() on the host
+ *	  exec_avg_ns	average mp_exec_move() on the host
+ *	  underruns		times the loader was starved mid-move
+ *	  wall_s		host time for the run
+ *	  timeout		1 if the run was stopped at the time limit
+ *	  rx_full_s		simulated time the console's receive ring was full (-P)
+ */
+int sim_exit()
+{
+	double wall = (sim_host_ns() - sim_wall_start) / 1e9;
+	double simulated = sim.time / 1e9;
+
+	fflush(sim.trace);
+	if (sim.trace != stdout) { fclose(sim.trace);}
+	if (sim.summary != NULL) {
+		fprintf(sim.summary, "{\"time_s\":%.6f,\"lines\":%lu,\"blocks\":%lu,\"passes\":%lu,\"pass_blocks\":%lu,"
+				"\"segments\":%lu,\"exec_max_ns\":%lu,\"exec_avg_ns\":%.1f,\"underruns\":%lu,"
+				"\"wall_s\":%.3f,\"timeout\":%d,\"rx_full_s\":%.3f}\n",
+				simulated, (unsigned long)sim.lines, (unsigned long)mm.aline_count, (unsigned long)mm.plan_passes,
+				(unsigned long)mm.plan_blocks, (unsigned long)sim.segments, (unsigned long)st_isr.exec.max,
+				(st_isr.exec.count == 0) ? 0.0 : (double)st_isr.exec.sum / st_isr.exec.count,
+				(unsigned long)st_seg.underruns, wall, sim.timed_out, sim.rx_full_ticks / 1000.0);
+		fclose(sim.summary);
+	}
+	fprintf(sim.log, "sim: %.3f s simulated, %lu segments, %lu lines, %.3f s wall (%.0fx)\n",
+			simulated, (unsigned long)sim.segments, (unsigned long)sim.lines, wall,
+			(wall > 0) ? simulated / wall : 0.0);
+	return (0);
+}
@@ -0,0 +1,69 @@
+/*
+ * sim_persistence.cpp - persistence functions for the host simulator
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Stands in for persistence.cpp. Values are kept in RAM for the run of the simulator
+ * only, so every run starts from the compiled-in defaults.
+ */
+#include "tinyg2.h"
+#include "config.h"
+#include "persistence.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+static float nvm_value[NVM_INDEX_MAX];
+static uint8_t nvm_valid[NVM_INDEX_MAX];
+
+void persistence_init() {}
+stat_t persistence_callback() { return (STAT_NOOP);}
+
+stat_t read_persistent_value(cmdObj_t *cmd)
+{
+	if (cmd->index >= NVM_INDEX_MAX) return (STAT_INTERNAL_RANGE_ERROR);
+	if (nvm_valid[cmd->index] == false) return (STAT_NOOP);
+	cmd->value = nvm_value[cmd->index];
+	return (STAT_OK);
+}
+
+stat_t write_persistent_value(cmdObj_t *cmd)
+{
+	if (cmd->index >= NVM_INDEX_MAX) return (STAT_INTERNAL_RANGE_ERROR);
+	nvm_value[cmd->index] = cmd->value;
+	nvm_valid[cmd->index] = true;
+	return (STAT_OK);
+}
+
+uint32_t read_persistent_schema()
+{
+	uint32_t schema = 0;
+	if (nvm_valid[NVM_SCHEMA_INDEX]) {
+		memcpy(&schema, &nvm_value[NVM_SCHEMA_INDEX], sizeof(schema));
+	}
+	return (schema);
+}
+
+void write_persistent_schema(uint32_t schema)
+{
+	memcpy(&nvm_value[NVM_SCHEMA_INDEX], &schema, sizeof(schema));
+	nvm_valid[NVM_SCHEMA_INDEX] = true;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,854 @@
+/*
+ * sim_stepper.cpp - simulated stepper backend for the host simulator
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2010 - 2013 Alden S. Hart, Jr.
+ * Copyright (c) 2013 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Stands in for stepper.cpp and implements the whole of stepper.h. The exec and the
+ * prep ring work as they do on the board: mp_exec_move() fills the ring through the
+ * st_prep functions and segments are loaded from it in order. What would run from
+ * the exec and load interrupts is called directly, and a loaded segment "runs" until
+ * the simulator's clock reaches its end (see st_sim_event()). Each segment that ends
+ * is written to the trace - see sim.h for the columns.
+ *
+ * Steps are counted by accumulating the substeps of each motor and taking whole steps
+ * as they are crossed, which is what the DDA puts out less its phasing. Motors have
+ * no drivers here, so the power functions only keep the bookkeeping the config reads.
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "controller.h"
+#include "stepper.h"
+#include "planner.h"
+#include "hardware.h"
+#include "kinematics.h"
+#include "switch.h"
+#include "encoder.h"
+#include "event_log.h"
+#include "pwm.h"
+#include "text_parser.h"
+#include "util.h"
+
+/**** Allocate structures ****/
+
+stConfig_t st;
+stIsrTimingSingleton_t st_isr;
+stSegmentTelemetry_t st_seg;
+static stPrepSingleton_t st_prep;
+static stLatch_t st_latch[ST_LATCHES];
+
+#define SIM_NS_PER_TICK (1000000000ULL / FREQUENCY_DDA)
+
+typedef struct simStepperRun {
+	uint16_t magic_start;			// magic number to test memory integrity
+	uint8_t busy;					// a segment, dwell or axis move is running
+	uint8_t move_type;				// type of the running segment - 'a'line, 'd'well or 'h'oming
+	uint8_t underrun;				// true while the loader is starved mid-move (counted once)
+	volatile uint8_t halted;		// set by st_halt() - nothing more is loaded until reset
+	uint8_t motor_run;				// motors allowed to step: bit 0 = MOTOR_1
+	uint8_t exec_busy;				// the exec is running - a request only flags another pass
+	uint8_t exec_pending;			// the exec was requested while it ran
+	uint64_t start;					// simulated time the running segment started (ns)
+	uint64_t end;					// simulated time it ends (ns)
+	uint32_t dda_ticks;				// DDA ticks in the running segment
+	uint32_t line;					// runtime line number when the segment was prepped
+	uint32_t seq;					// planner buffers freed when the running segment was prepped
+	uint8_t outputs;				// digital outputs that are on: bit 0 = output 1
+	float position[AXES];			// absolute axis position at the end of the running segment
+	float travel[AXES];				// axis travel of the running segment
+	int32_t substeps[MOTORS];		// signed substeps of the running segment
+	int64_t motor_substeps[MOTORS];	// motor positions in substeps
+	uint8_t power_state[MOTORS];	// see motorPowerState
+} simStepperRun_t;
+static simStepperRun_t st_run;
+
+typedef struct simAxisMove {		// axis move engine - the move is run as one segment
+	int8_t direction;				// +1 or -1
+	uint8_t motor_mask;				// motors being stepped: bit 0 = MOTOR_1
+	uint32_t steps;					// steps in the move
+	float velocity;					// cruise velocity (steps per second)
+	float acceleration;				// steps per second^2
+} simAxisMove_t;
+static simAxisMove_t st_axis;
+
+static uint32_t prep_line[PREP_BUFFER_POOL_SIZE];	// runtime line number of each prepped segment
+
+static void _load_move(void);
+static void _request_exec(void);
+static uint8_t _next_prep_index(uint8_t index);
+static void _clear_isr_timing(void);
+static void _record_isr_time(stIsrTiming_t *t, const uint64_t start);
+
+/*
+ * stepper_init() - initialize stepper motor subsystem
+ */
+void stepper_init()
+{
+	memset(&st_run, 0, sizeof(st_run));
+	memset(&st_prep, 0, sizeof(st_prep));
+	memset(&st_axis, 0, sizeof(st_axis));
+	st_run.magic_start = MAGICNUM;
+	st_prep.magic_start = MAGICNUM;
+	st_run.motor_run = 0xFF;
+	_clear_isr_timing();
+
+	for (uint8_t i=0; i<PREP_BUFFER_POOL_SIZE; i++) {
+		st_prep.bf[i].move_type = MOVE_TYPE_NULL;
+		st_prep.bf[i].power = PREP_POWER_NONE;
+		st_prep.bf[i].exec_state = PREP_BUFFER_OWNED_BY_EXEC;
+	}
+}
+
+static void _clear_isr_timing()
+{
+	stIsrTiming_t *t = (stIsrTiming_t *)&st_isr;
+	for (uint8_t i=0; i < (sizeof(st_isr) / sizeof(stIsrTiming_t)); i++, t++) {
+		t->min = 0xFFFFFFFF;
+		t->max = 0;
+		t->count = 0;
+		t->sum = 0;
+	}
+}
+
+/*
+ * _record_isr_time() - record one sample given the starting host time (see sim.h)
+ */
+static void _record_isr_time(stIsrTiming_t *t, const uint64_t start)
+{
+	uint32_t ns = (uint32_t)(sim_host_ns() - start);
+	if (ns < t->min) t->min = ns;
+	if (ns > t->max) t->max = ns;
+	t->count++;
+	t->sum += ns;
+}
+
+void st_record_kinematics_time(const uint32_t start) {}
+
+stat_t st_assertions()
+{
+	if (st_run.magic_start  != MAGICNUM) return (STAT_MEMORY_FAULT);
+	if (st_prep.magic_start != MAGICNUM) return (STAT_MEMORY_FAULT);
+	return (STAT_OK);
+}
+
+uint8_t stepper_isbusy()
+{
+	if (st_run.busy == true) { return (true);}
+	return (st_prep.bf[st_prep.load_index].exec_state == PREP_BUFFER_OWNED_BY_LOADER);
+}
+
+uint8_t st_sim_isbusy() { return (stepper_isbusy());}
+
+/*
+ * Motor power - no drivers, so only the power states are kept
+ */
+void st_set_motor_power(const uint8_t motor) {}
+
+void st_energize_motors()
+{
+	for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) { st_run.power_state[motor] = MOTOR_RUNNING;}
+}
+
+void st_deenergize_motors()
+{
+	for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) { st_run.power_state[motor] = MOTOR_OFF;}
+}
+
+stat_t st_motor_power_callback() { return (STAT_NOOP);}
+
+/*
+ * st_halt()			- stop all stepping at once
+ * st_stop_motors()		- stop stepping the motors in motor_mask
+ * st_release_motors()	- let all motors step again
+ *
+ *	A halt ends the running segment where it is. Stopped motors take no more steps.
+ */
+void st_halt()
+{
+	st_run.halted = true;
+	if (st_run.busy == true) { st_run.end = sim.time;}
+	st_run.busy = false;
+}
+
+void st_stop_motors(const uint8_t motor_mask) { st_run.motor_run &= ~motor_mask;}
+void st_release_motors() { st_run.motor_run = 0xFF;}
+
+/*
+ * Position latch - see stepper.cpp
+ */
+void st_latch_position(const uint8_t latch)
+{
+	stLatch_t *l = &st_latch[latch];
+	if (l->latched == true) return;
+	l->ticks = st_run.dda_ticks;
+	l->ticks_left = (st_run.busy == true) ? (uint32_t)((st_run.end - sim.time) / SIM_NS_PER_TICK) : 0;
+	copy_axis_vector(l->position, st_run.position);
+	copy_axis_vector(l->travel, st_run.travel);
+	l->latched = true;
+}
+
+void st_clear_latch(const uint8_t latch) { st_latch[latch].latched = false;}
+
+uint8_t st_get_latched_position(const uint8_t latch, float position[])
+{
+	stLatch_t *l = &st_latch[latch];
+	if (l->latched == false) return (false);
+	float remaining = (l->ticks == 0) ? 0 : (float)l->ticks_left / (float)l->ticks;
+	for (uint8_t i=0; i<AXES; i++) {
+		position[i] = l->position[i] - l->travel[i] * remaining;
+	}
+	return (true);
+}
+
+void st_prep_position(const float position[], const float travel[])
+{
+	copy_axis_vector(st_prep.bf[st_prep.exec_index].position, position);
+	copy_axis_vector(st_prep.bf[st_prep.exec_index].travel, travel);
+}
+
+void st_prep_power(float power) { st_prep.bf[st_prep.exec_index].power = power;}
+
+void st_prep_outputs(const uint8_t on, const uint8_t off)
+{
+	st_prep.bf[st_prep.exec_index].outputs_on = on;
+	st_prep.bf[st_prep.exec_index].outputs_off = off;
+}
+
+void st_set_outputs(const uint8_t on, const uint8_t off) { st_run.outputs = (st_run.outputs & ~off) | on;}
+
+void st_prep_raster(const uint8_t pixels[], const uint16_t count, float first, float last)
+{
+	stPrepBuffer_t *sp = &st_prep.bf[st_prep.exec_index];
+	if (first < 0) { first = 0;}
+	if (first > count) { first = count;}
+	if (last < first) { last = first;}
+	uint16_t index = (uint16_t)first;
+	uint8_t n = min(count - index, ST_RASTER_PIXELS-1);
+	memcpy(sp->raster, &pixels[index], n);
+	sp->raster[n] = 0;
+	sp->raster_count = n+1;
+	sp->raster_phase = (uint32_t)((first - index) * 65536);
+	sp->raster_length = (uint32_t)((last - first) * 65536);
+}
+
+uint32_t st_get_motion_seq(uint32_t seq_prepped)
+{
+	if ((st_run.busy == false) &&
+		(st_prep.bf[st_prep.load_index].exec_state != PREP_BUFFER_OWNED_BY_LOADER)) {
+		return (seq_prepped);
+	}
+	return (st_run.seq);
+}
+
+#ifdef __AXIS_MOVE_ENGINE
+/*
+ * Axis move engine - the move runs as one segment for the time a constant
+ * acceleration profile takes. st_axis_stop() ends it at once.
+ */
+stat_t st_axis_move(const uint8_t motor_mask, const int32_t steps, const float velocity, const float acceleration)
+{
+	if (stepper_isbusy() == true) { return (STAT_INTERNAL_ERROR);
+	} else if ((steps == 0) || (motor_mask == 0)) { return (STAT_OK);
+	} else if ((velocity < EPSILON) || (acceleration < EPSILON)) { return (STAT_INPUT_VALUE_TOO_SMALL);
+	}
+	st_axis.motor_mask = motor_mask;
+	st_axis.direction = (steps < 0) ? -1 : 1;
+	st_axis.steps = (steps < 0) ? -steps : steps;
+	st_axis.velocity = velocity;
+	st_axis.acceleration = acceleration;
+
+	float ramp = velocity * velocity / acceleration;	// steps to accelerate and decelerate
+	float seconds;
+	if (ramp >= st_axis.steps) {
+		seconds = 2 * sqrt(st_axis.steps / acceleration);
+	} else {
+		seconds = 2 * velocity / acceleration + (st_axis.steps - ramp) / velocity;
+	}
+	for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) {
+		st_run.substeps[motor] = (motor_mask & (1<<motor)) ? steps * DDA_SUBSTEPS : 0;
+	}
+	for (uint8_t i=0; i<AXES; i++) { st_run.travel[i] = 0;}
+	st_run.move_type = 'h';
+	st_run.line = cm_get_linenum(RUNTIME);
+	st_run.dda_ticks = (uint32_t)(seconds * FREQUENCY_DDA);
+	st_run.start = sim.time;
+	st_run.end = sim.time + (uint64_t)(seconds * 1000000000);
+	st_run.busy = true;
+	return (STAT_OK);
+}
+
+void st_axis_stop()
+{
+	if ((st_run.busy == true) && (st_run.move_type == 'h')) {
+		uint64_t run = sim.time - st_run.start;		// steps are scaled to the time run
+		uint64_t total = st_run.end - st_run.start;
+		for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) {
+			st_run.substeps[motor] = (int32_t)(((int64_t)st_run.substeps[motor] * (int64_t)run) / (int64_t)total);
+		}
+		st_run.end = sim.time;
+	}
+}
+
+int32_t st_axis_get_steps()
+{
+	if ((st_run.busy == false) || (st_run.move_type != 'h')) { return ((int32_t)st_axis.steps * st_axis.direction);}
+	float done = (float)(sim.time - st_run.start) / (float)(st_run.end - st_run.start);
+	return ((int32_t)(st_axis.steps * done) * st_axis.direction);
+}
+#endif // __AXIS_MOVE_ENGINE
+
+/****************************************************************************************
+ * Exec sequencing - see stepper.cpp
+ * st_request_exec_move() - run the exec now, or make the background exec ready
+ * st_exec_callback()	  - background exec - fill the ring up to the fill target
+ * _request_exec()		  - run the exec now, or once more if it is already running
+ */
+static uint8_t _next_prep_index(uint8_t index)
+{
+	if (++index >= PREP_BUFFER_POOL_SIZE) index = 0;
+	return (index);
+}
+
+static stat_t _exec_segment()
+{
+	uint64_t start = sim_host_ns();
+	st_prep.bf[st_prep.exec_index].seq = mb.seq_freed;
+	stat_t status = mp_exec_move();
+	_record_isr_time(&st_isr.exec, start);
+	if (status == STAT_NOOP) { return (status);}
+	prep_line[st_prep.exec_index] = cm_get_linenum(RUNTIME);
+	st_prep.bf[st_prep.exec_index].exec_state = PREP_BUFFER_OWNED_BY_LOADER;
+	st_prep.exec_index = _next_prep_index(st_prep.exec_index);
+	if (st_run.busy == false) { _load_move();}
+	return (status);
+}
+
+static void _exec_move()
+{
+	while (st_prep.bf[st_prep.exec_index].exec_state == PREP_BUFFER_OWNED_BY_EXEC) {
+		if (_exec_segment() == STAT_NOOP) break;
+	}
+}
+
+static uint8_t _prep_fill()
+{
+	uint8_t fill = 0;
+	for (uint8_t i=0; i<PREP_BUFFER_POOL_SIZE; i++) {
+		if (st_prep.bf[i].exec_state == PREP_BUFFER_OWNED_BY_LOADER) { fill++;}
+	}
+	return (fill);
+}
+
+void st_request_exec_move()
+{
+	if (st.exec_mode == EXEC_BACKGROUND) {
+		controller_set_ready(CTL_TASK_EXEC);
+		return;
+	}
+	_request_exec();
+}
+
+stat_t st_exec_callback()
+{
+	if (st.exec_mode != EXEC_BACKGROUND) { return (STAT_NOOP);}
+	st_prep.exec_busy = true;
+	while ((_prep_fill() < st.exec_fill) &&
+		   (st_prep.bf[st_prep.exec_index].exec_state == PREP_BUFFER_OWNED_BY_EXEC)) {
+		if (_exec_segment() == STAT_NOOP) break;
+	}
+	st_prep.exec_busy = false;
+	return (STAT_NOOP);
+}
+
+static void _request_exec()
+{
+	if (st_prep.bf[st_prep.exec_index].exec_state != PREP_BUFFER_OWNED_BY_EXEC) return;
+	if (st.exec_mode == EXEC_BACKGROUND) {		// rescue a starved loader with one segment
+		if ((st_prep.exec_busy == true) || (st_run.exec_busy == true)) return;
+		st_run.exec_busy = true;
+		if (_exec_segment() != STAT_NOOP) {
+			st_seg.rescues++;
+			st_seg.rescue_line = cm_get_linenum(RUNTIME);
+			controller_set_ready(CTL_TASK_EXEC);
+		}
+		st_run.exec_busy = false;
+		return;
+	}
+	if (st_run.exec_busy == true) {
+		st_run.exec_pending = true;
+		return;
+	}
+	st_run.exec_busy = true;
+	do {
+		st_run.exec_pending = false;
+		_exec_move();
+	} while (st_run.exec_pending == true);
+	st_run.exec_busy = false;
+}
+
+/****************************************************************************************
+ * Load sequencing
+ * _load_move()			- start the next prepped segment at the current simulated time
+ * st_sim_next_event()	- time the running segment ends
+ * st_sim_event()		- end the running segment, trace it and load the next
+ */
+static void _load_move()
+{
+	while (st_run.busy == false) {
+		if (st_run.halted == true) return;
+#ifdef __ENCODERS
+		for (uint8_t i=0; i<ENCODERS; i++) {
+			if (en.en[i].motor != 0) { en_sample(i, st_run.motor_substeps[en.en[i].motor-1]);}
+		}
+#endif
+		stPrepBuffer_t *sp = &st_prep.bf[st_prep.load_index];
+		if (sp->exec_state != PREP_BUFFER_OWNED_BY_LOADER) {
+			if ((mr.move_state > MOVE_STATE_NEW) && (st_run.underrun == false)) {
+				st_run.underrun = true;
+				st_seg.underruns++;
+				st_seg.underrun_line = cm_get_linenum(RUNTIME);
+				ev_record(EV_UNDERRUN, st_seg.underrun_line, 0);
+			} else if (mr.move_state <= MOVE_STATE_NEW) {
+				pwm_set_power(PWM_1, 0);
+				controller_signal(CTL_EVENT_MOTION_STOP);
+			}
+			if (mr.move_state > MOVE_STATE_NEW) {
+				_request_exec();					// even in background mode
+			} else {
+				st_request_exec_move();
+			}
+			return;
+		}
+		st_run.underrun = false;
+		st_run.seq = sp->seq;
+		st_run.line = prep_line[st_prep.load_index];
+		if ((sp->raster_count != 0) && (fp_NE(sp->power, PREP_POWER_NONE))) {	// no DDA ticks - the segment
+			pwm_start_raster(PWM_1, sp->power);							// ...runs its first pixel
+			pwm_set_raster(PWM_1, sp->raster[sp->raster_phase >> 16]);
+		} else if (fp_NE(sp->power, PREP_POWER_NONE)) { pwm_set_power(PWM_1, sp->power);}
+		if ((sp->outputs_on | sp->outputs_off) != 0) { st_set_outputs(sp->outputs_on, sp->outputs_off);}
+
+		if (sp->move_type == MOVE_TYPE_ALINE) {
+			for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) {
+				int32_t substeps = (int32_t)sp->m[motor].phase_increment;
+				if (sp->m[motor].dir ^ st.m[motor].polarity) { substeps = -substeps;}
+				st_run.substeps[motor] = (st_run.motor_run & (1<<motor)) ? substeps : 0;
+			}
+			copy_axis_vector(st_run.position, sp->position);
+			copy_axis_vector(st_run.travel, sp->travel);
+			st_run.move_type = 'a';
+			st_run.dda_ticks = sp->dda_ticks;
+			st_run.start = sim.time;
+			st_run.end = sim.time + ((uint64_t)sp->dda_ticks << sp->dda_rate_shift) * SIM_NS_PER_TICK;
+			st_run.busy = true;
+
+		} else if (sp->move_type == MOVE_TYPE_DWELL) {
+			for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) { st_run.substeps[motor] = 0;}
+			for (uint8_t i=0; i<AXES; i++) { st_run.travel[i] = 0;}
+			st_run.move_type = 'd';
+			st_run.dda_ticks = sp->dda_ticks;
+			st_run.start = sim.time;
+			st_run.end = sim.time + ((uint64_t)sp->dda_ticks << sp->dda_rate_shift) * SIM_NS_PER_TICK;
+			st_run.busy = true;
+		}
+#ifdef __STEP_TRACE
+		if (sp->move_type != MOVE_TYPE_NULL) { st_trace_segment(sp);}
+#endif
+		sp->move_type = MOVE_TYPE_NULL;
+		sp->power = PREP_POWER_NONE;
+		sp->outputs_on = 0;
+		sp->outputs_off = 0;
+		sp->raster_count = 0;
+		sp->exec_state = PREP_BUFFER_OWNED_BY_EXEC;
+		st_prep.load_index = _next_prep_index(st_prep.load_index);
+		st_request_exec_move();
+	}
+}
+
+uint64_t st_sim_next_event()
+{
+	return ((st_run.busy == true) ? st_run.end : SIM_NEVER);
+}
+
+float st_sim_velocity()
+{
+	uint64_t duration = st_run.end - st_run.start;
+	if ((st_run.busy == false) || (st_run.move_type != 'a') || (duration == 0)) { return (0);}
+	float length = 0;
+	for (uint8_t i=0; i<AXES; i++) { length += square(st_run.travel[i]);}
+	return (sqrt(length) / ((float)duration / 60000000000.0));
+}
+
+static void _trace_segment()
+{
+	uint64_t duration = st_run.end - st_run.start;
+	float velocity = st_sim_velocity();
+
+	fprintf(sim.trace, "%.3f,%.3f,%lu,%c,%.3f", (double)st_run.start / 1000, (double)duration / 1000,
+			(unsigned long)st_run.line, st_run.move_type, (double)velocity);
+	for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) {
+		int64_t before = st_run.motor_substeps[motor] / DDA_SUBSTEPS;
+		st_run.motor_substeps[motor] += st_run.substeps[motor];
+		fprintf(sim.trace, ",%ld", (long)(st_run.motor_substeps[motor] / DDA_SUBSTEPS - before));
+	}
+	for (uint8_t i=0; i<AXES; i++) {
+		fprintf(sim.trace, ",%.4f", (double)st_run.position[i]);
+	}
+	fprintf(sim.trace, "\n");
+}
+
+void st_sim_event()
+{
+	if (st_run.busy == false) return;
+	if (st_run.move_type != 'h') { _trace_segment();}	// axis moves don't move the runtime position
+	sim.segments++;
+	st_run.busy = false;
+	if (st_run.move_type == 'h') {
+		controller_signal(CTL_EVENT_MOTION_STOP);
+		return;
+	}
+	_load_move();
+}
+
+/*
+ * st_prep_null()	- keeps the loader happy. Otherwise performs no action
+ * st_prep_dwell()	- add a dwell to the move buffer
+ * st_prep_line()	- prepare the next move for the loader
+ * st_prep_line_substeps() - fixed-point version of st_prep_line()
+ * st_prep_ticks()	- segment time in DDA ticks for st_prep_line_substeps()
+ *
+ *	As stepper.cpp, less the step stream and power work the simulator doesn't need. The
+ *	DDA rate and accumulator resets are kept so the step trace matches the board's.
+ */
+void st_prep_null()
+{
+	st_prep.bf[st_prep.exec_index].move_type = MOVE_TYPE_NULL;
+}
+
+void st_prep_dwell(float microseconds)
+{
+	stPrepBuffer_t *sp = &st_prep.bf[st_prep.exec_index];
+	sp->move_type = MOVE_TYPE_DWELL;
+	sp->power = 0;
+	sp->reset_flag = false;
+	sp->dda_rate_shift = DDA_RATE_SHIFT_MAX;
+	sp->dda_ticks = (uint32_t)((microseconds/1000000) * (FREQUENCY_DDA >> DDA_RATE_SHIFT_MAX) + 0.5);
+}
+
+stat_t st_prep_line(float steps[], float microseconds)
+{
+	if (isfinite(microseconds) == false) { return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
+	} else if (microseconds < EPSILON) { return (STAT_MINIMUM_TIME_MOVE_ERROR);
+	}
+	int32_t substeps[MOTORS];
+	float residual[MOTORS];
+	for (uint8_t i=0; i<MOTORS; i++) {
+		float exact = steps[i] * DDA_SUBSTEPS + st_prep.residual[i];
+		if (fabs(exact) > DDA_SUBSTEPS_LIMIT) { return (STAT_INPUT_EXCEEDS_MAX_LENGTH);}
+		substeps[i] = (int32_t)exact;
+		residual[i] = exact - substeps[i];
+	}
+	stat_t status = st_prep_line_substeps(substeps, st_prep_ticks(microseconds));
+	if (status == STAT_OK) {
+		for (uint8_t i=0; i<MOTORS; i++) { st_prep.residual[i] = residual[i];}
+	}
+	return (status);
+}
+
+uint32_t st_prep_ticks(float microseconds)
+{
+	if ((isfinite(microseconds) == false) || (microseconds < EPSILON)) { return (0);}
+	return ((uint32_t)(microseconds * DDA_TICKS_PER_USEC));
+}
+
+stat_t st_prep_line_substeps(int32_t substeps[], uint32_t ticks)
+{
+	stPrepBuffer_t *sp = &st_prep.bf[st_prep.exec_index];
+
+	if (sp->exec_state != PREP_BUFFER_OWNED_BY_EXEC) { return (STAT_INTERNAL_ERROR);
+	} else if (ticks == 0) { return (STAT_MINIMUM_TIME_MOVE_ERROR);
+	}
+	sp->reset_flag = false;
+	uint32_t max_substeps = 0;
+	for (uint8_t i=0; i<MOTORS; i++) {
+		sp->m[i].dir = ((substeps[i] < 0) ? 1 : 0) ^ st.m[i].polarity;
+		sp->m[i].phase_increment = (substeps[i] < 0) ? -substeps[i] : substeps[i];
+		if (sp->m[i].phase_increment > max_substeps) { max_substeps = sp->m[i].phase_increment;}
+	}
+	uint64_t min_ticks_X_substeps = (uint64_t)max_substeps * DDA_MIN_TICKS_PER_STEP;
+	uint8_t shift = 0;
+	while ((shift < DDA_RATE_SHIFT_MAX) && 
+		   (((uint64_t)(ticks >> (shift+1)) * DDA_SUBSTEPS) > min_ticks_X_substeps)) {
+		shift++;
+	}
+	sp->dda_rate_shift = shift;
+	sp->dda_ticks = ticks >> shift;
+	if (((sp->dda_ticks << shift) * ACCUMULATOR_RESET_FACTOR) < st_prep.prev_ticks) {
+		sp->reset_flag = true;
+		st_seg.resets++;
+		st_seg.reset_line = cm_get_linenum(RUNTIME);
+	}
+	st_prep.prev_ticks = sp->dda_ticks << shift;
+	sp->move_type = MOVE_TYPE_ALINE;
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table - as stepper.cpp
+ ***********************************************************************************/
+
+static int8_t _get_motor(const index_t index)
+{
+	char_t *ptr;
+	char_t motors[] = {"12345678"};
+	char_t tmp[CMD_TOKEN_LEN+1];
+
+	strcpy_P(tmp, cfgTokens[index].group);
+	if ((ptr = strchr(motors, tmp[0])) == NULL) {
+		return (-1);
+	}
+	return (ptr - motors);
+}
+
+static void _set_motor_steps_per_unit(cmdObj_t *cmd)
+{
+	uint8_t m = _get_motor(cmd->index);
+	st.m[m].steps_per_unit = (360 / (st.m[m].step_angle / st.m[m].microsteps) / st.m[m].travel_rev);
+	ik_update_motor_map();
+}
+
+stat_t st_set_ma(cmdObj_t *cmd)
+{
+	set_ui8(cmd);
+	ik_update_motor_map();
+	return(STAT_OK);
+}
+
+stat_t st_set_sa(cmdObj_t *cmd)
+{
+	set_flt(cmd);
+	_set_motor_steps_per_unit(cmd);
+	return(STAT_OK);
+}
+
+stat_t st_set_tr(cmdObj_t *cmd)
+{
+	set_flu(cmd);
+	_set_motor_steps_per_unit(cmd);
+	return(STAT_OK);
+}
+
+stat_t st_set_mi(cmdObj_t *cmd)
+{
+	if (fp_NE(cmd->value,1) && fp_NE(cmd->value,2) && fp_NE(cmd->value,4) && fp_NE(cmd->value,8)) {
+		cmd_add_conditional_message((const char_t *)"*** WARNING *** Setting non-standard microstep value");
+	}
+	set_ui8(cmd);
+	_set_motor_steps_per_unit(cmd);
+	return (STAT_OK);
+}
+
+stat_t st_set_pm(cmdObj_t *cmd)
+{
+	if (cmd->value > DYNAMIC_MOTOR_POWER) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	return (set_ui8(cmd));
+}
+
+stat_t st_set_pl(cmdObj_t *cmd)
+{
+	if (cmd->value < 0) { return (STAT_INPUT_VALUE_TOO_SMALL);}
+	if (cmd->value > 1) { return (STAT_INPUT_VALUE_TOO_LARGE);}
+	return (set_flt(cmd));
+}
+
+stat_t st_set_gs(cmdObj_t *cmd)
+{
+	if (cmd->value > (SW_PAIRS * SW_POSITIONS)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	return (set_ui8(cmd));
+}
+
+stat_t st_set_mt(cmdObj_t *cmd)
+{
+	st.motor_idle_timeout = min(IDLE_TIMEOUT_SECONDS_MAX, max(cmd->value, IDLE_TIMEOUT_SECONDS_MIN));
+	return (STAT_OK);
+}
+
+stat_t st_set_md(cmdObj_t *cmd)
+{
+	st_deenergize_motors();
+	return (STAT_OK);
+}
+
+stat_t st_set_me(cmdObj_t *cmd)
+{
+	st_energize_motors();
+	return (STAT_OK);
+}
+
+/*
+ * st_get_motor_position() - motor position in substeps at the end of the loaded segment
+ * st_get_mp() - get motor position to the nearest whole step
+ */
+int64_t st_get_motor_position(const uint8_t motor)
+{
+	int64_t position = st_run.motor_substeps[motor];
+	if ((st_run.busy == true) && (st_run.move_type == 'a')) { position += st_run.substeps[motor];}
+	return (position);
+}
+
+stat_t st_get_mp(cmdObj_t *cmd)
+{
+	int64_t position = st_get_motor_position(_get_motor(cmd->index));
+	position += (position < 0) ? -(DDA_SUBSTEPS/2) : (DDA_SUBSTEPS/2);	// nearest whole step
+	cmd->value = (float)(position / DDA_SUBSTEPS);
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+static void _get_isr_timing(cmdObj_t *cmd, stIsrTiming_t *t)
+{
+	memcpy(t, (stIsrTiming_t *)GET_TABLE_WORD(target), sizeof(stIsrTiming_t));
+	cmd->objtype = TYPE_INTEGER;
+}
+
+stat_t st_get_isrn(cmdObj_t *cmd)
+{
+	stIsrTiming_t t;
+	_get_isr_timing(cmd, &t);
+	cmd->value = (t.count == 0) ? 0 : (float)t.min;
+	return (STAT_OK);
+}
+
+stat_t st_get_isrx(cmdObj_t *cmd)
+{
+	stIsrTiming_t t;
+	_get_isr_timing(cmd, &t);
+	cmd->value = (float)t.max;
+	return (STAT_OK);
+}
+
+stat_t st_get_isra(cmdObj_t *cmd)
+{
+	stIsrTiming_t t;
+	_get_isr_timing(cmd, &t);
+	cmd->value = (t.count == 0) ? 0 : (float)(t.sum / t.count);
+	return (STAT_OK);
+}
+
+stat_t st_set_isrz(cmdObj_t *cmd)
+{
+	_clear_isr_timing();
+	return (STAT_OK);
+}
+
+stat_t st_set_exm(cmdObj_t *cmd)
+{
+	if ((cmd->value < EXEC_INTERRUPT) || (cmd->value > EXEC_BACKGROUND)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	st_request_exec_move();
+	return (STAT_OK);
+}
+
+stat_t st_set_exf(cmdObj_t *cmd)
+{
+	if ((cmd->value < 1) || (cmd->value > PREP_BUFFER_POOL_SIZE)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	return (STAT_OK);
+}
+
+stat_t st_set_dsu(cmdObj_t *cmd)					// no direction lines - kept for the config
+{
+	if ((cmd->value < 0) || (cmd->value > ST_DIR_SETUP_MAX)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_flt(cmd);
+	return (STAT_OK);
+}
+
+stat_t st_set_segz(cmdObj_t *cmd)
+{
+	memset(&st_seg, 0, sizeof(st_seg));
+	mp_reset_exec_budget();
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char msg_units0[] PROGMEM = " in";
+static const char msg_units1[] PROGMEM = " mm";
+static const char msg_units2[] PROGMEM = " deg";
+static const char *const msg_units[] PROGMEM = { msg_units0, msg_units1, msg_units2 };
+#define DEGREE_INDEX 2
+
+static const char fmt_mt[] PROGMEM = "[mt]  motor idle timeout%14.2f Sec\n";
+static const char fmt_me[] PROGMEM = "motors energized\n";
+static const char fmt_md[] PROGMEM = "motors de-energized\n";
+static const char fmt_0ma[] PROGMEM = "[%s%s] m%s map to axis%15d [0=X,1=Y,2=Z...]\n";
+static const char fmt_0sa[] PROGMEM = "[%s%s] m%s step angle%20.3f%s\n";
+static const char fmt_0tr[] PROGMEM = "[%s%s] m%s travel per revolution%9.3f%s\n";
+static const char fmt_0mi[] PROGMEM = "[%s%s] m%s microsteps%16d [1,2,4,8]\n";
+static const char fmt_0po[] PROGMEM = "[%s%s] m%s polarity%18d [0=normal,1=reverse]\n";
+static const char fmt_0pm[] PROGMEM = "[%s%s] m%s power management%10d [0=remain powered,1=power down when idle,2=reduce when idle,3=dynamic]\n";
+static const char fmt_0pl[] PROGMEM = "[%s%s] m%s power level%19.3f [0..1]\n";
+static const char fmt_0pi[] PROGMEM = "[%s%s] m%s idle power level%14.3f [0..1]\n";
+static const char fmt_0gs[] PROGMEM = "[%s%s] m%s gantry switch%13d [0=axis switch,1=xmin,2=xmax,3=ymin...]\n";
+static const char fmt_0mp[] PROGMEM = "[%s%s] m%s position%18.0f steps\n";
+static const char fmt_isr[] PROGMEM = "[isr%s] %lu cycles\n";
+static const char fmt_seg[] PROGMEM = "[seg%s] %lu\n";
+static const char fmt_exm[] PROGMEM = "[exm] exec mode%20d [0=interrupt,1=background]\n";
+static const char fmt_exf[] PROGMEM = "[exf] exec fill target%13d segments\n";
+static const char fmt_dsu[] PROGMEM = "[dsu] direction setup time%13.1f uSec\n";
+
+void st_print_mt(cmdObj_t *cmd) { text_print_flt(cmd, fmt_mt);}
+void st_print_me(cmdObj_t *cmd) { text_print_nul(cmd, fmt_me);}
+void st_print_md(cmdObj_t *cmd) { text_print_nul(cmd, fmt_md);}
+
+static void _print_motor_ui8(cmdObj_t *cmd, const char *format)
+{
+	fprintf_P(stderr, format, cmd->group, cmd->token, cmd->group, (uint8_t)cmd->value);
+}
+
+static void _print_motor_flt(cmdObj_t *cmd, const char *format)
+{
+	fprintf_P(stderr, format, cmd->group, cmd->token, cmd->group, cmd->value);
+}
+
+static void _print_motor_flt_units(cmdObj_t *cmd, const char *format, uint8_t units)
+{
+	fprintf_P(stderr, format, cmd->group, cmd->token, cmd->group, cmd->value, GET_TEXT_ITEM(msg_units, units));
+}
+
+void st_print_ma(cmdObj_t *cmd) { _print_motor_ui8(cmd, fmt_0ma);}
+void st_print_sa(cmdObj_t *cmd) { _print_motor_flt_units(cmd, fmt_0sa, DEGREE_INDEX);}
+void st_print_tr(cmdObj_t *cmd) { _print_motor_flt_units(cmd, fmt_0tr, cm_get_units_mode(MODEL));}
+void st_print_mi(cmdObj_t *cmd) { _print_motor_ui8(cmd, fmt_0mi);}
+void st_print_po(cmdObj_t *cmd) { _print_motor_ui8(cmd, fmt_0po);}
+void st_print_pm(cmdObj_t *cmd) { _print_motor_ui8(cmd, fmt_0pm);}
+void st_print_gs(cmdObj_t *cmd) { _print_motor_ui8(cmd, fmt_0gs);}
+void st_print_pl(cmdObj_t *cmd) { _print_motor_flt(cmd, fmt_0pl);}
+void st_print_pi(cmdObj_t *cmd) { _print_motor_flt(cmd, fmt_0pi);}
+void st_print_mp(cmdObj_t *cmd) { _print_motor_flt(cmd, fmt_0mp);}
+void st_print_isr(cmdObj_t *cmd) { fprintf_P(stderr, fmt_isr, cmd->token, (unsigned long)cmd->value);}
+void st_print_seg(cmdObj_t *cmd) { fprintf_P(stderr, fmt_seg, cmd->token, (unsigned long)cmd->value);}
+void st_print_exm(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_exm);}
+void st_print_exf(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_exf);}
+void st_print_dsu(cmdObj_t *cmd) { text_print_flt(cmd, fmt_dsu);}
+
+#endif // __TEXT_MODE
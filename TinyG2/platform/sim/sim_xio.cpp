@@ -0,0 +1,258 @@
+/*
+ * sim_xio.cpp - extended IO functions for the host simulator
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart Jr.
+ * Copyright (c) 2013 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Stands in for xio.cpp and xio_file.cpp. The console reads the simulator's input
+ * (see sim.h) and writes to the host's stderr, which is the pty with -P. There is one
+ * console device and no file device - $fl and $fr answer as they do with no flash 
+ * fitted.
+ */
+#include <poll.h>
+#include <unistd.h>
+
+#include "tinyg2.h"
+#include "config.h"
+#include "text_parser.h"
+#include "xio.h"
+#include "xio_file.h"
+#include "xio_lz.h"
+#include "canonical_machine.h"
+#include "hardware.h"
+#include "switch.h"
+#include "can.h"
+#include "MotateTimers.h"
+
+xioSingleton_t xio;
+xioFileSingleton_t xf;
+
+void xio_init()
+{
+	xio.console = XIO_CONSOLE_DEVICE;
+	xio.console_next = XIO_CONSOLE_DEVICE;
+}
+
+void xio_flush_output() { fflush(stderr);}
+
+void xio_set_stdin(const uint8_t dev) {}
+void xio_set_stdout(const uint8_t dev) {}
+void xio_set_stderr(const uint8_t dev) {}
+bool xio_is_connected() { return (true);}
+
+/*
+ * read_char() - returns single char or -1 (_FDEV_ERR) is none available
+ * read_line() - read a complete line from the input - see xio.cpp for returns
+ *
+ *	The input file always has the next line ready until it runs out, when STAT_EAGAIN 
+ *	is returned as it would be by a console with nothing waiting. Realtime characters
+ *	are acted on as they are read and never reach the line. Compressed input (see
+ *	xio_lz.h) is decoded as it is read.
+ *
+ *	A pty console is read from a receive ring that SysTick fills (see _pty_rx_fill()).
+ */
+static cmJogFrame_t jog_frame;
+
+static struct simRxRing {				// pty receive ring - as xio.cpp's
+	uint16_t head;						// next slot to fill - SysTick only
+	uint16_t tail;						// next character to hand out - foreground only
+	uint8_t buf[XIO_RX_BUFFER_LEN];
+} rx;
+
+static uint8_t _xio_realtime_char(int c)	// returns true if c was a realtime character
+{
+	if ((c != _FDEV_ERR) && (cm_jog_frame(&jog_frame, (uint8_t)c) == true)) { return (true);}
+	switch (c) {
+		case '!': { cm_request_feedhold(); can_sync_event(CAN_SYNC_HOLD); return (true);}
+		case '~': { cm_request_cycle_start(); can_sync_event(CAN_SYNC_START); return (true);}
+		case CAN: { hw_request_hard_reset(); return (true);}
+	}
+	return (false);
+}
+
+int read_char (void)
+{
+	if (sim.pty >= 0) {
+		if (rx.tail == rx.head) { return (_FDEV_ERR);}
+		uint8_t c = rx.buf[rx.tail];
+		rx.tail = (rx.tail + 1) & (XIO_RX_BUFFER_LEN-1);
+		sim.line_read = true;
+		return (c);
+	}
+	if (sim.input_done == true) { return (_FDEV_ERR);}
+	int c = getc(sim.input);
+	if (c == EOF) {
+		sim.input_done = true;
+		return (_FDEV_ERR);
+	}
+	sim.line_read = true;
+	return (c);
+}
+
+static int _read_text()					// the next character of text - decoded if compressed
+{
+	if ((xz.window == 0) || (sim.pty >= 0)) { return (read_char());}	// the pty ring is decoded
+
+	int c;
+	while ((c = xio_lz_get()) == _FDEV_ERR) {
+		int code = read_char();
+		if (code == _FDEV_ERR) { return (_FDEV_ERR);}
+		xio_lz_put((uint8_t)code);
+	}
+	return (c);
+}
+
+stat_t read_line (uint8_t *buffer, uint16_t *index, size_t size)
+{
+	if (*index >= size) { return (STAT_FILE_SIZE_EXCEEDED);}
+	if (sim.input_done == true) { return (STAT_EAGAIN);}
+
+	while (*index < size) {
+		int c = _read_text();
+		if (c == _FDEV_ERR) {
+			if ((*index == 0) || (sim.pty >= 0)) { return (STAT_EAGAIN);}
+			c = LF;								// the last line needs no terminator
+		}
+		if ((sim.pty < 0) && (_xio_realtime_char(c) == true)) { continue;}	// the ring has none
+		if ((c == LF) || (c == CR)) {
+			buffer[*index] = NUL;
+			sim.lines++;
+			return (STAT_OK);
+		}
+		buffer[(*index)++] = (uint8_t)c;
+	}
+	return (STAT_BUFFER_FULL);
+}
+
+/*
+ * Output - stdio goes straight to the host, so nothing is ever backed up. A pty that
+ * nobody reads blocks the write instead (see Pseudo-terminal console in sim.h).
+ */
+size_t xio_write(const uint8_t *buffer, size_t size) { return (fwrite(buffer, 1, size, stderr));}
+size_t write(uint8_t *buffer, size_t size) { return (xio_write(buffer, size));}
+void xio_select_port(uint8_t port) {}
+uint16_t xio_get_rx_free()
+{
+	if (sim.pty < 0) { return (XIO_RX_BUFFER_LEN-1);}
+	return ((XIO_RX_BUFFER_LEN-1) - ((rx.head - rx.tail) & (XIO_RX_BUFFER_LEN-1)));
+}
+uint8_t xio_input_waiting()					// the input file always has more until it runs out
+{
+	if (sim.pty < 0) { return (sim.input_done == false);}
+	return (rx.tail != rx.head);
+}
+uint16_t xio_get_tx_bufcount(uint8_t port) { return (0);}
+bool xio_tx_backed_up(uint8_t port) { return (false);}
+
+/*
+ * _pty_rx_fill() - take what the sender has written into the receive ring (SysTick)
+ * _pty_read()	   - the next character from the pty, or _FDEV_ERR if there is none
+ *
+ *	The pty is read a bank of XIO_RX_BUFFER_LEN at a time, which stands in for the USB
+ *	endpoint banks, and the bank is emptied into the ring only as far as the ring has
+ *	room. The rest stays in the pty, and the sender is held off once that fills. 
+ *	Compressed input is decoded on the way and realtime characters are acted on, as
+ *	in _usb_rx_fill().
+ */
+static struct simPtyBank {
+	uint16_t count;						// characters read into the bank...
+	uint16_t next;						// ...and taken from it
+	uint8_t buf[XIO_RX_BUFFER_LEN];
+} bank;
+
+static int _pty_read()
+{
+	if (bank.next == bank.count) {
+		struct pollfd p = { sim.pty, POLLIN, 0 };
+		if ((poll(&p, 1, 0) != 1) || ((p.revents & POLLIN) == 0)) { return (_FDEV_ERR);}
+		ssize_t count = read(sim.pty, bank.buf, sizeof(bank.buf));
+		if (count <= 0) { return (_FDEV_ERR);}
+		bank.count = (uint16_t)count;
+		bank.next = 0;
+	}
+	return (bank.buf[bank.next++]);
+}
+
+static void _pty_rx_fill()
+{
+	while (((rx.tail - rx.head - 1) & (XIO_RX_BUFFER_LEN-1)) != 0) {	// room in the ring
+		int c;
+		if (xz.window == 0) {
+			c = _pty_read();
+		} else {
+			while ((c = xio_lz_get()) == _FDEV_ERR) {
+				int code = _pty_read();
+				if (code == _FDEV_ERR) { break;}
+				xio_lz_put((uint8_t)code);
+			}
+		}
+		if (c == _FDEV_ERR) { return;}
+		if (_xio_realtime_char(c) == true) { continue;}
+		rx.buf[rx.head] = (uint8_t)c;
+		rx.head = (rx.head + 1) & (XIO_RX_BUFFER_LEN-1);
+	}
+	sim.rx_full_ticks++;
+}
+
+namespace Motate {
+	void Timer<SysTickTimerNum>::interrupt()
+	{
+		switch_tick();					// switch debounce samples
+		if (sim.pty >= 0) { _pty_rx_fill();}
+	}
+}
+
+/*
+ * File device - not fitted
+ */
+void xio_file_init()
+{
+	memset(&xf, 0, sizeof(xf));
+	xf.end = XIO_FILE_SECTOR_LEN;
+}
+
+stat_t xio_file_read_line(uint8_t *buffer, uint16_t *index, size_t size) { return (STAT_EOF);}
+stat_t xio_file_write_line(const char_t *line) { return (STAT_FILE_NOT_OPEN);}
+uint8_t xio_file_uploading() { return (false);}
+uint32_t xio_file_linenum() { return (0);}
+
+stat_t xio_file_set_fl(cmdObj_t *cmd) { return (STAT_NO_SUCH_DEVICE);}
+stat_t xio_file_set_fr(cmdObj_t *cmd) { return (STAT_NO_SUCH_DEVICE);}
+stat_t xio_file_set_fp(cmdObj_t *cmd) { return (STAT_COMMAND_NOT_ACCEPTED);}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ ***********************************************************************************/
+
+stat_t xio_set_ci(cmdObj_t *cmd)
+{
+	if (cmd->value >= XIO_DEV_INPUTS) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	return (STAT_OK);								// there is only the one console
+}
+
+#ifdef __TEXT_MODE
+
+static const char fmt_ci[] PROGMEM = "[ci]  console interface%12d [0=USB,1=USART,2=CAN]\n";
+static const char fmt_fl[] PROGMEM = "[fl]  file lines stored%12lu\n";
+static const char fmt_fr[] PROGMEM = "[fr]  file line running%12lu\n";
+static const char fmt_fp[] PROGMEM = "[fp]  file pause%19d [0=run,1=pause,2=stop]\n";
+
+void xio_print_ci(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_ci);}
+void xio_file_print_fl(cmdObj_t *cmd) { text_print_int(cmd, fmt_fl);}
+void xio_file_print_fr(cmdObj_t *cmd) { text_print_int(cmd, fmt_fr);}
+void xio_file_print_fp(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_fp);}
+
+#endif // __TEXT_MODE
@@ -0,0 +1,246 @@
+/*
+ * preflight.cpp - dry run a job for its time and extents
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	See Preflight in preflight.h
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "controller.h"
+#include "canonical_machine.h"
+#include "gcode_parser.h"
+#include "planner.h"
+#include "preflight.h"
+#include "text_parser.h"
+#include "xio.h"
+#include "xio_file.h"
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+pfPreflightSingleton_t pf;
+
+static void _free_blocks(uint8_t headroom);
+static uint8_t _generating(void);
+static void _preflight_end(void);
+
+/*
+ * pf_set_pre() - start or end a preflight
+ *
+ *	Starting needs the machine idle with the planner empty, as for the benchmark.
+ *	The job stored on the file device is played from its first line.
+ */
+
+stat_t pf_set_pre(cmdObj_t *cmd)
+{
+	uint8_t state = (uint8_t)cmd->value;
+	if (state > PREFLIGHT_FILE) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if (state == PREFLIGHT_OFF) {
+		if (pf.state != PREFLIGHT_OFF) { pf.state = PREFLIGHT_ENDING;}
+		return (STAT_OK);
+	}
+	if ((pf.state != PREFLIGHT_OFF) || (mp_get_runtime_busy() == true) ||
+		(mp_get_planner_buffers_available() < PLANNER_BUFFER_POOL_SIZE)) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+
+	// save everything the job will change
+	pf.gm = gm;
+	pf.gmx = gmx;
+	copy_axis_vector(pf.position, mm.position);
+	pf.machine_state = cm.machine_state;
+	pf.cycle_state = cm.cycle_state;
+	pf.motion_state = cm.motion_state;
+
+	pf.time = 0;
+	pf.blocks = 0;
+	pf.limit_line = 0;
+	pf.limit_targets = 0;
+	copy_axis_vector(pf.min, mm.position);
+	copy_axis_vector(pf.max, mm.position);
+	pf.state = state;
+	mp_set_dry_run(true);
+
+	if (state == PREFLIGHT_FILE) {
+		cmdObj_t fr;
+		fr.value = 1;
+		stat_t status = xio_file_set_fr(&fr);
+		if (status != STAT_OK) {
+			pf.state = PREFLIGHT_OFF;
+			mp_set_dry_run(false);
+			return (status);
+		}
+	}
+	return (STAT_OK);
+}
+
+/*
+ * pf_preflight_callback() - stand in for the runtime while a preflight runs
+ *
+ *	Frees planned blocks down to the planner headroom so the parser can go on, and
+ *	ends the preflight once the input is over and everything behind it is planned.
+ *	It runs ahead of the generators (arcs, canned cycles), which wait on the room it
+ *	makes.
+ */
+
+stat_t pf_preflight_callback()
+{
+	if (pf.state == PREFLIGHT_OFF) { return (STAT_NOOP);}
+	_free_blocks(PLANNER_BUFFER_HEADROOM);
+
+	if ((pf.state == PREFLIGHT_FILE) && (xf.state != XIO_FILE_PLAYING)) { pf.state = PREFLIGHT_ENDING;}
+	if ((pf.state != PREFLIGHT_ENDING) || (cs.line_pending == true) ||
+		(gc_read_ahead_empty() == false) || (gc_batch_running() == true) || (_generating() == true)) {
+		return (STAT_OK);
+	}
+	_preflight_end();
+	return (STAT_OK);
+}
+
+/*
+ * _free_blocks() - free blocks from the run end, adding up their time
+ *
+ *	A block is let go only when nothing will replan it, so the trapezoid it has is
+ *	the one it would run. Only safe in dry-run mode, when the exec never takes the
+ *	run buffer.
+ */
+
+static void _free_blocks(uint8_t headroom)
+{
+	mpBuf_t *bf;
+	while (mp_get_planner_buffers_available() < headroom) {
+		if ((bf = mp_get_run_buffer()) == NULL) { return;}
+		if (bf->move_type == MOVE_TYPE_ALINE) {
+			pf.time += mp_get_block_time(bf) * 60;
+		} else if (bf->move_type == MOVE_TYPE_DWELL) {
+			pf.time += bf->gm->move_time;			// dwells are held in seconds
+		}
+		pf.blocks++;
+		mp_free_run_buffer();
+	}
+}
+
+/*
+ * _generating() - TRUE while a generator still has moves to queue
+ */
+
+static uint8_t _generating()
+{
+	for (uint8_t task = CTL_TASK_ARC; task <= CTL_TASK_SUBROUTINE; task++) {
+		if ((cs.task_ready[task] == true) || (cs.task_wait[task] != CTL_EVENT_NONE)) { return (true);}
+	}
+	return (false);
+}
+
+/*
+ * _preflight_end() - plan what is left, count it, and put the machine back
+ */
+
+static void _preflight_end()
+{
+	mp_plan_batch();							// the batch still waiting is planned to a stop
+	_free_blocks(PLANNER_BUFFER_POOL_SIZE);
+	mp_flush_planner();
+	mp_set_dry_run(false);
+	gm = pf.gm;
+	gmx = pf.gmx;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		mp_set_planner_position(axis, pf.position[axis]);
+	}
+	cm.machine_state = pf.machine_state;
+	cm.cycle_state = pf.cycle_state;
+	cm.motion_state = pf.motion_state;
+	pf.state = PREFLIGHT_OFF;
+}
+
+/*
+ * pf_target() - take in the target of a line, in machine coordinates
+ * pf_arc()	   - take in an arc planned as a single block
+ *
+ *	An arc reaches past its end points where it crosses an axis of its plane. Theta
+ *	is measured from the axis_2 direction, as in mp_arc().
+ */
+
+void pf_target(const GCodeState_t *gm_line)
+{
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		pf.min[axis] = min(pf.min[axis], gm_line->target[axis]);
+		pf.max[axis] = max(pf.max[axis], gm_line->target[axis]);
+	}
+	if (cm_test_soft_limits(gm_line->target) != STAT_OK) {
+		if (pf.limit_targets++ == 0) { pf.limit_line = gm_line->linenum;}
+	}
+}
+
+void pf_arc(const GCodeState_t *gm_arc, const float center_1, const float center_2, const float theta,
+			const float radius, const float angular_travel, const uint8_t axis_1, const uint8_t axis_2)
+{
+	float target[AXES];
+	copy_axis_vector(target, gm_arc->target);
+	float start = min(theta, theta + angular_travel);
+	float end = max(theta, theta + angular_travel);
+
+	for (float crossing = ceil(start / (M_PI/2)) * (M_PI/2); crossing < end; crossing += M_PI/2) {
+		target[axis_1] = center_1 + sin(crossing) * radius;
+		target[axis_2] = center_2 + cos(crossing) * radius;
+		pf.min[axis_1] = min(pf.min[axis_1], target[axis_1]);
+		pf.max[axis_1] = max(pf.max[axis_1], target[axis_1]);
+		pf.min[axis_2] = min(pf.min[axis_2], target[axis_2]);
+		pf.max[axis_2] = max(pf.max[axis_2], target[axis_2]);
+		if ((cm_test_soft_limits(target) != STAT_OK) && (pf.limit_targets++ == 0)) {
+			pf.limit_line = gm_arc->linenum;
+		}
+	}
+	pf_target(gm_arc);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_pre[] PROGMEM = "[pre]  preflight%25d [0=off,1=stream,2=file,3=ending]\n";
+static const char fmt_pft[] PROGMEM = "[pft]  planned time%22.1f sec\n";
+static const char fmt_pfb[] PROGMEM = "[pfb]  blocks planned%20lu\n";
+static const char fmt_pfe[] PROGMEM = "[pfe]  first line outside limits%9lu\n";
+static const char fmt_pfo[] PROGMEM = "[pfo]  targets outside limits%12lu\n";
+static const char fmt_pfenv[] PROGMEM = "[pf%s] %c %s position%19.3f %s\n";
+
+void pf_print_pre(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_pre);}
+void pf_print_t(cmdObj_t *cmd) { text_print_flt(cmd, fmt_pft);}
+void pf_print_b(cmdObj_t *cmd) { text_print_int(cmd, fmt_pfb);}
+void pf_print_e(cmdObj_t *cmd) { text_print_int(cmd, fmt_pfe);}
+void pf_print_o(cmdObj_t *cmd) { text_print_int(cmd, fmt_pfo);}
+
+void pf_print_env(cmdObj_t *cmd)				// tokens end in the axis letter then n (lowest) or x (highest)
+{
+	const char *t = (const char *)cmd->token + strlen((const char *)cmd->token) - 2;	// the group prefix is only there outside the group
+	char axis = toupper(t[0]);
+	fprintf_P(stderr, fmt_pfenv, t, axis, (t[1] == 'n') ? "lowest " : "highest",
+			  (double)cmd->value, (strchr("ABC", axis) != NULL) ? "deg" : "mm");
+}
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,122 @@
+/*
+ * preflight.h - dry run a job for its time and extents
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Preflight
+ *	A job is run through the parser, the canonical machine and the planner as it would
+ *	be for real, with the planner in dry-run mode: nothing is executed, the motors
+ *	don't move and commands (spindle, coolant, tool change, program end) are dropped
+ *	unrun. It goes as fast as the input comes in.
+ *
+ *	  $pre=1	start a preflight of the lines that follow - stream the job, then
+ *	  $pre=0	end it. The moves still generating (arcs, canned cycles) finish first
+ *	  $pre=2	preflight the job stored on the file device (see xio_file.h). It ends
+ *				by itself when the job has been read
+ *	  $pre		0 once the preflight is over - see preflight.cpp for the others
+ *
+ *	The planned blocks are let go from the front of the queue only as the parser needs
+ *	room, so every block is planned at full look-ahead depth as it is when the job
+ *	runs. A block's time is taken from its trapezoid as it leaves, when nothing can
+ *	replan it - the time the runtime would take for it, without overrides, holds or
+ *	the steppers starving. Dwells count their time.
+ *
+ *	Results are read back with $pf (text) or {"pf":""} (JSON):
+ *
+ *	  pft		planned time of the job in seconds
+ *	  pfb		blocks planned - line, arc and dwell blocks, commands and the rest
+ *	  pfe		line of the first target outside the soft limits - 0 if there was none
+ *	  pfo		targets outside the soft limits
+ *	  pfxn,pfxx	lowest and highest machine position of each axis - X to C. These start
+ *				from where the machine was, take in the end of every move, and the
+ *				sides of native arcs
+ *
+ *	The soft limits are 0 to $xtm for each axis (see cm_test_soft_limits()), in machine
+ *	coordinates, so the work offsets the job sets are taken into account. The Gcode
+ *	model, the planner position and the machine states are put back when it ends. The
+ *	machine must be idle with the planner empty to start. Homing and probing cycles
+ *	need the motors, so a job that has them can't be preflighted past them.
+ */
+
+#ifndef PREFLIGHT_H_ONCE
+#define PREFLIGHT_H_ONCE
+
+#include "canonical_machine.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+enum pfState {						// $pre
+	PREFLIGHT_OFF = 0,
+	PREFLIGHT_STREAM,				// the lines that follow, until $pre=0
+	PREFLIGHT_FILE,					// the job on the file device
+	PREFLIGHT_ENDING				// $pre=0 - ends once the moves behind the lines are planned
+};
+
+typedef struct pfPreflightSingleton {
+	uint8_t state;					// see pfState
+
+	// results
+	float time;						// planned time in seconds ($pft)
+	uint32_t blocks;				// blocks planned ($pfb)
+	uint32_t limit_line;			// first line outside the soft limits - 0 for none ($pfe)
+	uint32_t limit_targets;			// targets outside the soft limits ($pfo)
+	float min[AXES];				// machine position envelope ($pfxn...)
+	float max[AXES];				// ($pfxx...)
+
+	// put back when it ends
+	GCodeState_t gm;
+	GCodeStateX_t gmx;
+	float position[AXES];
+	uint8_t machine_state;
+	uint8_t cycle_state;
+	uint8_t motion_state;
+} pfPreflightSingleton_t;
+
+extern pfPreflightSingleton_t pf;
+
+stat_t pf_set_pre(cmdObj_t *cmd);
+stat_t pf_preflight_callback(void);
+void pf_target(const GCodeState_t *gm_line);
+void pf_arc(const GCodeState_t *gm_arc, const float center_1, const float center_2, const float theta,
+			const float radius, const float angular_travel, const uint8_t axis_1, const uint8_t axis_2);
+
+#ifdef __TEXT_MODE
+
+	void pf_print_pre(cmdObj_t *cmd);
+	void pf_print_t(cmdObj_t *cmd);
+	void pf_print_b(cmdObj_t *cmd);
+	void pf_print_e(cmdObj_t *cmd);
+	void pf_print_o(cmdObj_t *cmd);
+	void pf_print_env(cmdObj_t *cmd);
+
+#else
+
+	#define pf_print_pre tx_print_stub
+	#define pf_print_t tx_print_stub
+	#define pf_print_b tx_print_stub
+	#define pf_print_e tx_print_stub
+	#define pf_print_o tx_print_stub
+	#define pf_print_env tx_print_stub
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PREFLIGHT_H_ONCE
@@ -0,0 +1,179 @@
+/*
+ * pressure.cpp - extruder pressure advance
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* See "PRESSURE ADVANCE" in pressure.h. It runs after the input shaper and before
+ * ik_kinematics(), on the same segments, so it only ever moves the extruder motor.
+ */
+#include "tinyg2.h"
+#include "config.h"
+#include "pressure.h"
+#include "text_parser.h"
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+paSingleton_t pa;
+
+static void _configure(void);
+static float _extruded_since(uint8_t index, const uint32_t age) RAMFUNC;
+
+/*
+ * pa_advance() - advance the extruder of the segment being prepped
+ *
+ *	Takes the end position and travel of the segment and adds the change in advance to
+ *	the extruder. Call pa_commit() once the segment has been prepped. Called from the
+ *	exec wherever sh_shape() is, including the segments that run out the delay.
+ */
+void pa_advance(float position[], float travel[], const float microseconds)
+{
+	if ((pa.reconfigure == true) && (pa_settled() == true)) { _configure();}
+	if (pa.enable == false) { return;}
+
+	uint8_t e = pa.extruder;
+	uint8_t index = (pa.newest + 1) & (PA_HISTORY-1);
+	paSegment_t *s = &pa.history[index];
+	s->end = pa.history[pa.newest].end + (uint32_t)microseconds;
+	s->extruded = 0;
+	if (travel[e] > 0) {
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			if ((axis != e) && (fp_NOT_ZERO(travel[axis]))) { s->extruded = travel[e]; break;}
+		}
+	}
+	float velocity = _extruded_since(index, pa.window) * 1000000 / pa.window;
+	pa.staged = pa.k * velocity;
+	travel[e] += pa.staged - pa.advance;
+	position[e] += pa.staged;
+}
+
+void pa_commit()
+{
+	if (pa.enable == false) { return;}
+	pa.newest = (pa.newest + 1) & (PA_HISTORY-1);
+	pa.advance = pa.staged;
+}
+
+/*
+ * pa_settled() - true once the advance is back to zero
+ */
+uint8_t pa_settled()
+{
+	return ((pa.enable == false) || (fp_ZERO(pa.advance)));
+}
+
+/*
+ * pa_get_position() - move a runtime position to where the motors have been sent
+ */
+void pa_get_position(float position[])
+{
+	if (pa.enable == false) { return;}
+	position[pa.extruder] += pa.advance;
+}
+
+/*
+ * _extruded_since() - extrusion counted in the age in microseconds before the end of
+ *					   segment index
+ *
+ *	A segment extrudes evenly across its time. A window longer than the history takes
+ *	what the history holds, which averages a little low.
+ */
+static float _extruded_since(uint8_t index, const uint32_t age)
+{
+	uint32_t t = pa.history[index].end - age;
+	float extruded = 0;
+
+	for (uint8_t n=1; n<PA_HISTORY; n++) {
+		uint8_t older = (index - 1) & (PA_HISTORY-1);
+		uint32_t start = pa.history[older].end;
+		if ((int32_t)(t - start) >= 0) {		// the window starts in this segment
+			return (extruded + pa.history[index].extruded *
+					(float)(pa.history[index].end - t) / (float)(pa.history[index].end - start));
+		}
+		extruded += pa.history[index].extruded;
+		index = older;
+	}
+	return (extruded);
+}
+
+/*
+ * _configure() - take up the config and start the history at rest
+ *
+ *	Only called with the advance at zero (or off), so the extruder motor is where the
+ *	runtime is.
+ */
+static void _configure()
+{
+	pa.reconfigure = false;
+	pa.enable = ((pa.advance_time > 0) && (pa.axis < AXES)) ? true : false;
+	pa.extruder = pa.axis;
+	pa.k = pa.advance_time;
+	pa.window = max((uint32_t)(pa.smooth_time * 1000000), (uint32_t)1);	// 0 takes the last segment's velocity
+	for (uint8_t i=0; i<PA_HISTORY; i++) {
+		pa.history[i].end = 0;
+		pa.history[i].extruded = 0;
+	}
+	pa.newest = 0;
+	pa.advance = 0;
+	pa.staged = 0;
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * pa_set_pae() - set the extruder axis
+ * pa_set_pa()	- set the advance or smoothing time in seconds
+ */
+stat_t pa_set_pae(cmdObj_t *cmd)
+{
+	if ((cmd->value < 0) || (cmd->value >= AXES)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	pa.reconfigure = true;
+	return (STAT_OK);
+}
+
+stat_t pa_set_pa(cmdObj_t *cmd)
+{
+	if ((cmd->value < 0) || (cmd->value > 1)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_flt(cmd);
+	pa.reconfigure = true;
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_pae[] PROGMEM = "[pae] pressure advance axis%12d [0=X,1=Y,2=Z,3=A,4=B,5=C]\n";
+static const char fmt_pak[] PROGMEM = "[pak] pressure advance time%12.3f Sec [0=off]\n";
+static const char fmt_pas[] PROGMEM = "[pas] pressure advance smoothing%7.3f Sec\n";
+
+void pa_print_pae(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_pae);}
+void pa_print_pak(cmdObj_t *cmd) { text_print_flt(cmd, fmt_pak);}
+void pa_print_pas(cmdObj_t *cmd) { text_print_flt(cmd, fmt_pas);}
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,104 @@
+/*
+ * pressure.h - extruder pressure advance
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PRESSURE_H_ONCE
+#define PRESSURE_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/* PRESSURE ADVANCE - keep the extruder ahead of the melt pressure
+ *
+ *	A 3D printer's extruder is just another axis ($pae, A in the Ultimaker profile), but
+ *	the plastic comes out of the nozzle behind the filament: the melt has to be pressed
+ *	up to flow, and it runs on as the pressure bleeds off. So the lines start thin and end
+ *	in a blob, and the faster the print the worse. Pressure advance drives the extruder
+ *	motor ahead of the planned extruder position by
+ *
+ *	  advance = K * v
+ *
+ *	for the extrusion velocity v and advance time K ({"pak":0.05}, in seconds). Segment
+ *	to segment the motor gets K times the change in velocity on top of its planned steps:
+ *	extra on the way up, less on the way down. v is averaged over the last $pas seconds of
+ *	segments, so a corner or a speed change ramps the advance in instead of kicking the
+ *	motor with a step. The window adds that much lag; 20 to 40 ms is about right.
+ *
+ *	Only segments that extrude (the extruder moving forward) with some other axis moving
+ *	count - a retract or a prime runs as planned and the advance falls off across it. The
+ *	advance is back to zero once the extruder has stopped for a window, and at the end of
+ *	motion, at a hold and before a command the runtime runs that out like the input shaper
+ *	delay (see mp_exec_shaper()). Config changes take effect once it has.
+ *
+ *	Measure K by printing a test with a few speed changes and raising it until the line
+ *	width stays even - a few hundredths of a second on a direct drive, more on a bowden.
+ */
+#define PA_HISTORY 32					// segments of extrusion kept - must be a power of 2
+
+typedef struct paSegment {				// extrusion of a segment
+	uint32_t end;						// microseconds - wraps
+	float extruded;						// extruder travel counted - 0 if it didn't extrude
+} paSegment_t;
+
+typedef struct paSingleton {
+	// config
+	uint8_t axis;						// extruder axis
+	float advance_time;					// K in seconds - 0 turns it off
+	float smooth_time;					// velocity averaging window in seconds
+
+	// runtime - exec only
+	volatile uint8_t reconfigure;		// config has changed
+	uint8_t enable;
+	uint8_t extruder;					// axis advanced while enabled
+	float k;							// advance time and...
+	uint32_t window;					// ...window in effect - microseconds
+	uint8_t newest;						// history index of the last segment run
+	float advance;						// extruder offset sent to the motor so far
+	float staged;						// ...and as of the segment being prepped
+	paSegment_t history[PA_HISTORY];
+} paSingleton_t;
+extern paSingleton_t pa;
+
+/*
+ * Global Scope Functions
+ */
+
+void pa_advance(float position[], float travel[], const float microseconds) RAMFUNC;
+void pa_commit(void) RAMFUNC;
+uint8_t pa_settled(void);
+void pa_get_position(float position[]);
+
+stat_t pa_set_pae(cmdObj_t *cmd);
+stat_t pa_set_pa(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+	void pa_print_pae(cmdObj_t *cmd);
+	void pa_print_pak(cmdObj_t *cmd);
+	void pa_print_pas(cmdObj_t *cmd);
+#else
+	#define pa_print_pae tx_print_stub
+	#define pa_print_pak tx_print_stub
+	#define pa_print_pas tx_print_stub
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // End of include Guard: PRESSURE_H_ONCE
@@ -31,6 +31,7 @@
 #include "config.h"		// #2
 #include "hardware.h"
 #include "text_parser.h"
+#include "switch.h"
 //#include "gpio.h"
 #include "pwm.h"
 
@@ -42,117 +43,132 @@ extern "C"{
 
 pwmSingleton_t pwm;
 
-// defines common to all PWM channels
-//#define PWM_TIMER_TYPE	TC1_struct	// PWM uses TC1's
-#define PWM_TIMER_t	TC1_t				// PWM uses TC1's
-#define PWM_TIMER_DISABLE 0				// turn timer off (clock = 0 Hz)
+/* PWM outputs run on the SAM3X PWM controller. Each output is bound to the controller 
+ * channel its pin is wired to (see hardware.h), or -1 if the pin has no PWM controller
+ * function. The channel clock is F_CPU divided by a power of 2, picked per frequency 
+ * so the period fits the 16 bit counter with the finest duty steps.
+ */
+#define PWM_PRESCALE_MAX 10				// largest channel prescaler - F_CPU/1024
+#define PWM_PERIOD_MAX 65535			// channel counters are 16 bits
 #define PWM_MAX_FREQ (F_CPU/256)		// max frequency with 8-bits duty cycle precision
-#define PWM_MIN_FREQ (F_CPU/64/65536)	// min frequency with supported prescaling
+#define PWM_MIN_FREQ (F_CPU/1024/65536)	// min frequency with supported prescaling
 
-// channel specific defines
-/* CLKSEL is used to configure default PWM clock operating ranges
- * These can be changed by pwm_freq() depending on the PWM frequency selected
- *
- * The useful ranges (assuming a 32 Mhz system clock) are:
- *	 TC_CLKSEL_DIV1_gc  - good for about 500 Hz to 125 Khz practical upper limit
- *   TC_CLKSEL_DIV2_gc  - good for about 250 Hz to  62 KHz
- *	 TC_CLKSEL_DIV4_gc  - good for about 125 Hz to  31 KHz
- *	 TC_CLKSEL_DIV8_gc  - good for about  62 Hz to  16 KHz
- *	 TC_CLKSEL_DIV64_gc - good for about   8 Hz to   2 Khz
- */
-#define PWM1_CTRLA_CLKSEL	TC_CLKSEL_DIV1_gc	// starting clock select value
-#define PWM1_CTRLB 			(3 | TC0_CCBEN_bm)	// single slope PWM enabled on channel B
-#define PWM1_ISR_vect 		TCD1_CCB_vect		// must match timer assignments in system.h
-#define PWM1_INTCTRLB		0					// timer interrupt level (0=off, 1=lo, 2=med, 3=hi)
+static const int8_t pwm_channel[PWMS] = { SPINDLE_PWM_CHANNEL, SECONDARY_PWM_CHANNEL };
 
-#define PWM2_CTRLA_CLKSEL 	TC_CLKSEL_DIV1_gc
-#define PWM2_CTRLB 			3					// single slope PWM enabled, no output channel
-//#define PWM2_CTRLB 		(3 | TC0_CCBEN_bm)	// single slope PWM enabled on channel B
-#define PWM2_ISR_vect		TCE1_CCB_vect		// must match timer assignments in system.h
-#define PWM2_INTCTRLB		0					// timer interrupt level (0=off, 1=lo, 2=med, 3=hi)
+static uint32_t _duty_ticks(pwmChannel_t *p);
 
 /***** PWM code *****/
 /* 
  * pwm_init() - initialize pwm channels
  *
  *	Notes: 
- *	  - Whatever level interrupts you use must be enabled in main()
- *	  - init assumes PWM1 output bit (D5) has been set to output previously (stepper.c)
- *	  - See system.h for timer and port assignments
- *    - Don't do this: memset(&TIMER_PWM1, 0, sizeof(PWM_TIMER_t)); // zero out the timer registers
+ *	  - The PWM controller runs with no interrupts. Duty and frequency changes are
+ *		written to the update registers and taken up at the end of the period
+ *	  - The pins are handed to the PWM controller here. See hardware.h for the 
+ *		channel assignments
+ *	  - Must follow config_init() - the frequency and off phase come from the config
  */
 void pwm_init()
 {
-/*
-	gpio_set_bit_off(SPINDLE_PWM);
-
-	// setup PWM channel 1
-	memset(&pwm.p[PWM_1], 0, sizeof(pwmChannel_t));		// clear parent structure
-	pwm.p[PWM_1].timer = &TIMER_PWM1;					// bind timer struct to PWM struct array
-	pwm.p[PWM_1].ctrla = PWM1_CTRLA_CLKSEL;				// initialize starting clock operating range
-	pwm.p[PWM_1].timer->CTRLB = PWM1_CTRLB;
-	pwm.p[PWM_1].timer->INTCTRLB = PWM1_INTCTRLB;		// set interrupt level
-
-	// setup PWM channel 2
-	memset(&pwm.p[PWM_2], 0, sizeof(pwmChannel_t));		// clear all values, pointers and status
-	pwm.p[PWM_2].timer = &TIMER_PWM2;
-	pwm.p[PWM_2].ctrla = PWM2_CTRLA_CLKSEL;
-	pwm.p[PWM_2].timer->CTRLB = PWM2_CTRLB;
-	pwm.p[PWM_2].timer->INTCTRLB = PWM2_INTCTRLB;
-*/
+	PMC->PMC_PCER1 = (1u << (ID_PWM - 32));	// clock the PWM controller
+	for (uint8_t chan=0; chan<PWMS; chan++) {
+		memset(&pwm.p[chan], 0, sizeof(pwmChannel_t));	// clear all values and status
+		pwm.p[chan].channel = pwm_channel[chan];
+		if (pwm.p[chan].channel >= 0) { PWM->PWM_DIS = (1 << pwm.p[chan].channel);}
+	}
+#if (SPINDLE_PWM_CHANNEL >= 0)
+	spindle_pwm_pin.setMode(Motate::kPeripheralB);		// PWML4 on the spindle PWM pin
+#endif
+	pwm_set_freq(PWM_1, pwm.c[PWM_1].frequency);
+	pwm_set_duty(PWM_1, pwm.c[PWM_1].phase_off);
+	pwm_fault_init();
 }
 
 /*
- * ISRs for PWM timers
+ * pwm_fault_init() - let the e-stop input gate the spindle PWM in hardware
+ * pwm_halt()		- hold the spindle PWM pin low at once. OK to call from an ISR
+ *
+ *	See Emergency stop in switch.h. With ESTOP_PWM_FAULT the e-stop pin is handed to
+ *	the PWM controller as that fault input, at the polarity of $es, and a fault forces
+ *	the spindle channel's output low until it is cleared. The PIO change interrupt 
+ *	still sees the pin. The fault is latched, and only clears here if the input has 
+ *	gone back.
+ *
+ *	pwm_halt() takes the pin from the PWM controller, so it stays low through later 
+ *	duty writes and raster pixels. Only a reset gives it back.
  */
-/*
-MOTATE_TIMER_INTERRUPT
-ISR(PWM1_ISR_vect) 
+void pwm_fault_init()
 {
-	return;
+#if ((ESTOP_PWM_FAULT >= 0) && (SPINDLE_PWM_CHANNEL >= 0) && !defined(__SIM))
+	uint32_t fault = (1 << ESTOP_PWM_FAULT);
+	uint32_t enable = fault << (8 * (SPINDLE_PWM_CHANNEL % 4));	// a byte per channel
+	volatile uint32_t *fpe = (SPINDLE_PWM_CHANNEL < 4) ? &PWM->PWM_FPE1 : &PWM->PWM_FPE2;
+
+	if (sw.estop_mode == ESTOP_DISABLED) {
+		*fpe &= ~enable;
+		estop_pin.setMode(Motate::kInput);
+	} else {
+		PWM->PWM_FMR = (PWM->PWM_FMR & ~PWM_FMR_FPOL(fault)) | PWM_FMR_FMOD(fault) |	// latched
+					   ((sw.estop_mode == ESTOP_NORMALLY_CLOSED) ? PWM_FMR_FPOL(fault) : 0);
+		PWM->PWM_FPV &= ~(PWM_FPV_FPVL0 << SPINDLE_PWM_CHANNEL);	// forced low
+		estop_pin.setMode(Motate::kPeripheralB);	// PWMFIn - the pull-up stays on
+		*fpe |= enable;
+	}
+	PWM->PWM_FCR = PWM_FCR_FCLR(fault);
+#endif
 }
 
-ISR(PWM2_ISR_vect) 
+void pwm_halt()
 {
-	return;
+#if (SPINDLE_PWM_CHANNEL >= 0)
+	spindle_pwm_pin.clear();
+	spindle_pwm_pin.setMode(Motate::kOutput);
+#endif
 }
-*/
 
 /* 
  * pwm_set_freq() - set PWM channel frequency
  *
  *	channel	- PWM channel
- *	freq	- PWM frequency in Khz as a float
+ *	freq	- PWM frequency in Hz as a float
  *
- *	Assumes 32MHz clock.
- *	Doesn't turn time on until duty cycle is set
+ *	The duty cycle is kept. If the prescaler is unchanged the new period goes through 
+ *	the update register and starts cleanly at the end of the current period. A new 
+ *	prescaler can only be set with the channel stopped, which cuts the current period 
+ *	short - this only happens on a large frequency change.
  */
 
 stat_t pwm_set_freq(uint8_t chan, float freq)
 {
-	if (chan > PWMS) { return (STAT_NO_SUCH_DEVICE);}
+	if (chan >= PWMS) { return (STAT_NO_SUCH_DEVICE);}
 	if (freq > PWM_MAX_FREQ) { return (STAT_INPUT_VALUE_TOO_LARGE);}
 	if (freq < PWM_MIN_FREQ) { return (STAT_INPUT_VALUE_TOO_SMALL);}
-/*
-	// set the period and the prescaler
-	float prescale = F_CPU/65536/freq;	// optimal non-integer prescaler value
-	if (prescale <= 1) {
-		pwm.p[chan].timer->PER = F_CPU/freq;
-		pwm.p[chan].timer->CTRLA = TC_CLKSEL_DIV1_gc;
-	} else if (prescale <= 2) {
-		pwm.p[chan].timer->PER = F_CPU/2/freq;
-		pwm.p[chan].timer->CTRLA = TC_CLKSEL_DIV2_gc;
-	} else if (prescale <= 4) {
-		pwm.p[chan].timer->PER = F_CPU/4/freq;
-		pwm.p[chan].timer->CTRLA = TC_CLKSEL_DIV4_gc;
-	} else if (prescale <= 8) {
-		pwm.p[chan].timer->PER = F_CPU/8/freq;
-		pwm.p[chan].timer->CTRLA = TC_CLKSEL_DIV8_gc;
+	pwmChannel_t *p = &pwm.p[chan];
+	if (p->channel < 0) { return (STAT_NO_SUCH_DEVICE);}
+
+	// use the smallest prescaler the period fits - the finest duty steps
+	uint8_t prescale = 0;
+	float period = F_CPU / freq;
+	while ((period > PWM_PERIOD_MAX) && (prescale < PWM_PRESCALE_MAX)) {
+		period /= 2;
+		prescale++;
+	}
+	p->period = (uint16_t)period;
+
+	uint32_t mask = (1 << p->channel);
+	PwmCh_num *ch = &PWM->PWM_CH_NUM[p->channel];
+	if ((prescale != p->prescale) || ((PWM->PWM_SR & mask) == 0)) {
+		PWM->PWM_DIS = mask;
+		while (PWM->PWM_SR & mask);					// the mode can only be set while disabled
+		p->prescale = prescale;
+		ch->PWM_CMR = (prescale << PWM_CMR_CPRE_Pos);// left aligned. The L output is high for CDTY
+		ch->PWM_CPRD = p->period;
+		ch->PWM_CDTY = _duty_ticks(p);
+		PWM->PWM_ENA = mask;
 	} else {
-		pwm.p[chan].timer->PER = F_CPU/64/freq;
-		pwm.p[chan].timer->CTRLA = TC_CLKSEL_DIV64_gc;
+		ch->PWM_CPRDUPD = p->period;				// loaded at the end of the period
+		ch->PWM_CDTYUPD = _duty_ticks(p);
 	}
-*/
 	return (STAT_OK);
 }
 
@@ -162,34 +178,92 @@ stat_t pwm_set_freq(uint8_t chan, float freq)
  *	channel	- PWM channel
  *	duty	- PWM duty cycle from 0% to 100%
  *
- *	Setting duty cycle to 0 disables the PWM channel with output low
- *	Setting duty cycle to 100 disables the PWM channel with output high
- *	Setting duty cycle between 0 and 100 enables PWM channel
+ *	Setting duty cycle to 0 holds the output low
+ *	Setting duty cycle to 1 holds the output high
+ *	Setting duty cycle between 0 and 1 runs the PWM
  *
- *	The frequency must have been set previously
+ *	The new duty cycle is written to the update register so it takes effect at the 
+ *	end of the current period - there are no partial pulses. The frequency must have 
+ *	been set previously, otherwise the duty is kept until it is.
  */
 
 stat_t pwm_set_duty(uint8_t chan, float duty)
 {
     if (duty < 0.0) { return (STAT_INPUT_VALUE_TOO_SMALL);}
     if (duty > 1.0) { return (STAT_INPUT_VALUE_TOO_LARGE);}
-    
-	// Ffrq = Fper/(2N(CCA+1))
-	// Fpwm = Fper/((N(PER+1))
-/*	
-	float period_scalar = pwm.p[chan].timer->PER;
-	pwm.p[chan].timer->CCB = (uint16_t)(period_scalar * duty) + 1;
-*/
+	if (chan >= PWMS) { return (STAT_NO_SUCH_DEVICE);}
+	pwmChannel_t *p = &pwm.p[chan];
+	if (p->channel < 0) { return (STAT_NO_SUCH_DEVICE);}
+
+	p->duty = duty;
+	if (p->period == 0) { return (STAT_OK);}			// frequency not set yet
+	PWM->PWM_CH_NUM[p->channel].PWM_CDTYUPD = _duty_ticks(p);
 	return (STAT_OK);
 }
 
+/*
+ * pwm_set_power() - set the duty cycle for a fraction of the S power
+ *
+ *	ratio	- [0..1] of the power set by S. 0 is the off phase
+ *
+ *	Dynamic power mode only - otherwise the spindle commands set the duty cycle. Called 
+ *	from _load_move() with the ratio the exec prepped for the segment, so the power 
+ *	follows the velocity segment by segment. The duty is taken up at the end of the 
+ *	PWM period the segment starts in.
+ */
+
+void pwm_set_power(uint8_t chan, float ratio)
+{
+	if (pwm.c[chan].dynamic_power == false) return;
+	float phase_off = pwm.c[chan].phase_off;
+	pwm_set_duty(chan, phase_off + (pwm.p[chan].power - phase_off) * ratio);
+}
+
+/*
+ * pwm_start_raster() - set up the pixel duties for a raster segment
+ * pwm_set_raster()	  - set the duty for a pixel level
+ *
+ *	ratio	- [0..1] of the power set by S, as for pwm_set_power()
+ *	level	- pixel level [0..255] of that. 0 is the off phase
+ *
+ *	Called from the stepper ISRs (see Raster pixels in stepper.h), so the float math 
+ *	is done once per segment and a pixel is an integer multiply and a register store.
+ */
+
+void pwm_start_raster(uint8_t chan, float ratio)
+{
+	pwmChannel_t *p = &pwm.p[chan];
+	float phase_off = pwm.c[chan].phase_off;
+	p->raster_off = (uint32_t)(phase_off * p->period + 0.5);
+	p->raster_span = (int32_t)((p->power - phase_off) * ratio * p->period * 256 / 255);
+}
+
+void pwm_set_raster(uint8_t chan, uint8_t level)
+{
+	pwmChannel_t *p = &pwm.p[chan];
+	if ((p->channel < 0) || (p->period == 0)) return;
+	PWM->PWM_CH_NUM[p->channel].PWM_CDTYUPD = p->raster_off + ((p->raster_span * level) >> 8);
+}
+
+static uint32_t _duty_ticks(pwmChannel_t *p)
+{
+	return ((uint32_t)(p->duty * p->period + 0.5));
+}
+
 
 /***********************************************************************************
  * CONFIGURATION AND INTERFACE FUNCTIONS
  * Functions to get and set variables from the cfgArray table
  ***********************************************************************************/
 
-// none
+/*
+ * pwm_set_pwm() - set the PWM frequency and apply it to the running channel
+ */
+stat_t pwm_set_pwm(cmdObj_t *cmd)
+{
+	set_flt(cmd);
+	return (pwm_set_freq(PWM_1, pwm.c[PWM_1].frequency));
+}
 
 
 /***********************************************************************************
@@ -209,6 +283,7 @@ static const char fmt_p1wsh[] PROGMEM = "[p1wsh] pwm ccw speed hi%15.3f RPM\n";
 static const char fmt_p1wpl[] PROGMEM = "[p1wpl] pwm ccw phase lo%15.3f [0..1]\n";
 static const char fmt_p1wph[] PROGMEM = "[p1wph] pwm ccw phase hi%15.3f [0..1]\n";
 static const char fmt_p1pof[] PROGMEM = "[p1pof] pwm phase off   %15.3f [0..1]\n";
+static const char fmt_p1dyn[] PROGMEM = "[p1dyn] pwm dynamic power%14d [0=off,1=on]\n";
 
 void pwm_print_p1frq(cmdObj_t *cmd) { text_print_flt(cmd, fmt_p1frq);}
 void pwm_print_p1csl(cmdObj_t *cmd) { text_print_flt(cmd, fmt_p1csl);}
@@ -220,6 +295,7 @@ void pwm_print_p1wsh(cmdObj_t *cmd) { text_print_flt(cmd, fmt_p1wsh);}
 void pwm_print_p1wpl(cmdObj_t *cmd) { text_print_flt(cmd, fmt_p1wpl);}
 void pwm_print_p1wph(cmdObj_t *cmd) { text_print_flt(cmd, fmt_p1wph);}
 void pwm_print_p1pof(cmdObj_t *cmd) { text_print_flt(cmd, fmt_p1pof);}
+void pwm_print_p1dyn(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_p1dyn);}
 
 #endif //__TEXT_MODE 
 
@@ -43,11 +43,17 @@ typedef struct pwmConfigChannel {
 	float ccw_phase_lo;				// pwm phase at minimum CCW spindle speed, clamped [0..1]
 	float ccw_phase_hi;				// pwm phase at maximum CCW spindle speed, clamped
 	float phase_off;				// pwm phase when spindle is disabled
+	uint8_t dynamic_power;			// TRUE scales the power with the running velocity (see pwm_set_power())
 } pwmConfigChannel_t;
 
 typedef struct pwmChannel {
-	uint8_t ctrla;					// byte needed to active CTRLA (it's dynamic - rest are static)
-//++++	TC1_t *timer;				// assumes TC1 flavor timers used for PWM channels
+	int8_t channel;					// PWM controller channel, -1 if the output has none
+	uint8_t prescale;				// channel clock is F_CPU / 2^prescale
+	uint16_t period;				// period in channel clocks, 0 if frequency not set
+	float duty;						// duty cycle [0..1]
+	float power;					// duty cycle for S at the programmed velocity - dynamic power mode
+	uint32_t raster_off;			// raster pixel duties: off phase in channel clocks...
+	int32_t raster_span;			// ...plus this times the pixel level / 256 (see pwm_start_raster())
 } pwmChannel_t;
 
 typedef struct pwmSingleton {
@@ -60,8 +66,15 @@ extern pwmSingleton_t pwm;
 /*** function prototypes ***/
 
 void pwm_init(void);
+void pwm_fault_init(void);
+void pwm_halt(void);
 stat_t pwm_set_freq(uint8_t channel, float freq);
 stat_t pwm_set_duty(uint8_t channel, float duty);
+void pwm_set_power(uint8_t channel, float ratio);
+void pwm_start_raster(uint8_t channel, float ratio) RAMFUNC;
+void pwm_set_raster(uint8_t channel, uint8_t level) RAMFUNC;
+
+stat_t pwm_set_pwm(cmdObj_t *cmd);
 
 #ifdef __TEXT_MODE
 
@@ -75,6 +88,7 @@ stat_t pwm_set_duty(uint8_t channel, float duty);
 	void pwm_print_p1wpl(cmdObj_t *cmd);
 	void pwm_print_p1wph(cmdObj_t *cmd);
 	void pwm_print_p1pof(cmdObj_t *cmd);
+	void pwm_print_p1dyn(cmdObj_t *cmd);
 
 #else
 
@@ -88,6 +102,7 @@ stat_t pwm_set_duty(uint8_t channel, float duty);
 	#define pwm_print_p1wpl tx_print_stub
 	#define pwm_print_p1wph tx_print_stub
 	#define pwm_print_p1pof tx_print_stub
+	#define pwm_print_p1dyn tx_print_stub
 
 #endif // __TEXT_MODE
 
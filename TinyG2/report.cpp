@@ -28,9 +28,11 @@
 #include "tinyg2.h"
 #include "config.h"
 #include "report.h"
+#include "canonical_machine.h"
 #include "json_parser.h"
 #include "text_parser.h"
 #include "planner.h"
+#include "hardware.h"
 #include "settings.h"
 #include "util.h"
 #include "xio.h"
@@ -46,6 +48,7 @@ qrSingleton_t qr;
 
 /**** Exception Messages ************************************************************
  * rpt_exception() - generate an exception message - always in JSON format
+ * rpt_line_exception() - ...for a Gcode line that was answered before it ran (see gc_read_ahead())
  * rpt_er()		   - send a bogus exception report for testing purposes (it's not real)
  */
 void rpt_exception(uint8_t status)
@@ -54,6 +57,12 @@ void rpt_exception(uint8_t status)
 		TINYG_FIRMWARE_BUILD, status, get_status_message(status));
 }
 
+void rpt_line_exception(uint8_t status, uint32_t linenum)
+{
+	printf_P(PSTR("{\"er\":{\"fb\":%0.2f,\"st\":%d,\"msg\":\"%s\",\"line\":%lu}}\n"),
+		TINYG_FIRMWARE_BUILD, status, get_status_message(status), (unsigned long)linenum);
+}
+
 stat_t rpt_er(cmdObj_t *cmd)
 {
 	rpt_exception(STAT_GENERIC_EXCEPTION_REPORT);	// bogus exception report
@@ -63,9 +72,11 @@ stat_t rpt_er(cmdObj_t *cmd)
 /**** Application Messages *********************************************************
  * rpt_print_initializing_message()	   - initializing configs from hard-coded profile
  * rpt_print_loading_configs_message() - loading configs from EEPROM
+ * rpt_print_irq_message()			   - interrupt priorities in effect
  * rpt_print_system_ready_message()    - system ready message
  *
- *	These messages are always in JSON format to allow UIs to sync
+ *	These messages are always in JSON format to allow UIs to sync. They carry the boot
+ *	phase times reached so far (see Boot timing in hardware.h)
  */
 
 void _startup_helper(stat_t status, const char *msg)
@@ -78,6 +89,7 @@ void _startup_helper(stat_t status, const char *msg)
 	cmd_add_object((const char_t *)"hp");		// hardware platform
 	cmd_add_object((const char_t *)"hv");		// hardware version
 //	cmd_add_object((const char_t *)"id");		// hardware ID
+	cmd_add_object((const char_t *)"bt");		// boot timing
 	cmd_add_string((const char_t *)"msg", (const char_t *)msg);	// startup message
 	json_print_response(status);
 #endif
@@ -93,6 +105,15 @@ void rpt_print_loading_configs_message(void)
 	_startup_helper(STAT_INITIALIZING, PSTR("Loading configs from EEPROM"));
 }
 
+void rpt_print_irq_message(void)
+{
+#ifndef __SUPPRESS_STARTUP_MESSAGES
+	cmd_reset_list();
+	cmd_add_object((const char_t *)"irq");		// interrupt priorities in effect
+	json_print_response(STAT_OK);
+#endif
+}
+
 void rpt_print_system_ready_message(void)
 {
 	_startup_helper(STAT_OK, PSTR("SYSTEM READY"));
@@ -140,6 +161,9 @@ void rpt_print_system_ready_message(void)
  *		the system into text mode.
  *
  *	  - Automatic status reports in text mode return CSV format according to si setting
+ *
+ *	  - Automatic status reports with verbosity set to binary ($sv=3) return a packed 
+ *		frame in place of the JSON object, in any mode. See sr_run_binary_status_report().
  */
 
 /* 
@@ -157,8 +181,10 @@ void sr_init_status_report()
 
 	for (uint8_t i=0; i < CMD_STATUS_REPORT_LEN ; i++) {
 		if (sr_defaults[i][0] == NUL) break;			// quit on first blank array entry
+		index_t index = cmd_get_index((const char_t *)"", sr_defaults[i]);
+		if (index == NO_MATCH) continue;				// axis not in this build (see AXES)
 		sr.status_report_value[i] = -1234567;			// pre-load values with an unlikely number
-		cmd->value = cmd_get_index((const char_t *)"", sr_defaults[i]);// load the index for the SR element
+		cmd->value = index;								// load the index for the SR element
 		cmd_set(cmd);
 		cmd_persist(cmd);								// conditionally persist - automatic by cmd_persis()
 		cmd->index++;									// increment SR NVM index
@@ -204,16 +230,30 @@ stat_t sr_set_status_report(cmdObj_t *cmd)
  *
  *	Status reports are generally returned with minimal delay (from the controller callback), 
  *	but will not be provided more frequently than the status report interval
+ *
+ *	An immediate request follows a command or the end of a cycle, where anything may 
+ *	have changed, so it marks all elements as changed. Timed requests rely on the 
+ *	change flags set by the runtime - see sr_mark_changed().
+ *
+ *	The interval is a deadline timer (see hardware.h), so the callback tests a flag
+ *	rather than the clock while it waits.
  */
+static void _sr_interval_done() { sr.status_report_due = true;}
+
 stat_t sr_request_status_report(uint8_t request_type)
 {
 	if (request_type == SR_IMMEDIATE_REQUEST) {
-//		sr.status_report_systick = SysTickTimer_getValue();
-		sr.status_report_systick = SysTickTimer.getValue();
+		sr_mark_changed(SR_CHANGED_ALL);
+		hw_deadline_stop(HW_DEADLINE_STATUS_REPORT);
+		sr.status_report_due = true;
 	}
 	if ((request_type == SR_TIMED_REQUEST) && (sr.status_report_requested == false)) {
-//		sr.status_report_systick = SysTickTimer_getValue() + sr.status_report_interval;
-		sr.status_report_systick = SysTickTimer.getValue() + sr.status_report_interval;
+		uint32_t interval = sr.status_report_interval;
+		if ((sr.status_report_verbosity != SR_BINARY) && (interval < STATUS_REPORT_MIN_MS)) {
+			interval = STATUS_REPORT_MIN_MS;
+		}
+		sr.status_report_due = false;
+		hw_deadline_start(HW_DEADLINE_STATUS_REPORT, interval * 1000, _sr_interval_done);
 	}
 	sr.status_report_requested = true;
 	return (STAT_OK);
@@ -223,22 +263,52 @@ stat_t sr_status_report_callback() 		// called by controller dispatcher
 {
 	if (sr.status_report_verbosity == SR_OFF) return (STAT_NOOP);
 	if (sr.status_report_requested == false) return (STAT_NOOP);
-//	if (SysTickTimer_getValue() < sr.status_report_systick) return (STAT_NOOP);
-	if (SysTickTimer.getValue() < sr.status_report_systick) return (STAT_NOOP);
+	if (sr.status_report_due == false) return (STAT_NOOP);
+	if (xio_tx_backed_up(XIO_TELEMETRY) == true) return (STAT_NOOP);	// defer - the report goes out later with the latest values
+	if (json_response_pending() == true) return (STAT_NOOP);			// defer - don't clobber the response going out
 
 	sr.status_report_requested = false;		// disable reports until requested again
+	sr.status_report_due = false;
 
-	if (sr.status_report_verbosity == SR_VERBOSE) {
+	xio_select_port(XIO_TELEMETRY);
+	if (sr.status_report_verbosity == SR_BINARY) {
+		sr_run_binary_status_report(true);
+	} else if (sr.status_report_verbosity == SR_VERBOSE) {
 		sr_populate_unfiltered_status_report();
-	} else {
-		if (sr_populate_filtered_status_report() == false) {	// no new data
-			return (STAT_OK);
-		}
+		cmd_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
+	} else if (sr_populate_filtered_status_report() == true) {	// false if no new data
+		cmd_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
 	}
-	cmd_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
+	xio_select_port(XIO_CONSOLE);
 	return (STAT_OK);
 }
 
+/*
+ * sr_mark_changed() - flag classes of status report elements as changed
+ *
+ *	Called by whatever changes reported state - the runtime for position, velocity
+ *	and line number (from interrupt level), and the state transitions in the 
+ *	canonical machine. A filtered report only fetches and compares the elements in 
+ *	a flagged class. Safe to call from interrupts.
+ */
+void sr_mark_changed(uint8_t flags)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	sr.changed |= flags;
+	__set_PRIMASK(primask);
+}
+
+static uint8_t _sr_take_changed()
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint8_t changed = sr.changed;
+	sr.changed = 0;
+	__set_PRIMASK(primask);
+	return (changed);
+}
+
 /* 
  * sr_run_text_status_report() - generate a text mode status report in multiline format
  */
@@ -249,6 +319,142 @@ stat_t sr_run_text_status_report()
 	return (STAT_OK);
 }
 
+/*
+ * sr_run_binary_status_report() - send a packed binary status report
+ *
+ *	The report is a fixed layout of little-endian values, independent of the SR list:
+ *
+ *	  [0]		SR_BINARY_VERSION
+ *	  [1]		SR_BINARY_BYTES - length of the whole report including these 2 bytes
+ *	  [2-5]		line number (uint32)
+ *	  [6-29]	work position X,Y,Z,A,B,C (int32) in thousandths of mm or degrees
+ *	  [30-33]	velocity (int32) in thousandths of mm per minute
+ *	  [34]		combined machine state (stat)
+ *	  [35]		motion mode (momo)
+ *	  [36]		units mode (unit)
+ *	  [37]		coordinate system (coor)
+ *	  [38]		planner buffers available (qr)
+ *
+ *	Positions and velocity are always in mm - the units byte tells the host how the
+ *	machine is set to display them. The report is sent like a binary Gcode frame: 
+ *	'#', the bytes in base64, '*', the compute_checksum() of the base64 text and a 
+ *	newline. That keeps it on a single line that cannot be mistaken for JSON or 
+ *	text output and can be read with the host's existing line reader. About 60 
+ *	characters replace a JSON object of several hundred.
+ *
+ *	If filtered is true the report is not sent when nothing has changed since the last one.
+ */
+static void _pack_int32(uint8_t *buf, int32_t value)
+{
+	uint32_t v = (uint32_t)value;
+	for (uint8_t i=0; i<4; i++) { buf[i] = (uint8_t)v; v >>= 8;}
+}
+
+stat_t sr_run_binary_status_report(uint8_t filtered)
+{
+	uint8_t report[SR_BINARY_BYTES];
+	uint8_t *wr = report;
+
+	*wr++ = SR_BINARY_VERSION;
+	*wr++ = SR_BINARY_BYTES;
+	_pack_int32(wr, (int32_t)cm_get_linenum(RUNTIME)); wr += 4;
+	mp_hold_runtime_snapshot(true);
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		_pack_int32(wr, (int32_t)lround(mp_get_runtime_work_position(axis) * 1000)); wr += 4;
+	}
+	float velocity = (cm_get_motion_state() == MOTION_STOP) ? 0 : mp_get_runtime_velocity();
+	mp_hold_runtime_snapshot(false);
+	_pack_int32(wr, (int32_t)lround(velocity * 1000)); wr += 4;
+	*wr++ = cm_get_combined_state();
+	*wr++ = cm_get_motion_mode(RUNTIME);
+	*wr++ = cm_get_units_mode(RUNTIME);
+	*wr++ = cm_get_coord_system(RUNTIME);
+	*wr++ = mp_get_planner_buffers_available();
+
+	if ((filtered == true) && (memcmp(report, sr.binary_report, SR_BINARY_BYTES) == 0)) {
+		return (STAT_OK);					// no new data
+	}
+	memcpy(sr.binary_report, report, SR_BINARY_BYTES);
+
+	char_t frame[((SR_BINARY_BYTES+2)/3)*4 + 10];	// base64 text, '#', '*', checksum, newline and NUL
+	char_t *str = frame;
+
+	*str++ = '#';
+	str += base64_encode(str, report, SR_BINARY_BYTES);	// no '=' padding
+	uint16_t checksum = compute_checksum(frame+1, str - frame - 1);
+	*str++ = '*';
+	str += inttoa(str, checksum);
+	*str++ = '\n';
+	*str = NUL;
+	fprintf(stderr, "%s", (char *)frame);
+	return (STAT_OK);
+}
+
+/*
+ * _sr_change_class() - classify an element by the getter that reads it
+ */
+static uint8_t _sr_change_class(fptrCmd get)
+{
+	if ((get == cm_get_pos) || (get == cm_get_mpo) || (get == cm_get_vel)) { 
+		return (SR_CHANGED_MOTION);
+	}
+	if ((get == cm_get_line) || (get == cm_get_unit) || (get == cm_get_coor) || 
+		(get == cm_get_momo) || (get == cm_get_plan) || (get == cm_get_path) || 
+		(get == cm_get_dist) || (get == cm_get_frmo) || (get == cm_get_toolv)) {
+		return (SR_CHANGED_BLOCK);
+	}
+	if ((get == cm_get_stat) || (get == cm_get_macs) || (get == cm_get_cycs) || 
+		(get == cm_get_mots) || (get == cm_get_hold) || (get == cm_get_home)) {
+		return (SR_CHANGED_STATE);
+	}
+	return (SR_CHANGED_ALL);
+}
+
+/*
+ * _sr_get_element() - populate a cmdObj with status report element i
+ *
+ *	The first time an element is seen (or after the list entry changes, which can 
+ *	happen from sr_set_status_report() or directly from the se00-seXX persistence 
+ *	entries) it is fetched the long way with cmd_get_cmdObj() and the flattened 
+ *	token, group and getter are saved. After that only the getter is run.
+ */
+static void _sr_get_element(cmdObj_t *cmd, uint8_t i)
+{
+	index_t index = sr.status_report_list[i];
+
+	if (sr.bound_index[i] != index) {
+		char_t tmp[CMD_TOKEN_LEN+1];
+		cmd->index = index;
+		cmd_get_cmdObj(cmd);
+		strcpy(tmp, cmd->group);			// concatenate groups and tokens
+		strcat(tmp, cmd->token);
+		strcpy(cmd->token, tmp);
+		strcpy(sr.bound_token[i], cmd->token);
+		strcpy(sr.bound_group[i], cmd->group);
+		sr.bound_get[i] = (fptrCmd)GET_TABLE_WORD(get);
+		sr.bound_class[i] = _sr_change_class(sr.bound_get[i]);
+		sr.bound_index[i] = index;
+		return;
+	}
+	cmd_reset_obj(cmd);
+	cmd->index = index;
+	strcpy(cmd->token, sr.bound_token[i]);
+	strcpy(cmd->group, sr.bound_group[i]);
+	sr.bound_get[i](cmd);					// populate the value
+}
+
+static void _sr_setup_parent(cmdObj_t *cmd)
+{
+	const char_t sr_str[] = "sr";
+
+	cmd->objtype = TYPE_PARENT; 			// setup the parent object
+	strcpy(cmd->token, sr_str);
+	if (sr.status_report_index == 0) {		// cfgArray[0] is not "sr", so 0 means not looked up yet
+		sr.status_report_index = cmd_get_index((const char_t *)"", sr_str);
+	}
+	cmd->index = sr.status_report_index;	// set the index - may be needed by calling function
+}
+
 /*
  * sr_populate_unfiltered_status_report() - populate cmdObj body with status values
  *
@@ -257,24 +463,21 @@ stat_t sr_run_text_status_report()
 
 stat_t sr_populate_unfiltered_status_report()
 {
-	const char_t sr_str[] = "sr";
-	char_t tmp[CMD_TOKEN_LEN+1];
 	cmdObj_t *cmd = cmd_reset_list();		// sets *cmd to the start of the body
 
-	cmd->objtype = TYPE_PARENT; 			// setup the parent object
-	strcpy(cmd->token, sr_str);
-	cmd->index = cmd_get_index((const char_t *)"", sr_str);// set the index - may be needed by calling function
+	_sr_setup_parent(cmd);
 	cmd = cmd->nx;							// no need to check for NULL as list has just been reset
 
+	mp_hold_runtime_snapshot(true);			// all elements from the same segment
 	for (uint8_t i=0; i<CMD_STATUS_REPORT_LEN; i++) {
-		if ((cmd->index = sr.status_report_list[i]) == 0) { break;}
-		cmd_get_cmdObj(cmd);
-		strcpy(tmp, cmd->group);			// concatenate groups and tokens
-		strcat(tmp, cmd->token);
-		strcpy(cmd->token, tmp);
-		if ((cmd = cmd->nx) == NULL) 
+		if (sr.status_report_list[i] == 0) { break;}
+		_sr_get_element(cmd, i);
+		if ((cmd = cmd->nx) == NULL) {
+			mp_hold_runtime_snapshot(false);
 			return (cm_alarm(STAT_BUFFER_FULL_FATAL));	// should never be NULL unless SR length exceeds available buffer array
+		}
 	}
+	mp_hold_runtime_snapshot(false);
 	return (STAT_OK);
 }
 
@@ -284,41 +487,39 @@ stat_t sr_populate_unfiltered_status_report()
  *	Designed to be displayed as a JSON object; i;e; no footer or header
  *	Returns 'true' if the report has new data, 'false' if there is nothing to report.
  *
- *	NOTE: Unlike sr_populate_unfiltered_status_report(), this function does NOT set 
- *	the SR index, which is a relatively expensive operation. In current use this 
- *	doesn't matter, but if the caller assumes its set it may lead to a side-effect (bug)
- *
- *	NOTE: Room for improvement - look up the SR index initially and cache it, use the 
- *		  cached value for all remaining reports.
+ *	Only elements whose change class has been flagged are fetched and compared, 
+ *	so an idle machine does almost no work here.
  */
 uint8_t sr_populate_filtered_status_report()
 {
-	const char_t sr_str[] = "sr";
 	uint8_t has_data = false;
-	char_t tmp[CMD_TOKEN_LEN+1];
+	uint8_t changed = _sr_take_changed();
+	if (changed == 0) { return (false);}
+
 	cmdObj_t *cmd = cmd_reset_list();		// sets cmd to the start of the body
 
-	cmd->objtype = TYPE_PARENT; 			// setup the parent object
-	strcpy(cmd->token, sr_str);
-//	cmd->index = cmd_get_index((const char_t *)"", sr_str);// OMITTED - set the index - may be needed by calling function
+	_sr_setup_parent(cmd);
 	cmd = cmd->nx;							// no need to check for NULL as list has just been reset
 
+	mp_hold_runtime_snapshot(true);			// all elements from the same segment
 	for (uint8_t i=0; i<CMD_STATUS_REPORT_LEN; i++) {
-		if ((cmd->index = sr.status_report_list[i]) == 0) { break;}
+		if (sr.status_report_list[i] == 0) { break;}
+		if ((sr.bound_index[i] == sr.status_report_list[i]) && ((sr.bound_class[i] & changed) == 0)) { continue;}
 
-		cmd_get_cmdObj(cmd);
+		_sr_get_element(cmd, i);
 		if (fp_EQ(cmd->value, sr.status_report_value[i])) {
 			cmd->objtype = TYPE_EMPTY;
 			continue;
 		} else {
-			strcpy(tmp, cmd->group);		// flatten out groups
-			strcat(tmp, cmd->token);
-			strcpy(cmd->token, tmp);
 			sr.status_report_value[i] = cmd->value;
-			if ((cmd = cmd->nx) == NULL) return (false); // should never be NULL unless SR length exceeds available buffer array
+			if ((cmd = cmd->nx) == NULL) {		// should never be NULL unless SR length exceeds available buffer array
+				has_data = false;
+				break;
+			}
 			has_data = true;
 		}
 	}
+	mp_hold_runtime_snapshot(false);
 	return (has_data);
 }
 
@@ -335,15 +536,130 @@ stat_t sr_set(cmdObj_t *cmd) { return (sr_set_status_report(cmd));}
 
 stat_t sr_set_si(cmdObj_t *cmd)
 {
-	if (cmd->value < STATUS_REPORT_MIN_MS) { cmd->value = STATUS_REPORT_MIN_MS;}
+	if (cmd->value < SR_BINARY_MIN_MS) { cmd->value = SR_BINARY_MIN_MS;}	// STATUS_REPORT_MIN_MS applies unless binary
 	sr.status_report_interval = (uint32_t)cmd->value;
 	return(STAT_OK);
 }
 
+/*****************************************************************************
+ * Subscriptions - see report.h
+ *
+ * sr_subscription_callback() - main loop callback to send the next subscription due
+ * su_get()		- get a subscription's current values
+ * su_set()		- set a subscription's elements
+ * su_set_i()	- set a subscription's interval
+ * su_set_v()	- set a subscription's verbosity
+ *
+ *	The subscription is found from the token - su1 is sr.sub[0]. The interval and 
+ *	verbosity tokens set the subscription through their cfgArray target.
+ */
+static srSubscription_t *_su_get_sub(cmdObj_t *cmd) { return (&sr.sub[cmd->token[2] - '1']);}
+
+/*
+ * _su_populate() - populate the cmdObj list with a subscription's values
+ *
+ *	Returns false if filtered and nothing has changed since the last report
+ */
+static uint8_t _su_populate(srSubscription_t *s, uint8_t filtered)
+{
+	uint8_t has_data = false;
+	cmdObj_t *cmd = cmd_reset_list();
+	const char_t su_str[] = "su1";
+
+	cmd->objtype = TYPE_PARENT;
+	strcpy(cmd->token, su_str);
+	cmd->token[2] += (s - sr.sub);
+	cmd->index = cmd_get_index((const char_t *)"", cmd->token);
+	cmd = cmd->nx;
+
+	mp_hold_runtime_snapshot(true);				// all elements from the same segment
+	for (uint8_t i=0; i<SR_SUBSCRIPTION_LEN; i++) {
+		if (s->list[i] == 0) { break;}
+		char_t tmp[CMD_TOKEN_LEN+1];
+		cmd->index = s->list[i];
+		cmd_get_cmdObj(cmd);
+		strcpy(tmp, cmd->group);				// concatenate groups and tokens
+		strcat(tmp, cmd->token);
+		strcpy(cmd->token, tmp);
+		if ((filtered == true) && (fp_EQ(cmd->value, s->value[i]))) {
+			cmd->objtype = TYPE_EMPTY;
+			continue;
+		}
+		s->value[i] = cmd->value;
+		has_data = true;
+		if ((cmd = cmd->nx) == NULL) { break;}
+	}
+	mp_hold_runtime_snapshot(false);
+	return (has_data);
+}
+
+stat_t sr_subscription_callback()			// called by controller dispatcher
+{
+	if (xio_tx_backed_up(XIO_TELEMETRY) == true) return (STAT_NOOP);
+	if (json_response_pending() == true) return (STAT_NOOP);
+
+	uint32_t now = SysTickTimer.getValue();
+	for (uint8_t n=0; n<SR_SUBSCRIPTIONS; n++) {
+		srSubscription_t *s = &sr.sub[n];
+		if ((s->verbosity == SR_OFF) || (s->list[0] == 0)) { continue;}
+		if ((int32_t)(now - s->next) < 0) { continue;}
+		s->next = now + max(s->interval, (uint32_t)STATUS_REPORT_MIN_MS);
+		if (_su_populate(s, (s->verbosity == SR_FILTERED)) == true) {
+			xio_select_port(XIO_TELEMETRY);
+			cmd_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
+			xio_select_port(XIO_CONSOLE);
+		}
+		return (STAT_OK);						// one report per pass
+	}
+	return (STAT_NOOP);
+}
+
+stat_t su_get(cmdObj_t *cmd)
+{
+	_su_populate(_su_get_sub(cmd), false);
+	return (STAT_OK);
+}
+
+stat_t su_set(cmdObj_t *cmd)
+{
+	srSubscription_t *s = _su_get_sub(cmd);
+	index_t list[SR_SUBSCRIPTION_LEN];
+	memset(list, 0, sizeof(list));
+
+	for (uint8_t i=0; i<=SR_SUBSCRIPTION_LEN; i++) {
+		if (((cmd = cmd->nx) == NULL) || (cmd->objtype == TYPE_EMPTY)) { break;}
+		if ((i == SR_SUBSCRIPTION_LEN) || (cmd->objtype != TYPE_BOOL) || (fp_FALSE(cmd->value))) {
+			return (STAT_INPUT_VALUE_UNSUPPORTED);
+		}
+		list[i] = cmd->index;
+	}
+	if (list[0] == 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	memcpy(s->list, list, sizeof(list));
+	for (uint8_t i=0; i<SR_SUBSCRIPTION_LEN; i++) { s->value[i] = -1234567;}	// an unlikely number
+	s->next = SysTickTimer.getValue();
+	_su_populate(s, false);						// return current values
+	return (STAT_OK);
+}
+
+stat_t su_set_i(cmdObj_t *cmd)
+{
+	if (cmd->value < 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_int(cmd);
+	return (STAT_OK);
+}
+
+stat_t su_set_v(cmdObj_t *cmd)
+{
+	if ((cmd->value < SR_OFF) || (cmd->value > SR_VERBOSE)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	return (STAT_OK);
+}
+
 /*****************************************************************************
  * Queue Reports
  *
  * qr_get() 					- run a queue report (as data)
+ * qr_get_qt()					- get ms of movement & dwell in the queue (as data)
  * qr_clear_queue_report()		- wipe stored values
  * qr_request_queue_report()	- request a queue report with current values
  * qr_queue_report_callback()	- run the queue report w/stored values
@@ -356,6 +672,13 @@ stat_t qr_get(cmdObj_t *cmd)
 	return (STAT_OK);
 }
 
+stat_t qr_get_qt(cmdObj_t *cmd) 
+{
+	cmd->value = (float)mp_get_planner_queue_time();
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
 void qr_clear_queue_report()
 {
 	qr.request = false;
@@ -365,9 +688,10 @@ void qr_clear_queue_report()
 
 void qr_request_queue_report(int8_t buffers)
 {
-	if (qr.queue_report_verbosity == QR_OFF) return;
+	if ((qr.queue_report_verbosity == QR_OFF) || (qr.queue_report_verbosity == QR_FOOTER)) return;
 
 	qr.buffers_available = mp_get_planner_buffers_available();
+	qr.queue_time = mp_get_planner_queue_time();
 
 	if (buffers > 0) {
 		qr.buffers_added += buffers;
@@ -378,29 +702,46 @@ void qr_request_queue_report(int8_t buffers)
 	qr.request = true;
 }
 
+static void _qr_holdoff_done() { qr.holdoff = false;}
+
 uint8_t qr_queue_report_callback()
 {
 	if (qr.request == false) { return (STAT_NOOP);}
+	uint8_t change = (qr.buffers_available > qr.reported_available) ?
+		qr.buffers_available - qr.reported_available : qr.reported_available - qr.buffers_available;
+	if ((change < qr.queue_report_hysteresis) &&
+		(qr.buffers_available != 0) && (qr.buffers_available != PLANNER_BUFFER_POOL_SIZE)) {
+		return (STAT_NOOP);												// hold - not enough change to report
+	}
+	if (qr.holdoff == true) { return (STAT_NOOP);}						// hold - too soon after the last one
+	if (xio_tx_backed_up(XIO_TELEMETRY) == true) { return (STAT_NOOP);}	// defer - later requests fold into this one
+	if (json_response_pending() == true) { return (STAT_NOOP);}			// defer - don't clobber the response going out
 	qr.request = false;
+	qr.reported_available = qr.buffers_available;
+	qr.holdoff = true;
+	hw_deadline_start(HW_DEADLINE_QUEUE_REPORT, qr.queue_report_interval * 1000, _qr_holdoff_done);
+
+	xio_select_port(XIO_TELEMETRY);
 
 	if (cfg.comm_mode == TEXT_MODE) {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
-			fprintf(stderr, "qr:%d\n", qr.buffers_available);
+			fprintf(stderr, "qr:%d,qt:%lu\n", qr.buffers_available, (unsigned long)qr.queue_time);
 		} else  {
 			if (qr.queue_report_verbosity == QR_TRIPLE) {
-				fprintf(stderr, "qr:%d,added:%d,removed:%d\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+				fprintf(stderr, "qr:%d,added:%d,removed:%d,qt:%lu\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed, (unsigned long)qr.queue_time);
 			}
 		}
 	} else {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
-			fprintf(stderr, "{\"qr\":%d}\n", qr.buffers_available);
+			fprintf(stderr, "{\"qr\":%d,\"qt\":%lu}\n", qr.buffers_available, (unsigned long)qr.queue_time);
 		} else {
 			if (qr.queue_report_verbosity == QR_TRIPLE) {
-				fprintf(stderr, "{\"qr\":[%d,%d,%d]}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+				fprintf(stderr, "{\"qr\":[%d,%d,%d],\"qt\":%lu}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed, (unsigned long)qr.queue_time);
 				qr_clear_queue_report();
 			}
 		}
 	}
+	xio_select_port(XIO_CONSOLE);
 	return (STAT_OK);
 }
 /* Alternate Formulation - using cmdObj list
@@ -429,20 +770,33 @@ uint8_t qr_queue_report_callback()
  * sr_print_sr() - produce SR text output
  */
 static const char fmt_si[] PROGMEM = "[si]  status interval%14.0f ms\n";
-static const char fmt_sv[] PROGMEM = "[sv]  status report verbosity%6d [0=off,1=filtered,2=verbose]\n";
+static const char fmt_sv[] PROGMEM = "[sv]  status report verbosity%6d [0=off,1=filtered,2=verbose,3=binary]\n";
 
 void sr_print_sr(cmdObj_t *cmd) { sr_populate_unfiltered_status_report();}
 void sr_print_si(cmdObj_t *cmd) { text_print_flt(cmd, fmt_si);}
 void sr_print_sv(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_sv);}
 
+static const char fmt_sui[] PROGMEM = "[%s] subscription interval%9.0f ms\n";
+static const char fmt_suv[] PROGMEM = "[%s] subscription verbosity%8d [0=off,1=filtered,2=verbose]\n";
+
+void su_print_su(cmdObj_t *cmd) { su_get(cmd);}
+void su_print_i(cmdObj_t *cmd) { fprintf_P(stderr, fmt_sui, cmd->token, cmd->value);}
+void su_print_v(cmdObj_t *cmd) { fprintf_P(stderr, fmt_suv, cmd->token, (int)cmd->value);}
+
 /*
  * qr_print_qr() - produce QR text output
  */
 static const char fmt_qr[] PROGMEM = "qr:%d\n";
-static const char fmt_qv[] PROGMEM = "[qv]  queue report verbosity%7d [0=off,1=filtered,2=verbose]\n";
+static const char fmt_qt[] PROGMEM = "qt:%d\n";
+static const char fmt_qv[] PROGMEM = "[qv]  queue report verbosity%7d [0=off,1=single,2=triple,3=footer]\n";
+static const char fmt_qi[] PROGMEM = "[qi]  queue report interval%8.0f ms\n";
+static const char fmt_qh[] PROGMEM = "[qh]  queue report hysteresis%6d buffers\n";
 
 void qr_print_qr(cmdObj_t *cmd) { text_print_int(cmd, fmt_qr);}
+void qr_print_qt(cmdObj_t *cmd) { text_print_int(cmd, fmt_qt);}
 void qr_print_qv(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_qv);}
+void qr_print_qi(cmdObj_t *cmd) { text_print_flt(cmd, fmt_qi);}
+void qr_print_qh(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_qh);}
 
 #endif // __TEXT_MODE
 
@@ -41,9 +41,21 @@ extern "C"{
 enum srVerbosity {								// status report enable and verbosity
 	SR_OFF = 0,									// no reports
 	SR_FILTERED,								// reports only values that have changed from the last report
-	SR_VERBOSE									// reports all values specified
+	SR_VERBOSE,									// reports all values specified
+	SR_BINARY									// reports a packed binary frame - see sr_run_binary_status_report()
 };
 
+enum srChangeFlags {							// what has changed since the last filtered report
+	SR_CHANGED_MOTION = 0x01,					// runtime position and velocity
+	SR_CHANGED_BLOCK = 0x02,					// line number and the other Gcode model values
+	SR_CHANGED_STATE = 0x04,					// machine, cycle, motion, feedhold and homing states
+	SR_CHANGED_ALL = 0xFF						// elements not in a class above are fetched on any change
+};
+
+#define SR_BINARY_VERSION 1						// binary status report layout version - bump on any change
+#define SR_BINARY_BYTES (2+4+(AXES*4)+4+5)		// header, line, positions, velocity, states and queue
+#define SR_BINARY_MIN_MS 10						// binary reports may run faster than STATUS_REPORT_MIN_MS
+
 enum cmStatusReportRequest {
 	SR_TIMED_REQUEST = 0,						// request a status report at next timer interval
 	SR_IMMEDIATE_REQUEST						// request a status report ASAP
@@ -52,9 +64,49 @@ enum cmStatusReportRequest {
 enum qrVerbosity {								// planner queue enable and verbosity
 	QR_OFF = 0,									// no response is provided
 	QR_SINGLE,									// queue depth reported
-	QR_TRIPLE									// queue depth reported for buffers, buffers added, buffered removed
+	QR_TRIPLE,									// queue depth reported for buffers, buffers added, buffered removed
+	QR_FOOTER									// no reports - queue depth rides on each response instead
 };
 
+/* Queue reports are coalesced. A report goes out no sooner than $qi ms after the last
+ * one, and only once the free buffer count has moved $qh or more from what was last
+ * reported - or the queue has gone full or empty, which always reports. Changes held
+ * back are not lost; the next report carries the then current count and the added and
+ * removed totals. With $qv=3 no reports are sent: the JSON footer is sent in the flow
+ * control style (see _json_footer_values()) and the text prompt carries qr:n.
+ */
+
+/* Subscriptions
+ *	Besides the status report a host can subscribe to SR_SUBSCRIPTIONS more reports, 
+ *	each with its own elements, interval and change filter, so every value goes out 
+ *	only as often as it is needed - say position at 20 Hz, spindle and feed at 2 Hz 
+ *	and counters every 5 seconds:
+ *
+ *	  {"su1":{"posx":t,"posy":t,"posz":t,"vel":t}}  {"su1i":50}   {"su1v":1}
+ *	  {"su2":{"sps":t,"feed":t,"tool":t}}           {"su2i":500}  {"su2v":1}
+ *	  {"su3":{"segun":t,"seglt":t}}                 {"su3i":5000} {"su3v":2}
+ *
+ *	A subscription sends {"su1":{...}} every $su1i ms (no faster than 
+ *	STATUS_REPORT_MIN_MS) while $su1v is 1 (only the values that have changed, and 
+ *	nothing if none have) or 2 (all of them). It is off at 0, which is where they all
+ *	start - subscriptions are not persisted, the host sets them up when it connects.
+ *	Reports are sent by sr_subscription_callback() one per controller pass, are held
+ *	back like status reports while the telemetry port is backed up or a response is
+ *	going out, and don't change when the status report runs. {"su1":""} gets the 
+ *	current values.
+ */
+#define SR_SUBSCRIPTIONS 3						// subscriptions - su1 to su3
+// **** must also line up in cfgArray, su1 - suN ****
+#define SR_SUBSCRIPTION_LEN 8					// max elements in a subscription
+
+typedef struct srSubscription {
+	uint8_t verbosity;							// SR_OFF, SR_FILTERED or SR_VERBOSE
+	uint32_t interval;							// ms between reports
+	uint32_t next;								// systick the next report is due
+	index_t list[SR_SUBSCRIPTION_LEN];			// elements to report - 0 ends the list
+	float value[SR_SUBSCRIPTION_LEN];			// previous values for filtered reporting
+} srSubscription_t;
+
 typedef struct srSingleton {
 
 	/*** config values (PUBLIC) ***/
@@ -63,9 +115,21 @@ typedef struct srSingleton {
 
 	/*** runtime values (PRIVATE) ***/
 	uint8_t status_report_requested;					// flag that SR has been requested
-	uint32_t status_report_systick;						// SysTick value for next status report
+	uint8_t status_report_due;							// TRUE once the interval is up - see HW_DEADLINE_STATUS_REPORT
 	index_t status_report_list[CMD_STATUS_REPORT_LEN];	// status report elements to report
 	float status_report_value[CMD_STATUS_REPORT_LEN];	// previous values for filtered reporting
+	index_t status_report_index;						// index of the "sr" parent - 0 until looked up
+
+	// element bindings - resolved once per element, so reports only run the getters
+	index_t bound_index[CMD_STATUS_REPORT_LEN];			// index the binding was made for - 0 is unbound
+	fptrCmd bound_get[CMD_STATUS_REPORT_LEN];			// getter from the cfgArray
+	char_t bound_token[CMD_STATUS_REPORT_LEN][CMD_TOKEN_LEN+1];	// flattened group + token
+	char_t bound_group[CMD_STATUS_REPORT_LEN][CMD_GROUP_LEN+1];
+	uint8_t bound_class[CMD_STATUS_REPORT_LEN];			// srChangeFlags that make the element worth fetching
+	volatile uint8_t changed;							// srChangeFlags set since the last filtered report
+	uint8_t binary_report[SR_BINARY_BYTES];				// previous binary report for filtering
+
+	srSubscription_t sub[SR_SUBSCRIPTIONS];				// see Subscriptions
 
 } srSingleton_t;
 
@@ -73,13 +137,18 @@ typedef struct qrSingleton {		// data for queue reports
 
 	/*** config values (PUBLIC) ***/
 	uint8_t queue_report_verbosity;	// queue reports enabled and verbosity level
+	uint32_t queue_report_interval;	// minimum ms between reports
+	uint8_t queue_report_hysteresis;// buffers the count must move before it is reported
 
 	/*** runtime values (PRIVATE) ***/
 	uint8_t request;				// set to true to request a report
+	uint8_t reported_available;		// buffers available in the last report sent
+	uint8_t holdoff;				// TRUE until the interval after a report is up - see HW_DEADLINE_QUEUE_REPORT
 	uint8_t buffers_available;		// stored value used by callback
 	uint8_t prev_available;			// used to filter reports
 	uint8_t buffers_added;			// buffers added since last report
 	uint8_t buffers_removed;		// buffers removed since last report
+	uint32_t queue_time;			// ms of movement & dwell in the planner queue
 
 } qrSingleton_t;
 
@@ -92,27 +161,38 @@ extern qrSingleton_t qr;
 
 void rpt_print_message(char *msg);
 void rpt_exception(uint8_t status);
+void rpt_line_exception(uint8_t status, uint32_t linenum);
 
 stat_t rpt_er(cmdObj_t *cmd);
 void rpt_print_loading_configs_message(void);
 void rpt_print_initializing_message(void);
+void rpt_print_irq_message(void);
 void rpt_print_system_ready_message(void);
 
 void sr_init_status_report(void);
 
 stat_t sr_set_status_report(cmdObj_t *cmd);
 stat_t sr_request_status_report(uint8_t request_type);
+void sr_mark_changed(uint8_t flags);
 stat_t sr_status_report_callback(void);
 stat_t sr_run_text_status_report(void);
+stat_t sr_run_binary_status_report(uint8_t filtered);
 stat_t sr_populate_unfiltered_status_report(void);
 uint8_t sr_populate_filtered_status_report(void);
 
 stat_t sr_get(cmdObj_t *cmd);
 stat_t sr_set(cmdObj_t *cmd);
 stat_t sr_set_si(cmdObj_t *cmd);
+
+stat_t sr_subscription_callback(void);
+stat_t su_get(cmdObj_t *cmd);
+stat_t su_set(cmdObj_t *cmd);
+stat_t su_set_i(cmdObj_t *cmd);
+stat_t su_set_v(cmdObj_t *cmd);
 //void sr_print_sr(cmdObj_t *cmd);
 
 stat_t qr_get(cmdObj_t *cmd);
+stat_t qr_get_qt(cmdObj_t *cmd);
 void qr_clear_queue_report(void);
 void qr_request_queue_report(int8_t buffers);
 stat_t qr_queue_report_callback(void);
@@ -122,16 +202,28 @@ stat_t qr_queue_report_callback(void);
 	void sr_print_sr(cmdObj_t *cmd);
 	void sr_print_si(cmdObj_t *cmd);
 	void sr_print_sv(cmdObj_t *cmd);
+	void su_print_su(cmdObj_t *cmd);
+	void su_print_i(cmdObj_t *cmd);
+	void su_print_v(cmdObj_t *cmd);
 	void qr_print_qv(cmdObj_t *cmd);
 	void qr_print_qr(cmdObj_t *cmd);
+	void qr_print_qt(cmdObj_t *cmd);
+	void qr_print_qi(cmdObj_t *cmd);
+	void qr_print_qh(cmdObj_t *cmd);
 
 #else
 
 	#define sr_print_sr tx_print_stub
 	#define sr_print_si tx_print_stub
 	#define sr_print_sv tx_print_stub
+	#define su_print_su tx_print_stub
+	#define su_print_i tx_print_stub
+	#define su_print_v tx_print_stub
 	#define qr_print_qv tx_print_stub
 	#define qr_print_qr tx_print_stub
+	#define qr_print_qt tx_print_stub
+	#define qr_print_qi tx_print_stub
+	#define qr_print_qh tx_print_stub
 
 #endif // __TEXT_MODE
 
@@ -0,0 +1,327 @@
+/*
+ * servo.cpp - analog velocity output for servo axes
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	See Analog servo axes in servo.h
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "stepper.h"
+#include "servo.h"
+#include "encoder.h"
+#include "hardware.h"
+#include "text_parser.h"
+#include "util.h"
+
+#ifndef __SIM
+#include "MotateTimers.h"
+using Motate::Timer;
+
+static Timer<servo_timer_num> servo_timer(Motate::kTimerUpToMatch, SV_SAMPLE_RATE);	// sample clock - see _dac_init()
+#endif
+
+#define SV_TIMER_CLOCK (F_CPU/2)	// sample clock counts a second - TIMER_CLOCK1, which the timer picks for SV_SAMPLE_RATE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+svServoSingleton_t sv;
+
+static uint8_t _servo_map(void);
+static float _correction(const uint8_t motor, const float error);
+static uint16_t _code(const uint8_t channel, const uint8_t motor, const float velocity);
+static void _dac_init(void);
+static void _dac_write(void);
+
+/*
+ * servo_init() - start the DAC channels of the analog motors
+ *
+ *	The settings are loaded before this is called.
+ */
+
+void servo_init()
+{
+	_servo_map();
+	_dac_init();
+}
+
+/*
+ * _servo_map() - find the motor on each channel. TRUE if two motors asked for one
+ */
+
+static uint8_t _servo_map()
+{
+	uint8_t shared = false;
+	sv.channels = 0;
+	for (uint8_t channel=0; channel<SERVO_CHANNELS; channel++) { sv.motor[channel] = -1;}
+	for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) {
+		if (st.m[motor].output == MOTOR_OUTPUT_STEP) { continue;}
+		uint8_t channel = st.m[motor].output - MOTOR_OUTPUT_DAC0;
+		if (sv.motor[channel] >= 0) {
+			shared = true;							// the first motor keeps it
+			continue;
+		}
+		sv.motor[channel] = motor;
+		sv.channels++;
+	}
+	return (shared);
+}
+
+/*
+ * sv_prep() - set up the DAC ramps of the segment being prepped
+ *
+ *	Ticks are the segment time at FREQUENCY_DDA. The analog motors' travel is in
+ *	servo_substeps - st_prep_line() kept it out of the DDA. A dwell has none, so its
+ *	ramp runs down to zero velocity.
+ */
+
+void sv_prep(stPrepBuffer_t *sp, const uint32_t ticks)
+{
+	sp->servo_samples = 0;
+	if ((sv.channels == 0) || (ticks == 0)) { return;}	// a dwell too short to run
+
+	float seconds = (float)ticks / FREQUENCY_DDA;
+	uint32_t samples = (uint32_t)(seconds * SV_SAMPLE_RATE);
+	if (samples > SV_SAMPLES_MAX) { samples = SV_SAMPLES_MAX;}
+	if (samples == 0) { samples = 1;}
+	sp->servo_samples = samples;
+	sp->servo_period = (uint32_t)(seconds * SV_TIMER_CLOCK / (samples * sv.channels));
+
+	for (uint8_t channel=0; channel<SERVO_CHANNELS; channel++) {
+		if (sv.motor[channel] < 0) { continue;}
+		uint8_t motor = sv.motor[channel];
+		float velocity = (float)sp->m[motor].servo_substeps / DDA_SUBSTEPS / seconds;
+		float end = velocity + (velocity - sv.velocity[channel]) / 2;
+		if ((end * velocity) <= 0) { end = 0;}		// the ramp doesn't cross zero
+
+		float correction = 0;
+		for (uint8_t i=0; i<ENCODERS; i++) {
+			if ((en.en[i].motor == motor+1) && (en.en[i].resync == false)) {
+				correction = _correction(motor, en.en[i].error);
+			}
+		}
+		sp->servo_start[channel] = _code(channel, motor, sv.end[channel] + correction);
+		sp->servo_end[channel] = _code(channel, motor, end + correction);
+		sv.velocity[channel] = velocity;
+		sv.end[channel] = end;
+	}
+}
+
+/*
+ * sv_servo_callback() - hold the stopped analog motors on their encoders
+ *
+ *	Runs every controller pass, but only updates the DACs every SV_HOLD_USEC while
+ *	the steppers are idle. In alarm the DACs stay at zero velocity.
+ */
+
+stat_t sv_servo_callback()
+{
+	if ((sv.channels == 0) || (stepper_isbusy() == true)) { return (STAT_NOOP);}
+	uint32_t now = hw_get_usec();
+	if ((now - sv.hold_usec) < SV_HOLD_USEC) { return (STAT_NOOP);}	// uint32_t math handles wrap
+	sv.hold_usec = now;
+
+	for (uint8_t channel=0; channel<SERVO_CHANNELS; channel++) {
+		if (sv.motor[channel] < 0) { continue;}
+		uint8_t motor = sv.motor[channel];
+		float velocity = 0;
+		for (uint8_t i=0; i<ENCODERS; i++) {
+			if ((en.en[i].motor == motor+1) && (cm.machine_state != MACHINE_ALARM)) {
+				velocity = _correction(motor, en_read_error(i, st_get_motor_position(motor)));
+			}
+		}
+		sv.code[channel] = _code(channel, motor, velocity);
+	}
+	_dac_write();
+	return (STAT_OK);
+}
+
+/*
+ * _correction() - velocity that takes out a following error, in steps/sec
+ * _code()		  - DAC code for a velocity in steps/sec, clipped to full scale
+ */
+
+static float _correction(const uint8_t motor, const float error)
+{
+	return (-sv.gain * error);
+}
+
+static uint16_t _code(const uint8_t channel, const uint8_t motor, const float velocity)
+{
+	if ((sv.full_scale[channel] < EPSILON) || (st.m[motor].steps_per_unit < EPSILON)) { return (SV_DAC_ZERO);}
+	float scale = velocity * 60 / st.m[motor].steps_per_unit / sv.full_scale[channel];
+	if (st.m[motor].polarity != 0) { scale = -scale;}
+	scale = max(-1, min(scale, 1));
+	return ((uint16_t)(SV_DAC_ZERO + (int16_t)(scale * SV_DAC_SPAN + ((scale < 0) ? -0.5 : 0.5))));
+}
+
+/*
+ * _dac_init() - set up the DACC and its sample clock for the channels in use
+ * sv_load()   - start the DAC ramps of a segment as the loader starts it
+ * sv_stop()   - go to zero velocity now
+ * _dac_write() - convert sv.code[] at the next sample clock
+ *
+ *	The DACC runs in word mode with tags: each 32 bit word the PDC hands it is two
+ *	conversions, low half first, and bits 12-13 of each half pick the channel. A
+ *	rising edge on TIOA0 starts each conversion. sv_load() fills the DAC buffer the
+ *	PDC isn't reading, hands it over and restarts the sample clock at the segment's
+ *	period, so the ramp starts with the segment. The last conversion of an odd count
+ *	is repeated to fill the word.
+ */
+
+#ifndef __SIM
+
+static void _dac_init()
+{
+	if (sv.channels == 0) {
+		servo_timer.stop();
+		DACC->DACC_CHDR = DACC_CHDR_CH0 | DACC_CHDR_CH1;	// the vref pins go back to their PWMs
+		return;
+	}
+	PMC->PMC_PCER1 = (1u << (ID_DACC - 32));	// clock the DAC
+	DACC->DACC_PTCR = DACC_PTCR_TXTDIS;
+	DACC->DACC_CR = DACC_CR_SWRST;
+	DACC->DACC_MR = DACC_MR_TRGEN | DACC_MR_TRGSEL(1) | DACC_MR_WORD | DACC_MR_TAG |
+					DACC_MR_REFRESH(8) | DACC_MR_STARTUP_64;
+	DACC->DACC_ACR = DACC_ACR_IBCTLCH0(2) | DACC_ACR_IBCTLCH1(2) | DACC_ACR_IBCTLDACCORE(1);
+	DACC->DACC_CHER = ((sv.motor[0] >= 0) ? DACC_CHER_CH0 : 0) | ((sv.motor[1] >= 0) ? DACC_CHER_CH1 : 0);
+	DACC->DACC_TCR = 0;
+	DACC->DACC_PTCR = DACC_PTCR_TXTEN;
+
+	uint32_t period = SV_TIMER_CLOCK / (SV_SAMPLE_RATE * sv.channels);
+	servo_timer.setOutputOptions(Motate::kSetAOnCompareA | Motate::kClearAOnMatch);
+	servo_timer.setTop(period);
+	servo_timer.setExactDutyCycleA(period/2);
+	servo_timer.start();
+	sv_stop();
+}
+
+void sv_load(const stPrepBuffer_t *sp)
+{
+	if (sp->servo_samples == 0) { return;}
+	uint16_t *conversion = (uint16_t *)sv.dac[sv.fill];
+	uint16_t count = 0;
+	int32_t code[SERVO_CHANNELS];
+	int32_t step[SERVO_CHANNELS];
+	for (uint8_t channel=0; channel<SERVO_CHANNELS; channel++) {	// Q16.16 codes
+		code[channel] = (int32_t)sp->servo_start[channel] << 16;
+		step[channel] = (((int32_t)sp->servo_end[channel] - sp->servo_start[channel]) << 16) / sp->servo_samples;
+	}
+	for (uint16_t i=0; i<sp->servo_samples; i++) {
+		for (uint8_t channel=0; channel<SERVO_CHANNELS; channel++) {
+			if (sv.motor[channel] < 0) { continue;}
+			code[channel] += step[channel];
+			conversion[count++] = (uint16_t)((code[channel] + 0x8000) >> 16) | (channel << 12);
+		}
+	}
+	if ((count & 1) != 0) {
+		conversion[count] = conversion[count-1];
+		count++;
+	}
+	DACC->DACC_TPR = (uint32_t)sv.dac[sv.fill];
+	DACC->DACC_TCR = count / 2;
+	sv.fill ^= 1;
+	servo_timer.setTop(sp->servo_period);
+	servo_timer.setExactDutyCycleA(sp->servo_period/2);
+	servo_timer.start();
+}
+
+void sv_stop()
+{
+	for (uint8_t channel=0; channel<SERVO_CHANNELS; channel++) {
+		sv.velocity[channel] = 0;
+		sv.end[channel] = 0;
+		sv.code[channel] = SV_DAC_ZERO;
+	}
+	if (sv.channels == 0) { return;}
+	DACC->DACC_TCR = 0;
+	_dac_write();
+}
+
+static void _dac_write()
+{
+	uint32_t word = 0;
+	uint8_t half = 0;
+	for (uint8_t channel=0; channel<SERVO_CHANNELS; channel++) {
+		if (sv.motor[channel] < 0) { continue;}
+		word |= (uint32_t)(sv.code[channel] | (channel << 12)) << (half++ * 16);
+	}
+	if (half == 1) { word |= word << 16;}
+	if ((DACC->DACC_ISR & DACC_ISR_TXRDY) != 0) { DACC->DACC_CDR = word;}	// else the next hold has it
+}
+
+#else // __SIM
+
+static void _dac_init() {}
+void sv_load(const stPrepBuffer_t *sp) {}
+static void _dac_write() {}
+
+void sv_stop()
+{
+	for (uint8_t channel=0; channel<SERVO_CHANNELS; channel++) {
+		sv.velocity[channel] = 0;
+		sv.end[channel] = 0;
+		sv.code[channel] = SV_DAC_ZERO;
+	}
+}
+
+#endif // __SIM
+
+/*
+ * sv_set_ot() - set a motor's output and restart the DACs
+ */
+
+stat_t sv_set_ot(cmdObj_t *cmd)
+{
+	if (cmd->value >= MOTOR_OUTPUT_TYPES) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	if (_servo_map() == true) {
+		cmd_add_conditional_message((const char_t *)"*** WARNING *** Two motors on one DAC channel - the first is driven");
+	}
+	_dac_init();
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_0ot[] PROGMEM = "[%s%s] m%s output%20d [0=step and direction,1=DAC0,2=DAC1]\n";
+static const char fmt_aok[] PROGMEM = "[aok]  position loop gain%16.2f 1/sec\n";
+static const char fmt_aofs[] PROGMEM = "[ao%c]  DAC%d full scale velocity%10.1f per min\n";
+
+void sv_print_ot(cmdObj_t *cmd) { fprintf_P(stderr, fmt_0ot, cmd->group, cmd->token, cmd->group, (uint8_t)cmd->value);}
+void sv_print_k(cmdObj_t *cmd) { text_print_flt(cmd, fmt_aok);}
+
+void sv_print_fs(cmdObj_t *cmd)				// tokens end in a for DAC0, b for DAC1
+{
+	const char *t = (const char *)cmd->token;	// the group prefix is only there outside the group
+	char dac = t[strlen(t)-1];
+	fprintf_P(stderr, fmt_aofs, dac, (dac == 'b') ? 1 : 0, (double)cmd->value);
+}
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,119 @@
+/*
+ * servo.h - analog velocity output for servo axes
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Analog servo axes
+ *	A motor can drive a velocity mode servo amplifier from one of the two DAC channels
+ *	in place of step and direction ($1ot=1 for DAC0, 2 for DAC1). It runs the same
+ *	segments as the steppers: st_prep_line() takes its travel out of the DDA and
+ *	sv_prep() turns it into a velocity, and _load_move() starts its DAC samples as the
+ *	DDA starts the segment. Its motor position (see Motor positions in stepper.h) is
+ *	counted from the same substeps, so kinematics, latches and the encoder see it
+ *	like any other motor.
+ *
+ *	A segment has one velocity. The DAC ramps across it, from where the last segment
+ *	ended to the segment velocity plus half the change from the last one - which is
+ *	where the runtime's velocity is at the end of the segment while it accelerates at
+ *	a steady rate. A ramp that would cross zero ends at zero. The samples are clocked
+ *	by timer 0 (TIOA0 triggers the DACC, the pin isn't used) and fed by the DACC PDC,
+ *	SV_SAMPLE_RATE a second per channel or SV_SAMPLES_MAX a segment, whichever is
+ *	fewer. The DAC goes to zero velocity when the loader runs dry or st_halt() stops it.
+ *
+ *	The position loop closes on the encoder (see encoder.h) if $enm is on the motor.
+ *	Each segment's velocity is corrected by $aok times the following error the encoder
+ *	callback last measured, and while the motor is stopped sv_servo_callback() holds
+ *	it on the same gain every SV_HOLD_USEC. The error is a segment or two old when it
+ *	is used, so the gain should be well under the segment rate - tens, not hundreds.
+ *	The following error alarm ($ene) works as it does for a stepper. With $aok=0 or
+ *	no encoder the output is open loop and the amplifier's own loop holds the axis.
+ *
+ *	  $Not	motor output, 0=step and direction, 1=DAC0, 2=DAC1. One motor per channel
+ *	  $aok	position loop gain, velocity per unit of following error (1/sec). 0 is off
+ *	  $aoa	velocity at full scale on DAC0, in mm (or degrees) per minute
+ *	  $aob	velocity at full scale on DAC1
+ *
+ *	Full scale is code 0 or 4095, and code 2048 is zero velocity. The DAC swings about
+ *	0.55V to 2.75V, so an amplifier wants a level shifter that takes that to +/-10V,
+ *	with the offset trimmed at code 2048. Keep the axis velocity maximum ($xvm...)
+ *	under full scale, with room for the position loop; faster is clipped.
+ *
+ *	The TC quadrature decoders can't be used for the encoder (see encoder.h), so the
+ *	position loop is limited by the software decoder's count rate. DAC0 and DAC1 are
+ *	the motor 5 and motor 6 vref pins, which lose their vref to a channel that's on.
+ *	The axis move engine doesn't drive analog motors, so an analog axis can't be homed
+ *	with a homing cycle. The simulator steps analog motors like the others and has no
+ *	DAC.
+ */
+
+#ifndef SERVO_H_ONCE
+#define SERVO_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define SV_SAMPLE_RATE		10000		// DAC samples a second per channel
+#define SV_SAMPLES_MAX		64			// most samples a segment per channel - longer segments are sampled slower
+#define SV_HOLD_USEC		1000		// position loop period while the motor is stopped
+#define SV_DAC_ZERO			2048		// code for zero velocity
+#define SV_DAC_SPAN			2047		// codes from zero to full scale
+
+typedef struct svServoSingleton {
+	float gain;						// position loop gain, 1/sec ($aok)
+	float full_scale[SERVO_CHANNELS];// velocity at full scale, mm/min ($aoa, $aob)
+
+	int8_t motor[SERVO_CHANNELS];	// motor on each channel, -1 for none
+	uint8_t channels;				// channels in use
+	float velocity[SERVO_CHANNELS];	// last segment velocity, steps/sec (prep)
+	float end[SERVO_CHANNELS];		// ...and where its ramp ended
+	uint8_t fill;					// DAC buffer the loader fills next
+	uint16_t code[SERVO_CHANNELS];	// codes last written while stopped
+	uint32_t hold_usec;				// time of the last hold update
+	uint32_t dac[2][(SV_SAMPLES_MAX * SERVO_CHANNELS + 1) / 2];	// conversions, two to a word
+} svServoSingleton_t;
+
+extern svServoSingleton_t sv;
+
+struct stPrepBuffer;
+
+void servo_init(void);
+void sv_prep(struct stPrepBuffer *sp, const uint32_t ticks);
+void sv_load(const struct stPrepBuffer *sp) RAMFUNC;
+void sv_stop(void) RAMFUNC;
+stat_t sv_servo_callback(void);
+
+stat_t sv_set_ot(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+
+	void sv_print_ot(cmdObj_t *cmd);
+	void sv_print_k(cmdObj_t *cmd);
+	void sv_print_fs(cmdObj_t *cmd);
+
+#else
+
+	#define sv_print_ot tx_print_stub
+	#define sv_print_k tx_print_stub
+	#define sv_print_fs tx_print_stub
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERVO_H_ONCE
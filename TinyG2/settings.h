@@ -42,8 +42,36 @@
 
 // Machine configuration settings
 #define CHORDAL_TOLERANCE 			0.001			// chord accuracy for arc drawing
+#define COALESCE_TOLERANCE 			0.001			// path deviation for merging collinear feeds. 0 disables
+#define ARC_FIT_TOLERANCE			0				// path deviation for fitting feeds to an arc. 0 disables (see _fit_arc())
+#define JUNCTION_MODEL				JUNCTION_MODEL_DEVIATION	// one of: JUNCTION_MODEL_DEVIATION, JUNCTION_MODEL_JERK (see _get_junction_vmax())
+#define RAPID_MODE					RAPID_MODE_STRAIGHT	// one of: RAPID_MODE_STRAIGHT, RAPID_MODE_DOGLEG (see mp_dogleg())
 #define SWITCH_TYPE 				SW_NORMALLY_OPEN// one of: SW_NORMALLY_OPEN, SW_NORMALLY_CLOSED
+#define SWITCH_DEBOUNCE_SAMPLES		5				// millisecond samples a switch must be steady after an edge
+#define SWITCH_FILTER_MS			0				// PIO debounce filter on the switch pins - 0 debounces in software (see switch.h)
+#define ESTOP_MODE					ESTOP_DISABLED	// one of: ESTOP_DISABLED, ESTOP_NORMALLY_CLOSED, ESTOP_NORMALLY_OPEN (see switch.h)
 #define MOTOR_IDLE_TIMEOUT			2.00			// motor power timeout in seconds
+#define ASSERTION_INTERVAL_MS		100				// milliseconds between integrity checks - 0 checks every pass
+#define ENCODER_MOTOR				0				// motor the encoder is on, 1-6. 0 is off (see encoder.h)
+#define ENCODER_COUNTS_PER_STEP		1.0				// encoder counts per motor step (microstep)
+#define ENCODER_ERROR_LIMIT			4.0				// following error that raises the alarm, in steps
+#define SPINDLE_PULSES_PER_REV		0				// spindle tach pulses per revolution. 0 is no tach (see spindle.h)
+#define SPINDLE_SPINUP_TIME			0.0				// seconds the first feed after M3/M4 waits for the spindle. 0 is off
+#define SPINDLE_SPINUP_SPEED		0				// percent of S the tach ends the spin-up at. 0 waits the full time
+#define RESTART_CLEARANCE_Z			0.0				// machine Z a job restart approaches at (see Job restart in canonical_machine.cpp)
+#define LOAD_CONTROL_TARGET			0				// spindle load the feed is adapted to hold, percent. 0 is off (see load_control.h)
+#define LOAD_CONTROL_AIR			5				// load below which the cutter is in air, percent
+#define LOAD_CONTROL_GAIN			2.0				// load factor change per second per 100% load error
+#define LOAD_CONTROL_FILTER_TIME	0.05			// load filter time constant in seconds
+#define LOAD_CONTROL_FACTOR_MIN		0.5				// load factor range
+#define LOAD_CONTROL_FACTOR_MAX		1.5
+#define LOAD_CONTROL_CHANNEL		7				// ADC channel of the load signal - 7 is A0 on the Due
+#define SERVO_GAIN					0				// analog motor position loop gain, 1/sec. 0 is open loop (see servo.h)
+#define SERVO_FULL_SCALE_DAC0		6000			// velocity at full scale on DAC0, mm (or degrees) per minute
+#define SERVO_FULL_SCALE_DAC1		6000			// ...and on DAC1
+#define STARVE_QUEUE_TIME_MS		0				// ms of queued motion the feed is slowed to keep when starved. 0 disables (see mp_starve_callback())
+#define PLANNER_BATCH_SIZE			8				// most blocks arriving together that are planned in one pass. 0 or 1 disables (see mp_plan_batch())
+#define JOG_TIMEOUT_MS				150				// ms jog velocities hold without a new frame. 0 turns jogging off (see Jogging in canonical_machine.cpp)
 
 // Communications and reporting settings
 #define COMM_MODE					TEXT_MODE		// one of: TEXT_MODE, JSON_MODE
@@ -52,14 +80,24 @@
 
 #define JSON_VERBOSITY				JV_VERBOSE		// one of: JV_SILENT, JV_FOOTER, JV_CONFIGS, JV_MESSAGES, JV_LINENUM, JV_VERBOSE
 #define JSON_FOOTER_DEPTH			0				// 0 = new style, 1 = old style
+#define JSON_FOOTER_STYLE			1				// 1 = standard, 2 = with rx free and planner free counts for streaming
+#define EARLY_ACK					0				// 1 = answer Gcode lines when they are read ahead, not when they run (see gc_read_ahead())
+#define LINE_CHECK					0				// 1 = check N...*checksum lines and ask for bad ones again (see controller.h)
+#define JSON_TERSE					0				// 1 = answer plain Gcode lines that succeed with [status,line,planner_free] (see json_print_response())
 //#define JSON_FOOTER_DEPTH			1				// 0 = new style, 1 = old style
 
-#define SR_VERBOSITY				SR_FILTERED		// one of: SR_OFF, SR_FILTERED, SR_VERBOSE
+#define SR_VERBOSITY				SR_FILTERED		// one of: SR_OFF, SR_FILTERED, SR_VERBOSE, SR_BINARY
 #define STATUS_REPORT_MIN_MS		50				// milliseconds - enforces a viable minimum
 #define STATUS_REPORT_INTERVAL_MS	250				// milliseconds - set $SV=0 to disable
 #define SR_DEFAULTS "line","posx","posy","posz","posa","feed","vel","unit","coor","dist","frmo","momo","stat"
 
-#define QR_VERBOSITY				QR_OFF			// one of: QR_OFF, QR_SINGLE, QR_TRIPLE
+#define QR_VERBOSITY				QR_OFF			// one of: QR_OFF, QR_SINGLE, QR_TRIPLE, QR_FOOTER
+#define QUEUE_REPORT_INTERVAL_MS	50				// milliseconds - minimum time between queue reports
+#define QUEUE_REPORT_HYSTERESIS		4				// buffers - change needed before a queue report (full or empty always reports)
+
+#define CAN_NODE					0				// CAN bus node number, 1-15. 0 is off (see can.h)
+#define CAN_BAUD					500				// CAN bus bit rate in kbit/s
+#define CAN_SYNC					0				// 1 = send and follow feedholds and cycle starts over the bus
 
 // Gcode startup defaults
 #define GCODE_DEFAULT_UNITS			MILLIMETERS		// MILLIMETERS or INCHES
@@ -76,8 +114,11 @@
 
 /**** MACHINE PROFILES ******************************************************/
 
-// machine default profiles - chose only one:
+// machine default profiles - chose only one, or name one with -DSETTINGS_FILE (see platform/sim.mk):
 
+#ifdef SETTINGS_FILE
+#include SETTINGS_FILE
+#else
 //#include "settings/settings_default.h"				// Default settings for release
 //#include "settings/settings_hammer.h"					// Hammer torque demo
 //#include "settings/settings_pendulum.h"				// Pendulum motion demo
@@ -89,6 +130,7 @@
 #include "settings/settings_shapeoko375.h"			// Shapeoko 375mm kit
 //#include "settings/settings_ultimaker.h"				// Ultimaker 3D printer
 //#include "settings/settings_zen7x12.h"				// Zen Toolworks 7x12
+#endif
 
 /*** Handle optional modules that may not be in every machine ***/
 
@@ -107,4 +149,252 @@
 #define P1_PWM_PHASE_OFF                0.1
 #endif//P1_PWM_FREQUENCY
 
+#ifndef P1_DYNAMIC_POWER
+#define P1_DYNAMIC_POWER                0					// 1 = laser power follows velocity
+#endif
+
+// If homing groups are not defined every axis homes on its own (see cycle_homing.cpp)
+#ifndef X_HOMING_GROUP
+#define X_HOMING_GROUP					0					// xhg		0=alone, 1-3=home with the group
+#endif
+#ifndef Y_HOMING_GROUP
+#define Y_HOMING_GROUP					0
+#endif
+#ifndef Z_HOMING_GROUP
+#define Z_HOMING_GROUP					0
+#endif
+#ifndef A_HOMING_GROUP
+#define A_HOMING_GROUP					0
+#endif
+
+// If input shapers are not defined no axis is shaped (see shaper.h)
+#ifndef SHAPER_TYPE
+#define SHAPER_TYPE						0					// ist		0=ZV, 1=ZVD
+#endif
+#ifndef X_SHAPER_FREQUENCY
+#define X_SHAPER_FREQUENCY				0					// xif		Hz, 0=off
+#endif
+#ifndef X_SHAPER_DAMPING
+#define X_SHAPER_DAMPING				0.1					// xid		damping ratio
+#endif
+#ifndef Y_SHAPER_FREQUENCY
+#define Y_SHAPER_FREQUENCY				0
+#endif
+#ifndef Y_SHAPER_DAMPING
+#define Y_SHAPER_DAMPING				0.1
+#endif
+#ifndef Z_SHAPER_FREQUENCY
+#define Z_SHAPER_FREQUENCY				0
+#endif
+#ifndef Z_SHAPER_DAMPING
+#define Z_SHAPER_DAMPING				0.1
+#endif
+#ifndef A_SHAPER_FREQUENCY
+#define A_SHAPER_FREQUENCY				0
+#endif
+#ifndef A_SHAPER_DAMPING
+#define A_SHAPER_DAMPING				0.1
+#endif
+#ifndef B_SHAPER_FREQUENCY
+#define B_SHAPER_FREQUENCY				0
+#endif
+#ifndef B_SHAPER_DAMPING
+#define B_SHAPER_DAMPING				0.1
+#endif
+#ifndef C_SHAPER_FREQUENCY
+#define C_SHAPER_FREQUENCY				0
+#endif
+#ifndef C_SHAPER_DAMPING
+#define C_SHAPER_DAMPING				0.1
+#endif
+
+// If pressure advance is not defined the extruder runs as planned (see pressure.h)
+#ifndef PA_AXIS
+#define PA_AXIS							AXIS_A				// pae		extruder axis
+#endif
+#ifndef PA_ADVANCE_TIME
+#define PA_ADVANCE_TIME					0					// pak		seconds, 0=off
+#endif
+#ifndef PA_SMOOTH_TIME
+#define PA_SMOOTH_TIME					0.04				// pas		seconds
+#endif
+
+// If backlash is not defined no axis is compensated (see kinematics.h)
+#ifndef X_BACKLASH
+#define X_BACKLASH						0					// xbl		mm
+#endif
+#ifndef Y_BACKLASH
+#define Y_BACKLASH						0
+#endif
+#ifndef Z_BACKLASH
+#define Z_BACKLASH						0
+#endif
+#ifndef A_BACKLASH
+#define A_BACKLASH						0					// abl		degrees
+#endif
+#ifndef B_BACKLASH
+#define B_BACKLASH						0
+#endif
+#ifndef C_BACKLASH
+#define C_BACKLASH						0
+#endif
+
+// Boards run alone unless a profile makes them a leader or follower (see "Motion sync" in stepper.h)
+#ifndef MOTION_SYNC_MODE
+#define MOTION_SYNC_MODE				0					// syn		0=off, 1=leader, 2=follower
+#endif
+
+// Segments are generated in the exec interrupt unless a profile moves them to the main loop (see "Background exec" in stepper.h)
+#ifndef EXEC_MODE
+#define EXEC_MODE						0					// exm		0=interrupt, 1=background
+#endif
+#ifndef EXEC_FILL
+#define EXEC_FILL						PREP_BUFFER_POOL_SIZE	// exf		segments prepped ahead in background mode
+#endif
+
+// Reversals are not held unless a profile sets the drivers' setup time (see "Direction setup" in stepper.h)
+#ifndef DIRECTION_SETUP
+#define DIRECTION_SETUP					0					// dsu		microseconds, 0 to ST_DIR_SETUP_MAX
+#endif
+
+// Expansion motors are unmapped unless a profile maps them (see Step expansion in stepper.h)
+#ifndef M7_MOTOR_MAP
+#define M7_MOTOR_MAP			AXIS_U				// 7ma		AXIS_U is past the axes - the motor is off
+#endif
+#ifndef M7_STEP_ANGLE
+#define M7_STEP_ANGLE			1.8
+#endif
+#ifndef M7_TRAVEL_PER_REV
+#define M7_TRAVEL_PER_REV		360
+#endif
+#ifndef M7_MICROSTEPS
+#define M7_MICROSTEPS			8
+#endif
+#ifndef M7_POLARITY
+#define M7_POLARITY				0
+#endif
+#ifndef M7_POWER_MODE
+#define M7_POWER_MODE			0
+#endif
+#ifndef M8_MOTOR_MAP
+#define M8_MOTOR_MAP			AXIS_U
+#endif
+#ifndef M8_STEP_ANGLE
+#define M8_STEP_ANGLE			1.8
+#endif
+#ifndef M8_TRAVEL_PER_REV
+#define M8_TRAVEL_PER_REV		360
+#endif
+#ifndef M8_MICROSTEPS
+#define M8_MICROSTEPS			8
+#endif
+#ifndef M8_POLARITY
+#define M8_POLARITY				0
+#endif
+#ifndef M8_POWER_MODE
+#define M8_POWER_MODE			0
+#endif
+
+// If gantry switches are not defined every motor homes on its axis switch (see cycle_homing.cpp)
+#ifndef M1_GANTRY_SWITCH
+#define M1_GANTRY_SWITCH				0					// 1gs		0=axis switch, else switch number + 1
+#endif
+#ifndef M2_GANTRY_SWITCH
+#define M2_GANTRY_SWITCH				0
+#endif
+#ifndef M3_GANTRY_SWITCH
+#define M3_GANTRY_SWITCH				0
+#endif
+#ifndef M4_GANTRY_SWITCH
+#define M4_GANTRY_SWITCH				0
+#endif
+#ifndef M5_GANTRY_SWITCH
+#define M5_GANTRY_SWITCH				0
+#endif
+#ifndef M6_GANTRY_SWITCH
+#define M6_GANTRY_SWITCH				0
+#endif
+#ifndef M7_GANTRY_SWITCH
+#define M7_GANTRY_SWITCH				0
+#endif
+#ifndef M8_GANTRY_SWITCH
+#define M8_GANTRY_SWITCH				0
+#endif
+
+// If motor outputs are not defined every motor is stepped (see servo.h)
+#ifndef M1_OUTPUT
+#define M1_OUTPUT						MOTOR_OUTPUT_STEP	// 1ot		0=step and direction, 1=DAC0, 2=DAC1
+#endif
+#ifndef M2_OUTPUT
+#define M2_OUTPUT						MOTOR_OUTPUT_STEP
+#endif
+#ifndef M3_OUTPUT
+#define M3_OUTPUT						MOTOR_OUTPUT_STEP
+#endif
+#ifndef M4_OUTPUT
+#define M4_OUTPUT						MOTOR_OUTPUT_STEP
+#endif
+#ifndef M5_OUTPUT
+#define M5_OUTPUT						MOTOR_OUTPUT_STEP
+#endif
+#ifndef M6_OUTPUT
+#define M6_OUTPUT						MOTOR_OUTPUT_STEP
+#endif
+#ifndef M7_OUTPUT
+#define M7_OUTPUT						MOTOR_OUTPUT_STEP
+#endif
+#ifndef M8_OUTPUT
+#define M8_OUTPUT						MOTOR_OUTPUT_STEP
+#endif
+
+// Motor currents (see st_set_motor_power())
+#ifndef M1_POWER_LEVEL
+#define M1_POWER_LEVEL				0.375				// 1pl		[0..1] of full scale vref
+#endif
+#ifndef M1_POWER_IDLE
+#define M1_POWER_IDLE				0.125				// 1pi		[0..1] held when idle in power modes 2 and 3
+#endif
+#ifndef M2_POWER_LEVEL
+#define M2_POWER_LEVEL				0.375				// 2pl		[0..1] of full scale vref
+#endif
+#ifndef M2_POWER_IDLE
+#define M2_POWER_IDLE				0.125				// 2pi		[0..1] held when idle in power modes 2 and 3
+#endif
+#ifndef M3_POWER_LEVEL
+#define M3_POWER_LEVEL				0.375				// 3pl		[0..1] of full scale vref
+#endif
+#ifndef M3_POWER_IDLE
+#define M3_POWER_IDLE				0.125				// 3pi		[0..1] held when idle in power modes 2 and 3
+#endif
+#ifndef M4_POWER_LEVEL
+#define M4_POWER_LEVEL				0.375				// 4pl		[0..1] of full scale vref
+#endif
+#ifndef M4_POWER_IDLE
+#define M4_POWER_IDLE				0.125				// 4pi		[0..1] held when idle in power modes 2 and 3
+#endif
+#ifndef M5_POWER_LEVEL
+#define M5_POWER_LEVEL				0.375				// 5pl		[0..1] of full scale vref
+#endif
+#ifndef M5_POWER_IDLE
+#define M5_POWER_IDLE				0.125				// 5pi		[0..1] held when idle in power modes 2 and 3
+#endif
+#ifndef M6_POWER_LEVEL
+#define M6_POWER_LEVEL				0.375				// 6pl		[0..1] of full scale vref
+#endif
+#ifndef M6_POWER_IDLE
+#define M6_POWER_IDLE				0.125				// 6pi		[0..1] held when idle in power modes 2 and 3
+#endif
+#ifndef M7_POWER_LEVEL
+#define M7_POWER_LEVEL				0.375				// 7pl		no vref on the expansion - set on the driver
+#endif
+#ifndef M7_POWER_IDLE
+#define M7_POWER_IDLE				0.125				// 7pi
+#endif
+#ifndef M8_POWER_LEVEL
+#define M8_POWER_LEVEL				0.375				// 8pl		no vref on the expansion - set on the driver
+#endif
+#ifndef M8_POWER_IDLE
+#define M8_POWER_IDLE				0.125				// 8pi
+#endif
+
 #endif // End of include guard: SETTINGS_H_ONCE
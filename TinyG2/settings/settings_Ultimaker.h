@@ -184,6 +184,12 @@
 #define C_ZERO_BACKOFF			2
 #define C_JERK_HOMING			A_JERK_MAX
 
+// *** pressure advance (see pressure.h) ***
+
+#define PA_AXIS					AXIS_A		// pae		the extruder
+#define PA_ADVANCE_TIME			0.05		// pak		seconds - a starting point, tune for the filament
+#define PA_SMOOTH_TIME			0.04		// pas		seconds
+
 // *** DEFAULT COORDINATE SYSTEM OFFSETS ***
 
 #define G54_X_OFFSET 0			// G54 is traditionally set to all zeros
@@ -0,0 +1,240 @@
+/*
+ * shaper.cpp - input shaping for resonance compensation
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* See "INPUT SHAPING" in shaper.h. The shaper sits between the runtime's segment
+ * generation and ik_kinematics(), so it works on cartesian positions at segment rate.
+ * Positions are motor side - the Z height map offset is included.
+ */
+#include "tinyg2.h"
+#include "config.h"
+#include "shaper.h"
+#include "text_parser.h"
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+shSingleton_t sh;
+
+static void _configure(const float position[], const float travel[]);
+static float _position_at(uint8_t index, const uint8_t axis, const uint32_t age) RAMFUNC;
+
+/*
+ * sh_shape() - shape the segment being prepped
+ *
+ *	Takes the planned end position and travel of the segment and replaces them with the
+ *	shaped ones. Axes without a shaper are left alone. Call sh_commit() once the segment
+ *	has been prepped. Called from the exec for every line segment and for the segments
+ *	that run out the delay at the end of motion (travel all zero).
+ */
+void sh_shape(float position[], float travel[], const float microseconds)
+{
+	if ((sh.reconfigure == true) && (sh_settled() == true)) { _configure(position, travel);}
+	if (sh.enable == false) { return;}
+
+	uint8_t index = (sh.newest + 1) & (SH_HISTORY-1);
+	shSegment_t *s = &sh.history[index];
+	shSegment_t *prev = &sh.history[sh.newest];
+	s->end = prev->end + (uint32_t)microseconds;
+	copy_axis_vector(s->position, position);
+
+	uint8_t moved = false;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if ((sh.shaped[axis] == true) && (fp_NE(position[axis], prev->position[axis]))) { moved = true;}
+	}
+	uint32_t still = (moved == true) ? 0 : min(sh.still + (uint32_t)microseconds, sh.span);
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (sh.shaped[axis] == false) { continue;}
+		float output = position[axis];		// caught up - the planned position exactly
+		if (still < sh.span) {
+			output = 0;
+			for (uint8_t i=0; i<sh.impulses; i++) {
+				output += sh.amplitude[axis][i] * _position_at(index, axis, sh.delay[axis][i]);
+			}
+		}
+		sh.staged[axis] = output;
+		travel[axis] = output - sh.output[axis];
+		position[axis] = output;
+	}
+	sh.staged_still = still;
+}
+
+void sh_commit()
+{
+	if (sh.enable == false) { return;}
+	sh.newest = (sh.newest + 1) & (SH_HISTORY-1);
+	copy_axis_vector(sh.output, sh.staged);
+	sh.still = sh.staged_still;
+}
+
+/*
+ * sh_settled() - true once the shaped axes have caught up with the planned position
+ */
+uint8_t sh_settled()
+{
+	return ((sh.enable == false) || (sh.still >= sh.span));
+}
+
+/*
+ * sh_get_position() - move a runtime position to where the motors have been sent
+ */
+void sh_get_position(float position[])
+{
+	if (sh.enable == false) { return;}
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (sh.shaped[axis] == true) { position[axis] += sh.output[axis] - sh.history[sh.newest].position[axis];}
+	}
+}
+
+/*
+ * sh_set_position() - move the axis' planned and shaped positions to a new origin
+ *
+ *	Setting the runtime position renames where the axis is, it doesn't move it, so the
+ *	history is moved with it and anything still to run out of the delay still runs.
+ */
+void sh_set_position(const uint8_t axis, const float position)
+{
+	if (sh.enable == false) { return;}
+	float offset = position - sh.history[sh.newest].position[axis];
+	for (uint8_t i=0; i<SH_HISTORY; i++) { sh.history[i].position[axis] += offset;}
+	sh.output[axis] += offset;
+}
+
+/*
+ * _position_at() - planned position an age in microseconds before the end of segment index
+ *
+ *	Planned positions are linear across a segment. Older than the history is the oldest
+ *	position held.
+ */
+static float _position_at(uint8_t index, const uint8_t axis, const uint32_t age)
+{
+	uint32_t t = sh.history[index].end - age;
+
+	for (uint8_t n=1; n<SH_HISTORY; n++) {
+		uint8_t older = (index - 1) & (SH_HISTORY-1);
+		uint32_t start = sh.history[older].end;
+		if ((int32_t)(t - start) >= 0) {		// in this segment
+			if (t == start) { return (sh.history[older].position[axis]);}
+			float fraction = (float)(t - start) / (float)(sh.history[index].end - start);
+			return (sh.history[older].position[axis] +
+				   (sh.history[index].position[axis] - sh.history[older].position[axis]) * fraction);
+		}
+		index = older;
+	}
+	return (sh.history[index].position[axis]);
+}
+
+/*
+ * _configure() - work out the impulses and start the history at rest
+ *
+ *	Only called with the shaper caught up (or off), where the motors are at the planned
+ *	position from before the segment being prepped.
+ */
+static void _configure(const float position[], const float travel[])
+{
+	float start[AXES];
+	for (uint8_t axis=0; axis<AXES; axis++) { start[axis] = position[axis] - travel[axis];}
+
+	sh.reconfigure = false;
+	sh.enable = false;
+	sh.span = 0;
+	sh.impulses = (sh.type == SHAPER_ZVD) ? 3 : 2;
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		sh.shaped[axis] = (sh.frequency[axis] > 0) ? true : false;
+		if (sh.shaped[axis] == false) { continue;}
+		sh.enable = true;
+
+		float root = sqrt(1 - square(sh.damping[axis]));
+		float k = exp(-sh.damping[axis] * M_PI / root);
+		uint32_t half = (uint32_t)(500000 / (sh.frequency[axis] * root));	// half the damped period
+		if (sh.type == SHAPER_ZVD) {
+			float scale = 1 / square(1 + k);
+			sh.amplitude[axis][0] = scale;
+			sh.amplitude[axis][1] = 2 * k * scale;
+			sh.amplitude[axis][2] = k * k * scale;
+		} else {
+			sh.amplitude[axis][0] = 1 / (1 + k);
+			sh.amplitude[axis][1] = k / (1 + k);
+		}
+		for (uint8_t i=0; i<sh.impulses; i++) { sh.delay[axis][i] = half * i;}
+		sh.span = max(sh.span, sh.delay[axis][sh.impulses-1]);
+	}
+	for (uint8_t i=0; i<SH_HISTORY; i++) {
+		sh.history[i].end = 0;
+		copy_axis_vector(sh.history[i].position, start);
+	}
+	sh.newest = 0;
+	sh.still = sh.span;
+	copy_axis_vector(sh.output, start);
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * sh_set_if()	- set an axis' shaper frequency in Hz (0 = off)
+ * sh_set_id()	- set an axis' damping ratio
+ * sh_set_ist() - set the shaper type
+ */
+stat_t sh_set_if(cmdObj_t *cmd)
+{
+	if (cmd->value < 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_flt(cmd);
+	sh.reconfigure = true;
+	return (STAT_OK);
+}
+
+stat_t sh_set_id(cmdObj_t *cmd)
+{
+	if ((cmd->value < 0) || (cmd->value >= 1)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_flt(cmd);
+	sh.reconfigure = true;
+	return (STAT_OK);
+}
+
+stat_t sh_set_ist(cmdObj_t *cmd)
+{
+	ritorno(set_01(cmd));
+	sh.reconfigure = true;
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_Xif[] PROGMEM = "[%s%s] %s shaper frequency%15.1f Hz [0=off]\n";
+static const char fmt_Xid[] PROGMEM = "[%s%s] %s shaper damping%17.3f\n";
+static const char fmt_ist[] PROGMEM = "[ist] input shaper type%12d [0=ZV,1=ZVD]\n";
+
+void sh_print_if(cmdObj_t *cmd) { fprintf_P(stderr, fmt_Xif, cmd->group, cmd->token, cmd->group, cmd->value);}
+void sh_print_id(cmdObj_t *cmd) { fprintf_P(stderr, fmt_Xid, cmd->group, cmd->token, cmd->group, cmd->value);}
+void sh_print_ist(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_ist);}
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
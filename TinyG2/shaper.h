@@ -0,0 +1,115 @@
+/*
+ * shaper.h - input shaping for resonance compensation
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SHAPER_H_ONCE
+#define SHAPER_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/* INPUT SHAPING - cancel the ringing of a resonant axis
+ *
+ *	An axis with a shaper frequency ({"xif":40}) does not follow the planned position
+ *	directly. The runtime sends the motors a weighted sum of where the planned position
+ *	was at a few delays back (the impulses), chosen so the vibration each impulse starts
+ *	at the axis' resonance is cancelled by the next:
+ *
+ *	  ZV	2 impulses over half the damped period - the shortest delay
+ *	  ZVD	3 impulses over the whole damped period - also tolerates the frequency
+ *			being off by 20% or so
+ *
+ *	The damped period is 1 / (f * sqrt(1 - d^2)), for frequency f and damping ratio d
+ *	({"xid":0.1}). Measure f from the ringing after a sharp stop. The impulses add up to
+ *	one, so the motors end up exactly where planned; they just arrive up to a shaper
+ *	delay late. At the end of the motion (or at a hold, dwell or command) the runtime
+ *	runs that last delay out in NOM_SEGMENT_USEC segments of its own before going on.
+ *	Commands that run as the planner frees a buffer (see mp_queue_command()) can run
+ *	up to a delay before the motors arrive.
+ *
+ *	The planned positions are kept for the last SH_HISTORY segments - at least 40 ms
+ *	at full override. A delay longer than that takes the oldest position, which shapes
+ *	less but still ends in place. Config changes take effect once the shaped axes have
+ *	caught up with the planned position, so a running shaper never jumps.
+ */
+#define SH_HISTORY 32					// segments of planned position kept - must be a power of 2
+#define SH_IMPULSES_MAX 3
+
+enum shType {
+	SHAPER_ZV = 0,
+	SHAPER_ZVD
+};
+
+typedef struct shSegment {				// planned position at the end of a segment
+	uint32_t end;						// microseconds - wraps
+	float position[AXES];
+} shSegment_t;
+
+typedef struct shSingleton {
+	// config
+	uint8_t type;						// SHAPER_ZV or SHAPER_ZVD
+	float frequency[AXES];				// Hz - 0 turns the axis' shaper off
+	float damping[AXES];				// damping ratio
+
+	// runtime - exec only
+	volatile uint8_t reconfigure;		// config has changed
+	uint8_t enable;						// true if any axis is shaped
+	uint8_t shaped[AXES];				// true if the axis is shaped
+	uint8_t impulses;
+	float amplitude[AXES][SH_IMPULSES_MAX];
+	uint32_t delay[AXES][SH_IMPULSES_MAX];// microseconds before the end of the segment
+	uint32_t span;						// longest delay
+	uint32_t still;						// microseconds the planned position has not moved
+	uint32_t staged_still;				// ...as of the segment being prepped
+	uint8_t newest;						// history index of the last segment run
+	float output[AXES];					// shaped position sent to the motors so far
+	float staged[AXES];					// ...and as of the segment being prepped
+	shSegment_t history[SH_HISTORY];
+} shSingleton_t;
+extern shSingleton_t sh;
+
+/*
+ * Global Scope Functions
+ */
+
+void sh_shape(float position[], float travel[], const float microseconds) RAMFUNC;
+void sh_commit(void) RAMFUNC;
+uint8_t sh_settled(void);
+void sh_get_position(float position[]);
+void sh_set_position(const uint8_t axis, const float position);
+
+stat_t sh_set_if(cmdObj_t *cmd);
+stat_t sh_set_id(cmdObj_t *cmd);
+stat_t sh_set_ist(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+	void sh_print_if(cmdObj_t *cmd);
+	void sh_print_id(cmdObj_t *cmd);
+	void sh_print_ist(cmdObj_t *cmd);
+#else
+	#define sh_print_if tx_print_stub
+	#define sh_print_id tx_print_stub
+	#define sh_print_ist tx_print_stub
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // End of include Guard: SHAPER_H_ONCE
@@ -32,6 +32,9 @@
 #include "planner.h"
 #include "hardware.h"
 #include "pwm.h"
+#include "stepper.h"
+#include "text_parser.h"
+#include "util.h"
 
 #ifdef __cplusplus
 extern "C"{
@@ -39,6 +42,11 @@ extern "C"{
 
 static void _exec_spindle_control(float *value, float *flag);
 static void _exec_spindle_speed(float *value, float *flag);
+static void _set_spindle_power(uint8_t spindle_mode);
+static void _tach_init(void);
+static void _spinup_check(void);
+
+cmSpindleSingleton_t spindle;
 
 /* 
  * cm_spindle_init()
@@ -50,6 +58,7 @@ void cm_spindle_init()
 
     pwm_set_freq(PWM_1, pwm.c[PWM_1].frequency);
     pwm_set_duty(PWM_1, pwm.c[PWM_1].phase_off);
+	_tach_init();
 }
 
 /*
@@ -90,8 +99,14 @@ float cm_get_spindle_pwm( uint8_t spindle_mode )
 
 stat_t cm_spindle_control(uint8_t spindle_mode)
 {
-	float value[AXES] = { (float)spindle_mode, 0,0,0,0,0 };
-	mp_queue_command(_exec_spindle_control, value, value);
+	if (spindle_mode == SPINDLE_OFF) {
+		spindle.spinup_pending = false;
+	} else if ((spindle_mode != spindle.programmed_mode) && (spindle.spinup_time > 0)) {
+		spindle.spinup_pending = true;			// the next feed waits for it (see spindle.h)
+	}
+	spindle.programmed_mode = spindle_mode;
+	float value[AXES] = { (float)spindle_mode };
+	mp_queue_stop_command(_exec_spindle_control, value, value);	// stop and start are done stopped
 	return(STAT_OK);
 }
 
@@ -99,6 +114,14 @@ stat_t cm_spindle_control(uint8_t spindle_mode)
 static void _exec_spindle_control(float *value, float *flag)
 {
 	uint8_t spindle_mode = (uint8_t)value[0];
+	if (spindle_mode == SPINDLE_OFF) {
+		spindle.spinup = false;
+		hw_deadline_stop(HW_DEADLINE_SPINDLE);
+	} else if ((spindle_mode != cm_get_spindle_mode(MODEL)) && (spindle.spinup_time > 0)) {
+		spindle.spinup_end = hw_get_usec() + (uint32_t)(spindle.spinup_time * 1000000);
+		spindle.spinup = true;
+		hw_deadline_start(HW_DEADLINE_SPINDLE, 0, _spinup_check);
+	}
 	cm_set_spindle_mode(MODEL, spindle_mode);
 
  #ifdef __AVR
@@ -125,7 +148,7 @@ static void _exec_spindle_control(float *value, float *flag)
 #endif // __ARM
 
 	// PWM spindle control
-	pwm_set_duty(PWM_1, cm_get_spindle_pwm(spindle_mode) );
+	_set_spindle_power(spindle_mode);
 }
 
 /*
@@ -136,8 +159,9 @@ static void _exec_spindle_control(float *value, float *flag)
 stat_t cm_set_spindle_speed(float speed)
 {
 //	if (speed > cfg.max_spindle speed) { return (STAT_MAX_SPINDLE_SPEED_EXCEEDED);}
-	float value[AXES] = { speed, 0,0,0,0,0 };
-	mp_queue_command(_exec_spindle_speed, value, value);
+	spindle.programmed_speed = speed;
+	float value[AXES] = { speed };
+	mp_queue_output_command(_exec_spindle_speed, value, value);	// runs as the motors reach it
 	return (STAT_OK);
 }
 
@@ -148,10 +172,185 @@ void cm_exec_spindle_speed(float speed)
 
 static void _exec_spindle_speed(float *value, float *flag)
 {
+	spindle.speed = value[0];
 	cm_set_spindle_speed_parameter(MODEL, value[0]);
-	pwm_set_duty(PWM_1, cm_get_spindle_pwm(gm.spindle_mode) ); // update spindle speed if we're running
+	_set_spindle_power(gm.spindle_mode);		// update spindle speed if we're running
+}
+
+/*
+ * _set_spindle_power() - set the PWM for the spindle mode and speed
+ *
+ *	In dynamic power mode the duty cycle is only recorded - the segments set the PWM 
+ *	as they load (see pwm_set_power()). Turning the spindle off still takes effect now.
+ */
+static void _set_spindle_power(uint8_t spindle_mode)
+{
+	pwm.p[PWM_1].power = cm_get_spindle_pwm(spindle_mode);
+	if ((pwm.c[PWM_1].dynamic_power == false) || (spindle_mode == SPINDLE_OFF)) {
+		pwm_set_duty(PWM_1, pwm.p[PWM_1].power);
+	}
+}
+
+/*
+ * Spindle tachometer - see spindle.h
+ *
+ * _tach_init()			  - enable rising edge interrupts on the tach pin if $spp is set
+ * sp_index_edge()		  - a tach pulse. Called from the PIO interrupt of the tach port
+ * cm_get_spindle_rpm()	  - measured spindle speed
+ * cm_spindle_index_wait() - called by the runtime before starting a G33 from rest. 
+ *							 Returns TRUE to wait; the index restarts the exec
+ * cm_spindle_spinup_wait() - called by the runtime before starting the first feed 
+ *							 after M3/M4. Returns TRUE to wait; _spinup_check() restarts the exec
+ * _spinup_check()		  - end the spin-up if it's time or the tach says so, else look 
+ *							 again later. Runs on the spindle deadline (main loop)
+ */
+
+#ifndef __SIM
+
+#define _tach Motate::Pin<spindle_index_pin_num>
+
+static Pio *_tach_pio()
+{
+	if (_tach::portLetter == 'A') { return (PIOA);}
+	if (_tach::portLetter == 'B') { return (PIOB);}
+	if (_tach::portLetter == 'C') { return (PIOC);}
+	return (PIOD);
+}
+
+static IRQn_Type _tach_irqn()
+{
+	if (_tach::portLetter == 'A') { return (PIOA_IRQn);}
+	if (_tach::portLetter == 'B') { return (PIOB_IRQn);}
+	if (_tach::portLetter == 'C') { return (PIOC_IRQn);}
+	return (PIOD_IRQn);
+}
+
+static void _tach_init()
+{
+	Pio *pio = _tach_pio();
+	if (spindle.pulses_per_rev == 0) {
+		pio->PIO_IDR = _tach::mask;				// the switch handlers may still run for the port
+		return;
+	}
+	Motate::InputPin<spindle_index_pin_num> spindle_index_pin(Motate::kPullUp);
+	pio->PIO_AIMER = _tach::mask;				// rising edges only
+	pio->PIO_ESR = _tach::mask;
+	pio->PIO_REHLSR = _tach::mask;
+	pio->PIO_IER = _tach::mask;
+	NVIC_EnableIRQ(_tach_irqn());
+}
+
+void sp_index_edge()
+{
+	uint32_t now = hw_get_cycle_count();
+	uint32_t tick = SysTickTimer.getValue();
+	spindle.period = ((tick - spindle.last_tick) < SPINDLE_TACH_TIMEOUT_MS) ? now - spindle.last_edge : 0;
+	spindle.last_edge = now;
+	spindle.last_tick = tick;
+	if ((++spindle.pulses % spindle.pulses_per_rev) != 0) { return;}
+	if (spindle.index_state == SPINDLE_INDEX_WAIT) {
+		spindle.index_state = SPINDLE_INDEX_SEEN;
+		spindle.index_pulses = spindle.pulses;
+		st_request_exec_move();					// start the G33
+	}
+}
+
+float cm_get_spindle_rpm()
+{
+	if (spindle.pulses_per_rev == 0) { return (0);}
+	__disable_irq();
+	uint32_t period = spindle.period;
+	uint32_t since = hw_get_cycle_count() - spindle.last_edge;
+	uint32_t ticks = SysTickTimer.getValue() - spindle.last_tick;
+	__enable_irq();
+
+	if ((period == 0) || (ticks > SPINDLE_TACH_TIMEOUT_MS)) { return (0);}
+	if (since > period) { period = since;}		// slowing down, or stopped
+	return ((60.0 * F_CPU) / ((float)period * spindle.pulses_per_rev));
+}
+
+uint8_t cm_spindle_index_wait()
+{
+	if ((spindle.index_state == SPINDLE_INDEX_SEEN) && (spindle.pulses == spindle.index_pulses)) {
+		spindle.index_state = SPINDLE_INDEX_OFF;
+		return (false);
+	}
+	spindle.index_state = SPINDLE_INDEX_WAIT;	// (again if the index was seen too long ago)
+	return (true);
+}
+
+#else // __SIM
+
+static void _tach_init() {}
+void sp_index_edge() {}
+
+float cm_get_spindle_rpm()
+{
+	if ((spindle.pulses_per_rev == 0) || (gm.spindle_mode == SPINDLE_OFF)) { return (0);}
+	return (spindle.speed);						// turns at exactly the speed it's given
+}
+
+uint8_t cm_spindle_index_wait() { return (false);}
+
+#endif // __SIM
+
+uint8_t cm_spindle_spinup_wait() { return (spindle.spinup);}
+
+static void _spinup_check()
+{
+	int32_t left = (int32_t)(spindle.spinup_end - hw_get_usec());
+	if (left > 0) {
+		if ((spindle.pulses_per_rev == 0) || (spindle.spinup_speed <= 0)) {
+			hw_deadline_start(HW_DEADLINE_SPINDLE, left, _spinup_check);
+			return;
+		}
+		if (cm_get_spindle_rpm() < (spindle.speed * spindle.spinup_speed / 100)) {
+			hw_deadline_start(HW_DEADLINE_SPINDLE, min(left, (int32_t)SPINDLE_SPINUP_POLL_MS * 1000), _spinup_check);
+			return;
+		}
+	}
+	spindle.spinup = false;
+	st_request_exec_move();						// start the feed waiting for it, if any
 }
 
+/*
+ * sp_set_pp()  - set tach pulses per revolution ($spp)
+ * sp_get_sps() - get measured spindle speed ($sps)
+ */
+
+stat_t sp_set_pp(cmdObj_t *cmd)
+{
+	set_ui8(cmd);
+	_tach_init();
+	return (STAT_OK);
+}
+
+stat_t sp_get_sps(cmdObj_t *cmd)
+{
+	cmd->value = cm_get_spindle_rpm();
+	cmd->objtype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_spp[] PROGMEM = "[spp]  spindle tach pulses per rev%7d\n";
+static const char fmt_sps[] PROGMEM = "[sps]  spindle speed%21.0f rpm\n";
+static const char fmt_spu[] PROGMEM = "[spu]  spindle spin-up time%14.2f sec\n";
+static const char fmt_spa[] PROGMEM = "[spa]  spindle spin-up at speed%10.0f %%\n";
+
+void sp_print_pp(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_spp);}
+void sp_print_ps(cmdObj_t *cmd) { text_print_flt(cmd, fmt_sps);}
+void sp_print_pu(cmdObj_t *cmd) { text_print_flt(cmd, fmt_spu);}
+void sp_print_pa(cmdObj_t *cmd) { text_print_flt(cmd, fmt_spa);}
+
+#endif // __TEXT_MODE
+
 #ifdef __cplusplus
 }
 #endif
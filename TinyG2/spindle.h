@@ -32,17 +32,108 @@
 extern "C"{
 #endif
 
+/* Spindle tachometer and synchronized motion
+ *	A tach on the spindle gives $spp pulses per revolution on spindle_index_pin_num 
+ *	(hardware.h). Each rising edge is timestamped from the cycle counter in the PIO 
+ *	handler the switches use, and the measured speed is the time between the last two
+ *	pulses - or the time since the last one if that is longer, so a stopping spindle 
+ *	reads down to 0. With $spp set to 0 there is no tach.
+ *
+ *	G33 K... feeds along the line at K per spindle revolution, and G84 taps at F with
+ *	the spindle at S. Both queue blocks planned for the programmed S and tagged with 
+ *	it (spindle_sync in the Gcode state). The runtime time-scales their segments by 
+ *	measured / programmed speed, through the feed override factor (see 
+ *	mp_feed_rate_override()), so the feed per revolution holds as the spindle bogs 
+ *	down. The factor can't go over 1, so a spindle running faster than S isn't followed 
+ *	- the block is already planned to the axis limits. Overrides don't apply to 
+ *	synchronized blocks.
+ *
+ *	A G33 following anything but another G33 starts from rest on the index - the 
+ *	pulse count reaching a multiple of $spp - so every pass of a thread starts at the
+ *	same spindle angle. Start the passes far enough off the work for the axis to get 
+ *	up to speed. The tach can't tell the direction the spindle turns, so G84 reverses 
+ *	the spindle at the bottom and back at the top with the motion stopped, and dwells
+ *	P seconds after each reversal. P must cover the spindle's reversal time. 
+ *
+ *	The simulator's spindle turns at exactly its commanded speed and has no index.
+ */
+/* Spindle spin-up
+ *	With $spu set, an M3 or M4 that starts the spindle (or reverses it) doesn't need
+ *	a G4 after it. The first feed after it - G1, G2, G3, G33 or a canned cycle - is 
+ *	planned to start from rest and waits at its start until $spu seconds have passed 
+ *	since the spindle was switched on. Rapids and anything else ahead of that feed 
+ *	run during the spin-up.
+ *
+ *	With a tach and $spa set, the feed goes as soon as the measured speed reaches $spa
+ *	percent of S, and $spu is the longest it waits for that. Speed changes with S 
+ *	while the spindle turns don't wait.
+ */
+#ifndef SPINDLE_TACH_TIMEOUT_MS
+#define SPINDLE_TACH_TIMEOUT_MS 5000			// no tach pulse for this long reads 0 RPM
+#endif
+#define SPINDLE_SPINUP_POLL_MS 10				// tach checked this often during a spin-up
+
+typedef struct cmSpindleSingleton {
+	uint8_t pulses_per_rev;						// tach pulses per revolution, 0 is no tach ($spp)
+	uint8_t programmed_mode;					// M3, M4, M5 as last programmed...
+	float programmed_speed;						// ...and S - the spindle gets them as the motors do
+	float speed;								// S as the spindle got it (gm.spindle_speed is clamped to the PWM range)
+	float spinup_time;							// seconds to reach speed after M3/M4 ($spu)
+	float spinup_speed;							// percent of S the tach confirms the spin-up at, 0 is off ($spa)
+	uint8_t spinup_pending;						// the next feed waits for the spin-up (planner)
+	volatile uint8_t spinup;					// the spindle is spinning up... (exec)
+	uint32_t spinup_end;						// ...until this hw_get_usec() time
+
+	volatile uint32_t pulses;					// tach pulses counted
+	volatile uint32_t period;					// cycles between the last two pulses
+	volatile uint32_t last_edge;				// cycle count of the last pulse...
+	volatile uint32_t last_tick;				// ...and SysTick
+	volatile uint8_t index_state;				// see cmSpindleIndex
+	volatile uint32_t index_pulses;				// pulse count at the index seen
+} cmSpindleSingleton_t;
+
+enum cmSpindleIndex {							// G33 start on the index
+	SPINDLE_INDEX_OFF = 0,
+	SPINDLE_INDEX_WAIT,							// the runtime is waiting for it
+	SPINDLE_INDEX_SEEN							// the index came - go
+};
+
+extern cmSpindleSingleton_t spindle;
+
 /*
  * Global Scope Functions
  */
 
 void cm_spindle_init();
 
+void sp_index_edge(void);							// tach pulse - from the PIO interrupt
+float cm_get_spindle_rpm(void);						// measured spindle speed
+uint8_t cm_spindle_index_wait(void);				// TRUE until a G33 may start
+uint8_t cm_spindle_spinup_wait(void);				// TRUE until the first feed after M3/M4 may start
+stat_t sp_set_pp(cmdObj_t *cmd);					// $spp
+stat_t sp_get_sps(cmdObj_t *cmd);					// $sps
+
 stat_t cm_set_spindle_speed(float speed);			// S parameter
 void cm_exec_spindle_speed(float speed);			// callback for above
 
 stat_t cm_spindle_control(uint8_t spindle_mode);	// M3, M4, M5 integrated spindle control
 void cm_exec_spindle_control(uint8_t spindle_mode);	// callback for above
+
+#ifdef __TEXT_MODE
+
+	void sp_print_pp(cmdObj_t *cmd);
+	void sp_print_ps(cmdObj_t *cmd);
+	void sp_print_pu(cmdObj_t *cmd);
+	void sp_print_pa(cmdObj_t *cmd);
+
+#else
+
+	#define sp_print_pp tx_print_stub
+	#define sp_print_ps tx_print_stub
+	#define sp_print_pu tx_print_stub
+	#define sp_print_pa tx_print_stub
+
+#endif // __TEXT_MODE
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,136 @@
+/*
+ * step_trace.cpp - step trace capture ring
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart, Jr.
+ * Copyright (c) 2013 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* See "Step trace" in stepper.h. This file is shared by the board and the simulator,
+ * which both call st_trace_segment() from their _load_move(), so the two dumps have
+ * the same format.
+ */
+#include "tinyg2.h"
+#include "config.h"
+#include "planner.h"
+#include "stepper.h"
+#include "text_parser.h"
+#include "hardware.h"
+
+#ifdef __STEP_TRACE
+
+stTraceRing_t st_trace;
+
+static uint8_t _trace_copy(uint32_t n, stTraceEntry_t *e);
+
+/*
+ * st_trace_segment() - record a segment as it is loaded. Called from _load_move()
+ */
+void st_trace_segment(const stPrepBuffer_t *sp)
+{
+	stTraceEntry_t *e = &st_trace.entry[st_trace.count++ & (ST_TRACE_ENTRIES-1)];
+	e->dda_ticks = sp->dda_ticks;
+	e->dir = 0;
+	for (uint8_t i=0; i<MOTORS; i++) {
+		e->phase_increment[i] = sp->m[i].phase_increment;
+		e->dir |= (sp->m[i].dir << i);
+	}
+	e->flags = ((sp->reset_flag == true) ? ST_TRACE_RESET : 0) |
+			   ((sp->move_type == MOVE_TYPE_DWELL) ? ST_TRACE_DWELL : 0);
+	e->rate_shift = sp->dda_rate_shift;
+}
+
+/*
+ * _trace_copy() - copy out segment n. Returns false if it has been overwritten
+ */
+static uint8_t _trace_copy(uint32_t n, stTraceEntry_t *e)
+{
+	__disable_irq();
+	uint8_t valid = ((st_trace.count - n) <= ST_TRACE_ENTRIES) ? true : false;
+	*e = st_trace.entry[n & (ST_TRACE_ENTRIES-1)];
+	__enable_irq();
+	return (valid);
+}
+
+/*
+ * st_get_trc()	 - dump the ring, oldest segment first
+ * st_set_trcz() - clear the ring
+ *
+ *	Each segment is numbered from the last clear. JSON mode dumps the ring as
+ *	{"trc":[[seg,ticks,shift,flags,dir,m1..m6],...]} ahead of the response, text mode
+ *	as a table (see st_print_trc()). The value is the number of segments recorded.
+ */
+stat_t st_get_trc(cmdObj_t *cmd)
+{
+	cmd->value = (float)st_trace.count;
+	cmd->objtype = TYPE_INTEGER;
+	if (cfg.comm_mode != JSON_MODE) { return (STAT_OK);}
+
+	uint32_t count = st_trace.count;
+	uint32_t first = (count > ST_TRACE_ENTRIES) ? count - ST_TRACE_ENTRIES : 0;
+	stTraceEntry_t e;
+	fprintf_P(stderr, PSTR("{\"trc\":["));
+	for (uint32_t n = first; n < count; n++) {
+		if (_trace_copy(n, &e) == false) { continue;}
+		fprintf_P(stderr, PSTR("%s[%lu,%lu,%d,%d,%d"), (n == first) ? "" : ",",
+				  (unsigned long)n, (unsigned long)e.dda_ticks, e.rate_shift, e.flags, e.dir);
+		for (uint8_t i=0; i<MOTORS; i++) {
+			fprintf_P(stderr, PSTR(",%lu"), (unsigned long)e.phase_increment[i]);
+		}
+		fprintf_P(stderr, PSTR("]"));
+	}
+	fprintf_P(stderr, PSTR("]}\n"));
+	return (STAT_OK);
+}
+
+stat_t st_set_trcz(cmdObj_t *cmd)
+{
+	__disable_irq();
+	st_trace.count = 0;
+	__enable_irq();
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_trc[] PROGMEM = "[trc]  step trace%18lu segments\n";
+static const char fmt_trc_head[] PROGMEM = "     seg    ticks sh rst dwl dir        m1        m2        m3        m4        m5        m6\n";
+static const char fmt_trc_seg[] PROGMEM = "%8lu %8lu %2d %3d %3d  %02x";
+
+void st_print_trc(cmdObj_t *cmd)
+{
+	text_print_int(cmd, fmt_trc);
+
+	uint32_t count = st_trace.count;
+	uint32_t first = (count > ST_TRACE_ENTRIES) ? count - ST_TRACE_ENTRIES : 0;
+	stTraceEntry_t e;
+	fprintf_P(stderr, fmt_trc_head);
+	for (uint32_t n = first; n < count; n++) {
+		if (_trace_copy(n, &e) == false) { continue;}
+		fprintf_P(stderr, fmt_trc_seg, (unsigned long)n, (unsigned long)e.dda_ticks, e.rate_shift,
+				  (e.flags & ST_TRACE_RESET) ? 1 : 0, (e.flags & ST_TRACE_DWELL) ? 1 : 0, e.dir);
+		for (uint8_t i=0; i<MOTORS; i++) {
+			fprintf_P(stderr, PSTR(" %9lu"), (unsigned long)e.phase_increment[i]);
+		}
+		fprintf_P(stderr, PSTR("\n"));
+	}
+}
+
+#endif // __TEXT_MODE
+
+#endif // __STEP_TRACE
@@ -40,9 +40,16 @@
 
 #include "tinyg2.h"
 #include "config.h"
+#include "controller.h"
 #include "stepper.h"
 #include "planner.h"
 #include "hardware.h"
+#include "kinematics.h"
+#include "switch.h"
+#include "encoder.h"
+#include "servo.h"
+#include "event_log.h"
+#include "pwm.h"
 #include "text_parser.h"
 #include "util.h"
 
@@ -56,17 +63,52 @@
 /**** Allocate structures ****/
 
 stConfig_t st;
-static stRunSingleton_t st_run;
-static stPrepSingleton_t st_prep;
+stIsrTimingSingleton_t st_isr;
+stSegmentTelemetry_t st_seg;
+static stRunSingleton_t st_run SRAM_ISR;
+static stPrepSingleton_t st_prep SRAM_ISR;
+static stLatch_t st_latch[ST_LATCHES];
+#ifdef __AXIS_MOVE_ENGINE
+static stAxisMoveSingleton_t st_axis;
+#endif
+#ifdef __MOTION_SYNC
+#ifndef __SWITCH_INTERRUPTS
+#error __MOTION_SYNC requires __SWITCH_INTERRUPTS (switch.h)
+#endif
+enum stSyncTimer { SYNC_TIMER_NONE = 0, SYNC_TIMER_DDA };
+typedef struct stSyncSingleton {	// follower state. Written by the loader and the sync edge
+	volatile uint8_t waiting;		// timer of the loaded segment waiting for an edge - see stSyncTimer
+	volatile uint16_t pending;		// edges that came before their segment was loaded
+} stSyncSingleton_t;
+static stSyncSingleton_t st_sync;
+#endif
 
 /**** Setup local functions ****/
 
-static void _load_move(void);
-static void _request_load_move(void);
+static void _load_move(void) RAMFUNC;
+static void _request_load_move(void) RAMFUNC;
+static uint8_t _next_prep_index(uint8_t index) RAMFUNC;
+static void _request_exec(void) RAMFUNC;
+static stat_t _exec_segment(void) RAMFUNC;
+static uint8_t _prep_fill(void);
+static void _clear_isr_timing(void);
 static void _clear_diagnostic_counters(void);
+static uint32_t _vref_duty(float power);
+static void _set_vref(const uint8_t motor, const uint32_t duty);
+static void _prep_motor_power(stPrepBuffer_t *sp, uint32_t ticks);
+static void _motor_power_walk(void);
+static void _load_raster(const stPrepBuffer_t *sp) RAMFUNC;
+static void _preset_directions(void) RAMFUNC;
+static void _dir_setup_hold(const stPrepBuffer_t *sp) RAMFUNC;
+#ifdef __MOTION_SYNC
+static void _sync_init(void);
+static void _sync_start(const uint8_t timer) RAMFUNC;
+#endif
 
 // handy macro
 #define _f_to_period(f) (uint16_t)((float)F_CPU / (float)f)
+
+#define VREF_PWM_PERIOD (F_CPU / VREF_PWM_FREQUENCY)	// vref PWM period in F_CPU clocks
 
 /**** Setup motate ****/
 
@@ -78,69 +120,393 @@ OutputPin<33> dda_debug_pin2;
 
 // Example with prefixed name::
 //Motate::Timer<dda_timer_num> dda_timer(kTimerUpToMatch, FREQUENCY_DDA);			// stepper pulse generation
-Timer<dda_timer_num> dda_timer(kTimerUpToMatch, FREQUENCY_DDA);			// stepper pulse generation
-Timer<dwell_timer_num> dwell_timer(kTimerUpToMatch, FREQUENCY_DWELL);	// dwell timer
+typedef TimerPrescaler<F_CPU, (FREQUENCY_DDA >> DDA_RATE_SHIFT_MAX), FREQUENCY_DDA> dda_prescaler; // one clock for all DDA rates
+Timer<dda_timer_num> dda_timer;			// stepper pulse generation - mode and frequency set in stepper_init()
 Timer<load_timer_num> load_timer;		// triggers load of next stepper segment
 Timer<exec_timer_num> exec_timer;		// triggers calculation of next+1 stepper segment
+#ifdef __AXIS_MOVE_ENGINE
+Timer<axis_timer_num> axis_timer(kTimerUpToMatch, FREQUENCY_DDA);	// axis move engine step timer
+#endif
 
 // Motor structures
-template<pin_number step_num,			// Setup a stepper template to hold our pins
-		 pin_number dir_num, 
-		 pin_number enable_num, 
+/* Stepper<> holds the pins for one motor and the per-motor load and DDA code.
+ *	The motor index is a template argument so each instance compiles its own copy of 
+ *	load() and dda_tick() with the st_run and prep buffer offsets resolved at compile 
+ *	time. A motor whose step pin is not defined (-1) compiles both down to nothing.
+ *	The vref code likewise drops out for motors without a vref PWM channel.
+ *	The step, dir and enable pins are classes so the expansion motors can put them on
+ *	the step expansion register (see below).
+ */
+template<uint8_t motor,					// index of this motor in st_run.m[], st.m[] etc.
+		 class step_pin,				// OutputPin<> or an expansion register bit
+		 class dir_pin, 
+		 class enable_pin, 
 		 pin_number ms0_num, 
 		 pin_number ms1_num, 
-		 pin_number vref_num>
+		 pin_number vref_num,
+		 int8_t vref_channel>			// PWM channel on the vref pin, -1 if none
 
 struct Stepper {
-	OutputPin<step_num> step;
-	OutputPin<dir_num> dir;
-	OutputPin<enable_num> enable;
+	step_pin step;
+	dir_pin dir;
+	enable_pin enable;
 	OutputPin<ms0_num> ms0;
 	OutputPin<ms1_num> ms1;
 	OutputPin<vref_num> vref;
+
+	// load the motor's part of a prepped segment - called from _load_move()
+	inline void load(const stPrepBuffer_t *sp) {
+		if (step.isNull()) return;					// motor is not populated on this board
+		st_run.m[motor].phase_increment = sp->m[motor].phase_increment;
+		if (sp->reset_flag == true) {				// compensate for pulse phasing
+			st_run.m[motor].phase_accumulator = -(st_run.dda_ticks_downcount);
+		}
+		if (st_run.m[motor].phase_increment != 0) {	// motor is in this move
+			if (sp->m[motor].dir == 0) {
+				dir.clear();						// clear the bit for clockwise motion 
+			} else {
+				dir.set();							// set the bit for CCW motion
+			}
+			if (((st_run.dir >> motor) & 1) != sp->m[motor].dir) { dir_changed();}
+			enable.clear();							// enable the motor (clear the ~Enable line)
+			if (st.m[motor].power_mode >= MOTOR_POWER_REDUCED_WHEN_IDLE) { set_vref(sp->m[motor].vref);}
+			st_run.m[motor].power_state = MOTOR_RUNNING;
+		} else {									// motor is not in this move
+			if (st.m[motor].power_mode == MOTOR_IDLE_WHEN_STOPPED) {
+				enable.clear();						// energize motor
+				st_run.m[motor].power_state = MOTOR_START_IDLE_TIMEOUT;
+				st_run.power_start = true;			// arm the power callback
+			} else if ((st.m[motor].power_mode >= MOTOR_POWER_REDUCED_WHEN_IDLE) && 
+					   (st_run.m[motor].power_state == MOTOR_RUNNING)) {
+				set_vref(sp->m[motor].vref);		// stopped - time out to the idle level
+				st_run.m[motor].power_state = MOTOR_START_IDLE_TIMEOUT;
+				st_run.power_start = true;
+			}
+		}
+		if ((st_run.motor_run & (1<<motor)) == 0) {	// stopped by st_stop_motors() - stays energized
+			st_run.m[motor].phase_increment = 0;
+		}
+		if (st_run.m[motor].phase_increment != 0) { st_run.motor_active |= (1<<motor);}
+		if ((sp->m[motor].dir ^ st.m[motor].polarity) == 0) {	// see Motor positions in stepper.h
+			st_run.m[motor].position += st_run.m[motor].phase_increment;
+		} else {
+			st_run.m[motor].position -= st_run.m[motor].phase_increment;
+		}
+		st_run.m[motor].position += sp->m[motor].servo_substeps;	// analog motors - see servo.h
+	}
+
+	// set the next segment's direction a tick early - if it reverses and the last tick can't step it
+	inline void preset_dir(const stPrepBuffer_t *np) {
+		if (step.isNull() || (np->m[motor].phase_increment == 0)) return;
+		if (((st_run.dir >> motor) & 1) == np->m[motor].dir) return;
+		if (((st_run.motor_active & (1<<motor)) != 0) &&
+			((st_run.m[motor].phase_accumulator + st_run.m[motor].phase_increment) > 0)) return;
+		if (np->m[motor].dir == 0) {
+			dir.clear();
+		} else {
+			dir.set();
+		}
+		dir_changed();
+	}
+
+	// record a direction change for the setup hold - see Direction setup in stepper.h
+	inline void dir_changed() {
+		st_run.dir ^= (1<<motor);
+		st_run.dir_cycles = hw_get_cycle_count();
+		st_run.dir_wait = true;
+	}
+
+	// advance the motor's DDA accumulator one tick. Returns true if the motor steps
+	// A motor not in active is skipped - a zero increment would leave it where it is
+	inline bool dda_tick(const uint8_t active) {
+		if (step.isNull() || ((active & (1<<motor)) == 0)) return (false);
+		if ((st_run.m[motor].phase_accumulator += st_run.m[motor].phase_increment) > 0) {
+			st_run.m[motor].phase_accumulator -= st_run.dda_ticks_X_substeps;
+			INCREMENT_DIAGNOSTIC_COUNTER(motor);
+			return (true);
+		}
+		return (false);
+	}
+
+	// set direction and enable for an axis engine move - if this motor is in the move
+	inline void axis_start(const uint8_t motor_mask, const uint8_t negative) {
+		if (step.isNull() || ((motor_mask & (1<<motor)) == 0)) return;
+		if ((negative ^ st.m[motor].polarity) == 0) {
+			dir.clear();
+			st_run.dir &= ~(1<<motor);
+		} else {
+			dir.set();
+			st_run.dir |= (1<<motor);
+		}
+		enable.clear();
+		st_run.m[motor].power_state = MOTOR_RUNNING;
+	}
+
+	// start the idle timeout of a motor at the end of an axis engine move - as load() does
+	inline void axis_end(const uint8_t motor_mask) {
+		if (step.isNull() || ((motor_mask & (1<<motor)) == 0)) return;
+		st_run.m[motor].power_state = MOTOR_START_IDLE_TIMEOUT;
+		st_run.power_start = true;				// arm the power callback
+	}
+
+	// set the step bit for an axis engine step - if this motor is in the move
+	inline void axis_step(const uint8_t motor_mask) {
+		if (step.isNull() || ((motor_mask & (1<<motor)) == 0)) return;
+		step.set();
+	}
+
+	// PWM_ENA/PWM_DIS bit of the vref channel - 0 if the motor has none
+	static inline uint32_t vref_mask() {
+		return ((vref_channel < 0) ? 0 : (1u << (vref_channel & 0x1F)));
+	}
+
+	// hand the vref pin to its PWM channel, left aligned with the L output high for the duty
+	inline void init_vref() {
+		if (vref.isNull() || (vref_channel < 0)) return;
+		PWM->PWM_DIS = vref_mask();
+		PWM->PWM_CH_NUM[vref_channel].PWM_CMR = 0;	// F_CPU channel clock
+		PWM->PWM_CH_NUM[vref_channel].PWM_CPRD = VREF_PWM_PERIOD;
+		PWM->PWM_CH_NUM[vref_channel].PWM_CDTY = st_run.m[motor].power_level;
+		PWM->PWM_ENA = vref_mask();
+		vref.setMode(kPeripheralB);
+	}
+
+	// set the motor current - taken up at the end of the PWM period
+	inline void set_vref(const uint32_t duty) {
+		if (vref.isNull() || (vref_channel < 0)) return;
+		PWM->PWM_CH_NUM[vref_channel].PWM_CDTYUPD = duty;
+		st_run.m[motor].power_level = duty;
+	}
+};
+
+/* Step expansion - see Step expansion in stepper.h
+ *	ExpansionStepPin<> and ExpansionPin<> stand in for the OutputPin<> of an expansion
+ *	motor. Step bits are collected in st_exp.steps by the DDA and axis ISRs and sent 
+ *	once per tick. Dir and enable bits are sent as they change. A frame that finds the
+ *	transmit register full is left pending and goes out with the next tick's frame, or
+ *	from st_expansion_tick() if the motors are stopped - nothing waits on the SPI.
+ */
+#if (EXPANSION_MOTORS > 0)
+#ifdef __STEP_STREAM
+#error "__STEP_STREAM cannot drive EXPANSION_MOTORS"
+#endif
+
+typedef struct stExpansion {
+	uint8_t outputs;				// dir and enable bits as last sent
+	uint8_t steps;					// step bits of this tick - DDA and axis ISRs only
+	volatile uint8_t pending;		// a frame is waiting for the transmit register
+} stExpansion_t;
+static stExpansion_t st_exp;
+
+static inline void _exp_send()		// queue a frame - it latches as it finishes shifting
+{
+	if ((ST_EXP_SPI->SPI_SR & SPI_SR_TDRE) == 0) {	// one shifting and one queued already
+		st_exp.pending = true;						// ...so it goes with the next frame sent
+		return;
+	}
+	ST_EXP_SPI->SPI_TDR = st_exp.outputs | st_exp.steps;
+	st_exp.pending = false;
+}
+
+static void _exp_output(const uint8_t mask, const uint8_t value)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint8_t outputs = (st_exp.outputs & ~mask) | (value ? mask : 0);
+	if (outputs != st_exp.outputs) {
+		st_exp.outputs = outputs;
+		_exp_send();
+	}
+	__set_PRIMASK(primask);
+}
+
+static void _exp_init()
+{
+	st_exp.outputs = 0x24;						// drivers disabled
+	st_exp.steps = 0;
+	PMC->PMC_PCER0 = (1u << ST_EXP_SPI_ID);	// clock the SPI
+	ST_EXP_SPI_PIO->PIO_PDR = ST_EXP_SPI_PINS;	// hand the pins to the peripheral...
+	ST_EXP_SPI_PIO->PIO_ABSR &= ~ST_EXP_SPI_PINS;	// ...peripheral A
+
+	ST_EXP_SPI->SPI_CR = SPI_CR_SPIDIS;
+	ST_EXP_SPI->SPI_CR = SPI_CR_SWRST;
+	ST_EXP_SPI->SPI_MR = SPI_MR_MSTR | SPI_MR_MODFDIS | SPI_MR_PCS(0x0E);	// NPCS0
+	ST_EXP_SPI->SPI_CSR[0] = SPI_CSR_NCPHA | SPI_CSR_CSNAAT | SPI_CSR_BITS_8_BIT |	// mode 0, latch every frame
+		SPI_CSR_SCBR((SystemCoreClock + ST_EXP_SPI_BAUD - 1) / ST_EXP_SPI_BAUD);
+	ST_EXP_SPI->SPI_IDR = 0xFFFFFFFF;			// no interrupts
+	ST_EXP_SPI->SPI_CR = SPI_CR_SPIEN;
+	_exp_send();
+}
+
+template<uint8_t bit>
+struct ExpansionStepPin {
+	bool isNull() { return false; };
+	void set() { st_exp.steps |= (1 << bit);};
+	void clear() { st_exp.steps &= ~(1 << bit);};
 };
 
-Stepper<motor_1_step_pin_num, 
-		motor_1_dir_pin_num, 
-		motor_1_enable_pin_num, 
+template<uint8_t bit>
+struct ExpansionPin {
+	bool isNull() { return false; };
+	void set() { _exp_output((1 << bit), 1);};
+	void clear() { _exp_output((1 << bit), 0);};
+};
+
+#define _exp_write_steps() if ((st_exp.steps != 0) || (st_exp.pending == true)) { _exp_send();}
+#define _exp_clear_steps() if ((st_exp.steps != 0) || (st_exp.pending == true)) { st_exp.steps = 0; _exp_send();}
+
+/*
+ * st_expansion_tick() - send a pending expansion frame. Called from the SysTick interrupt
+ *
+ *	Frames carry all the bits, so a pending one is just the latest state. While the DDA
+ *	or the axis engine runs their next tick sends it first.
+ */
+void st_expansion_tick()
+{
+	if (st_exp.pending == false) return;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();							// a step ISR may be sending too
+	_exp_send();
+	__set_PRIMASK(primask);
+}
+#else
+void st_expansion_tick() {}
+
+#define _exp_write_steps()
+#define _exp_clear_steps()
+#endif // EXPANSION_MOTORS
+
+Stepper<MOTOR_1,
+		OutputPin<motor_1_step_pin_num>, 
+		OutputPin<motor_1_dir_pin_num>, 
+		OutputPin<motor_1_enable_pin_num>, 
 		motor_1_microstep_0_pin_num, 
 		motor_1_microstep_1_pin_num,
-		motor_1_vref_pin_num> motor_1;
+		motor_1_vref_pin_num,
+		MOTOR_1_VREF_CHANNEL> motor_1;
 
-Stepper<motor_2_step_pin_num, 
-		motor_2_dir_pin_num, 
-		motor_2_enable_pin_num, 
+Stepper<MOTOR_2,
+		OutputPin<motor_2_step_pin_num>, 
+		OutputPin<motor_2_dir_pin_num>, 
+		OutputPin<motor_2_enable_pin_num>, 
 		motor_2_microstep_0_pin_num, 
 		motor_2_microstep_1_pin_num,
-		motor_2_vref_pin_num> motor_2;
+		motor_2_vref_pin_num,
+		MOTOR_2_VREF_CHANNEL> motor_2;
 
-Stepper<motor_3_step_pin_num, 
-		motor_3_dir_pin_num, 
-		motor_3_enable_pin_num, 
+Stepper<MOTOR_3,
+		OutputPin<motor_3_step_pin_num>, 
+		OutputPin<motor_3_dir_pin_num>, 
+		OutputPin<motor_3_enable_pin_num>, 
 		motor_3_microstep_0_pin_num, 
 		motor_3_microstep_1_pin_num,
-		motor_3_vref_pin_num> motor_3;
+		motor_3_vref_pin_num,
+		MOTOR_3_VREF_CHANNEL> motor_3;
 
-Stepper<motor_4_step_pin_num, 
-		motor_4_dir_pin_num, 
-		motor_4_enable_pin_num, 
+Stepper<MOTOR_4,
+		OutputPin<motor_4_step_pin_num>, 
+		OutputPin<motor_4_dir_pin_num>, 
+		OutputPin<motor_4_enable_pin_num>, 
 		motor_4_microstep_0_pin_num, 
 		motor_4_microstep_1_pin_num,
-		motor_4_vref_pin_num> motor_4;
+		motor_4_vref_pin_num,
+		MOTOR_4_VREF_CHANNEL> motor_4;
 
-Stepper<motor_5_step_pin_num, 
-		motor_5_dir_pin_num, 
-		motor_5_enable_pin_num, 
+Stepper<MOTOR_5,
+		OutputPin<motor_5_step_pin_num>, 
+		OutputPin<motor_5_dir_pin_num>, 
+		OutputPin<motor_5_enable_pin_num>, 
 		motor_5_microstep_0_pin_num, 
 		motor_5_microstep_1_pin_num,
-		motor_5_vref_pin_num> motor_5;
+		motor_5_vref_pin_num,
+		MOTOR_5_VREF_CHANNEL> motor_5;
 		
-Stepper<motor_6_step_pin_num, 
-		motor_6_dir_pin_num, 
-		motor_6_enable_pin_num, 
+Stepper<MOTOR_6,
+		OutputPin<motor_6_step_pin_num>, 
+		OutputPin<motor_6_dir_pin_num>, 
+		OutputPin<motor_6_enable_pin_num>, 
 		motor_6_microstep_0_pin_num, 
 		motor_6_microstep_1_pin_num,
-		motor_6_vref_pin_num> motor_6;
+		motor_6_vref_pin_num,
+		MOTOR_6_VREF_CHANNEL> motor_6;
+
+#if (MOTORS >= 7)
+Stepper<MOTOR_7,
+		ExpansionStepPin<0>, 
+		ExpansionPin<1>, 
+		ExpansionPin<2>, 
+		-1, 
+		-1,
+		-1,
+		-1> motor_7;
+#endif
+
+#if (MOTORS >= 8)
+Stepper<MOTOR_8,
+		ExpansionStepPin<3>, 
+		ExpansionPin<4>, 
+		ExpansionPin<5>, 
+		-1, 
+		-1,
+		-1,
+		-1> motor_8;
+#endif
+
+/* Step port writes
+ *	With __STEP_PORT_WRITES defined the DDA builds one step bitmask per PIO port and 
+ *	sets it with a single SODR store, then clears it with a single CODR store per port. 
+ *	This replaces up to 12 individual pin writes per tick and makes the step edges of 
+ *	all motors on the same port coincide. The port masks are resolved at compile time
+ *	from the step pin assignments in hardware.h. Undefined motors drop out as before.
+ *	Comment out the define to revert to individual motor_N.step.set() / clear() calls.
+ */
+#define __STEP_PORT_WRITES
+
+#ifdef __STEP_PORT_WRITES
+
+#define _step_bit(n,port) ((Pin<motor_##n##_step_pin_num>::portLetter == (port)) ? Pin<motor_##n##_step_pin_num>::mask : 0)
+#define _step_port_mask(port) (_step_bit(1,port) | _step_bit(2,port) | _step_bit(3,port) | \
+							   _step_bit(4,port) | _step_bit(5,port) | _step_bit(6,port))
+
+static const uint32_t step_port_mask_A = _step_port_mask('A');
+static const uint32_t step_port_mask_B = _step_port_mask('B');
+#ifdef PIOC
+static const uint32_t step_port_mask_C = _step_port_mask('C');
+#endif
+#ifdef PIOD
+static const uint32_t step_port_mask_D = _step_port_mask('D');
+#endif
+
+#endif // __STEP_PORT_WRITES
+
+/* Step stream port table
+ *	Translates a motor step mask from a step stream into the step bits for each port.
+ *	Built once in stepper_init() from the same compile-time port masks as above.
+ */
+#ifdef __STEP_STREAM
+#ifndef __STEP_PORT_WRITES
+#error __STEP_STREAM requires __STEP_PORT_WRITES
+#endif
+
+#define STEP_STREAM_MASKS (1<<MOTORS)
+
+typedef struct stStreamPortBits {	// step bits to write to each port for one motor mask
+	uint32_t a;
+	uint32_t b;
+	uint32_t c;
+	uint32_t d;
+} stStreamPortBits_t;
+
+static stStreamPortBits_t stream_port_bits[STEP_STREAM_MASKS];
+
+#define _stream_bit(mask,n,port) (((mask) & (1<<((n)-1))) ? _step_bit(n,port) : 0)
+#define _stream_port_bits(mask,port) (_stream_bit(mask,1,port) | _stream_bit(mask,2,port) | _stream_bit(mask,3,port) | \
+									  _stream_bit(mask,4,port) | _stream_bit(mask,5,port) | _stream_bit(mask,6,port))
+
+static void _init_stream_port_bits(void);
+static void _prep_step_stream(stPrepBuffer_t *sp);
+
+#endif // __STEP_STREAM
 
 /************************************************************************************
  **** CODE **************************************************************************
@@ -158,16 +524,25 @@ Stepper<motor_6_step_pin_num,
 void stepper_init()
 {
 	memset(&st_run, 0, sizeof(st_run));		// clear all values, pointers and status
+	memset(&st_prep, 0, sizeof(st_prep));
 	st_run.magic_start = MAGICNUM;
 	st_prep.magic_start = MAGICNUM;
+	st_run.motor_run = 0xFF;				// all motors step
 	_clear_diagnostic_counters();
+	_clear_isr_timing();
+
+	// interrupt priorities are set afterwards by hw_set_irq_priorities() - see hardware.h
 
 	// setup DDA timer (see FOOTNOTE)
+	dda_timer.setModeAndFrequency<dda_prescaler>(kTimerUpToMatch, FREQUENCY_DDA);
 	dda_timer.setInterrupts(kInterruptOnOverflow | kInterruptOnMatchA | kInterruptPriorityHighest);
-	dda_timer.setDutyCycleA(0.25);
-
-	// setup DWELL timer
-	dwell_timer.setInterrupts(kInterruptOnOverflow | kInterruptPriorityHighest);
+	dda_timer.setDutyCycleA(0.25);			// sets step pulse width - unchanged by DDA rate changes
+	st_prep.dda_period_base = dda_timer.getTopValue();
+	st_run.dda_tick_cycles = F_CPU / (st_prep.dda_period_base * FREQUENCY_DDA);	// timer clock divisor
+	st_run.dir_setup_cycles = (uint32_t)(st.dir_setup * (F_CPU / 1000000));
+#ifdef __STEP_STREAM
+	_init_stream_port_bits();
+#endif
 
 	// setup LOAD timer
 	load_timer.setInterrupts(kInterruptOnSoftwareTrigger | kInterruptPriorityLow);
@@ -175,7 +550,35 @@ void stepper_init()
 	// setup EXEC timer
 	exec_timer.setInterrupts(kInterruptOnSoftwareTrigger | kInterruptPriorityLowest);
 
-	st_prep.exec_state = PREP_BUFFER_OWNED_BY_EXEC;		// initial condition
+#ifdef __AXIS_MOVE_ENGINE
+	// setup AXIS timer - same step pulse width as the DDA. Period is set per move
+	axis_timer.setInterrupts(kInterruptOnOverflow | kInterruptOnMatchA | kInterruptPriorityHighest);
+	st_axis.timer_clock = axis_timer.getTopValue() * FREQUENCY_DDA;
+	st_axis.pulse_ticks = axis_timer.getTopValue() / 4;
+	axis_timer.setExactDutyCycleA(st_axis.pulse_ticks);
+#endif
+
+	for (uint8_t i=0; i<PREP_BUFFER_POOL_SIZE; i++) {
+		st_prep.bf[i].move_type = MOVE_TYPE_NULL;
+		st_prep.bf[i].power = PREP_POWER_NONE;
+		st_prep.bf[i].exec_state = PREP_BUFFER_OWNED_BY_EXEC;	// initial condition
+	}
+
+	// setup motor current - vref channels start at the motor power level
+	PMC->PMC_PCER1 = (1u << (ID_PWM - 32));	// clock the PWM controller
+	for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) {
+		st_run.m[motor].power_level = _vref_duty(st.m[motor].power_level);
+	}
+	motor_1.init_vref();
+	motor_2.init_vref();
+	motor_3.init_vref();
+	motor_4.init_vref();
+	motor_5.init_vref();
+	motor_6.init_vref();
+
+#if (EXPANSION_MOTORS > 0)
+	_exp_init();							// drivers start disabled - see Step expansion
+#endif
 }
 /*	FOOTNOTE: This is the bare code that the Motate timer calls replace.
 	NB: requires: #include <component_tc.h>
@@ -197,8 +600,52 @@ static void _clear_diagnostic_counters()
 	st_run.m[MOTOR_4].step_count_diagnostic = 0;
 	st_run.m[MOTOR_5].step_count_diagnostic = 0;
 	st_run.m[MOTOR_6].step_count_diagnostic = 0;
+#if (MOTORS >= 7)
+	st_run.m[MOTOR_7].step_count_diagnostic = 0;
+#endif
+#if (MOTORS >= 8)
+	st_run.m[MOTOR_8].step_count_diagnostic = 0;
+#endif
+}
+
+/*
+ * ISR timing functions
+ *
+ * _clear_isr_timing()	- reset all ISR timing statistics
+ * _record_isr_sample() - record one sample
+ * _record_isr_time()	- record one sample given the starting cycle count 
+ *
+ *	These run inside the ISRs so keep them lean. 
+ */
+
+static void _clear_isr_timing()
+{
+	stIsrTiming_t *t = (stIsrTiming_t *)&st_isr;
+	__disable_irq();
+	for (uint8_t i=0; i < (sizeof(st_isr) / sizeof(stIsrTiming_t)); i++, t++) {
+		t->min = 0xFFFFFFFF;
+		t->max = 0;
+		t->count = 0;
+		t->sum = 0;
+	}
+	__enable_irq();
+}
+
+static inline void _record_isr_sample(stIsrTiming_t *t, const uint32_t cycles)
+{
+	if (cycles < t->min) t->min = cycles;
+	if (cycles > t->max) t->max = cycles;
+	t->sum += cycles;
+	t->count++;
+}
+
+static inline void _record_isr_time(stIsrTiming_t *t, const uint32_t start)
+{
+	_record_isr_sample(t, hw_get_cycle_count() - start);	// uint32_t math handles counter wrap
 }
 
+void st_record_kinematics_time(const uint32_t start) { _record_isr_time(&st_isr.kinematics, start);}
+
 /*
  * st_assertions() - test assertions, return error code if violation exists
  */
@@ -214,10 +661,18 @@ stat_t st_assertions()
  */
 uint8_t stepper_isbusy()
 {
-	if (st_run.dda_ticks_downcount == 0) {
-		return (false);
-	} 
-	return (true);
+	if (st_run.dda_ticks_downcount != 0) {
+		return (true);
+	}
+#ifdef __AXIS_MOVE_ENGINE
+	if (st_axis.busy == true) {
+		return (true);							// axis engine move is running
+	}
+#endif
+	if (st_prep.bf[st_prep.load_index].exec_state == PREP_BUFFER_OWNED_BY_LOADER) {
+		return (true);							// prepped segments are waiting to run
+	}
+	return (false);
 }
 
 /*
@@ -225,10 +680,24 @@ uint8_t stepper_isbusy()
  *
  * _energize_motor()			- apply power to a motor
  * _deenergize_motor()			- remove power from a motor
- * st_set_motor_power()			- set motor a specified power level
+ * st_set_motor_power()			- set the motor current for its power state
  * st_energize_motors()			- apply power to all motors
  * st_deenergize_motors()		- remove power from all motors
  * st_motor_power_callback()	- callback to manage motor power sequencing
+ *
+ *	The callback is event driven. Anything that puts a motor in MOTOR_START_IDLE_TIMEOUT
+ *	(including _load_move()) sets st_run.power_start. The callback then starts the timers 
+ *	and puts the earliest in the HW_DEADLINE_MOTOR_POWER deadline (see hardware.h), which
+ *	walks the motors again when it is up. On any other pass it returns after one flag 
+ *	test. The motor timers are kept in SysTick ms, as $mt can be longer than the 
+ *	timebase wraps - the deadline only wakes the walk.
+ *
+ *	Motor current is set with the vref PWM of each motor, as a fraction of full scale.
+ *	In MOTOR_POWER_REDUCED_WHEN_IDLE a motor runs at its power level and drops to its 
+ *	idle level when the idle timeout ($mt) expires, instead of being deenergized. 
+ *	DYNAMIC_MOTOR_POWER does the same, but in motion the exec sets the current of each 
+ *	segment between the two levels (see _prep_motor_power()) and _load_move() applies 
+ *	it as the segment starts. Other modes run at the power level.
  */
 
 static void _energize_motor(const uint8_t motor)
@@ -240,10 +709,18 @@ static void _energize_motor(const uint8_t motor)
 	if (!motor_4.enable.isNull()) if (motor == MOTOR_4) motor_4.enable.clear();
 	if (!motor_5.enable.isNull()) if (motor == MOTOR_5) motor_5.enable.clear();
 	if (!motor_6.enable.isNull()) if (motor == MOTOR_6) motor_6.enable.clear();
+#if (MOTORS >= 7)
+	if (!motor_7.enable.isNull()) if (motor == MOTOR_7) motor_7.enable.clear();
+#endif
+#if (MOTORS >= 8)
+	if (!motor_8.enable.isNull()) if (motor == MOTOR_8) motor_8.enable.clear();
+#endif
 
 	st_run.m[motor].power_state = MOTOR_START_IDLE_TIMEOUT;
-}
-
+	st_run.power_start = true;
+	st_set_motor_power(motor);
+}
+
 static void _deenergize_motor(const uint8_t motor)
 {
 	// Motors that are not defined are not compiled. Saves some ugly #ifdef code
@@ -253,11 +730,42 @@ static void _deenergize_motor(const uint8_t motor)
 	if (!motor_4.enable.isNull()) if (motor == MOTOR_4) motor_4.enable.set();
 	if (!motor_5.enable.isNull()) if (motor == MOTOR_5) motor_5.enable.set();
 	if (!motor_6.enable.isNull()) if (motor == MOTOR_6) motor_6.enable.set();
+#if (MOTORS >= 7)
+	if (!motor_7.enable.isNull()) if (motor == MOTOR_7) motor_7.enable.set();
+#endif
+#if (MOTORS >= 8)
+	if (!motor_8.enable.isNull()) if (motor == MOTOR_8) motor_8.enable.set();
+#endif
 
 	st_run.m[motor].power_state = MOTOR_OFF;
 }
 
-void st_set_motor_power(const uint8_t motor) { }	// code for PWM driven Vref goes here
+void st_set_motor_power(const uint8_t motor)
+{
+	if (st_run.m[motor].power_state == MOTOR_IDLE) {
+		_set_vref(motor, _vref_duty(st.m[motor].power_idle));
+	} else {
+		_set_vref(motor, _vref_duty(st.m[motor].power_level));
+	}
+}
+
+static uint32_t _vref_duty(float power)
+{
+	if (power < 0) { power = 0;}
+	if (power > 1) { power = 1;}
+	return ((uint32_t)(power * VREF_PWM_PERIOD));
+}
+
+static void _set_vref(const uint8_t motor, const uint32_t duty)
+{
+	// Motors without a vref channel are not compiled
+	if (motor == MOTOR_1) motor_1.set_vref(duty);
+	if (motor == MOTOR_2) motor_2.set_vref(duty);
+	if (motor == MOTOR_3) motor_3.set_vref(duty);
+	if (motor == MOTOR_4) motor_4.set_vref(duty);
+	if (motor == MOTOR_5) motor_5.set_vref(duty);
+	if (motor == MOTOR_6) motor_6.set_vref(duty);
+}
 
 void st_energize_motors()
 {
@@ -267,6 +775,12 @@ void st_energize_motors()
 	motor_4.enable.clear();
 	motor_5.enable.clear();
 	motor_6.enable.clear();
+#if (MOTORS >= 7)
+	motor_7.enable.clear();
+#endif
+#if (MOTORS >= 8)
+	motor_8.enable.clear();
+#endif
 	common_enable.clear();			// enable gShield common enable
 
 	st_run.m[MOTOR_1].power_state = MOTOR_START_IDLE_TIMEOUT;
@@ -275,6 +789,14 @@ void st_energize_motors()
 	st_run.m[MOTOR_4].power_state = MOTOR_START_IDLE_TIMEOUT;
 	st_run.m[MOTOR_5].power_state = MOTOR_START_IDLE_TIMEOUT;
 	st_run.m[MOTOR_6].power_state = MOTOR_START_IDLE_TIMEOUT;
+#if (MOTORS >= 7)
+	st_run.m[MOTOR_7].power_state = MOTOR_START_IDLE_TIMEOUT;
+#endif
+#if (MOTORS >= 8)
+	st_run.m[MOTOR_8].power_state = MOTOR_START_IDLE_TIMEOUT;
+#endif
+	st_run.power_start = true;
+	for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) { st_set_motor_power(motor);}
 }
 
 void st_deenergize_motors()
@@ -285,78 +807,108 @@ void st_deenergize_motors()
 	motor_4.enable.set();
 	motor_5.enable.set();
 	motor_6.enable.set();
+#if (MOTORS >= 7)
+	motor_7.enable.set();
+#endif
+#if (MOTORS >= 8)
+	motor_8.enable.set();
+#endif
 	common_enable.set();			// disable gShield common enable
 }
 
+static uint32_t _get_idle_timeout_ms(const uint8_t motor)
+{
+	if (st.m[motor].power_mode == MOTOR_ENERGIZED_DURING_CYCLE) {
+		return ((uint32_t)(st.motor_idle_timeout * 1000));
+	} else if (st.m[motor].power_mode == MOTOR_IDLE_WHEN_STOPPED) {
+		return ((uint32_t)(IDLE_TIMEOUT_SECONDS * 1000));
+	} else if (st.m[motor].power_mode >= MOTOR_POWER_REDUCED_WHEN_IDLE) {
+		return ((uint32_t)(st.motor_idle_timeout * 1000));
+	}
+	return (0);											// power mode has no idle timeout
+}
+
 stat_t st_motor_power_callback() 	// called by controller
 {
-	// manage power for each motor individually - facilitates advanced features
-	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
-
-		if (st.m[motor].power_mode == MOTOR_ENERGIZED_DURING_CYCLE) {
+	if (st_run.power_start == false) { return (STAT_OK);}	// nothing started - the deadline does the rest
+	st_run.power_start = false;							// clear before the walk so new starts are not lost
+	_motor_power_walk();
+	return (STAT_OK);
+}
 
-			switch (st_run.m[motor].power_state) {
-				case (MOTOR_START_IDLE_TIMEOUT): {
-//					st_run.m[motor].power_systick = SysTickTimer_getValue() + (uint32_t)(st.motor_idle_timeout * 1000);
-					st_run.m[motor].power_systick = SysTickTimer.getValue() + (uint32_t)(st.motor_idle_timeout * 1000);
-					st_run.m[motor].power_state = MOTOR_TIME_IDLE_TIMEOUT;
-					break;
-				}
+static void _motor_power_walk()
+{
+	uint32_t now = SysTickTimer.getValue();
+	uint8_t armed = false;
+	uint32_t deadline = 0;
 
-				case (MOTOR_TIME_IDLE_TIMEOUT): {
-//					if (SysTickTimer_getValue() > st_run.m[motor].power_systick ) {
-					if (SysTickTimer.getValue() > st_run.m[motor].power_systick ) {
-						st_run.m[motor].power_state = MOTOR_IDLE;
-						_deenergize_motor(motor);
-					}
-					break;
-				}
-			}
-			} else if(st.m[motor].power_mode == MOTOR_IDLE_WHEN_STOPPED) {
-			switch (st_run.m[motor].power_state) {
-				case (MOTOR_START_IDLE_TIMEOUT): {
-//					st_run.m[motor].power_systick = SysTickTimer_getValue() + (uint32_t)(IDLE_TIMEOUT_SECONDS * 1000);
-					st_run.m[motor].power_systick = SysTickTimer.getValue() + (uint32_t)(IDLE_TIMEOUT_SECONDS * 1000);
-					st_run.m[motor].power_state = MOTOR_TIME_IDLE_TIMEOUT;
-					break;
-				}
+	// manage power for each motor individually - facilitates advanced features
+	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
+		uint32_t timeout = _get_idle_timeout_ms(motor);
+		if (timeout == 0) continue;
 
-				case (MOTOR_TIME_IDLE_TIMEOUT): {
-//					if (SysTickTimer_getValue() > st_run.m[motor].power_systick ) {
-					if (SysTickTimer.getValue() > st_run.m[motor].power_systick ) {
-						st_run.m[motor].power_state = MOTOR_IDLE;
-						_deenergize_motor(motor);
-					}
-					break;
+		if (st_run.m[motor].power_state == MOTOR_START_IDLE_TIMEOUT) {
+			st_run.m[motor].power_systick = now + timeout;
+			st_run.m[motor].power_state = MOTOR_TIME_IDLE_TIMEOUT;
+		} else if (st_run.m[motor].power_state == MOTOR_TIME_IDLE_TIMEOUT) {
+			if ((int32_t)(now - st_run.m[motor].power_systick) >= 0) {
+				st_run.m[motor].power_state = MOTOR_IDLE;
+				if (st.m[motor].power_mode >= MOTOR_POWER_REDUCED_WHEN_IDLE) {
+					st_set_motor_power(motor);			// hold at the idle level
+				} else {
+					_deenergize_motor(motor);
 				}
+				continue;
 			}
-
-//		} else if(st_run.m[motor].power_mode == MOTOR_POWER_REDUCED_WHEN_IDLE) {	// future
-			
-//		} else if(st_run.m[motor].power_mode == DYNAMIC_MOTOR_POWER) {				// future
-			
+		} else {
+			continue;									// motor is not timing out
+		}
+		// keep the earliest deadline of the motors still timing out
+		if ((armed == false) || ((int32_t)(st_run.m[motor].power_systick - deadline) < 0)) {
+			deadline = st_run.m[motor].power_systick;
+			armed = true;
 		}
 	}
-	return (STAT_OK);
+	if (armed == true) {
+		uint32_t ms = min(deadline - now, HW_DEADLINE_MAX_USEC / 1000);	// longer ones walk again first
+		hw_deadline_start(HW_DEADLINE_MOTOR_POWER, ms * 1000, _motor_power_walk);
+	} else {
+		hw_deadline_stop(HW_DEADLINE_MOTOR_POWER);
+	}
 }
 
 /******************************
  * Interrupt Service Routines *
  ******************************/
 
-/*
- * Dwell timer interrupt
+/****************************************************************************************
+ * _load_raster() - start the pixels of a raster segment. Called from _load_move()
+ * _raster_tick() - step the pixel position. Called from the DDA overflow ISR
+ *
+ *	See Raster pixels in stepper.h. Without dynamic power the segment has no power 
+ *	ratio and the pixels are ignored.
  */
-namespace Motate {			// Must define timer interrupts inside the Motate namespace
-MOTATE_TIMER_INTERRUPT(dwell_timer_num) 
+static void _load_raster(const stPrepBuffer_t *sp)
 {
-	dwell_timer.getInterruptCause(); // read SR to clear interrupt condition
-	if (--st_run.dda_ticks_downcount == 0) {
-		dwell_timer.stop();
-		_load_move();
+	if ((fp_EQ(sp->power, PREP_POWER_NONE)) || (sp->dda_ticks == 0)) { return;}
+	memcpy(st_run.raster, sp->raster, sp->raster_count);
+	st_run.raster_phase = sp->raster_phase;
+	st_run.raster_step = sp->raster_length / sp->dda_ticks;
+	st_run.raster_pixel = sp->raster_phase >> 16;
+	st_run.raster_count = sp->raster_count;
+	pwm_start_raster(PWM_1, sp->power);
+	pwm_set_raster(PWM_1, st_run.raster[st_run.raster_pixel]);
+}
+
+static inline void _raster_tick()
+{
+	st_run.raster_phase += st_run.raster_step;
+	uint32_t pixel = st_run.raster_phase >> 16;
+	if ((pixel != st_run.raster_pixel) && (pixel < st_run.raster_count)) {
+		st_run.raster_pixel = pixel;
+		pwm_set_raster(PWM_1, st_run.raster[pixel]);
 	}
 }
-} // namespace Motate
 
 /****************************************************************************************
  * ISR - DDA timer interrupt routine - service ticks from DDA timer
@@ -365,93 +917,604 @@ MOTATE_TIMER_INTERRUPT(dwell_timer_num)
  *	Overflow interrupts are used to set step pins, match interrupts clear step pins.
  *	This way the duty cycle of the stepper pulse can be controlled by setting the match value.
  *
- *	Note that the motor_N.step.isNull() tests are compile-time tests, not run-time tests. 
- *	If motor_N is not defined that if{} clause (i.e. that motor) drops out of the complied code.
+ *	Note that the step.isNull() tests in Stepper<>::dda_tick() are compile-time tests, not 
+ *	run-time tests. If motor_N is not defined that motor drops out of the complied code.
+ *	Motors that are defined but have no steps in the segment are skipped on the active 
+ *	mask _load_move() builds, so a single axis move only runs one accumulator.
+ *
+ *	_set_step() and _clear_steps() either accumulate the step bits for a port-wide write 
+ *	or write the pins individually, depending on __STEP_PORT_WRITES (see above). The
+ *	expansion motors set their bits with step.set() and go out first, in one frame.
+ */
+#ifdef __STEP_PORT_WRITES
+
+#ifdef PIOC
+#define _set_step_C(n) step_bits_C |= _step_bit(n,'C');
+#define _write_step_C() if (step_port_mask_C) { PIOC->PIO_SODR = step_bits_C;}
+#define _clear_step_C() if (step_port_mask_C) { PIOC->PIO_CODR = step_port_mask_C;}
+#else
+#define _set_step_C(n)
+#define _write_step_C()
+#define _clear_step_C()
+#endif
+#ifdef PIOD
+#define _set_step_D(n) step_bits_D |= _step_bit(n,'D');
+#define _write_step_D() if (step_port_mask_D) { PIOD->PIO_SODR = step_bits_D;}
+#define _clear_step_D() if (step_port_mask_D) { PIOD->PIO_CODR = step_port_mask_D;}
+#else
+#define _set_step_D(n)
+#define _write_step_D()
+#define _clear_step_D()
+#endif
+
+#define _set_step(n) { step_bits_A |= _step_bit(n,'A'); step_bits_B |= _step_bit(n,'B'); _set_step_C(n) _set_step_D(n) }
+#define _write_steps() { \
+	_exp_write_steps() \
+	if (step_port_mask_A) { PIOA->PIO_SODR = step_bits_A;} \
+	if (step_port_mask_B) { PIOB->PIO_SODR = step_bits_B;} \
+	_write_step_C() _write_step_D() }
+#define _clear_steps() { \
+	_exp_clear_steps() \
+	if (step_port_mask_A) { PIOA->PIO_CODR = step_port_mask_A;} \
+	if (step_port_mask_B) { PIOB->PIO_CODR = step_port_mask_B;} \
+	_clear_step_C() _clear_step_D() }
+
+#else
+
+#define _set_step(n) motor_##n.step.set();
+#define _write_steps() { _exp_write_steps() }
+#define _clear_steps() { \
+	_exp_clear_steps() \
+	motor_1.step.clear(); motor_2.step.clear(); motor_3.step.clear(); \
+	motor_4.step.clear(); motor_5.step.clear(); motor_6.step.clear(); }
+
+#endif // __STEP_PORT_WRITES
+
+namespace Motate {			// Must define timer interrupts inside the Motate namespace
+template<> void Timer<dda_timer_num>::interrupt() RAMFUNC;
+MOTATE_TIMER_INTERRUPT(dda_timer_num)
+{
+	uint32_t start = hw_get_cycle_count();
+	uint32_t latency = dda_timer.getValue();	// counts since the period started - read it first
+	uint32_t interrupt_cause = dda_timer.getInterruptCause();	// also clears interrupt condition
+
+	if (interrupt_cause == kInterruptOnOverflow) {
+		if (st_run.dir_hold_ticks != 0) return;		// direction setup - the tick is held, see _dir_setup_hold()
+		dda_debug_pin1 = 1;
+		_record_isr_sample(&st_isr.dda_latency, latency * st_run.dda_tick_cycles);
+#ifdef __STEP_PORT_WRITES
+		uint32_t step_bits_A = 0;
+		uint32_t step_bits_B = 0;
+#ifdef PIOC
+		uint32_t step_bits_C = 0;
+#endif
+#ifdef PIOD
+		uint32_t step_bits_D = 0;
+#endif
+#endif
+#ifdef __STEP_STREAM
+		if (st_run.step_stream != NULL) {				// play back a prepped step stream
+			stStreamPortBits_t *bits = &stream_port_bits[*st_run.step_stream++ & st_run.motor_run];
+			step_bits_A = bits->a;
+			step_bits_B = bits->b;
+#ifdef PIOC
+			step_bits_C = bits->c;
+#endif
+#ifdef PIOD
+			step_bits_D = bits->d;
+#endif
+		} else {
+#endif
+		uint8_t active = st_run.motor_active;		// read once - most moves run 1 to 3 motors
+		if (motor_1.dda_tick(active)) _set_step(1);	// turn step bit on
+		if (motor_2.dda_tick(active)) _set_step(2);
+		if (motor_3.dda_tick(active)) _set_step(3);
+		if (motor_4.dda_tick(active)) _set_step(4);
+		if (motor_5.dda_tick(active)) _set_step(5);
+		if (motor_6.dda_tick(active)) _set_step(6);
+#if (MOTORS >= 7)
+		if (motor_7.dda_tick(active)) motor_7.step.set();
+#endif
+#if (MOTORS >= 8)
+		if (motor_8.dda_tick(active)) motor_8.step.set();
+#endif
+#ifdef __STEP_STREAM
+		}
+#endif
+		_write_steps();				// one SODR store per port (port write mode only)
+		if (st_run.raster_count != 0) { _raster_tick();}	// laser raster pixels
+		dda_debug_pin1 = 0;
+		_record_isr_time(&st_isr.dda_overflow, start);
+
+	} else if (interrupt_cause == kInterruptOnMatchA) { // dda_timer.getInterruptCause() == kInterruptOnMatchA
+		dda_debug_pin2 = 1;
+		_clear_steps();				// turn step bits off
+
+		if (st_run.dir_hold_ticks != 0) {			// a held tick doesn't count
+			st_run.dir_hold_ticks--;
+		} else if (--st_run.dda_ticks_downcount == 0) {	// process end of move
+			dda_timer.stop();						// turn it off or it will keep stepping out the last segment
+			_load_move();							// load the next move at the current interrupt level
+		} else if (st_run.dda_ticks_downcount == 1) {	// the last tick is next
+			_preset_directions();
+		}
+		dda_debug_pin2 = 0;
+		_record_isr_time(&st_isr.dda_match, start);
+	}
+}
+} // namespace Motate
+
+/*
+ * st_halt() - stop all stepping at once. OK to call from an ISR
+ *
+ *	Called by a limit switch interrupt. The DDA and axis move timers are stopped
+ *	where they are, with no deceleration, and the loader will not start anything else 
+ *	until the steppers are reset. Position is lost. Must run at a priority above the 
+ *	loader so a load can't start a segment in between.
+ */
+void st_halt()
+{
+	st_run.halted = true;						// set first - a DDA match ends in _load_move()
+	dda_timer.stop();
+#ifdef __AXIS_MOVE_ENGINE
+	axis_timer.stop();
+	st_axis.busy = false;
+#endif
+	_clear_steps();
+	st_run.dda_ticks_downcount = 0;
+	st_run.dir_hold_ticks = 0;
+	sv_stop();
+#ifdef __MOTION_SYNC
+	st_sync.waiting = SYNC_TIMER_NONE;
+	st_sync.pending = 0;
+#endif
+}
+
+/*
+ * st_stop_motors()		- stop stepping the motors in motor_mask. OK to call from an ISR
+ * st_release_motors()	- let all motors step again
+ *
+ *	Stops single motors while the rest of the move runs on, e.g. each axis of a 
+ *	homing group as it reaches its switch. The DDA keeps running and the motors 
+ *	stay energized. The running segment is stopped by zeroing the motor's phase 
+ *	increment, later segments by the loader, and streamed segments by masking the 
+ *	stream. The planner is not told, so the caller must correct the runtime 
+ *	position of the stopped axes - st_latch_position() records where they stopped.
+ *	Release only once motion has stopped.
+ */
+void st_stop_motors(const uint8_t motor_mask)
+{
+	st_run.motor_run &= ~motor_mask;			// set first - a DDA match may load a segment
+	st_run.motor_active &= ~motor_mask;
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if (motor_mask & (1<<motor)) { st_run.m[motor].phase_increment = 0;}
+	}
+}
+
+void st_release_motors() { st_run.motor_run = 0xFF;}
+
+/*
+ * st_latch_position()		 - record where the motors are now. OK to call from an ISR
+ * st_clear_latch()			 - forget the last latched position
+ * st_get_latched_position() - return TRUE and the absolute axis position if one was latched
+ * st_prep_position()		 - set the end position and travel of the segment being prepped
+ * st_prep_power()			 - set the spindle power ratio of the segment being prepped
+ * st_prep_outputs()		 - set the outputs switched as the segment being prepped starts
+ * st_set_outputs()			 - switch digital outputs now
+ * st_prep_raster()			 - set the raster pixels of the segment being prepped (below)
+ *
+ *	See stepper.h. The first call after st_clear_latch() wins. Interrupts are masked 
+ *	while the segment is copied so the DDA can't load the next one half way through.
+ *	Not for axis move engine moves, which don't run through the prep ring.
+ */
+void st_latch_position(const uint8_t latch)
+{
+	stLatch_t *l = &st_latch[latch];
+	if (l->latched == true) return;
+	__disable_irq();
+	l->ticks_left = st_run.dda_ticks_downcount;
+	l->ticks = st_run.dda_ticks;
+	copy_axis_vector(l->position, st_run.position);
+	copy_axis_vector(l->travel, st_run.travel);
+	__enable_irq();
+	l->latched = true;
+}
+
+void st_clear_latch(const uint8_t latch) { st_latch[latch].latched = false;}
+
+uint8_t st_get_latched_position(const uint8_t latch, float position[])
+{
+	stLatch_t *l = &st_latch[latch];
+	if (l->latched == false) return (false);
+	float remaining = (l->ticks == 0) ? 0 : (float)l->ticks_left / (float)l->ticks;
+	for (uint8_t i=0; i<AXES; i++) {
+		position[i] = l->position[i] - l->travel[i] * remaining;
+	}
+	return (true);
+}
+
+void st_prep_position(const float position[], const float travel[])
+{
+	copy_axis_vector(st_prep.bf[st_prep.exec_index].position, position);
+	copy_axis_vector(st_prep.bf[st_prep.exec_index].travel, travel);
+}
+
+void st_prep_power(float power) { st_prep.bf[st_prep.exec_index].power = power;}
+
+void st_prep_outputs(const uint8_t on, const uint8_t off)
+{
+	st_prep.bf[st_prep.exec_index].outputs_on = on;
+	st_prep.bf[st_prep.exec_index].outputs_off = off;
+}
+
+void st_set_outputs(const uint8_t on, const uint8_t off)
+{
+	if (on & 0x01) { output_1_pin.set();} else if (off & 0x01) { output_1_pin.clear();}
+	if (on & 0x02) { output_2_pin.set();} else if (off & 0x02) { output_2_pin.clear();}
+	if (on & 0x04) { output_3_pin.set();} else if (off & 0x04) { output_3_pin.clear();}
+	if (on & 0x08) { output_4_pin.set();} else if (off & 0x08) { output_4_pin.clear();}
+}
+
+/*
+ * st_prep_raster() - set the raster pixels of the segment being prepped
+ *
+ *	pixels	- the raster line's pixel levels
+ *	count	- how many
+ *	first	- pixel position at the segment start, in pixels from the line start
+ *	last	- ...and at its end
+ *
+ *	See Raster pixels in stepper.h. Copies the pixels the segment crosses and an off
+ *	pixel after them, for the position past the end of the line or of the copy.
+ */
+void st_prep_raster(const uint8_t pixels[], const uint16_t count, float first, float last)
+{
+	stPrepBuffer_t *sp = &st_prep.bf[st_prep.exec_index];
+	if (first < 0) { first = 0;}
+	if (first > count) { first = count;}
+	if (last < first) { last = first;}
+	uint16_t index = (uint16_t)first;
+	uint8_t n = min(count - index, ST_RASTER_PIXELS-1);
+	memcpy(sp->raster, &pixels[index], n);
+	sp->raster[n] = 0;
+	sp->raster_count = n+1;
+	sp->raster_phase = (uint32_t)((first - index) * 65536);
+	sp->raster_length = (uint32_t)((last - first) * 65536);
+}
+
+/*
+ * st_get_motion_seq() - count of planner buffers the motors have run past
+ *
+ *	Returns the count the running segment was prepped at (see mb.seq_freed), so output
+ *	commands keyed to a buffer run as the motors start it. With the motors stopped and 
+ *	nothing prepped everything prepped has run, so seq_prepped is returned. Called 
+ *	from the exec, which runs after every segment load.
  */
+uint32_t st_get_motion_seq(uint32_t seq_prepped)
+{
+	if ((st_run.dda_ticks_downcount == 0) && 
+		(st_prep.bf[st_prep.load_index].exec_state != PREP_BUFFER_OWNED_BY_LOADER)) {
+		return (seq_prepped);
+	}
+	return (st_run.seq);
+}
+
+#ifdef __AXIS_MOVE_ENGINE
+/****************************************************************************************
+ * Axis move engine - see stepper.h
+ * st_axis_move()		- start a move of the motors in motor_mask
+ * st_axis_stop()		- decelerate the running move to a stop
+ * st_axis_get_steps()	- return signed steps taken by the current or last move
+ * axis timer interrupt	- steps the motors and ramps the step period
+ *
+ *	Args to st_axis_move():
+ *	  motor_mask	- motors to step in lockstep, bit 0 = MOTOR_1
+ *	  steps			- signed number of steps to move
+ *	  velocity		- cruise velocity in steps per second
+ *	  acceleration	- acceleration and deceleration in steps per second^2
+ *
+ *	The period recurrence is c[n] = c[n-1] - 2*c[n-1]/(4n+1) to accelerate, and the 
+ *	reverse to decelerate. The first period is 0.676 * clock * sqrt(2/acceleration).
+ *	This is constant acceleration, not jerk limited. Deceleration starts when the 
+ *	steps remaining equal the steps it took to accelerate.
+ */
+
+stat_t st_axis_move(const uint8_t motor_mask, const int32_t steps, const float velocity, const float acceleration)
+{
+	if (stepper_isbusy() == true) { return (STAT_INTERNAL_ERROR);	// DDA or axis engine is running
+	} else if ((steps == 0) || (motor_mask == 0)) { return (STAT_OK);
+	} else if ((velocity < EPSILON) || (acceleration < EPSILON)) { return (STAT_INPUT_VALUE_TOO_SMALL);
+	}
+	uint32_t period_min = AXIS_MOVE_MIN_PERIOD_FACTOR * st_axis.pulse_ticks;
+	float period = (float)st_axis.timer_clock / velocity;
+	st_axis.period_min = (period > period_min) ? (uint32_t)period : period_min;
+
+	period = 0.676 * (float)st_axis.timer_clock * sqrt(2 / acceleration);
+	if (period > (float)0xFFFFFFF0) { period = (float)0xFFFFFFF0;}
+	st_axis.period = (period > st_axis.period_min) ? (uint32_t)period : st_axis.period_min;
+
+	st_axis.motor_mask = motor_mask;
+	st_axis.direction = (steps < 0) ? -1 : 1;
+	st_axis.steps_remaining = (steps < 0) ? -steps : steps;
+	st_axis.steps = 0;
+	st_axis.ramp_steps = 0;
+	st_axis.stop = false;
+	st_axis.busy = true;
+
+	uint8_t negative = (steps < 0) ? 1 : 0;
+	motor_1.axis_start(motor_mask, negative);
+	motor_2.axis_start(motor_mask, negative);
+	motor_3.axis_start(motor_mask, negative);
+	motor_4.axis_start(motor_mask, negative);
+	motor_5.axis_start(motor_mask, negative);
+	motor_6.axis_start(motor_mask, negative);
+#if (MOTORS >= 7)
+	motor_7.axis_start(motor_mask, negative);
+#endif
+#if (MOTORS >= 8)
+	motor_8.axis_start(motor_mask, negative);
+#endif
+
+	axis_timer.setTop(st_axis.period);
+	axis_timer.start();
+	return (STAT_OK);
+}
+
+void st_axis_stop()
+{
+	if (st_axis.busy == true) { st_axis.stop = true;}
+}
+
+int32_t st_axis_get_steps()
+{
+	return ((int32_t)st_axis.steps * st_axis.direction);
+}
+
 namespace Motate {			// Must define timer interrupts inside the Motate namespace
-MOTATE_TIMER_INTERRUPT(dda_timer_num)
+MOTATE_TIMER_INTERRUPT(axis_timer_num)
 {
-	uint32_t interrupt_cause = dda_timer.getInterruptCause();	// also clears interrupt condition
+	uint32_t interrupt_cause = axis_timer.getInterruptCause();	// also clears interrupt condition
 
 	if (interrupt_cause == kInterruptOnOverflow) {
-		dda_debug_pin1 = 1;
+		motor_1.axis_step(st_axis.motor_mask);		// turn step bits on
+		motor_2.axis_step(st_axis.motor_mask);
+		motor_3.axis_step(st_axis.motor_mask);
+		motor_4.axis_step(st_axis.motor_mask);
+		motor_5.axis_step(st_axis.motor_mask);
+		motor_6.axis_step(st_axis.motor_mask);
+#if (MOTORS >= 7)
+		motor_7.axis_step(st_axis.motor_mask);
+#endif
+#if (MOTORS >= 8)
+		motor_8.axis_step(st_axis.motor_mask);
+#endif
+		_exp_write_steps();							// expansion step bits go out in one frame
+		st_axis.steps++;
 
-		if (!motor_1.step.isNull() && (st_run.m[MOTOR_1].phase_accumulator += st_run.m[MOTOR_1].phase_increment) > 0) {
-			st_run.m[MOTOR_1].phase_accumulator -= st_run.dda_ticks_X_substeps;
-			motor_1.step.set();		// turn step bit on
-			INCREMENT_DIAGNOSTIC_COUNTER(MOTOR_1);
-		}
-		if (!motor_2.step.isNull() && (st_run.m[MOTOR_2].phase_accumulator += st_run.m[MOTOR_2].phase_increment) > 0) {
-			st_run.m[MOTOR_2].phase_accumulator -= st_run.dda_ticks_X_substeps;
-			motor_2.step.set();
-			INCREMENT_DIAGNOSTIC_COUNTER(MOTOR_2);
-		}
-		if (!motor_3.step.isNull() && (st_run.m[MOTOR_3].phase_accumulator += st_run.m[MOTOR_3].phase_increment) > 0) {
-			st_run.m[MOTOR_3].phase_accumulator -= st_run.dda_ticks_X_substeps;
-			motor_3.step.set();
-			INCREMENT_DIAGNOSTIC_COUNTER(MOTOR_3);
-		}
-		if (!motor_4.step.isNull() && (st_run.m[MOTOR_4].phase_accumulator += st_run.m[MOTOR_4].phase_increment) > 0) {
-			st_run.m[MOTOR_4].phase_accumulator -= st_run.dda_ticks_X_substeps;
-			motor_4.step.set();
-			INCREMENT_DIAGNOSTIC_COUNTER(MOTOR_4);
+		if ((--st_axis.steps_remaining > st_axis.ramp_steps) && (st_axis.stop == true)) {
+			st_axis.steps_remaining = st_axis.ramp_steps;	// stop: start the deceleration now
 		}
-		if (!motor_5.step.isNull() && (st_run.m[MOTOR_5].phase_accumulator += st_run.m[MOTOR_5].phase_increment) > 0) {
-			st_run.m[MOTOR_5].phase_accumulator -= st_run.dda_ticks_X_substeps;
-			motor_5.step.set();
-			INCREMENT_DIAGNOSTIC_COUNTER(MOTOR_5);
+		if (st_axis.steps_remaining == 0) return; 			// the match interrupt ends the move
+
+		if (st_axis.steps_remaining <= st_axis.ramp_steps) {	// decelerate
+			st_axis.period += (2 * st_axis.period) / (4 * st_axis.ramp_steps - 1);
+			st_axis.ramp_steps--;
+		} else if (st_axis.period > st_axis.period_min) {	// accelerate
+			st_axis.ramp_steps++;
+			st_axis.period -= (2 * st_axis.period) / (4 * st_axis.ramp_steps + 1);
+			if (st_axis.period < st_axis.period_min) { st_axis.period = st_axis.period_min;}
 		}
-		if (!motor_6.step.isNull() && (st_run.m[MOTOR_6].phase_accumulator += st_run.m[MOTOR_6].phase_increment) > 0) {
-			st_run.m[MOTOR_6].phase_accumulator -= st_run.dda_ticks_X_substeps;
-			motor_6.step.set();
-			INCREMENT_DIAGNOSTIC_COUNTER(MOTOR_6);
-		}
-		dda_debug_pin1 = 0;
-
-	} else if (interrupt_cause == kInterruptOnMatchA) { // dda_timer.getInterruptCause() == kInterruptOnMatchA
-		dda_debug_pin2 = 1;
-		motor_1.step.clear();		// turn step bits off
-		motor_2.step.clear();
-		motor_3.step.clear();
-		motor_4.step.clear();
-		motor_5.step.clear();
-		motor_6.step.clear();
-
-		if (--st_run.dda_ticks_downcount == 0) {	// process end of move
-			dda_timer.stop();						// turn it off or it will keep stepping out the last segment
-			_load_move();							// load the next move at the current interrupt level
+		axis_timer.setPeriod(st_axis.period, st_axis.pulse_ticks);	// timer keeps running
+
+	} else if (interrupt_cause == kInterruptOnMatchA) {
+		_clear_steps();								// turn step bits off
+		if (st_axis.steps_remaining == 0) {
+			axis_timer.stop();
+			motor_1.axis_end(st_axis.motor_mask);		// the motors time out to idle
+			motor_2.axis_end(st_axis.motor_mask);
+			motor_3.axis_end(st_axis.motor_mask);
+			motor_4.axis_end(st_axis.motor_mask);
+			motor_5.axis_end(st_axis.motor_mask);
+			motor_6.axis_end(st_axis.motor_mask);
+#if (MOTORS >= 7)
+			motor_7.axis_end(st_axis.motor_mask);
+#endif
+#if (MOTORS >= 8)
+			motor_8.axis_end(st_axis.motor_mask);
+#endif
+			st_axis.busy = false;
+			controller_signal(CTL_EVENT_MOTION_STOP);
 		}
-		dda_debug_pin2 = 0;
 	}
 }
 } // namespace Motate
 
+#endif // __AXIS_MOVE_ENGINE
+
 /****************************************************************************************
  * Exec sequencing code - computes and prepares next load segment
- * st_request_exec_move()	- SW interrupt to request to execute a move
+ * st_request_exec_move()	- request to execute a move - SW interrupt or background task
+ * st_exec_callback()		- background exec - fill the ring up to the fill target
  * exec_timer interrupt		- interrupt handler for calling exec function
+ * _request_exec()			- SW interrupt to run the exec
+ * _exec_segment()			- prep the next segment into the exec buffer
+ * _prep_fill()				- segments prepped and not yet loaded
+ * _next_prep_index()		- advance an index around the prep buffer ring
+ *
+ *	The exec interrupt fills as many prep buffers as are free each time it runs, so
+ *	it can get up to PREP_BUFFER_POOL_SIZE segments ahead of the loader. It stops 
+ *	when the ring is full or mp_exec_move() has nothing more to run (STAT_NOOP).
+ *	In background mode it only runs for a starved loader - see Background exec.
  */
 void st_request_exec_move()
 {
-	if (st_prep.exec_state == PREP_BUFFER_OWNED_BY_EXEC) {	// bother interrupting
+	if (st.exec_mode == EXEC_BACKGROUND) {
+		controller_set_ready(CTL_TASK_EXEC);
+		return;
+	}
+	_request_exec();
+}
+
+static void _request_exec()
+{
+	if (st_prep.bf[st_prep.exec_index].exec_state == PREP_BUFFER_OWNED_BY_EXEC) {	// bother interrupting
 		exec_timer.setInterruptPending();
 	}
 }
 
+stat_t st_exec_callback()
+{
+	if (st.exec_mode != EXEC_BACKGROUND) { return (STAT_NOOP);}
+	st_prep.exec_busy = true;					// set before the ring is looked at - see the exec ISR
+	while ((_prep_fill() < st.exec_fill) &&
+		   (st_prep.bf[st_prep.exec_index].exec_state == PREP_BUFFER_OWNED_BY_EXEC)) {
+		if (_exec_segment() == STAT_NOOP) break;
+	}
+	st_prep.exec_busy = false;
+	return (STAT_NOOP);							// the loader makes it ready again
+}
+
+static stat_t _exec_segment()
+{
+	uint32_t start = hw_get_cycle_count();
+	st_prep.bf[st_prep.exec_index].seq = mb.seq_freed;	// the buffer this segment comes from
+	stat_t status = mp_exec_move();
+	_record_isr_time(&st_isr.exec, start);
+	if (status == STAT_NOOP) { return (status);}
+
+	uint32_t cycles = hw_get_cycle_count() - start;
+	if (st.exec_mode == EXEC_BACKGROUND) { cycles /= st.exec_fill;}	// it has the ring's depth to run in
+	if ((st_prep.bf[st_prep.exec_index].move_type == MOVE_TYPE_ALINE) &&
+		(mp_check_exec_budget(cycles) == true)) {
+		st_seg.overbudget++;
+		st_seg.overbudget_line = cm_get_linenum(RUNTIME);
+	}
+	if ((st_prep.exec_index == st_prep.load_index) && 		// no other segment queued
+		(st_run.dda_ticks_downcount != 0) &&				// ...and the motors are running
+		(st_prep.bf[st_prep.exec_index].move_type == MOVE_TYPE_ALINE)) {
+		st_seg.late++;
+		st_seg.late_line = cm_get_linenum(RUNTIME);
+	}
+	st_prep.bf[st_prep.exec_index].exec_state = PREP_BUFFER_OWNED_BY_LOADER; // flip it back
+	st_prep.exec_index = _next_prep_index(st_prep.exec_index);
+	_request_load_move();
+	return (status);
+}
+
+static uint8_t _prep_fill()
+{
+	uint8_t fill = 0;
+	for (uint8_t i=0; i<PREP_BUFFER_POOL_SIZE; i++) {
+		if (st_prep.bf[i].exec_state == PREP_BUFFER_OWNED_BY_LOADER) { fill++;}
+	}
+	return (fill);
+}
+
+static uint8_t _next_prep_index(uint8_t index)
+{
+	if (++index >= PREP_BUFFER_POOL_SIZE) index = 0;
+	return (index);
+}
+
 namespace Motate {	// Define timer inside Motate namespace
+template<> void Timer<exec_timer_num>::interrupt() RAMFUNC;
 MOTATE_TIMER_INTERRUPT(exec_timer_num)			// exec move SW interrupt
 {
 	exec_timer.getInterruptCause();				// clears the interrupt condition
-   	if (st_prep.exec_state == PREP_BUFFER_OWNED_BY_EXEC) {
-		if (mp_exec_move() != STAT_NOOP) {
-			st_prep.exec_state = PREP_BUFFER_OWNED_BY_LOADER; // flip it back
-			_request_load_move();
+	if (st.exec_mode == EXEC_BACKGROUND) {		// rescue a starved loader
+		if (st_prep.exec_busy == true) { return;}	// ...unless the main loop is already on it
+		if (_exec_segment() != STAT_NOOP) {
+			st_seg.rescues++;
+			st_seg.rescue_line = cm_get_linenum(RUNTIME);
+			controller_set_ready(CTL_TASK_EXEC);
 		}
+		return;
+	}
+	while (st_prep.bf[st_prep.exec_index].exec_state == PREP_BUFFER_OWNED_BY_EXEC) {
+		if (_exec_segment() == STAT_NOOP) break;
 	}
 }
 
 } // namespace Motate
 
+#ifdef __MOTION_SYNC
+/****************************************************************************************
+ * Motion sync - see stepper.h
+ *
+ * _sync_init()	  - set the sync line up for the sync mode. Drops any edges held
+ * _sync_start()  - start a loaded segment. Called from _load_move()
+ * st_sync_edge() - an edge on the sync line. Called from the PIO interrupt of its port
+ *
+ *	The edge runs at the switch priority, above the loader, so _sync_start() tests 
+ *	for a held edge and sets the wait with interrupts off.
+ */
+
+static Pio *_sync_pio()
+{
+	if (kinen_sync_pin.portLetter == 'A') { return (PIOA);}
+	if (kinen_sync_pin.portLetter == 'B') { return (PIOB);}
+	if (kinen_sync_pin.portLetter == 'C') { return (PIOC);}
+	return (PIOD);
+}
+
+static IRQn_Type _sync_irqn()
+{
+	if (kinen_sync_pin.portLetter == 'A') { return (PIOA_IRQn);}
+	if (kinen_sync_pin.portLetter == 'B') { return (PIOB_IRQn);}
+	if (kinen_sync_pin.portLetter == 'C') { return (PIOC_IRQn);}
+	return (PIOD_IRQn);
+}
+
+static void _sync_init()
+{
+	Pio *pio = _sync_pio();
+	__disable_irq();
+	st_sync.waiting = SYNC_TIMER_NONE;
+	st_sync.pending = 0;
+	__enable_irq();
+	if (st.sync_mode == SYNC_FOLLOWER) {
+		kinen_sync_pin.setMode(kInput);
+		kinen_sync_pin.setOptions(kPullUp);
+		pio->PIO_AIMDR = kinen_sync_pin.mask;	// interrupt on both edges
+		pio->PIO_IER = kinen_sync_pin.mask;
+		NVIC_EnableIRQ(_sync_irqn());
+	} else {
+		pio->PIO_IDR = kinen_sync_pin.mask;		// the switch handlers may still run for the port
+		kinen_sync_pin.setMode(kOutput);
+	}
+}
+
+static void _sync_start(const uint8_t timer)
+{
+	if (st.sync_mode == SYNC_FOLLOWER) {
+		__disable_irq();
+		if (st_sync.pending == 0) {				// wait for the leader
+			st_sync.waiting = timer;
+			__enable_irq();
+			return;
+		}
+		st_sync.pending--;						// the leader is already running it
+		__enable_irq();
+	} else if (st.sync_mode == SYNC_LEADER) {
+		kinen_sync_pin.toggle();
+	}
+	dda_timer.start();
+}
+
+void st_sync_edge()
+{
+	if (st.sync_mode != SYNC_FOLLOWER) { return;}
+	if (st_sync.waiting == SYNC_TIMER_DDA) {
+		dda_timer.start();
+	} else {
+		st_sync.pending++;						// this board's segment isn't loaded yet
+		st_seg.sync_late++;
+		st_seg.sync_late_line = cm_get_linenum(RUNTIME);
+		return;
+	}
+	st_sync.waiting = SYNC_TIMER_NONE;
+}
+#endif // __MOTION_SYNC
+
 /****************************************************************************************
  * Load sequencing code
  *
@@ -469,6 +1532,7 @@ static void _request_load_move()
 }
 
 namespace Motate {	// Define timer inside Motate namespace
+template<> void Timer<load_timer_num>::interrupt() RAMFUNC;
 MOTATE_TIMER_INTERRUPT(load_timer_num)		// load steppers SW interrupt
 {
 	load_timer.getInterruptCause();			// read SR to clear interrupt condition
@@ -480,127 +1544,182 @@ MOTATE_TIMER_INTERRUPT(load_timer_num)		// load steppers SW interrupt
  * _load_move() - Dequeue move and load into stepper struct
  *
  *	This routine can only be called be called from an ISR at the same or 
- *	higher level as the DDA or dwell ISR. A software interrupt has been 
+ *	higher level as the DDA ISR. A software interrupt has been 
  *	provided to allow a non-ISR to request a load (see st_request_load_move())
  *
+ *	Moves are loaded from the load_index buffer in the prep ring. If that buffer
+ *	has not been prepped yet (the exec is running behind) there is nothing to do;
+ *	the exec will request another load once it finishes the buffer.
+ *
  *	In aline() code:
  *	 - All axes must set steps and compensate for out-of-range pulse phasing.
  *	 - If axis has 0 steps the direction setting can be omitted
  *	 - If axis has 0 steps the motor must not be enabled to support power mode = 1
+ *
+ *	A dwell is a segment with no motors in it (see st_prep_dwell()), so it shares the
+ *	DDA rate change, the timer start and the end of segment load with the alines.
  */
 
 void _load_move()
 {
-	// handle aline() loads first (most common case)  NB: there are no more lines, only alines()
-	if (st_prep.move_type == MOVE_TYPE_ALINE) {
-		st_run.dda_ticks_downcount = st_prep.dda_ticks;
-		st_run.dda_ticks_X_substeps = st_prep.dda_ticks_X_substeps;
- 
-		st_run.m[MOTOR_1].phase_increment = st_prep.m[MOTOR_1].phase_increment;
-		if (st_prep.reset_flag == true) {           // compensate for pulse phasing
-			st_run.m[MOTOR_1].phase_accumulator = -(st_run.dda_ticks_downcount);
-		}
-		if (st_run.m[MOTOR_1].phase_increment != 0) {	// motor is in this move
-			if (st_prep.m[MOTOR_1].dir == 0) {
-				motor_1.dir.clear();			// clear the bit for clockwise motion 
-			} else {
-				motor_1.dir.set();				// set the bit for CCW motion
-			}
-			motor_1.enable.clear();				// enable the motor (clear the ~Enable line)
-			st_run.m[MOTOR_1].power_state = MOTOR_RUNNING;
-		} else {								// motor is not in this move
-			if (st.m[MOTOR_1].power_mode == MOTOR_IDLE_WHEN_STOPPED) {
-				motor_1.enable.clear();			// energize motor
-				st_run.m[MOTOR_1].power_state = MOTOR_START_IDLE_TIMEOUT;
-			}			
-		}
-
-		st_run.m[MOTOR_2].phase_increment = st_prep.m[MOTOR_2].phase_increment;
-		if (st_prep.reset_flag == true) {
-			st_run.m[MOTOR_2].phase_accumulator = -(st_run.dda_ticks_downcount);
-		}
-		if (st_run.m[MOTOR_2].phase_increment != 0) {
-			if (st_prep.m[MOTOR_2].dir == 0) motor_2.dir.clear(); else motor_2.dir.set();
-			motor_2.enable.clear();
-			st_run.m[MOTOR_2].power_state = MOTOR_RUNNING;
-		} else {
-			if (st.m[MOTOR_2].power_mode == MOTOR_IDLE_WHEN_STOPPED) {
-				motor_2.enable.clear();
-				st_run.m[MOTOR_2].power_state = MOTOR_START_IDLE_TIMEOUT;
-			}
-		}
-
-		st_run.m[MOTOR_3].phase_increment = st_prep.m[MOTOR_3].phase_increment;
-		if (st_prep.reset_flag == true) {
-			st_run.m[MOTOR_3].phase_accumulator = -(st_run.dda_ticks_downcount);
-		}
-		if (st_run.m[MOTOR_3].phase_increment != 0) {
-			if (st_prep.m[MOTOR_3].dir == 0) motor_3.dir.clear(); else motor_3.dir.set();
-			motor_3.enable.clear();
-			st_run.m[MOTOR_3].power_state = MOTOR_RUNNING;
-		} else {
-			if (st.m[MOTOR_3].power_mode == MOTOR_IDLE_WHEN_STOPPED) {
-				motor_3.enable.clear();
-				st_run.m[MOTOR_3].power_state = MOTOR_START_IDLE_TIMEOUT;
-			}
-		}
-
-		st_run.m[MOTOR_4].phase_increment = st_prep.m[MOTOR_4].phase_increment;
-		if (st_prep.reset_flag == true) {
-			st_run.m[MOTOR_4].phase_accumulator = (st_run.dda_ticks_downcount);
+	uint32_t start = hw_get_cycle_count();
+	if (st_run.dda_ticks_downcount != 0) return;	// a segment or dwell is still running
+	if (st_run.halted == true) return;				// stopped by a limit switch
+#ifdef __ENCODERS
+	for (uint8_t i=0; i<ENCODERS; i++) {			// the motors are where the last segment left them
+		if (en.en[i].motor != 0) { en_sample(i, st_run.m[en.en[i].motor-1].position);}
+	}
+#endif
+#ifdef __STEP_STREAM
+	if (st_run.stream_bf != NULL) {					// the stream has finished playing
+		st_run.stream_bf->exec_state = PREP_BUFFER_OWNED_BY_EXEC;	// ...so release its buffer
+		st_run.stream_bf = NULL;
+		st_run.step_stream = NULL;
+	}
+#endif
+	stPrepBuffer_t *sp = &st_prep.bf[st_prep.load_index];
+	if (sp->exec_state != PREP_BUFFER_OWNED_BY_LOADER) {
+		sv_stop();									// analog motors stop with the steppers
+		if ((mr.move_state > MOVE_STATE_NEW) && (st_run.underrun == false)) {	// starved mid-move
+			st_run.underrun = true;					// count each stall once
+			st_seg.underruns++;
+			st_seg.underrun_line = cm_get_linenum(RUNTIME);
+			ev_record(EV_UNDERRUN, st_seg.underrun_line, 0);
+		} else if (mr.move_state <= MOVE_STATE_NEW) {	// nothing running or left to run
+			st_run.raster_count = 0;
+			pwm_set_power(PWM_1, 0);				// no dynamic power while stopped
+			controller_signal(CTL_EVENT_MOTION_STOP);
 		}
-		if (st_run.m[MOTOR_4].phase_increment != 0) {
-			if (st_prep.m[MOTOR_4].dir == 0) motor_4.dir.clear(); else motor_4.dir.set();
-			motor_4.enable.clear();
-			st_run.m[MOTOR_4].power_state = MOTOR_RUNNING;
+		if (mr.move_state > MOVE_STATE_NEW) {		// prep buffer is not ready yet
+			_request_exec();						// ...so run the exec now, even in background mode
 		} else {
-			if (st.m[MOTOR_4].power_mode == MOTOR_IDLE_WHEN_STOPPED) {
-				motor_4.enable.clear();
-				st_run.m[MOTOR_4].power_state = MOTOR_START_IDLE_TIMEOUT;
-			}
-		}
-
-		st_run.m[MOTOR_5].phase_increment = st_prep.m[MOTOR_5].phase_increment;
-		if (st_prep.reset_flag == true) {
-			st_run.m[MOTOR_5].phase_accumulator = (st_run.dda_ticks_downcount);
+			st_request_exec_move();
 		}
-		if (st_run.m[MOTOR_5].phase_increment != 0) {
-			if (st_prep.m[MOTOR_5].dir == 0) motor_5.dir.clear(); else motor_5.dir.set();
-			motor_5.enable.clear();
-			st_run.m[MOTOR_5].power_state = MOTOR_RUNNING;
-		} else {
-			if (st.m[MOTOR_5].power_mode == MOTOR_IDLE_WHEN_STOPPED) {
-				motor_5.enable.clear();
-				st_run.m[MOTOR_5].power_state = MOTOR_START_IDLE_TIMEOUT;
+		return;
+	}
+	st_run.underrun = false;
+	st_run.seq = sp->seq;
+	st_run.raster_count = 0;
+	if (sp->raster_count != 0) {
+		_load_raster(sp);							// the pixels set the power as the DDA runs
+	} else if (fp_NE(sp->power, PREP_POWER_NONE)) { pwm_set_power(PWM_1, sp->power);}	// latch power at the segment boundary
+	if ((sp->outputs_on | sp->outputs_off) != 0) { st_set_outputs(sp->outputs_on, sp->outputs_off);}	// ...and outputs
+
+	// handle aline() and dwell loads (most common case)  NB: there are no more lines, only alines()
+	if ((sp->move_type == MOVE_TYPE_ALINE) || (sp->move_type == MOVE_TYPE_DWELL)) {
+		st_run.dda_ticks_downcount = sp->dda_ticks;
+		st_run.dda_ticks_X_substeps = sp->dda_ticks_X_substeps;
+		st_run.dda_ticks = sp->dda_ticks;
+
+		// change DDA rate - timer is stopped here. Rescale accumulators to preserve phase
+		if (sp->dda_rate_shift != st_run.dda_rate_shift) {
+			dda_timer.setTop(sp->dda_period);
+			for (uint8_t i=0; i<MOTORS; i++) {
+				if (sp->dda_rate_shift > st_run.dda_rate_shift) {	// slower: fewer ticks per segment
+					st_run.m[i].phase_accumulator >>= (sp->dda_rate_shift - st_run.dda_rate_shift);
+				} else {
+					st_run.m[i].phase_accumulator <<= (st_run.dda_rate_shift - sp->dda_rate_shift);
+				}
 			}
+			st_run.dda_rate_shift = sp->dda_rate_shift;
 		}
-
-		st_run.m[MOTOR_6].phase_increment = st_prep.m[MOTOR_6].phase_increment;
-		if (st_prep.reset_flag == true) {
-			st_run.m[MOTOR_6].phase_accumulator = (st_run.dda_ticks_downcount);
-		}
-		if (st_run.m[MOTOR_6].phase_increment != 0) {
-			if (st_prep.m[MOTOR_6].dir == 0) motor_6.dir.clear(); else motor_6.dir.set();
-			motor_6.enable.clear();
-			st_run.m[MOTOR_6].power_state = MOTOR_RUNNING;
-		} else {
-			if (st.m[MOTOR_6].power_mode == MOTOR_IDLE_WHEN_STOPPED) {
-				motor_6.enable.clear();
-				st_run.m[MOTOR_6].power_state = MOTOR_START_IDLE_TIMEOUT;
-			}
+		st_run.motor_active = 0;				// each load() adds its motor if it steps
+	}
+	if (sp->move_type == MOVE_TYPE_ALINE) {
+		copy_axis_vector(st_run.position, sp->position);	// for st_latch_position()
+		copy_axis_vector(st_run.travel, sp->travel);
+#ifdef __STEP_STREAM
+		if (sp->stream == true) {
+			st_run.step_stream = sp->step_stream;
+			st_run.stream_bf = sp;
 		}
+#endif
+		motor_1.load(sp);						// unpopulated motors drop out at compile time
+		motor_2.load(sp);
+		motor_3.load(sp);
+		motor_4.load(sp);
+		motor_5.load(sp);
+		motor_6.load(sp);
+#if (MOTORS >= 7)
+		motor_7.load(sp);
+#endif
+#if (MOTORS >= 8)
+		motor_8.load(sp);
+#endif
+	} else if (sp->move_type == MOVE_TYPE_DWELL) {
+		for (uint8_t i=0; i<AXES; i++) { st_run.travel[i] = 0;}	// not moving - the motors stay as they are
+	}
+	if (st_run.dda_ticks_downcount != 0) {
+		if (st_run.dir_wait == true) { _dir_setup_hold(sp);}
+		sv_load(sp);
+#ifdef __MOTION_SYNC
+		_sync_start(SYNC_TIMER_DDA);			// on the leader's clock
+#else
 		dda_timer.start();		// start the DDA timer if not already running
-
-	// handle dwells
-	} else if (st_prep.move_type == MOVE_TYPE_DWELL) {
-		st_run.dda_ticks_downcount = st_prep.dda_ticks;
-		dwell_timer.start();
+#endif
 	}
 
 	// all cases drop to here - such as Null moves queued by MCodes
-	st_prep_null();										// needed to shut off timers if no moves left
-	st_prep.exec_state = PREP_BUFFER_OWNED_BY_EXEC;		// flip it back
+#ifdef __STEP_TRACE
+	if (sp->move_type != MOVE_TYPE_NULL) { st_trace_segment(sp);}
+#endif
+	sp->move_type = MOVE_TYPE_NULL;						// needed to shut off timers if no moves left
+	sp->power = PREP_POWER_NONE;
+	sp->outputs_on = 0;
+	sp->outputs_off = 0;
+	sp->raster_count = 0;
+	sp->servo_samples = 0;
+#ifdef __STEP_STREAM
+	if (st_run.stream_bf != sp)							// streamed buffers are released when they end
+#endif
+	sp->exec_state = PREP_BUFFER_OWNED_BY_EXEC;			// flip it back
+	st_prep.load_index = _next_prep_index(st_prep.load_index);
 	st_request_exec_move();								// compute and prepare the next move
+	_record_isr_time(&st_isr.load, start);
+
+	if (st_run.dda_ticks_downcount == 0) {				// Null move - nothing was started so
+		_request_load_move();							// ...load the next prepped buffer, if any
+	}
+}
+
+/*
+ * _preset_directions() - set the reversing directions of the next segment a tick early
+ * _dir_setup_hold()	- hold the start of a segment for the direction setup time
+ *
+ *	See Direction setup in stepper.h. _preset_directions() runs from the DDA match 
+ *	interrupt that leaves one tick in the segment. The next buffer is only read once
+ *	the exec has handed it to the loader, so it can't change underneath. 
+ *	_dir_setup_hold() runs from _load_move() just before the DDA starts. The first 
+ *	tick is one DDA period after the start, so only the rest of $dsu is held - as whole
+ *	DDA ticks that the DDA interrupt counts down without stepping or counting them.
+ */
+static void _preset_directions()
+{
+	const stPrepBuffer_t *np = &st_prep.bf[st_prep.load_index];
+	if ((np->exec_state != PREP_BUFFER_OWNED_BY_LOADER) || (np->move_type != MOVE_TYPE_ALINE)) return;
+#ifdef __STEP_STREAM
+	if ((st_run.step_stream != NULL) || (np->stream == true)) return;
+#endif
+	motor_1.preset_dir(np);
+	motor_2.preset_dir(np);
+	motor_3.preset_dir(np);
+	motor_4.preset_dir(np);
+	motor_5.preset_dir(np);
+	motor_6.preset_dir(np);
+#if (MOTORS >= 7)
+	motor_7.preset_dir(np);
+#endif
+#if (MOTORS >= 8)
+	motor_8.preset_dir(np);
+#endif
+}
+
+static void _dir_setup_hold(const stPrepBuffer_t *sp)
+{
+	st_run.dir_wait = false;
+	int32_t period = (int32_t)(sp->dda_period * st_run.dda_tick_cycles);	// CPU cycles a tick
+	int32_t hold = (int32_t)st_run.dir_setup_cycles - (int32_t)(hw_get_cycle_count() - st_run.dir_cycles) - period;
+	st_run.dir_hold_ticks = (hold > 0) ? (uint8_t)((hold + period - 1) / period) : 0;
 }
 
 /* 
@@ -610,65 +1729,245 @@ void _load_move()
  */
 void st_prep_null()
 {
-	st_prep.move_type = MOVE_TYPE_NULL;
+	st_prep.bf[st_prep.exec_index].move_type = MOVE_TYPE_NULL;
 }
 
 /* 
  * st_prep_dwell() 	 - Add a dwell to the move buffer
+ *
+ *	A dwell runs on the DDA timer as a segment with no steps, at the slowest DDA rate
+ *	to keep its interrupts down. It is timed to the nearest tick of that rate. A dwell 
+ *	too short for one tick is a Null move.
  */
 
 void st_prep_dwell(float microseconds)
 {
-	st_prep.move_type = MOVE_TYPE_DWELL;
-	st_prep.dda_ticks = (uint32_t)((microseconds/1000000) * FREQUENCY_DWELL); // ARM code
-//	st_prep.dda_period = _f_to_period(F_DWELL);	// AVR code
+	stPrepBuffer_t *sp = &st_prep.bf[st_prep.exec_index];
+	sp->move_type = MOVE_TYPE_DWELL;
+	sp->power = 0;										// dynamic power is off while dwelling
+	sp->reset_flag = false;
+	sp->dda_rate_shift = DDA_RATE_SHIFT_MAX;
+	sp->dda_period = st_prep.dda_period_base << DDA_RATE_SHIFT_MAX;
+	sp->dda_ticks = (uint32_t)((microseconds/1000000) * (FREQUENCY_DDA >> DDA_RATE_SHIFT_MAX) + 0.5);
+	sp->dda_ticks_X_substeps = sp->dda_ticks * DDA_SUBSTEPS;
+	for (uint8_t i=0; i<MOTORS; i++) { sp->m[i].servo_substeps = 0;}
+	sv_prep(sp, sp->dda_ticks << DDA_RATE_SHIFT_MAX);	// analog motors run down to zero
+#ifdef __STEP_STREAM
+	sp->stream = false;
+#endif
 }
 
 /***********************************************************************************
  * st_prep_line() - Prepare the next move for the loader
+ * st_prep_line_substeps() - fixed-point version of st_prep_line()
+ * st_prep_ticks() - segment time in DDA ticks for st_prep_line_substeps()
  *
  *	This function does the math on the next pulse segment and gets it ready for 
  *	the loader. It deals with all the DDA optimizations and timer setups so that
  *	loading can be performed as rapidly as possible. It works in joint space 
- *	(motors) and it works in steps, not length units. All args are provided as 
- *	floats and converted to their appropriate integer types for the loader. 
+ *	(motors) and it works in steps, not length units. 
+ *
+ *	st_prep_line_substeps() does all the work in integer math, which matters on 
+ *	the M3 as it has no FPU. The runtime gets its substeps from ik_kinematics() and 
+ *	calls it directly. st_prep_line() accepts floats, converts them and calls the 
+ *	integer version. It remains for callers that work in floating point steps.
+ *
+ *	st_prep_line() carries the part of a substep each motor's steps don't fill into 
+ *	the motor's next segment, so truncation doesn't add up over a long run. Steps that 
+ *	don't fit an int32 of substeps (about 21474) are refused rather than wrapped.
+ *	st_prep_ticks() returns 0, which st_prep_line_substeps() refuses, for a time that 
+ *	is too short or not a number.
  *
  * Args:
  *	steps[] are signed relative motion in steps (can be non-integer values)
  *	Microseconds - how many microseconds the segment should run 
+ *
+ * Args (substeps version):
+ *	substeps[] are signed relative motion in substeps (steps * DDA_SUBSTEPS)
+ *	ticks - segment duration in DDA ticks at FREQUENCY_DDA 
  */
 
-stat_t st_prep_line(float steps[], float microseconds)
+RAMFUNC stat_t st_prep_line(float steps[], float microseconds)
 {
 	// *** defensive programming ***
 	// trap conditions that would prevent queuing the line
-	if (st_prep.exec_state != PREP_BUFFER_OWNED_BY_EXEC) { return (STAT_INTERNAL_ERROR);
-	} else if (isfinite(microseconds) == false) { return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
+	if (isfinite(microseconds) == false) { return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
 	} else if (microseconds < EPSILON) { return (STAT_MINIMUM_TIME_MOVE_ERROR);
 	}
-	st_prep.reset_flag = false;         // initialize accumulator reset flag for this move.
+	int32_t substeps[MOTORS];
+	float residual[MOTORS];
+	for (uint8_t i=0; i<MOTORS; i++) {
+		float exact = steps[i] * DDA_SUBSTEPS + st_prep.residual[i];
+		if (fabs(exact) > DDA_SUBSTEPS_LIMIT) { return (STAT_INPUT_EXCEEDS_MAX_LENGTH);}
+		substeps[i] = (int32_t)exact;
+		residual[i] = exact - substeps[i];
+	}
+	stat_t status = st_prep_line_substeps(substeps, st_prep_ticks(microseconds));
+	if (status == STAT_OK) {
+		for (uint8_t i=0; i<MOTORS; i++) { st_prep.residual[i] = residual[i];}
+	}
+	return (status);
+}
+
+RAMFUNC uint32_t st_prep_ticks(float microseconds)
+{
+	if ((isfinite(microseconds) == false) || (microseconds < EPSILON)) { return (0);}
+	return ((uint32_t)(microseconds * DDA_TICKS_PER_USEC));
+}
+
+RAMFUNC stat_t st_prep_line_substeps(int32_t substeps[], uint32_t ticks)
+{
+	stPrepBuffer_t *sp = &st_prep.bf[st_prep.exec_index];
+
+	// *** defensive programming ***
+	if (sp->exec_state != PREP_BUFFER_OWNED_BY_EXEC) { return (STAT_INTERNAL_ERROR);
+	} else if (ticks == 0) { return (STAT_MINIMUM_TIME_MOVE_ERROR);
+	}
+	sp->reset_flag = false;         // initialize accumulator reset flag for this move.
 
 	// setup motor parameters
+	uint32_t max_substeps = 0;
 	for (uint8_t i=0; i<MOTORS; i++) {
-		st_prep.m[i].dir = ((steps[i] < 0) ? 1 : 0) ^ st.m[i].polarity;
-		st_prep.m[i].phase_increment = (uint32_t)fabs(steps[i] * DDA_SUBSTEPS);
+		int32_t motor_substeps = substeps[i];
+		sp->m[i].servo_substeps = 0;
+		if (st.m[i].output != MOTOR_OUTPUT_STEP) {	// analog motors don't step - see servo.h
+			sp->m[i].servo_substeps = motor_substeps;
+			motor_substeps = 0;
+		}
+		uint32_t phase_increment = (motor_substeps < 0) ? -motor_substeps : motor_substeps;
+		sp->m[i].dir = ((motor_substeps < 0) ? 1 : 0) ^ st.m[i].polarity;
+		sp->m[i].phase_increment = phase_increment;
+		if (phase_increment > max_substeps) { max_substeps = phase_increment;}
+	}
+
+	// choose the slowest DDA rate that still gives the fastest motor enough ticks per step
+	// ticks >= steps * DDA_MIN_TICKS_PER_STEP is tested as: ticks * substeps > substeps * min ticks
+	uint64_t min_ticks_X_substeps = (uint64_t)max_substeps * DDA_MIN_TICKS_PER_STEP;
+	uint8_t shift = 0;
+	while ((shift < DDA_RATE_SHIFT_MAX) && 
+		   (((uint64_t)(ticks >> (shift+1)) * DDA_SUBSTEPS) > min_ticks_X_substeps)) {
+		shift++;
 	}
-	st_prep.dda_ticks = (uint32_t)((microseconds/1000000) * FREQUENCY_DDA);
-	st_prep.dda_ticks_X_substeps = st_prep.dda_ticks * DDA_SUBSTEPS;
+	sp->dda_rate_shift = shift;
+	sp->dda_period = st_prep.dda_period_base << shift;
+	sp->dda_ticks = ticks >> shift;
+	sp->dda_ticks_X_substeps = sp->dda_ticks * DDA_SUBSTEPS;
 
 	// FOOTNOTE: The above expression was previously computed as below but floating
 	// point rounding errors caused subtle and nasty accumulated position errors:
 	// sp.dda_ticks_X_substeps = (uint32_t)((microseconds/1000000) * f_dda * dda_substeps);
 
 	// anti-stall measure in case change in velocity between segments is too great 
-	if ((st_prep.dda_ticks * ACCUMULATOR_RESET_FACTOR) < st_prep.prev_ticks) {  // NB: uint32_t math
-		st_prep.reset_flag = true;
+	// ticks are compared at the full DDA rate so DDA rate changes don't trigger resets
+	if (((sp->dda_ticks << shift) * ACCUMULATOR_RESET_FACTOR) < st_prep.prev_ticks) {  // NB: uint32_t math
+		sp->reset_flag = true;
+		st_seg.resets++;
+		st_seg.reset_line = cm_get_linenum(RUNTIME);
+	}
+	st_prep.prev_ticks = sp->dda_ticks << shift;
+
+#ifdef __STEP_STREAM
+	sp->stream = (sp->dda_ticks <= STEP_STREAM_TICKS_MAX) ? true : false;
+	if (sp->stream == true) {
+		_prep_step_stream(sp);
+	} else if (st_prep.stream_active == true) {
+		sp->reset_flag = true;			// runtime DDA accumulators are stale after a stream
 	}
-	st_prep.prev_ticks = st_prep.dda_ticks;
-	st_prep.move_type = MOVE_TYPE_ALINE;
+	st_prep.stream_active = sp->stream;
+#endif
+	_prep_motor_power(sp, ticks);
+	sv_prep(sp, ticks);
+	sp->move_type = MOVE_TYPE_ALINE;
 	return (STAT_OK);
 }
 
+/*
+ * _prep_motor_power() - set the motor currents of the segment being prepped
+ *
+ *	MOTOR_POWER_REDUCED_WHEN_IDLE runs at the power level. DYNAMIC_MOTOR_POWER scales 
+ *	from the idle level to the power level with the demand of the segment: full power 
+ *	while the move accelerates or decelerates, and the motor's rate over the rate at 
+ *	its axis velocity maximum in the cruise. Motors not in the segment get the idle 
+ *	level. Other modes don't use the prepped vref.
+ */
+static void _prep_motor_power(stPrepBuffer_t *sp, uint32_t ticks)
+{
+	uint8_t cruise = (mr.move_state == MOVE_STATE_BODY);
+	for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) {
+		cfgMotor_t *m = &st.m[motor];
+		if (m->power_mode == MOTOR_POWER_REDUCED_WHEN_IDLE) {
+			sp->m[motor].vref = _vref_duty(m->power_level);
+		} else if (m->power_mode == DYNAMIC_MOTOR_POWER) {
+			float demand = 0;
+			if (sp->m[motor].phase_increment != 0) {
+				demand = 1;
+				if ((cruise == true) && (m->motor_map < AXES)) {	// substeps per full rate tick at vmax
+					float rate_max = cm.a[m->motor_map].velocity_max * m->steps_per_unit * 
+									 DDA_SUBSTEPS / (60 * FREQUENCY_DDA);
+					if (rate_max > EPSILON) { demand = (float)sp->m[motor].phase_increment / (ticks * rate_max);}
+					if (demand > 1) { demand = 1;}
+				}
+			}
+			sp->m[motor].vref = _vref_duty(m->power_idle + (m->power_level - m->power_idle) * demand);
+		}
+	}
+}
+
+#ifdef __STEP_STREAM
+/*
+ * _init_stream_port_bits() - build the motor mask to port bits table
+ * _prep_step_stream()		- run the DDA for a segment and record the step mask for each tick
+ *
+ *	_prep_step_stream() keeps its own accumulators and applies the same reset and 
+ *	rate change rules as _load_move() does for the runtime DDA. It runs one motor at 
+ *	a time over the whole segment, which keeps the inner loop in registers.
+ */
+
+static void _init_stream_port_bits()
+{
+	for (uint16_t mask=0; mask < STEP_STREAM_MASKS; mask++) {
+		stream_port_bits[mask].a = _stream_port_bits(mask,'A');
+		stream_port_bits[mask].b = _stream_port_bits(mask,'B');
+		stream_port_bits[mask].c = _stream_port_bits(mask,'C');
+		stream_port_bits[mask].d = _stream_port_bits(mask,'D');
+	}
+}
+
+static void _prep_step_stream(stPrepBuffer_t *sp)
+{
+	int32_t *accumulator = st_prep.phase_accumulator;
+
+	for (uint8_t i=0; i<MOTORS; i++) {
+		if ((sp->reset_flag == true) || (st_prep.stream_active == false)) {
+			accumulator[i] = -(int32_t)sp->dda_ticks;
+		} else if (sp->dda_rate_shift > st_prep.stream_rate_shift) {
+			accumulator[i] >>= (sp->dda_rate_shift - st_prep.stream_rate_shift);
+		} else if (sp->dda_rate_shift < st_prep.stream_rate_shift) {
+			accumulator[i] <<= (st_prep.stream_rate_shift - sp->dda_rate_shift);
+		}
+	}
+	st_prep.stream_rate_shift = sp->dda_rate_shift;
+	memset(sp->step_stream, 0, sp->dda_ticks);
+
+	for (uint8_t i=0; i<MOTORS; i++) {
+		int32_t phase_increment = sp->m[i].phase_increment;
+		if (phase_increment == 0) continue;
+		int32_t phase_accumulator = accumulator[i];
+		int32_t ticks_X_substeps = sp->dda_ticks_X_substeps;
+		uint8_t step_bit = (1<<i);
+		uint8_t *tick = sp->step_stream;
+
+		for (uint32_t j=sp->dda_ticks; j>0; j--, tick++) {
+			if ((phase_accumulator += phase_increment) > 0) {
+				phase_accumulator -= ticks_X_substeps;
+				*tick |= step_bit;
+			}
+		}
+		accumulator[i] = phase_accumulator;
+	}
+}
+#endif // __STEP_STREAM
+
 /*
  * _set_hw_microsteps() - set microsteps in hardware
  *
@@ -707,16 +2006,38 @@ static void _set_hw_microsteps(const uint8_t motor, const uint8_t microstep_mode
 static int8_t _get_motor(const index_t index)
 {
 	char_t *ptr;
-	char_t motors[] = {"1234"};
+	char_t motors[] = {"12345678"};
 	char_t tmp[CMD_TOKEN_LEN+1];
 
-	strcpy_P(tmp, cfgArray[index].group);
+	strcpy_P(tmp, cfgTokens[index].group);
 	if ((ptr = strchr(motors, tmp[0])) == NULL) {
 		return (-1);
 	}
 	return (ptr - motors);
 }
 
+/*
+ * st_get_motor_position() - motor position in substeps. See Motor positions in stepper.h
+ * st_get_mp() - get motor position to the nearest whole step
+ */
+
+int64_t st_get_motor_position(const uint8_t motor)
+{
+	__disable_irq();								// 64 bits are not read atomically
+	int64_t position = st_run.m[motor].position;
+	__enable_irq();
+	return (position);
+}
+
+stat_t st_get_mp(cmdObj_t *cmd)
+{
+	int64_t position = st_get_motor_position(_get_motor(cmd->index));
+	position += (position < 0) ? -(DDA_SUBSTEPS/2) : (DDA_SUBSTEPS/2);	// nearest whole step
+	cmd->value = (float)(position / DDA_SUBSTEPS);
+	cmd->objtype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
 /*
  * _set_motor_steps_per_unit() - what it says
  * This function will need to be rethought if microstep morphing is implemented
@@ -726,6 +2047,14 @@ static void _set_motor_steps_per_unit(cmdObj_t *cmd)
 {
 	uint8_t m = _get_motor(cmd->index);
 	st.m[m].steps_per_unit = (360 / (st.m[m].step_angle / st.m[m].microsteps) / st.m[m].travel_rev);
+	ik_update_motor_map();
+}
+
+stat_t st_set_ma(cmdObj_t *cmd)			// motor map to axis
+{
+	set_ui8(cmd);
+	ik_update_motor_map();
+	return(STAT_OK);
 }
 
 stat_t st_set_sa(cmdObj_t *cmd)			// motor step angle
@@ -755,15 +2084,31 @@ stat_t st_set_mi(cmdObj_t *cmd)			// motor microsteps
 
 stat_t st_set_pm(cmdObj_t *cmd)			// motor power mode
 { 
-	ritorno (set_01(cmd));
-	if (fp_ZERO(cmd->value)) { // people asked this setting take effect immediately, hence:
-		_energize_motor(_get_motor(cmd->index));
-	} else {
+	if (cmd->value > DYNAMIC_MOTOR_POWER) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	if (fp_EQ(cmd->value, MOTOR_IDLE_WHEN_STOPPED)) { // people asked this setting take effect immediately, hence:
 		_deenergize_motor(_get_motor(cmd->index));
+	} else {
+		_energize_motor(_get_motor(cmd->index));	// reduced and dynamic modes time out to idle
 	}
 	return (STAT_OK);
 }
 
+stat_t st_set_pl(cmdObj_t *cmd)			// motor power level and idle power level
+{
+	if (cmd->value < 0) { return (STAT_INPUT_VALUE_TOO_SMALL);}
+	if (cmd->value > 1) { return (STAT_INPUT_VALUE_TOO_LARGE);}
+	set_flt(cmd);
+	st_set_motor_power(_get_motor(cmd->index));
+	return (STAT_OK);
+}
+
+stat_t st_set_gs(cmdObj_t *cmd)			// motor gantry squaring switch
+{
+	if (cmd->value > (SW_PAIRS * SW_POSITIONS)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	return (set_ui8(cmd));
+}
+
 stat_t st_set_mt(cmdObj_t *cmd)
 {
 	st.motor_idle_timeout = min(IDLE_TIMEOUT_SECONDS_MAX, max(cmd->value, IDLE_TIMEOUT_SECONDS_MIN));
@@ -782,6 +2127,100 @@ stat_t st_set_me(cmdObj_t *cmd)	// Make sure this function is not part of initia
 	return (STAT_OK);
 }
 
+/*
+ * ISR timing accessors - cfgArray target is the stIsrTiming_t struct for the ISR path
+ *
+ * st_get_isrn() - get minimum cycles (0 if there are no samples)
+ * st_get_isrx() - get maximum cycles
+ * st_get_isra() - get mean cycles
+ * st_set_isrz() - reset all ISR timing statistics
+ */
+
+static void _get_isr_timing(cmdObj_t *cmd, stIsrTiming_t *t)
+{
+	__disable_irq();								// take a consistent copy
+	memcpy(t, (stIsrTiming_t *)GET_TABLE_WORD(target), sizeof(stIsrTiming_t));
+	__enable_irq();
+	cmd->objtype = TYPE_INTEGER;
+}
+
+stat_t st_get_isrn(cmdObj_t *cmd)
+{
+	stIsrTiming_t t;
+	_get_isr_timing(cmd, &t);
+	cmd->value = (t.count == 0) ? 0 : (float)t.min;
+	return (STAT_OK);
+}
+
+stat_t st_get_isrx(cmdObj_t *cmd)
+{
+	stIsrTiming_t t;
+	_get_isr_timing(cmd, &t);
+	cmd->value = (float)t.max;
+	return (STAT_OK);
+}
+
+stat_t st_get_isra(cmdObj_t *cmd)
+{
+	stIsrTiming_t t;
+	_get_isr_timing(cmd, &t);
+	cmd->value = (t.count == 0) ? 0 : (float)(t.sum / t.count);
+	return (STAT_OK);
+}
+
+stat_t st_set_isrz(cmdObj_t *cmd)	// Make sure this function is not part of initialization --> f00
+{
+	_clear_isr_timing();
+	return (STAT_OK);
+}
+
+#ifdef __MOTION_SYNC
+stat_t st_set_syn(cmdObj_t *cmd)
+{
+	if ((cmd->value < SYNC_OFF) || (cmd->value > SYNC_FOLLOWER)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	_sync_init();
+	return (STAT_OK);
+}
+#endif
+
+/*
+ * st_set_exm() - set the exec mode - see Background exec
+ * st_set_exf() - set the background exec fill target in segments
+ */
+stat_t st_set_exm(cmdObj_t *cmd)
+{
+	if ((cmd->value < EXEC_INTERRUPT) || (cmd->value > EXEC_BACKGROUND)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	st_request_exec_move();						// pick up any segments the other mode left
+	return (STAT_OK);
+}
+
+stat_t st_set_exf(cmdObj_t *cmd)
+{
+	if ((cmd->value < 1) || (cmd->value > PREP_BUFFER_POOL_SIZE)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	return (STAT_OK);
+}
+
+/*
+ * st_set_dsu() - set the direction setup time - see Direction setup
+ */
+stat_t st_set_dsu(cmdObj_t *cmd)
+{
+	if ((cmd->value < 0) || (cmd->value > ST_DIR_SETUP_MAX)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_flt(cmd);
+	st_run.dir_setup_cycles = (uint32_t)(st.dir_setup * (F_CPU / 1000000));
+	return (STAT_OK);
+}
+
+stat_t st_set_segz(cmdObj_t *cmd)	// Make sure this function is not part of initialization --> f00
+{
+	memset(&st_seg, 0, sizeof(st_seg));
+	mp_reset_exec_budget();
+	return (STAT_OK);
+}
+
 
 /***********************************************************************************
  * TEXT MODE SUPPORT
@@ -804,7 +2243,15 @@ static const char fmt_0sa[] PROGMEM = "[%s%s] m%s step angle%20.3f%s\n";
 static const char fmt_0tr[] PROGMEM = "[%s%s] m%s travel per revolution%9.3f%s\n";
 static const char fmt_0mi[] PROGMEM = "[%s%s] m%s microsteps%16d [1,2,4,8]\n";
 static const char fmt_0po[] PROGMEM = "[%s%s] m%s polarity%18d [0=normal,1=reverse]\n";
-static const char fmt_0pm[] PROGMEM = "[%s%s] m%s power management%10d [0=remain powered,1=power down when idle]\n";
+static const char fmt_0pm[] PROGMEM = "[%s%s] m%s power management%10d [0=remain powered,1=power down when idle,2=reduce when idle,3=dynamic]\n";
+static const char fmt_0pl[] PROGMEM = "[%s%s] m%s power level%19.3f [0..1]\n";
+static const char fmt_0pi[] PROGMEM = "[%s%s] m%s idle power level%14.3f [0..1]\n";
+static const char fmt_0gs[] PROGMEM = "[%s%s] m%s gantry switch%13d [0=axis switch,1=xmin,2=xmax,3=ymin...]\n";
+static const char fmt_0mp[] PROGMEM = "[%s%s] m%s position%18.0f steps\n";
+static const char fmt_syn[] PROGMEM = "[syn] motion sync mode%13d [0=off,1=leader,2=follower]\n";
+static const char fmt_exm[] PROGMEM = "[exm] exec mode%20d [0=interrupt,1=background]\n";
+static const char fmt_exf[] PROGMEM = "[exf] exec fill target%13d segments\n";
+static const char fmt_dsu[] PROGMEM = "[dsu] direction setup time%13.1f uSec\n";
 
 void st_print_mt(cmdObj_t *cmd) { text_print_flt(cmd, fmt_mt);}
 void st_print_me(cmdObj_t *cmd) { text_print_nul(cmd, fmt_me);}
@@ -815,6 +2262,11 @@ static void _print_motor_ui8(cmdObj_t *cmd, const char *format)
 	fprintf_P(stderr, format, cmd->group, cmd->token, cmd->group, (uint8_t)cmd->value);
 }
 
+static void _print_motor_flt(cmdObj_t *cmd, const char *format)
+{
+	fprintf_P(stderr, format, cmd->group, cmd->token, cmd->group, cmd->value);
+}
+
 static void _print_motor_flt_units(cmdObj_t *cmd, const char *format, uint8_t units)
 {
 	fprintf_P(stderr, format, cmd->group, cmd->token, cmd->group, cmd->value, GET_TEXT_ITEM(msg_units, units));
@@ -826,5 +2278,73 @@ void st_print_tr(cmdObj_t *cmd) { _print_motor_flt_units(cmd, fmt_0tr, cm_get_un
 void st_print_mi(cmdObj_t *cmd) { _print_motor_ui8(cmd, fmt_0mi);}
 void st_print_po(cmdObj_t *cmd) { _print_motor_ui8(cmd, fmt_0po);}
 void st_print_pm(cmdObj_t *cmd) { _print_motor_ui8(cmd, fmt_0pm);}
+void st_print_gs(cmdObj_t *cmd) { _print_motor_ui8(cmd, fmt_0gs);}
+void st_print_pl(cmdObj_t *cmd) { _print_motor_flt(cmd, fmt_0pl);}
+void st_print_pi(cmdObj_t *cmd) { _print_motor_flt(cmd, fmt_0pi);}
+void st_print_mp(cmdObj_t *cmd) { _print_motor_flt(cmd, fmt_0mp);}
+void st_print_syn(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_syn);}
+void st_print_exm(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_exm);}
+void st_print_exf(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_exf);}
+void st_print_dsu(cmdObj_t *cmd) { text_print_flt(cmd, fmt_dsu);}
+
+static const char msg_isr_o[] PROGMEM = "DDA overflow";	// keyed by token[0] of the stripped token
+static const char msg_isr_m[] PROGMEM = "DDA match";
+static const char msg_isr_l[] PROGMEM = "load move";
+static const char msg_isr_e[] PROGMEM = "exec move";
+static const char msg_isr_k[] PROGMEM = "kinematics";
+static const char msg_isr_j[] PROGMEM = "DDA latency";
+static const char msg_isr_n[] PROGMEM = "min";			// keyed by token[1] of the stripped token
+static const char msg_isr_x[] PROGMEM = "max";
+static const char msg_isr_a[] PROGMEM = "mean";
+static const char fmt_isr[] PROGMEM = "[isr%s] %s %s%*lu cycles\n";
+
+void st_print_isr(cmdObj_t *cmd)
+{
+	const char *path = msg_isr_e;
+	if (cmd->token[0] == 'o') { path = msg_isr_o;}
+	else if (cmd->token[0] == 'm') { path = msg_isr_m;}
+	else if (cmd->token[0] == 'l') { path = msg_isr_l;}
+	else if (cmd->token[0] == 'k') { path = msg_isr_k;}
+	else if (cmd->token[0] == 'j') { path = msg_isr_j;}
+
+	const char *stat = msg_isr_a;
+	if (cmd->token[1] == 'n') { stat = msg_isr_n;}
+	else if (cmd->token[1] == 'x') { stat = msg_isr_x;}
+
+	fprintf_P(stderr, fmt_isr, cmd->token, path, stat, 
+			  (int)(24 - strlen(path) - strlen(stat)), (unsigned long)cmd->value);
+}
+
+static const char fmt_segun[] PROGMEM = "[segun] segment underruns%17lu\n";
+static const char fmt_segul[] PROGMEM = "[segul] last underrun line%16lu\n";
+static const char fmt_seglt[] PROGMEM = "[seglt] late segments%21lu\n";
+static const char fmt_segll[] PROGMEM = "[segll] last late segment line%12lu\n";
+static const char fmt_segar[] PROGMEM = "[segar] accumulator resets%16lu\n";
+static const char fmt_segal[] PROGMEM = "[segal] last accumulator reset line%7lu\n";
+static const char fmt_segob[] PROGMEM = "[segob] exec budget violations%12lu\n";
+static const char fmt_segol[] PROGMEM = "[segol] last exec budget violation line%3lu\n";
+static const char fmt_segbf[] PROGMEM = "[segbf] segment time backoff%14.2f\n";
+static const char fmt_segsy[] PROGMEM = "[segsy] sync late segments%16lu\n";
+static const char fmt_segsl[] PROGMEM = "[segsl] last sync late line%15lu\n";
+static const char fmt_segrs[] PROGMEM = "[segrs] exec rescues%22lu\n";
+static const char fmt_segrl[] PROGMEM = "[segrl] last exec rescue line%13lu\n";
+
+void st_print_seg(cmdObj_t *cmd)
+{
+	const char *format = fmt_segal;
+	if (strcmp(cmd->token, "un") == 0) { format = fmt_segun;}
+	else if (strcmp(cmd->token, "ul") == 0) { format = fmt_segul;}
+	else if (strcmp(cmd->token, "lt") == 0) { format = fmt_seglt;}
+	else if (strcmp(cmd->token, "ll") == 0) { format = fmt_segll;}
+	else if (strcmp(cmd->token, "ar") == 0) { format = fmt_segar;}
+	else if (strcmp(cmd->token, "ob") == 0) { format = fmt_segob;}
+	else if (strcmp(cmd->token, "ol") == 0) { format = fmt_segol;}
+	else if (strcmp(cmd->token, "sy") == 0) { format = fmt_segsy;}
+	else if (strcmp(cmd->token, "sl") == 0) { format = fmt_segsl;}
+	else if (strcmp(cmd->token, "rs") == 0) { format = fmt_segrs;}
+	else if (strcmp(cmd->token, "rl") == 0) { format = fmt_segrl;}
+	else if (strcmp(cmd->token, "bf") == 0) { fprintf_P(stderr, fmt_segbf, (double)cmd->value); return;}
+	fprintf_P(stderr, format, (unsigned long)cmd->value);
+}
 
 #endif // __TEXT_MODE
@@ -50,6 +50,7 @@
  *		max pulse rate for the fastest move, it's capable of sustaining this rate for any
  *		move. So just run it flat out and get the best pulse resolution for all moves. 
  *		If we were running from batteries we might not be so cavalier about this.
+ *		(Exception: very slow segments drop to a lower DDA rate. See Adaptive DDA rate)
  *
  *    - Pulse phasing is preserved between segments if possible. This makes for smoother
  *		motion, particularly at very low speeds and short segment lengths (avoids pulse 
@@ -182,8 +183,8 @@
  *********************************/
 //See hardware.h for platform specific stepper definitions
 
-// Currently there is no distinction between IDLE and OFF (DEENERGIZED)
-// In the future IDLE will be powered at a low, torque-maintaining current
+// IDLE is OFF (deenergized) except in the reduced and dynamic power modes, which hold 
+// an idle motor at its idle power level (see st_set_motor_power())
 
 enum motorPowerState {				// used w/start and stop flags to sequence motor power
 	MOTOR_OFF = 0,					// motor is stopped and deenergized
@@ -197,15 +198,65 @@ enum motorPowerState {				// used w/start and stop flags to sequence motor power
 enum cmStepperPowerMode {
 	MOTOR_ENERGIZED_DURING_CYCLE=0,	// motor is fully powered during cycles
 	MOTOR_IDLE_WHEN_STOPPED,		// idle motor shortly after it's stopped - even in cycle
-	MOTOR_POWER_REDUCED_WHEN_IDLE,	// enable Vref current reduction (not implemented yet)
-	DYNAMIC_MOTOR_POWER				// adjust motor current with velocity (not implemented yet)
+	MOTOR_POWER_REDUCED_WHEN_IDLE,	// full power level in motion, idle power level once the idle timeout expires
+	DYNAMIC_MOTOR_POWER				// power level scaled with velocity and acceleration, idle power level when stopped
 };
 
+enum stMotorOutput {				// $1ot - see Analog servo axes in servo.h
+	MOTOR_OUTPUT_STEP = 0,			// step and direction
+	MOTOR_OUTPUT_DAC0,				// velocity on DAC0
+	MOTOR_OUTPUT_DAC1,				// velocity on DAC1
+	MOTOR_OUTPUT_TYPES
+};
+#define SERVO_CHANNELS (MOTOR_OUTPUT_TYPES - MOTOR_OUTPUT_DAC0)
+
 enum prepBufferState {
 	PREP_BUFFER_OWNED_BY_LOADER = 0,// staging buffer is ready for load
 	PREP_BUFFER_OWNED_BY_EXEC		// staging buffer is being loaded
 };
 
+/* Prep buffer ring
+ *	PREP_BUFFER_POOL_SIZE sets how many prepared segments can be staged between 
+ *	the exec and the loader. Each buffer holds one segment (usually 5ms), so the
+ *	exec can run this many segments ahead of the DDA. This absorbs latency in 
+ *	servicing the exec interrupt (USB traffic, main loop activity) that would 
+ *	otherwise starve the loader and cause stutters.
+ *
+ *	Deeper is more jitter tolerant but increases the lag between the exec and 
+ *	the actual motion - e.g. for feedhold response and M code synchronization.
+ *	Setting it to 1 reverts to the original single prep buffer behavior.
+ */
+#ifndef PREP_BUFFER_POOL_SIZE
+#define PREP_BUFFER_POOL_SIZE 4		// number of prepared segments in the prep ring
+#endif
+
+/* Background exec
+ *	By default ($exm=0) segments are generated in the exec interrupt: all of the 
+ *	segment math - mp_exec_move(), the input shaper, pressure advance, ik_kinematics() 
+ *	and st_prep_line() - preempts the main loop whenever the loader frees a buffer, 
+ *	and has to finish within the segment the DDA is running.
+ *
+ *	With $exm=1 the exec runs in the main loop instead, as a ready task 
+ *	(st_exec_callback(), CTL_TASK_EXEC). st_request_exec_move() only makes the task 
+ *	ready, and the task fills the prep ring until $exf segments are prepped ahead of 
+ *	the loader, or the runtime has nothing more to run. The interrupt is then left to 
+ *	the loader, which takes finished segments off the ring. A segment now has the whole
+ *	depth of the ring to be generated in ($exf segment times less a main loop pass) 
+ *	rather than one, so heavier shaping, compensation or kinematics fit, and the main 
+ *	loop is no longer preempted by them. A lower $exf cuts the lag to a feedhold or 
+ *	an M code; PREP_BUFFER_POOL_SIZE can be raised for a deeper ring.
+ *
+ *	The ring running dry is the deadline. If the loader finds no segment mid-move it 
+ *	runs one exec pass in the exec interrupt, as in $exm=0, to get the motors going 
+ *	again - unless the main loop is in the middle of one, which will load its segment
+ *	when it's done. These rescues are counted in the segment telemetry; any at all 
+ *	mean a main loop pass took longer than the ring holds.
+ */
+enum stExecMode {
+	EXEC_INTERRUPT = 0,				// segments are generated in the exec interrupt
+	EXEC_BACKGROUND					// ...in the main loop up to the fill target
+};
+
 // Stepper power management settings
 // Min/Max timeouts allowed for motor disable. Allow for inertial stop; must be non-zero
 #define IDLE_TIMEOUT_SECONDS_MIN 	(float)0.1		// seconds !!! SHOULD NEVER BE ZERO !!!
@@ -220,6 +271,17 @@ enum prepBufferState {
  *	Set to 1 to disable, but don't do this or you will lose a lot of accuracy.
  */
 #define DDA_SUBSTEPS 100000		// 100,000 accumulates substeps to 6 decimal places
+#define DDA_TICKS_PER_USEC ((float)FREQUENCY_DDA / 1000000)	// converts microseconds to DDA ticks
+#define DDA_SUBSTEPS_LIMIT ((float)2147483520.0)	// most substeps a segment can carry - the largest float under 2^31
+
+/* Step rate limit
+ *	A motor takes at most one step per DDA tick, and well before that its steps phase
+ *	unevenly - runs of back to back ticks with a gap between them. The planner holds
+ *	each axis to the velocity at which its fastest stepping motor reaches 
+ *	ST_STEP_RATE_MAX, so a high microstep setting lowers the rapids rather than 
+ *	clipping steps (see cm_set_move_terms() and $xvs).
+ */
+#define ST_STEP_RATE_MAX ((float)FREQUENCY_DDA / 2)	// fastest a motor is planned to step (steps/sec)
 
 /* Accumulator resets
  * 	You want to reset the DDA accumulators if the new ticks value is way less 
@@ -230,6 +292,190 @@ enum prepBufferState {
  */
 #define ACCUMULATOR_RESET_FACTOR 2	// amount counter range can safely change
 
+/* Adaptive DDA rate
+ *	The DDA runs at FREQUENCY_DDA for fast segments, but slow segments (Z plunges, 
+ *	jogging, deceleration tails) don't need that resolution. st_prep_line() lowers 
+ *	the DDA rate for a segment by a power of 2 (the rate shift) as long as the 
+ *	fastest motor still gets at least DDA_MIN_TICKS_PER_STEP ticks per step. 
+ *	_load_move() reprograms the DDA timer period at the segment boundary. 
+ *
+ *	Power of 2 rates allow the phase accumulators to be rescaled by shifting when 
+ *	the rate changes, so pulse phasing is preserved as if the rate were constant.
+ *	The step pulse width is set by the timer match value and does not change.
+ *
+ *	Set DDA_RATE_SHIFT_MAX to 0 to always run at FREQUENCY_DDA.
+ */
+#define DDA_RATE_SHIFT_MAX 4		// slowest DDA rate is FREQUENCY_DDA / 2^4 (6.25 KHz)
+#define DDA_MIN_TICKS_PER_STEP 8	// min DDA ticks per step for the fastest motor in the segment
+
+/* Step stream engine
+ *	With __STEP_STREAM defined st_prep_line() runs the DDA ahead of time in the exec 
+ *	and stores one byte per DDA tick in the prep buffer - a mask of the motors that 
+ *	step on that tick. The DDA ISR then plays the stream back: one table lookup and 
+ *	one SODR store per port per tick, with no per-motor accumulator math. The planner
+ *	and the st_prep_line() / _load_move() contract are unchanged.
+ *
+ *	A streamed prep buffer is held by the loader until its stream has finished playing.
+ *	Segments longer than STEP_STREAM_TICKS_MAX ticks fall back to the runtime DDA.
+ *	Requires __STEP_PORT_WRITES (stepper.cpp). Costs STEP_STREAM_TICKS_MAX bytes of 
+ *	RAM per prep buffer plus a 1Kb port mask table.
+ */
+//#define __STEP_STREAM				// uncomment to enable the step stream engine
+#define STEP_STREAM_TICKS_MAX 1024	// max ticks in a streamed segment (10 ms at 100 KHz)
+
+/* Raster pixels
+ *	A raster line segment (see RASTER LINES in planner.h) carries the pixels it crosses
+ *	in its prep buffer, with the pixel position at its start and its length in pixels
+ *	(Q16.16). _load_move() divides the length by the segment's DDA ticks, and the DDA 
+ *	overflow ISR adds that to the position each tick. When it moves onto a new pixel 
+ *	the ISR writes the pixel's duty to the spindle PWM (see pwm_set_raster()) - an add,
+ *	a compare and a register store. The duty is the pixel level (0-255) of the S power
+ *	scaled by the segment's dynamic power ratio, so ramps get the same energy per mm.
+ *
+ *	So pixels change on DDA ticks, and the PWM takes them up at the end of its period -
+ *	run the PWM several times faster than the pixel rate. A segment holds at most 
+ *	ST_RASTER_PIXELS pixels; the exec keeps segments short enough unless the pixel rate
+ *	is over ST_RASTER_PIXELS per MIN_SEGMENT_USEC, in which case the rest of the segment
+ *	runs with the laser off. Costs ST_RASTER_PIXELS bytes per prep buffer and one more
+ *	in the runtime.
+ */
+#define ST_RASTER_PIXELS 64			// max pixels in a raster segment (25 KHz pixel rate at 2.5 ms)
+
+/* Axis move engine
+ *	With __AXIS_MOVE_ENGINE defined single axis moves (homing) can bypass the planner,
+ *	the runtime and the DDA. The engine steps one set of motors in lockstep from its 
+ *	own timer (axis_timer_num). Each step is one timer period, and the period is ramped 
+ *	per step for constant acceleration (David Austin's recurrence, integer math in the ISR). 
+ *	Position is the count of steps taken. The DDA timer remains stopped throughout.
+ *
+ *	st_axis_move() starts a move, st_axis_stop() ramps it down to a stop (e.g. on a 
+ *	switch closure), and st_axis_get_steps() returns the signed steps taken. 
+ *	stepper_isbusy() is true while an axis move runs. The motors of a finished move start 
+ *	their idle timeout, as they do when the DDA stops them.
+ */
+#define __AXIS_MOVE_ENGINE			// comment out to run homing moves through the planner
+#define AXIS_MOVE_MIN_PERIOD_FACTOR 2	// min step period, in step pulse widths
+
+/* Step trace
+ *	With __STEP_TRACE defined _load_move() records what it hands the DDA for each 
+ *	segment - DDA ticks and rate shift, phase increments, direction bits and whether 
+ *	the accumulators were reset - in a ring of the last ST_TRACE_ENTRIES segments. 
+ *	$trc dumps the ring oldest first ({"trc":""} dumps it as JSON) and $trcz=1 clears it.
+ *	Dump it with the machine stopped - the ring keeps recording while it is read.
+ *
+ *	The simulator records the same ring (see platform/sim), so dumps from the board 
+ *	and the simulator running the same Gcode can be diffed to catch timing and rounding
+ *	regressions in st_prep_line() without a logic analyzer. Recording is a 32 byte copy
+ *	per segment. Costs ST_TRACE_ENTRIES * 32 bytes of RAM.
+ */
+//#define __STEP_TRACE				// uncomment to record the step trace
+#define ST_TRACE_ENTRIES 64			// segments kept - must be a power of 2
+
+/* Direction setup
+ *	Drivers want the direction line steady for a setup time before the next step
+ *	edge - a few hundred ns for the chip drivers, up to 5 us for opto-isolated ones.
+ *	The loader sets direction at the end of the last tick of a segment, and the DDA
+ *	is restarted at the top of a period, so a motor that reverses gets one DDA period
+ *	less the load time. At the top DDA rates that can be less than the driver needs.
+ *
+ *	So the DDA looks ahead as the second to last tick of a segment ends. If the next
+ *	segment is already prepped, each motor that reverses in it and can't step on the
+ *	last tick - its accumulator won't cross, or it isn't in the segment - gets its new
+ *	direction then, a period early. Streamed segments (see Step stream engine) are not
+ *	looked ahead of. The expansion motors gain the most, as their direction bits only 
+ *	go out with the next step frame.
+ *
+ *	The loader then holds the start of the next segment, if it has to, until the last
+ *	direction change is $dsu microseconds before its first tick. The hold is counted
+ *	in whole DDA ticks that don't step - the interrupt doesn't wait - so it only happens
+ *	where the lookahead couldn't help and the DDA period is shorter than $dsu - never at
+ *	the default FREQUENCY_DDA with $dsu at 5 or less. It stretches the segment by the
+ *	ticks held. $dsu=0 turns the hold off.
+ *	The simulator has no direction lines and ignores $dsu.
+ */
+#define ST_DIR_SETUP_MAX 20			// longest direction setup hold - microseconds
+
+/* Motor positions
+ *	Each motor's position is kept as a 64 bit count of substeps, added up from the 
+ *	signed phase increment of each segment as _load_move() hands it to the DDA. It is 
+ *	where the motor will be at the end of the loaded segment. It is counted from the 
+ *	same phase increments the DDA steps from, so it doesn't drift from the motor. It is zeroed 
+ *	at power up and left alone by homing and G92, which rename axis positions without 
+ *	moving the motors. A segment cut short by st_halt() or st_stop_motors() is counted 
+ *	whole. Axis moves (homing) are not counted.
+ *
+ *	ik_kinematics() carries the fraction of a substep left over by each segment into 
+ *	the next, so converting the runtime's float steps doesn't lose substeps either. 
+ *	st_prep_line() does the same for callers that still pass float steps.
+ *	Read with {"1mp":""} (whole steps) or st_get_motor_position().
+ */
+
+/* Motion sync
+ *	With __MOTION_SYNC defined boards can share the kinen sync line to drive more 
+ *	motors than one board has. One board leads ($syn=1) and the others follow ($syn=2).
+ *	Every board is sent the same Gcode and has the same axis settings - only the motor 
+ *	maps differ - so each plans the same segments. The leader toggles the sync line as 
+ *	_load_move() starts each segment or dwell. A follower loads its segment as usual 
+ *	but holds the DDA timer until the next edge, so every segment starts on 
+ *	the leader's clock and the boards can't drift apart over a long program.
+ *
+ *	An edge that comes before the follower has loaded its segment - its exec is behind 
+ *	- is kept and the segment starts as soon as it is loaded. These are counted as sync 
+ *	late segments in the segment telemetry. A follower waits as long as it takes for an 
+ *	edge, so anything that plans differently on the boards stops the followers: a 
+ *	planner that runs dry on one board and not the other (stream to all boards and 
+ *	wait on the slowest), or a feedhold that doesn't reach every board at the same 
+ *	time (wire the feedhold and cycle start inputs in common). Needs __SWITCH_INTERRUPTS,
+ *	as the edge is taken in the PIO interrupt of the sync pin's port.
+ */
+#ifndef __SIM						// the simulator is one board - there is no sync line
+#define __MOTION_SYNC				// comment out to leave the sync line alone
+#endif
+
+/* Step expansion
+ *	A build with EXPANSION_MOTORS set to 1 or 2 (see tinyg2.h) has motors 7 and 8, whose
+ *	step, direction and enable lines are on an external 74HC595 shift register clocked 
+ *	from the SPI. A frame is one byte. For expansion motor k (0 is motor 7) step is bit 
+ *	3k, direction 3k+1 and enable 3k+2 (high disables, as on the board); bit 0 comes out
+ *	on QA. MOSI (PA26), SPCK (PA27) and NPCS0 (PA28) drive SER, SRCLK and RCLK - the chip
+ *	select rises at the end of every frame and latches it onto the outputs.
+ *
+ *	The DDA ISR ticks the expansion motors with the others. On a tick where one of them
+ *	steps it stores the frame in the SPI transmit register just before it writes the 
+ *	on-chip step bits, so the expansion step edges follow the board's by one frame - 
+ *	under a microsecond at ST_EXP_SPI_BAUD. The match interrupt sends the frame with the
+ *	step bits clear the same way, so the pulse is as wide as on the board. A frame is a
+ *	single store - the SPI has no PDC on this part. Direction and enable changes are sent
+ *	as they are made, with interrupts masked so they can't cut across a step frame. The
+ *	axis move engine steps the expansion motors the same way.
+ *
+ *	Nothing waits for the SPI. A frame sent while one is shifting and another is in the
+ *	transmit register is held as pending, and as every frame holds all eight bits the
+ *	next one sent covers it - the next tick's, or st_expansion_tick() once a millisecond
+ *	from SysTick if the motors are stopped. Only the output changes of one load come that
+ *	close together, and a DDA period is ten frames, so a step frame doesn't wait.
+ *
+ *	The register takes SPI0, which is where the file device looks for its serial flash,
+ *	so a build with expansion motors has no file device. The drivers have no vref - set
+ *	their current on the driver. Not available with __STEP_STREAM, whose port tables 
+ *	hold 6 motors. The simulator steps the expansion motors like the others.
+ */
+#ifndef ST_EXP_SPI
+#define ST_EXP_SPI 			SPI0
+#define ST_EXP_SPI_ID 		ID_SPI0
+#define ST_EXP_SPI_PIO 		PIOA
+#define ST_EXP_SPI_PINS 	(PIO_PA26A_SPI0_MOSI | PIO_PA27A_SPI0_SPCK | PIO_PA28A_SPI0_NPCS0)
+#endif
+#ifndef ST_EXP_SPI_BAUD
+#define ST_EXP_SPI_BAUD 	10500000	// SPI clock - a frame takes under a microsecond
+#endif
+
+enum stSyncMode {
+	SYNC_OFF = 0,					// sync line not used
+	SYNC_LEADER,					// toggles the sync line at each segment start
+	SYNC_FOLLOWER					// starts each segment on a sync line edge
+};
+
 /*
  * Stepper control structures
  *
@@ -238,7 +484,7 @@ enum prepBufferState {
  *	data structure:						static to:		runs at:
  *	  mpBuffer planning buffers (bf)	  planner.c		  main loop
  *	  mrRuntimeSingleton (mr)			  planner.c		  MED ISR
- *	  stPrepSingleton (sp)				  stepper.c		  MED ISR
+ *	  stPrepSingleton (sp)				  stepper.c		  MED ISR (ring of prep buffers)
  *	  stRunSingleton (st)				  stepper.c		  HI ISR
  *  
  *	Care has been taken to isolate actions on these structures to the 
@@ -252,13 +498,21 @@ typedef struct cfgMotor {			// per-motor configs
   	uint8_t microsteps;				// microsteps to apply for each axis (ex: 8)
 	uint8_t polarity;				// 0=normal polarity, 1=reverse motor direction
  	uint8_t power_mode;				// See stepper.h for enum
+	uint8_t gantry_switch;			// homing switch of this motor on a gantry: switch number + 1. 0 = the axis switch
+	uint8_t output;					// see stMotorOutput
 	float step_angle;				// degrees per whole step (ex: 1.8)
 	float travel_rev;				// mm or deg of travel per motor revolution
 	float steps_per_unit;			// steps (usteps)/mm or deg of travel
+	float power_level;				// motor current in motion [0..1] of full scale vref
+	float power_idle;				// motor current when idle in the reduced and dynamic power modes [0..1]
 } cfgMotor_t;
 
 typedef struct stConfig {			// stepper configs
 	float motor_idle_timeout;		// seconds before setting motors to idle current (currently this is OFF)
+	uint8_t sync_mode;				// see stSyncMode
+	uint8_t exec_mode;				// see stExecMode
+	uint8_t exec_fill;				// segments the background exec keeps prepped ahead
+	float dir_setup;				// microseconds between a direction change and the next step - see Direction setup
 	cfgMotor_t m[MOTORS];			// settings for motors 1-4
 } stConfig_t;
 
@@ -269,14 +523,40 @@ typedef struct stRunMotor { 		// one per controlled motor
 	int32_t phase_accumulator;		// DDA phase angle accumulator for axis
 	uint8_t power_state;			// state machine for managing motor power
 	uint32_t power_systick;			// sys_tick for next state transition
-	uint32_t power_level;			// power level for this segment (FUTURE)
+	uint32_t power_level;			// vref PWM duty the motor is set to
 	uint8_t step_count_diagnostic;	// step count diagnostic
+	int64_t position;				// substeps at the end of the loaded segment - see Motor positions
 } stRunMotor_t;
 
 typedef struct stRunSingleton {		// Stepper static values and axis parameters
 	uint16_t magic_start;			// magic number to test memory integrity	
+	uint8_t dda_rate_shift;			// DDA rate currently programmed: FREQUENCY_DDA >> shift
 	int32_t dda_ticks_downcount;	// tick down-counter (unscaled)
 	int32_t dda_ticks_X_substeps;	// ticks multiplied by scaling factor
+	uint8_t underrun;				// true while the loader is starved mid-move (counted once)
+	volatile uint8_t halted;		// set by st_halt() - nothing more is loaded until reset
+	volatile uint8_t motor_run;		// motors allowed to step: bit 0 = MOTOR_1. See st_stop_motors()
+	volatile uint8_t motor_active;	// motors with steps in the running segment - the only ones the DDA ticks
+	uint8_t dir;					// direction pins as last set: bit 0 = MOTOR_1 - see Direction setup
+	uint8_t dir_wait;				// a direction changed since the last segment started
+	uint32_t dir_cycles;			// hw_get_cycle_count() of the last direction change
+	uint32_t dir_setup_cycles;		// $dsu in CPU cycles
+	volatile uint8_t dir_hold_ticks;// DDA ticks to hold before the segment steps - see Direction setup
+	uint32_t dda_ticks;				// DDA ticks in the running segment
+	float position[AXES];			// absolute axis position at the end of the running segment
+	float travel[AXES];				// axis travel of the running segment
+	uint32_t seq;					// planner buffers freed when the running segment was prepped
+	volatile uint8_t power_start;	// set when any motor enters MOTOR_START_IDLE_TIMEOUT
+	uint8_t dda_tick_cycles;		// CPU cycles per DDA timer count - for dda_latency
+	uint8_t raster_count;			// pixels in raster[], 0 if the segment isn't a raster line
+	uint32_t raster_pixel;			// pixel the PWM is set to
+	uint32_t raster_phase;			// pixel position in raster[] (Q16.16)
+	uint32_t raster_step;			// pixels per DDA tick (Q16.16)
+	uint8_t raster[ST_RASTER_PIXELS];// pixel levels of the running segment
+#ifdef __STEP_STREAM
+	uint8_t *step_stream;			// next tick in the step stream being played, or NULL for DDA
+	struct stPrepBuffer *stream_bf;	// prep buffer being streamed - released when the stream ends
+#endif
 	stRunMotor_t m[MOTORS];			// runtime motor structures
 } stRunSingleton_t;
 
@@ -286,22 +566,189 @@ typedef struct stRunSingleton {		// Stepper static values and axis parameters
 typedef struct stPrepMotor {
  	uint32_t phase_increment; 		// total steps in axis times substep factor
 	int8_t dir;						// direction
+	uint16_t vref;					// vref PWM duty - reduced and dynamic power modes only
+	int32_t servo_substeps;			// signed travel of an analog motor, which the DDA doesn't step
 } stPrepMotor_t;
 
-typedef struct stPrepSingleton {
-	uint16_t magic_start;			// magic number to test memory integrity	
+typedef struct stPrepBuffer {		// one prepared segment in the prep ring
+	volatile uint8_t exec_state;	// buffer ownership - see prepBufferState
 	uint8_t move_type;				// move type
-	volatile uint8_t exec_state;	// move execution state 
-	volatile uint8_t reset_flag;	// TRUE if accumulator should be reset
-	uint32_t prev_ticks;			// tick count from previous move
-	uint16_t dda_period;			// DDA or dwell clock period setting
-	uint32_t dda_ticks;				// DDA or dwell ticks for the move
+	uint8_t reset_flag;				// TRUE if accumulator should be reset
+	uint8_t dda_rate_shift;			// DDA rate for this segment: FREQUENCY_DDA >> shift
+	uint32_t dda_period;			// DDA timer period (top) for this segment
+	uint32_t dda_ticks;				// DDA ticks for the move or dwell
 	uint32_t dda_ticks_X_substeps;	// DDA ticks scaled by substep factor
+	float position[AXES];			// absolute axis position at the end of the segment - see st_latch_position()
+	float travel[AXES];				// axis travel of the segment
+	float power;					// spindle power ratio for the segment, or PREP_POWER_NONE - see st_prep_power()
+	uint8_t outputs_on;				// digital outputs switched on as the segment starts - see st_prep_outputs()
+	uint8_t outputs_off;			// ...and off
+	uint32_t seq;					// planner buffers freed when the segment was prepped - see st_get_motion_seq()
+	uint8_t raster_count;			// pixels in raster[], 0 if not a raster line - see st_prep_raster()
+	uint32_t raster_phase;			// pixel position at the segment start (Q16.16)
+	uint32_t raster_length;			// pixels the segment runs across (Q16.16)
+	uint8_t raster[ST_RASTER_PIXELS];// pixel levels, the last is always off
+	uint16_t servo_samples;			// DAC samples per channel, 0 leaves the DACs alone - see sv_prep()
+	uint32_t servo_period;			// DAC sample clock counts per conversion
+	uint16_t servo_start[SERVO_CHANNELS];// DAC codes at the start of the segment...
+	uint16_t servo_end[SERVO_CHANNELS];	// ...and at the end
 //	float segment_velocity;			// record segment velocity for diagnostics
 	stPrepMotor_t m[MOTORS];		// per-motor structs
+#ifdef __STEP_STREAM
+	uint8_t stream;					// TRUE if the segment is played from step_stream[]
+	uint8_t step_stream[STEP_STREAM_TICKS_MAX];	// motor step mask for each DDA tick
+#endif
+} stPrepBuffer_t;
+
+typedef struct stPrepSingleton {
+	uint16_t magic_start;			// magic number to test memory integrity	
+	uint8_t exec_index;				// next buffer to be prepped. Written only by exec
+	uint8_t load_index;				// next buffer to be loaded. Written only by loader
+	volatile uint8_t exec_busy;		// the background exec is running mp_exec_move()
+	uint32_t prev_ticks;			// tick count from previous move - normalized to FREQUENCY_DDA
+	uint32_t dda_period_base;		// DDA timer period (top) at FREQUENCY_DDA
+	float residual[MOTORS];			// fraction of a substep left over by st_prep_line()
+#ifdef __STEP_STREAM
+	uint8_t stream_active;			// TRUE if the previous segment was streamed
+	uint8_t stream_rate_shift;		// DDA rate of the previous streamed segment
+	int32_t phase_accumulator[MOTORS];	// DDA accumulators used to generate streams
+#endif
+	stPrepBuffer_t bf[PREP_BUFFER_POOL_SIZE];	// prep buffer ring
 } stPrepSingleton_t;
 
+/* ISR timing
+ *	Cycle counts (DWT CYCCNT, F_CPU clocks) are kept for the DDA overflow and match 
+ *	paths, _load_move(), mp_exec_move() and the ik_kinematics() part of it. Counts are wall clock cycles including 
+ *	any preemption by higher priority interrupts. The match path includes the 
+ *	_load_move() that occurs at the end of each segment. DDA latency is the time from
+ *	the start of a DDA period to the overflow ISR reading the timer - its spread is 
+ *	the step jitter (see $jit in benchmark.cpp). Read with {"isr":""} 
+ *	and reset with {"isrz":1}
+ */
+typedef struct stIsrTiming {		// timing for one ISR path
+	uint32_t min;					// minimum cycles observed
+	uint32_t max;					// maximum cycles observed
+	uint32_t count;					// number of samples
+	uint64_t sum;					// total cycles - for computing the mean
+} stIsrTiming_t;
+
+typedef struct stIsrTimingSingleton {
+	stIsrTiming_t dda_overflow;		// DDA ISR step generation (overflow) path
+	stIsrTiming_t dda_match;		// DDA ISR step clear (match) path
+	stIsrTiming_t load;				// _load_move()
+	stIsrTiming_t exec;				// mp_exec_move() called from the exec ISR
+	stIsrTiming_t kinematics;		// ik_kinematics() - part of the exec time
+	stIsrTiming_t dda_latency;		// DDA overflow: timer period start to ISR entry
+} stIsrTimingSingleton_t;
+
+/* Segment telemetry
+ *	Counts the events that make motion stutter. Each count also keeps the runtime 
+ *	Gcode line number of the most recent event. Line numbers are taken from the 
+ *	runtime model, which runs up to PREP_BUFFER_POOL_SIZE segments ahead of the 
+ *	motors. Read with {"seg":""} (or add the tokens to the status report) and 
+ *	reset with {"segz":1}
+ *
+ *	  underruns	- the DDA finished a segment mid-move and the next was not prepped yet
+ *	  late		- exec finished a segment with no other segment queued - a near miss
+ *	  resets	- accumulator resets from a velocity drop (ACCUMULATOR_RESET_FACTOR)
+ *	  overbudget- exec runs that took over EXEC_BUDGET_RATIO of their segment time
+ *	  sync late	- follower segments loaded after the leader's sync edge (see Motion sync)
+ *	  rescues	- segments the exec interrupt made for a starved loader (see Background exec)
+ */
+typedef struct stSegmentTelemetry {
+	uint32_t underruns;				// segment underruns - motors stopped waiting for exec
+	uint32_t underrun_line;			// line number of the last underrun
+	uint32_t late;					// exec completions with the prep ring empty
+	uint32_t late_line;				// line number of the last late completion
+	uint32_t resets;				// accumulator resets triggered by ACCUMULATOR_RESET_FACTOR
+	uint32_t reset_line;			// line number of the last accumulator reset
+	uint32_t overbudget;			// exec runs over the exec time budget
+	uint32_t overbudget_line;		// line number of the last exec budget violation
+	uint32_t sync_late;				// follower segments loaded after their sync edge
+	uint32_t sync_late_line;		// line number of the last sync late segment
+	uint32_t rescues;				// background exec rescues
+	uint32_t rescue_line;			// line number of the last rescue
+} stSegmentTelemetry_t;
+
+/* Position latch
+ *	st_latch_position() records where the motors are at the moment it is called, to 
+ *	the DDA tick. It is called from the switch interrupt when a probe trips, and by 
+ *	parallel homing as each axis reaches its switch. It takes 
+ *	the ticks left in the running segment and the segment's end position and travel, 
+ *	which the exec records for each segment with st_prep_position(). The position is 
+ *	interpolated across the segment when it is read with st_get_latched_position(). 
+ *	This uses the runtime's own axis positions, so no forward kinematics are needed.
+ *	Non-linear kinematics are linear in joint space across a segment, so the result
+ *	is within the segment length error (see KINEMATICS_SEGMENT_LENGTH).
+ *
+ *	There is one latch per axis so each axis of a homing group can latch on its own
+ *	switch in the same move. Probing uses ST_LATCH_PROBE.
+ */
+/* Segment power
+ *	In dynamic power mode (see pwm_set_power()) the exec records the spindle power 
+ *	ratio of each segment with st_prep_power(), and _load_move() sets the PWM as the 
+ *	segment starts. Dwells run with the power off. PREP_POWER_NONE leaves the PWM alone.
+ */
+#define PREP_POWER_NONE -1
+
+/* Segment outputs
+ *	Output triggers (M62, M63 - see mp_queue_output_trigger()) are switched by the loader 
+ *	too. The exec sets the outputs of the segment the trigger falls in with 
+ *	st_prep_outputs(), bit 0 being output 1, and _load_move() switches them with 
+ *	st_set_outputs() as that segment starts on the motors.
+ */
+
+#define ST_LATCHES AXES				// number of position latches
+#define ST_LATCH_PROBE 0			// latch used by the probing cycle
+
+typedef struct stLatch {
+	volatile uint8_t latched;		// TRUE once a position has been recorded
+	uint32_t ticks_left;			// DDA ticks left in the segment when latched
+	uint32_t ticks;					// DDA ticks in the segment
+	float position[AXES];			// segment end position
+	float travel[AXES];				// segment travel
+} stLatch_t;
+
+#ifdef __STEP_TRACE
+#define ST_TRACE_RESET 0x01			// accumulators were reset for pulse phasing
+#define ST_TRACE_DWELL 0x02			// a dwell - a segment with no steps
+
+typedef struct stTraceEntry {		// one loaded segment - see Step trace, above
+	uint32_t dda_ticks;				// ticks at the segment's DDA rate
+	uint32_t phase_increment[MOTORS];// substeps per DDA tick - 0 if the motor is not in the segment
+	uint8_t dir;					// direction bits as set on the pins: bit 0 = MOTOR_1
+	uint8_t flags;					// ST_TRACE_RESET, ST_TRACE_DWELL
+	uint8_t rate_shift;				// DDA rate: FREQUENCY_DDA >> rate_shift
+	uint8_t reserved;
+} stTraceEntry_t;
+
+typedef struct stTraceRing {
+	uint32_t count;					// segments recorded since the last clear
+	stTraceEntry_t entry[ST_TRACE_ENTRIES];	// entry[count % ST_TRACE_ENTRIES] is written next
+} stTraceRing_t;
+#endif
+
+typedef struct stAxisMoveSingleton {	// axis move engine runtime. Used by the axis timer ISR
+	volatile uint8_t busy;			// true while a move is running
+	uint8_t motor_mask;				// motors being stepped: bit 0 = MOTOR_1
+	volatile uint8_t stop;			// stop requested - decelerate to a stop
+	int8_t direction;				// +1 or -1
+	uint32_t steps_remaining;		// steps left to take
+	volatile uint32_t steps;		// steps taken (position counter)
+	uint32_t ramp_steps;			// steps taken on the acceleration ramp
+	uint32_t period;				// current step period in axis timer ticks
+	uint32_t period_min;			// cruise step period
+	uint32_t timer_clock;			// axis timer clock (ticks per second)
+	uint32_t pulse_ticks;			// step pulse width in axis timer ticks
+} stAxisMoveSingleton_t;
+
 extern stConfig_t st;
+extern stIsrTimingSingleton_t st_isr;
+extern stSegmentTelemetry_t st_seg;
+
+#ifdef __STEP_TRACE
+extern stTraceRing_t st_trace;
+#endif
 
 /**** FUNCTION PROTOTYPES ****/
 
@@ -313,19 +760,66 @@ void st_energize_motors(void);
 void st_deenergize_motors(void);
 void st_set_motor_power(const uint8_t motor);
 stat_t st_motor_power_callback(void);
+void st_expansion_tick(void);
 
 void st_request_exec_move(void);
+stat_t st_exec_callback(void);
+void st_halt(void);
+void st_stop_motors(const uint8_t motor_mask);
+void st_release_motors(void);
+void st_latch_position(const uint8_t latch);
+void st_clear_latch(const uint8_t latch);
+uint8_t st_get_latched_position(const uint8_t latch, float position[]);
+void st_prep_position(const float position[], const float travel[]);
+void st_prep_power(float power);
+void st_prep_outputs(const uint8_t on, const uint8_t off);
+void st_set_outputs(const uint8_t on, const uint8_t off);
+void st_prep_raster(const uint8_t pixels[], const uint16_t count, float first, float last);
+uint32_t st_get_motion_seq(uint32_t seq_prepped);
 void st_prep_null(void);
 void st_prep_dwell(float microseconds);
 stat_t st_prep_line(float steps[], float microseconds);
+stat_t st_prep_line_substeps(int32_t substeps[], uint32_t ticks);
+uint32_t st_prep_ticks(float microseconds);
+int64_t st_get_motor_position(const uint8_t motor);
+
+#ifdef __AXIS_MOVE_ENGINE
+stat_t st_axis_move(const uint8_t motor_mask, const int32_t steps, const float velocity, const float acceleration);
+void st_axis_stop(void);
+int32_t st_axis_get_steps(void);
+#endif
 
+void st_record_kinematics_time(const uint32_t start);
+
+stat_t st_set_ma(cmdObj_t *cmd);
 stat_t st_set_sa(cmdObj_t *cmd);
 stat_t st_set_tr(cmdObj_t *cmd);
 stat_t st_set_mi(cmdObj_t *cmd);
 stat_t st_set_pm(cmdObj_t *cmd);
+stat_t st_set_gs(cmdObj_t *cmd);
+stat_t st_set_pl(cmdObj_t *cmd);
 stat_t st_set_mt(cmdObj_t *cmd);
 stat_t st_set_md(cmdObj_t *cmd);
 stat_t st_set_me(cmdObj_t *cmd);
+stat_t st_set_exm(cmdObj_t *cmd);
+stat_t st_set_exf(cmdObj_t *cmd);
+stat_t st_set_dsu(cmdObj_t *cmd);
+#ifdef __MOTION_SYNC
+void st_sync_edge(void);
+stat_t st_set_syn(cmdObj_t *cmd);
+#endif
+
+stat_t st_get_mp(cmdObj_t *cmd);
+stat_t st_get_isrn(cmdObj_t *cmd);
+stat_t st_get_isrx(cmdObj_t *cmd);
+stat_t st_get_isra(cmdObj_t *cmd);
+stat_t st_set_isrz(cmdObj_t *cmd);
+stat_t st_set_segz(cmdObj_t *cmd);
+#ifdef __STEP_TRACE
+void st_trace_segment(const stPrepBuffer_t *sp);
+stat_t st_get_trc(cmdObj_t *cmd);
+stat_t st_set_trcz(cmdObj_t *cmd);
+#endif
 
 #ifdef __TEXT_MODE
 
@@ -338,6 +832,17 @@ stat_t st_set_me(cmdObj_t *cmd);
 	void st_print_mi(cmdObj_t *cmd);
 	void st_print_po(cmdObj_t *cmd);
 	void st_print_pm(cmdObj_t *cmd);
+	void st_print_gs(cmdObj_t *cmd);
+	void st_print_pl(cmdObj_t *cmd);
+	void st_print_pi(cmdObj_t *cmd);
+	void st_print_mp(cmdObj_t *cmd);
+	void st_print_syn(cmdObj_t *cmd);
+	void st_print_exm(cmdObj_t *cmd);
+	void st_print_exf(cmdObj_t *cmd);
+	void st_print_dsu(cmdObj_t *cmd);
+	void st_print_isr(cmdObj_t *cmd);
+	void st_print_seg(cmdObj_t *cmd);
+	void st_print_trc(cmdObj_t *cmd);
 
 #else
 
@@ -350,6 +855,17 @@ stat_t st_set_me(cmdObj_t *cmd);
 	#define st_print_mi tx_print_stub
 	#define st_print_po tx_print_stub
 	#define st_print_pm tx_print_stub
+	#define st_print_gs tx_print_stub
+	#define st_print_pl tx_print_stub
+	#define st_print_pi tx_print_stub
+	#define st_print_mp tx_print_stub
+	#define st_print_syn tx_print_stub
+	#define st_print_exm tx_print_stub
+	#define st_print_exf tx_print_stub
+	#define st_print_dsu tx_print_stub
+	#define st_print_isr tx_print_stub
+	#define st_print_seg tx_print_stub
+	#define st_print_trc tx_print_stub
 
 #endif // __TEXT_MODE
 
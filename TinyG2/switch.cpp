@@ -32,19 +32,26 @@
  *	  - Hitting a homing switch puts the current move into feedhold
  *	  - Hitting a limit switch causes the machine to shut down and go into lockdown until reset
  *
- * 	The normally open switch modes (NO) trigger an interrupt on the falling edge 
- *	and lockout subsequent interrupts for the defined lockout period. This approach 
- *	beats doing debouncing as an integration as switches fire immediately.
- *
- * 	The normally closed switch modes (NC) trigger an interrupt on the rising edge 
- *	and lockout subsequent interrupts for the defined lockout period. Ditto on the method.
+ * 	The normally open switch modes (NO) trigger on the falling edge and the normally 
+ *	closed modes (NC) on the rising edge. The first edge of a settled switch fires 
+ *	immediately, then the switch is debounced by counting timed samples until it is 
+ *	steady again (see switch.h). A lockout of fixed length would hide a genuine second 
+ *	edge - such as the homing latch after a short backoff - for the whole lockout.
  */
 
 #include "tinyg2.h"
 #include "config.h"
 #include "switch.h"
+#include "controller.h"
 #include "hardware.h"
 #include "canonical_machine.h"
+#include "planner.h"
+#include "stepper.h"
+#include "encoder.h"
+#include "spindle.h"
+#include "pwm.h"
+#include "event_log.h"
+#include "xio_file.h"
 #include "text_parser.h"
 
 #include "MotateTimers.h"
@@ -58,6 +65,16 @@ switches_t sw;
 //static void _led_off(switch_t *s);
 static void _trigger_feedhold(switch_t *s);
 static void _trigger_cycle_start(switch_t *s);
+static uint8_t _estop_stopped(const uint8_t pin_value);
+static void _estop_trip(void);
+static void _switch_irq_enable(void);
+static void _switch_irq_disable(void);
+static void _switch_filter_init(void);
+static void _switch_change(switch_t *s, uint8_t state);
+static uint8_t _switch_debounce(switch_t *s, uint8_t state);
+#ifdef __SWITCH_INTERRUPTS
+static void _switch_edge(switch_t *s, uint8_t pin_value, uint8_t sample);
+#endif
 
 static void _no_action(switch_t *s) { return; }
 //static void _led_on(switch_t *s) { IndicatorLed.clear(); }
@@ -79,6 +96,8 @@ void switch_init(void)
 
 	switch_t *s;	// shorthand
 
+	_switch_irq_disable();					// switch_init() is re-run on config changes
+	if (sw.debounce_samples == 0) { sw.debounce_samples = 1;}	// before the config is loaded
 	for (uint8_t axis=0; axis<SW_PAIRS; axis++) {
 		for (uint8_t position=0; position<SW_POSITIONS; position++) {
 			s = &sw.s[axis][position];
@@ -87,42 +106,255 @@ void switch_init(void)
 //			s->mode = SW_MODE_DISABLED;		// set from config			
 			s->state = false;
 			s->edge = SW_NO_EDGE;
-			s->debounce_ticks = SW_LOCKOUT_TICKS;
-			s->debounce_timeout = 0;
+			s->sample = false;
+			s->steady = sw.debounce_samples;// settled, so a closed switch is acted on when first read
+			s->edge_steps = 0;
 
 			// functions bound to each switch
 			s->when_open = _no_action;
 			s->when_closed = _no_action;
-			s->on_leading = _trigger_feedhold;
-			s->on_trailing = _trigger_cycle_start;
 		}
 	}
+	switch_reset_callbacks();
+	_switch_filter_init();					// after the modes are known
 	// functions bound to individual switches
 	// <none>
 	// sw.s[AXIS_X][SW_MIN].when_open = _led_off;
 	// sw.s[AXIS_X][SW_MIN].when_closed = _led_on;
+	_switch_irq_enable();					// also reads the switches once
+}
+
+#ifdef __SWITCH_INTERRUPTS
+/*
+ * Switch interrupts - see switch.h
+ *
+ * _switch_irq_enable()	 - enable change interrupts on the switch pins and read them all once
+ * _switch_irq_disable() - disable the switch port interrupts
+ * switch_tick()		 - take a debounce sample - called from the SysTick interrupt
+ * PIOx_Handler()		 - port change interrupts. Read the level of every switch on the port
+ * _switch_edge()		 - process a switch that may have changed. Runs in the interrupt
+ *
+ *	The switch ports and pin masks are resolved at compile time from the switch pin
+ *	assignments in hardware.h, as the step ports are in stepper.cpp. Ports with no
+ *	switches are never enabled. Reading PIO_ISR clears every pending change on the 
+ *	port, so the handler looks at the level of each switch on the port and not only
+ *	the ones that interrupted - an unchanged switch costs a compare. 
+ *
+ *	The debounce samples are taken by the port handlers too, so the switch state is 
+ *	only written at the port interrupt priority. While any switch is settling the 
+ *	tick marks the ports for sampling and pends their interrupts. Bounces interrupt 
+ *	in between, but only the marked pass counts as a sample.
+ *
+ *	A motion sync follower also takes the sync line's edges in the handler for its 
+ *	port (see "Motion sync" in stepper.h). The sync pin is enabled by stepper.cpp.
+ *	The encoder phases are decoded in the handler for theirs (see encoder.h), and the
+ *	spindle tach pulses are timed in the handler for its port (see spindle.h).
+ *	Switches of axes not compiled in (see AXES) are left out of the port masks.
+ *	The e-stop input is read first thing in the handler for its port, whatever 
+ *	interrupted (see Emergency stop in switch.h).
+ */
+#define _sw_pin(a,p) Motate::Pin<axis_##a##_##p##_pin_num>
+#define _sw_bit(a,p,port) (((AXIS_##a < AXES) && (_sw_pin(a,p)::portLetter == (port))) ? _sw_pin(a,p)::mask : 0)
+#define _sw_port_mask(port) (_sw_bit(X,min,port) | _sw_bit(X,max,port) | _sw_bit(Y,min,port) | \
+							 _sw_bit(Y,max,port) | _sw_bit(Z,min,port) | _sw_bit(Z,max,port) | \
+							 _sw_bit(A,min,port) | _sw_bit(A,max,port) | _sw_bit(B,min,port) | \
+							 _sw_bit(B,max,port) | _sw_bit(C,min,port) | _sw_bit(C,max,port) | \
+							 _sw_estop_bit(port))
+#define _sw_estop_bit(port) ((Motate::Pin<estop_pin_num>::portLetter == (port)) ? Motate::Pin<estop_pin_num>::mask : 0)
+
+static const uint32_t sw_port_mask_A = _sw_port_mask('A');
+static const uint32_t sw_port_mask_B = _sw_port_mask('B');
+static const uint32_t sw_port_mask_C = _sw_port_mask('C');
+static const uint32_t sw_port_mask_D = _sw_port_mask('D');
+static volatile uint8_t sw_sample_ports;	// ports to take a debounce sample from - bit per port
+
+#define _sw_read(a,p,P,port,pins,smp) if ((AXIS_##a < AXES) && (_sw_pin(a,p)::portLetter == (port))) { \
+		_switch_edge(&sw.s[AXIS_##a][SW_##P], ((pins) & _sw_pin(a,p)::mask) ? 1 : 0, smp);}
+#define _sw_read_port(port,pins,smp) { \
+		_sw_read(X,min,MIN,port,pins,smp) _sw_read(X,max,MAX,port,pins,smp) _sw_read(Y,min,MIN,port,pins,smp) \
+		_sw_read(Y,max,MAX,port,pins,smp) _sw_read(Z,min,MIN,port,pins,smp) _sw_read(Z,max,MAX,port,pins,smp) \
+		_sw_read(A,min,MIN,port,pins,smp) _sw_read(A,max,MAX,port,pins,smp) _sw_read(B,min,MIN,port,pins,smp) \
+		_sw_read(B,max,MAX,port,pins,smp) _sw_read(C,min,MIN,port,pins,smp) _sw_read(C,max,MAX,port,pins,smp) }
+
+#define _sw_port_enable(pio, irqn, mask) if (mask) { \
+		(pio)->PIO_AIMDR = (mask);			/* interrupt on both edges */ \
+		(pio)->PIO_IER = (mask); \
+		NVIC_EnableIRQ(irqn); \
+		NVIC_SetPendingIRQ(irqn);}			/* read the switches now */
+
+static void _switch_irq_enable()
+{
+	_sw_port_enable(PIOA, PIOA_IRQn, sw_port_mask_A);
+	_sw_port_enable(PIOB, PIOB_IRQn, sw_port_mask_B);
+	_sw_port_enable(PIOC, PIOC_IRQn, sw_port_mask_C);
+	_sw_port_enable(PIOD, PIOD_IRQn, sw_port_mask_D);
+}
+
+static void _switch_irq_disable()
+{
+	if (sw_port_mask_A) { NVIC_DisableIRQ(PIOA_IRQn);}
+	if (sw_port_mask_B) { NVIC_DisableIRQ(PIOB_IRQn);}
+	if (sw_port_mask_C) { NVIC_DisableIRQ(PIOC_IRQn);}
+	if (sw_port_mask_D) { NVIC_DisableIRQ(PIOD_IRQn);}
+}
+
+#define _sw_sample_bit(port) (1 << ((port) - 'A'))
+
+void switch_tick()
+{
+	switch_t *s = &sw.s[0][0];
+
+	for (uint8_t i=0; i < (SW_PAIRS * SW_POSITIONS); i++, s++) {
+		if ((s->mode != SW_MODE_DISABLED) && (s->steady < sw.debounce_samples)) {
+			sw_sample_ports = (_sw_sample_bit('A') | _sw_sample_bit('B') | _sw_sample_bit('C') | _sw_sample_bit('D'));
+			if (sw_port_mask_A) { NVIC_SetPendingIRQ(PIOA_IRQn);}
+			if (sw_port_mask_B) { NVIC_SetPendingIRQ(PIOB_IRQn);}
+			if (sw_port_mask_C) { NVIC_SetPendingIRQ(PIOC_IRQn);}
+			if (sw_port_mask_D) { NVIC_SetPendingIRQ(PIOD_IRQn);}
+			return;
+		}
+	}
+}
+
+static void _switch_edge(switch_t *s, uint8_t pin_value, uint8_t sample)
+{
+	if (s->mode == SW_MODE_DISABLED) return;
+	uint8_t pin_sense_corrected = (pin_value ^ (s->type ^ 1));	// correct for NO or NC mode
+	if (s->steady < sw.debounce_samples) {						// settling - count timed samples only
+		if (sample) { _switch_debounce(s, pin_sense_corrected);}
+		return;
+	}
+	if (s->state == pin_sense_corrected) return;				// no change
+	s->sample = pin_sense_corrected;							// act on the edge and start settling
+	s->steady = sw.edge_steady;
+	_switch_change(s, pin_sense_corrected);
 }
 
+#ifdef __MOTION_SYNC
+#define _sw_sync_edge(port,changed) \
+	if ((changed) & ((Motate::Pin<kinen_sync_pin_num>::portLetter == (port)) ? Motate::Pin<kinen_sync_pin_num>::mask : 0)) { \
+		st_sync_edge();}
+#else
+#define _sw_sync_edge(port,changed) (void)(changed);
+#endif
+
+#define _sw_pin_bit(pin,port) ((Motate::Pin<pin>::portLetter == (port)) ? Motate::Pin<pin>::mask : 0)
+
+#ifdef __ENCODERS
+#define _sw_encoder_edge(port,changed,pins) \
+	if (((changed) & (_sw_pin_bit(encoder_a_pin_num,port) | _sw_pin_bit(encoder_b_pin_num,port))) && \
+		(en.en[0].motor != 0)) { en_quadrature_edge(pins);}
+#else
+#define _sw_encoder_edge(port,changed,pins)
+#endif
+
+#define _sw_spindle_edge(port,changed) \
+	if (((changed) & _sw_pin_bit(spindle_index_pin_num,port)) && (spindle.pulses_per_rev != 0)) { sp_index_edge();}
+
+#define _sw_estop(pio, port) \
+	if (_sw_estop_bit(port) && (sw.estop_mode != ESTOP_DISABLED) && \
+		(_estop_stopped(((pio)->PIO_PDSR & _sw_estop_bit(port)) ? 1 : 0) == true)) { _estop_trip();}
+
+#define _sw_handler(pio, port) { \
+	_sw_estop(pio, port) \
+	uint32_t changed = (pio)->PIO_ISR;			/* read to clear the interrupt */ \
+	_sw_sync_edge(port, changed) \
+	_sw_spindle_edge(port, changed) \
+	uint32_t pins = (pio)->PIO_PDSR; \
+	_sw_encoder_edge(port, changed, pins) \
+	uint8_t sample = sw_sample_ports & _sw_sample_bit(port); \
+	sw_sample_ports &= ~_sw_sample_bit(port); \
+	_sw_read_port(port, pins, sample); }
+
+extern "C" {
+void PIOA_Handler(void) { _sw_handler(PIOA, 'A');}
+void PIOB_Handler(void) { _sw_handler(PIOB, 'B');}
+void PIOC_Handler(void) { _sw_handler(PIOC, 'C');}
+void PIOD_Handler(void) { _sw_handler(PIOD, 'D');}
+}
+
+#else // __SWITCH_INTERRUPTS
+
+static void _switch_irq_enable() {}
+static void _switch_irq_disable() {}
+void switch_tick() {}
+
 /*
- * poll_switches() - run a polling cycle on all switches
+ * poll_switches() - run a polling cycle on all switches - once per millisecond
  */
 stat_t poll_switches()
 {
+	static uint32_t sample_tick;
+	uint32_t now = SysTickTimer.getValue();
+	if ((sw.estop_mode != ESTOP_DISABLED) && (_estop_stopped(estop_pin.get()) == true)) { _estop_trip();}
+	if (now == sample_tick) { return (STAT_NOOP);}		// one debounce sample per tick
+	sample_tick = now;
+
 	read_switch(&sw.s[AXIS_X][SW_MIN], axis_X_min_pin);
 	read_switch(&sw.s[AXIS_X][SW_MAX], axis_X_max_pin);
 	read_switch(&sw.s[AXIS_Y][SW_MIN], axis_Y_min_pin);
 	read_switch(&sw.s[AXIS_Y][SW_MAX], axis_Y_max_pin);
 	read_switch(&sw.s[AXIS_Z][SW_MIN], axis_Z_min_pin);
 	read_switch(&sw.s[AXIS_Z][SW_MAX], axis_Z_max_pin);
+#if (AXES > AXIS_A)
 	read_switch(&sw.s[AXIS_A][SW_MIN], axis_A_min_pin);
 	read_switch(&sw.s[AXIS_A][SW_MAX], axis_A_max_pin);
+#endif
+#if (AXES > AXIS_B)
 	read_switch(&sw.s[AXIS_B][SW_MIN], axis_B_min_pin);
 	read_switch(&sw.s[AXIS_B][SW_MAX], axis_B_max_pin);
+#endif
+#if (AXES > AXIS_C)
 	read_switch(&sw.s[AXIS_C][SW_MIN], axis_C_min_pin);
 	read_switch(&sw.s[AXIS_C][SW_MAX], axis_C_max_pin);
+#endif
 	return (STAT_OK);
 }
 
+#endif // __SWITCH_INTERRUPTS
+
+/*
+ * _switch_filter_init() - set the PIO input filters on the switch pins - see Switch filter in switch.h
+ *
+ *	Every switch pin has its filter turned off first, so a switch that has just been
+ *	disabled loses it. Then the ones in use get the debounce filter if $swf is set.
+ *	The divider makes the debounce clock period 2*(DIV+1) slow clocks, and a level
+ *	shorter than half of that is dropped.
+ */
+#ifndef __SIM
+
+#define _sw_filter_bit(a,p,P,port,all) (((AXIS_##a < AXES) && \
+		(Motate::Pin<axis_##a##_##p##_pin_num>::portLetter == (port)) && \
+		((all) || (sw.s[AXIS_##a][SW_##P].mode != SW_MODE_DISABLED))) ? Motate::Pin<axis_##a##_##p##_pin_num>::mask : 0)
+#define _sw_filter_mask(port,all) ( \
+		_sw_filter_bit(X,min,MIN,port,all) | _sw_filter_bit(X,max,MAX,port,all) | _sw_filter_bit(Y,min,MIN,port,all) | \
+		_sw_filter_bit(Y,max,MAX,port,all) | _sw_filter_bit(Z,min,MIN,port,all) | _sw_filter_bit(Z,max,MAX,port,all) | \
+		_sw_filter_bit(A,min,MIN,port,all) | _sw_filter_bit(A,max,MAX,port,all) | _sw_filter_bit(B,min,MIN,port,all) | \
+		_sw_filter_bit(B,max,MAX,port,all) | _sw_filter_bit(C,min,MIN,port,all) | _sw_filter_bit(C,max,MAX,port,all))
+#define _sw_filter_port(pio, port, div) { \
+		(pio)->PIO_IFDR = _sw_filter_mask(port, true); \
+		if (sw.filter_ms != 0) { \
+			(pio)->PIO_SCDR = PIO_SCDR_DIV(div); \
+			(pio)->PIO_DIFSR = _sw_filter_mask(port, false); \
+			(pio)->PIO_IFER = _sw_filter_mask(port, false);}}
+
+static void _switch_filter_init()
+{
+	uint32_t div = ((uint32_t)sw.filter_ms * SW_FILTER_SLOW_CLOCK) / 1000;
+	div = (div > 0) ? div-1 : 0;
+	_sw_filter_port(PIOA, 'A', div);
+	_sw_filter_port(PIOB, 'B', div);
+	_sw_filter_port(PIOC, 'C', div);
+	_sw_filter_port(PIOD, 'D', div);
+	sw.edge_steady = (sw.filter_ms != 0) ? sw.debounce_samples : 0;
+}
+
+#else // __SIM
+
+static void _switch_filter_init() { sw.edge_steady = 0;}
+
+#endif // __SIM
+
 /*
  * read_switch() - read switch with NO/NC, debouncing and edge detection
  *
@@ -130,18 +362,19 @@ stat_t poll_switches()
  *	Assumes pin_value input = 1 means open, 0 is closed. Pin sense is adjusted to mean:
  *	  0 = open for both NO and NC switches
  *	  1 = closed for both NO and NC switches
+ *	Each call is a debounce sample, so it must be called at the sample rate.
  */
 uint8_t read_switch(switch_t *s, uint8_t pin_value)
 {
-	// instant return conditions: switch disabled or in a lockout period
+	// instant return condition: switch disabled
 	if (s->mode == SW_MODE_DISABLED) {
 		return (false); 
 	}
-	if (s->debounce_timeout > SysTickTimer.getValue()) {
-		return (false);
+	uint8_t pin_sense_corrected = (pin_value ^ (s->type ^ 1));	// correct for NO or NC mode
+	if (s->steady < sw.debounce_samples) {						// settling from the last edge
+		return (_switch_debounce(s, pin_sense_corrected));
 	}
 	// return if no change in state
-	uint8_t pin_sense_corrected = (pin_value ^ (s->type ^ 1));	// correct for NO or NC mode
   	if ( s->state == pin_sense_corrected) { 
 		s->edge = SW_NO_EDGE;
 		if (s->state == SW_OPEN) { 
@@ -151,29 +384,65 @@ uint8_t read_switch(switch_t *s, uint8_t pin_value)
 		}
 		return (false);
 	}
-	// the switch legitimately changed state - process edges
-	if ((s->state = pin_sense_corrected) == SW_OPEN) {
-			s->edge = SW_TRAILING;
-			s->on_trailing(s);
-		} else {
-			s->edge = SW_LEADING;
-			s->on_leading(s);
+	// the switch legitimately changed state - process edges and start settling
+	s->sample = pin_sense_corrected;
+	s->steady = sw.edge_steady;
+	_switch_change(s, pin_sense_corrected);
+	return (true);
+}
+
+/*
+ * _switch_debounce() - take a sample of a settling switch
+ *
+ *	Counts the samples the switch has read the same. Once it is steady for 
+ *	sw.debounce_samples it has settled, and if it settled in the other state the 
+ *	edge is acted on then. Returns true if it was.
+ */
+static uint8_t _switch_debounce(switch_t *s, uint8_t state)
+{
+	if (state != s->sample) {					// still bouncing
+		s->sample = state;
+		s->steady = 0;
 	}
-	s->debounce_timeout = (SysTickTimer.getValue() + s->debounce_ticks);
+	if (++s->steady < sw.debounce_samples) { return (false);}
+	if (s->state == s->sample) { return (false);}
+	_switch_change(s, s->sample);				// settled the other way
 	return (true);
 }
 
+/*
+ * _switch_change() - set the switch state and run the edge functions
+ */
+static void _switch_change(switch_t *s, uint8_t state)
+{
+#ifdef __AXIS_MOVE_ENGINE
+	s->edge_steps = st_axis_get_steps();		// where the homing latch was seen
+#endif
+	ev_record(EV_SWITCH, cm_get_linenum(RUNTIME), ((s - &sw.s[0][0]) << 1) | state);
+	if ((s->state = state) == SW_OPEN) {
+		s->edge = SW_TRAILING;
+		s->on_trailing(s);
+	} else {
+		s->edge = SW_LEADING;
+		s->on_leading(s);
+	}
+	controller_signal(CTL_EVENT_SWITCH);
+}
+
 static void _trigger_feedhold(switch_t *s) 
 {
+	if (cm.cycle_state == CYCLE_PROBE) { st_latch_position(ST_LATCH_PROBE);}	// first - the probe just touched
 	IndicatorLed.toggle();
-	cm_request_feedhold();
-/*
-	if (cm.cycle_state == CYCLE_HOMING) {		// regardless of switch type
-		cm.request_feedhold = true;
-	} else if (s->mode & SW_LIMIT_BIT) {		// set flag if it's a limit switch
-		cm.limit_tripped_flag = true;
+	if ((cm.cycle_state != CYCLE_HOMING) && (cm.cycle_state != CYCLE_PROBE) && (s->mode & SW_LIMIT_BIT)) {
+		st_halt();								// stop dead - no feedhold
+		sw.limit_tripped = true;
+		controller_set_ready(CTL_TASK_LIMIT);	// alarm from the controller
+		return;
 	}
-*/
+	cm_request_feedhold();
+#ifdef __AXIS_MOVE_ENGINE
+	if (cm.cycle_state == CYCLE_HOMING) { st_axis_stop();}	// homing moves may run on the axis engine
+#endif
 }
 
 static void _trigger_cycle_start(switch_t *s) 
@@ -182,13 +451,56 @@ static void _trigger_cycle_start(switch_t *s)
 	cm_request_cycle_start();
 }
 
+/*
+ * _estop_stopped() - true if the e-stop input at pin_value asks for a stop
+ * _estop_trip()	- cut the step, motor and spindle outputs. Runs in the switch interrupt
+ *
+ *	See Emergency stop in switch.h. Safe to run again on a bounce - the machine is
+ *	not in alarm until the controller gets to it.
+ */
+static uint8_t _estop_stopped(const uint8_t pin_value)
+{
+	return ((pin_value != 0) == (sw.estop_mode == ESTOP_NORMALLY_CLOSED));
+}
+
+static void _estop_trip()
+{
+	st_halt();									// stop dead
+	st_deenergize_motors();
+	spindle_enable_pin.clear();
+	pwm_halt();
+	sw.estop_tripped = true;
+	controller_set_ready(CTL_TASK_LIMIT);		// alarm from the controller
+}
+
 /*
  * switch_get_switch_mode()  - return switch mode setting
  * switch_get_limit_thrown() - return true if a limit was tripped
  * switch_get_switch_num()   - return switch number most recently thrown
  */
 
-uint8_t get_switch_mode(uint8_t sw_num) { return (0);}	// ++++
+uint8_t get_switch_mode(uint8_t sw_num) { return (GET_SWITCH(sw_num)->mode);}
+
+/*
+ * switch_set_callbacks()	- bind edge functions to a switch. NULL ignores that edge
+ * switch_reset_callbacks() - restore the feedhold and cycle start bindings on all switches
+ *
+ *	Cycles that need their own switch handling (e.g. parallel homing) bind it for 
+ *	the cycle and reset when done. The functions run in the switch interrupt.
+ */
+void switch_set_callbacks(uint8_t sw_num, sw_callback on_leading, sw_callback on_trailing)
+{
+	switch_t *s = GET_SWITCH(sw_num);
+	s->on_leading = (on_leading == NULL) ? _no_action : on_leading;
+	s->on_trailing = (on_trailing == NULL) ? _no_action : on_trailing;
+}
+
+void switch_reset_callbacks()
+{
+	for (uint8_t sw_num=0; sw_num < (SW_PAIRS * SW_POSITIONS); sw_num++) {
+		switch_set_callbacks(sw_num, _trigger_feedhold, _trigger_cycle_start);
+	}
+}
 
 /***********************************************************************************
  * CONFIGURATION AND INTERFACE FUNCTIONS
@@ -212,6 +524,32 @@ stat_t sw_set_sw(cmdObj_t *cmd)			// switch setting
 	return (STAT_OK);
 }
 
+stat_t sw_set_swd(cmdObj_t *cmd)		// switch debounce samples (global)
+{
+	if ((cmd->value < 1) || (cmd->value > SW_DEBOUNCE_SAMPLES_MAX)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	switch_init();
+	return (STAT_OK);
+}
+
+stat_t sw_set_swf(cmdObj_t *cmd)		// switch hardware filter time (global)
+{
+	if (cmd->value > SW_FILTER_MS_MAX) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(cmd);
+	switch_init();
+	return (STAT_OK);
+}
+
+stat_t sw_set_es(cmdObj_t *cmd)			// e-stop input mode
+{
+	if (cmd->value > ESTOP_NORMALLY_OPEN) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if ((cmd->value >= 1) && (xf.present == true)) { return (STAT_PIN_IN_USE);}	// see SPI0 in xio_file.h
+	set_ui8(cmd);
+	pwm_fault_init();
+	switch_init();						// also reads the input once
+	return (STAT_OK);
+}
+
 /***********************************************************************************
  * TEXT MODE SUPPORT
  * Functions to print variables from the cfgArray table
@@ -222,6 +560,15 @@ stat_t sw_set_sw(cmdObj_t *cmd)			// switch setting
 static const char fmt_st[] PROGMEM = "[st]  switch type%18d [0=NO,1=NC]\n";
 void sw_print_st(cmdObj_t *cmd) { text_print_flt(cmd, fmt_st);}
 
+static const char fmt_swd[] PROGMEM = "[swd] switch debounce samples%6d ms\n";
+void sw_print_swd(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_swd);}
+
+static const char fmt_swf[] PROGMEM = "[swf] switch hardware filter%7d ms [0=off]\n";
+void sw_print_swf(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_swf);}
+
+static const char fmt_es[] PROGMEM = "[es]  e-stop input%17d [0=disabled,1=NC,2=NO]\n";
+void sw_print_es(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_es);}
+
 //static const char fmt_ss[] PROGMEM = "Switch %s state:     %d\n";
 //void sw_print_ss(cmdObj_t *cmd) { fprintf(stderr, fmt_ss, cmd->token, (uint8_t)cmd->value);}
 
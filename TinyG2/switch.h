@@ -47,6 +47,9 @@
 // macros for finding the index into the switch table give the axis number
 #define MIN_SWITCH(axis) (axis*2)
 #define MAX_SWITCH(axis) (axis*2+1)
+#define GET_SWITCH(sw_num) (&sw.s[(sw_num)/SW_POSITIONS][(sw_num)%SW_POSITIONS])	// switch_t * from index
+#define GET_SWITCH_NUM(s) ((uint8_t)((s) - &sw.s[0][0]))								// index from switch_t *
+#define GET_SWITCH_AXIS(s) (GET_SWITCH_NUM(s) / SW_POSITIONS)							// axis from switch_t *
 
 // switch modes
 #define SW_HOMING_BIT 0x01
@@ -63,6 +66,12 @@ enum swType {
 };
 
 
+enum swEstopMode {					// emergency stop input ($es)
+	ESTOP_DISABLED = 0,
+	ESTOP_NORMALLY_CLOSED,			// stops when the input opens (reads high) - a broken wire stops too
+	ESTOP_NORMALLY_OPEN				// stops when the input closes to ground
+};
+
 enum swState {
 	SW_DISABLED = -1,
 	SW_OPEN = 0,					// also read as 'false'
@@ -83,12 +92,77 @@ enum swEdge {
 	SW_TRAILING,
 };
 
-#define SW_LOCKOUT_TICKS 100		// in milliseconds
-//#define SW_DEGLITCH_TICKS 30		// in milliseconds
+#define SW_DEBOUNCE_SAMPLES_MAX 100	// most debounce samples ($swd) - in milliseconds
+#define SW_FILTER_MS_MAX 100		// longest hardware filter ($swf) - in milliseconds
+#define SW_FILTER_SLOW_CLOCK 32768	// PIO debounce clock (Hz) - the slow clock, if it runs from the crystal
 
 #define SW_PAIRS AXES				// array sizing
 #define SW_POSITIONS 2				// array sizing
 
+/* Switch debounce
+ *	Switches are debounced with a counter sampled every millisecond from the SysTick 
+ *	interrupt (switch_tick()). A switch is settled once its pin has read the same for 
+ *	sw.debounce_samples samples in a row. An edge on a settled switch is acted on at 
+ *	once, and the switch then ignores its pin until it settles again. If it settles 
+ *	to the other state - the switch really did change back - that edge is acted on 
+ *	when it settles. Unlike a fixed lockout a genuine second transition is only held 
+ *	off until the bouncing stops, not for a fixed blind window.
+ *
+ * Switch filter
+ *	With $swf set the PIO debounce filters reject bounce in hardware instead. Each 
+ *	switch that isn't disabled ($xsn, $xsx) has its pin's input filter set to debounce 
+ *	from the slow clock, divided so that a level must hold for about $swf ms to get
+ *	through. The divider is one per PIO port, so the time is one for all switches. 
+ *	The edges that reach the pin change interrupts are then clean, and a switch takes
+ *	no debounce samples - it is settled again as soon as an edge is acted on, so the
+ *	next genuine edge is not held off either. The cost is that every edge arrives $swf
+ *	ms late, homing latches included, so keep it short: contact bounce is over in a
+ *	millisecond or two. 0 turns the filters off and debounces in software with $swd.
+ *	The simulator has no filters and always debounces in software.
+ *
+ * Switch interrupts
+ *	With __SWITCH_INTERRUPTS defined the switches are read from PIO change interrupts 
+ *	on both edges instead of being polled every controller pass, so the first edge on
+ *	a settled switch is acted on in the interrupt. Only switches that are settling are 
+ *	sampled from the SysTick. Limit switches stop the steppers from the interrupt 
+ *	(see st_halt()). Comment out the define to poll the switches, in which case they 
+ *	are polled at most once per millisecond.
+ */
+/* Emergency stop
+ *	An external fault line - an e-stop chain, a drive fault output - on estop_pin_num
+ *	(see hardware.h) stops the machine from the PIO change interrupt for its port, at
+ *	IRQ_PRIORITY_SWITCH. Only the DDA interrupt can hold it off, so the outputs are
+ *	cut within microseconds however busy the main loop is. The input is not debounced:
+ *	the first edge into the stop state does it, and a bounce only does it again.
+ *
+ *	  - the DDA and axis move timers stop where they are, with the step pins low
+ *		(see st_halt())
+ *	  - the motor enables are released (see st_deenergize_motors())
+ *	  - the spindle enable is released and the spindle PWM pin is taken from the PWM
+ *		controller and held low, whatever its off phase (see pwm_halt())
+ *
+ *	The controller then puts the machine in alarm with STAT_EMERGENCY_STOP, which is
+ *	cleared by a reset. If the input is still in the stop state the machine goes back
+ *	into alarm as soon as the switches are set up.
+ *
+ *	The default e-stop pin is SPI0 MISO, which the file device's flash also needs, so
+ *	only one of them is on - the e-stop if $es was set at startup. See SPI0 in
+ *	xio_file.h.
+ *
+ *	With ESTOP_PWM_FAULT the e-stop pin is also a PWM controller fault input, and the
+ *	PWM controller forces the spindle PWM low in hardware, in a clock or two, before 
+ *	the interrupt runs. The fault is latched in the PWM controller until reset.
+ *
+ *	  $es	0=disabled, 1=normally closed, 2=normally open. Normally closed is the 
+ *			safe choice - an open circuit stops the machine
+ *
+ *	Without __SWITCH_INTERRUPTS the input is polled with the switches, once per
+ *	millisecond at best, and only as often as the main loop gets there.
+ */
+#ifndef __SIM						// the simulator has no PIO interrupts - switches are polled
+#define __SWITCH_INTERRUPTS
+#endif
+
 /*
  * Switch control structures
  */
@@ -97,10 +171,11 @@ typedef struct swSwitch {			// one struct per switch
 	uint8_t mode;					// 0=disabled, 1=homing, 2=limit, 3=homing+limit
 	uint8_t state;					// set true if switch is closed
 	uint8_t edge;					// keeps a transient record of edges for immediate inquiry
-	uint16_t debounce_ticks;		// number of millisecond ticks for debounce lockout 
-	uint32_t debounce_timeout;		// time to expire current debounce lockout, or 0 if no lockout
-	void (*when_open)(struct swSwitch *s);		// callback to action function when sw is open - passes *s, returns void
-	void (*when_closed)(struct swSwitch *s);	// callback to action function when closed
+	uint8_t sample;					// pin sense of the last debounce sample
+	uint8_t steady;					// samples the pin has read the same - settled at sw.debounce_samples
+	int32_t edge_steps;				// axis move engine steps when the last edge was seen
+	void (*when_open)(struct swSwitch *s);		// callback each poll when sw is open (polled mode) - passes *s, returns void
+	void (*when_closed)(struct swSwitch *s);	// callback each poll when closed (polled mode)
 	void (*on_leading)(struct swSwitch *s);		// callback to action function for leading edge onset
 	void (*on_trailing)(struct swSwitch *s);	// callback to action function for trailing edge
 } switch_t;
@@ -108,6 +183,13 @@ typedef void (*sw_callback)(switch_t *s); // typedef for switch action callback
 
 typedef struct swSwitchArray {		// array of switches
 	uint8_t type;					// switch type for entire array
+	uint8_t debounce_samples;		// samples a switch must read the same to settle
+	uint8_t filter_ms;				// PIO debounce filter time - 0 for none ($swf)
+	uint8_t edge_steady;			// steady count an edge starts from - settled at once if filtered
+	volatile uint16_t settling;		// switches being debounced - bit per switch number
+	volatile uint8_t limit_tripped;	// set when a limit switch stops the machine
+	uint8_t estop_mode;				// swEstopMode ($es)
+	volatile uint8_t estop_tripped;	// set when the e-stop input stops the machine
 	switch_t s[SW_PAIRS][SW_POSITIONS];
 } switches_t;
 extern switches_t sw;
@@ -118,19 +200,31 @@ extern switches_t sw;
 void switch_init(void);
 uint8_t read_switch(switch_t *s, uint8_t pin_value);
 uint8_t get_switch_mode(uint8_t sw_num);
+void switch_set_callbacks(uint8_t sw_num, sw_callback on_leading, sw_callback on_trailing);
+void switch_reset_callbacks(void);
 
 stat_t poll_switches(void);
+void switch_tick(void);
 
 /*
  * Switch config accessors and text functions
  */
 stat_t sw_set_st(cmdObj_t *cmd);
 stat_t sw_set_sw(cmdObj_t *cmd);
+stat_t sw_set_swd(cmdObj_t *cmd);
+stat_t sw_set_swf(cmdObj_t *cmd);
+stat_t sw_set_es(cmdObj_t *cmd);
 
 #ifdef __TEXT_MODE
 	void sw_print_st(cmdObj_t *cmd);
+	void sw_print_swd(cmdObj_t *cmd);
+	void sw_print_swf(cmdObj_t *cmd);
+	void sw_print_es(cmdObj_t *cmd);
 #else
 	#define sw_print_st tx_print_stub
+	#define sw_print_swd tx_print_stub
+	#define sw_print_swf tx_print_stub
+	#define sw_print_es tx_print_stub
 #endif // __TEXT_MODE
 
 #endif // End of include guard: SWITCH_H_ONCE
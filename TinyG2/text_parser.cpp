@@ -32,6 +32,8 @@
 #include "text_parser.h"
 #include "json_parser.h"
 #include "report.h"
+#include "planner.h"
+#include "util.h"
 #include "xio.h"					// for ASCII char definitions
 
 #ifdef __cplusplus
@@ -124,7 +126,7 @@ static stat_t _text_parser_kernal(char_t *str, cmdObj_t *cmd)
 	if ((cmd->index = cmd_get_index((const char_t *)"", cmd->token)) == NO_MATCH) { // get index or fail it
 		return (STAT_UNRECOGNIZED_COMMAND);
 	}
-	strcpy_P(cmd->group, cfgArray[cmd->index].group);// capture the group string if there is one
+	strcpy_P(cmd->group, cfgTokens[cmd->index].group);// capture the group string if there is one
 
 	// see if you need to strip the token
 	if ((cmd_index_is_group(cmd->index)) && (cmd_group_is_prefixed(cmd->token))) {
@@ -140,6 +142,7 @@ static stat_t _text_parser_kernal(char_t *str, cmdObj_t *cmd)
  * text_response() - text mode responses
  */
 static const char prompt_ok[] PROGMEM = "tinyg [%s] ok> ";
+static const char prompt_ok_qr[] PROGMEM = "tinyg [%s] qr:%d ok> ";	// queue reports in footer mode
 static const char prompt_err[] PROGMEM = "tinyg [%s] err: %s: %s ";
 
 void text_response(const stat_t status, char_t *buf)
@@ -150,7 +153,11 @@ void text_response(const stat_t status, char_t *buf)
 	if (cm_get_units_mode(MODEL) != INCHES) { strcpy(units, "mm"); }
 
 	if ((status == STAT_OK) || (status == STAT_EAGAIN) || (status == STAT_NOOP)) {
-		fprintf_P(stderr, prompt_ok, units);
+		if (qr.queue_report_verbosity == QR_FOOTER) {
+			fprintf_P(stderr, prompt_ok_qr, units, mp_get_planner_buffers_available());
+		} else {
+			fprintf_P(stderr, prompt_ok, units);
+		}
 	} else {
 		fprintf_P(stderr, prompt_err, units, get_status_message(status), buf);
 	}
@@ -181,11 +188,13 @@ void text_print_list(stat_t status, uint8_t flags)
 
 void text_print_inline_pairs(cmdObj_t *cmd)
 {
+	char_t number[NUMBER_STRING_LEN];
+
 	for (uint8_t i=0; i<CMD_BODY_LEN-1; i++) {
 		switch (cmd->objtype) {
 			case TYPE_PARENT: 	{ if ((cmd = cmd->nx) == NULL) return; continue;} // NULL means parent with no child
-			case TYPE_FLOAT:	{ fprintf_P(stderr,PSTR("%s:%1.3f"), cmd->token, cmd->value); break;}
-			case TYPE_INTEGER:	{ fprintf_P(stderr,PSTR("%s:%1.0f"), cmd->token, cmd->value); break;}
+			case TYPE_FLOAT:	{ fntoa(number, cmd->value, 3); fprintf_P(stderr,PSTR("%s:%s"), cmd->token, number); break;}
+			case TYPE_INTEGER:	{ fntoa(number, cmd->value, 0); fprintf_P(stderr,PSTR("%s:%s"), cmd->token, number); break;}
 			case TYPE_STRING:	{ fprintf_P(stderr,PSTR("%s:%s"), cmd->token, *cmd->stringp); break;}
 			case TYPE_EMPTY:	{ fprintf_P(stderr,PSTR("\n")); return; }
 		}
@@ -196,11 +205,13 @@ void text_print_inline_pairs(cmdObj_t *cmd)
 
 void text_print_inline_values(cmdObj_t *cmd)
 {
+	char_t number[NUMBER_STRING_LEN];
+
 	for (uint8_t i=0; i<CMD_BODY_LEN-1; i++) {
 		switch (cmd->objtype) {
 			case TYPE_PARENT: 	{ if ((cmd = cmd->nx) == NULL) return; continue;} // NULL means parent with no child
-			case TYPE_FLOAT:	{ fprintf_P(stderr,PSTR("%1.3f"), cmd->value); break;}
-			case TYPE_INTEGER:	{ fprintf_P(stderr,PSTR("%1.0f"), cmd->value); break;}
+			case TYPE_FLOAT:	{ fntoa(number, cmd->value, 3); fprintf_P(stderr,PSTR("%s"), number); break;}
+			case TYPE_INTEGER:	{ fntoa(number, cmd->value, 0); fprintf_P(stderr,PSTR("%s"), number); break;}
 			case TYPE_STRING:	{ fprintf_P(stderr,PSTR("%s"), *cmd->stringp); break;}
 			case TYPE_EMPTY:	{ fprintf_P(stderr,PSTR("\n")); return; }
 		}
@@ -33,6 +33,7 @@
 #include <string.h>
 #include <math.h>
 
+//#define MOTATE_SAM_BITBAND				// single pin writes and reads through the bit-band alias - see SamPins.h
 #include "MotatePins.h"
 
 #define TINYG_FIRMWARE_BUILD   		020.20	// Sync-up point with TinyG build 394.25
@@ -46,6 +47,7 @@
 #define __TEXT_MODE							// comment out to disable text mode support (saves ~9Kb)
 #define __HELP_SCREENS						// comment out to disable help screens 		(saves ~3.5Kb)
 #define __CANNED_TESTS 						// comment out to remove canned tests 		(saves ~12Kb)
+//#define __RAM_ISR							// run the step ISRs and segment generation from SRAM - see RAMFUNC
 
 /****** DEVELOPMENT SETTINGS ******/
 
@@ -54,6 +56,7 @@
 //#define __SUPPRESS_STARTUP_MESSAGES 		// what it says
 //#define __ENABLE_PROBING					// comment out to take out experimental probing code
 //#define __UNIT_TESTS						// master enable for unit tests; USAGE: uncomment test in .h file
+//#define __LOOP_PROFILE					// time the controller tasks - see controller.h
 
 //#ifndef WEAK
 //#define WEAK  __attribute__ ((weak))
@@ -78,9 +81,9 @@ typedef char char_t;			// ARM/C++ version uses uint8_t as char_t
 
 																	// gets rely on cmd->index having been set
 #define GET_TABLE_WORD(a)  pgm_read_word(&cfgArray[cmd->index].a)	// get word value from cfgArray
-#define GET_TABLE_BYTE(a)  pgm_read_byte(&cfgArray[cmd->index].a)	// get byte value from cfgArray
+#define GET_TABLE_BYTE(a)  pgm_read_byte(&cfgTokens[cmd->index].a)	// get flags or precision from cfgTokens
 #define GET_TABLE_FLOAT(a) pgm_read_float(&cfgArray[cmd->index].a)	// get float value from cfgArray
-#define GET_TOKEN_BYTE(a)  (char_t)pgm_read_byte(&cfgArray[i].a)	// get token byte value from cfgArray
+#define GET_TOKEN_BYTE(a)  (char_t)pgm_read_byte(&cfgTokens[i].a)	// get token byte value from cfgTokens
 
 // get text from an array of strings in PGM and convert to RAM string
 #define GET_TEXT_ITEM(b,a) strcpy_P(shared_buf,(const char *)pgm_read_word(&b[a])) 
@@ -106,23 +109,52 @@ typedef char char_t;			// ARM/C++ version uses uint8_t as char_t
 #define PROGMEM					// ignore PROGMEM declarations in ARM/GCC++
 #define PSTR (const char *)		// AVR macro is: PSTR(s) ((const PROGMEM char *)(s))
 
+/* RAMFUNC puts a function in the .ramfunc section, which the linker script copies to SRAM
+ * at startup, so it runs without flash wait states. It marks the step ISRs and the
+ * segment generation they call (mp_exec_move() down to st_prep_line()) when __RAM_ISR
+ * is defined. -mlong-calls lets them call back into flash. Each byte of code moved
+ * costs a byte of SRAM - the link prints the budget. Flash callees (libm, printf'ing 
+ * error paths) still run with wait states. Compare $isr with and without it.
+ */
+#if defined(__RAM_ISR) && !defined(__SIM)
+#define RAMFUNC __attribute__ ((section (".ramfunc")))
+#else
+#define RAMFUNC
+#endif
+
+/* SRAM_ISR and SRAM_DMA pick the SRAM bank of a zeroed static. SRAM0 and SRAM1 are 
+ * separate slaves on the bus matrix, so a DMA master only holds up the CPU when both
+ * go to the same bank. SRAM_ISR marks what the step ISRs work on (st_run, st_prep, mr), 
+ * which goes first in .bss, in SRAM0 with the other statics and the stack. SRAM_DMA 
+ * marks the USART PDC buffer and the planner pool, which go in SRAM1 (.sram1 in 
+ * gcc_flash.ld). The startup code zeroes .sram1 before the constructors run. The link
+ * prints what each bank holds - the pool has to fit in SRAM1's 32K. 
+ */
+#ifndef __SIM
+#define SRAM_ISR __attribute__ ((section (".bss.sram0")))
+#define SRAM_DMA __attribute__ ((section (".bss.sram1")))
+#else
+#define SRAM_ISR
+#define SRAM_DMA
+#endif
+
 typedef uint8_t char_t;			// In the ARM/GCC++ version char_t is typedef'd to uint8_t 
 								// because in C++ uint8_t and char are distinct types and 
 								// we want chars to behave as uint8's
 
 													// gets rely on cmd->index having been set
 #define GET_TABLE_WORD(a)  cfgArray[cmd->index].a	// get word value from cfgArray
-#define GET_TABLE_BYTE(a)  cfgArray[cmd->index].a	// get byte value from cfgArray
+#define GET_TABLE_BYTE(a)  cfgTokens[cmd->index].a	// get flags or precision from cfgTokens
 #define GET_TABLE_FLOAT(a) cfgArray[cmd->index].a	// get byte value from cfgArray
-#define GET_TOKEN_BYTE(a)  (char_t)cfgArray[i].a	// get token byte value from cfgArray
+#define GET_TOKEN_BYTE(a)  (char_t)cfgTokens[i].a	// get token byte value from cfgTokens
 
 #define GET_TEXT_ITEM(b,a) b[a]						// get text from an array of strings in flash
 #define GET_UNITS(a) msg_units[cm_get_units_mode(a)]
 
 // IO settings
-#define DEV_STDIN 0				// STDIO defaults - stdio is not yet used in the ARM version
-#define DEV_STDOUT 0
-#define DEV_STDERR 0
+#define DEV_STDIN XIO_CONSOLE_DEVICE	// STDIO defaults - see xio.h
+#define DEV_STDOUT XIO_CONSOLE_DEVICE
+#define DEV_STDERR XIO_CONSOLE_DEVICE
 
 /* String compatibility
  *
@@ -167,8 +199,30 @@ typedef uint16_t magic_t;		// magic number size
 /***** Axes, motors & PWM channels used by the application *****/
 // Axes, motors & PWM channels must be defines (not enums) so #ifdef <value> can be used
 
+/* AXES is the number of axes the build carries, 3 (XYZ) to 6 (XYZABC), taken in order.
+ * A router built with -DAXES=3 drops A, B and C from the planner and runtime math, the
+ * per-axis arrays in the planner buffers and Gcode state, the config table and the 
+ * Gcode words - an A word is then an unrecognized command. Like PLANNER_BUFFER_POOL_SIZE
+ * it must be set on the compiler command line (see platform/sim.mk), not in a settings 
+ * file, so that every file sees the same value.
+ */
+#ifndef AXES
 #define AXES	6				// number of axes supported in this version
-#define MOTORS	6				// number of motors on the board
+#endif
+#if ((AXES < 3) || (AXES > 6))
+#error AXES must be 3 to 6
+#endif
+
+/* EXPANSION_MOTORS adds motors 7 and 8 on the step expansion shift register (see Step
+ * expansion in stepper.h). Like AXES it must be set on the compiler command line.
+ */
+#ifndef EXPANSION_MOTORS
+#define EXPANSION_MOTORS 0		// motors on the step expansion register, 0 to 2
+#endif
+#if ((EXPANSION_MOTORS < 0) || (EXPANSION_MOTORS > 2))
+#error EXPANSION_MOTORS must be 0 to 2
+#endif
+#define MOTORS	(6 + EXPANSION_MOTORS)	// number of motors: the board's 6 and the expansion motors
 #define COORDS	6				// number of supported coordinate systems (1-6)
 #define PWMS	2				// number of supported PWM channels
 
@@ -190,6 +244,8 @@ typedef uint16_t magic_t;		// magic number size
 #define MOTOR_4	3
 #define MOTOR_5 4
 #define MOTOR_6 5
+#define MOTOR_7 6				// expansion motors
+#define MOTOR_8 7
 
 #define PWM_1	0
 #define PWM_2	1
@@ -275,13 +331,13 @@ char *get_status_message(stat_t status);
 #define	STAT_JSON_TOO_LONG 50				// JSON output exceeds buffer size
 #define	STAT_NO_BUFFER_SPACE 51				// Buffer pool is full and cannot perform this operation
 #define	STAT_CONFIG_NOT_TAKEN 52			// configuration value not taken while in machining cycle
-#define	STAT_ERROR_53 53
-#define	STAT_ERROR_54 54
-#define	STAT_ERROR_55 55
-#define	STAT_ERROR_56 56
-#define	STAT_ERROR_57 57
-#define	STAT_ERROR_58 58
-#define	STAT_ERROR_59 59
+#define	STAT_CHECKSUM_MISMATCH 53			// input checksum does not match its contents
+#define	STAT_BINARY_FRAME_ERROR 54			// binary Gcode frame is not well formed
+#define	STAT_SUBROUTINE_UNDEFINED 55		// O-word call to a subroutine that is not defined
+#define	STAT_EXPRESSION_ERROR 56			// Gcode expression is not well formed or is too long
+#define	STAT_EXPRESSION_VALUE_ERROR 57		// expression can't be evaluated - divide by zero, bad parameter number...
+#define	STAT_LINE_NUMBER_ERROR 58			// checked line is not the next line number (see controller.h)
+#define	STAT_LINE_DISCARDED 59				// line dropped while a resend is awaited
 
 // Gcode and machining errors
 #define	STAT_MINIMUM_LENGTH_MOVE_ERROR 60	// move is less than minimum length
@@ -298,13 +354,13 @@ char *get_status_message(stat_t status);
 #define	STAT_SOFT_LIMIT_EXCEEDED 71			// soft limit error
 #define	STAT_COMMAND_NOT_ACCEPTED 72		// command cannot be accepted at this time
 #define	STAT_PROBING_CYCLE_FAILED 73		// probing cycle did not complete
-#define	STAT_ERROR_74 74
-#define	STAT_ERROR_75 75
-#define	STAT_ERROR_76 76
-#define	STAT_ERROR_77 77
-#define	STAT_ERROR_78 78
-#define	STAT_ERROR_79 79
-#define	STAT_ERROR_80 80
+#define	STAT_LIMIT_SWITCH_HIT 74			// limit switch was hit - machine is stopped
+#define	STAT_ENCODER_FOLLOWING_ERROR 75	// encoder and motor disagree - steps were lost
+#define	STAT_SPINDLE_SYNC_ERROR 76			// synchronized move with no tach or spindle speed
+#define	STAT_SPLINE_SPECIFICATION_ERROR 77	// spline without its control points, or not in G17
+#define	STAT_EMERGENCY_STOP 78				// emergency stop input - machine is stopped
+#define	STAT_PIN_IN_USE 79					// the pins are taken by another feature that is on
+#define	STAT_ENCODER_EDGES_MISSED 80		// the encoder jumped two states - its count is off
 #define	STAT_ERROR_81 81
 #define	STAT_ERROR_82 82
 #define	STAT_ERROR_83 83
@@ -335,5 +391,6 @@ char *get_status_message(stat_t status);
 #define	STAT_PLANNER_ASSERTION_FAILURE 106
 #define	STAT_STEPPER_ASSERTION_FAILURE 107
 #define	STAT_XIO_ASSERTION_FAILURE 108
+#define	STAT_CONFIG_ASSERTION_FAILURE 109	// config checksum changed without a config write
 
 #endif // End of include guard: TINYG2_H_ONCE
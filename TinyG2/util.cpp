@@ -31,7 +31,9 @@
  */
 
 #include "tinyg2.h"
+#include "config.h"
 #include "util.h"
+#include "xio.h"					// for ASCII char definitions
 
 #ifdef __cplusplus
 extern "C"{
@@ -59,104 +61,49 @@ void copy_axis_vector(float dst[], const float src[])
 	memcpy(dst, src, sizeof(float)*AXES);
 }
 
+// Loops over AXES are fully unrolled by the compiler, for only the axes built in
+
 uint8_t vector_equal(const float a[], const float b[])
 {
-	if ((fp_EQ(a[AXIS_X], b[AXIS_X])) &&
-		(fp_EQ(a[AXIS_Y], b[AXIS_Y])) &&
-		(fp_EQ(a[AXIS_Z], b[AXIS_Z])) &&
-		(fp_EQ(a[AXIS_A], b[AXIS_A])) &&
-		(fp_EQ(a[AXIS_B], b[AXIS_B])) &&
-		(fp_EQ(a[AXIS_C], b[AXIS_C]))) {
-		return (true);
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (fp_EQ(a[axis], b[axis]) == false) { return (false);}
 	}
-	return (false);
+	return (true);
 }
 
 float get_axis_vector_length(const float a[], const float b[]) 
 {
-	return (sqrt(square(a[AXIS_X] - b[AXIS_X]) +
-				 square(a[AXIS_Y] - b[AXIS_Y]) +
-				 square(a[AXIS_Z] - b[AXIS_Z]) +
-				 square(a[AXIS_A] - b[AXIS_A]) +
-				 square(a[AXIS_B] - b[AXIS_B]) +
-				 square(a[AXIS_C] - b[AXIS_C])));
+	float sum = 0;
+	for (uint8_t axis=0; axis<AXES; axis++) { sum += square(a[axis] - b[axis]);}
+	return (sqrt(sum));
 }
 
-float *set_vector(float x, float y, float z, float a, float b, float c)
+float *set_vector(float x, float y, float z, float a, float b, float c)	// ABC beyond AXES are dropped
 {
 	vector[AXIS_X] = x;
 	vector[AXIS_Y] = y;
 	vector[AXIS_Z] = z;
+#if (AXES > AXIS_A)
 	vector[AXIS_A] = a;
+#endif
+#if (AXES > AXIS_B)
 	vector[AXIS_B] = b;
+#endif
+#if (AXES > AXIS_C)
 	vector[AXIS_C] = c;
+#endif
 	return (vector);
 }
 
 float *set_vector_by_axis(float value, uint8_t axis)
 {
 	clear_vector(vector);
-	switch (axis) {
-		case (AXIS_X): vector[AXIS_X] = value; break;
-		case (AXIS_Y): vector[AXIS_Y] = value; break;
-		case (AXIS_Z): vector[AXIS_Z] = value; break;
-		case (AXIS_A): vector[AXIS_A] = value; break;
-		case (AXIS_B): vector[AXIS_B] = value; break;
-		case (AXIS_C): vector[AXIS_C] = value;
-	}
+	if (axis < AXES) { vector[axis] = value;}
 	return (vector);
 }
 
 /**** Math and other general purpose functions ****/
-
-/* Slightly faster (*) multi-value min and max functions
- * 	min3() - return minimum of 3 numbers
- * 	min4() - return minimum of 4 numbers
- * 	max3() - return maximum of 3 numbers
- * 	max4() - return maximum of 4 numbers
- *
- * Implementation tip: Order the min and max values from most to least likely in the calling args
- *
- * (*) Macro min4 is about 20uSec, inline function version is closer to 10 uSec (Xmega 32 MHz)
- * 	#define min3(a,b,c) (min(min(a,b),c))
- *	#define min4(a,b,c,d) (min(min(a,b),min(c,d)))
- *	#define max3(a,b,c) (max(max(a,b),c))
- *	#define max4(a,b,c,d) (max(max(a,b),max(c,d)))
- */
-
-float min3(float x1, float x2, float x3)
-{
-	float min = x1;
-	if (x2 < min) { min = x2;} 
-	if (x3 < min) { return (x3);} 
-	return (min);
-}
-
-float min4(float x1, float x2, float x3, float x4)
-{
-	float min = x1;
-	if (x2 < min) { min = x2;} 
-	if (x3 < min) { min = x3;} 
-	if (x4 < min) { return (x4);}
-	return (min);
-}
-
-float max3(float x1, float x2, float x3)
-{
-	float max = x1;
-	if (x2 > max) { max = x2;} 
-	if (x3 > max) { return (x3);} 
-	return (max);
-}
-
-float max4(float x1, float x2, float x3, float x4)
-{
-	float max = x1;
-	if (x2 > max) { max = x2;} 
-	if (x3 > max) { max = x3;} 
-	if (x4 > max) { return (x4);}
-	return (max);
-}
+// min3(), min4(), max3() and max4() are inline in fastmath.h
 
 /**** String utilities ****
  * strcpy_U() 	   - strcpy workalike to get around initial NUL for blank string - possibly wrong
@@ -195,6 +142,74 @@ char_t *escape_string(char_t *dst, char_t *src)
 	return (start_dst);
 }
 
+/*
+ * inttoa() - write a signed integer as decimal text
+ * fntoa()  - write a float as decimal text with a fixed number of fraction digits
+ *
+ *	Both write a NUL terminated string to str and return the number of characters 
+ *	written, not counting the NUL. They replace sprintf("%1.0f") and sprintf("%0.Nf")
+ *	on the serialization paths - printf-family float formatting is slow on a part
+ *	without an FPU. 
+ *
+ *	fntoa() rounds half away from zero and does not print a sign for a value that 
+ *	rounds to zero. Precision is limited to FNTOA_MAX_PRECISION digits. Magnitudes 
+ *	too large for a uint32 are scaled down and padded with zeros - which is as many
+ *	significant digits as a float carries anyway. NaN and inf are not handled; the
+ *	caller is expected to screen them out.
+ */
+#define FNTOA_MAX_PRECISION 6
+
+static const uint32_t _fntoa_pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+static uint8_t _utoa(char_t *str, uint32_t n)
+{
+	char_t digits[10];
+	uint8_t i = 0, len = 0;
+
+	do { digits[i++] = '0' + (n % 10); n /= 10; } while (n != 0);
+	while (i != 0) { str[len++] = digits[--i];}
+	str[len] = NUL;
+	return (len);
+}
+
+uint8_t inttoa(char_t *str, int32_t n)
+{
+	if (n >= 0) { return (_utoa(str, (uint32_t)n));}
+	*str = '-';
+	return (_utoa(str+1, (uint32_t)(-(n+1)) + 1) + 1);	// -(n+1) avoids overflow on INT32_MIN
+}
+
+uint8_t fntoa(char_t *str, float n, uint8_t precision)
+{
+	char_t *wr = str;
+	uint8_t zeros = 0;							// zeros padded onto very large values
+
+	if (precision > FNTOA_MAX_PRECISION) { precision = FNTOA_MAX_PRECISION;}
+	uint32_t scale = _fntoa_pow10[precision];
+
+	float f = fabs(n);
+	while (f >= (float)MAX_ULONG) { f /= 10; zeros++;}
+	if (zeros != 0) { precision = 0;}
+
+	uint32_t whole = (uint32_t)f;
+	uint32_t fraction = (uint32_t)((f - whole) * scale + 0.5);
+	if (fraction >= scale) { whole++; fraction -= scale;}	// rounding carried into the whole part
+
+	if ((n < 0) && ((whole != 0) || (fraction != 0))) { *wr++ = '-';}
+	wr += _utoa(wr, whole);
+	while (zeros-- != 0) { *wr++ = '0';}
+	if (precision != 0) {
+		*wr++ = '.';
+		for (uint8_t i = precision; i != 0; i--) {
+			wr[i-1] = '0' + (fraction % 10);
+			fraction /= 10;
+		}
+		wr += precision;
+	}
+	*wr = NUL;
+	return (wr - str);
+}
+
 /* 
  * compute_checksum() - calculate the checksum for a string
  * 
@@ -202,12 +217,23 @@ char_t *escape_string(char_t *dst, char_t *src)
  *
  * 	This is based on the the Java hashCode function. 
  *	See http://en.wikipedia.org/wiki/Java_hashCode()
+ *
+ *	checksum_accumulate() and checksum_finish() compute the same checksum over a 
+ *	string that is produced in pieces. Start with a hash of 0, accumulate each piece
+ *	(length 0 means the whole piece) and finish to get the checksum.
  */
 #define HASHMASK 9999
 
 uint16_t compute_checksum(char_t const *string, const uint16_t length) 
 {
-	uint32_t h = 0;
+	return (checksum_finish(checksum_accumulate(0, string, length)));
+}
+
+uint16_t checksum_finish(uint32_t hash) { return (hash % HASHMASK);}
+
+uint32_t checksum_accumulate(uint32_t hash, char_t const *string, const uint16_t length) 
+{
+	uint32_t h = hash;
 	uint16_t len = strlen(string);
 
 	if (length != 0) {
@@ -216,7 +242,40 @@ uint16_t compute_checksum(char_t const *string, const uint16_t length)
     for (uint16_t i=0; i<len; i++) {
 		h = 31 * h + string[i];
     }
-    return (h % HASHMASK);
+    return (h);
+}
+
+/*
+ * base64_value()  - value of a base64 character (RFC 4648 alphabet), or -1 if it isn't one
+ * base64_encode() - encode length bytes without '=' padding. Returns the characters written
+ *
+ *	dst must have room for (length * 4 + 2) / 3 characters and a NUL.
+ */
+int8_t base64_value(char_t c)
+{
+	if ((c >= 'A') && (c <= 'Z')) return (c - 'A');
+	if ((c >= 'a') && (c <= 'z')) return (c - 'a' + 26);
+	if ((c >= '0') && (c <= '9')) return (c - '0' + 52);
+	if (c == '+') return (62);
+	if (c == '/') return (63);
+	return (-1);
+}
+
+static const char_t _base64_char[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+uint16_t base64_encode(char_t *dst, const uint8_t *src, const uint16_t length)
+{
+	char_t *str = dst;
+	uint32_t bits = 0;
+	uint8_t nbits = 0;
+
+	for (uint16_t i=0; i<length; i++) {
+		bits = (bits << 8) | src[i];
+		for (nbits += 8; nbits >= 6; nbits -= 6) { *str++ = _base64_char[(bits >> (nbits-6)) & 0x3F];}
+	}
+	if (nbits != 0) { *str++ = _base64_char[(bits << (6-nbits)) & 0x3F];}
+	*str = NUL;
+	return (str - dst);
 }
 
 /*
@@ -72,10 +72,7 @@ void copy_axis_vector(float dst[], const float src[]);
 
 //*** math utilities ***
 
-float min3(float x1, float x2, float x3);
-float min4(float x1, float x2, float x3, float x4);
-float max3(float x1, float x2, float x3);
-float max4(float x1, float x2, float x3, float x4);
+#include "fastmath.h"			// min3(), max4() etc. and the fast_ kernels - all inline
 //float std_dev(float a[], uint8_t n, float *mean);
 
 //*** string utilities ***
@@ -86,7 +83,14 @@ float max4(float x1, float x2, float x3, float x4);
 
 uint8_t isnumber(char_t c);
 char_t *escape_string(char_t *dst, char_t *src);
+#define NUMBER_STRING_LEN 48		// longest possible fntoa() output, including the NUL
+uint8_t inttoa(char_t *str, int32_t n);
+uint8_t fntoa(char_t *str, float n, uint8_t precision);
 uint16_t compute_checksum(char_t const *string, const uint16_t length);
+uint32_t checksum_accumulate(uint32_t hash, char_t const *string, const uint16_t length);
+uint16_t checksum_finish(uint32_t hash);
+int8_t base64_value(char_t c);
+uint16_t base64_encode(char_t *dst, const uint8_t *src, const uint16_t length);
 
 //*** other utilities ***
 
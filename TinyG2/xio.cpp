@@ -27,14 +27,209 @@
  */
 //#include "Arduino.h"
 #include "tinyg2.h"
+#include "config.h"
+#include "text_parser.h"
 #include "xio.h"
+#include "xio_file.h"
+#include "xio_lz.h"
+#include "canonical_machine.h"
+#include "planner.h"
+#include "hardware.h"
+#include "switch.h"
+#include "stepper.h"
+#include "event_log.h"
+#include "can.h"
+#include "MotateTimers.h"
+
+xioSingleton_t xio;
+
+/*
+ * Receive rings and realtime characters
+ *
+ *	Input is taken from the devices by _xio_rx_fill(), which runs from the SysTick 
+ *	interrupt, into an rx ring per input device. read_char() and read_line() hand it
+ *	out from the console's ring. 
+ *
+ *	USB input is read straight out of the endpoint bank (SerialUSB.borrowRead()) into 
+ *	the ring, so each character is copied once. Reading the endpoint byte by byte 
+ *	checks the FIFO control and bank state for every character; borrowing the bank 
+ *	does that once per packet. Only up to the free space in rx is taken, so USB flow 
+ *	control still holds the host off when the firmware falls behind. Compressed input
+ *	(see xio_lz.h) is decoded on the way, one character at a time for as long as the
+ *	ring has room.
+ *
+ *	USART input is received by the PDC into a circular buffer (see _usart_init())
+ *	and moved into the ring from wherever the PDC has got to. Polling the PDC 
+ *	position each millisecond stands in for idle line detection - a line is picked
+ *	up within a millisecond of its last character whether or not the buffer filled.
+ *
+ *	CAN input arrives in text frames, which the CAN interrupt holds in a ring of its
+ *	own (see can.h). A frame is only taken once rx has room for all of it.
+ *
+ *	The interrupt only writes head, the foreground only writes tail.
+ *
+ *	Realtime characters are acted on as they are taken from either device and never
+ *	reach a ring, so a feedhold doesn't wait behind the lines queued ahead of it:
+ *
+ *	  !		feedhold
+ *	  ~		cycle start
+ *	  ^x	hard reset
+ *	  ^r	jog frame - takes the bytes after it (see Jogging in canonical_machine.cpp)
+ *
+ *	They take effect within a millisecond of arriving. Anything a USB host sent 
+ *	after a full ring and full endpoint banks still waits its turn in the host - 
+ *	a bulk pipe can't be overtaken. Other input from the device that is not the 
+ *	console is dropped.
+ */
+struct xioRxRing {
+	volatile uint16_t head;					// next slot to fill - fill interrupt only
+	volatile uint16_t tail;					// next character to hand out - foreground only
+	uint8_t buf[XIO_RX_BUFFER_LEN];
+};
+static xioRxRing rx[XIO_DEV_INPUTS];
+
+static uint8_t usart_dma[XIO_USART_DMA_LEN] SRAM_DMA;	// PDC receive buffer
+static uint16_t usart_dma_rd;					// next character to take from it
+static cmJogFrame_t jog_frame[XIO_DEV_INPUTS];	// jog frames being read in
+
+static uint8_t _xio_realtime_char(const uint8_t dev, uint8_t c)	// returns true if c was a realtime character
+{
+	if (cm_jog_frame(&jog_frame[dev], c) == true) { return (true);}
+	switch (c) {
+		case '!': { cm_request_feedhold(); can_sync_event(CAN_SYNC_HOLD); return (true);}
+		case '~': { cm_request_cycle_start(); can_sync_event(CAN_SYNC_START); return (true);}
+		case CAN: { hw_request_hard_reset(); return (true);}
+	}
+	return (false);
+}
+
+static void _usb_rx_decode()
+{
+	xioRxRing *r = &rx[XIO_DEV_USB];
+	const volatile uint8_t *bank;
+	int16_t count = 0;						// code in the borrowed bank...
+	int16_t used = 0;						// ...and taken from it
+	uint16_t head = r->head;
+
+	while (((r->tail - head - 1) & (XIO_RX_BUFFER_LEN-1)) != 0) {	// room in the ring
+		int c = xio_lz_get();
+		if (c == _FDEV_ERR) {				// more code needed
+			if (used == count) {
+				if (count > 0) { SerialUSB.releaseRead(count);}
+				used = 0;
+				if ((count = SerialUSB.borrowRead(&bank)) <= 0) { count = 0; break;}
+			}
+			xio_lz_put(bank[used++]);
+			continue;
+		}
+		if (_xio_realtime_char(XIO_DEV_USB, c) == true) { continue;}
+		if (xio.console != XIO_DEV_USB) { continue;}	// not the console - realtime characters only
+		r->buf[head] = c;
+		head = (head + 1) & (XIO_RX_BUFFER_LEN-1);
+	}
+	r->head = head;
+	if (used > 0) { SerialUSB.releaseRead(used);}
+}
+
+static void _usb_rx_fill()
+{
+	xioRxRing *r = &rx[XIO_DEV_USB];
+	const volatile uint8_t *bank;
+
+	if (xz.window != 0) { _usb_rx_decode(); return;}
+	while (true) {
+		uint16_t head = r->head;
+		uint16_t space = (XIO_RX_BUFFER_LEN-1) - ((head - r->tail) & (XIO_RX_BUFFER_LEN-1));
+		if (space == 0) { return;}
+		int16_t count = SerialUSB.borrowRead(&bank);
+		if (count <= 0) { return;}
+		if (count > space) { count = space;}
+
+		for (int16_t i=0; i<count; i++) {	// straight from the bank - realtime characters never land
+			uint8_t c = bank[i];
+			if (_xio_realtime_char(XIO_DEV_USB, c) == true) { continue;}
+			if (xio.console != XIO_DEV_USB) { continue;}	// not the console - realtime characters only
+			r->buf[head] = c;
+			head = (head + 1) & (XIO_RX_BUFFER_LEN-1);
+		}
+		r->head = head;
+		SerialUSB.releaseRead(count);
+	}
+}
+
+static void _usart_rx_fill()
+{
+	xioRxRing *r = &rx[XIO_DEV_USART];
+	uint16_t wr = (XIO_USART->UART_RPR - (uintptr_t)usart_dma) & (XIO_USART_DMA_LEN-1);	// where the PDC writes next
+
+	if (XIO_USART->UART_RNCR == 0) {			// PDC has wrapped - queue the buffer up again
+		XIO_USART->UART_RNPR = (uintptr_t)usart_dma;
+		XIO_USART->UART_RNCR = XIO_USART_DMA_LEN;
+	}
+	while (usart_dma_rd != wr) {
+		uint8_t c = usart_dma[usart_dma_rd];
+		usart_dma_rd = (usart_dma_rd + 1) & (XIO_USART_DMA_LEN-1);
+		if (_xio_realtime_char(XIO_DEV_USART, c) == true) { continue;}
+		if (xio.console != XIO_DEV_USART) { continue;}	// not the console - realtime characters only
+		uint16_t next = (r->head + 1) & (XIO_RX_BUFFER_LEN-1);
+		if (next == r->tail) { continue;}	// ring is full - the character is lost
+		r->buf[r->head] = c;
+		r->head = next;
+	}
+}
+
+static void _can_rx_fill()
+{
+	xioRxRing *r = &rx[XIO_DEV_CAN];
+	uint8_t text[CAN_TEXT_LEN];
+
+	while (((XIO_RX_BUFFER_LEN-1) - ((r->head - r->tail) & (XIO_RX_BUFFER_LEN-1))) >= CAN_TEXT_LEN) {
+		uint8_t len = can_read_text(text);
+		if (len == 0) { return;}
+		for (uint8_t i=0; i<len; i++) {
+			if (_xio_realtime_char(XIO_DEV_CAN, text[i]) == true) { continue;}
+			if (xio.console != XIO_DEV_CAN) { continue;}	// not the console - realtime characters only
+			r->buf[r->head] = text[i];
+			r->head = (r->head + 1) & (XIO_RX_BUFFER_LEN-1);
+		}
+	}
+}
+
+static void _xio_rx_fill()
+{
+	_usb_rx_fill();
+	_usart_rx_fill();
+	_can_rx_fill();
+}
+
+/*
+ * xio_get_rx_free() - return the number of characters the console's rx ring can still take
+ *
+ *	Reported in the flow control footer so a host can keep the ring full without
+ *	overrunning it. Realtime characters don't take up space.
+ */
+uint16_t xio_get_rx_free()
+{
+	xioRxRing *r = &rx[xio.console];
+	return ((XIO_RX_BUFFER_LEN-1) - ((r->head - r->tail) & (XIO_RX_BUFFER_LEN-1)));
+}
+
+/*
+ * xio_input_waiting() - return TRUE if console input is waiting to be read
+ */
+uint8_t xio_input_waiting() { return (xio_get_rx_free() < XIO_RX_BUFFER_LEN-1);}
 
 /*
  * read_char() - returns single char or -1 (_FDEV_ERR) is none available
  */
 int read_char (void)
 {
-	return SerialUSB.readByte();
+	xioRxRing *r = &rx[xio.console];
+
+	if (r->tail == r->head) { return (_FDEV_ERR);}
+	uint8_t c = r->buf[r->tail];
+	r->tail = (r->tail + 1) & (XIO_RX_BUFFER_LEN-1);
+	return (c);
 }
 
 /* 
@@ -59,29 +254,319 @@ int read_char (void)
  *                    Index will equal size.
  *
  *	  STAT_FILE_SIZE_EXCEEDED returned if the starting index exceeds the size.
+ *
+ *	While a stored job runs (see xio_file.h) lines come from the file device whenever
+ *	the console has nothing waiting and no console line has been started.
  */
 
 stat_t read_line (uint8_t *buffer, uint16_t *index, size_t size)
 {
+	xioRxRing *r = &rx[xio.console];
+
 	if (*index >= size) { return (STAT_FILE_SIZE_EXCEEDED);}
+	if ((xf.state == XIO_FILE_PLAYING) && (*index == 0) && (r->tail == r->head)) {
+		return (xio_file_read_line(buffer, index, size));
+	}
+	xf.line_read = 0;						// this line is from the console
 
-	for (int c; *index < size; (*index)++ ) {
-		if ((c = read_char()) != _FDEV_ERR) {
-			buffer[*index] = (uint8_t)c;
+	while (*index < size) {
+		uint16_t head = r->head;
+		uint16_t tail = r->tail;
+		if (tail == head) { return (STAT_EAGAIN);}
+
+		uint16_t count = (head > tail) ? (head - tail) : (XIO_RX_BUFFER_LEN - tail);	// contiguous part
+		if (count > size - *index) { count = size - *index;}
+
+		uint8_t *src = &r->buf[tail];
+		uint8_t *dst = &buffer[*index];
+		for (uint16_t i=0; i<count; i++) {	// copy up to the terminator
+			uint8_t c = src[i];
 			if ((c == LF) || (c == CR)) {
-				buffer[*index] = NUL;
+				dst[i] = NUL;
+				*index += i;
+				r->tail = (tail + i+1) & (XIO_RX_BUFFER_LEN-1);
 				return (STAT_OK);
 			}
-			continue;
+			dst[i] = c;
 		}
-		return (STAT_EAGAIN);
-	}	
+		*index += count;
+		r->tail = (tail + count) & (XIO_RX_BUFFER_LEN-1);
+	}
 	return (STAT_BUFFER_FULL);
 }
 
-size_t write(uint8_t *buffer, size_t size)
+/*
+ * xio_init() - set up the USART, the file device and buffered console output
+ * xio_flush_output() - send anything buffered
+ *
+ *	Unbuffered, every fprintf() reaches _write() on its own, so a $$ dump or help 
+ *	screen goes out as hundreds of small USB packets. Buffered, output only goes out
+ *	when the buffer fills or xio_flush_output() is called. The controller calls it 
+ *	once per pass, so everything one task prints - a response, a report, a whole 
+ *	config dump - ends up in a few large packets. A console change requested by $ci
+ *	is made here, after the response to it has been flushed to the old console.
+ *
+ *	xio_init() must run before the first output to stderr.
+ */
+static char _tx_buf[XIO_TX_BUFFER_LEN];
+
+static void _usart_init()
+{
+	PMC->PMC_PCER0 = (1u << XIO_USART_ID);	// clock the USART
+	XIO_USART_PIO->PIO_PDR = XIO_USART_PINS;	// hand the pins to the peripheral...
+	XIO_USART_PIO->PIO_ABSR &= ~XIO_USART_PINS;	// ...peripheral A
+
+	XIO_USART->UART_PTCR = UART_PTCR_RXTDIS | UART_PTCR_TXTDIS;
+	XIO_USART->UART_CR = UART_CR_RSTRX | UART_CR_RSTTX | UART_CR_RXDIS | UART_CR_TXDIS;
+	XIO_USART->UART_MR = UART_MR_PAR_NO | UART_MR_CHMODE_NORMAL;	// 8 bits, 1 stop bit is fixed
+	XIO_USART->UART_BRGR = UART_BRGR_CD((SystemCoreClock + 8 * XIO_USART_BAUD) / (16 * XIO_USART_BAUD));
+	XIO_USART->UART_IDR = 0xFFFFFFFF;			// no interrupts - the PDC does the work
+
+	XIO_USART->UART_RPR = (uintptr_t)usart_dma;	// receive circularly: this buffer...
+	XIO_USART->UART_RCR = XIO_USART_DMA_LEN;
+	XIO_USART->UART_RNPR = (uintptr_t)usart_dma;	// ...then the same one again
+	XIO_USART->UART_RNCR = XIO_USART_DMA_LEN;
+	usart_dma_rd = 0;
+
+	XIO_USART->UART_PTCR = UART_PTCR_RXTEN | UART_PTCR_TXTEN;
+	XIO_USART->UART_CR = UART_CR_RXEN | UART_CR_TXEN;
+}
+
+void xio_init()
+{
+	xio.console = XIO_CONSOLE_DEVICE;
+	xio.console_next = XIO_CONSOLE_DEVICE;
+	_usart_init();
+	setvbuf(stderr, _tx_buf, _IOFBF, sizeof(_tx_buf));
+}
+
+void xio_flush_output()
 {
-//	SerialUSB.write(buffer, sizeof(buffer));
-	SerialUSB.write(buffer, size);
+	fflush(stderr);
+	if (xio.console_next != xio.console) {
+		xio.console = xio.console_next;
+	}
+}
+
+/*
+ * xio_set_stdin()  - set the console input device
+ * xio_set_stdout() - set the console output device (same as stderr - all output goes to stderr)
+ * xio_set_stderr() - set the console output device
+ *
+ *	There is one console, so these all set it. They take effect at once and are 
+ *	meant for startup - see xio_set_ci() for changing the console at runtime.
+ */
+void xio_set_stdin(const uint8_t dev)
+{
+	if (dev >= XIO_DEV_INPUTS) { return;}
+	xio.console = dev;
+	xio.console_next = dev;
+}
+
+void xio_set_stdout(const uint8_t dev) { xio_set_stdin(dev);}
+void xio_set_stderr(const uint8_t dev) { xio_set_stdin(dev);}
+
+/*
+ * Transmit rings
+ *
+ * xio_write() - queue output without waiting for the host
+ * _xio_tx_drain() - move queued output to the devices - runs from the SysTick interrupt
+ *
+ *	SerialUSB.write() blocks until the host has taken everything and then forces a
+ *	flush, so every response or report could stall the main loop on a slow host.
+ *	All console output (_write(), and so stdio) comes through xio_write() instead, 
+ *	which only copies into the tx ring of the current output device. It only waits 
+ *	if the ring is full.
+ *
+ *	The rings are drained every millisecond from the SysTick interrupt. The USB 
+ *	drain fills the endpoint banks as far as they will go. Full banks are sent as 
+ *	they fill, and a partly filled one is sent once the ring is empty - so bursts go
+ *	out as full size packets. The USART drain hands the PDC the longest contiguous 
+ *	run of the ring and retires it once the PDC is done. The CAN drain packs the ring
+ *	into text frames for as long as the CAN transmit ring takes them. The foreground
+ *	only writes head, the interrupt only writes tail.
+ *
+ *	USB output is dropped while no host is connected, as it would be at the USB level.
+ */
+struct xioTxRing {
+	volatile uint16_t head;					// next slot to fill - foreground only
+	volatile uint16_t tail;					// next slot to send - drain interrupt only
+	uint8_t buf[XIO_TX_RING_LEN];
+};
+static xioTxRing tx[XIO_DEV_COUNT];
+
+static uint8_t tx_port = XIO_CONSOLE;		// logical port that stdio output currently goes to
+static uint16_t usart_tx_inflight;			// characters handed to the PDC and not yet retired
+
+static uint8_t _port_device(uint8_t port)	// map a logical port to its device
+{
+#if (XIO_TELEMETRY_PORT == 1)
+	if ((port == XIO_TELEMETRY) && (xio.console == XIO_DEV_USB)) { return (XIO_DEV_USB_TELEMETRY);}
+#endif
+	return (xio.console);
+}
+
+static bool _is_connected(uint8_t dev)
+{
+	if (dev == XIO_DEV_USART) { return (true);}
+	if (dev == XIO_DEV_CAN) { return (can_is_connected());}
+#if (XIO_TELEMETRY_PORT == 1)
+	if (dev == XIO_DEV_USB_TELEMETRY) { return (SerialUSB1.isConnected());}
+#endif
+	return (SerialUSB.isConnected());
+}
+
+bool xio_is_connected() { return (_is_connected(xio.console));}
+
+size_t xio_write(const uint8_t *buffer, size_t size)
+{
+	uint8_t dev = _port_device(tx_port);
+	xioTxRing *t = &tx[dev];
+
+	if (_is_connected(dev) == false) { return (size);}
+
+	for (size_t i=0; i<size; i++) {
+		uint16_t next = (t->head + 1) & (XIO_TX_RING_LEN-1);
+		if (next == t->tail) {				// ring is full - wait for the drain
+			uint32_t stalled = hw_get_usec();
+			while (next == t->tail) {
+				if (_is_connected(dev) == false) { return (size);}
+			}
+			ev_record(EV_TX_STALL, cm_get_linenum(RUNTIME), hw_get_usec() - stalled);
+		}
+		t->buf[t->head] = buffer[i];
+		t->head = next;
+	}
 	return (size);
-}
\ No newline at end of file
+}
+
+/*
+ * xio_select_port() - send stdio output to the console or the telemetry port
+ *
+ *	Whatever is already buffered in stderr is flushed to the old port first. Callers
+ *	select XIO_TELEMETRY around a report and XIO_CONSOLE after it. Without a telemetry
+ *	port both are the console and this is only a flush.
+ */
+void xio_select_port(uint8_t port)
+{
+	if (port == tx_port) { return;}
+	fflush(stderr);
+	tx_port = port;
+}
+
+/*
+ * xio_get_tx_bufcount() - return number of bytes waiting in a port's tx ring
+ * xio_tx_backed_up()	 - return true if the ring is above the high water mark
+ *
+ *	Callers that generate output use xio_tx_backed_up() to hold off rather than 
+ *	block in xio_write() when the host is not reading.
+ */
+uint16_t xio_get_tx_bufcount(uint8_t port)
+{
+	xioTxRing *t = &tx[_port_device(port)];
+	return ((t->head - t->tail) & (XIO_TX_RING_LEN-1));
+}
+
+bool xio_tx_backed_up(uint8_t port)
+{
+	if (_is_connected(_port_device(port)) == false) { return (false);}	// output is being dropped anyway
+	return (xio_get_tx_bufcount(port) >= XIO_TX_HI_WATER_MARK);
+}
+
+static void _usb_tx_drain(uint8_t dev, typeof usb._mixin_0_type::Serial &serial)
+{
+	xioTxRing *t = &tx[dev];
+	uint16_t head = t->head;
+
+	while (t->tail != head) {
+		uint16_t count = (head > t->tail) ? (head - t->tail) : (XIO_TX_RING_LEN - t->tail);
+		int16_t written = serial.writeAvailable(&t->buf[t->tail], count);
+		if (written <= 0) { return;}		// banks are busy - try again next tick
+		t->tail = (t->tail + written) & (XIO_TX_RING_LEN-1);
+	}
+	serial.flushPartial();					// end of the burst - send what's left
+}
+
+static void _usart_tx_drain()
+{
+	xioTxRing *t = &tx[XIO_DEV_USART];
+
+	if (XIO_USART->UART_TCR != 0) { return;}	// PDC is still sending the last run
+	t->tail = (t->tail + usart_tx_inflight) & (XIO_TX_RING_LEN-1);
+	usart_tx_inflight = 0;
+
+	uint16_t head = t->head;
+	if (t->tail == head) { return;}
+	usart_tx_inflight = (head > t->tail) ? (head - t->tail) : (XIO_TX_RING_LEN - t->tail);
+	XIO_USART->UART_TPR = (uintptr_t)&t->buf[t->tail];
+	XIO_USART->UART_TCR = usart_tx_inflight;
+}
+
+static void _can_tx_drain()
+{
+	xioTxRing *t = &tx[XIO_DEV_CAN];
+	uint8_t text[CAN_TEXT_LEN];
+
+	while (t->tail != t->head) {
+		uint16_t tail = t->tail;
+		uint8_t len = 0;
+		while ((len < CAN_TEXT_LEN) && (tail != t->head)) {
+			text[len++] = t->buf[tail];
+			tail = (tail + 1) & (XIO_TX_RING_LEN-1);
+		}
+		if (can_write_text(text, len) == false) { return;}	// frames are backed up - try again next tick
+		t->tail = tail;
+	}
+}
+
+static void _xio_tx_drain()
+{
+	_usb_tx_drain(XIO_DEV_USB, SerialUSB);
+#if (XIO_TELEMETRY_PORT == 1)
+	_usb_tx_drain(XIO_DEV_USB_TELEMETRY, SerialUSB1);
+#endif
+	_usart_tx_drain();
+	_can_tx_drain();
+}
+
+namespace Motate {
+	void Timer<SysTickTimerNum>::interrupt() 
+	{
+		_xio_rx_fill();
+		_xio_tx_drain();
+		switch_tick();					// switch debounce samples
+		st_expansion_tick();			// expansion frames the step ISRs left pending
+	}
+}
+
+size_t write(uint8_t *buffer, size_t size)
+{
+	return (xio_write(buffer, size));
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ ***********************************************************************************/
+/*
+ * xio_set_ci() - set console interface - 0=USB, 1=USART, 2=CAN
+ *
+ *	The switch is made in xio_flush_output() so the response goes to the old console.
+ */
+stat_t xio_set_ci(cmdObj_t *cmd)
+{
+	if (cmd->value >= XIO_DEV_INPUTS) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	xio.console_next = (uint8_t)cmd->value;
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_ci[] PROGMEM = "[ci]  console interface%12d [0=USB,1=USART,2=CAN]\n";
+void xio_print_ci(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_ci);}
+
+#endif // __TEXT_MODE
@@ -29,22 +29,138 @@
 #define _XIO_H_
 
 #include "tinyg2.h"
+#ifndef __SIM						// the simulator's console is stdio - see platform/sim
 #include "MotateUSB.h"
 #include "MotateUSBCDC.h"
+#endif
 
 //#include "Arduino.h"
 
-//extern Motate::USBDevice< Motate::USBCDC, Motate::USBCDC > usb;
+/*
+ * XIO_TELEMETRY_PORT - build with a second CDC port for reports
+ *
+ *	When set the device enumerates as two serial ports. Commands, responses and 
+ *	everything else stay on the first. Automatic status reports and queue reports
+ *	go out the second, so a host polling them hard doesn't hold up responses to 
+ *	g-code, and each port has its own backpressure. Off by default - hosts that 
+ *	expect reports on the command port need it off.
+ */
+#ifndef XIO_TELEMETRY_PORT
+#define XIO_TELEMETRY_PORT 0		// 1 = status and queue reports go out a second USB serial port
+#endif
+
+#ifndef __SIM
+#if (XIO_TELEMETRY_PORT == 1)
+extern Motate::USBDevice< Motate::USBCDC, Motate::USBCDC > usb;
+extern typeof usb._mixin_1_type::Serial &SerialUSB1;
+#else
 extern Motate::USBDevice< Motate::USBCDC > usb;
+#endif
 extern typeof usb._mixin_0_type::Serial &SerialUSB;
-//extern typeof usb._mixin_1_type::Serial &SerialUSB1;
+#endif
+
+/*
+ * Devices
+ *
+ *	The console (stdin and stderr) is the USB serial port, the hardware USART or the
+ *	CAN bus (see can.h). Realtime characters are honored from all of them; other 
+ *	input is only taken from the console. The console is set by controller_init() and can be changed
+ *	at runtime with $ci - the switch is made once the response to $ci has gone out.
+ */
+enum xioDevice {
+	XIO_DEV_USB = 0,				// USB serial port (the first one if there are two)
+	XIO_DEV_USART,					// hardware USART - see XIO_USART below
+	XIO_DEV_CAN,					// text frames on the CAN bus - see can.h
+#if (XIO_TELEMETRY_PORT == 1)
+	XIO_DEV_USB_TELEMETRY,			// second USB serial port - output only
+#endif
+	XIO_DEV_COUNT
+};
+#define XIO_DEV_INPUTS 3			// devices that take input - USB, USART and CAN
+
+enum xioPort {						// logical output ports - mapped to devices by xio
+	XIO_CONSOLE = 0,				// commands and responses
+	XIO_TELEMETRY					// status and queue reports - the console unless there is a telemetry port
+};
+
+#ifndef XIO_CONSOLE_DEVICE
+#define XIO_CONSOLE_DEVICE XIO_DEV_USB	// console device at startup
+#endif
+
+/*
+ * XIO_USART - hardware serial port used as the alternate console
+ *
+ *	Defaults to the UART on PA8 (URXD) and PA9 (UTXD) - pins 0 and 1 on a Due, which
+ *	also reach the programming port through the 16U2. The USARTs' pins are taken by
+ *	the limit switches and SPI selects (see hardware.h).
+ *
+ *	Both directions run on the PDC, so there is no per character interrupt at any
+ *	baud rate. There is no flow control: a host on this port should stream with 
+ *	the flow control footer ($fs=2).
+ */
+#ifndef XIO_USART
+#define XIO_USART 			UART
+#define XIO_USART_ID 		ID_UART
+#define XIO_USART_PIO 		PIOA
+#define XIO_USART_PINS 		(PIO_PA8A_URXD | PIO_PA9A_UTXD)	// peripheral A
+#endif
+#ifndef XIO_USART_BAUD
+#define XIO_USART_BAUD 		115200
+#endif
+#ifndef XIO_USART_DMA_LEN
+#define XIO_USART_DMA_LEN 	512		// circular PDC receive buffer - must be a power of 2
+#endif
+
+typedef struct xioSingleton {
+	uint8_t console;				// device for stdin and stderr
+	uint8_t console_next;			// console requested by $ci - takes effect in xio_flush_output()
+} xioSingleton_t;
+
+extern xioSingleton_t xio;
 
 #define _FDEV_ERR -1
 #define _FDEV_EOF -2
 
+void xio_init(void);
+void xio_set_stdin(const uint8_t dev);
+void xio_set_stdout(const uint8_t dev);
+void xio_set_stderr(const uint8_t dev);
+bool xio_is_connected(void);
+stat_t xio_set_ci(cmdObj_t *cmd);
+
 int read_char (void);
 stat_t read_line (uint8_t *buffer, uint16_t *index, size_t size);
 size_t write(uint8_t *buffer, size_t size);
+size_t xio_write(const uint8_t *buffer, size_t size);
+
+#ifndef XIO_TX_BUFFER_LEN
+#define XIO_TX_BUFFER_LEN 512		// stderr output is collected here and sent in as few device writes as possible
+#endif
+
+uint16_t xio_get_rx_free(void);
+uint8_t xio_input_waiting(void);
+uint16_t xio_get_tx_bufcount(uint8_t port);
+bool xio_tx_backed_up(uint8_t port);
+void xio_select_port(uint8_t port);
+
+#ifndef XIO_TX_RING_LEN
+#define XIO_TX_RING_LEN 1024		// transmit rings drained from the SysTick interrupt - must be a power of 2
+#endif
+#ifndef XIO_TX_HI_WATER_MARK		// stop making new output above this - leaves room for a full stderr buffer
+#define XIO_TX_HI_WATER_MARK (XIO_TX_RING_LEN - XIO_TX_BUFFER_LEN)
+#endif
+
+#ifndef XIO_RX_BUFFER_LEN
+#define XIO_RX_BUFFER_LEN 512		// receive rings - hold at least one full USB packet - must be a power of 2
+#endif
+void xio_flush_output(void);
+
+#ifdef __TEXT_MODE
+	void xio_print_ci(cmdObj_t *cmd);
+#else
+	#define xio_print_ci tx_print_stub
+#endif
+
 
 /* Some useful ASCII definitions */
 
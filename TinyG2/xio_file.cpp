@@ -0,0 +1,573 @@
+/*
+ * xio_file.cpp - file device for jobs stored on an SPI serial flash
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart Jr.
+ * Copyright (c) 2013 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "tinyg2.h"
+#include "config.h"
+#include "controller.h"
+#include "text_parser.h"
+#include "util.h"
+#include "xio.h"
+#include "xio_file.h"
+#include "switch.h"
+
+xioFileSingleton_t xf;
+
+/*
+ * Serial flash
+ *
+ *	The SPI runs polled, one character at a time. Jobs are read a page at a time into
+ *	page[], so a line costs at most a page read - well under a millisecond at the
+ *	default clock - and usually nothing. Programming and erasing wait on the part's
+ *	busy bit. Sector erases are done as the upload reaches each sector, so only an
+ *	upload ever waits on one; nothing is moving then.
+ */
+#define FLASH_WRITE_ENABLE	0x06
+#define FLASH_READ_STATUS	0x05
+#define FLASH_READ			0x03
+#define FLASH_PAGE_PROGRAM	0x02
+#define FLASH_SECTOR_ERASE	0x20
+#define FLASH_JEDEC_ID		0x9F
+#define FLASH_BUSY			0x01		// status register write-in-progress bit
+
+typedef struct xioFileHeader {			// kept in the first sector
+	uint32_t magic;
+	uint32_t size;						// characters in the job
+	uint32_t lines;						// lines in the job
+} xioFileHeader_t;
+
+static uint8_t _spi_xfer(uint8_t out)
+{
+	while ((XIO_FILE_SPI->SPI_SR & SPI_SR_TDRE) == 0);
+	XIO_FILE_SPI->SPI_TDR = out;
+	while ((XIO_FILE_SPI->SPI_SR & SPI_SR_RDRF) == 0);
+	return ((uint8_t)XIO_FILE_SPI->SPI_RDR);
+}
+
+static void _spi_end()					// raise chip select after the last character
+{
+	XIO_FILE_SPI->SPI_CR = SPI_CR_LASTXFER;
+	while ((XIO_FILE_SPI->SPI_SR & SPI_SR_TXEMPTY) == 0);
+}
+
+static void _spi_init()
+{
+	PMC->PMC_PCER0 = (1u << XIO_FILE_SPI_ID);	// clock the SPI
+	XIO_FILE_SPI_PIO->PIO_PDR = XIO_FILE_SPI_PINS;	// hand the pins to the peripheral...
+	XIO_FILE_SPI_PIO->PIO_ABSR &= ~XIO_FILE_SPI_PINS;	// ...peripheral A
+
+	XIO_FILE_SPI->SPI_CR = SPI_CR_SPIDIS;
+	XIO_FILE_SPI->SPI_CR = SPI_CR_SWRST;
+	XIO_FILE_SPI->SPI_MR = SPI_MR_MSTR | SPI_MR_MODFDIS | SPI_MR_PCS(~(1u << XIO_FILE_SPI_CS) & 0x0F);
+	XIO_FILE_SPI->SPI_CSR[XIO_FILE_SPI_CS] = SPI_CSR_NCPHA | SPI_CSR_CSAAT | SPI_CSR_BITS_8_BIT |	// mode 0
+		SPI_CSR_SCBR((SystemCoreClock + XIO_FILE_SPI_BAUD - 1) / XIO_FILE_SPI_BAUD);
+	XIO_FILE_SPI->SPI_IDR = 0xFFFFFFFF;			// no interrupts
+	XIO_FILE_SPI->SPI_CR = SPI_CR_SPIEN;
+}
+
+static void _flash_command(uint8_t command, uint32_t addr)	// leaves the part selected
+{
+	_spi_xfer(command);
+	_spi_xfer((uint8_t)(addr >> 16));
+	_spi_xfer((uint8_t)(addr >> 8));
+	_spi_xfer((uint8_t)addr);
+}
+
+static void _flash_wait()
+{
+	_spi_xfer(FLASH_READ_STATUS);
+	while ((_spi_xfer(0) & FLASH_BUSY) != 0);
+	_spi_end();
+}
+
+static void _flash_write_enable()
+{
+	_spi_xfer(FLASH_WRITE_ENABLE);
+	_spi_end();
+}
+
+static void _flash_read(uint32_t addr, uint8_t *buf, uint16_t len)
+{
+	_flash_command(FLASH_READ, addr);
+	for (uint16_t i=0; i<len; i++) { buf[i] = _spi_xfer(0);}
+	_spi_end();
+}
+
+static void _flash_program(uint32_t addr, const uint8_t *buf, uint16_t len)	// within one page
+{
+	_flash_write_enable();
+	_flash_command(FLASH_PAGE_PROGRAM, addr);
+	for (uint16_t i=0; i<len; i++) { _spi_xfer(buf[i]);}
+	_spi_end();
+	_flash_wait();
+}
+
+static void _flash_erase_sector(uint32_t addr)
+{
+	_flash_write_enable();
+	_flash_command(FLASH_SECTOR_ERASE, addr);
+	_spi_end();
+	_flash_wait();
+}
+
+static uint8_t _flash_present()
+{
+	_spi_xfer(FLASH_JEDEC_ID);
+	uint8_t manufacturer = _spi_xfer(0);
+	_spi_xfer(0);
+	_spi_xfer(0);
+	_spi_end();
+	return ((manufacturer != 0x00) && (manufacturer != 0xFF));	// nothing on the bus reads as either
+}
+
+/*
+ * xio_file_init() - find the flash and the job on it - called after the settings are loaded
+ */
+void xio_file_init()
+{
+	xioFileHeader_t header;
+
+	memset(&xf, 0, sizeof(xf));
+	xf.end = XIO_FILE_SECTOR_LEN;
+#if (EXPANSION_MOTORS > 0)
+	return;									// the step expansion has the SPI - see stepper.h
+#endif
+	if (sw.estop_mode != ESTOP_DISABLED) { return;}	// the e-stop input has MISO - see SPI0 in xio_file.h
+	_spi_init();
+	xf.present = _flash_present();
+	if (xf.present == false) { return;}
+
+	_flash_read(0, (uint8_t *)&header, sizeof(header));
+	if (((header.magic == XIO_FILE_MAGIC) || (header.magic == XIO_FILE_MAGIC_COMPACT)) &&
+		(header.size <= XIO_FILE_SIZE)) {
+		xf.compact = (header.magic == XIO_FILE_MAGIC_COMPACT);
+		xf.lines = header.lines;
+		xf.end = XIO_FILE_SECTOR_LEN + header.size;
+	}
+	xf.page_addr = 0xFFFFFFFF;				// nothing cached
+}
+
+/*
+ * Compact jobs - see __XIO_FILE_COMPACT in xio_file.h
+ *
+ *	A line is a length byte and that many code bytes. Code bytes below 0x80 are
+ *	characters. Tokens are CODE_TOKEN + letter * 3 + mode. A line whose first code
+ *	byte is CODE_RAW is stored as it is. Varints are 7 bits a byte, low bits first,
+ *	zigzagged so small negative deltas stay short.
+ *
+ *	Coding never makes a line longer, in code or as it decodes: a word that would
+ *	code longer than its text, or decode past INPUT_BUFFER_LEN, is stored as text.
+ *	Numbers are only coded when they keep every significant digit the parser reads
+ *	(see _get_gcode_number()), so a decoded word reads as exactly the same float.
+ */
+#define CODE_TOKEN		0x80
+#define CODE_REPEAT		0			// token modes
+#define CODE_DELTA		1
+#define CODE_ABSOLUTE	2
+#define CODE_MODES		3
+#define CODE_RAW		0xFF
+#define CODE_DIGITS_MAX	9			// significant digits - fits an int32_t and the parser's mantissa
+#define CODE_NUMBER_LEN	(CODE_DIGITS_MAX + 3)// sign, digits, point and a leading 0
+#define CODE_TOKEN_LEN	7			// token, decimals and a 5 byte varint
+
+static void _file_reset_words()
+{
+	memset(xf.word_value, 0, sizeof(xf.word_value));
+	memset(xf.word_decimals, 0, sizeof(xf.word_decimals));
+}
+
+static uint8_t _put_varint(uint8_t *code, int32_t value)	// NULL code just counts
+{
+	uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);	// zigzag
+	uint8_t n = 0;
+	for (; v >= 0x80; v >>= 7, n++) {
+		if (code != NULL) { code[n] = (uint8_t)(v | 0x80);}
+	}
+	if (code != NULL) { code[n] = (uint8_t)v;}
+	return (n+1);
+}
+
+/*
+ * _read_word() - read a word's number as an integer and decimal count
+ *
+ *	Returns the characters in the word, or 0 if it can't be coded - no digits, too
+ *	many digits or -0, whose sign an integer can't hold.
+ */
+static uint8_t _read_word(const char_t *word, int32_t *value, uint8_t *decimals)
+{
+	const char_t *rd = word + 1;
+	uint8_t negative = false;
+	if (*rd == '-') { negative = true; rd++;}
+	else if (*rd == '+') { rd++;}
+
+	uint32_t v = 0;
+	uint8_t digits = 0;
+	uint8_t significant = 0;
+	*decimals = 0;
+	for (uint8_t point = false; ; rd++) {
+		if ((*rd == '.') && (point == false)) { point = true; continue;}
+		if (isdigit(*rd) == false) { break;}
+		if (((v != 0) || (*rd != '0')) && (++significant > CODE_DIGITS_MAX)) { return (0);}
+		if ((point == true) && (++(*decimals) > CODE_DIGITS_MAX)) { return (0);}
+		v = v*10 + (*rd - '0');
+		digits++;
+	}
+	if ((digits == 0) || ((negative == true) && (v == 0))) { return (0);}
+	*value = (negative == true) ? -(int32_t)v : (int32_t)v;
+	return (rd - word);
+}
+
+static uint8_t _render_number(char_t *text, int32_t value, uint8_t decimals)
+{
+	char_t digits[CODE_DIGITS_MAX+1];
+	uint32_t v = (value < 0) ? -value : value;
+	uint8_t n = 0;
+	do {
+		digits[n++] = '0' + (v % 10);
+		v /= 10;
+	} while ((v != 0) || (n <= decimals));			// at least one digit before the point
+
+	uint8_t len = 0;
+	if (value < 0) { text[len++] = '-';}
+	while (n > 0) {
+		if (n-- == decimals) { text[len++] = '.';}
+		text[len++] = digits[n];
+	}
+	return (len);
+}
+
+/*
+ * _encode_line() - code a line for a compact job - returns the code length
+ */
+static uint16_t _encode_line(const char_t *line, uint8_t *code)
+{
+	const char_t *rd = line;
+	uint16_t len = strlen((const char *)line);
+	for (uint16_t i=0; i<len; i++) {
+		if (line[i] & 0x80) {					// not coded - store as it is
+			code[0] = CODE_RAW;
+			memcpy(&code[1], line, len);
+			return (len+1);
+		}
+	}
+
+	char_t text[CODE_NUMBER_LEN];
+	uint8_t token[CODE_TOKEN_LEN];
+	uint16_t n = 0;								// code length
+	uint16_t rlen = 0;							// length of the line as it will decode
+	uint8_t word = false;						// last code was a token
+	uint8_t dropped = false;					// the space after it is left to be implied
+	char_t comment = NUL;						// ')' or LF (to the end) while in a comment
+
+	while (*rd != NUL) {
+		int32_t value;
+		uint8_t decimals;
+		uint8_t wlen;
+		if ((comment == NUL) && (isalpha(*rd)) && ((wlen = _read_word(rd, &value, &decimals)) > 0)) {
+			uint8_t letter = toupper(*rd) - 'A';
+			uint8_t tlen = 0;
+			if ((value == xf.word_value[letter]) && (decimals == xf.word_decimals[letter])) {
+				token[tlen++] = CODE_TOKEN + letter * CODE_MODES + CODE_REPEAT;
+			} else if (decimals == xf.word_decimals[letter]) {
+				token[tlen++] = CODE_TOKEN + letter * CODE_MODES + CODE_DELTA;
+				tlen += _put_varint(&token[tlen], value - xf.word_value[letter]);
+			}
+			if ((tlen == 0) || (tlen > 2 + _put_varint(NULL, value))) {	// absolute is shorter
+				tlen = 0;
+				token[tlen++] = CODE_TOKEN + letter * CODE_MODES + CODE_ABSOLUTE;
+				token[tlen++] = decimals;
+				tlen += _put_varint(&token[tlen], value);
+			}
+			uint16_t dlen = word + 1 + _render_number(text, value, decimals);	// space, letter, number
+			if ((tlen <= wlen + dropped) && 
+				((rlen + dlen + strlen((const char *)(rd + wlen))) < INPUT_BUFFER_LEN)) {
+				memcpy(&code[n], token, tlen);
+				n += tlen;
+				rlen += dlen;
+				rd += wlen;
+				xf.word_value[letter] = value;
+				xf.word_decimals[letter] = decimals;
+				word = true;
+				dropped = false;
+				continue;
+			}
+		}
+		if (dropped == true) {
+			code[n++] = ' ';
+			rlen++;
+			dropped = false;
+		} else if ((word == true) && (*rd == ' ')) {
+			dropped = true;
+			rd++;
+			continue;
+		}
+		word = false;
+		if (comment == NUL) {
+			if (*rd == '(') { comment = ')';}
+			else if (*rd == ';') { comment = LF;}
+		} else if (*rd == comment) { comment = NUL;}
+		code[n++] = *rd++;
+		rlen++;
+	}
+	if (dropped == true) { code[n++] = ' ';}
+	return (n);
+}
+
+/*
+ * xio_file_read_line() - read the next line of the job - see read_line() for returns
+ *
+ *	Called by read_line() while the job runs and the console has nothing waiting.
+ *	A line is always read whole. One longer than the buffer is cut to fit. STAT_EAGAIN
+ *	is returned while paused, STAT_EOF at the end of the job, after which input cuts
+ *	back to the console.
+ */
+static int16_t _file_getc()
+{
+	if (xf.addr >= xf.end) { return (-1);}
+	uint32_t page = xf.addr & ~(uint32_t)(XIO_FILE_PAGE_LEN-1);
+	if (page != xf.page_addr) {
+		_flash_read(page, xf.page, XIO_FILE_PAGE_LEN);
+		xf.page_addr = page;
+	}
+	return (xf.page[xf.addr++ - page]);
+}
+
+static uint32_t _file_get_varint(uint16_t *count)
+{
+	uint32_t v = 0;
+	int16_t c;
+	for (uint8_t shift = 0; (*count > 0) && ((c = _file_getc()) >= 0); shift += 7) {
+		(*count)--;
+		v |= (uint32_t)(c & 0x7F) << shift;
+		if ((c & 0x80) == 0) { break;}
+	}
+	return (v);
+}
+
+static int32_t _file_get_signed(uint16_t *count)
+{
+	uint32_t v = _file_get_varint(count);
+	return ((int32_t)(v >> 1) ^ -(int32_t)(v & 1));		// un-zigzag
+}
+
+#define _put_char(c) if ((buffer != NULL) && (i < size-1)) { buffer[i++] = (c);}
+
+static uint16_t _file_read(uint8_t *buffer, size_t size)	// read a line - NULL buffer skips it
+{
+	int16_t c;
+	uint16_t i = 0;
+
+	if (xf.compact == false) {
+		while (((c = _file_getc()) >= 0) && (c != LF)) { _put_char((uint8_t)c);}
+		return (i);
+	}
+	uint16_t count = ((c = _file_getc()) < 0) ? 0 : c;
+	uint8_t raw = false;
+	uint8_t word = false;
+	char_t text[CODE_NUMBER_LEN];
+	for (uint16_t first = count; (count > 0) && ((c = _file_getc()) >= 0); ) {
+		count--;
+		if ((c == CODE_RAW) && (count+1 == first)) { raw = true; continue;}
+		if ((raw == true) || (c < CODE_TOKEN)) {
+			_put_char((uint8_t)c);
+			word = false;
+			continue;
+		}
+		uint8_t letter = (c - CODE_TOKEN) / CODE_MODES;
+		uint8_t mode = (c - CODE_TOKEN) % CODE_MODES;
+		if (mode == CODE_DELTA) {
+			xf.word_value[letter] += _file_get_signed(&count);
+		} else if (mode == CODE_ABSOLUTE) {
+			if (count > 0) { count--; xf.word_decimals[letter] = _file_getc();}
+			xf.word_value[letter] = _file_get_signed(&count);
+		}
+		if (word == true) { _put_char(' ');}
+		_put_char('A' + letter);
+		if (buffer != NULL) {
+			uint8_t len = _render_number(text, xf.word_value[letter], xf.word_decimals[letter]);
+			for (uint8_t j=0; j<len; j++) { _put_char(text[j]);}
+		}
+		word = true;
+	}
+	return (i);
+}
+
+stat_t xio_file_read_line(uint8_t *buffer, uint16_t *index, size_t size)
+{
+	if (xf.pause == XIO_FILE_STOP) { xf.addr = xf.end;}
+	if ((xf.pause == XIO_FILE_PAUSE) && (xf.addr < xf.end)) { return (STAT_EAGAIN);}
+
+	if (xf.addr >= xf.end) {
+		xf.state = XIO_FILE_IDLE;
+		xf.pause = XIO_FILE_RUN;
+		xf.line_read = 0;
+		return (STAT_EOF);
+	}
+	uint16_t i = _file_read(buffer, size);
+	buffer[i] = NUL;
+	*index = i;
+	xf.line_read = ++xf.linenum;
+	return (STAT_OK);
+}
+
+/*
+ * xio_file_write_line() - store a line of an upload
+ */
+stat_t xio_file_write_line(const char_t *line)
+{
+	if (xf.state != XIO_FILE_UPLOADING) { return (STAT_FILE_NOT_OPEN);}
+
+	uint16_t len = strlen((const char *)line);
+	if ((xf.addr + xf.page_len + len + 1) > (XIO_FILE_SECTOR_LEN + XIO_FILE_SIZE)) {
+		return (STAT_FILE_SIZE_EXCEEDED);		// a coded line is never longer - see _encode_line()
+	}
+	uint8_t code[INPUT_BUFFER_LEN+1];
+	const uint8_t *out = (const uint8_t *)line;
+	if (xf.compact == true) {					// the length byte stands in for the LF
+		code[0] = (uint8_t)_encode_line(line, &code[1]);
+		out = code;
+		len = code[0];
+	}
+	for (uint16_t i=0; i<=len; i++) {
+		xf.page[xf.page_len++] = ((i < len) || (xf.compact == true)) ? out[i] : LF;
+		if (xf.page_len < XIO_FILE_PAGE_LEN) { continue;}
+		if ((xf.addr & (XIO_FILE_SECTOR_LEN-1)) == 0) { _flash_erase_sector(xf.addr);}
+		_flash_program(xf.addr, xf.page, XIO_FILE_PAGE_LEN);
+		xf.addr += XIO_FILE_PAGE_LEN;
+		xf.page_len = 0;
+	}
+	xf.lines++;
+	return (STAT_OK);
+}
+
+static void _file_end_upload()
+{
+	xioFileHeader_t header;
+
+	if (xf.page_len > 0) {
+		if ((xf.addr & (XIO_FILE_SECTOR_LEN-1)) == 0) { _flash_erase_sector(xf.addr);}
+		_flash_program(xf.addr, xf.page, xf.page_len);
+		xf.addr += xf.page_len;
+		xf.page_len = 0;
+	}
+	header.magic = (xf.compact == true) ? XIO_FILE_MAGIC_COMPACT : XIO_FILE_MAGIC;
+	header.size = xf.addr - XIO_FILE_SECTOR_LEN;
+	header.lines = xf.lines;
+	_flash_program(0, (uint8_t *)&header, sizeof(header));	// header sector was erased at the start
+	xf.end = xf.addr;
+	xf.state = XIO_FILE_IDLE;
+}
+
+uint8_t xio_file_uploading() { return (xf.state == XIO_FILE_UPLOADING);}
+
+/*
+ * xio_file_linenum() - job line number of the line just read, 0 if it came from the console
+ *
+ *	The Gcode parser takes this as the line number of a block without an N word, so
+ *	the progress of a job shows in the line number of status reports.
+ */
+uint32_t xio_file_linenum() { return (xf.line_read);}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ ***********************************************************************************/
+/*
+ * xio_file_set_fl() - 1 starts an upload, 0 ends it
+ * xio_file_set_fr() - run the job from a line
+ * xio_file_set_fp() - 0=run, 1=pause, 2=stop
+ */
+stat_t xio_file_set_fl(cmdObj_t *cmd)
+{
+	if (xf.present == false) { return (STAT_NO_SUCH_DEVICE);}
+
+	if (fp_ZERO(cmd->value)) {
+		if (xf.state != XIO_FILE_UPLOADING) { return (STAT_FILE_NOT_OPEN);}
+		_file_end_upload();
+		return (STAT_OK);
+	}
+	if (xf.state != XIO_FILE_IDLE) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	_flash_erase_sector(0);					// the old job is gone from here on
+	xf.page_addr = 0xFFFFFFFF;
+	xf.state = XIO_FILE_UPLOADING;
+	xf.addr = XIO_FILE_SECTOR_LEN;
+	xf.end = XIO_FILE_SECTOR_LEN;
+	xf.page_len = 0;
+	xf.lines = 0;
+#ifdef __XIO_FILE_COMPACT
+	xf.compact = true;
+#else
+	xf.compact = false;
+#endif
+	_file_reset_words();
+	return (STAT_OK);
+}
+
+stat_t xio_file_set_fr(cmdObj_t *cmd)
+{
+	if (xf.present == false) { return (STAT_NO_SUCH_DEVICE);}
+	if (xf.state == XIO_FILE_UPLOADING) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	if (xf.end == XIO_FILE_SECTOR_LEN) { return (STAT_FILE_NOT_OPEN);}	// no job stored
+	if (cmd->value < 0) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+
+	uint32_t start = (uint32_t)cmd->value;
+	if (start > xf.lines) { return (STAT_INPUT_VALUE_TOO_LARGE);}
+
+	xf.addr = XIO_FILE_SECTOR_LEN;			// skip to the line
+	xf.linenum = 0;
+	_file_reset_words();
+	while ((xf.linenum + 1 < start) && (xf.addr < xf.end)) {
+		_file_read(NULL, 0);					// compact lines are decoded for the word numbers
+		xf.linenum++;
+	}
+	xf.pause = XIO_FILE_RUN;
+	xf.state = XIO_FILE_PLAYING;
+	return (STAT_OK);
+}
+
+stat_t xio_file_set_fp(cmdObj_t *cmd)
+{
+	if (cmd->value > XIO_FILE_STOP) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	if (xf.state != XIO_FILE_PLAYING) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	xf.pause = (uint8_t)cmd->value;
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_fl[] PROGMEM = "[fl]  file lines stored%12lu\n";
+static const char fmt_fr[] PROGMEM = "[fr]  file line running%12lu\n";
+static const char fmt_fp[] PROGMEM = "[fp]  file pause%19d [0=run,1=pause,2=stop]\n";
+
+void xio_file_print_fl(cmdObj_t *cmd) { text_print_int(cmd, fmt_fl);}
+void xio_file_print_fr(cmdObj_t *cmd) { text_print_int(cmd, fmt_fr);}
+void xio_file_print_fp(cmdObj_t *cmd) { text_print_ui8(cmd, fmt_fp);}
+
+#endif // __TEXT_MODE
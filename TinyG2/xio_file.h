@@ -0,0 +1,157 @@
+/*
+ * xio_file.h - file device for jobs stored on an SPI serial flash
+ * Part of TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart Jr.
+ * Copyright (c) 2013 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _XIO_FILE_H_
+#define _XIO_FILE_H_
+
+/*
+ * File device
+ *
+ *	One job is kept on a serial NOR flash (25 series - W25Qxx, AT25, SST25 and the
+ *	like) on the SPI bus. It is uploaded once and then run from the flash, so the
+ *	host is out of the loop while the job runs.
+ *
+ *	  $fl=1		start an upload - the stored job is discarded
+ *	  $fl=0		end the upload and keep the job. $fl reads back the lines stored
+ *	  $fr=n		run the job from line n (0 or 1 is the start). $fr reads back the
+ *				line running - also reported as the line number (cm_get_linenum())
+ *				for lines without an N word. The lines before n are not run - to pick
+ *				up their modal state and offsets set $rsl=n and run from the start
+ *				(see Job restart in canonical_machine.cpp)
+ *	  $fp=1		pause at the next line, $fp=0 resume, $fp=2 stop the job
+ *
+ *	While uploading, lines starting with $, ? or { are still run as commands, so an
+ *	upload can be ended and queried. Every other line is stored and answered as if
+ *	it had been run. While the job runs the console is still read, and a line from
+ *	the console goes ahead of the next line of the job. At the end of the job input
+ *	cuts back to the console.
+ *
+ *	Flash layout: the first sector holds the job header, the job follows from the
+ *	second, one LF terminated line after another - or, for a compact job, one coded
+ *	line after another (see below).
+ */
+/* SPI0
+ *	The flash is on SPI0, whose MISO (PA25) is also the e-stop input (estop_pin_num
+ *	in hardware.h, see Emergency stop in switch.h) - every other header pin is taken.
+ *	The file device looks for the flash once the settings are loaded, and only if the
+ *	e-stop is off ($es=0). With the flash found, $es can't be turned on - it returns
+ *	STAT_PIN_IN_USE. To change over set $es and reset. A build with step expansion 
+ *	motors has no file device (see Step expansion in stepper.h).
+ */
+/* __XIO_FILE_COMPACT
+ *	Stores uploads as compact jobs. Each line is a length byte and its code. Every
+ *	Gcode word outside a comment whose number fits in 9 digits becomes a token for
+ *	its letter, and the number is held as an integer with a decimal count:
+ *
+ *	  repeat	same number as the last word with this letter - 1 byte (G1, F1200...)
+ *	  delta		same decimals, the difference from the last number as a varint
+ *	  absolute	the decimal count, then the number as a varint
+ *
+ *	The other characters are stored as they are, and the space between two words is
+ *	implied. A 3D surfacing line like "G1 X12.345 Y-3.21 Z0.5" codes to about a third 
+ *	of its size, and a job reads that many fewer bytes from the flash. Lines are
+ *	decoded back to text as they are read, so the parser is unchanged. A decoded
+ *	line can differ in form but not in value - "x.5" comes back as "X0.5", and words
+ *	are spaced. Lines with characters above 0x7F are stored as they are.
+ *
+ *	Jobs stored either way run. Comment out to store uploads as text.
+ */
+#define __XIO_FILE_COMPACT
+#ifndef XIO_FILE_SPI
+#define XIO_FILE_SPI 		SPI0
+#define XIO_FILE_SPI_ID 	ID_SPI0
+#define XIO_FILE_SPI_PIO 	PIOA
+#define XIO_FILE_SPI_PINS 	(PIO_PA25A_SPI0_MISO | PIO_PA26A_SPI0_MOSI | PIO_PA27A_SPI0_SPCK | PIO_PA28A_SPI0_NPCS0)
+#define XIO_FILE_SPI_CS 	0		// NPCS line the flash is selected by - NPCS0 is pin 10 on a Due
+#endif
+#ifndef XIO_FILE_SPI_BAUD
+#define XIO_FILE_SPI_BAUD 	21000000	// SPI clock - 25 series parts take the 0x03 read up to at least 33 MHz
+#endif
+#ifndef XIO_FILE_SIZE
+#define XIO_FILE_SIZE 		(1024L * 1024L - XIO_FILE_SECTOR_LEN)	// room for the job - fits an 8 Mbit part
+#endif
+
+#define XIO_FILE_PAGE_LEN 	256		// flash program page - also the read cache
+#define XIO_FILE_SECTOR_LEN 4096	// smallest flash erase
+#define XIO_FILE_MAGIC 		0x4A4F4231	// "JOB1" - marks a complete job in the header sector
+#define XIO_FILE_MAGIC_COMPACT 0x4A4F4232	// "JOB2" - ...a complete compact job
+#define XIO_FILE_LETTERS 	26		// word letters A-Z
+
+enum xioFileState {
+	XIO_FILE_IDLE = 0,				// no upload or job running
+	XIO_FILE_UPLOADING,				// lines are being stored
+	XIO_FILE_PLAYING				// the job is being read as input
+};
+
+enum xioFilePause {
+	XIO_FILE_RUN = 0,
+	XIO_FILE_PAUSE,					// hold at the next line
+	XIO_FILE_STOP					// abandon the job
+};
+
+typedef struct xioFileSingleton {
+	uint8_t present;				// TRUE if a flash answered at startup
+	uint8_t state;					// see xioFileState
+	uint8_t pause;					// see xioFilePause - set by $fp
+	uint32_t lines;					// lines in the stored job - stored so far while uploading
+	uint32_t linenum;				// line of the job last read
+	uint32_t line_read;				// job line number of the line read_line() last returned - 0 if from the console
+	uint32_t addr;					// next flash address to read or write
+	uint32_t end;					// end of the stored job
+	uint32_t page_addr;				// flash address of the page in page[]
+	uint16_t page_len;				// characters in page[] not yet programmed (uploading)
+	uint8_t page[XIO_FILE_PAGE_LEN];
+	uint8_t compact;				// TRUE if the job is a compact job
+
+	// last number of each word letter - compact jobs code against these
+	int32_t word_value[XIO_FILE_LETTERS];
+	uint8_t word_decimals[XIO_FILE_LETTERS];
+} xioFileSingleton_t;
+
+extern xioFileSingleton_t xf;
+
+void xio_file_init(void);
+stat_t xio_file_read_line(uint8_t *buffer, uint16_t *index, size_t size);
+stat_t xio_file_write_line(const char_t *line);
+uint8_t xio_file_uploading(void);
+uint32_t xio_file_linenum(void);
+
+stat_t xio_file_set_fl(cmdObj_t *cmd);
+stat_t xio_file_set_fr(cmdObj_t *cmd);
+stat_t xio_file_set_fp(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+	void xio_file_print_fl(cmdObj_t *cmd);
+	void xio_file_print_fr(cmdObj_t *cmd);
+	void xio_file_print_fp(cmdObj_t *cmd);
+#else
+	#define xio_file_print_fl tx_print_stub
+	#define xio_file_print_fr tx_print_stub
+	#define xio_file_print_fp tx_print_stub
+#endif
+
+#endif // _XIO_FILE_H_
@@ -0,0 +1,122 @@
+/*
+ * xio_lz.cpp - compressed input on the USB console
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart Jr.
+ * Copyright (c) 2013 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* See "Compressed input" in xio_lz.h. The decoder is shared by the USB receive
+ * interrupt (xio.cpp) and the simulator's console (platform/sim/sim_xio.cpp).
+ */
+#include "tinyg2.h"
+#include "config.h"
+#include "text_parser.h"
+#include "xio.h"
+#include "xio_lz.h"
+
+xioLzSingleton_t xz;
+
+/*
+ * xio_lz_get() - return the next character of text or _FDEV_ERR if more code is needed
+ * xio_lz_put() - take a byte of code - only after xio_lz_get() has returned _FDEV_ERR
+ *
+ *	A byte of code makes up to 18 characters, so the caller takes them one at a time
+ *	for as long as it has room and leaves the rest of the code where it is.
+ */
+static uint8_t _emit(const uint8_t c)
+{
+	xz.buf[xz.head] = c;
+	xz.head = (xz.head + 1) & (xz.window-1);
+	return (c);
+}
+
+int xio_lz_get()
+{
+	if (xz.pending >= 0) {
+		uint8_t c = (uint8_t)xz.pending;
+		xz.pending = -1;
+		return (_emit(c));
+	}
+	if (xz.count == 0) { return (_FDEV_ERR);}
+	xz.count--;
+	return (_emit(xz.buf[(xz.head - xz.offset) & (xz.window-1)]));
+}
+
+void xio_lz_put(const uint8_t code)
+{
+	switch (xz.state) {
+		case XIO_LZ_TOKEN: {
+			if (code < 0x80) { xz.pending = code; break;}
+			xz.token = code;
+			xz.state = XIO_LZ_OFFSET;
+			break;
+		}
+		case XIO_LZ_OFFSET: {
+			xz.offset = ((uint16_t)(xz.token & 0x70) << 4) | code;
+			if (xz.offset == 0) {				// escape - a character follows
+				xz.state = XIO_LZ_CHAR;
+				break;
+			}
+			xz.count = (xz.token & 0x0F) + XIO_LZ_MIN_COPY;
+			xz.state = XIO_LZ_TOKEN;
+			break;
+		}
+		case XIO_LZ_CHAR: {
+			xz.pending = code;
+			xz.state = XIO_LZ_TOKEN;
+			break;
+		}
+	}
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ ***********************************************************************************/
+/*
+ * xio_lz_set_cz() - grant a window and start taking compressed input, 0 goes back to text
+ *
+ *	The window is cleared with the decoder off, so the receive interrupt never sees
+ *	it half set up.
+ */
+stat_t xio_lz_set_cz(cmdObj_t *cmd)
+{
+	if (cmd->value < 0) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+
+	uint32_t window = 0;
+	if (cmd->value > 0) {
+		for (window = XIO_LZ_WINDOW_LEN; (window > XIO_LZ_WINDOW_MIN) && (window > cmd->value); window >>= 1);
+	}
+	xz.window = 0;
+	memset(xz.buf, 0, sizeof(xz.buf));
+	xz.head = 0;
+	xz.state = XIO_LZ_TOKEN;
+	xz.pending = -1;
+	xz.count = 0;
+	xz.window = window;
+	cmd->value = window;					// the response has the window granted
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_cz[] PROGMEM = "[cz]  compressed input window%6lu characters [0=text]\n";
+void xio_lz_print_cz(cmdObj_t *cmd) { text_print_int(cmd, fmt_cz);}
+
+#endif // __TEXT_MODE
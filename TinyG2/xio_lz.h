@@ -0,0 +1,89 @@
+/*
+ * xio_lz.h - compressed input on the USB console
+ * Part of TinyG2 project
+ *
+ * Copyright (c) 2013 Alden S. Hart Jr.
+ * Copyright (c) 2013 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _XIO_LZ_H_
+#define _XIO_LZ_H_
+
+/*
+ * Compressed input
+ *
+ *	On a dense toolpath the USB link's byte rate limits the blocks per second before
+ *	the planner does. Gcode repeats itself a lot, so a host can send it LZ compressed
+ *	against a window of the text it has already sent, and get several times as many
+ *	blocks through the same link.
+ *
+ *	  {"cz":1024}	ask for a window of up to 1024 characters. The response has the
+ *					window granted - the largest power of 2 from XIO_LZ_WINDOW_MIN to
+ *					XIO_LZ_WINDOW_LEN that is no more than asked for. Everything the
+ *					host sends after the response is compressed
+ *	  {"cz":0}		(sent compressed) go back to text
+ *
+ *	Send nothing after either until its response has come back. The code is byte
+ *	aligned, so a line can be sent as soon as it has been coded:
+ *
+ *	  0xxxxxxx				the character x
+ *	  1ooollll oooooooo		copy llll+3 characters from o back in the text, o from 1 to
+ *							the window less 1. Copies can overlap the characters they make
+ *	  1xxxxxxx 00000000 c	the character c - for characters above 0x7F (jog frames)
+ *
+ *	Text below 0x80 is its own code. The window starts empty at each {"cz":n}, so only
+ *	the text sent since can be copied from.
+ *
+ *	The code is undone in the USB receive interrupt as it is taken from the endpoint
+ *	(see xio.cpp), so realtime characters act as they do in text and the rx ring and
+ *	the flow control footer count characters of text. The decoder stops when the ring
+ *	is full and the rest of the code waits in the endpoint, which holds the host off.
+ */
+#ifndef XIO_LZ_WINDOW_LEN
+#define XIO_LZ_WINDOW_LEN 	1024	// largest window that can be granted - a power of 2, 2048 at most
+#endif
+#define XIO_LZ_WINDOW_MIN 	64		// smallest window - a smaller request gets this
+#define XIO_LZ_MIN_COPY 	3		// copy length coded as 0
+
+enum xioLzState {					// what the next byte of code is
+	XIO_LZ_TOKEN = 0,				// a character or the start of a copy
+	XIO_LZ_OFFSET,					// the low byte of a copy's offset
+	XIO_LZ_CHAR						// an escaped character
+};
+
+typedef struct xioLzSingleton {
+	volatile uint32_t window;		// window in use - 0 while input is text ($cz)
+	uint16_t head;					// next window slot to fill
+	uint8_t state;					// see xioLzState
+	uint8_t token;					// first byte of the copy being read
+	int16_t pending;				// character decoded and not yet taken, -1 if none
+	uint16_t offset;				// copy being made...
+	uint8_t count;					// ...and the characters left of it
+	uint8_t buf[XIO_LZ_WINDOW_LEN];
+} xioLzSingleton_t;
+
+extern xioLzSingleton_t xz;
+
+int xio_lz_get(void);
+void xio_lz_put(const uint8_t code);
+
+stat_t xio_lz_set_cz(cmdObj_t *cmd);
+
+#ifdef __TEXT_MODE
+	void xio_lz_print_cz(cmdObj_t *cmd);
+#else
+	#define xio_lz_print_cz tx_print_stub
+#endif
+
+#endif // _XIO_LZ_H_